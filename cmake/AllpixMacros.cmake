@@ -47,8 +47,18 @@ MACRO(_allpix_module_define_common name)
 Create the header or provide the alternative class name as first argument")
     ENDIF()
 
-    # Define the library
-    ADD_LIBRARY(${${name}} SHARED "")
+    # Define the library, which is built into the executable for the modules selected in ALLPIX_STATIC_MODULES
+    LIST(FIND ALLPIX_STATIC_MODULES ${_allpix_module_dir} _allpix_module_static)
+    IF(NOT ${ALLPIX_MODULE_EXTERNAL} AND _allpix_module_static GREATER -1)
+        ADD_LIBRARY(${${name}} STATIC "")
+
+        # Name the registration function called by the executable after the module
+        TARGET_COMPILE_DEFINITIONS(${${name}} PRIVATE ALLPIX_MODULE_STATIC_NAME="${_allpix_module_dir}")
+        TARGET_COMPILE_DEFINITIONS(${${name}} PRIVATE ALLPIX_MODULE_STATIC_REGISTER=allpix_register_module_${_allpix_module_dir})
+        SET(ALLPIX_STATIC_MODULE_NAMES ${ALLPIX_STATIC_MODULE_NAMES} ${_allpix_module_dir} CACHE INTERNAL "Static modules")
+    ELSE()
+        ADD_LIBRARY(${${name}} SHARED "")
+    ENDIF()
 
     # Add the current directory as include directory
     TARGET_INCLUDE_DIRECTORIES(${${name}} PRIVATE ${CMAKE_CURRENT_SOURCE_DIR})
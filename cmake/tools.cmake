@@ -150,3 +150,32 @@ FUNCTION(ADD_ALLPIX_TEST TEST)
     ENDIF()
 
 ENDFUNCTION()
+
+FUNCTION(ADD_ALLPIX_SCALING_TEST TEST)
+    # Numbers of workers to run the test with, defaults to one, two and four:
+    SET(WORKERS "1 2 4")
+    FILE(STRINGS ${TEST} TESTWORKERS REGEX "#WORKERS ")
+    IF(TESTWORKERS)
+        STRING(REPLACE "#WORKERS " "" WORKERS "${TESTWORKERS}")
+    ENDIF()
+    # Minimum speedup of the event rate with the largest number of workers:
+    FILE(STRINGS ${TEST} MINSPEEDUP REGEX "#MINSPEEDUP ")
+    IF(MINSPEEDUP)
+        STRING(REPLACE "#MINSPEEDUP " "" MINSPEEDUP "${MINSPEEDUP}")
+    ENDIF()
+
+    ADD_TEST(NAME ${TEST}
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+        COMMAND ${CMAKE_CURRENT_SOURCE_DIR}/run_scaling.sh "output/${TEST}" "${CMAKE_INSTALL_PREFIX}/bin/allpix" "${CMAKE_CURRENT_SOURCE_DIR}/${TEST}" "${WORKERS}" "${MINSPEEDUP}"
+    )
+
+    # Only one scaling test should be executed at a time
+    SET_TESTS_PROPERTIES(${TEST} PROPERTIES RUN_SERIAL TRUE LABELS "scaling")
+
+    # Add individual timeout criteria:
+    FILE(STRINGS ${TEST} TESTTIMEOUT REGEX "#TIMEOUT ")
+    IF(TESTTIMEOUT)
+        STRING(REPLACE "#TIMEOUT " "" TESTTIMEOUT "${TESTTIMEOUT}")
+        SET_TESTS_PROPERTIES(${TEST} PROPERTIES TIMEOUT "${TESTTIMEOUT}")
+    ENDIF()
+ENDFUNCTION()
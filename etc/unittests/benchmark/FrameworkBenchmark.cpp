@@ -0,0 +1,466 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the hot paths of the framework
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+#include <TBufferFile.h>
+#include <TClass.h>
+
+#include "core/config/ConfigReader.hpp"
+#include "core/config/Configuration.hpp"
+#include "core/geometry/Detector.hpp"
+#include "core/geometry/MonolithicPixelDetectorModel.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+#include "core/utils/log.h"
+#include "objects/DepositedCharge.hpp"
+#include "objects/Pulse.hpp"
+#include "tools/ROOT.h"
+#include "tools/runge_kutta.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Prevent the compiler from optimizing away the computation of a value
+     * @param value Value which should be considered used
+     */
+    template <typename T> inline void do_not_optimize(const T& value) { asm volatile("" : : "g"(&value) : "memory"); }
+
+    /**
+     * @brief Benchmark running a function for a given number of iterations
+     */
+    struct Benchmark {
+        std::string name;
+        std::function<void(uint64_t)> function;
+    };
+
+    /**
+     * @brief Result of a benchmark as the median time of all repetitions
+     */
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        double time;
+    };
+
+    /**
+     * @brief Module only used as source and receiver of messages
+     */
+    class BenchmarkModule : public Module {
+    public:
+        explicit BenchmarkModule(Configuration& config) : Module(config) {}
+        std::shared_ptr<DepositedChargeMessage> message;
+    };
+
+    /**
+     * @brief Detector with a pixel grid and an electric field grid, shared by the geometry and field benchmarks
+     * @return Detector at the origin
+     */
+    std::shared_ptr<Detector> make_detector() {
+        std::istringstream model_stream("number_of_pixels = 256 256\n"
+                                        "pixel_size = 0.055 0.055\n"
+                                        "sensor_thickness = 0.3\n");
+        ConfigReader reader(model_stream, "benchmark");
+        auto model = std::make_shared<MonolithicPixelDetectorModel>("benchmark", reader);
+        auto detector = std::make_shared<Detector>(
+            "benchmark", model, ROOT::Math::XYZPoint(0, 0, 0), ROOT::Math::Rotation3D());
+
+        // Fill a field grid of a single pixel with arbitrary values
+        std::array<size_t, 3> sizes{{25, 25, 60}};
+        auto field = std::make_shared<std::vector<double>>(3 * sizes[0] * sizes[1] * sizes[2]);
+        std::mt19937_64 random_generator(0);
+        std::uniform_real_distribution<double> distribution(-1., 1.);
+        std::generate(field->begin(), field->end(), [&]() { return distribution(random_generator); });
+
+        auto thickness = model->getSensorSize().z();
+        auto center = model->getSensorCenter().z();
+        detector->setElectricFieldGrid(field,
+                                       sizes,
+                                       {{1., 1.}},
+                                       {{0., 0.}},
+                                       {center - thickness / 2, center + thickness / 2},
+                                       FieldInterpolation::LINEAR);
+        return detector;
+    }
+
+    /**
+     * @brief Random local positions around the sensor of a detector
+     * @param detector Detector to generate the positions for
+     * @param scale Scale of the extent of the positions relative to the sensor size
+     * @return List of positions
+     */
+    std::vector<ROOT::Math::XYZPoint> make_positions(const Detector& detector, double scale) {
+        auto model = detector.getModel();
+        auto center = model->getSensorCenter();
+        auto size = model->getSensorSize() * scale;
+
+        std::mt19937_64 random_generator(1);
+        std::uniform_real_distribution<double> distribution(-0.5, 0.5);
+        std::vector<ROOT::Math::XYZPoint> positions(1024);
+        for(auto& position : positions) {
+            position = ROOT::Math::XYZPoint(center.x() + distribution(random_generator) * size.x(),
+                                            center.y() + distribution(random_generator) * size.y(),
+                                            center.z() + distribution(random_generator) * size.z());
+        }
+        return positions;
+    }
+
+    /**
+     * @brief Create the list of all benchmarks
+     * @return List of benchmarks
+     */
+    std::vector<Benchmark> make_benchmarks() {
+        std::vector<Benchmark> benchmarks;
+
+        // Field lookups and geometry checks
+        auto detector = make_detector();
+        auto sensor_positions = std::make_shared<std::vector<ROOT::Math::XYZPoint>>(make_positions(*detector, 0.99));
+        auto all_positions = std::make_shared<std::vector<ROOT::Math::XYZPoint>>(make_positions(*detector, 1.2));
+        benchmarks.push_back({"detector_field_get", [detector, sensor_positions](uint64_t iterations) {
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      auto field = detector->getElectricField((*sensor_positions)[i % 1024]);
+                                      do_not_optimize(field);
+                                  }
+                              }});
+        benchmarks.push_back({"detector_field_get_fast", [detector, sensor_positions](uint64_t iterations) {
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      auto field = detector->getElectricFieldFast((*sensor_positions)[i % 1024]);
+                                      do_not_optimize(field);
+                                  }
+                              }});
+        benchmarks.push_back({"detector_is_within_sensor", [detector, all_positions](uint64_t iterations) {
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      auto within = detector->isWithinSensor((*all_positions)[i % 1024]);
+                                      do_not_optimize(within);
+                                  }
+                              }});
+
+        // Runge-Kutta integration with a velocity depending on the position
+        benchmarks.push_back({"runge_kutta_rk5_step", [](uint64_t iterations) {
+                                  auto velocity = [](double, const Eigen::Vector3d& position) -> Eigen::Vector3d {
+                                      return Eigen::Vector3d(1e-3 * position.y(), -1e-3 * position.x(), 1e-2 + position.z());
+                                  };
+                                  Eigen::Vector3d initial(0.01, 0.02, -0.1);
+                                  auto runge_kutta = make_runge_kutta(tableau::RK5, velocity, 1e-3, initial);
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      runge_kutta.setValue(initial);
+                                      auto step = runge_kutta.step();
+                                      do_not_optimize(step);
+                                  }
+                              }});
+        benchmarks.push_back({"runge_kutta_rk5_batch_step_8", [](uint64_t iterations) {
+                                  using Values = std::array<std::array<double, 8>, 3>;
+                                  auto velocity = [](const Values& values, std::size_t count, Values& derivatives) {
+                                      for(std::size_t l = 0; l < count; ++l) {
+                                          derivatives[0][l] = 1e-3 * values[1][l];
+                                          derivatives[1][l] = -1e-3 * values[0][l];
+                                          derivatives[2][l] = 1e-2 + values[2][l];
+                                      }
+                                  };
+                                  BatchRungeKutta<double, 6, 8, 3, decltype(velocity)> runge_kutta(tableau::RK5, velocity);
+                                  Values initial{}, values{}, step{}, error{};
+                                  initial[2].fill(-0.1);
+                                  std::array<double, 8> step_sizes{};
+                                  step_sizes.fill(1e-3);
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      values = initial;
+                                      runge_kutta.step(values, step_sizes, 8, step, error);
+                                      do_not_optimize(values);
+                                  }
+                              }});
+
+        // Deposits used as message content and for serialization
+        auto deposits = std::make_shared<std::vector<DepositedCharge>>();
+        for(int i = 0; i < 100; ++i) {
+            deposits->emplace_back(
+                ROOT::Math::XYZPoint(i * 1e-3, 0, 0), ROOT::Math::XYZPoint(i * 1e-3, 0, 10), CarrierType::ELECTRON, 80, 0.);
+        }
+
+        // Message dispatching between two modules
+        benchmarks.push_back({"messenger_dispatch_message", [deposits](uint64_t iterations) {
+                                  Messenger messenger;
+                                  Configuration source_config("source");
+                                  source_config.set<std::string>("output", "");
+                                  Configuration receiver_config("receiver");
+                                  receiver_config.set<std::string>("input", "");
+                                  BenchmarkModule source(source_config);
+                                  BenchmarkModule receiver(receiver_config);
+                                  messenger.bindSingle(&receiver, &BenchmarkModule::message, MsgFlags::ALLOW_OVERWRITE);
+
+                                  auto message = std::make_shared<DepositedChargeMessage>(
+                                      std::vector<DepositedCharge>(deposits->begin(), deposits->begin() + 10));
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      messenger.dispatchMessage(&source, message);
+                                      messenger.clearMessages();
+                                  }
+                              }});
+
+        // Configuration lookups with conversion of the value
+        auto config = std::make_shared<Configuration>("benchmark");
+        config->set<double>("temperature", 293.15);
+        config->set<ROOT::Math::XYVector>("pixel_size", {0.055, 0.055});
+        benchmarks.push_back({"configuration_get_double", [config](uint64_t iterations) {
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      auto value = config->get<double>("temperature");
+                                      do_not_optimize(value);
+                                  }
+                              }});
+        benchmarks.push_back({"configuration_get_vector", [config](uint64_t iterations) {
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      auto value = config->get<ROOT::Math::XYVector>("pixel_size");
+                                      do_not_optimize(value);
+                                  }
+                              }});
+
+        // Summing of pulses with a few hundred bins
+        benchmarks.push_back({"pulse_add", [](uint64_t iterations) {
+                                  Pulse pulse(0.01);
+                                  for(int i = 0; i < 500; ++i) {
+                                      pulse.addCharge(std::sin(i * 0.1), 2. + i * 0.01);
+                                  }
+                                  Pulse total(0.01);
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      total += pulse;
+                                      do_not_optimize(total);
+                                  }
+                              }});
+
+        // Serialization of the objects of a message as written by the ROOTObjectWriter
+        benchmarks.push_back({"root_serialize_100_objects", [deposits](uint64_t iterations) {
+                                  std::vector<Object*> objects;
+                                  for(auto& deposit : *deposits) {
+                                      objects.push_back(&deposit);
+                                  }
+                                  auto* cls = TClass::GetClass(typeid(std::vector<Object*>));
+                                  TBufferFile buffer(TBuffer::kWrite);
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      buffer.Reset();
+                                      buffer.WriteObjectAny(&objects, cls);
+                                  }
+                                  do_not_optimize(buffer.Length());
+                              }});
+        benchmarks.push_back({"root_deserialize_100_objects", [deposits](uint64_t iterations) {
+                                  std::vector<Object*> objects;
+                                  for(auto& deposit : *deposits) {
+                                      objects.push_back(&deposit);
+                                  }
+                                  auto* cls = TClass::GetClass(typeid(std::vector<Object*>));
+                                  TBufferFile write_buffer(TBuffer::kWrite);
+                                  write_buffer.WriteObjectAny(&objects, cls);
+
+                                  for(uint64_t i = 0; i < iterations; ++i) {
+                                      TBufferFile buffer(
+                                          TBuffer::kRead, write_buffer.Length(), write_buffer.Buffer(), false);
+                                      auto* read_objects = static_cast<std::vector<Object*>*>(buffer.ReadObjectAny(cls));
+                                      for(auto* object : *read_objects) {
+                                          delete object;
+                                      }
+                                      delete read_objects;
+                                  }
+                              }});
+
+        return benchmarks;
+    }
+
+    /**
+     * @brief Measure the time per iteration of a benchmark
+     * @param benchmark Benchmark to measure
+     * @param min_time Minimum time of every repetition in seconds
+     * @param repetitions Number of repetitions to take the median of
+     * @return Median time per iteration in nanoseconds
+     */
+    Result measure(const Benchmark& benchmark, double min_time, unsigned int repetitions) {
+        auto run = [&](uint64_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            benchmark.function(iterations);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        // Increase the number of iterations until a single repetition takes at least the minimum time
+        uint64_t iterations = 1;
+        auto elapsed = run(iterations);
+        while(elapsed < min_time && iterations < (uint64_t(1) << 40u)) {
+            auto factor = (elapsed > 0 ? std::clamp(1.4 * min_time / elapsed, 2., 100.) : 100.);
+            iterations = static_cast<uint64_t>(std::ceil(static_cast<double>(iterations) * factor));
+            elapsed = run(iterations);
+        }
+
+        std::vector<double> times;
+        for(unsigned int i = 0; i < repetitions; ++i) {
+            times.push_back(run(iterations) * 1e9 / static_cast<double>(iterations));
+        }
+        std::sort(times.begin(), times.end());
+        return {benchmark.name, iterations, times[times.size() / 2]};
+    }
+
+    /**
+     * @brief Read a baseline of benchmark results
+     * @param file_name Name of the baseline file
+     * @return Map of the benchmark names to the time per iteration in nanoseconds
+     */
+    std::map<std::string, double> read_baseline(const std::string& file_name) {
+        std::map<std::string, double> baseline;
+        std::ifstream file(file_name);
+        if(!file) {
+            throw std::invalid_argument("cannot open baseline file " + file_name);
+        }
+
+        std::string line;
+        while(std::getline(file, line)) {
+            if(line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream stream(line);
+            std::string name;
+            double time = 0;
+            if(!(stream >> name >> time)) {
+                throw std::invalid_argument("invalid line \"" + line + "\" in baseline file " + file_name);
+            }
+            baseline[name] = time;
+        }
+        return baseline;
+    }
+} // namespace
+
+/**
+ * @brief Main function running the benchmarks and comparing them to a baseline
+ */
+int main(int argc, const char* argv[]) {
+    // Add stream and set default logging level
+    Log::addStream(std::cout);
+    Log::setReportingLevel(LogLevel::WARNING);
+
+    bool print_help = false;
+    bool list = false;
+    int return_code = 0;
+    std::string filter = ".*";
+    std::string baseline_file_name;
+    std::string save_file_name;
+    double min_time = 0.2;
+    unsigned int repetitions = 5;
+    double tolerance = 0.2;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-l") == 0) {
+            list = true;
+        } else if(strcmp(argv[i], "-f") == 0 && (i + 1 < argc)) {
+            filter = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-b") == 0 && (i + 1 < argc)) {
+            baseline_file_name = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-s") == 0 && (i + 1 < argc)) {
+            save_file_name = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-t") == 0 && (i + 1 < argc)) {
+            min_time = std::stod(argv[++i]);
+        } else if(strcmp(argv[i], "-r") == 0 && (i + 1 < argc)) {
+            repetitions = static_cast<unsigned int>(std::max(1, std::stoi(argv[++i])));
+        } else if(strcmp(argv[i], "-d") == 0 && (i + 1 < argc)) {
+            tolerance = std::stod(argv[++i]);
+        } else {
+            LOG(ERROR) << "Unrecognized command line argument or missing value \"" << argv[i] << "\"";
+            print_help = true;
+            return_code = 1;
+        }
+    }
+
+    // Print help if requested
+    if(print_help) {
+        std::cerr << "Usage: allpix_benchmark [OPTIONS]" << std::endl;
+        std::cout << "Measures the time per iteration of the hot paths of the framework" << std::endl;
+        std::cout << "Optional parameters:" << std::endl;
+        std::cout << "\t -l           list the available benchmarks" << std::endl;
+        std::cout << "\t -f <regex>   only run the benchmarks matching the regular expression" << std::endl;
+        std::cout << "\t -t <time>    minimum time of a single repetition in seconds (default is 0.2)" << std::endl;
+        std::cout << "\t -r <number>  number of repetitions to take the median time of (default is 5)" << std::endl;
+        std::cout << "\t -s <file>    store the results as baseline in the given file" << std::endl;
+        std::cout << "\t -b <file>    compare the results to the baseline stored in the given file" << std::endl;
+        std::cout << "\t -d <change>  relative slowdown compared to the baseline to fail at (default is 0.2)" << std::endl;
+        std::cout << "\t -h           print this help text" << std::endl;
+
+        Log::finish();
+        return return_code;
+    }
+
+    std::map<std::string, double> baseline;
+    std::vector<Result> results;
+    try {
+        if(!baseline_file_name.empty()) {
+            baseline = read_baseline(baseline_file_name);
+        }
+
+        std::regex filter_regex(filter);
+        for(const auto& benchmark : make_benchmarks()) {
+            if(!std::regex_search(benchmark.name, filter_regex)) {
+                continue;
+            }
+            if(list) {
+                std::cout << benchmark.name << std::endl;
+                continue;
+            }
+
+            auto result = measure(benchmark, min_time, repetitions);
+            std::cout << std::left << std::setw(32) << result.name << std::right << std::setw(14) << result.iterations
+                      << std::setw(12) << std::fixed << std::setprecision(2) << result.time << " ns";
+
+            // Compare to the baseline if available
+            auto iter = baseline.find(result.name);
+            if(iter != baseline.end()) {
+                auto change = (result.time - iter->second) / iter->second;
+                std::cout << std::setw(12) << iter->second << " ns" << std::setw(9) << std::showpos << 100 * change << "%"
+                          << std::noshowpos;
+                if(change > tolerance) {
+                    std::cout << "  SLOWER";
+                    return_code = 1;
+                }
+            }
+            std::cout << std::endl;
+            results.push_back(result);
+        }
+    } catch(std::exception& e) {
+        LOG(FATAL) << "Benchmark failed: " << e.what();
+        Log::finish();
+        return 1;
+    }
+
+    // Store the results as baseline
+    if(!save_file_name.empty()) {
+        std::ofstream file(save_file_name);
+        if(!file) {
+            LOG(FATAL) << "Cannot write baseline file " << save_file_name;
+            Log::finish();
+            return 1;
+        }
+        file << "# Baseline of allpix_benchmark: name and time per iteration in nanoseconds" << std::endl;
+        for(const auto& result : results) {
+            file << result.name << " " << std::setprecision(6) << result.time << std::endl;
+        }
+    }
+
+    Log::finish();
+    return return_code;
+}
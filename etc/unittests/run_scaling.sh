@@ -0,0 +1,56 @@
+ABSOLUTE_PATH="$( cd "$( dirname "${BASH_SOURCE}" )" && pwd )"
+
+# Load dependencies if run by the CI
+# FIXME: This is needed because of broken RPATH on Mac
+if [ -n "${CI}" ] && [ "$(uname)" == "Darwin" ]; then
+    source $ABSOLUTE_PATH/../../.gitlab/ci/init_x86_64.sh
+    source $ABSOLUTE_PATH/../../.gitlab/ci/load_deps.sh
+fi
+
+# Run the configuration given as third argument with the executable given as second argument for every number of workers
+# in the fourth argument, in the directory created from the first argument. The optional fifth argument is the minimum
+# speedup of the event rate with the largest number of workers compared to the smallest one.
+OUTPUT=$1
+EXECUTABLE=$2
+CONFIGURATION=$3
+WORKERS=$4
+MIN_SPEEDUP=$5
+
+rm -rf $OUTPUT
+mkdir -p $OUTPUT
+cd $OUTPUT
+
+# Write the scaling curve as CSV, the number of carriers is taken from the summary of the GenericPropagation module
+echo "workers,events,event_loop_time,events_per_second,carriers_per_second,speedup,efficiency" > scaling.csv
+for NUM in $WORKERS; do
+    mkdir -p workers_$NUM
+    (cd workers_$NUM && $EXECUTABLE -c $CONFIGURATION -o experimental_multithreading=true -o workers=$NUM \
+        -o profiling_file="profile" > output.log 2>&1)
+    if [ $? -ne 0 ]; then
+        cat workers_$NUM/output.log
+        echo "Run with $NUM workers failed"
+        exit 1
+    fi
+
+    EVENTS=$(sed -n 's/^  "events": \([0-9]*\),$/\1/p' workers_$NUM/output/profile.json)
+    TIME=$(sed -n 's/^  "event_loop_time": \(.*\),$/\1/p' workers_$NUM/output/profile.json)
+    CARRIERS=$(sed -n 's/.*Propagated total of \([0-9]*\) charges.*/\1/p' workers_$NUM/output.log | \
+        awk '{s += $1} END {print s + 0}')
+    if [ -z "$REFERENCE_WORKERS" ]; then
+        REFERENCE_WORKERS=$NUM
+        REFERENCE_RATE=$(awk "BEGIN {print $EVENTS / $TIME}")
+    fi
+    awk "BEGIN {rate = $EVENTS / $TIME; speedup = rate / $REFERENCE_RATE;
+                printf \"%d,%d,%g,%g,%g,%g,%g\n\", $NUM, $EVENTS, $TIME, rate, $CARRIERS / $TIME, speedup,
+                       speedup * $REFERENCE_WORKERS / $NUM}" >> scaling.csv
+done
+cat scaling.csv
+
+# Check the speedup of the largest number of workers
+if [ -n "$MIN_SPEEDUP" ]; then
+    SPEEDUP=$(tail -n 1 scaling.csv | cut -d, -f6)
+    if awk "BEGIN {exit !($SPEEDUP < $MIN_SPEEDUP)}"; then
+        echo "Speedup of $SPEEDUP is below the minimum speedup of $MIN_SPEEDUP"
+        exit 1
+    fi
+fi
@@ -8,6 +8,7 @@
 
 #include "Allpix.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <climits>
 #include <fstream>
@@ -16,6 +17,7 @@
 #include <thread>
 #include <utility>
 
+#include <TFile.h>
 #include <TROOT.h>
 #include <TRandom.h>
 #include <TStyle.h>
@@ -23,7 +25,9 @@
 
 #include "core/config/exceptions.h"
 #include "core/utils/file.h"
+#include "core/utils/huge_pages.h"
 #include "core/utils/log.h"
+#include "core/utils/numa.h"
 #include "core/utils/unit.h"
 
 #include "tools/units.h"
@@ -92,6 +96,11 @@ Allpix::Allpix(std::string config_file_name,
         Log::addStream(log_file_);
     }
 
+    // Write the log messages from a background thread if requested
+    if(global_config.get<bool>("log_asynchronous", false)) {
+        Log::setAsynchronous(true);
+    }
+
     // Wait for the first detailed messages until level and format are properly set
     LOG(TRACE) << "Global log level is set to " << log_level_string;
     LOG(TRACE) << "Global log format is set to " << log_format_string;
@@ -99,8 +108,8 @@ Allpix::Allpix(std::string config_file_name,
 
 /**
  * Performs the initialization, including:
- * - Initialize the random seeder
  * - Determine and create the output directory
+ * - Initialize the random seeder, using the seeds of the checkpoint if the run is resumed
  * - Include all the defined units
  * - Load the modules from the configuration
  */
@@ -114,10 +123,70 @@ void Allpix::load() {
     LOG(STATUS) << "Welcome to Allpix^2 " << ALLPIX_PROJECT_VERSION;
     global_config.set<std::string>("version", ALLPIX_PROJECT_VERSION);
 
+    // Get output directory
+    std::string directory = gSystem->pwd();
+    directory += "/output";
+    if(global_config.has("output_directory")) {
+        // Use config specified one if available
+        directory = global_config.getPath("output_directory");
+    }
+
+    // Use existing output directory if it exists
+    bool create_output_dir = true;
+    if(allpix::path_is_directory(directory)) {
+        if(global_config.get<bool>("purge_output_directory", false) && global_config.get<bool>("resume", false)) {
+            LOG(WARNING) << "Not deleting previous output directory " << directory << " since the run is resumed";
+            create_output_dir = false;
+        } else if(global_config.get<bool>("purge_output_directory", false)) {
+            LOG(DEBUG) << "Deleting previous output directory " << directory;
+            allpix::remove_path(directory);
+        } else {
+            LOG(DEBUG) << "Output directory " << directory << " already exists";
+            create_output_dir = false;
+        }
+    }
+    // Create the output directory
+    try {
+        if(create_output_dir) {
+            LOG(DEBUG) << "Creating output directory " << directory;
+            allpix::create_directories(directory);
+        }
+        // Change to the new/existing output directory
+        gSystem->ChangeDirectory(directory.c_str());
+    } catch(std::invalid_argument& e) {
+        LOG(ERROR) << "Cannot create output directory " << directory << ": " << e.what()
+                   << ". Using current directory instead.";
+    }
+
+    // Use the seeds of the checkpoint when resuming a run to reproduce the remaining events
+    auto checkpoint_file = global_config.get<std::string>("checkpoint_file", "checkpoint");
+    checkpoint_file = allpix::add_file_extension(std::string(gSystem->pwd()) + "/" + checkpoint_file, "root");
+    if(global_config.get<bool>("resume", false) && allpix::path_is_file(checkpoint_file)) {
+        TFile file(checkpoint_file.c_str(), "READ");
+        for(const auto& key : {"random_seed", "random_seed_core"}) {
+            std::string* value = nullptr;
+            file.GetObject((std::string("Allpix/") + key).c_str(), value);
+            if(value == nullptr) {
+                throw RuntimeError("Checkpoint file " + checkpoint_file + " does not contain the " + key);
+            }
+            if(global_config.has(key) && global_config.get<std::string>(key) != *value) {
+                LOG(WARNING) << "Replacing configured " << key << " by the value " << *value << " of the checkpoint";
+            }
+            global_config.set<std::string>(key, *value);
+            delete value;
+        }
+    }
+
     // Initialize the random seeders, one for modules, one for core components
     std::mt19937_64 seeder_modules;
     std::mt19937_64 seeder_core;
 
+    // Shards drawing their own seed from system entropy would neither produce independent events nor simulate the same setup
+    if(global_config.get<unsigned int>("number_of_shards", 1u) > 1 && !global_config.has("random_seed")) {
+        throw InvalidValueError(
+            global_config, "number_of_shards", "runs split into shards require the same random_seed for every shard");
+    }
+
     uint64_t seed = 0;
     if(global_config.has("random_seed")) {
         // Use provided random seed
@@ -150,47 +219,59 @@ void Allpix::load() {
         global_config.set<uint64_t>("random_seed_core", seed + 1);
     }
 
-    // Initialize ROOT random generator
-    gRandom->SetSeed(seeder_modules());
-
-    // Get output directory
-    std::string directory = gSystem->pwd();
-    directory += "/output";
-    if(global_config.has("output_directory")) {
-        // Use config specified one if available
-        directory = global_config.getPath("output_directory");
+    // Split the run into shards processed by separate jobs
+    auto number_of_shards = global_config.get<unsigned int>("number_of_shards", 1u);
+    auto shard_index = global_config.get<unsigned int>("shard_index", 0u);
+    if(number_of_shards == 0) {
+        throw InvalidValueError(global_config, "number_of_shards", "number of shards should be larger than zero");
     }
-
-    // Use existing output directory if it exists
-    bool create_output_dir = true;
-    if(allpix::path_is_directory(directory)) {
-        if(global_config.get<bool>("purge_output_directory", false)) {
-            LOG(DEBUG) << "Deleting previous output directory " << directory;
-            allpix::remove_path(directory);
-        } else {
-            LOG(DEBUG) << "Output directory " << directory << " already exists";
-            create_output_dir = false;
-        }
+    if(shard_index >= number_of_shards) {
+        throw InvalidValueError(global_config, "shard_index", "shard index should be smaller than the number of shards");
     }
-    // Create the output directory
-    try {
-        if(create_output_dir) {
-            LOG(DEBUG) << "Creating output directory " << directory;
-            allpix::create_directories(directory);
-        }
-        // Change to the new/existing output directory
-        gSystem->ChangeDirectory(directory.c_str());
-    } catch(std::invalid_argument& e) {
-        LOG(ERROR) << "Cannot create output directory " << directory << ": " << e.what()
-                   << ". Using current directory instead.";
+    if(number_of_shards > 1) {
+        // Derive the module seeds of every shard from the global seed, the core seed is shared to keep the same geometry
+        uint64_t shard_seed = global_config.get<uint64_t>("random_seed") + 0x9E3779B97F4A7C15ULL * (shard_index + 1ULL);
+        shard_seed = (shard_seed ^ (shard_seed >> 30u)) * 0xBF58476D1CE4E5B9ULL;
+        shard_seed = (shard_seed ^ (shard_seed >> 27u)) * 0x94D049BB133111EBULL;
+        shard_seed ^= (shard_seed >> 31u);
+        seeder_modules.seed(shard_seed);
+
+        // Distribute the events of the run over the shards
+        auto total_events = global_config.get<unsigned int>("number_of_events", 1u);
+        auto shard_events = total_events / number_of_shards + (shard_index < total_events % number_of_shards ? 1u : 0u);
+        global_config.set<unsigned int>("number_of_events", shard_events);
+        LOG(STATUS) << "Running shard " << shard_index << " of " << number_of_shards << " with " << shard_events << " of "
+                    << total_events << " events and derived seed " << shard_seed;
     }
 
+    // Initialize ROOT random generator
+    gRandom->SetSeed(seeder_modules());
+
     // Enable relevant multithreading if needed (disabled by default)
     if(global_config.get<bool>("experimental_multithreading", false)) {
         // Enable thread safety for ROOT
         ROOT::EnableThreadSafety();
     }
 
+    // Replicate the field grids on every memory node if requested, before the fields are set up by the modules
+    set_numa_replication(global_config.get<bool>("numa_field_replicas", false));
+
+    // Back the field grids with huge pages if requested
+    auto huge_page_mode = global_config.get<std::string>("huge_pages", "none");
+    std::transform(huge_page_mode.begin(), huge_page_mode.end(), huge_page_mode.begin(), ::tolower);
+    if(huge_page_mode == "none") {
+        set_huge_pages(HugePages::NONE);
+    } else if(huge_page_mode == "transparent") {
+        set_huge_pages(HugePages::TRANSPARENT);
+    } else if(huge_page_mode == "2mb") {
+        set_huge_pages(HugePages::EXPLICIT_2MB);
+    } else if(huge_page_mode == "1gb") {
+        set_huge_pages(HugePages::EXPLICIT_1GB);
+    } else {
+        throw InvalidValueError(
+            global_config, "huge_pages", "huge page mode should be 'none', 'transparent', '2MB' or '1GB'");
+    }
+
     // Set the default units to use
     register_units();
 
@@ -205,9 +286,35 @@ void Allpix::load() {
         mod_mgr_->load(msg_.get(), conf_mgr_.get(), geo_mgr_.get(), seeder_modules);
     } else {
         LOG(INFO) << "Skip loading modules because termination is requested";
+        return;
+    }
+
+    // Add the module exchanging the messages with the embedding application in front of all modules
+    if(embedded_) {
+        Configuration exchange_config("Exchange");
+        exchange_config.set<std::string>("input", "");
+        exchange_config.set<std::string>("output", "");
+        auto& instance_config =
+            conf_mgr_->addInstanceConfiguration(ModuleIdentifier("Exchange", "", 0), exchange_config);
+        auto exchange_module = std::make_unique<ExchangeModule>(instance_config, msg_.get());
+        exchange_module_ = exchange_module.get();
+        mod_mgr_->addModule(std::move(exchange_module));
     }
 }
 
+/**
+ * The flag is passed to the module manager through the global configuration, as the main ROOT file is created when loading
+ */
+void Allpix::enableEmbedding() {
+    LOG(DEBUG) << "Embedding framework, running events on demand";
+    embedded_ = true;
+    conf_mgr_->getGlobalConfiguration().set<bool>("_embedded", true);
+}
+
+std::shared_ptr<Detector> Allpix::getDetector(const std::string& name) {
+    return geo_mgr_->getDetector(name);
+}
+
 /**
  * Runs the Module::init() method linearly for every module
  */
@@ -233,6 +340,43 @@ void Allpix::run() {
         LOG(INFO) << "Skip running modules because termination is requested";
     }
 }
+/**
+ * The messages are dispatched by the \ref ExchangeModule before the configured modules are executed
+ */
+std::vector<std::shared_ptr<BaseMessage>> Allpix::runEvent(const std::vector<std::shared_ptr<BaseMessage>>& messages) {
+    if(exchange_module_ == nullptr) {
+        throw RuntimeError("Single events can only be run after loading the modules with embedding enabled");
+    }
+    if(terminate_) {
+        LOG(INFO) << "Skip running event because termination is requested";
+        return {};
+    }
+
+    for(const auto& message : messages) {
+        exchange_module_->addInput(message);
+    }
+    mod_mgr_->runEvent();
+    has_run_ = true;
+    return exchange_module_->takeOutput();
+}
+
+/**
+ * The events of all jobs are numbered consecutively, the modules are only finalized once after the last job
+ */
+unsigned int Allpix::runJob(unsigned int number_of_events,
+                            std::optional<uint64_t> seed,
+                            const std::vector<std::pair<std::string, std::string>>& parameters) {
+    if(terminate_) {
+        LOG(INFO) << "Skip running job because termination is requested";
+        return 0;
+    }
+
+    LOG(TRACE) << "Running job of " << number_of_events << " events";
+    auto events_run = mod_mgr_->runJob(number_of_events, seed, parameters);
+    has_run_ = true;
+    return events_run;
+}
+
 /**
  * Runs all modules Module::finalize() method linearly for every module
  */
@@ -17,12 +17,17 @@
 #include <atomic>
 #include <fstream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "config/ConfigManager.hpp"
 #include "geometry/GeometryManager.hpp"
 #include "messenger/Messenger.hpp"
+#include "module/ExchangeModule.hpp"
 #include "module/ModuleManager.hpp"
+#include "utils/exceptions.h"
 
 namespace allpix {
     /**
@@ -30,6 +35,10 @@ namespace allpix {
      *
      * Supply the path location the main configuration which should be provided to the executable. Hereafter this class
      * should be used to load, initialize, run and finalize all the modules.
+     *
+     * The framework can also be embedded in another application, which runs single events on demand. The messages of every
+     * event are then handed over in memory by the application and the messages of the bound types are returned directly,
+     * while the initialized state of all modules is kept between the events. The events are finalized together at the end.
      */
 
     class Allpix {
@@ -49,6 +58,33 @@ namespace allpix {
          */
         void load();
 
+        /**
+         * @brief Prepare the framework to be embedded in another application running single events with \ref runEvent
+         * @warning Should be called before the \ref Allpix::load "load function"
+         *
+         * The main ROOT file is only kept in memory, and an \ref ExchangeModule is added in front of all modules to pass
+         * the messages of the events between the application and the modules.
+         */
+        void enableEmbedding();
+
+        /**
+         * @brief Return all messages of a type dispatched by the modules from \ref runEvent, regardless of their name
+         * @warning Should be called after the \ref Allpix::load "load function" and before the first event is run
+         */
+        template <typename T> void bindOutput() {
+            if(exchange_module_ == nullptr) {
+                throw RuntimeError("Output messages can only be bound after loading the modules with embedding enabled");
+            }
+            exchange_module_->bindOutput<T>();
+        }
+
+        /**
+         * @brief Get a detector of the geometry, to create the messages handed over to \ref runEvent
+         * @param name Name of the detector
+         * @return Pointer to the detector
+         */
+        std::shared_ptr<Detector> getDetector(const std::string& name);
+
         /**
          * @brief Initialize all modules (pre-run)
          * @warning Should be called after the \ref Allpix::load "load function"
@@ -61,6 +97,27 @@ namespace allpix {
          */
         void run();
 
+        /**
+         * @brief Run all modules for a single event with the given messages (run)
+         * @param messages Messages dispatched to the modules at the start of the event
+         * @return Messages of the bound types dispatched by the modules in this event
+         * @warning Should be called after the \ref Allpix::init "init function" with embedding enabled, the history of the
+         * returned objects is only valid until the next event is run
+         */
+        std::vector<std::shared_ptr<BaseMessage>> runEvent(const std::vector<std::shared_ptr<BaseMessage>>& messages);
+
+        /**
+         * @brief Run all modules for a job of events, as done by the simulation server (run)
+         * @param number_of_events Number of events of the job
+         * @param seed Seed of the events of the job, the seeds continue from the previous job if not given
+         * @param parameters Module parameters changed before the job, as pairs of <module>.<parameter> and value
+         * @return Number of events run
+         * @warning Should be called after the \ref Allpix::init "init function", the jobs share the output of the run
+         */
+        unsigned int runJob(unsigned int number_of_events,
+                            std::optional<uint64_t> seed,
+                            const std::vector<std::pair<std::string, std::string>>& parameters);
+
         /**
          * @brief Finalize all modules (post-run)
          * @warning Should be called after the \ref Allpix::run "run function"
@@ -82,6 +139,10 @@ namespace allpix {
         std::atomic<bool> terminate_;
         std::atomic<bool> has_run_;
 
+        // Module exchanging the messages with the embedding application, owned by the module manager
+        ExchangeModule* exchange_module_{};
+        bool embedded_{false};
+
         // Log file if specified
         std::ofstream log_file_;
 
@@ -129,7 +129,7 @@ std::string Configuration::path_to_absolute(std::string path, bool canonicalize_
 }
 
 void Configuration::setText(const std::string& key, const std::string& val) {
-    config_[key] = val;
+    set_value(key, val);
 }
 
 /**
@@ -140,7 +140,7 @@ void Configuration::setAlias(const std::string& new_key, const std::string& old_
         return;
     }
     try {
-        config_[new_key] = config_.at(old_key);
+        set_value(new_key, config_.at(old_key));
     } catch(std::out_of_range& e) {
         throw MissingKeyError(old_key, getName());
     }
@@ -182,6 +182,75 @@ std::vector<std::pair<std::string, std::string>> Configuration::getAll() const {
     return result;
 }
 
+/**
+ * The hash is calculated with the 64-bit FNV-1a algorithm over the name and all keys and values, which are ordered by key.
+ */
+uint64_t Configuration::getHash() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const std::string& str) {
+        // Include the terminating null character to separate the strings
+        for(size_t i = 0; i <= str.size(); ++i) {
+            hash ^= static_cast<unsigned char>(str.c_str()[i]);
+            hash *= 1099511628211ull;
+        }
+    };
+
+    add(name_);
+    for(auto& key_value : getAll()) {
+        add(key_value.first);
+        add(key_value.second);
+    }
+    return hash;
+}
+
+std::set<std::string> Configuration::getParsedKeys() const {
+    std::set<std::string> keys;
+    std::lock_guard<std::mutex> lock(parse_cache_.mutex);
+    for(const auto& tree : parse_cache_.trees) {
+        if(!tree.first.empty() && tree.first.front() != '_') {
+            keys.insert(tree.first);
+        }
+    }
+    return keys;
+}
+
+/**
+ * The parse trees are shared with the callers, such that a tree stays valid if the key is set again while it is used. Values
+ * that cannot be parsed are not cached and throw again when read the next time.
+ */
+std::shared_ptr<const Configuration::parse_node> Configuration::get_parse_tree(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(parse_cache_.mutex);
+    auto iter = parse_cache_.trees.find(key);
+    if(iter != parse_cache_.trees.end()) {
+        return iter->second;
+    }
+
+    std::shared_ptr<const parse_node> tree = parse_value(config_.at(key));
+    parse_cache_.trees.emplace(key, tree);
+    return tree;
+}
+
+void Configuration::set_value(const std::string& key, std::string value) {
+    config_[key] = std::move(value);
+
+    std::lock_guard<std::mutex> lock(parse_cache_.mutex);
+    parse_cache_.trees.erase(key);
+}
+
+/**
+ * The cache of the assigned configuration is not copied, as the trees of the previous values are not valid anymore
+ */
+Configuration::ParseCache& Configuration::ParseCache::operator=(const ParseCache&) {
+    std::lock_guard<std::mutex> lock(mutex);
+    trees.clear();
+    return *this;
+}
+Configuration::ParseCache& Configuration::ParseCache::operator=(ParseCache&&) noexcept {
+    std::lock_guard<std::mutex> lock(mutex);
+    trees.clear();
+    return *this;
+}
+
 /**
  * String is recursively parsed for all pair of [ and ] brackets. All parts between single or double quotation marks are
  * skipped.
@@ -10,8 +10,11 @@
 #ifndef ALLPIX_CONFIGURATION_H
 #define ALLPIX_CONFIGURATION_H
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -28,7 +31,8 @@ namespace allpix {
      *
      * The configuration holds a set of keys with arbitrary values that are internally stored as strings. It has special
      * logic for reading paths (relative to the configuration file). All types are converted to their appropriate type using
-     * the library of \ref StringConversions.
+     * the library of \ref StringConversions. The parsed structure of every value is cached until the key is set again, such
+     * that reading arrays and matrices repeatedly only parses their value once.
      */
     class Configuration {
     public:
@@ -84,6 +88,23 @@ namespace allpix {
          */
         template <typename T> T get(const std::string& key, const T& def) const;
 
+        /**
+         * @brief Bind a variable to a key, assigning the value of the key converted to the type of the variable
+         * @param key Key to bind the variable to
+         * @param value Variable to assign the value to, typically a member of a module
+         *
+         * Intended to parse parameters once when constructing a module, such that the run method only accesses the bound
+         * variable instead of converting the value of the key from its string representation for every event.
+         */
+        template <typename T> void bind(const std::string& key, T& value) const;
+        /**
+         * @brief Bind a variable to a key, setting a default value first if the key is not defined yet
+         * @param key Key to bind the variable to
+         * @param value Variable to assign the value to, typically a member of a module
+         * @param def Default value to set if the key is not defined yet
+         */
+        template <typename T> void bind(const std::string& key, T& value, const T& def);
+
         /**
          * @brief Get values for a key containing an array
          * @param key Key to get values of
@@ -249,6 +270,25 @@ namespace allpix {
         // FIXME Better name for this function
         std::vector<std::pair<std::string, std::string>> getAll() const;
 
+        /**
+         * @brief Get a hash of the name and all key value pairs of the configuration
+         * @return Hash which is identical for configurations with the same name and the same values
+         *
+         * The hash does not depend on the order in which the keys were set and is identical between runs, such that it can
+         * be used as key of caches shared by module instances with the same configuration. Internal keys starting with an
+         * underscore, such as the random seed of a module, are not included.
+         */
+        uint64_t getHash() const;
+
+        /**
+         * @brief Get the keys whose values have been read since the configuration was created or copied
+         * @return Keys with a cached parse tree, excluding internal keys and keys set again after they have been read
+         *
+         * Used to find the parameters a module reads in its constructor, which cannot be changed by initializing the module
+         * again.
+         */
+        std::set<std::string> getParsedKeys() const;
+
     private:
         /**
          * @brief Make relative paths absolute from this configuration file
@@ -272,11 +312,42 @@ namespace allpix {
          */
         static std::unique_ptr<parse_node> parse_value(std::string str, int depth = 0);
 
+        /**
+         * @brief Get the parse tree of the value of a key, only parsing the value if it is not cached yet
+         * @param key Key to get the parse tree for
+         * @return Root node of the parsed tree
+         * @throws std::out_of_range If the key is not defined
+         */
+        std::shared_ptr<const parse_node> get_parse_tree(const std::string& key) const;
+
+        /**
+         * @brief Set the value of a key and remove its cached parse tree
+         * @param key Key to set
+         * @param value Value of the key
+         */
+        void set_value(const std::string& key, std::string value);
+
+        /**
+         * @brief Cache of the parse trees of all keys read, which starts empty for copies of the configuration
+         */
+        struct ParseCache {
+            ParseCache() = default;
+            ParseCache(const ParseCache&) {}
+            ParseCache(ParseCache&&) noexcept {}
+            ParseCache& operator=(const ParseCache&);
+            ParseCache& operator=(ParseCache&&) noexcept;
+            ~ParseCache() = default;
+
+            std::mutex mutex;
+            std::map<std::string, std::shared_ptr<const parse_node>> trees;
+        };
+
         std::string name_;
         std::string path_;
 
         using ConfigMap = std::map<std::string, std::string>;
         ConfigMap config_;
+        mutable ParseCache parse_cache_;
     };
 } // namespace allpix
 
@@ -15,7 +15,7 @@ namespace allpix {
      */
     template <typename T> T Configuration::get(const std::string& key) const {
         try {
-            auto node = parse_value(config_.at(key));
+            auto node = get_parse_tree(key);
             try {
                 return allpix::from_string<T>(node->value);
             } catch(std::invalid_argument& e) {
@@ -40,6 +40,21 @@ namespace allpix {
         return def;
     }
 
+    /**
+     * @throws MissingKeyError If the requested key is not defined
+     * @throws InvalidKeyError If the conversion to the requested type did not succeed
+     * @throws InvalidKeyError If an overflow happened while converting the key
+     */
+    template <typename T> void Configuration::bind(const std::string& key, T& value) const { value = get<T>(key); }
+    /**
+     * @throws InvalidKeyError If the conversion to the requested type did not succeed
+     * @throws InvalidKeyError If an overflow happened while converting the key
+     */
+    template <typename T> void Configuration::bind(const std::string& key, T& value, const T& def) {
+        setDefault<T>(key, def);
+        value = get<T>(key);
+    }
+
     /**
      * @throws MissingKeyError If the requested key is not defined
      * @throws InvalidKeyError If the conversion to the requested type did not succeed
@@ -47,10 +62,8 @@ namespace allpix {
      */
     template <typename T> std::vector<T> Configuration::getArray(const std::string& key) const {
         try {
-            std::string str = config_.at(key);
-
             std::vector<T> array;
-            auto node = parse_value(str);
+            auto node = get_parse_tree(key);
             for(auto& child : node->children) {
                 try {
                     array.push_back(allpix::from_string<T>(child->value));
@@ -85,10 +98,8 @@ namespace allpix {
      */
     template <typename T> Matrix<T> Configuration::getMatrix(const std::string& key) const {
         try {
-            std::string str = config_.at(key);
-
             Matrix<T> matrix;
-            auto node = parse_value(str);
+            auto node = get_parse_tree(key);
             for(auto& child : node->children) {
                 if(child->children.empty()) {
                     throw std::invalid_argument("matrix has less than two dimensions, enclosing brackets might be missing");
@@ -127,7 +138,7 @@ namespace allpix {
     }
 
     template <typename T> void Configuration::set(const std::string& key, const T& val) {
-        config_[key] = allpix::to_string(val);
+        set_value(key, allpix::to_string(val));
     }
 
     template <typename T>
@@ -140,7 +151,7 @@ namespace allpix {
             ret_str += ",";
         }
         ret_str.pop_back();
-        config_[key] = ret_str;
+        set_value(key, std::move(ret_str));
     }
 
     template <typename T> void Configuration::setArray(const std::string& key, const std::vector<T>& val) {
@@ -151,7 +162,7 @@ namespace allpix {
             str += ",";
         }
         str.pop_back();
-        config_[key] = str;
+        set_value(key, std::move(str));
     }
 
     template <typename T> void Configuration::setMatrix(const std::string& key, const Matrix<T>& val) {
@@ -172,7 +183,7 @@ namespace allpix {
         }
         str.pop_back();
         str += "]";
-        config_[key] = str;
+        set_value(key, std::move(str));
     }
 
     template <typename T> void Configuration::setDefault(const std::string& key, const T& val) {
@@ -8,6 +8,7 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -31,14 +32,13 @@ Detector::Detector(std::string name,
                    ROOT::Math::XYZPoint position,
                    const ROOT::Math::Rotation3D& orientation)
     : Detector(std::move(name), std::move(position), orientation) {
-    model_ = std::move(model);
     // Check if valid model is supplied
-    if(model_ == nullptr) {
+    if(model == nullptr) {
         throw InvalidModuleActionException("Detector model cannot be a null pointer");
     }
 
-    // Build the transformation matrix
-    build_transform();
+    // Set the model, which also builds the transformation matrix
+    set_model(std::move(model));
 }
 
 /**
@@ -56,6 +56,14 @@ void Detector::set_model(std::shared_ptr<DetectorModel> model) {
     // Initialize the detector fields with the model parameters:
     electric_field_.set_model_parameters(model_->getSensorCenter(), model_->getSensorSize(), model_->getPixelSize());
     weighting_potential_.set_model_parameters(model_->getSensorCenter(), model_->getSensorSize(), model_->getPixelSize());
+    magnetic_field_grid_.set_model_parameters(model_->getSensorCenter(), model_->getSensorSize(), model_->getPixelSize());
+
+    // Cache the model parameters used for the sensor and implant checks
+    sensor_center_ = model_->getSensorCenter();
+    sensor_size_ = model_->getSensorSize();
+    pixel_size_ = model_->getPixelSize();
+    implant_size_ = model_->getImplantSize();
+    geometry_view_ = DetectorGeometryView(sensor_center_, sensor_size_, pixel_size_, implant_size_, model_->getNPixels());
 
     build_transform();
 }
@@ -72,6 +80,10 @@ void Detector::build_transform() {
     ROOT::Math::Transform3D transform_local(translation_local);
     // Compute total transform local to global by first transforming local to locally centered and then to global coordinates
     transform_ = transform_center * transform_local.Inverse();
+
+    // Cache the inverse and the matrix components to avoid recomputing them for every conversion
+    inverse_transform_ = transform_.Inverse();
+    transform_.GetComponents(local_to_global_.begin());
 }
 
 std::string Detector::getName() const {
@@ -98,21 +110,46 @@ ROOT::Math::Rotation3D Detector::getOrientation() const {
  * The origin of the local frame is at the center of the first pixel in the middle of the sensor.
  */
 ROOT::Math::XYZPoint Detector::getLocalPosition(const ROOT::Math::XYZPoint& global_pos) const {
-    return transform_.Inverse()(global_pos);
+    return inverse_transform_(global_pos);
 }
 ROOT::Math::XYZPoint Detector::getGlobalPosition(const ROOT::Math::XYZPoint& local_pos) const {
     return transform_(local_pos);
 }
+void Detector::getGlobalPositions(const std::vector<double>& local_x,
+                                  const std::vector<double>& local_y,
+                                  const std::vector<double>& local_z,
+                                  std::vector<double>& global_x,
+                                  std::vector<double>& global_y,
+                                  std::vector<double>& global_z) const {
+    auto count = local_x.size();
+    global_x.resize(count);
+    global_y.resize(count);
+    global_z.resize(count);
+
+    // Copy the matrix components such that the compiler does not have to assume they alias the output
+    const auto m = local_to_global_;
+    const auto* lx = local_x.data();
+    const auto* ly = local_y.data();
+    const auto* lz = local_z.data();
+    auto* gx = global_x.data();
+    auto* gy = global_y.data();
+    auto* gz = global_z.data();
+    for(size_t i = 0; i < count; ++i) {
+        gx[i] = m[0] * lx[i] + m[1] * ly[i] + m[2] * lz[i] + m[3];
+        gy[i] = m[4] * lx[i] + m[5] * ly[i] + m[6] * lz[i] + m[7];
+        gz[i] = m[8] * lx[i] + m[9] * ly[i] + m[10] * lz[i] + m[11];
+    }
+}
+
+const DetectorGeometryView& Detector::getGeometryView() const {
+    return geometry_view_;
+}
 
 /**
  * The definition of inside the sensor is determined by the detector model
  */
 bool Detector::isWithinSensor(const ROOT::Math::XYZPoint& local_pos) const {
-    auto sensor_center = model_->getSensorCenter();
-    auto sensor_size = model_->getSensorSize();
-    return (2 * std::fabs(local_pos.z() - sensor_center.z()) <= sensor_size.z()) &&
-           (2 * std::fabs(local_pos.y() - sensor_center.y()) <= sensor_size.y()) &&
-           (2 * std::fabs(local_pos.x() - sensor_center.x()) <= sensor_size.x());
+    return geometry_view_.isWithinSensor(local_pos);
 }
 
 /**
@@ -121,29 +158,55 @@ bool Detector::isWithinSensor(const ROOT::Math::XYZPoint& local_pos) const {
  * @note The pixel implant currently is always positioned symmetrically, in the center of the pixel cell.
  */
 bool Detector::isWithinImplant(const ROOT::Math::XYZPoint& local_pos) const {
-
-    auto x_mod_pixel = std::fmod(local_pos.x() + model_->getPixelSize().x() / 2, model_->getPixelSize().x()) -
-                       model_->getPixelSize().x() / 2;
-    auto y_mod_pixel = std::fmod(local_pos.y() + model_->getPixelSize().y() / 2, model_->getPixelSize().y()) -
-                       model_->getPixelSize().y() / 2;
-
-    return (std::fabs(x_mod_pixel) <= std::fabs(model_->getImplantSize().x() / 2) &&
-            std::fabs(y_mod_pixel) <= std::fabs(model_->getImplantSize().y() / 2));
+    return geometry_view_.isWithinImplant(local_pos);
 }
 
 /**
  * The definition of the pixel grid size is determined by the detector model
  */
 bool Detector::isWithinPixelGrid(const Pixel::Index& pixel_index) const {
-    return !(pixel_index.x() >= model_->getNPixels().x() || pixel_index.y() >= model_->getNPixels().y());
+    return geometry_view_.isWithinPixelGrid(pixel_index);
 }
 
 /**
  * The definition of the pixel grid size is determined by the detector model
  */
 bool Detector::isWithinPixelGrid(const int x, const int y) const {
-    return !(x < 0 || x >= static_cast<int>(model_->getNPixels().x()) || y < 0 ||
-             y >= static_cast<int>(model_->getNPixels().y()));
+    return geometry_view_.isWithinPixelGrid(x, y);
+}
+
+bool Detector::hasRegionOfInterest() const {
+    return !regions_of_interest_.empty();
+}
+
+bool Detector::isWithinRegionOfInterest(const Pixel::Index& pixel_index) const {
+    if(regions_of_interest_.empty()) {
+        return true;
+    }
+    return std::any_of(regions_of_interest_.begin(), regions_of_interest_.end(), [&](const auto& region) {
+        return pixel_index.x() >= region[0] && pixel_index.y() >= region[1] && pixel_index.x() <= region[2] &&
+               pixel_index.y() <= region[3];
+    });
+}
+
+/**
+ * The pixels of the region of interest extend by half a pixel pitch around their centers, the margin is added on top
+ */
+bool Detector::isNearRegionOfInterest(const ROOT::Math::XYZPoint& local_pos, double margin) const {
+    if(regions_of_interest_.empty()) {
+        return true;
+    }
+    const auto& pitch = geometry_view_.getPixelSize();
+    return std::any_of(regions_of_interest_.begin(), regions_of_interest_.end(), [&](const auto& region) {
+        return local_pos.x() >= (region[0] - 0.5) * pitch[0] - margin &&
+               local_pos.y() >= (region[1] - 0.5) * pitch[1] - margin &&
+               local_pos.x() <= (region[2] + 0.5) * pitch[0] + margin &&
+               local_pos.y() <= (region[3] + 0.5) * pitch[1] + margin;
+    });
+}
+
+void Detector::set_regions_of_interest(std::vector<std::array<unsigned int, 4>> regions) {
+    regions_of_interest_ = std::move(regions);
 }
 
 /**
@@ -158,17 +221,11 @@ Pixel Detector::getPixel(unsigned int x, unsigned int y) const {
  * The pixel has internal information about the size and location specific for this detector
  */
 Pixel Detector::getPixel(const Pixel::Index& index) const {
-    auto size = model_->getPixelSize();
-
     // WARNING This relies on the origin of the local coordinate system
-    auto local_x = size.x() * index.x();
-    auto local_y = size.y() * index.y();
-    auto local_z = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
-
-    auto local_center = ROOT::Math::XYZPoint(local_x, local_y, local_z);
+    auto local_center = geometry_view_.getPixelCenter(static_cast<int>(index.x()), static_cast<int>(index.y()));
     auto global_center = getGlobalPosition(local_center);
 
-    return {index, local_center, global_center, size};
+    return {index, local_center, global_center, pixel_size_};
 }
 
 /**
@@ -186,6 +243,26 @@ bool Detector::hasElectricField() const {
 ROOT::Math::XYZVector Detector::getElectricField(const ROOT::Math::XYZPoint& pos) const {
     return electric_field_.get(pos);
 }
+void Detector::getElectricField(const std::vector<ROOT::Math::XYZPoint>& pos,
+                                std::vector<ROOT::Math::XYZVector>& fields) const {
+    electric_field_.get(pos, fields);
+}
+ROOT::Math::XYZVector Detector::getElectricFieldFast(const ROOT::Math::XYZPoint& pos) const {
+    return electric_field_.getFast(pos);
+}
+bool Detector::getElectricFieldGridView(FieldGridView& view) const {
+    return electric_field_.getGridView(view);
+}
+ROOT::Math::XYZVector
+Detector::getElectricField(const ROOT::Math::XYZPoint& pos, double time, FieldTimeBracket& bracket) const {
+    return electric_field_.get(pos, time, bracket);
+}
+void Detector::getElectricField(const double* pos, double time, FieldTimeBracket& bracket, double* field) const {
+    electric_field_.get(pos, time, bracket, field);
+}
+bool Detector::hasTimeDependentElectricField() const {
+    return electric_field_.isTimeDependent();
+}
 
 /**
  * The type of the electric field is set depending on the function used to apply it.
@@ -201,8 +278,25 @@ void Detector::setElectricFieldGrid(const std::shared_ptr<std::vector<double>>&
                                     std::array<size_t, 3> dimensions,
                                     std::array<double, 2> scales,
                                     std::array<double, 2> offset,
-                                    std::pair<double, double> thickness_domain) {
-    electric_field_.setGrid(field, dimensions, scales, offset, thickness_domain);
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation,
+                                    FieldStorage storage,
+                                    FieldSymmetry symmetry,
+                                    FieldLayout layout) {
+    electric_field_.setGrid(field, dimensions, scales, offset, thickness_domain, interpolation, storage, symmetry, layout);
+}
+void Detector::setElectricFieldGrid(const std::shared_ptr<const double>& field,
+                                    size_t size,
+                                    std::array<size_t, 3> dimensions,
+                                    std::array<double, 2> scales,
+                                    std::array<double, 2> offset,
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation,
+                                    FieldStorage storage,
+                                    FieldSymmetry symmetry,
+                                    FieldLayout layout) {
+    electric_field_.setGrid(
+        field, size, dimensions, scales, offset, thickness_domain, interpolation, storage, symmetry, layout);
 }
 
 void Detector::setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> function,
@@ -210,6 +304,23 @@ void Detector::setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> fun
                                         FieldType type) {
     electric_field_.setFunction(std::move(function), thickness_domain, type);
 }
+void Detector::setElectricFieldGridLoader(std::function<void()> loader, std::pair<double, double> thickness_domain) {
+    electric_field_.setGridLoader(std::move(loader), thickness_domain);
+}
+
+/**
+ * @throws std::invalid_argument If the electric field is not a grid, or the refined block does not fit into the grid
+ */
+void Detector::addElectricFieldGridRefinement(const std::shared_ptr<const double>& field,
+                                              size_t size,
+                                              std::array<size_t, 3> sizes,
+                                              std::array<size_t, 3> begin,
+                                              std::array<size_t, 3> cells) {
+    electric_field_.addGridRefinement(field, size, sizes, begin, cells);
+}
+void Detector::addElectricFieldTimeSlice(double time, const std::shared_ptr<const double>& field, size_t size) {
+    electric_field_.addTimeSlice(time, field, size);
+}
 
 bool Detector::hasWeightingPotential() const {
     return weighting_potential_.isValid();
@@ -231,6 +342,28 @@ double Detector::getWeightingPotential(const ROOT::Math::XYZPoint& pos, const Pi
     return weighting_potential_.getRelativeTo(pos, {local_x, local_y}, true);
 }
 
+void Detector::getWeightingPotentials(const ROOT::Math::XYZPoint& pos,
+                                      int x,
+                                      int y,
+                                      int matrix_x,
+                                      int matrix_y,
+                                      std::vector<double>& potentials) const {
+    auto size = model_->getPixelSize();
+
+    // WARNING This relies on the origin of the local coordinate system
+    auto first_x = size.x() * (x - matrix_x / 2);
+    auto first_y = size.y() * (y - matrix_y / 2);
+
+    // Extrapolating along z as for the potential of a single pixel
+    weighting_potential_.getRelativeTo(pos,
+                                       {first_x, first_y},
+                                       {size.x(), size.y()},
+                                       static_cast<size_t>(2 * (matrix_x / 2) + 1),
+                                       static_cast<size_t>(2 * (matrix_y / 2) + 1),
+                                       potentials,
+                                       true);
+}
+
 /**
  * The type of the weighting potential is set depending on the function used to apply it.
  */
@@ -246,8 +379,24 @@ void Detector::setWeightingPotentialGrid(const std::shared_ptr<std::vector<doubl
                                          std::array<size_t, 3> dimensions,
                                          std::array<double, 2> scales,
                                          std::array<double, 2> offset,
-                                         std::pair<double, double> thickness_domain) {
-    weighting_potential_.setGrid(potential, dimensions, scales, offset, thickness_domain);
+                                         std::pair<double, double> thickness_domain,
+                                         FieldInterpolation interpolation,
+                                         FieldStorage storage,
+                                         FieldSymmetry symmetry) {
+    weighting_potential_.setGrid(
+        potential, dimensions, scales, offset, thickness_domain, interpolation, storage, symmetry);
+}
+void Detector::setWeightingPotentialGrid(const std::shared_ptr<const double>& potential,
+                                         size_t size,
+                                         std::array<size_t, 3> dimensions,
+                                         std::array<double, 2> scales,
+                                         std::array<double, 2> offset,
+                                         std::pair<double, double> thickness_domain,
+                                         FieldInterpolation interpolation,
+                                         FieldStorage storage,
+                                         FieldSymmetry symmetry) {
+    weighting_potential_.setGrid(
+        potential, size, dimensions, scales, offset, thickness_domain, interpolation, storage, symmetry);
 }
 
 void Detector::setWeightingPotentialFunction(FieldFunction<double> function,
@@ -255,13 +404,14 @@ void Detector::setWeightingPotentialFunction(FieldFunction<double> function,
                                              FieldType type) {
     weighting_potential_.setFunction(std::move(function), thickness_domain, type);
 }
+void Detector::setWeightingPotentialGridLoader(std::function<void()> loader, std::pair<double, double> thickness_domain) {
+    weighting_potential_.setGridLoader(std::move(loader), thickness_domain);
+}
 
 bool Detector::hasMagneticField() const {
     return magnetic_field_on_;
 }
 
-// TODO Currently the magnetic field in the detector is fixed to the field vector at it's center position. Change in case a
-// field gradient is needed inside the sensor.
 void Detector::setMagneticField(ROOT::Math::XYZVector b_field) {
     magnetic_field_on_ = true;
     magnetic_field_ = std::move(b_field);
@@ -273,3 +423,37 @@ void Detector::setMagneticField(ROOT::Math::XYZVector b_field) {
 ROOT::Math::XYZVector Detector::getMagneticField() const {
     return magnetic_field_;
 }
+
+/**
+ * The grid spans the full sensor and is not replicated for every pixel: the offset shifts the start of the grid to the
+ * edge of the sensor, and the scales are the sensor size such that the whole sensor falls into the first replica.
+ */
+void Detector::setMagneticFieldGrid(const std::shared_ptr<std::vector<double>>& field, std::array<size_t, 3> dimensions) {
+    std::array<double, 2> scales{{sensor_size_.x(), sensor_size_.y()}};
+    std::array<double, 2> offset{{sensor_size_.x() / 2.0 - sensor_center_.x() - pixel_size_.x() / 2.0,
+                                  sensor_size_.y() / 2.0 - sensor_center_.y() - pixel_size_.y() / 2.0}};
+    auto thickness_domain = std::make_pair(sensor_center_.z() - sensor_size_.z() / 2.0,
+                                           sensor_center_.z() + sensor_size_.z() / 2.0);
+    magnetic_field_grid_.setGrid(field, dimensions, scales, offset, thickness_domain, FieldInterpolation::LINEAR);
+
+    magnetic_field_on_ = true;
+    magnetic_field_ = magnetic_field_grid_.get(sensor_center_);
+}
+
+bool Detector::hasMagneticFieldGrid() const {
+    return magnetic_field_grid_.isValid();
+}
+
+ROOT::Math::XYZVector Detector::getMagneticField(const ROOT::Math::XYZPoint& local_pos) const {
+    if(!magnetic_field_grid_.isValid()) {
+        return magnetic_field_;
+    }
+    return magnetic_field_grid_.get(local_pos);
+}
+void Detector::getMagneticField(const double* local_pos, double* field) const {
+    if(!magnetic_field_grid_.isValid()) {
+        magnetic_field_.GetCoordinates(field);
+        return;
+    }
+    magnetic_field_grid_.get(local_pos, field);
+}
@@ -26,6 +26,7 @@
 
 #include "Detector.hpp"
 #include "DetectorField.hpp"
+#include "DetectorGeometryView.hpp"
 #include "DetectorModel.hpp"
 
 #include "objects/Pixel.hpp"
@@ -89,6 +90,30 @@ namespace allpix {
          * @return Position in the global frame
          */
         ROOT::Math::XYZPoint getGlobalPosition(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Convert a set of positions in the detector frame to global positions
+         * @param local_x Local x coordinates of the positions
+         * @param local_y Local y coordinates of the positions
+         * @param local_z Local z coordinates of the positions
+         * @param global_x Global x coordinates of the positions, resized to the number of positions
+         * @param global_y Global y coordinates of the positions, resized to the number of positions
+         * @param global_z Global z coordinates of the positions, resized to the number of positions
+         *
+         * Applies the same transformation as \ref getGlobalPosition to all positions at once, such that the conversion can
+         * be vectorized over the positions.
+         */
+        void getGlobalPositions(const std::vector<double>& local_x,
+                                const std::vector<double>& local_y,
+                                const std::vector<double>& local_z,
+                                std::vector<double>& global_x,
+                                std::vector<double>& global_y,
+                                std::vector<double>& global_z) const;
+
+        /**
+         * @brief Get the flat description of the detector geometry for geometry queries in hot loops
+         * @return Geometry view of the detector
+         */
+        const DetectorGeometryView& getGeometryView() const;
 
         /**
          * @brief Returns if a local position is within the sensitive device
@@ -114,6 +139,27 @@ namespace allpix {
          */
         bool isWithinPixelGrid(const int x, const int y) const;
 
+        /**
+         * @brief Returns if a region of interest is defined for the detector
+         * @return True if the detector has a region of interest, false if the full pixel grid is of interest
+         */
+        bool hasRegionOfInterest() const;
+
+        /**
+         * @brief Returns if a pixel is within the region of interest of the detector
+         * @param pixel_index Index of the pixel
+         * @return True if the pixel is within any of the rectangles of the region of interest or if no region is defined
+         */
+        bool isWithinRegionOfInterest(const Pixel::Index& pixel_index) const;
+
+        /**
+         * @brief Returns if a local position is close to the region of interest of the detector
+         * @param local_pos Position in the local frame
+         * @param margin Distance in x and y the position may be outside of the pixels of the region of interest
+         * @return True if the position is within the margin around any rectangle of the region or if no region is defined
+         */
+        bool isNearRegionOfInterest(const ROOT::Math::XYZPoint& local_pos, double margin) const;
+
         /**
          * @brief Return a pixel object from the x- and y-index values
          * @return Pixel object
@@ -142,6 +188,50 @@ namespace allpix {
          * @return Vector of the field at the queried point
          */
         ROOT::Math::XYZVector getElectricField(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the electric field in the sensor at several local positions
+         * @param local_pos List of positions in the local frame
+         * @param fields List of vectors of the field at the queried points, resized to the number of positions
+         */
+        void getElectricField(const std::vector<ROOT::Math::XYZPoint>& local_pos,
+                              std::vector<ROOT::Math::XYZVector>& fields) const;
+        /**
+         * @brief Get the electric field in the sensor at a local position using the precomputed replica transform
+         * @param pos Position in the local frame
+         * @return Vector of the field at the queried point
+         * @note Intended for hot loops, can differ from \ref getElectricField for positions within rounding precision of a
+         * bin edge of the field grid
+         */
+        ROOT::Math::XYZVector getElectricFieldFast(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get a plain description of the electric field grid, e.g. to copy it to an accelerator
+         * @param view Description of the grid, only set if the electric field is a grid stored in double precision
+         * @return True if the electric field is a grid stored in double precision, false otherwise
+         */
+        bool getElectricFieldGridView(FieldGridView& view) const;
+        /**
+         * @brief Get the electric field in the sensor at a local position and time within the event
+         * @param pos Position in the local frame
+         * @param time Time within the event
+         * @param bracket Bracket of the time slices of the field, kept by the caller between lookups at close-by times
+         * @return Vector of the field at the queried point and time, identical to \ref getElectricField for static fields
+         */
+        ROOT::Math::XYZVector
+        getElectricField(const ROOT::Math::XYZPoint& local_pos, double time, FieldTimeBracket& bracket) const;
+        /**
+         * @brief Get the electric field in the sensor at a local position given as plain coordinates and a time
+         * @param local_pos Coordinates of the position in the local frame, three contiguous values
+         * @param time Time within the event
+         * @param bracket Bracket of the time slices of the field, kept by the caller between lookups at close-by times
+         * @param field Components of the field at the queried point and time, three contiguous values
+         * @note Intended for the step loops of the propagation, which pass the data of their Eigen vectors directly
+         */
+        void getElectricField(const double* local_pos, double time, FieldTimeBracket& bracket, double* field) const;
+        /**
+         * @brief Returns if the electric field of the detector changes with time
+         * @return True if the electric field has time slices, false otherwise
+         */
+        bool hasTimeDependentElectricField() const;
 
         /**
          * @brief Set the electric field in a single pixel in the detector using a grid
@@ -149,12 +239,43 @@ namespace allpix {
          * @param sizes The dimensions of the flat electric field array
          * @param scales Scaling factors for the field size, given in fractions of a pixel unit cell in x and y
          * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Interpolation of the field between the grid points
+         * @param storage Precision used to store the field values
+         * @param symmetry Symmetry of the field within the field cell, the grid only covers the reduced area
+         * @param layout Layout of the field values in memory
          */
         void setElectricFieldGrid(const std::shared_ptr<std::vector<double>>& field,
                                   std::array<size_t, 3> sizes,
                                   std::array<double, 2> scales,
                                   std::array<double, 2> offset,
-                                  std::pair<double, double> thickness_domain);
+                                  std::pair<double, double> thickness_domain,
+                                  FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                  FieldStorage storage = FieldStorage::DOUBLE,
+                                  FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                  FieldLayout layout = FieldLayout::FLAT);
+        /**
+         * @brief Set the electric field in a single pixel in the detector using a grid stored in externally owned memory
+         * @param field Pointer to the first value of the flat array of the field vectors, sharing ownership of the memory
+         * @param size Number of values of the flat electric field array
+         * @param sizes The dimensions of the flat electric field array
+         * @param scales Scaling factors for the field size, given in fractions of a pixel unit cell in x and y
+         * @param offset Offset of the field from the pixel edge, given in physical units
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Interpolation of the field between the grid points
+         * @param storage Precision used to store the field values
+         * @param symmetry Symmetry of the field within the field cell, the grid only covers the reduced area
+         * @param layout Layout of the field values in memory
+         */
+        void setElectricFieldGrid(const std::shared_ptr<const double>& field,
+                                  size_t size,
+                                  std::array<size_t, 3> sizes,
+                                  std::array<double, 2> scales,
+                                  std::array<double, 2> offset,
+                                  std::pair<double, double> thickness_domain,
+                                  FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                  FieldStorage storage = FieldStorage::DOUBLE,
+                                  FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                  FieldLayout layout = FieldLayout::FLAT);
         /**
          * @brief Set the electric field in a single pixel using a function
          * @param function Function used to retrieve the electric field
@@ -164,6 +285,32 @@ namespace allpix {
         void setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> function,
                                       std::pair<double, double> thickness_domain,
                                       FieldType type = FieldType::CUSTOM);
+        /**
+         * @brief Set the electric field using a grid which is only loaded at the first lookup of the field
+         * @param loader Function loading the grid and setting it through \ref setElectricFieldGrid
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         */
+        void setElectricFieldGridLoader(std::function<void()> loader, std::pair<double, double> thickness_domain);
+        /**
+         * @brief Refine a block of cells of the electric field grid with a finer grid
+         * @param field Pointer to the first value of the flat array of the refined field, sharing ownership of the memory
+         * @param size Number of values of the flat array of the refined field
+         * @param sizes The dimensions of the flat refined field array, integer multiples of the cells covered
+         * @param begin Index of the first cell of the electric field grid covered by the block in x, y and z
+         * @param cells Number of cells of the electric field grid covered by the block in x, y and z
+         */
+        void addElectricFieldGridRefinement(const std::shared_ptr<const double>& field,
+                                            size_t size,
+                                            std::array<size_t, 3> sizes,
+                                            std::array<size_t, 3> begin,
+                                            std::array<size_t, 3> cells);
+        /**
+         * @brief Add a time slice to the electric field grid, sharing all grid parameters with the field at time zero
+         * @param time Time within the event at which the slice holds, later than all previous slices
+         * @param field Pointer to the first value of the flat array of the field vectors, sharing ownership of the memory
+         * @param size Number of values of the flat electric field array
+         */
+        void addElectricFieldTimeSlice(double time, const std::shared_ptr<const double>& field, size_t size);
 
         /**
          * @brief Returns if the detector has a weighting potential in the sensor
@@ -185,17 +332,64 @@ namespace allpix {
          */
         double getWeightingPotential(const ROOT::Math::XYZPoint& local_pos, const Pixel::Index& reference) const;
 
+        /**
+         * @brief Get the weighting potentials of a matrix of pixels in the sensor at a local position
+         * @param local_pos Position in the local frame
+         * @param x x-coordinate of the pixel in the center of the matrix
+         * @param y y-coordinate of the pixel in the center of the matrix
+         * @param matrix_x Size of the matrix in x, even sizes are extended to the next odd size
+         * @param matrix_y Size of the matrix in y, even sizes are extended to the next odd size
+         * @param potentials Values of the potential, pixel (x - matrix_x / 2 + i, y - matrix_y / 2 + j) is stored at
+         *                   index i * (2 * (matrix_y / 2) + 1) + j
+         *
+         * Equivalent to calling \ref getWeightingPotential for all pixels of the matrix, but sharing the conversion of the
+         * position to the field grid between the pixels. Pixels of the matrix outside the pixel grid are not skipped.
+         */
+        void getWeightingPotentials(const ROOT::Math::XYZPoint& local_pos,
+                                    int x,
+                                    int y,
+                                    int matrix_x,
+                                    int matrix_y,
+                                    std::vector<double>& potentials) const;
+
         /**
          * @brief Set the weighting potential in a single pixel in the detector using a grid
          * @param potential Flat array of the potential vectors (see detailed description)
          * @param sizes The dimensions of the flat weighting potential array
          * @param thickness_domain Domain in local coordinates in the thickness direction where the potential holds
+         * @param interpolation Interpolation of the potential between the grid points
+         * @param storage Precision used to store the potential values
+         * @param symmetry Symmetry of the potential within the field cell, the grid only covers the reduced area
          */
         void setWeightingPotentialGrid(const std::shared_ptr<std::vector<double>>& potential,
                                        std::array<size_t, 3> sizes,
                                        std::array<double, 2> scales,
                                        std::array<double, 2> offset,
-                                       std::pair<double, double> thickness_domain);
+                                       std::pair<double, double> thickness_domain,
+                                       FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                       FieldStorage storage = FieldStorage::DOUBLE,
+                                       FieldSymmetry symmetry = FieldSymmetry::NONE);
+        /**
+         * @brief Set the weighting potential in a single pixel using a grid stored in externally owned memory
+         * @param potential Pointer to the first value of the flat array of the potential, sharing ownership of the memory
+         * @param size Number of values of the flat weighting potential array
+         * @param sizes The dimensions of the flat weighting potential array
+         * @param scales Physical extent of the potential in x and y
+         * @param offset Offset of the potential from the pixel edge, given in physical units
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the potential holds
+         * @param interpolation Interpolation of the potential between the grid points
+         * @param storage Precision used to store the potential values
+         * @param symmetry Symmetry of the potential within the field cell, the grid only covers the reduced area
+         */
+        void setWeightingPotentialGrid(const std::shared_ptr<const double>& potential,
+                                       size_t size,
+                                       std::array<size_t, 3> sizes,
+                                       std::array<double, 2> scales,
+                                       std::array<double, 2> offset,
+                                       std::pair<double, double> thickness_domain,
+                                       FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                       FieldStorage storage = FieldStorage::DOUBLE,
+                                       FieldSymmetry symmetry = FieldSymmetry::NONE);
         /**
          * @brief Set the weighting potential in a single pixel using a function
          * @param function Function used to retrieve the weighting potential
@@ -205,6 +399,12 @@ namespace allpix {
         void setWeightingPotentialFunction(FieldFunction<double> function,
                                            std::pair<double, double> thickness_domain,
                                            FieldType type = FieldType::CUSTOM);
+        /**
+         * @brief Set the weighting potential using a grid which is only loaded at the first lookup of the potential
+         * @param loader Function loading the grid and setting it through \ref setWeightingPotentialGrid
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the potential holds
+         */
+        void setWeightingPotentialGridLoader(std::function<void()> loader, std::pair<double, double> thickness_domain);
 
         /**
          * @brief Set the magnetic field in the detector
@@ -224,6 +424,32 @@ namespace allpix {
          * @return Vector of the field at the queried point
          */
         ROOT::Math::XYZVector getMagneticField() const;
+        /**
+         * @brief Set the magnetic field in the detector using a grid spanning the full sensor
+         * @param field Flat array of the field vectors in local coordinates
+         * @param dimensions The dimensions of the flat field array
+         *
+         * The grid covers the full sensor volume and is interpolated linearly between the grid points. The magnetic field
+         * returned by \ref getMagneticField() without position is set to the field at the center of the sensor.
+         */
+        void setMagneticFieldGrid(const std::shared_ptr<std::vector<double>>& field, std::array<size_t, 3> dimensions);
+        /**
+         * @brief Returns if the magnetic field in the sensor depends on the position
+         * @return True if the magnetic field is defined by a grid, false if it is constant
+         */
+        bool hasMagneticFieldGrid() const;
+        /**
+         * @brief Get the magnetic field in the sensor at a local position
+         * @param local_pos Position in the local frame
+         * @return Vector of the field at the queried point, the constant field if no grid is set
+         */
+        ROOT::Math::XYZVector getMagneticField(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the magnetic field in the sensor at a local position given as plain coordinates
+         * @param local_pos Coordinates of the position in the local frame, three contiguous values
+         * @param field Components of the field at the queried point, the constant field if no grid is set
+         */
+        void getMagneticField(const double* local_pos, double* field) const;
 
         /**
          * @brief Get the model of this detector
@@ -246,6 +472,12 @@ namespace allpix {
          */
         void set_model(std::shared_ptr<DetectorModel> model);
 
+        /**
+         * @brief Set the region of interest of the detector (used by the \ref GeometryManager)
+         * @param regions List of rectangles of pixels with the inclusive minimum and maximum pixel index in x and y
+         */
+        void set_regions_of_interest(std::vector<std::array<unsigned int, 4>> regions);
+
         /**
          * @brief Create the coordinate transformation
          */
@@ -257,8 +489,11 @@ namespace allpix {
         ROOT::Math::XYZPoint position_;
         ROOT::Math::Rotation3D orientation_;
 
-        // Transform matrix from global to local coordinates
+        // Transform matrix from local to global coordinates and its inverse
         ROOT::Math::Transform3D transform_;
+        ROOT::Math::Transform3D inverse_transform_;
+        // Components of the transform from local to global coordinates as row-major 3x4 matrix for batched conversions
+        std::array<double, 12> local_to_global_{};
 
         // Electric field
         DetectorField<ROOT::Math::XYZVector, 3> electric_field_;
@@ -269,6 +504,17 @@ namespace allpix {
         // Magnetic field properties
         ROOT::Math::XYZVector magnetic_field_;
         bool magnetic_field_on_;
+        DetectorField<ROOT::Math::XYZVector, 3> magnetic_field_grid_;
+
+        // Parameters of the model used by the sensor and implant checks, cached to avoid virtual calls into the model
+        ROOT::Math::XYZPoint sensor_center_;
+        ROOT::Math::XYZVector sensor_size_;
+        ROOT::Math::XYVector pixel_size_;
+        ROOT::Math::XYVector implant_size_;
+        DetectorGeometryView geometry_view_;
+
+        // Rectangles of pixels forming the region of interest, empty if the full pixel grid is of interest
+        std::vector<std::array<unsigned int, 4>> regions_of_interest_;
     };
 
 } // namespace allpix
@@ -29,4 +29,18 @@ namespace allpix {
      * Here, no inversion of the field components is required
      */
     template <> void flip_vector_components<double>(double&, bool, bool) {}
+
+    /*
+     * Vector field template specialization of helper function for field mirroring
+     */
+    template <>
+    void mirror_vector_components<ROOT::Math::XYZVector>(ROOT::Math::XYZVector& vec, double x, double y) {
+        vec.SetXYZ(x * vec.x(), y * vec.y(), vec.z());
+    }
+
+    /*
+     * Scalar field template specialization of helper function for field mirroring
+     * Here, no inversion of the field components is required
+     */
+    template <> void mirror_vector_components<double>(double&, double, double) {}
 } // namespace allpix
@@ -11,8 +11,17 @@
 #ifndef ALLPIX_DETECTOR_FIELD_H
 #define ALLPIX_DETECTOR_FIELD_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 #include <Math/Point2D.h>
@@ -20,6 +29,8 @@
 #include <Math/Vector2D.h>
 #include <Math/Vector3D.h>
 
+#include "core/utils/huge_pages.h"
+#include "core/utils/numa.h"
 #include "objects/Pixel.hpp"
 #include "tools/ROOT.h"
 
@@ -36,6 +47,222 @@ namespace allpix {
         CUSTOM,   ///< Custom field function
     };
 
+    /**
+     * @brief Interpolation of field grids between the grid points
+     */
+    enum class FieldInterpolation {
+        NEAREST = 0, ///< Value of the nearest grid point
+        LINEAR,      ///< Trilinear interpolation between the surrounding grid points
+    };
+
+    /**
+     * @brief Precision used to store the values of field grids
+     */
+    enum class FieldStorage {
+        DOUBLE = 0, ///< Double precision
+        FLOAT,      ///< Single precision
+        HALF,       ///< Half precision, relative to the largest absolute value of the field
+    };
+
+    /**
+     * @brief Symmetry of the field within the field cell used to reduce the area covered by field grids
+     */
+    enum class FieldSymmetry {
+        NONE = 0, ///< Grid covers the full field cell
+        QUADRANT, ///< Grid covers the quadrant of positive x and y, the field is mirrored at the center of the cell
+    };
+
+    /**
+     * @brief Layout of the values of field grids in memory
+     */
+    enum class FieldLayout {
+        FLAT = 0, ///< Flat array with the index in z running fastest, as read from the field file
+        BRICKED,  ///< Bricks of 4x4x4 grid points stored contiguously, such that close-by points share cache lines
+    };
+
+    /**
+     * @brief Plain description of a field grid stored in double precision and of its replica transform
+     *
+     * Allows to evaluate the field without the \ref DetectorField, e.g. by code running on accelerators. The values are
+     * owned by the field and only valid as long as the grid of the field is not replaced.
+     */
+    struct FieldGridView {
+        const double* values{};
+        size_t size{};
+        std::array<size_t, 3> dimensions{};
+        std::array<double, 2> scales{};
+        std::array<double, 2> inverse_scales{};
+        std::array<double, 2> replica_shift{};
+        std::array<double, 3> bin_factors{};
+        double thickness_begin{};
+        FieldInterpolation interpolation{FieldInterpolation::NEAREST};
+    };
+
+    /**
+     * @brief Bracket of the two time slices of a time-dependent field enclosing a point in time
+     *
+     * The bracket is kept by the caller between lookups at close-by times, e.g. for all steps of a charge carrier, such
+     * that the time slices are only searched again once the time leaves the bracket. A default bracket is empty.
+     */
+    struct FieldTimeBracket {
+        size_t lower{};
+        size_t upper{};
+        double begin{1.};
+        double end{0.};
+        double inverse_width{};
+    };
+
+    /**
+     * @brief Convert a single precision value to half precision, rounding to the nearest representable value
+     * @param value Single precision value
+     * @return Bits of the half precision value
+     */
+    inline uint16_t float_to_half(float value) {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        auto sign = static_cast<uint16_t>((bits >> 16u) & 0x8000u);
+        auto exponent = static_cast<int>((bits >> 23u) & 0xffu) - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffffu;
+
+        // Values too large are stored as infinity, values too small as zero
+        if(exponent >= 31) {
+            return static_cast<uint16_t>(sign | 0x7c00u);
+        }
+        if(exponent < -10) {
+            return sign;
+        }
+
+        // Subnormal values of half precision
+        if(exponent <= 0) {
+            mantissa |= 0x800000u;
+            auto shift = static_cast<uint32_t>(14 - exponent);
+            auto half = mantissa >> shift;
+            auto remainder = mantissa & ((1u << shift) - 1u);
+            auto halfway = 1u << (shift - 1u);
+            if(remainder > halfway || (remainder == halfway && (half & 1u) != 0)) {
+                ++half;
+            }
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        // Normal values, a carry from rounding correctly increments the exponent
+        auto half = (static_cast<uint32_t>(exponent) << 10u) | (mantissa >> 13u);
+        auto remainder = mantissa & 0x1fffu;
+        if(remainder > 0x1000u || (remainder == 0x1000u && (half & 1u) != 0)) {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    /**
+     * @brief Convert a half precision value to single precision
+     * @param half Bits of the half precision value
+     * @return Single precision value
+     */
+    inline float half_to_float(uint16_t half) {
+        uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16u;
+        uint32_t exponent = (half >> 10u) & 0x1fu;
+        uint32_t mantissa = half & 0x3ffu;
+
+        // Subnormal values are a multiple of the smallest subnormal value
+        if(exponent == 0) {
+            auto value = static_cast<float>(mantissa) * 5.9604645e-8f;
+            return (sign != 0 ? -value : value);
+        }
+
+        uint32_t bits = sign | (exponent == 31 ? 0x7f800000u : (exponent + 112u) << 23u) | (mantissa << 13u);
+        float value = 0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    /**
+     * @brief Get a copy of a field grid in reduced precision, shared between all fields converting the same grid
+     * @param source Flat field data in double precision
+     * @param size Number of values of the field data
+     * @param scale Scale the values are stored relative to, set by the conversion or taken from the shared copy
+     * @param convert Function converting the source data, returning the copy and its scale
+     * @return Shared copy of the field grid in reduced precision
+     *
+     * Identical detectors reading the same field share the source data, such that the converted copies are kept in a
+     * process-wide registry keyed by the source data. Only weak references are held, so a copy is released as soon as no
+     * field uses it anymore.
+     */
+    template <typename S, typename F>
+    std::shared_ptr<const std::vector<S>>
+    get_shared_grid(const std::shared_ptr<const double>& source, size_t size, double& scale, F convert) {
+        struct SharedGrid {
+            const double* values;
+            size_t size;
+            std::weak_ptr<const double> source;
+            std::weak_ptr<const std::vector<S>> grid;
+            double scale;
+        };
+        static std::mutex mutex;
+        static std::vector<SharedGrid> grids;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        grids.erase(std::remove_if(grids.begin(),
+                                   grids.end(),
+                                   [](const SharedGrid& entry) { return entry.source.expired() || entry.grid.expired(); }),
+                    grids.end());
+        for(auto& entry : grids) {
+            if(entry.values == source.get() && entry.size == size) {
+                auto grid = entry.grid.lock();
+                if(grid) {
+                    scale = entry.scale;
+                    return grid;
+                }
+            }
+        }
+
+        auto converted = convert();
+        std::shared_ptr<const std::vector<S>> grid = std::move(converted.first);
+        scale = converted.second;
+        grids.push_back({source.get(), size, source, grid, scale});
+        return grid;
+    }
+
+    /**
+     * @brief Get a copy of a field grid in memory backed by huge pages, shared between all fields using the same data
+     * @param source Flat field data in double precision
+     * @param size Number of values of the field data
+     * @return Shared copy of the field grid, see \ref allocate_huge_pages
+     *
+     * The copies are kept in a process-wide registry keyed by the source data like the copies of \ref get_shared_grid.
+     */
+    inline std::shared_ptr<const double> get_huge_page_grid(const std::shared_ptr<const double>& source, size_t size) {
+        struct HugePageGrid {
+            const double* values;
+            size_t size;
+            std::weak_ptr<const double> source;
+            std::weak_ptr<const double> grid;
+        };
+        static std::mutex mutex;
+        static std::vector<HugePageGrid> grids;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        grids.erase(std::remove_if(grids.begin(),
+                                   grids.end(),
+                                   [](const HugePageGrid& entry) { return entry.source.expired() || entry.grid.expired(); }),
+                    grids.end());
+        for(auto& entry : grids) {
+            if(entry.values == source.get() && entry.size == size) {
+                auto grid = entry.grid.lock();
+                if(grid) {
+                    return grid;
+                }
+            }
+        }
+
+        auto memory = allocate_huge_pages(size * sizeof(double));
+        auto* values = static_cast<double*>(memory.get());
+        std::copy_n(source.get(), size, values);
+        std::shared_ptr<const double> grid(memory, values);
+        grids.push_back({source.get(), size, source, grid});
+        return grid;
+    }
+
     /**
      * @brief Functor returning the field at a given position
      * @param pos Position in local coordinates at which the field should be evaluated
@@ -50,6 +277,14 @@ namespace allpix {
      */
     template <typename T> void flip_vector_components(T& field, bool x, bool y);
 
+    /**
+     * @brief Helper function to multiply the field vector components with the signs of the mirroring at field boundaries
+     * @param field Field value, templated to support vector fields and scalar fields
+     * @param x     Sign of the x-direction, either 1 or -1
+     * @param y     Sign of the y-direction, either 1 or -1
+     */
+    template <typename T> void mirror_vector_components(T& field, double x, double y);
+
     /**
      * @brief Field instance of a detector
      *
@@ -69,7 +304,9 @@ namespace allpix {
          * @brief Check if the field is valid and either a field grid or a field function is configured
          * @return Boolean indicating field validity
          */
-        bool isValid() const { return function_ || (dimensions_[0] != 0 && dimensions_[1] != 0 && dimensions_[2] != 0); };
+        bool isValid() const {
+            return loader_ || function_ || (dimensions_[0] != 0 && dimensions_[1] != 0 && dimensions_[2] != 0);
+        };
 
         /**
          * @brief Return the type of field
@@ -84,6 +321,80 @@ namespace allpix {
          */
         T get(const ROOT::Math::XYZPoint& local_pos) const;
 
+        /**
+         * @brief Get the field value in the sensor at a position and time for time-dependent fields
+         * @param pos Position in the local frame
+         * @param time Time within the event
+         * @param bracket Bracket of the time slices enclosing the time, updated if the time is outside of it
+         * @return Value(s) of the field at the queried point and time
+         *
+         * The field is interpolated linearly in time between the enclosing time slices and is constant before the first and
+         * after the last slice. The position is only converted to the grid once for both slices, such that the lookup costs
+         * about two lookups of a static grid. Fields without time slices return the same value as \ref get.
+         */
+        T get(const ROOT::Math::XYZPoint& local_pos, double time, FieldTimeBracket& bracket) const;
+
+        /**
+         * @brief Check if the field has time slices, loading it first if it is loaded lazily
+         * @return True if the field changes with time, false otherwise
+         */
+        bool isTimeDependent() const {
+            load_grid();
+            return !time_slices_.empty();
+        }
+
+        /**
+         * @brief Get the field values in the sensor at several positions provided in local coordinates
+         * @param local_pos List of positions in the local frame
+         * @param values List of values of the field at the queried points, resized to the number of positions
+         */
+        void get(const std::vector<ROOT::Math::XYZPoint>& local_pos, std::vector<T>& values) const;
+
+        /**
+         * @brief Get the components of a vector field at a position given as plain coordinates
+         * @param local_pos Coordinates of the position in the local frame, three contiguous values
+         * @param value Components of the field at the queried point, three contiguous values
+         *
+         * Identical to \ref get for vector fields, intended for hot loops storing positions in other vector types such as
+         * the Eigen vectors of the propagation, which pass their data without converting it to a ROOT point and back.
+         */
+        void get(const double* local_pos, double* value) const {
+            get_value(local_pos[0], local_pos[1], local_pos[2]).GetCoordinates(value);
+        }
+
+        /**
+         * @brief Get the components of a vector field at a position given as plain coordinates and a time
+         * @param local_pos Coordinates of the position in the local frame, three contiguous values
+         * @param time Time within the event
+         * @param bracket Bracket of the time slices enclosing the time, updated if the time is outside of it
+         * @param value Components of the field at the queried point and time, three contiguous values
+         */
+        void get(const double* local_pos, double time, FieldTimeBracket& bracket, double* value) const {
+            get_value(local_pos[0], local_pos[1], local_pos[2], time, bracket).GetCoordinates(value);
+        }
+
+        /**
+         * @brief Get the field value in the sensor at a position using the precomputed replica transform
+         * @param local_pos Position in the local frame
+         * @return Value(s) of the field at the queried point
+         *
+         * Alternative to \ref get for hot loops, using reciprocal field scales and bin widths precomputed when setting the
+         * field and a branch-free mirroring of the odd field replicas. The result can differ from \ref get by one bin for
+         * positions within rounding precision of a bin edge.
+         */
+        T getFast(const ROOT::Math::XYZPoint& local_pos) const;
+
+        /**
+         * @brief Get a plain description of the field grid, loading it first if it is loaded lazily
+         * @param view Description of the grid, only set if the field is a full grid stored in double precision
+         * @return True if the field is a grid covering the full field cell stored in double precision in the flat layout,
+         *         false otherwise
+         *
+         * Values looked up from the description with the replica transform of \ref getFast are identical to the values
+         * returned by \ref getFast. Refined and time-dependent grids have no plain description.
+         */
+        bool getGridView(FieldGridView& view) const;
+
         /**
          * @brief Get the value of the field at a position provided in local coordinates with respect to the reference
          * @param pos       Position in the local frame
@@ -95,6 +406,27 @@ namespace allpix {
                         const ROOT::Math::XYPoint& reference,
                         const bool extrapolate_z = false) const;
 
+        /**
+         * @brief Get the values of the field at a position with respect to a regular matrix of reference positions
+         * @param local_pos Position in the local frame
+         * @param first_reference Reference position of the first matrix element, x and y coordinate only
+         * @param step Distance between neighboring reference positions of the matrix in x and y
+         * @param columns Number of reference positions in x
+         * @param rows Number of reference positions in y
+         * @param values Values of the field for all reference positions, element (i, j) is stored at index i * rows + j
+         * @param extrapolate_z Extrapolate the field along z when outside the defined region
+         *
+         * Equivalent to calling \ref getRelativeTo for every reference position of the matrix. For field grids the position
+         * in z is only converted once and the positions in x and y once per column and row of the matrix.
+         */
+        void getRelativeTo(const ROOT::Math::XYZPoint& local_pos,
+                           const ROOT::Math::XYPoint& first_reference,
+                           const ROOT::Math::XYVector& step,
+                           size_t columns,
+                           size_t rows,
+                           std::vector<T>& values,
+                           const bool extrapolate_z = false) const;
+
         /**
          * @brief Set the field in the detector using a grid
          * @param field Flat array of the field
@@ -102,12 +434,48 @@ namespace allpix {
          * @param scales The actual physical extent of the field in each direction in x and y
          * @param offset Offset of the field in x and y, given in physical units
          * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Interpolation of the field between the grid points
+         * @param storage Precision used to store the field values, values are converted to double precision at lookup
+         * @param symmetry Symmetry of the field within the field cell, the grid only covers the reduced area
+         * @param layout Layout of the field values in memory, the field is always given in the flat layout
          */
         void setGrid(std::shared_ptr<std::vector<double>> field,
                      std::array<size_t, 3> dimensions,
                      std::array<double, 2> scales,
                      std::array<double, 2> offset,
-                     std::pair<double, double> thickness_domain);
+                     std::pair<double, double> thickness_domain,
+                     FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                     FieldStorage storage = FieldStorage::DOUBLE,
+                     FieldSymmetry symmetry = FieldSymmetry::NONE,
+                     FieldLayout layout = FieldLayout::FLAT);
+        /**
+         * @brief Set the field in the detector using a grid stored in externally owned memory
+         * @param field Pointer to the first value of the flat array of the field, sharing ownership of the memory
+         * @param size Number of values of the flat array of the field
+         * @param dimensions The dimensions of the flat field array
+         * @param scales The actual physical extent of the field in each direction in x and y
+         * @param offset Offset of the field in x and y, given in physical units
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Interpolation of the field between the grid points
+         * @param storage Precision used to store the field values, values are converted to double precision at lookup
+         * @param symmetry Symmetry of the field within the field cell, the grid only covers the reduced area
+         * @param layout Layout of the field values in memory, the field is always given in the flat layout
+         *
+         * With double precision storage and the flat layout, the field is used in place without copying, e.g. from a
+         * memory-mapped file. The scales always describe the full field cell, also if the grid only covers a quadrant of it.
+         * The bricked layout reorders the field into a copy padded to full bricks, which is shared between all fields
+         * reordering the same data.
+         */
+        void setGrid(std::shared_ptr<const double> field,
+                     size_t size,
+                     std::array<size_t, 3> dimensions,
+                     std::array<double, 2> scales,
+                     std::array<double, 2> offset,
+                     std::pair<double, double> thickness_domain,
+                     FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                     FieldStorage storage = FieldStorage::DOUBLE,
+                     FieldSymmetry symmetry = FieldSymmetry::NONE,
+                     FieldLayout layout = FieldLayout::FLAT);
         /**
          * @brief Set the field in the detector using a function
          * @param function Function used to calculate the field
@@ -117,8 +485,60 @@ namespace allpix {
         void setFunction(FieldFunction<T> function,
                          std::pair<double, double> thickness_domain,
                          FieldType type = FieldType::CUSTOM);
+        /**
+         * @brief Set the field in the detector using a grid which is only loaded at the first lookup of the field
+         * @param loader Function loading the grid and setting it through \ref setGrid
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         *
+         * The loader is called exactly once, by the first thread looking up the field, while other threads looking up the
+         * field at the same time wait for the grid. Fields of detectors which are never hit are thus never loaded.
+         */
+        void setGridLoader(std::function<void()> loader, std::pair<double, double> thickness_domain);
+
+        /**
+         * @brief Refine a block of cells of the field grid with a finer grid stored in externally owned memory
+         * @param field Pointer to the first value of the flat array of the refined field, sharing ownership of the memory
+         * @param size Number of values of the flat array of the refined field
+         * @param dimensions The dimensions of the flat refined field array, integer multiples of the cells covered
+         * @param begin Index of the first cell of the field grid covered by the refined block in x, y and z
+         * @param cells Number of cells of the field grid covered by the refined block in x, y and z
+         *
+         * Lookups in cells covered by a refined block use the values of the block instead of the coarse grid, the block is
+         * found through an index of the block of every cell of the grid. Interpolation only uses the points of the block,
+         * the field is taken constant between the outermost points of the block and its edges. The values of refined blocks
+         * are always stored in double precision. Blocks are removed when the grid is set again.
+         */
+        void addGridRefinement(std::shared_ptr<const double> field,
+                               size_t size,
+                               std::array<size_t, 3> dimensions,
+                               std::array<size_t, 3> begin,
+                               std::array<size_t, 3> cells);
+
+        /**
+         * @brief Add a time slice to the field grid, making the field time-dependent
+         * @param time Time within the event at which the slice holds, later than all previous slices
+         * @param field Pointer to the first value of the flat array of the field at this time, sharing ownership of memory
+         * @param size Number of values of the flat array of the field at this time
+         *
+         * The grid set by \ref setGrid is the field at time zero. Time slices share its dimensions, scales, offset,
+         * thickness domain, interpolation, storage, symmetry and layout, and are removed when the grid is set again. Refined
+         * blocks and time slices cannot be combined.
+         */
+        void addTimeSlice(double time, std::shared_ptr<const double> field, size_t size);
 
     private:
+        /**
+         * @brief Load the grid of the field if it is loaded lazily and has not been loaded yet
+         */
+        void load_grid() const {
+            if(loader_ && !loader_->loaded.load(std::memory_order_acquire)) {
+                std::call_once(loader_->flag, [this]() {
+                    loader_->load();
+                    loader_->loaded.store(true, std::memory_order_release);
+                });
+            }
+        }
+
         /**
          * @brief Set the relevant parameters from the detector model this field is used for
          * @param sensor_center The center of the sensor in local coordinates
@@ -132,6 +552,53 @@ namespace allpix {
             sensor_size_ = sensor_size;
             pixel_size_ = pixel_pitch;
             model_initialized_ = true;
+            update_replica_transform();
+        }
+
+        /**
+         * @brief Helper function to precompute the replica transform and grid binning used by \ref getFast
+         */
+        void update_replica_transform();
+
+        /**
+         * @brief Helper function to search the time slices enclosing a point in time
+         * @param time Time within the event
+         * @param bracket Bracket of the time slices to update
+         */
+        void find_time_bracket(double time, FieldTimeBracket& bracket) const;
+
+        /**
+         * @brief Helper function to access a time slice of the field, the first slice being the field itself
+         * @param index Index of the time slice
+         * @return Field of the time slice
+         */
+        const DetectorField& time_slice(size_t index) const {
+            return (index == 0 ? *this : *time_slices_[index - 1]);
+        }
+
+        /**
+         * @brief Helper function to map a position onto the field replica it is located in
+         * @param x Position in x, converted to the frame of the replica
+         * @param y Position in y, converted to the frame of the replica
+         * @param sign_x Sign of the mirroring of the replica in x, to be applied to the vector components
+         * @param sign_y Sign of the mirroring of the replica in y, to be applied to the vector components
+         */
+        void to_replica_frame(double& x, double& y, double& sign_x, double& sign_y) const;
+
+        /**
+         * @brief Helper function to calculate the index of the first value of a grid point in the field data
+         * @param x Index of the grid point in x
+         * @param y Index of the grid point in y
+         * @param z Index of the grid point in z
+         * @return Index of the first component of the grid point in the layout of the field
+         */
+        size_t grid_offset(size_t x, size_t y, size_t z) const {
+            if(layout_ == FieldLayout::BRICKED) {
+                auto brick = ((x / brick_size) * bricks_[1] + y / brick_size) * bricks_[2] + z / brick_size;
+                auto point = ((x % brick_size) * brick_size + y % brick_size) * brick_size + z % brick_size;
+                return (brick * brick_size * brick_size * brick_size + point) * N;
+            }
+            return ((x * dimensions_[1] + y) * dimensions_[2] + z) * N;
         }
 
         /**
@@ -141,6 +608,49 @@ namespace allpix {
          */
         template <std::size_t... I> auto get_impl(size_t offset, std::index_sequence<I...>) const;
 
+        /**
+         * @brief Helper function to retrieve the return type from a calculated index of the values of a refined block
+         * @param values Values of the refined block
+         * @param offset The calculated index to start from
+         * @param index sequence expanded to the number of elements requested, depending on the template instance
+         */
+        template <std::size_t... I>
+        static T get_block_impl(const double* values, size_t offset, std::index_sequence<I...>);
+
+        /**
+         * @brief Helper function to look up or interpolate the value at a position in a regular grid
+         * @param value Function returning the value at the grid point with the given indices in x, y and z
+         * @param pos Position in x, y and z in units of grid bins, starting at the lower edge of the grid
+         * @param dimensions Number of bins of the grid in x, y and z
+         * @param mirror_x Whether the grid is mirrored at its lower edge in x, for quadrant grids
+         * @param mirror_y Whether the grid is mirrored at its lower edge in y, for quadrant grids
+         * @return Value of the nearest grid point or interpolated between the surrounding grid points
+         */
+        template <typename F>
+        T interpolate_grid(F&& value,
+                           const std::array<double, 3>& pos,
+                           const std::array<size_t, 3>& dimensions,
+                           bool mirror_x,
+                           bool mirror_y) const;
+
+        /**
+         * @brief Get the double precision grid values to use by the calling thread, preferring the copy on its memory node
+         * @return Pointer to the first value of the flat field data
+         */
+        const double* node_values() const;
+
+        /**
+         * @brief Helper function to compute the field value at a position given by its coordinates in the local frame
+         * @return Value(s) of the field at the queried point
+         */
+        T get_value(double x, double y, double z) const;
+
+        /**
+         * @brief Helper function to compute the field value at a position given by its coordinates and a time
+         * @return Value(s) of the field at the queried point and time
+         */
+        T get_value(double x, double y, double z, double time, FieldTimeBracket& bracket) const;
+
         /**
          * @brief Helper function to calculate the field index based on the distance from its center and to return the values
          * @param dist Distance from the center of the field to obtain the values for, given in local coordinates
@@ -149,15 +659,56 @@ namespace allpix {
          */
         T get_field_from_grid(const ROOT::Math::XYZPoint& dist, const bool extrapolate_z = false) const;
 
+        /**
+         * @brief Helper function to convert a coordinate relative to the center of the field to units of grid bins
+         * @param coordinate Coordinate in x or y relative to the center of the field
+         * @param axis Axis of the coordinate, 0 for x and 1 for y
+         * @return Position in units of grid bins from the lower edge of the grid, and sign of the mirroring into the grid
+         */
+        std::pair<double, double> to_grid_bins(double coordinate, size_t axis) const;
+
+        /**
+         * @brief Helper function to convert a coordinate in z to units of grid bins
+         * @param z Coordinate in z in local coordinates
+         * @return Position in units of grid bins from the lower edge of the thickness domain
+         */
+        double to_grid_bins_z(double z) const;
+
+        /**
+         * @brief Helper function to return the value(s) of the field at a position given in units of grid bins
+         * @param pos_x Position in x in units of grid bins
+         * @param pos_y Position in y in units of grid bins
+         * @param pos_z Position in z in units of grid bins
+         * @param sign_x Sign of the mirroring into the grid in x
+         * @param sign_y Sign of the mirroring into the grid in y
+         * @param extrapolate_z Switch to either extrapolate the field along z when outside the grid or return zero
+         * @return Value(s) of the field at the queried point
+         */
+        T get_field_from_bins(
+            double pos_x, double pos_y, double pos_z, double sign_x, double sign_y, const bool extrapolate_z) const;
+
         /**
          * Field properties
          * * Dimensions of the field map (bins in x, y, z)
          * * Scale of the field in x and y direction, defaults to 1, 1, i.e. to one full pixel cell
          * * Offset of the field from the pixel edge, e.g. when using fields centered at a pixel corner instead of the center
+         * * Symmetry of the field within the field cell, determining the area of the cell covered by the grid
          */
         std::array<size_t, 3> dimensions_{};
         std::array<double_t, 2> scales_{{1., 1.}};
         std::array<double_t, 2> offset_{{0., 0.}};
+        FieldInterpolation interpolation_{FieldInterpolation::NEAREST};
+        FieldSymmetry symmetry_{FieldSymmetry::NONE};
+
+        /**
+         * Layout of the field values in memory
+         * * Number of grid points along every axis of a brick of the bricked layout
+         * * Number of bricks in x, y and z, the last brick along every axis is padded if the dimensions are no multiple of
+         *   the brick size
+         */
+        static constexpr size_t brick_size = 4;
+        FieldLayout layout_{FieldLayout::FLAT};
+        std::array<size_t, 3> bricks_{};
 
         /**
          * Field definition
@@ -170,12 +721,78 @@ namespace allpix {
          * component in the flat field vector can be calculated as:
          *
          *   field_i(x, y, z) =  x * Y_SIZE* Z_SIZE * N + y * Z_SIZE * + z * N + i
+         *
+         * in the flat layout. In the bricked layout, the bricks are stored in the same order, and the points within every
+         * brick are again stored with the index in z running fastest, see \ref grid_offset.
+         *
+         * Depending on the storage precision, only one of the flat vectors is used. Half precision values are stored
+         * relative to the largest absolute value of the field. Reduced precision copies are shared between all fields
+         * converting the same data, see \ref get_shared_grid.
          */
-        std::shared_ptr<std::vector<double>> field_;
+        std::shared_ptr<const double> field_;
+        std::shared_ptr<const std::vector<float>> field_float_;
+        std::shared_ptr<const std::vector<uint16_t>> field_half_;
+        double half_scale_{1.};
+        FieldStorage storage_{FieldStorage::DOUBLE};
         std::pair<double, double> thickness_domain_{};
         FieldType type_{FieldType::NONE};
         FieldFunction<T> function_;
 
+        /*
+         * Loader of grids which are loaded at the first lookup, shared to keep the field copyable
+         */
+        struct GridLoader {
+            std::function<void()> load;
+            std::once_flag flag;
+            std::atomic<bool> loaded{false};
+        };
+        std::shared_ptr<GridLoader> loader_;
+
+        /*
+         * Copies of double precision grids on every memory node if enabled, see \ref numa_replication. Every copy is created
+         * by the first lookup from a thread on its node, such that its memory is allocated on that node. The copies are
+         * backed by huge pages if enabled, see \ref allocate_huge_pages.
+         */
+        struct NodeReplicas {
+            explicit NodeReplicas(size_t nodes) : grids(nodes), flags(nodes), values(nodes) {}
+            std::vector<std::shared_ptr<void>> grids;
+            std::vector<std::once_flag> flags;
+            std::vector<std::atomic<const double*>> values;
+        };
+        std::shared_ptr<NodeReplicas> replicas_;
+        size_t size_{};
+
+        /*
+         * Refined blocks of the grid, with the index of the block covering every cell of the grid starting from one, while
+         * zero denotes cells without refinement. The index follows the layout of the grid and is empty without refinements.
+         */
+        struct GridBlock {
+            std::shared_ptr<const double> values;
+            std::array<size_t, 3> dimensions;
+            std::array<size_t, 3> begin;
+            std::array<double, 3> factors;
+        };
+        std::vector<GridBlock> blocks_;
+        std::vector<uint16_t> block_index_;
+
+        /*
+         * Time slices of time-dependent grids after the grid at time zero, with the time of every slice
+         */
+        std::vector<double> slice_times_;
+        std::vector<std::shared_ptr<const DetectorField>> time_slices_;
+
+        /*
+         * Precomputed replica transform for fast lookups
+         * * Shift of local coordinates to the lower edge of the field replica at the local origin
+         * * Reciprocal of the field scales in x and y
+         * * Number of bins per unit length in x, y and z of the field grid
+         * * Shift of coordinates in the replica frame to the lower edge of the field grid
+         */
+        std::array<double, 2> replica_shift_{};
+        std::array<double, 2> inverse_scales_{{1., 1.}};
+        std::array<double, 3> bin_factors_{};
+        std::array<double, 2> grid_shift_{};
+
         /*
          * Relevant parameters from the detector model for this field
          */
@@ -18,6 +18,7 @@ namespace allpix {
     T DetectorField<T, N>::getRelativeTo(const ROOT::Math::XYZPoint& pos,
                                          const ROOT::Math::XYPoint& ref,
                                          const bool extrapolate_z) const {
+        load_grid();
         if(type_ == FieldType::NONE) {
             return {};
         }
@@ -46,23 +47,87 @@ namespace allpix {
         return ret_val;
     }
 
+    /**
+     * The bins of the grid are computed separately for the coordinates in x, y and z and combined for all elements of the
+     * matrix, iterating the rows of each column such that neighboring lookups access close-by grid points.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::getRelativeTo(const ROOT::Math::XYZPoint& pos,
+                                            const ROOT::Math::XYPoint& first_reference,
+                                            const ROOT::Math::XYVector& step,
+                                            size_t columns,
+                                            size_t rows,
+                                            std::vector<T>& values,
+                                            const bool extrapolate_z) const {
+        load_grid();
+        values.resize(columns * rows);
+        if(type_ != FieldType::GRID) {
+            for(size_t i = 0; i < columns; ++i) {
+                for(size_t j = 0; j < rows; ++j) {
+                    auto reference = first_reference + ROOT::Math::XYVector(static_cast<double>(i) * step.x(),
+                                                                            static_cast<double>(j) * step.y());
+                    values[i * rows + j] = getRelativeTo(pos, reference, extrapolate_z);
+                }
+            }
+            return;
+        }
+
+        auto pos_z = to_grid_bins_z(pos.z());
+        std::vector<std::pair<double, double>> bins_y(rows);
+        for(size_t j = 0; j < rows; ++j) {
+            bins_y[j] = to_grid_bins(pos.y() - (first_reference.y() + static_cast<double>(j) * step.y()), 1);
+        }
+        for(size_t i = 0; i < columns; ++i) {
+            auto bins_x = to_grid_bins(pos.x() - (first_reference.x() + static_cast<double>(i) * step.x()), 0);
+            for(size_t j = 0; j < rows; ++j) {
+                values[i * rows + j] = get_field_from_bins(
+                    bins_x.first, bins_y[j].first, pos_z, bins_x.second, bins_y[j].second, extrapolate_z);
+            }
+        }
+    }
+
     // Maps the field indices onto the range of -d/2 < x < d/2, where d is the scale of the field in coordinate x.
     // This means, {x,y,z} = (0,0,0) is in the center of the field.
     template <typename T, size_t N>
     T DetectorField<T, N>::get_field_from_grid(const ROOT::Math::XYZPoint& dist, const bool extrapolate_z) const {
+        auto x = to_grid_bins(dist.x(), 0);
+        auto y = to_grid_bins(dist.y(), 1);
+        return get_field_from_bins(x.first, y.first, to_grid_bins_z(dist.z()), x.second, y.second, extrapolate_z);
+    }
+
+    /**
+     * Grids covering a quadrant only span 0 < x < d/2, the position is mirrored into the quadrant and the sign of the
+     * mirroring is returned to mirror the vector components back. If the number of bins in x or y is 1, the field is
+     * assumed to be 2-dimensional and the position is always in the center of the single bin. This circumvents that the
+     * field size in the respective dimension would otherwise be zero.
+     */
+    template <typename T, size_t N>
+    std::pair<double, double> DetectorField<T, N>::to_grid_bins(double coordinate, size_t axis) const {
+        auto sign = 1.;
+        auto grid_size = scales_[axis];
+        if(symmetry_ == FieldSymmetry::QUADRANT) {
+            sign = (coordinate < 0 ? -1. : 1.);
+            coordinate *= sign;
+            grid_size /= 2.0;
+        }
+        auto position = (dimensions_[axis] == 1 ? 0.5
+                                                : static_cast<double>(dimensions_[axis]) *
+                                                      (coordinate + grid_shift_[axis]) / grid_size);
+        return {position, sign};
+    }
+
+    template <typename T, size_t N> double DetectorField<T, N>::to_grid_bins_z(double z) const {
+        return static_cast<double>(dimensions_[2]) * (z - thickness_domain_.first) /
+               (thickness_domain_.second - thickness_domain_.first);
+    }
+
+    template <typename T, size_t N>
+    T DetectorField<T, N>::get_field_from_bins(
+        double pos_x, double pos_y, double pos_z, double sign_x, double sign_y, const bool extrapolate_z) const {
         // Compute indices
-        // If the number of bins in x or y is 1, the field is assumed to be 2-dimensional and the respective index
-        // is forced to zero. This circumvents that the field size in the respective dimension would otherwise be zero
-        // clang-format off
-        auto x_ind = (dimensions_[0] == 1 ? 0
-                                          : static_cast<int>(std::floor(static_cast<double>(dimensions_[0]) *
-                                                                        (dist.x() + scales_[0] / 2.0) / scales_[0])));
-        auto y_ind = (dimensions_[1] == 1 ? 0
-                                          : static_cast<int>(std::floor(static_cast<double>(dimensions_[1]) *
-                                                                        (dist.y() + scales_[1] / 2.0) / scales_[1])));
-        auto z_ind = static_cast<int>(std::floor(static_cast<double>(dimensions_[2]) * (dist.z() - thickness_domain_.first) /
-                                                 (thickness_domain_.second - thickness_domain_.first)));
-        // clang-format on
+        auto x_ind = static_cast<int>(std::floor(pos_x));
+        auto y_ind = static_cast<int>(std::floor(pos_y));
+        auto z_ind = static_cast<int>(std::floor(pos_z));
 
         // Check for indices within the field map
         if(x_ind < 0 || x_ind >= static_cast<int>(dimensions_[0]) || y_ind < 0 ||
@@ -78,27 +143,115 @@ namespace allpix {
             return {};
         }
 
-        // Compute total index
-        size_t tot_ind = static_cast<size_t>(x_ind) * dimensions_[1] * dimensions_[2] * N +
-                         static_cast<size_t>(y_ind) * dimensions_[2] * N + static_cast<size_t>(z_ind) * N;
+        // Look up the value in the refined block covering the cell if there is one, or in the grid otherwise
+        T value;
+        uint16_t block = 0;
+        if(!block_index_.empty()) {
+            auto cell = (static_cast<size_t>(x_ind) * dimensions_[1] + static_cast<size_t>(y_ind)) * dimensions_[2] +
+                        static_cast<size_t>(z_ind);
+            block = block_index_[cell];
+        }
+        auto quadrant = (symmetry_ == FieldSymmetry::QUADRANT);
+        if(block == 0) {
+            auto values = [&](size_t i, size_t j, size_t k) {
+                return get_impl(grid_offset(i, j, k), std::make_index_sequence<N>{});
+            };
+            value = interpolate_grid(values, {{pos_x, pos_y, pos_z}}, dimensions_, quadrant, quadrant);
+        } else {
+            const auto& grid_block = blocks_[block - 1u];
+            const auto* block_values = grid_block.values.get();
+            const auto& block_dimensions = grid_block.dimensions;
+            auto values = [&](size_t i, size_t j, size_t k) {
+                return get_block_impl(block_values,
+                                      i * block_dimensions[1] * block_dimensions[2] * N + j * block_dimensions[2] * N +
+                                          k * N,
+                                      std::make_index_sequence<N>{});
+            };
+            std::array<double, 3> block_pos{{(pos_x - static_cast<double>(grid_block.begin[0])) * grid_block.factors[0],
+                                             (pos_y - static_cast<double>(grid_block.begin[1])) * grid_block.factors[1],
+                                             (pos_z - static_cast<double>(grid_block.begin[2])) * grid_block.factors[2]}};
+            value = interpolate_grid(values,
+                                     block_pos,
+                                     block_dimensions,
+                                     quadrant && grid_block.begin[0] == 0,
+                                     quadrant && grid_block.begin[1] == 0);
+        }
 
-        return get_impl(tot_ind, std::make_index_sequence<N>{});
+        if(symmetry_ == FieldSymmetry::QUADRANT) {
+            mirror_vector_components(value, sign_x, sign_y);
+        }
+        return value;
     }
 
     /**
-     * The field is replicated for all pixels and uses flipping at each boundary (edge effects are currently not modeled.
-     * Outside of the sensor the field is strictly zero by definition.
+     * Positions outside of the grid are assigned to the outermost grid points. Grids mirrored at their lower edge use the
+     * mirror image of the first grid point as lower neighbor below it, inverting the respective vector components.
      */
-    template <typename T, size_t N> T DetectorField<T, N>::get(const ROOT::Math::XYZPoint& pos) const {
-        // FIXME: We need to revisit this to be faster and not too specific
-        if(type_ == FieldType::NONE) {
-            return {};
+    template <typename T, size_t N>
+    template <typename F>
+    T DetectorField<T, N>::interpolate_grid(F&& value,
+                                            const std::array<double, 3>& pos,
+                                            const std::array<size_t, 3>& dimensions,
+                                            bool mirror_x,
+                                            bool mirror_y) const {
+        if(interpolation_ == FieldInterpolation::NEAREST) {
+            auto nearest = [](double position, size_t size) {
+                auto index = std::clamp(static_cast<int>(std::floor(position)), 0, static_cast<int>(size) - 1);
+                return static_cast<size_t>(index);
+            };
+            return value(nearest(pos[0], dimensions[0]), nearest(pos[1], dimensions[1]), nearest(pos[2], dimensions[2]));
+        }
+
+        // Find the two surrounding grid points along an axis and the fractional distance from the lower one. The grid
+        // points are located at the bin centers, the field is taken constant between the outermost grid points and the
+        // edges.
+        auto neighbors = [](double position, size_t size) {
+            auto lower = std::floor(position - 0.5);
+            auto max_index = static_cast<int>(size) - 1;
+            return std::make_tuple(static_cast<size_t>(std::clamp(static_cast<int>(lower), 0, max_index)),
+                                   static_cast<size_t>(std::clamp(static_cast<int>(lower) + 1, 0, max_index)),
+                                   position - 0.5 - lower);
+        };
+        auto [x_low, x_high, x_frac] = neighbors(pos[0], dimensions[0]);
+        auto [y_low, y_high, y_frac] = neighbors(pos[1], dimensions[1]);
+        auto [z_low, z_high, z_frac] = neighbors(pos[2], dimensions[2]);
+
+        // Below the first grid point of mirrored grids, the lower neighbor is the mirror image of the first grid point
+        mirror_x = mirror_x && pos[0] < 0.5;
+        mirror_y = mirror_y && pos[1] < 0.5;
+
+        // Interpolate between the eight surrounding grid points
+        T result{};
+        for(int corner = 0; corner < 8; ++corner) {
+            auto x_upper = (corner & 1) != 0;
+            auto y_upper = (corner & 2) != 0;
+            auto z_upper = (corner & 4) != 0;
+            auto weight =
+                (x_upper ? x_frac : 1 - x_frac) * (y_upper ? y_frac : 1 - y_frac) * (z_upper ? z_frac : 1 - z_frac);
+            if(weight == 0) {
+                continue;
+            }
+            T corner_value = value(x_upper ? x_high : x_low, y_upper ? y_high : y_low, z_upper ? z_high : z_low);
+            auto corner_mirror_x = (mirror_x && !x_upper);
+            auto corner_mirror_y = (mirror_y && !y_upper);
+            if(corner_mirror_x || corner_mirror_y) {
+                mirror_vector_components(corner_value, corner_mirror_x ? -1. : 1., corner_mirror_y ? -1. : 1.);
+            }
+            result += weight * corner_value;
         }
+        return result;
+    }
 
+    /**
+     * The replica is the copy of the field the position falls into, counted from the field at the local origin. The origin
+     * of the replica frame is at the center of the replica. Odd replicas are mirrored, which is done by multiplication with a
+     * sign as in getFast such that replicas with negative index are mirrored alike.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::to_replica_frame(double& x, double& y, double& sign_x, double& sign_y) const {
         // Shift the coordinates by the offset configured for the field:
-        auto x = pos.x() + offset_[0];
-        auto y = pos.y() + offset_[1];
-        auto z = pos.z();
+        x += offset_[0];
+        y += offset_[1];
 
         // Compute corresponding field replica coordinates:
         // WARNING This relies on the origin of the local coordinate system
@@ -109,14 +262,32 @@ namespace allpix {
         x -= (replica_x + 0.5) * scales_[0] - 0.5 * pixel_size_.x();
         y -= (replica_y + 0.5) * scales_[1] - 0.5 * pixel_size_.y();
 
-        // Do flipping if necessary
-        if((replica_x % 2) == 1) {
-            x *= -1;
-        }
-        if((replica_y % 2) == 1) {
-            y *= -1;
+        // Mirror odd replicas
+        sign_x = static_cast<double>(1 - 2 * (replica_x & 1));
+        sign_y = static_cast<double>(1 - 2 * (replica_y & 1));
+        x *= sign_x;
+        y *= sign_y;
+    }
+
+    /**
+     * The field is replicated for all pixels and uses flipping at each boundary (edge effects are currently not modeled.
+     * Outside of the sensor the field is strictly zero by definition.
+     */
+    template <typename T, size_t N> T DetectorField<T, N>::get(const ROOT::Math::XYZPoint& pos) const {
+        return get_value(pos.x(), pos.y(), pos.z());
+    }
+
+    template <typename T, size_t N> T DetectorField<T, N>::get_value(double x, double y, double z) const {
+        // FIXME: We need to revisit this to be faster and not too specific
+        load_grid();
+        if(type_ == FieldType::NONE) {
+            return {};
         }
 
+        // Compute the coordinates in the frame of the field replica
+        auto sign_x = 1., sign_y = 1.;
+        to_replica_frame(x, y, sign_x, sign_y);
+
         // Compute using the grid or a function depending on the setting
         T ret_val;
         if(type_ == FieldType::GRID) {
@@ -131,11 +302,176 @@ namespace allpix {
             ret_val = function_(ROOT::Math::XYZPoint(x, y, z));
         }
 
-        // Flip vector if necessary
-        flip_vector_components(ret_val, replica_x % 2, replica_y % 2);
+        // Mirror the vector components together with the position
+        mirror_vector_components(ret_val, sign_x, sign_y);
+        return ret_val;
+    }
+
+    /**
+     * The position is converted to the frame of the field replica and to grid bins once, as all time slices share the grid
+     * geometry, and the values of the two slices enclosing the time are interpolated linearly before mirroring.
+     */
+    template <typename T, size_t N>
+    T DetectorField<T, N>::get(const ROOT::Math::XYZPoint& pos, double time, FieldTimeBracket& bracket) const {
+        return get_value(pos.x(), pos.y(), pos.z(), time, bracket);
+    }
+
+    template <typename T, size_t N>
+    T DetectorField<T, N>::get_value(double x, double y, double z, double time, FieldTimeBracket& bracket) const {
+        load_grid();
+        if(time_slices_.empty()) {
+            return get_value(x, y, z);
+        }
+        if(!(time >= bracket.begin && time < bracket.end)) {
+            find_time_bracket(time, bracket);
+        }
+
+        // Compute the coordinates in the frame of the field replica and in units of grid bins
+        auto sign_x = 1., sign_y = 1.;
+        to_replica_frame(x, y, sign_x, sign_y);
+        auto bins_x = to_grid_bins(x, 0);
+        auto bins_y = to_grid_bins(y, 1);
+        auto bins_z = to_grid_bins_z(z);
+
+        // Interpolate between the time slices if the time is between two of them
+        const auto& lower = time_slice(bracket.lower);
+        auto ret_val = lower.get_field_from_bins(bins_x.first, bins_y.first, bins_z, bins_x.second, bins_y.second, false);
+        if(bracket.upper != bracket.lower) {
+            const auto& upper = time_slice(bracket.upper);
+            auto upper_val =
+                upper.get_field_from_bins(bins_x.first, bins_y.first, bins_z, bins_x.second, bins_y.second, false);
+            ret_val = ret_val + (upper_val - ret_val) * ((time - bracket.begin) * bracket.inverse_width);
+        }
+
+        // Mirror the vector components together with the position
+        mirror_vector_components(ret_val, sign_x, sign_y);
         return ret_val;
     }
 
+    /**
+     * For field grids the positions are processed in blocks, first converting all positions of a block to the replica frame
+     * in a loop the compiler can vectorize before looking up the field values. Other fields are evaluated point by point.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::get(const std::vector<ROOT::Math::XYZPoint>& pos, std::vector<T>& values) const {
+        load_grid();
+        values.resize(pos.size());
+        if(type_ != FieldType::GRID) {
+            for(size_t i = 0; i < pos.size(); ++i) {
+                values[i] = get(pos[i]);
+            }
+            return;
+        }
+
+        constexpr size_t block_size = 16;
+        std::array<double, block_size> x{}, y{};
+        std::array<double, block_size> sign_x{}, sign_y{};
+        for(size_t begin = 0; begin < pos.size(); begin += block_size) {
+            auto count = std::min(block_size, pos.size() - begin);
+
+            // Compute the coordinates in the frame of the field replica for all positions of the block
+            for(size_t i = 0; i < count; ++i) {
+                x[i] = pos[begin + i].x();
+                y[i] = pos[begin + i].y();
+                to_replica_frame(x[i], y[i], sign_x[i], sign_y[i]);
+            }
+
+            // Look up the field values and mirror them together with the positions
+            for(size_t i = 0; i < count; ++i) {
+                auto value = get_field_from_grid(ROOT::Math::XYZPoint(x[i], y[i], pos[begin + i].z()));
+                mirror_vector_components(value, sign_x[i], sign_y[i]);
+                values[begin + i] = value;
+            }
+        }
+    }
+
+    /**
+     * The replica index is computed with the reciprocal field scale and the mirroring of odd replicas is applied by
+     * multiplication with a sign, which is also correct for negative replica indices. For nearest-neighbor grids the bin
+     * indices are computed from the precomputed bin factors and clamped to the grid in x and y, as positions in the replica
+     * frame are always within the field scale apart from rounding.
+     */
+    template <typename T, size_t N> T DetectorField<T, N>::getFast(const ROOT::Math::XYZPoint& pos) const {
+        load_grid();
+        if(type_ == FieldType::NONE) {
+            return {};
+        }
+
+        // Compute the coordinates relative to the lower edge of the replica and the replica indices
+        auto x = pos.x() + replica_shift_[0];
+        auto y = pos.y() + replica_shift_[1];
+        auto replica_x = static_cast<int>(std::floor(x * inverse_scales_[0]));
+        auto replica_y = static_cast<int>(std::floor(y * inverse_scales_[1]));
+        x -= replica_x * scales_[0];
+        y -= replica_y * scales_[1];
+
+        // Mirror odd replicas, converting to the frame centered at the replica
+        auto sign_x = static_cast<double>(1 - 2 * (replica_x & 1));
+        auto sign_y = static_cast<double>(1 - 2 * (replica_y & 1));
+        x = sign_x * (x - 0.5 * scales_[0]);
+        y = sign_y * (y - 0.5 * scales_[1]);
+        auto z = pos.z();
+
+        // Mirror into the quadrant covered by symmetry-reduced grids
+        if(symmetry_ == FieldSymmetry::QUADRANT) {
+            auto quadrant_x = (x < 0 ? -1. : 1.);
+            auto quadrant_y = (y < 0 ? -1. : 1.);
+            x *= quadrant_x;
+            y *= quadrant_y;
+            sign_x *= quadrant_x;
+            sign_y *= quadrant_y;
+        }
+
+        T ret_val;
+        if(type_ == FieldType::GRID && interpolation_ == FieldInterpolation::NEAREST && blocks_.empty()) {
+            auto max_x = static_cast<int>(dimensions_[0]) - 1;
+            auto max_y = static_cast<int>(dimensions_[1]) - 1;
+            auto x_ind = std::clamp(static_cast<int>((x + grid_shift_[0]) * bin_factors_[0]), 0, max_x);
+            auto y_ind = std::clamp(static_cast<int>((y + grid_shift_[1]) * bin_factors_[1]), 0, max_y);
+            auto z_ind = static_cast<int>(std::floor((z - thickness_domain_.first) * bin_factors_[2]));
+            if(z_ind < 0 || z_ind >= static_cast<int>(dimensions_[2])) {
+                return {};
+            }
+
+            auto index =
+                grid_offset(static_cast<size_t>(x_ind), static_cast<size_t>(y_ind), static_cast<size_t>(z_ind));
+            ret_val = get_impl(index, std::make_index_sequence<N>{});
+        } else if(type_ == FieldType::GRID) {
+            ret_val = get_field_from_grid(ROOT::Math::XYZPoint(x, y, z));
+        } else {
+            // Check if inside the thickness domain
+            if(z < thickness_domain_.first || thickness_domain_.second < z) {
+                return {};
+            }
+
+            // Calculate the field from the configured function:
+            ret_val = function_(ROOT::Math::XYZPoint(x, y, z));
+        }
+
+        // Mirror the vector components together with the position
+        mirror_vector_components(ret_val, sign_x, sign_y);
+        return ret_val;
+    }
+
+    template <typename T, size_t N> bool DetectorField<T, N>::getGridView(FieldGridView& view) const {
+        load_grid();
+        if(type_ != FieldType::GRID || storage_ != FieldStorage::DOUBLE || symmetry_ != FieldSymmetry::NONE ||
+           layout_ != FieldLayout::FLAT || !blocks_.empty() || !time_slices_.empty() || field_ == nullptr) {
+            return false;
+        }
+
+        view.values = field_.get();
+        view.size = size_;
+        view.dimensions = dimensions_;
+        view.scales = scales_;
+        view.inverse_scales = inverse_scales_;
+        view.replica_shift = replica_shift_;
+        view.bin_factors = bin_factors_;
+        view.thickness_begin = thickness_domain_.first;
+        view.interpolation = interpolation_;
+        return true;
+    }
+
     /**
      * Woohoo, template magic! Using an index_sequence to construct the templated return type with a variable number of
      * elements from the flat field vector, e.g. 3 for a vector field and 1 for a scalar field. Using a braced-init-list
@@ -144,7 +480,42 @@ namespace allpix {
     template <typename T, size_t N>
     template <std::size_t... I>
     auto DetectorField<T, N>::get_impl(size_t offset, std::index_sequence<I...>) const {
-        return T{(*field_)[offset + I]...};
+        switch(storage_) {
+        case FieldStorage::FLOAT:
+            return T{static_cast<double>((*field_float_)[offset + I])...};
+        case FieldStorage::HALF:
+            return T{half_scale_ * static_cast<double>(half_to_float((*field_half_)[offset + I]))...};
+        default:
+            return T{(replicas_ ? node_values() : field_.get())[offset + I]...};
+        }
+    }
+
+    template <typename T, size_t N>
+    template <std::size_t... I>
+    T DetectorField<T, N>::get_block_impl(const double* values, size_t offset, std::index_sequence<I...>) {
+        return T{values[offset + I]...};
+    }
+
+    /**
+     * Threads on nodes without a copy, e.g. if the node could not be determined, use the original grid.
+     */
+    template <typename T, size_t N> const double* DetectorField<T, N>::node_values() const {
+        auto node = current_numa_node();
+        if(node >= replicas_->values.size()) {
+            return field_.get();
+        }
+        const auto* values = replicas_->values[node].load(std::memory_order_acquire);
+        if(values == nullptr) {
+            std::call_once(replicas_->flags[node], [&]() {
+                auto& grid = replicas_->grids[node];
+                grid = allocate_huge_pages(size_ * sizeof(double));
+                auto* copy = static_cast<double*>(grid.get());
+                std::copy_n(field_.get(), size_, copy);
+                replicas_->values[node].store(copy, std::memory_order_release);
+            });
+            values = replicas_->values[node].load(std::memory_order_acquire);
+        }
+        return values;
     }
 
     /**
@@ -152,19 +523,47 @@ namespace allpix {
      */
     template <typename T, size_t N> FieldType DetectorField<T, N>::getType() const { return type_; }
 
+    template <typename T, size_t N>
+    void DetectorField<T, N>::setGrid(std::shared_ptr<std::vector<double>> field, // NOLINT
+                                      std::array<size_t, 3> dimensions,
+                                      std::array<double, 2> scales,
+                                      std::array<double, 2> offset,
+                                      std::pair<double, double> thickness_domain,
+                                      FieldInterpolation interpolation,
+                                      FieldStorage storage,
+                                      FieldSymmetry symmetry,
+                                      FieldLayout layout) {
+        auto size = field->size();
+        setGrid(std::shared_ptr<const double>(field, field->data()),
+                size,
+                dimensions,
+                scales,
+                offset,
+                std::move(thickness_domain),
+                interpolation,
+                storage,
+                symmetry,
+                layout);
+    }
+
     /**
      * @throws std::invalid_argument If the field dimensions are incorrect or the thickness domain is outside the sensor
      */
     template <typename T, size_t N>
-    void DetectorField<T, N>::setGrid(std::shared_ptr<std::vector<double>> field, // NOLINT
+    void DetectorField<T, N>::setGrid(std::shared_ptr<const double> field, // NOLINT
+                                      size_t size,
                                       std::array<size_t, 3> dimensions,
                                       std::array<double, 2> scales,
                                       std::array<double, 2> offset,
-                                      std::pair<double, double> thickness_domain) {
+                                      std::pair<double, double> thickness_domain,
+                                      FieldInterpolation interpolation,
+                                      FieldStorage storage,
+                                      FieldSymmetry symmetry,
+                                      FieldLayout layout) {
         if(!model_initialized_) {
             throw std::invalid_argument("field not initialized with detector model parameters");
         }
-        if(dimensions[0] * dimensions[1] * dimensions[2] * N != field->size()) {
+        if(dimensions[0] * dimensions[1] * dimensions[2] * N != size) {
             throw std::invalid_argument("field does not match the given dimensions");
         }
         if(thickness_domain.first + 1e-9 < sensor_center_.z() - sensor_size_.z() / 2.0 ||
@@ -175,13 +574,193 @@ namespace allpix {
             throw std::invalid_argument("end of thickness domain is before begin");
         }
 
-        field_ = std::move(field);
+        // Reorder the field into bricks before converting it, padding the last brick along every axis with zeros
         dimensions_ = dimensions;
+        layout_ = layout;
+        if(layout == FieldLayout::BRICKED) {
+            for(size_t i = 0; i < 3; ++i) {
+                bricks_[i] = (dimensions[i] + brick_size - 1) / brick_size;
+            }
+            auto bricked_size = bricks_[0] * bricks_[1] * bricks_[2] * brick_size * brick_size * brick_size * N;
+            double unused_scale = 1.;
+            auto bricked = get_shared_grid<double>(field, size, unused_scale, [&]() {
+                auto values = std::make_shared<std::vector<double>>(bricked_size, 0.);
+                for(size_t x = 0; x < dimensions[0]; ++x) {
+                    for(size_t y = 0; y < dimensions[1]; ++y) {
+                        for(size_t z = 0; z < dimensions[2]; ++z) {
+                            auto source = ((x * dimensions[1] + y) * dimensions[2] + z) * N;
+                            std::copy_n(field.get() + source, N, values->data() + grid_offset(x, y, z));
+                        }
+                    }
+                }
+                return std::make_pair(values, 1.);
+            });
+            field = std::shared_ptr<const double>(bricked, bricked->data());
+            size = bricked_size;
+        }
+
+        // Convert the field to the requested precision, only keeping the field in the precision used
+        field_.reset();
+        field_float_.reset();
+        field_half_.reset();
+        replicas_.reset();
+        blocks_.clear();
+        block_index_.clear();
+        slice_times_.clear();
+        time_slices_.clear();
+        if(storage == FieldStorage::FLOAT) {
+            double scale = 1.;
+            field_float_ = get_shared_grid<float>(field, size, scale, [&]() {
+                return std::make_pair(std::make_shared<std::vector<float>>(field.get(), field.get() + size), 1.);
+            });
+        } else if(storage == FieldStorage::HALF) {
+            field_half_ = get_shared_grid<uint16_t>(field, size, half_scale_, [&]() {
+                double max_value = 0;
+                for(size_t i = 0; i < size; ++i) {
+                    max_value = std::max(max_value, std::fabs(field.get()[i]));
+                }
+                auto scale = (max_value > 0 ? max_value : 1.);
+
+                auto half = std::make_shared<std::vector<uint16_t>>(size);
+                for(size_t i = 0; i < size; ++i) {
+                    (*half)[i] = float_to_half(static_cast<float>(field.get()[i] / scale));
+                }
+                return std::make_pair(half, scale);
+            });
+        } else {
+            // Back the grid with huge pages if enabled, advising the memory of the source in place for transparent pages
+            auto pages = huge_pages();
+            if(pages == HugePages::EXPLICIT_2MB || pages == HugePages::EXPLICIT_1GB) {
+                field = get_huge_page_grid(field, size);
+            } else if(pages == HugePages::TRANSPARENT) {
+                advise_huge_pages(field.get(), size * sizeof(double));
+            }
+            field_ = std::move(field);
+            if(numa_replication()) {
+                replicas_ = std::make_shared<NodeReplicas>(numa_node_count());
+            }
+        }
+        size_ = size;
+        storage_ = storage;
+
         scales_ = scales;
         offset_ = offset;
+        interpolation_ = interpolation;
+        symmetry_ = symmetry;
 
         thickness_domain_ = std::move(thickness_domain);
         type_ = FieldType::GRID;
+        update_replica_transform();
+    }
+
+    /**
+     * @throws std::invalid_argument If the field is not a grid, the block is outside the grid or overlaps another block, or
+     * the dimensions of the refined field are incorrect
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::addGridRefinement(std::shared_ptr<const double> field, // NOLINT
+                                                size_t size,
+                                                std::array<size_t, 3> dimensions,
+                                                std::array<size_t, 3> begin,
+                                                std::array<size_t, 3> cells) {
+        if(type_ != FieldType::GRID || (field_ == nullptr && field_float_ == nullptr && field_half_ == nullptr)) {
+            throw std::invalid_argument("refinement requires a field grid");
+        }
+        if(!time_slices_.empty()) {
+            throw std::invalid_argument("refinement of time-dependent field grids is not supported");
+        }
+        if(dimensions[0] * dimensions[1] * dimensions[2] * N != size) {
+            throw std::invalid_argument("refined field does not match the given dimensions");
+        }
+        GridBlock block{std::move(field), dimensions, begin, {}};
+        for(size_t i = 0; i < 3; ++i) {
+            if(cells[i] == 0 || begin[i] + cells[i] > dimensions_[i]) {
+                throw std::invalid_argument("refined block is outside the field grid");
+            }
+            if(dimensions[i] % cells[i] != 0) {
+                throw std::invalid_argument("refined field dimensions are not a multiple of the cells covered");
+            }
+            block.factors[i] = static_cast<double>(dimensions[i] / cells[i]);
+        }
+        if(blocks_.size() >= std::numeric_limits<uint16_t>::max()) {
+            throw std::invalid_argument("too many refined blocks");
+        }
+
+        // Register the block in the index of all cells it covers
+        if(block_index_.empty()) {
+            block_index_.resize(dimensions_[0] * dimensions_[1] * dimensions_[2], 0);
+        }
+        std::vector<size_t> block_cells;
+        for(size_t i = begin[0]; i < begin[0] + cells[0]; ++i) {
+            for(size_t j = begin[1]; j < begin[1] + cells[1]; ++j) {
+                for(size_t k = begin[2]; k < begin[2] + cells[2]; ++k) {
+                    auto cell = (i * dimensions_[1] + j) * dimensions_[2] + k;
+                    if(block_index_[cell] != 0) {
+                        throw std::invalid_argument("refined block overlaps with another refined block");
+                    }
+                    block_cells.push_back(cell);
+                }
+            }
+        }
+        blocks_.push_back(std::move(block));
+        for(auto cell : block_cells) {
+            block_index_[cell] = static_cast<uint16_t>(blocks_.size());
+        }
+    }
+
+    /**
+     * @throws std::invalid_argument If the field is not a grid or has refined blocks, the time is not later than the time of
+     * the previous slice, or the dimensions of the slice are incorrect
+     *
+     * The slice is stored as a field of its own, converting it to the storage precision of the grid.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::addTimeSlice(double time, std::shared_ptr<const double> field, size_t size) { // NOLINT
+        if(type_ != FieldType::GRID || (field_ == nullptr && field_float_ == nullptr && field_half_ == nullptr)) {
+            throw std::invalid_argument("time slices require a field grid");
+        }
+        if(!blocks_.empty()) {
+            throw std::invalid_argument("time slices of refined field grids are not supported");
+        }
+        if(time <= (slice_times_.empty() ? 0. : slice_times_.back())) {
+            throw std::invalid_argument("time slices have to be added in increasing order of time after time zero");
+        }
+
+        auto slice = std::make_shared<DetectorField<T, N>>();
+        slice->set_model_parameters(sensor_center_, sensor_size_, pixel_size_);
+        slice->setGrid(std::move(field),
+                       size,
+                       dimensions_,
+                       scales_,
+                       offset_,
+                       thickness_domain_,
+                       interpolation_,
+                       storage_,
+                       symmetry_,
+                       layout_);
+        slice_times_.push_back(time);
+        time_slices_.push_back(std::move(slice));
+    }
+
+    /**
+     * Before the first and after the last time slice the bracket covers an unbounded range of time with a single slice.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::find_time_bracket(double time, FieldTimeBracket& bracket) const {
+        constexpr auto infinity = std::numeric_limits<double>::infinity();
+        if(time < 0) {
+            bracket = {0, 0, -infinity, 0., 0.};
+        } else if(time >= slice_times_.back()) {
+            bracket = {slice_times_.size(), slice_times_.size(), slice_times_.back(), infinity, 0.};
+        } else {
+            // Index of the first slice after the time, the field itself at time zero is slice zero
+            auto upper = static_cast<size_t>(std::upper_bound(slice_times_.begin(), slice_times_.end(), time) -
+                                             slice_times_.begin()) +
+                         1;
+            auto begin = (upper == 1 ? 0. : slice_times_[upper - 2]);
+            auto end = slice_times_[upper - 1];
+            bracket = {upper - 1, upper, begin, end, 1. / (end - begin)};
+        }
     }
 
     template <typename T, size_t N>
@@ -190,5 +769,32 @@ namespace allpix {
         thickness_domain_ = std::move(thickness_domain);
         function_ = std::move(function);
         type_ = type;
+        update_replica_transform();
+    }
+
+    template <typename T, size_t N>
+    void DetectorField<T, N>::setGridLoader(std::function<void()> loader, std::pair<double, double> thickness_domain) {
+        loader_ = std::make_shared<GridLoader>();
+        loader_->load = std::move(loader);
+        thickness_domain_ = std::move(thickness_domain);
+        type_ = FieldType::GRID;
+    }
+
+    /**
+     * Fields with a single bin in x or y are assumed to be 2-dimensional, the bin factor is set to zero such that the index
+     * in this direction is always zero. Grids covering a quadrant of the field cell start at its center and span half of the
+     * field scale.
+     */
+    template <typename T, size_t N> void DetectorField<T, N>::update_replica_transform() {
+        for(size_t i = 0; i < 2; ++i) {
+            auto grid_size = (symmetry_ == FieldSymmetry::QUADRANT ? 0.5 * scales_[i] : scales_[i]);
+            inverse_scales_[i] = 1.0 / scales_[i];
+            bin_factors_[i] = (dimensions_[i] > 1 ? static_cast<double>(dimensions_[i]) / grid_size : 0.);
+            grid_shift_[i] = (symmetry_ == FieldSymmetry::QUADRANT ? 0. : 0.5 * scales_[i]);
+        }
+        replica_shift_ = {offset_[0] + 0.5 * pixel_size_.x(), offset_[1] + 0.5 * pixel_size_.y()};
+
+        auto thickness = thickness_domain_.second - thickness_domain_.first;
+        bin_factors_[2] = (thickness > 0 ? static_cast<double>(dimensions_[2]) / thickness : 0.);
     }
 } // namespace allpix
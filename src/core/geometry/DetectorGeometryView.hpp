@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief Flat description of the detector geometry for geometry queries in hot loops
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_DETECTOR_GEOMETRY_VIEW_H
+#define ALLPIX_DETECTOR_GEOMETRY_VIEW_H
+
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include <Math/DisplacementVector2D.h>
+#include <Math/Point3D.h>
+#include <Math/Vector2D.h>
+#include <Math/Vector3D.h>
+
+#include "objects/Pixel.hpp"
+
+namespace allpix {
+    /**
+     * @brief Immutable description of the geometry of a detector with all values derived from its model precomputed
+     *
+     * The view holds the sensor bounds, the pixel pitch with its inverse, the size of the pixel grid and the implant size
+     * by value, such that the geometry queries of propagation and transfer modules neither dereference the detector model
+     * nor recompute derived values. It is created by the \ref Detector when its model is set and is meant to be copied
+     * once into the modules when they are initialized. The queries are identical to the ones of the \ref Detector.
+     */
+    class DetectorGeometryView {
+    public:
+        /**
+         * @brief Construct an empty view of a detector without model
+         */
+        DetectorGeometryView() = default;
+
+        /**
+         * @brief Construct the view from the parameters of a detector model
+         * @param sensor_center Center of the sensor in the local frame
+         * @param sensor_size Size of the sensor
+         * @param pixel_size Size of a single pixel
+         * @param implant_size Size of the pixel implant
+         * @param number_of_pixels Number of pixels of the pixel grid
+         */
+        DetectorGeometryView(const ROOT::Math::XYZPoint& sensor_center,
+                             const ROOT::Math::XYZVector& sensor_size,
+                             const ROOT::Math::XYVector& pixel_size,
+                             const ROOT::Math::XYVector& implant_size,
+                             const ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<unsigned int>>& number_of_pixels)
+            : sensor_center_{{sensor_center.x(), sensor_center.y(), sensor_center.z()}},
+              sensor_half_size_{{sensor_size.x() / 2, sensor_size.y() / 2, sensor_size.z() / 2}},
+              pixel_size_{{pixel_size.x(), pixel_size.y()}},
+              pixel_half_size_{{pixel_size.x() / 2, pixel_size.y() / 2}},
+              inverse_pixel_size_{{1. / pixel_size.x(), 1. / pixel_size.y()}},
+              implant_half_size_{{std::fabs(implant_size.x() / 2), std::fabs(implant_size.y() / 2)}},
+              number_of_pixels_{{static_cast<int>(number_of_pixels.x()), static_cast<int>(number_of_pixels.y())}} {}
+
+        /**
+         * @brief Returns if a local position is within the sensitive device
+         * @param local_pos Position in the local frame, of any vector type with x(), y() and z() accessors
+         * @return True if a local position is within the sensor, false otherwise
+         */
+        template <typename Point> bool isWithinSensor(const Point& local_pos) const {
+            return (std::fabs(local_pos.z() - sensor_center_[2]) <= sensor_half_size_[2]) &&
+                   (std::fabs(local_pos.y() - sensor_center_[1]) <= sensor_half_size_[1]) &&
+                   (std::fabs(local_pos.x() - sensor_center_[0]) <= sensor_half_size_[0]);
+        }
+
+        /**
+         * @brief Returns if a local position is within the pixel implant region of the sensitive device
+         * @param local_pos Position in the local frame, of any vector type with x(), y() and z() accessors
+         * @return True if a local position is within the pixel implant, false otherwise
+         */
+        template <typename Point> bool isWithinImplant(const Point& local_pos) const {
+            auto x_mod_pixel = std::fmod(local_pos.x() + pixel_half_size_[0], pixel_size_[0]) - pixel_half_size_[0];
+            auto y_mod_pixel = std::fmod(local_pos.y() + pixel_half_size_[1], pixel_size_[1]) - pixel_half_size_[1];
+            return std::fabs(x_mod_pixel) <= implant_half_size_[0] && std::fabs(y_mod_pixel) <= implant_half_size_[1];
+        }
+
+        /**
+         * @brief Returns if a set of pixel coordinates is within the grid of pixels defined for the device
+         * @return True if pixel coordinates are within the pixel grid, false otherwise
+         */
+        bool isWithinPixelGrid(const int x, const int y) const {
+            return !(x < 0 || x >= number_of_pixels_[0] || y < 0 || y >= number_of_pixels_[1]);
+        }
+
+        /**
+         * @brief Returns if a pixel index is within the grid of pixels defined for the device
+         * @return True if pixel_index is within the pixel grid, false otherwise
+         */
+        bool isWithinPixelGrid(const Pixel::Index& pixel_index) const {
+            return !(pixel_index.x() >= static_cast<unsigned int>(number_of_pixels_[0]) ||
+                     pixel_index.y() >= static_cast<unsigned int>(number_of_pixels_[1]));
+        }
+
+        /**
+         * @brief Return the coordinates of the pixel closest to a local position
+         * @param local_pos Position in the local frame, of any vector type with x(), y() and z() accessors
+         * @return Pixel coordinates in x and y, which can be outside the pixel grid
+         */
+        template <typename Point> std::pair<int, int> getPixel(const Point& local_pos) const {
+            // WARNING This relies on the origin of the local coordinate system
+            return {static_cast<int>(std::round(local_pos.x() * inverse_pixel_size_[0])),
+                    static_cast<int>(std::round(local_pos.y() * inverse_pixel_size_[1]))};
+        }
+
+        /**
+         * @brief Return the local position of the center of a pixel at the lower surface of the sensor
+         * @param x x-coordinate of the pixel
+         * @param y y-coordinate of the pixel
+         * @return Position of the pixel center in the local frame
+         */
+        ROOT::Math::XYZPoint getPixelCenter(int x, int y) const {
+            return {pixel_size_[0] * x, pixel_size_[1] * y, sensor_center_[2] - sensor_half_size_[2]};
+        }
+
+        /**
+         * @brief Get the position of the upper surface of the sensor in the local frame
+         * @return Position of the upper sensor surface in z
+         */
+        double getSensorTop() const { return sensor_center_[2] + sensor_half_size_[2]; }
+
+        /**
+         * @brief Get the size of a single pixel
+         * @return Size of a pixel in x and y
+         */
+        const std::array<double, 2>& getPixelSize() const { return pixel_size_; }
+
+        /**
+         * @brief Get the inverse of the size of a single pixel
+         * @return Inverse size of a pixel in x and y
+         */
+        const std::array<double, 2>& getInversePixelSize() const { return inverse_pixel_size_; }
+
+        /**
+         * @brief Get the number of pixels of the pixel grid
+         * @return Number of pixels in x and y
+         */
+        const std::array<int, 2>& getNPixels() const { return number_of_pixels_; }
+
+    private:
+        std::array<double, 3> sensor_center_{};
+        std::array<double, 3> sensor_half_size_{};
+        std::array<double, 2> pixel_size_{};
+        std::array<double, 2> pixel_half_size_{};
+        std::array<double, 2> inverse_pixel_size_{};
+        std::array<double, 2> implant_half_size_{};
+        std::array<int, 2> number_of_pixels_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DETECTOR_GEOMETRY_VIEW_H */
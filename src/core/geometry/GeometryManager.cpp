@@ -8,7 +8,11 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <algorithm>
+#include <array>
 #include <fstream>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -35,6 +39,47 @@
 using namespace allpix;
 using namespace ROOT::Math;
 
+namespace {
+    /**
+     * @brief Intersect a ray with an axis-aligned box
+     * @param min Lower corner of the box
+     * @param max Upper corner of the box
+     * @param origin Origin of the ray
+     * @param direction Direction of the ray
+     * @param entry Distance along the ray at which it enters the box, in units of the length of the direction
+     * @return True if the ray crosses the box
+     */
+    bool intersect_box(const std::array<double, 3>& min,
+                       const std::array<double, 3>& max,
+                       const std::array<double, 3>& origin,
+                       const std::array<double, 3>& direction,
+                       double& entry) {
+        double near = 0;
+        double far = std::numeric_limits<double>::infinity();
+        for(size_t i = 0; i < 3; ++i) {
+            if(direction[i] == 0) {
+                // Rays parallel to the slab only cross it if their origin is inside
+                if(origin[i] < min[i] || origin[i] > max[i]) {
+                    return false;
+                }
+                continue;
+            }
+            auto t_min = (min[i] - origin[i]) / direction[i];
+            auto t_max = (max[i] - origin[i]) / direction[i];
+            if(t_min > t_max) {
+                std::swap(t_min, t_max);
+            }
+            near = std::max(near, t_min);
+            far = std::min(far, t_max);
+            if(near > far) {
+                return false;
+            }
+        }
+        entry = near;
+        return true;
+    }
+} // namespace
+
 GeometryManager::GeometryManager() : closed_{false} {}
 
 /**
@@ -78,6 +123,25 @@ void GeometryManager::load(ConfigManager* conf_manager, std::mt19937_64& seeder)
             std::shared_ptr<Detector>(new Detector(geometry_section.getName(), orientation.first, orientation.second));
         addDetector(detector);
 
+        // Restrict the simulation to a region of interest of the pixel matrix if requested
+        if(geometry_section.has("region_of_interest")) {
+            std::vector<std::array<unsigned int, 4>> regions;
+            for(auto& region : geometry_section.getMatrix<unsigned int>("region_of_interest")) {
+                if(region.size() != 4) {
+                    throw InvalidValueError(geometry_section,
+                                            "region_of_interest",
+                                            "every region has to be given as the minimum and maximum pixel in x and y");
+                }
+                if(region[0] > region[2] || region[1] > region[3]) {
+                    throw InvalidValueError(
+                        geometry_section, "region_of_interest", "minimum pixel of a region cannot exceed its maximum");
+                }
+                regions.push_back({region[0], region[1], region[2], region[3]});
+            }
+            LOG(DEBUG) << "Region of interest of " << regions.size() << " rectangles of pixels";
+            detector->set_regions_of_interest(std::move(regions));
+        }
+
         // Add a link to the detector to add the model later
         nonresolved_models_[geometry_section.get<std::string>("type")].emplace_back(geometry_section, detector.get());
     }
@@ -341,6 +405,98 @@ std::shared_ptr<Detector> GeometryManager::getDetector(const std::string& name)
     throw allpix::InvalidDetectorError(name);
 }
 
+std::shared_ptr<Detector> GeometryManager::findDetector(const ROOT::Math::XYZPoint& position) {
+    if(!closed_) {
+        close_geometry();
+    }
+
+    // Descend into all nodes whose box contains the point, checking the sensors of the detectors at the leaves
+    std::array<double, 3> point{{position.x(), position.y(), position.z()}};
+    std::vector<size_t> stack;
+    if(!detector_tree_.empty()) {
+        stack.push_back(0);
+    }
+    while(!stack.empty()) {
+        const auto& node = detector_tree_[stack.back()];
+        auto index = stack.back();
+        stack.pop_back();
+
+        bool inside = true;
+        for(size_t i = 0; i < 3; ++i) {
+            inside = inside && point[i] >= node.min[i] && point[i] <= node.max[i];
+        }
+        if(!inside) {
+            continue;
+        }
+
+        if(node.second_child == 0) {
+            const auto& detector = detectors_[node.detector];
+            if(detector->isWithinSensor(detector->getLocalPosition(position))) {
+                return detector;
+            }
+        } else {
+            stack.push_back(node.second_child);
+            stack.push_back(index + 1);
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::shared_ptr<Detector>> GeometryManager::intersect(const ROOT::Math::XYZPoint& origin,
+                                                                  const ROOT::Math::XYZVector& direction) {
+    if(!closed_) {
+        close_geometry();
+    }
+
+    // Descend into all nodes whose box is crossed by the ray, crossing the sensors in local coordinates at the leaves
+    std::array<double, 3> global_origin{{origin.x(), origin.y(), origin.z()}};
+    std::array<double, 3> global_direction{{direction.x(), direction.y(), direction.z()}};
+    std::vector<std::pair<double, size_t>> crossed;
+    std::vector<size_t> stack;
+    if(!detector_tree_.empty()) {
+        stack.push_back(0);
+    }
+    while(!stack.empty()) {
+        const auto& node = detector_tree_[stack.back()];
+        auto index = stack.back();
+        stack.pop_back();
+
+        double entry = 0;
+        if(!intersect_box(node.min, node.max, global_origin, global_direction, entry)) {
+            continue;
+        }
+
+        if(node.second_child == 0) {
+            const auto& detector = detectors_[node.detector];
+            auto model = detector->getModel();
+            auto local_origin = detector->getLocalPosition(origin);
+            auto local_direction = detector->getLocalPosition(origin + direction) - local_origin;
+            auto center = model->getSensorCenter();
+            auto size = model->getSensorSize();
+            std::array<double, 3> min{{center.x() - size.x() / 2, center.y() - size.y() / 2, center.z() - size.z() / 2}};
+            std::array<double, 3> max{{center.x() + size.x() / 2, center.y() + size.y() / 2, center.z() + size.z() / 2}};
+            if(intersect_box(min,
+                             max,
+                             {{local_origin.x(), local_origin.y(), local_origin.z()}},
+                             {{local_direction.x(), local_direction.y(), local_direction.z()}},
+                             entry)) {
+                crossed.emplace_back(entry, node.detector);
+            }
+        } else {
+            stack.push_back(node.second_child);
+            stack.push_back(index + 1);
+        }
+    }
+
+    std::sort(crossed.begin(), crossed.end());
+    std::vector<std::shared_ptr<Detector>> detectors;
+    detectors.reserve(crossed.size());
+    for(auto& entry_detector : crossed) {
+        detectors.push_back(detectors_[entry_detector.second]);
+    }
+    return detectors;
+}
+
 /**
  * @throws InvalidDetectorError If not a single detector with this type exists
  */
@@ -372,9 +528,9 @@ void GeometryManager::load_models() {
     // Get paths to read models from
     std::vector<std::string> paths = getModelsPath();
 
-    std::vector<std::pair<std::string, ConfigReader>> readers;
-    LOG(TRACE) << "Reading model files";
-    // Add all the paths to the reader
+    // Collect the model files in order of precedence, without reading them yet
+    std::vector<std::pair<std::string, std::string>> model_files;
+    LOG(TRACE) << "Searching model files";
     for(auto& path : paths) {
         // Check if file or directory
         if(allpix::path_is_directory(path)) {
@@ -387,43 +543,35 @@ void GeometryManager::load_models() {
                 if(name_ext.second != suffix) {
                     continue;
                 }
-
-                // Add the sub directory path to the reader
-                LOG(TRACE) << "Reading model " << sub_path;
-                std::ifstream file(sub_path);
-
-                ConfigReader reader(file, sub_path);
-                readers.emplace_back(name_ext.first, reader);
+                model_files.emplace_back(name_ext.first, sub_path);
             }
         } else {
             // Always a file because paths are already checked
-            LOG(TRACE) << "Reading model " << path;
-            std::ifstream file(path);
-
-            ConfigReader reader(file, path);
             auto name_ext = allpix::get_file_name_extension(path);
-            readers.emplace_back(name_ext.first, reader);
+            model_files.emplace_back(name_ext.first, path);
         }
     }
 
-    // Loop through all configurations and parse them
+    // Only read and parse the files of the required models, since the model directories contain many more models
     LOG(TRACE) << "Parsing models";
-    for(auto& name_reader : readers) {
-        if(hasModel(name_reader.first)) {
+    for(auto& name_file : model_files) {
+        if(hasModel(name_file.first)) {
             // Skip models that we already loaded earlier higher in the chain
-            LOG(DEBUG) << "Skipping overwritten model " + name_reader.first << " in path "
-                       << name_reader.second.getHeaderConfiguration().getFilePath();
+            LOG(DEBUG) << "Skipping overwritten model " + name_file.first << " in path " << name_file.second;
             continue;
         }
-        if(!needsModel(name_reader.first)) {
+        if(!needsModel(name_file.first)) {
             // Also skip models that are not needed
-            LOG(TRACE) << "Skipping not required model " + name_reader.first << " in path "
-                       << name_reader.second.getHeaderConfiguration().getFilePath();
+            LOG(TRACE) << "Skipping not required model " + name_file.first << " in path " << name_file.second;
             continue;
         }
 
+        LOG(TRACE) << "Reading model " << name_file.second;
+        std::ifstream file(name_file.second);
+        ConfigReader reader(file, name_file.second);
+
         // Parse configuration and add model to the config
-        addModel(parse_config(name_reader.first, name_reader.second));
+        addModel(parse_config(name_file.first, reader));
     }
 }
 
@@ -454,6 +602,11 @@ std::shared_ptr<DetectorModel> GeometryManager::parse_config(const std::string&
  * specialized in the detector config a copy of the model is created with those specialized settings.
  */
 void GeometryManager::close_geometry() {
+    // Modules may look up detectors from several threads before the geometry is closed, only the first one closes it
+    std::lock_guard<std::mutex> lock(close_mutex_);
+    if(closed_) {
+        return;
+    }
     LOG(TRACE) << "Starting geometry closing procedure";
 
     // Load all standard models
@@ -498,9 +651,87 @@ void GeometryManager::close_geometry() {
         }
     }
 
+    build_detector_tree();
+
     closed_ = true;
     LOG(TRACE) << "Closed geometry";
 }
+
+/**
+ * The global bounding box of every sensor covers the eight corners of the sensor. The detectors are split recursively at the
+ * median of the centers of their boxes along the axis with the largest extent, such that the depth of the hierarchy grows
+ * logarithmically with the number of detectors.
+ */
+void GeometryManager::build_detector_tree() {
+    detector_tree_.clear();
+    if(detectors_.empty()) {
+        return;
+    }
+
+    // Global bounding boxes of all sensors
+    std::vector<DetectorNode> boxes;
+    for(size_t n = 0; n < detectors_.size(); ++n) {
+        const auto& detector = detectors_[n];
+        auto model = detector->getModel();
+        DetectorNode box{};
+        box.min.fill(std::numeric_limits<double>::infinity());
+        box.max.fill(-std::numeric_limits<double>::infinity());
+        box.detector = n;
+        for(size_t i = 0; i < 8; ++i) {
+            auto point = model->getSensorCenter();
+            point.SetX(point.x() + ((i & 1u) != 0 ? 1 : -1) * model->getSensorSize().x() / 2.0);
+            point.SetY(point.y() + ((i & 2u) != 0 ? 1 : -1) * model->getSensorSize().y() / 2.0);
+            point.SetZ(point.z() + ((i & 4u) != 0 ? 1 : -1) * model->getSensorSize().z() / 2.0);
+            point = detector->getGlobalPosition(point);
+            std::array<double, 3> corner{{point.x(), point.y(), point.z()}};
+            for(size_t j = 0; j < 3; ++j) {
+                box.min[j] = std::min(box.min[j], corner[j]);
+                box.max[j] = std::max(box.max[j], corner[j]);
+            }
+        }
+        boxes.push_back(box);
+    }
+
+    // Build the nodes in depth-first order, such that the first child of every inner node directly follows it
+    std::function<void(size_t, size_t)> build = [&](size_t begin, size_t end) {
+        auto index = detector_tree_.size();
+        detector_tree_.push_back(boxes[begin]);
+        detector_tree_[index].second_child = 0;
+        for(size_t n = begin + 1; n < end; ++n) {
+            for(size_t i = 0; i < 3; ++i) {
+                detector_tree_[index].min[i] = std::min(detector_tree_[index].min[i], boxes[n].min[i]);
+                detector_tree_[index].max[i] = std::max(detector_tree_[index].max[i], boxes[n].max[i]);
+            }
+        }
+        if(end - begin == 1) {
+            return;
+        }
+
+        // Split at the median along the largest extent of the node
+        size_t axis = 0;
+        for(size_t i = 1; i < 3; ++i) {
+            if(detector_tree_[index].max[i] - detector_tree_[index].min[i] >
+               detector_tree_[index].max[axis] - detector_tree_[index].min[axis]) {
+                axis = i;
+            }
+        }
+        auto middle = begin + (end - begin) / 2;
+        std::nth_element(boxes.begin() + static_cast<std::ptrdiff_t>(begin),
+                         boxes.begin() + static_cast<std::ptrdiff_t>(middle),
+                         boxes.begin() + static_cast<std::ptrdiff_t>(end),
+                         [axis](const DetectorNode& a, const DetectorNode& b) {
+                             return a.min[axis] + a.max[axis] < b.min[axis] + b.max[axis];
+                         });
+
+        build(begin, middle);
+        auto second_child = detector_tree_.size();
+        build(middle, end);
+        detector_tree_[index].second_child = second_child;
+    };
+    build(0, boxes.size());
+    LOG(TRACE) << "Built bounding volume hierarchy with " << detector_tree_.size() << " nodes over the sensors of "
+               << detectors_.size() << " detectors";
+}
 /*
  * Calculates the position and orientation of the object from the provided configuration file
  */
@@ -10,7 +10,10 @@
 #ifndef ALLPIX_GEOMETRY_MANAGER_H
 #define ALLPIX_GEOMETRY_MANAGER_H
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <set>
 #include <string>
@@ -32,6 +35,7 @@ namespace allpix {
         NONE = 0, ///< No magnetic field is simulated
         CONSTANT, ///< Constant magnetic field (mostly for testing)
         CUSTOM,   ///< Custom magnetic field function
+        GRID,     ///< Magnetic field interpolated from a grid
     };
 
     using MagneticFieldFunction = std::function<ROOT::Math::XYZVector(const ROOT::Math::XYZPoint&)>;
@@ -189,6 +193,30 @@ namespace allpix {
          */
         std::vector<std::shared_ptr<Detector>> getDetectorsByType(const std::string& type);
 
+        /**
+         * @brief Find the detector whose sensor contains a point
+         * @param position Point in global coordinates
+         * @return Detector containing the point in its sensor, or a null pointer if the point is outside all sensors
+         * @note Closes the geometry if it has not been closed yet
+         *
+         * The detectors are looked up in a bounding volume hierarchy over their sensors, built when the geometry is closed.
+         * If sensors overlap, any of the detectors containing the point is returned.
+         */
+        std::shared_ptr<Detector> findDetector(const ROOT::Math::XYZPoint& position);
+
+        /**
+         * @brief Find all detectors whose sensor is crossed by a ray
+         * @param origin Origin of the ray in global coordinates
+         * @param direction Direction of the ray in global coordinates
+         * @return Detectors crossed by the ray, sorted by the distance from the origin at which the ray enters their sensor
+         * @note Closes the geometry if it has not been closed yet
+         *
+         * Only the part of the line starting at the origin in the given direction is considered. Sensors containing the
+         * origin are crossed at a distance of zero.
+         */
+        std::vector<std::shared_ptr<Detector>> intersect(const ROOT::Math::XYZPoint& origin,
+                                                         const ROOT::Math::XYZVector& direction);
+
         /**
          * @brief Set the magnetic field in the volume
          * @param function Function used to retrieve the magnetic field
@@ -244,6 +272,8 @@ namespace allpix {
     private:
         /**
          * @brief Load all standard framework models (automatically done when the geometry is closed)
+         *
+         * Only the model files of models required by a detector and not yet added are read and parsed.
          */
         void load_models();
 
@@ -264,9 +294,28 @@ namespace allpix {
 
         /**
          * @brief Close the geometry after which changes to the detector geometry cannot be made anymore
+         * @note Can be called from several threads at the same time, the geometry is only closed once
          */
         void close_geometry();
         std::atomic_bool closed_;
+        std::mutex close_mutex_;
+
+        /**
+         * @brief Build the bounding volume hierarchy over the sensors of all detectors
+         */
+        void build_detector_tree();
+
+        /*
+         * Node of the bounding volume hierarchy, with the axis-aligned box covering the sensors of all detectors below it.
+         * Inner nodes refer to their two children, of which the first directly follows the node, and leaves to a detector.
+         */
+        struct DetectorNode {
+            std::array<double, 3> min;
+            std::array<double, 3> max;
+            size_t second_child;
+            size_t detector;
+        };
+        std::vector<DetectorNode> detector_tree_;
 
         std::mt19937_64 random_generator_;
 
@@ -34,3 +34,22 @@ std::shared_ptr<const Detector> BaseMessage::getDetector() const {
 std::vector<std::reference_wrapper<Object>> BaseMessage::getObjectArray() {
     throw MessageWithoutObjectException(typeid(*this));
 }
+
+/**
+ * @throws MessageWithoutObjectException If the message does not contain objects
+ *
+ * The default implementation appends the objects returned by \ref getObjectArray.
+ */
+void BaseMessage::appendObjects(std::vector<Object*>& objects) {
+    for(Object& object : getObjectArray()) {
+        objects.push_back(&object);
+    }
+}
+
+size_t BaseMessage::getMemoryUsage() const {
+    return sizeof(*this);
+}
+
+size_t BaseMessage::getObjectCount() const {
+    return 0;
+}
@@ -11,6 +11,7 @@
 #ifndef ALLPIX_MESSAGE_H
 #define ALLPIX_MESSAGE_H
 
+#include <mutex>
 #include <vector>
 
 #include "core/geometry/Detector.hpp"
@@ -53,6 +54,29 @@ namespace allpix {
          */
         virtual std::vector<std::reference_wrapper<Object>> getObjectArray();
 
+        /**
+         * @brief Append pointers to all objects stored in this message to a list if possible
+         * @param objects List to append the objects to, which is kept allocated by the caller
+         *
+         * Avoids creating a new list of object references for every message, as done by \ref getObjectArray.
+         */
+        virtual void appendObjects(std::vector<Object*>& objects);
+
+        /**
+         * @brief Get an estimate of the memory held by this message
+         * @return Number of bytes held by the message and its data
+         *
+         * The estimate only includes memory held directly by the message, memory allocated by the stored objects themselves
+         * such as the pulses of charges is not included.
+         */
+        virtual size_t getMemoryUsage() const;
+
+        /**
+         * @brief Get the number of objects stored in this message
+         * @return Number of objects, zero if the message does not store a list of objects
+         */
+        virtual size_t getObjectCount() const;
+
     protected:
         /**
          * @brief Construct a general message not linked to a detector
@@ -68,6 +92,36 @@ namespace allpix {
         std::shared_ptr<const Detector> detector_;
     };
 
+    /**
+     * @brief Pool of data vectors to recycle the memory of messages
+     *
+     * Messages return their data vector to the pool of their type when they are destroyed at the end of an event. The
+     * objects are destroyed but the allocated capacity is kept, such that modules acquiring a vector from the pool to fill
+     * the message of a later event do not need to reallocate it. The pool holds a limited number of vectors only.
+     */
+    template <typename T> class MessageDataPool {
+    public:
+        /**
+         * @brief Acquire an empty data vector, reusing the memory of a released vector if available
+         * @return Empty data vector
+         */
+        static std::vector<T> acquire();
+
+        /**
+         * @brief Release a data vector to the pool
+         * @param data Data vector to release, its objects are destroyed
+         */
+        static void release(std::vector<T>&& data);
+
+    private:
+        static constexpr size_t max_buffers_ = 64;
+
+        static MessageDataPool& instance();
+
+        std::mutex mutex_;
+        std::vector<std::vector<T>> buffers_;
+    };
+
     /**
      * @brief Generic class for all messages
      *
@@ -87,6 +141,22 @@ namespace allpix {
          */
         Message(std::vector<T> data, const std::shared_ptr<const Detector>& detector);
 
+        /**
+         * @brief Return the memory of the data to the \ref MessageDataPool
+         */
+        ~Message() override;
+
+        ///@{
+        /**
+         * @brief Use default copy and move behaviour
+         */
+        Message(const Message&) = default;
+        Message& operator=(const Message&) = default;
+
+        Message(Message&&) noexcept = default;
+        Message& operator=(Message&&) noexcept = default;
+        ///@}
+
         /**
          * @brief Get a reference to the data in this message
          */
@@ -98,6 +168,24 @@ namespace allpix {
          */
         std::vector<std::reference_wrapper<Object>> getObjectArray() override;
 
+        /**
+         * @brief Append pointers to the data to a list of objects if the contents can be converted
+         * @param objects List to append the objects to (throws if not possible)
+         */
+        void appendObjects(std::vector<Object*>& objects) override;
+
+        /**
+         * @brief Get the memory held by the message and the allocated capacity of its data vector
+         * @return Number of bytes held by the message
+         */
+        size_t getMemoryUsage() const override;
+
+        /**
+         * @brief Get the number of objects stored in the data vector
+         * @return Number of objects
+         */
+        size_t getObjectCount() const override;
+
     private:
         /**
          * @brief Returns object array for messages containing objects
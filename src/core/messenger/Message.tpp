@@ -11,13 +11,54 @@
 #include "exceptions.h"
 
 namespace allpix {
+    /**
+     * The pool is deliberately never destroyed, as messages might still be released to it during static destruction
+     */
+    template <typename T> MessageDataPool<T>& MessageDataPool<T>::instance() {
+        static auto* pool = new MessageDataPool();
+        return *pool;
+    }
+
+    template <typename T> std::vector<T> MessageDataPool<T>::acquire() {
+        auto& pool = instance();
+        std::lock_guard<std::mutex> lock(pool.mutex_);
+        if(pool.buffers_.empty()) {
+            return std::vector<T>();
+        }
+        auto data = std::move(pool.buffers_.back());
+        pool.buffers_.pop_back();
+        return data;
+    }
+
+    /**
+     * The objects are destroyed before acquiring the lock. Vectors without allocated memory are not stored.
+     */
+    template <typename T> void MessageDataPool<T>::release(std::vector<T>&& data) {
+        data.clear();
+        if(data.capacity() == 0) {
+            return;
+        }
+
+        auto& pool = instance();
+        std::lock_guard<std::mutex> lock(pool.mutex_);
+        if(pool.buffers_.size() < max_buffers_) {
+            pool.buffers_.push_back(std::move(data));
+        }
+    }
+
     template <typename T> Message<T>::Message(std::vector<T> data) : BaseMessage(), data_(std::move(data)) {}
     template <typename T>
     Message<T>::Message(std::vector<T> data, const std::shared_ptr<const Detector>& detector)
         : BaseMessage(detector), data_(std::move(data)) {}
 
+    template <typename T> Message<T>::~Message() { MessageDataPool<T>::release(std::move(data_)); }
+
     template <typename T> const std::vector<T>& Message<T>::getData() const { return data_; }
 
+    template <typename T> size_t Message<T>::getMemoryUsage() const { return sizeof(*this) + data_.capacity() * sizeof(T); }
+
+    template <typename T> size_t Message<T>::getObjectCount() const { return data_.size(); }
+
     /**
      * Chooses between internal \ref get_object_array implementations dependent on the type of the object (if it drives from
      * \ref allpix::Object).
@@ -25,6 +66,20 @@ namespace allpix {
     template <typename T> std::vector<std::reference_wrapper<Object>> Message<T>::getObjectArray() {
         return get_object_array();
     }
+
+    /**
+     * @throws MessageWithoutObjectException If the message does not contain types derived from \ref allpix::Object
+     */
+    template <typename T> void Message<T>::appendObjects(std::vector<Object*>& objects) {
+        if constexpr(std::is_base_of<Object, T>::value) {
+            objects.reserve(objects.size() + data_.size());
+            for(auto& object : data_) {
+                objects.push_back(&object);
+            }
+        } else {
+            throw MessageWithoutObjectException(typeid(*this));
+        }
+    }
     /**
      * Pass the data as a copy of the internal vector referencing the same data as the internal vector
      *
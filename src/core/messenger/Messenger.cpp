@@ -10,13 +10,19 @@
 
 #include "Messenger.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
 #include <typeindex>
 
 #include "Message.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/EventTracer.hpp"
 #include "core/module/Module.hpp"
+#include "core/module/exceptions.h"
 #include "core/utils/log.h"
 #include "core/utils/type.h"
 #include "delegates.h"
@@ -32,124 +38,209 @@ Messenger::~Messenger() {
 }
 #endif
 
-// Check if the detectors match for the message and the delegate
-static bool check_send(BaseMessage* message, BaseDelegate* delegate) {
-    if(delegate->getDetector() != nullptr &&
-       (message->getDetector() == nullptr || delegate->getDetector()->getName() != message->getDetector()->getName())) {
-        return false;
+const Messenger::Route::Delegates& Messenger::Route::getDelegates(const Detector* detector) const {
+    if(detector != nullptr && !detector_delegates.empty()) {
+        auto iter = detector_delegates.find(detector->getName());
+        if(iter != detector_delegates.end()) {
+            return iter->second;
+        }
     }
-    return true;
+    return unbound_delegates;
 }
 
 /**
  * Messages should be bound during construction, so this function only gives useful information outside the constructor
  */
-bool Messenger::hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
+bool Messenger::hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message, const std::string& message_name) {
     const BaseMessage* inst = message.get();
-    std::type_index type_idx = typeid(*inst);
-
-    // Get the name of the output message
-    auto name = source->get_configuration().get<std::string>("output");
+    return has_receiver(source, typeid(*inst), message->getDetector().get(), message_name);
+}
 
-    // Check if a normal specific listener exists
-    for(auto& delegate : delegates_[type_idx][name]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
-        }
-    }
-    // Check if a normal generic listener exists
-    for(auto& delegate : delegates_[type_idx]["*"]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
-        }
-    }
-    // Check if a base message specific listener exists
-    for(auto& delegate : delegates_[typeid(BaseMessage)][name]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
-        }
-    }
-    // Check if a base message generic listener exists
-    for(auto& delegate : delegates_[typeid(BaseMessage)]["*"]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
+/**
+ * The receivers are looked up in the route of the message, which is built on the first check or dispatch. The result is
+ * kept until the delegates change.
+ */
+bool Messenger::has_receiver(Module* source,
+                             const std::type_index& type,
+                             const Detector* detector,
+                             const std::string& name) {
+    auto key = std::make_tuple(source, type, name, (detector == nullptr ? std::string() : detector->getName()));
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto iter = receivers_.find(key);
+        if(iter != receivers_.end()) {
+            return iter->second;
         }
     }
 
-    return false;
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    const auto& route = build_route(source, type, name);
+    bool receiver = !route.getDelegates(detector).empty();
+    receivers_[key] = receiver;
+    return receiver;
 }
 
 /**
- * Send messages to all specific listeners and also to all generic listeners (listening to all incoming messages)
+ * Delegates listening to all message types never hold a single message. The check is only done during initialization, so
+ * the result is not cached.
  */
-void Messenger::dispatch_message(Module* source, const std::shared_ptr<BaseMessage>& message, std::string name) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool Messenger::has_single_receiver(Module* source,
+                                    const std::type_index& type,
+                                    const Detector* detector,
+                                    const std::string& name) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    const auto& route = build_route(source, type, name);
+    const auto& delegates = route.getDelegates(detector);
+    return std::any_of(delegates.begin(), delegates.end(), [](const auto& delegate) { return delegate.first->isSingle(); });
+}
 
-    // Get the name of the output message
-    if(name == "-") {
-        name = source->get_configuration().get<std::string>("output");
-    }
+/**
+ * Send messages to all specific listeners and also to all generic listeners (listening to all incoming messages). If the
+ * messages of the current event are deferred, the messages are only stored in the event and delivered later. As the
+ * delegates are not called in this case, messages of deferred events are dispatched concurrently.
+ */
+void Messenger::dispatch_message(Module* source, const std::shared_ptr<BaseMessage>& message, const std::string& name) {
+    auto* event = Event::get_current();
+    bool deferred = (event != nullptr && event->deferred_);
+    EventTracer::Scope trace(EventTracer::Category::DISPATCH, source, event != nullptr ? event->getNumber() : 0);
 
-    bool send = false;
+    // Create type identifier from the typeid
+    const BaseMessage* inst = message.get();
+    std::type_index type_idx = typeid(*inst);
+
+    // Look up the route of the message, the route is only built by the first dispatch after the delegates changed
+    std::shared_lock<std::shared_mutex> shared_lock(mutex_, std::defer_lock);
+    std::unique_lock<std::shared_mutex> lock(mutex_, std::defer_lock);
+    const Route* route = nullptr;
+    if(deferred) {
+        shared_lock.lock();
+        auto iter = routes_.find(std::make_tuple(source, type_idx, name));
+        if(iter != routes_.end()) {
+            route = &iter->second;
+        } else {
+            shared_lock.unlock();
+        }
+    }
+    if(route == nullptr) {
+        lock.lock();
+        route = &build_route(source, type_idx, name);
+    }
 
-    // Send to specific listeners
-    send = dispatch_message(source, message, name, name) || send;
+    // Account for the memory and the objects of the message in the current event
+    if(event != nullptr) {
+        event->account_message(source, type_idx, message->getMemoryUsage(), message->getObjectCount());
+    }
 
-    // Send to generic listeners
-    send = dispatch_message(source, message, name, "*") || send;
+    // Store the message in the current event and deliver it directly unless delivery is deferred
+    bool send = false;
+    for(const auto& [delegate, generic] : route->getDelegates(message->getDetector().get())) {
+        LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
+                   << (generic ? " to generic listener " : " to ") << delegate->getUniqueName();
+        if(event != nullptr) {
+            event->store_message(delegate, message, route->name);
+        }
+        if(!deferred) {
+            delegate->process(message, route->name);
+        }
+        send = true;
+    }
 
     // Display a TRACE log message if the message is send to no receiver
     if(!send) {
-        const BaseMessage* inst = message.get();
-        LOG(TRACE) << "Dispatched message " << allpix::demangle(typeid(*inst).name()) << " from " << source->getUniqueName()
+        LOG(TRACE) << "Dispatched message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
                    << " has no receivers!";
     }
 
     // Save a copy of the sent message
-    sent_messages_.emplace_back(message);
+    if(deferred) {
+        event->keep_message(message);
+    } else {
+        sent_messages_.emplace_back(message);
+    }
 }
 
 /**
- * Messages are only dispatched to delegates listening to the exact same type and the exact same name.
+ * Messages are only dispatched to delegates listening to the exact same type and the exact same name, or to delegates
+ * ignoring the name. The delegates are listed in the same order as they are checked for every message: first the specific
+ * listeners for the message type and for all messages, then the generic listeners for the message type and for all messages.
+ * The delegates bound to a detector are listed separately per detector together with all unbound delegates, keeping this
+ * order, such that messages are not checked against the delegates of all other detectors when dispatched.
  */
-bool Messenger::dispatch_message(Module* source,
-                                 const std::shared_ptr<BaseMessage>& message,
-                                 const std::string& name,
-                                 const std::string& id) {
-    bool send = false;
+const Messenger::Route& Messenger::build_route(Module* source, const std::type_index& type, const std::string& name) {
+    auto key = std::make_tuple(source, type, name);
+    auto iter = routes_.find(key);
+    if(iter != routes_.end()) {
+        return iter->second;
+    }
 
-    // Create type identifier from the typeid
-    const BaseMessage* inst = message.get();
-    std::type_index type_idx = typeid(*inst);
+    // Get the name of the output message
+    Route route;
+    route.name = (name == "-" ? source->get_configuration().get<std::string>("output") : name);
 
-    // Send messages only to their specific listeners
-    for(auto& delegate : delegates_[type_idx][id]) {
-        if(check_send(message.get(), delegate.get())) {
-            LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
-                       << " to " << delegate->getUniqueName();
-            delegate->process(message, name);
-            send = true;
+    assert(std::type_index(typeid(BaseMessage)) != type);
+    Route::Delegates delegates;
+    for(const auto& id : {route.name, std::string("*")}) {
+        for(auto& delegate : delegates_[type][id]) {
+            delegates.emplace_back(delegate.get(), false);
+        }
+        for(auto& delegate : delegates_[typeid(BaseMessage)][id]) {
+            delegates.emplace_back(delegate.get(), true);
         }
     }
 
-    // Dispatch to base message listeners
-    assert(typeid(BaseMessage) != typeid(*inst));
-    for(auto& delegate : delegates_[typeid(BaseMessage)][id]) {
-        if(check_send(message.get(), delegate.get())) {
-            LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
-                       << " to generic listener " << delegate->getUniqueName();
-            delegate->process(message, name);
-            send = true;
+    // Split the delegates by their detector, adding the unbound delegates to the list of every detector
+    for(const auto& item : delegates) {
+        auto detector = item.first->getDetector();
+        if(detector != nullptr) {
+            route.detector_delegates.emplace(detector->getName(), Route::Delegates());
         }
     }
+    for(const auto& item : delegates) {
+        auto detector = item.first->getDetector();
+        if(detector == nullptr) {
+            route.unbound_delegates.push_back(item);
+            for(auto& detector_delegates : route.detector_delegates) {
+                detector_delegates.second.push_back(item);
+            }
+        } else {
+            route.detector_delegates[detector->getName()].push_back(item);
+        }
+    }
+
+    return routes_.emplace(std::move(key), std::move(route)).first->second;
+}
 
-    return send;
+/**
+ * @throws InvalidModuleActionException If the messages are fetched outside the run method
+ */
+std::vector<std::shared_ptr<BaseMessage>> Messenger::fetch_messages(Module* module, const std::type_info& message_type) {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot fetch messages outside the run method");
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::vector<std::shared_ptr<BaseMessage>> messages;
+    for(auto& delegate : module->delegates_) {
+        // Only consider delegates of this messenger listening to the requested type
+        auto iter = delegate_to_iterator_.find(delegate.second);
+        if(delegate.first != this || iter == delegate_to_iterator_.end() ||
+           std::get<0>(iter->second) != std::type_index(message_type)) {
+            continue;
+        }
+
+        for(auto& message : event->get_messages(delegate.second)) {
+            messages.push_back(message.first);
+        }
+    }
+    return messages;
 }
 
 void Messenger::add_delegate(const std::type_info& message_type, Module* module, std::unique_ptr<BaseDelegate> delegate) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    routes_.clear();
+    receivers_.clear();
 
     // Register generic or specific delegate depending on flag
     std::string message_name;
@@ -173,7 +264,9 @@ void Messenger::add_delegate(const std::type_info& message_type, Module* module,
  * @throws std::out_of_range If a delegate is removed which is never registered
  */
 void Messenger::remove_delegate(BaseDelegate* delegate) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    routes_.clear();
+    receivers_.clear();
 
     auto iter = delegate_to_iterator_.find(delegate);
     if(iter == delegate_to_iterator_.end()) {
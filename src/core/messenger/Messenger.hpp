@@ -14,8 +14,13 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
 #include <typeindex>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Message.hpp"
 #include "core/module/Module.hpp"
@@ -104,9 +109,38 @@ namespace allpix {
          * @brief Check if a specific message has a receiver
          * @param source Module that will send the message
          * @param message Instantiation of the message to check
+         * @param name Optional message name (defaults to - indicating that it is dispatched to the module output parameter)
          * @return True if the message has at least one receiver, false otherwise
          */
-        bool hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message);
+        bool hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message, const std::string& name = "-");
+
+        /**
+         * @brief Check if messages of a specific type have a receiver, without constructing a message
+         * @param source Module that will send the messages
+         * @param detector Detector the messages are bound to, or a null pointer for messages without detector
+         * @param name Optional message name (defaults to - indicating that it is dispatched to the module output parameter)
+         * @return True if the messages have at least one receiver, false otherwise
+         *
+         * The result is kept until the delegates change, such that modules can cheaply check in every event if they can
+         * skip building an output without any receiver.
+         */
+        template <typename T>
+        bool hasReceiver(Module* source, const std::shared_ptr<const Detector>& detector, const std::string& name = "-");
+
+        /**
+         * @brief Check if messages of a specific type have a receiver accepting only a single message per event
+         * @param source Module that will send the messages
+         * @param detector Detector the messages are bound to, or a null pointer for messages without detector
+         * @param name Optional message name (defaults to - indicating that it is dispatched to the module output parameter)
+         * @return True if any receiver of the messages is bound to a single message, false otherwise
+         *
+         * Allows modules dispatching several messages of the same type per event to reject such receivers during
+         * initialization instead of failing in the first event.
+         */
+        template <typename T>
+        bool hasSingleReceiver(Module* source,
+                               const std::shared_ptr<const Detector>& detector,
+                               const std::string& name = "-");
 
         /**
          * @brief Dispatches a message
@@ -118,6 +152,27 @@ namespace allpix {
         template <typename T>
         void dispatchMessage(Module* source, std::shared_ptr<T> message, const std::string& name = "-");
 
+        /**
+         * @brief Fetches the message of the current event bound to a module
+         * @param module Module fetching the message
+         * @return Message of the requested type or a null pointer if no such message was received in the current event
+         * @warning This method can only be used from the run method of the module
+         * @note If multiple messages were received, the last dispatched message is returned
+         *
+         * Contrary to bound members, fetched messages are specific to the event processed by the calling thread. Modules
+         * enabling \ref Module::enable_event_parallelization "event parallelization" should use this method to access their
+         * messages instead of the bound members. The type should be registered for the module by binding it first.
+         */
+        template <typename T> std::shared_ptr<T> fetchMessage(Module* module);
+
+        /**
+         * @brief Fetches all messages of the current event bound to a module
+         * @param module Module fetching the messages
+         * @return List of all messages of the requested type received in the current event
+         * @warning This method can only be used from the run method of the module
+         */
+        template <typename T> std::vector<std::shared_ptr<T>> fetchMultiMessage(Module* module);
+
         /**
          * @brief Removes the list of sent messages, clearing them from memory if not otherwise used
          */
@@ -145,19 +200,84 @@ namespace allpix {
          * @param message Message to dispatch
          * @param name Message name (- indicates to use module output parameter)
          */
-        void dispatch_message(Module* source, const std::shared_ptr<BaseMessage>& message, std::string name);
+        void dispatch_message(Module* source, const std::shared_ptr<BaseMessage>& message, const std::string& name);
+
+        /**
+         * @brief Delegates a message of a given type and name from a source module is delivered to
+         *
+         * The delegates are split by the detector they are bound to when the route is built, such that a message is only
+         * handed to the delegates of its detector and to the delegates receiving the messages of all detectors.
+         */
+        struct Route {
+            // Delegates in order of delivery, together with a flag if the delegate listens to all message types
+            using Delegates = std::vector<std::pair<BaseDelegate*, bool>>;
 
+            /**
+             * @brief Get the delegates a message bound to a detector is delivered to
+             * @param detector Detector the message is bound to, or a null pointer for messages without detector
+             * @return Delegates in order of delivery
+             */
+            const Delegates& getDelegates(const Detector* detector) const;
+
+            // Name of the message, with the module output parameter resolved
+            std::string name;
+            // Delegates not bound to a detector, receiving all messages
+            Delegates unbound_delegates;
+            // Delegates receiving the messages of every detector with a bound delegate, including the unbound delegates
+            std::map<std::string, Delegates> detector_delegates;
+        };
+        /**
+         * @brief Key identifying a route by the source module, the message type and the name given when dispatching
+         */
+        using RouteKey = std::tuple<Module*, std::type_index, std::string>;
+        /**
+         * @brief Hash function for the route keys
+         */
+        struct RouteKeyHash {
+            size_t operator()(const RouteKey& key) const {
+                auto hash = std::hash<Module*>()(std::get<0>(key));
+                hash = hash * 31 + std::get<1>(key).hash_code();
+                return hash * 31 + std::hash<std::string>()(std::get<2>(key));
+            }
+        };
         /**
-         * @brief Dispatch base message to the exact delegates
+         * @brief Collect the delegates a message is delivered to and store them as route
          * @param source Dispatching module
-         * @param message Message to dispatch
-         * @param name Name of the message
-         * @param id Identifier to dispatch to (either the name or '*' to dispatch to all)
+         * @param type Type of the message
+         * @param name Message name (- indicates to use module output parameter)
+         * @return Route listing the specific and general delegates in order of delivery
+         * @warning The messenger has to be locked exclusively by the caller
          */
-        bool dispatch_message(Module* source,
-                              const std::shared_ptr<BaseMessage>& message,
-                              const std::string& name,
-                              const std::string& id);
+        const Route& build_route(Module* source, const std::type_index& type, const std::string& name);
+
+        /**
+         * @brief Check if messages have a receiver
+         * @param source Module that will send the messages
+         * @param type Type of the messages
+         * @param detector Detector the messages are bound to, or a null pointer for messages without detector
+         * @param name Name of the messages, or - for the output parameter of the module
+         * @return True if the messages have at least one receiver, false otherwise
+         */
+        bool has_receiver(Module* source, const std::type_index& type, const Detector* detector, const std::string& name);
+
+        /**
+         * @brief Check if messages have a receiver accepting only a single message per event
+         * @param source Module that will send the messages
+         * @param type Type of the messages
+         * @param detector Detector the messages are bound to, or a null pointer for messages without detector
+         * @param name Name of the messages, or - for the output parameter of the module
+         * @return True if any receiver of the messages is bound to a single message, false otherwise
+         */
+        bool
+        has_single_receiver(Module* source, const std::type_index& type, const Detector* detector, const std::string& name);
+
+        /**
+         * @brief Fetch all messages of the current event received by the delegates of a module for a message type
+         * @param module Module to fetch the messages for
+         * @param message_type Type of the messages
+         * @return List of messages in order of dispatch per delegate
+         */
+        std::vector<std::shared_ptr<BaseMessage>> fetch_messages(Module* module, const std::type_info& message_type);
 
         using DelegateMap = std::map<std::type_index, std::map<std::string, std::list<std::unique_ptr<BaseDelegate>>>>;
         using DelegateIteratorMap =
@@ -168,7 +288,12 @@ namespace allpix {
         DelegateIteratorMap delegate_to_iterator_;
         std::vector<std::shared_ptr<BaseMessage>> sent_messages_;
 
-        mutable std::mutex mutex_;
+        // Routes of all dispatched messages, cleared whenever delegates are added or removed
+        std::unordered_map<RouteKey, Route, RouteKeyHash> routes_;
+        // Results of the receiver checks by source, message type, name and detector, cleared together with the routes
+        std::map<std::tuple<Module*, std::type_index, std::string, std::string>, bool> receivers_;
+
+        mutable std::shared_mutex mutex_;
     };
 } // namespace allpix
 
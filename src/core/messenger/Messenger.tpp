@@ -15,6 +15,19 @@ namespace allpix {
         dispatch_message(source, std::static_pointer_cast<BaseMessage>(message), name);
     }
 
+    template <typename T>
+    bool Messenger::hasReceiver(Module* source, const std::shared_ptr<const Detector>& detector, const std::string& name) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Checked message should inherit from Message class");
+        return has_receiver(source, typeid(T), detector.get(), name);
+    }
+
+    template <typename T>
+    bool
+    Messenger::hasSingleReceiver(Module* source, const std::shared_ptr<const Detector>& detector, const std::string& name) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Checked message should inherit from Message class");
+        return has_single_receiver(source, typeid(T), detector.get(), name);
+    }
+
     template <typename T>
     void Messenger::registerListener(T* receiver,
                                      void (T::*method)(std::shared_ptr<BaseMessage>, std::string name),
@@ -45,6 +58,26 @@ namespace allpix {
         add_delegate(typeid(R), receiver, std::move(delegate));
     }
 
+    template <typename T> std::shared_ptr<T> Messenger::fetchMessage(Module* module) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Fetched message should inherit from Message class");
+
+        auto messages = fetch_messages(module, typeid(T));
+        if(messages.empty()) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<T>(messages.back());
+    }
+
+    template <typename T> std::vector<std::shared_ptr<T>> Messenger::fetchMultiMessage(Module* module) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Fetched message should inherit from Message class");
+
+        std::vector<std::shared_ptr<T>> messages;
+        for(auto& message : fetch_messages(module, typeid(T))) {
+            messages.push_back(std::static_pointer_cast<T>(message));
+        }
+        return messages;
+    }
+
     // FIXME: Allow binding other containers besides vector
     template <typename T, typename R>
     void Messenger::bindMulti(T* receiver, std::vector<std::shared_ptr<R>> T::*member, MsgFlags flags) {
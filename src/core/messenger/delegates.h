@@ -16,7 +16,9 @@
 #ifndef ALLPIX_DELEGATE_H
 #define ALLPIX_DELEGATE_H
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <memory>
 #include <typeinfo>
 
@@ -64,6 +66,20 @@ namespace allpix {
         return static_cast<MsgFlags>(static_cast<uint32_t>(f1) & static_cast<uint32_t>(f2));
     }
 
+    /**
+     * @ingroup Delegates
+     * @brief Readiness of a receiver, updated by its delegates when they receive their first message after a reset
+     *
+     * The receiver is ready to run once no required delegate is missing a message, such that its readiness does not have to
+     * be polled from all its delegates.
+     */
+    struct DelegateReadiness {
+        // Number of required delegates which did not receive a message yet
+        std::atomic<size_t> missing_messages{0};
+        // If any delegate received a message since the last reset
+        std::atomic<bool> received_messages{false};
+    };
+
     /**
      * @ingroup Delegates
      * @brief Base for all delegates
@@ -92,10 +108,10 @@ namespace allpix {
 
         /// @{
         /**
-         * @brief Enable default move behaviour
+         * @brief Moving a delegate is not allowed either, as its receiver keeps its address
          */
-        BaseDelegate(BaseDelegate&&) noexcept = default;
-        BaseDelegate& operator=(BaseDelegate&&) noexcept = default;
+        BaseDelegate(BaseDelegate&&) = delete;
+        BaseDelegate& operator=(BaseDelegate&&) = delete;
         /// @}
 
         /**
@@ -118,6 +134,18 @@ namespace allpix {
          */
         MsgFlags getFlags() const { return flags_; }
 
+        /**
+         * @brief Check if the delegate accepts only a single message per event
+         * @return True if a further message of the event is rejected or replaces the previous one, false otherwise
+         */
+        virtual bool isSingle() const { return false; }
+
+        /**
+         * @brief Set the readiness of the receiver updated by this delegate
+         * @param readiness Readiness of the receiver, counting this delegate as missing if it is required
+         */
+        void setReadiness(DelegateReadiness* readiness) { readiness_ = readiness; }
+
         /**
          * @brief Get the detector bound to a delegate
          * @return Linked detector
@@ -145,11 +173,23 @@ namespace allpix {
     protected:
         /**
          * @brief Set the processed flag to signal that the delegate is satisfied
+         *
+         * The first message after a reset marks the receiver as having received messages, and counts down the missing
+         * messages of the receiver if the delegate is required.
          */
-        void set_processed() { processed_ = true; }
-        bool processed_;
+        void set_processed() {
+            if(processed_.exchange(true) || readiness_ == nullptr) {
+                return;
+            }
+            readiness_->received_messages = true;
+            if((getFlags() & MsgFlags::REQUIRED) != MsgFlags::NONE) {
+                --readiness_->missing_messages;
+            }
+        }
+        std::atomic<bool> processed_;
 
         MsgFlags flags_;
+        DelegateReadiness* readiness_{};
     };
 
     /**
@@ -312,6 +352,12 @@ namespace allpix {
          */
         SingleBindDelegate(MsgFlags flags, T* obj, BindType member) : ModuleDelegate<T>(flags, obj), member_(member) {}
 
+        /**
+         * @brief A single bound delegate holds only one message per event
+         * @return Always true
+         */
+        bool isSingle() const override { return true; }
+
         /**
          * @brief Saves the message to the bound message pointer
          * @param msg Message to process
@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Implementation of queue executing the asynchronous tasks of a module
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "AsyncTaskQueue.hpp"
+
+#include <string>
+#include <utility>
+
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+AsyncTaskQueue::AsyncTaskQueue(size_t max_size) : max_size_(max_size) {
+    thread_ = std::thread(&AsyncTaskQueue::loop, this);
+}
+
+AsyncTaskQueue::~AsyncTaskQueue() {
+    try {
+        stop();
+    } catch(...) { // NOLINT
+        // Exceptions of the tasks cannot be propagated anymore at this point
+    }
+}
+
+/**
+ * The logging settings of the pushing thread, such as the log level and section of the module, are applied while executing
+ * the task
+ */
+void AsyncTaskQueue::push(std::function<void()> task) {
+    auto log_level = Log::getReportingLevel();
+    auto log_format = Log::getFormat();
+    auto log_section = Log::getSection();
+    auto logged_task = [task = std::move(task), log_level, log_format, log_section]() {
+        Log::setReportingLevel(log_level);
+        Log::setFormat(log_format);
+        Log::setSection(log_section);
+        task();
+    };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return tasks_.size() < max_size_ || exception_; });
+    if(exception_) {
+        std::rethrow_exception(exception_);
+    }
+    tasks_.push_back(std::move(logged_task));
+    lock.unlock();
+    condition_.notify_all();
+}
+
+void AsyncTaskQueue::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return (tasks_.empty() && !busy_) || exception_; });
+    if(exception_) {
+        std::rethrow_exception(exception_);
+    }
+}
+
+void AsyncTaskQueue::stop() {
+    if(thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        condition_.notify_all();
+        thread_.join();
+    }
+    if(exception_) {
+        std::rethrow_exception(exception_);
+    }
+}
+
+void AsyncTaskQueue::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true) {
+        condition_.wait(lock, [this]() { return !tasks_.empty() || stopped_; });
+        if(tasks_.empty()) {
+            break;
+        }
+
+        // Execute the next task outside of the lock
+        auto task = std::move(tasks_.front());
+        tasks_.pop_front();
+        busy_ = true;
+        lock.unlock();
+        condition_.notify_all();
+        try {
+            task();
+        } catch(...) {
+            lock.lock();
+            exception_ = std::current_exception();
+            tasks_.clear();
+            busy_ = false;
+            condition_.notify_all();
+            return;
+        }
+        // Release the resources of the task before taking the lock again
+        task = nullptr;
+        lock.lock();
+        busy_ = false;
+        condition_.notify_all();
+    }
+}
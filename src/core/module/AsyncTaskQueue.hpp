@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief Definition of queue executing the asynchronous tasks of a module
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_ASYNC_TASK_QUEUE_H
+#define ALLPIX_ASYNC_TASK_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace allpix {
+    /**
+     * @brief Bounded queue of tasks executed in order by a thread of their own
+     *
+     * Used for modules which spend most of their time waiting for input or output, such as writing events to disk. The
+     * tasks are executed one after the other in the order they were pushed, at the same time as the modules of the next
+     * events. Pushing a task blocks while the queue is full. The first exception thrown by a task stops the execution of
+     * all further tasks and is rethrown by the next call to any of the methods of the queue.
+     */
+    class AsyncTaskQueue {
+    public:
+        /**
+         * @brief Construct the queue and start its thread
+         * @param max_size Largest number of tasks waiting in the queue
+         */
+        explicit AsyncTaskQueue(size_t max_size);
+
+        /// @{
+        /**
+         * @brief Copying or moving the queue is not allowed
+         */
+        AsyncTaskQueue(const AsyncTaskQueue& rhs) = delete;
+        AsyncTaskQueue& operator=(const AsyncTaskQueue& rhs) = delete;
+        /// @}
+
+        /**
+         * @brief Execute all remaining tasks and stop the thread, ignoring any exception
+         */
+        ~AsyncTaskQueue();
+
+        /**
+         * @brief Add a task to the queue, waiting while the queue is full
+         * @param task Task to execute
+         * @throws Any exception thrown by a previous task
+         */
+        void push(std::function<void()> task);
+
+        /**
+         * @brief Wait until all tasks added so far have been executed
+         * @throws Any exception thrown by a task
+         */
+        void wait();
+
+        /**
+         * @brief Execute all remaining tasks and stop the thread
+         * @throws Any exception thrown by a task
+         */
+        void stop();
+
+    private:
+        /**
+         * @brief Loop of the thread, executing the queued tasks until the queue is stopped
+         */
+        void loop();
+
+        size_t max_size_;
+        std::deque<std::function<void()>> tasks_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool stopped_{false};
+        bool busy_{false};
+        std::exception_ptr exception_;
+        std::thread thread_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_ASYNC_TASK_QUEUE_H */
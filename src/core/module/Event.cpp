@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief Implementation of the event
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "Event.hpp"
+
+#include <array>
+#include <random>
+
+#include "core/messenger/Message.hpp"
+#include "core/messenger/delegates.h"
+
+using namespace allpix;
+
+Event::Event(unsigned int number, uint64_t seed) : number_(number), seed_(seed) {}
+
+Event::~Event() {
+    if(memory_counter_ != nullptr) {
+        *memory_counter_ -= memory_usage_;
+    }
+}
+
+// Thread local storage of the current event
+static Event*& current_event() {
+    thread_local Event* event = nullptr;
+    return event;
+}
+Event* Event::get_current() {
+    return current_event();
+}
+void Event::set_current(Event* event) {
+    current_event() = event;
+}
+
+/**
+ * Both seeds are split into their 32 bit parts, as the seed sequence only uses the lower 32 bits of every value
+ */
+uint64_t Event::derive_seed(uint64_t seed, uint64_t offset) {
+    std::seed_seq seed_seq({static_cast<uint32_t>(seed),
+                            static_cast<uint32_t>(seed >> 32),
+                            static_cast<uint32_t>(offset),
+                            static_cast<uint32_t>(offset >> 32)});
+    std::array<uint32_t, 2> values{};
+    seed_seq.generate(values.begin(), values.end());
+    return (static_cast<uint64_t>(values[0]) << 32) | values[1];
+}
+
+void Event::store_message(BaseDelegate* delegate, std::shared_ptr<BaseMessage> message, std::string name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages_[delegate].emplace_back(std::move(message), std::move(name));
+}
+void Event::keep_message(std::shared_ptr<BaseMessage> message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sent_messages_.emplace_back(std::move(message));
+}
+
+void Event::account_message(const Module* source, const std::type_index& type, size_t bytes, size_t objects) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        memory_per_message_[std::make_pair(source, type)] += bytes;
+        objects_per_type_[type] += objects;
+    }
+    memory_usage_ += bytes;
+    if(memory_counter_ != nullptr) {
+        *memory_counter_ += bytes;
+    }
+}
+
+Event::MessageList Event::get_messages(BaseDelegate* delegate) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = messages_.find(delegate);
+    if(iter == messages_.end()) {
+        return MessageList();
+    }
+    return iter->second;
+}
+bool Event::has_messages(BaseDelegate* delegate) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = messages_.find(delegate);
+    return iter != messages_.end() && !iter->second.empty();
+}
@@ -0,0 +1,187 @@
+/**
+ * @file
+ * @brief Definition of the event holding the state of a single event in the event sequence
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_EVENT_H
+#define ALLPIX_EVENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+    class BaseDelegate;
+    class BaseMessage;
+    class Module;
+
+    /**
+     * @brief State of a single event in the event sequence
+     *
+     * Holds all messages dispatched during an event, grouped by the delegate they are meant for. This allows the
+     * \ref ModuleManager to process several events at the same time, as the messages of one event are never mixed with the
+     * messages of another event. The event is set as the current event of a thread while a module is executing its run
+     * method for it. The memory held by the dispatched messages is accounted for every module and message type.
+     */
+    class Event {
+        friend class Messenger;
+        friend class Module;
+        friend class ModuleManager;
+
+    public:
+        using MessageList = std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>;
+
+        /**
+         * @brief Construct an event
+         * @param number Number of the event in the event sequence (starts at 1)
+         * @param seed Seed of the event used to derive the event seeds of the modules
+         */
+        Event(unsigned int number, uint64_t seed);
+
+        /**
+         * @brief Remove the memory of this event from the counter of the events in flight
+         */
+        ~Event();
+
+        /// @{
+        /**
+         * @brief Copying an event is not allowed
+         */
+        Event(const Event&) = delete;
+        Event& operator=(const Event&) = delete;
+        /// @}
+
+        /// @{
+        /**
+         * @brief Disallow move because of mutex
+         */
+        Event(Event&&) = delete;
+        Event& operator=(Event&&) = delete;
+        /// @}
+
+        /**
+         * @brief Get the number of this event
+         * @return Number of the event in the event sequence (starts at 1)
+         */
+        unsigned int getNumber() const { return number_; }
+
+        /**
+         * @brief Get the seed of this event
+         * @return Seed of the event
+         */
+        uint64_t getSeed() const { return seed_; }
+
+        /**
+         * @brief Get the memory held by all messages dispatched in this event so far
+         * @return Number of bytes, as estimated by \ref BaseMessage::getMemoryUsage
+         */
+        size_t getMemoryUsage() const { return memory_usage_; }
+
+        /**
+         * @brief Get the memory budget of this event
+         * @return Number of bytes the messages of a single event should not exceed, zero if unlimited
+         */
+        uint64_t getMemoryBudget() const { return memory_budget_; }
+
+        /**
+         * @brief Get the statistical weight of this event
+         * @return Weight of the event, one unless the sampling of the event has been biased
+         */
+        double getWeight() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return weight_;
+        }
+
+    private:
+        /**
+         * @brief Get the event currently processed by this thread
+         * @return Pointer to the current event or a null pointer if no event is processed
+         */
+        static Event* get_current();
+        /**
+         * @brief Set the event currently processed by this thread
+         * @param event Pointer to the event (or a null pointer to clear the current event)
+         */
+        static void set_current(Event* event);
+
+        /**
+         * @brief Derive a new seed from two seeds
+         * @param seed First seed
+         * @param offset Second seed, typically the seed of the event or the number of the event
+         * @return Derived seed which only depends on the two provided seeds
+         */
+        static uint64_t derive_seed(uint64_t seed, uint64_t offset);
+
+        /**
+         * @brief Store a message for a delegate listening to it
+         * @param delegate Delegate the message is meant for
+         * @param message Message to store
+         * @param name Name of the message
+         */
+        void store_message(BaseDelegate* delegate, std::shared_ptr<BaseMessage> message, std::string name);
+        /**
+         * @brief Keep a reference to a dispatched message until the end of the event
+         * @param message Message to keep alive
+         */
+        void keep_message(std::shared_ptr<BaseMessage> message);
+        /**
+         * @brief Account for the memory and the objects of a dispatched message
+         * @param source Module dispatching the message
+         * @param type Type of the message
+         * @param bytes Memory held by the message
+         * @param objects Number of objects stored in the message
+         */
+        void account_message(const Module* source, const std::type_index& type, size_t bytes, size_t objects);
+
+        /**
+         * @brief Get all messages stored for a delegate
+         * @param delegate Delegate to fetch the messages for
+         * @return List of messages together with their names in order of dispatch
+         */
+        MessageList get_messages(BaseDelegate* delegate) const;
+        /**
+         * @brief Check if any message is stored for a delegate
+         * @param delegate Delegate to check
+         * @return True if at least one message is available, false otherwise
+         */
+        bool has_messages(BaseDelegate* delegate) const;
+
+        unsigned int number_;
+        uint64_t seed_;
+
+        // Messages are only stored and delivered later by the framework if several events are processed concurrently
+        bool deferred_{false};
+
+        // Set if a module vetoed the event, the remaining modules are skipped
+        std::atomic<bool> vetoed_{false};
+
+        // Statistical weight of the event, the product of the factors of all modules biasing the event
+        double weight_{1.};
+
+        std::map<BaseDelegate*, MessageList> messages_;
+        std::vector<std::shared_ptr<BaseMessage>> sent_messages_;
+
+        // Memory of the dispatched messages per module and message type, and in total
+        std::map<std::pair<const Module*, std::type_index>, size_t> memory_per_message_;
+        // Number of dispatched objects per message type
+        std::map<std::type_index, size_t> objects_per_type_;
+        std::atomic<size_t> memory_usage_{0};
+        uint64_t memory_budget_{0};
+        // Optional counter of the memory of all events in flight, updated together with the memory of this event
+        std::atomic<size_t>* memory_counter_{nullptr};
+
+        mutable std::mutex mutex_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_EVENT_H */
@@ -0,0 +1,158 @@
+/**
+ * @file
+ * @brief Implementation of the tracer recording the execution of modules and tasks over time
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "EventTracer.hpp"
+
+#include <string>
+
+#include "Module.hpp"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+std::atomic<bool> EventTracer::enabled_{false};
+size_t EventTracer::buffer_size_{0};
+std::chrono::steady_clock::time_point EventTracer::start_time_;
+std::vector<std::unique_ptr<EventTracer::Buffer>> EventTracer::buffers_;
+std::mutex EventTracer::buffers_mutex_;
+
+namespace {
+    // Escape a string for use in JSON
+    std::string json_string(const std::string& str) {
+        std::string result = "\"";
+        for(auto character : str) {
+            if(character == '"' || character == '\\') {
+                result += '\\';
+            }
+            result += character;
+        }
+        result += '"';
+        return result;
+    }
+} // namespace
+
+EventTracer::Scope::Scope(Category category, const Module* module, unsigned int event)
+    : active_(EventTracer::isEnabled()), category_(category), module_(module), event_(event) {
+    if(active_) {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+/**
+ * The record is stored in the next slot of the ring buffer of the thread, overwriting the oldest record if it is full
+ */
+EventTracer::Scope::~Scope() {
+    if(!active_) {
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    auto& buffer = thread_buffer();
+    auto count = buffer.count.load(std::memory_order_relaxed);
+    auto& record = buffer.records[count % buffer.records.size()];
+    record.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(start_ - start_time_).count();
+    record.end = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_time_).count();
+    record.module = module_;
+    record.event = event_;
+    record.category = category_;
+    // Publish the record to the thread writing the trace
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void EventTracer::enable(size_t buffer_size) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if(enabled_) {
+        return;
+    }
+    buffer_size_ = buffer_size;
+    start_time_ = std::chrono::steady_clock::now();
+    enabled_ = true;
+}
+
+/**
+ * Threads only take the lock when they record for the first time
+ */
+EventTracer::Buffer& EventTracer::thread_buffer() {
+    thread_local Buffer* buffer = nullptr;
+    if(buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(std::make_unique<Buffer>(buffer_size_, static_cast<unsigned int>(buffers_.size())));
+        buffer = buffers_.back().get();
+    }
+    return *buffer;
+}
+
+/**
+ * Every execution is written as a complete event with its begin time and duration in microseconds. The threads are
+ * numbered in the order they first recorded, the event number is added as argument of every execution if known.
+ */
+void EventTracer::write(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    auto flags = out.flags();
+    auto precision = out.precision(3);
+    out << std::fixed;
+
+    out << "{\n";
+    out << "  \"displayTimeUnit\": \"ms\",\n";
+    out << "  \"traceEvents\": [";
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+    uint64_t dropped = 0;
+    for(auto& buffer : buffers_) {
+        separator();
+        out << "    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread
+            << ", \"args\": {\"name\": \"Thread " << buffer->thread << "\"}}";
+
+        // Write the records of the ring buffer from the oldest to the newest
+        auto count = buffer->count.load(std::memory_order_acquire);
+        auto size = static_cast<uint64_t>(buffer->records.size());
+        auto first_record = (count > size ? count - size : 0);
+        dropped += first_record;
+        for(auto i = first_record; i < count; ++i) {
+            const auto& record = buffer->records[i % size];
+
+            std::string name, category;
+            switch(record.category) {
+            case Category::MODULE:
+                name = record.module->getUniqueName();
+                category = "module";
+                break;
+            case Category::TASK:
+                name = (record.module != nullptr ? "Task of " + record.module->getUniqueName() : "Task");
+                category = "task";
+                break;
+            case Category::DISPATCH:
+                name = "Dispatch from " + record.module->getUniqueName();
+                category = "dispatch";
+                break;
+            }
+
+            separator();
+            out << "    {\"name\": " << json_string(name) << ", \"cat\": \"" << category << "\", \"ph\": \"X\", \"ts\": "
+                << static_cast<double>(record.begin) / 1e3
+                << ", \"dur\": " << static_cast<double>(record.end - record.begin) / 1e3 << ", \"pid\": 1, \"tid\": "
+                << buffer->thread;
+            if(record.event > 0) {
+                out << ", \"args\": {\"event\": " << record.event << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n  ]\n}\n";
+    out.flags(flags);
+    out.precision(precision);
+
+    if(dropped > 0) {
+        LOG(WARNING) << "Trace buffers were full, " << dropped << " oldest records are not included in the trace";
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file
+ * @brief Definition of the tracer recording the execution of modules and tasks over time
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_EVENT_TRACER_H
+#define ALLPIX_EVENT_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace allpix {
+    class Module;
+
+    /**
+     * @brief Tracer recording when modules, tasks of the thread pool and message dispatches are executed on every thread
+     *
+     * Every thread records into a ring buffer of its own, such that recording does not take any lock and only the most
+     * recent records are kept if the buffer is full. The records are written in the trace event format of Chrome, which can
+     * be displayed by the trace viewer of Chrome or Perfetto to find the times threads are waiting. Recording is disabled
+     * until \ref enable is called, in which case creating a \ref Scope only reads a single flag.
+     */
+    class EventTracer {
+    public:
+        /**
+         * @brief Category of the traced executions
+         */
+        enum class Category : uint8_t { MODULE = 0, TASK, DISPATCH };
+
+        /**
+         * @brief Records the execution of its lifetime on the calling thread
+         */
+        class Scope {
+        public:
+            /**
+             * @brief Start the execution
+             * @param category Category of the execution
+             * @param module Module executed, dispatching or owning the task, can be a null pointer for tasks
+             * @param event Number of the event, zero if it is unknown
+             */
+            Scope(Category category, const Module* module, unsigned int event = 0);
+            /**
+             * @brief Record the execution
+             */
+            ~Scope();
+
+            /// @{
+            /**
+             * @brief Copying or moving the scope is not allowed
+             */
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            /// @}
+
+        private:
+            bool active_;
+            Category category_;
+            const Module* module_;
+            unsigned int event_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        /**
+         * @brief Enable recording on all threads, the time of the trace starts at the first call
+         * @param buffer_size Number of records kept for every thread, should be larger than zero
+         */
+        static void enable(size_t buffer_size);
+
+        /**
+         * @brief Returns if recording is enabled
+         * @return True if the executions are recorded, false otherwise
+         */
+        static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Write all records to a stream in the trace event format of Chrome
+         * @param out Stream to write the trace to
+         * @warning Should only be called while no other thread is recording, and all traced modules must still exist
+         */
+        static void write(std::ostream& out);
+
+    private:
+        /**
+         * @brief Single traced execution, with the times in nanoseconds since the start of the trace
+         */
+        struct Record {
+            int64_t begin;
+            int64_t end;
+            const Module* module;
+            unsigned int event;
+            Category category;
+        };
+
+        /**
+         * @brief Ring buffer of the records of a single thread
+         */
+        struct Buffer {
+            explicit Buffer(size_t size, unsigned int index) : records(size), thread(index) {}
+            std::vector<Record> records;
+            std::atomic<uint64_t> count{0};
+            unsigned int thread;
+        };
+
+        /**
+         * @brief Get the buffer of the calling thread, registering it on first use
+         * @return Buffer of the calling thread
+         */
+        static Buffer& thread_buffer();
+
+        static std::atomic<bool> enabled_;
+        static size_t buffer_size_;
+        static std::chrono::steady_clock::time_point start_time_;
+
+        static std::vector<std::unique_ptr<Buffer>> buffers_;
+        static std::mutex buffers_mutex_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_EVENT_TRACER_H */
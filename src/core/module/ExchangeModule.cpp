@@ -0,0 +1,38 @@
+/**
+ * @file
+ * @brief Implementation of the module exchanging messages with an application embedding the framework
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ExchangeModule.hpp"
+
+#include <utility>
+
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+ExchangeModule::ExchangeModule(Configuration& config, Messenger* messenger) : Module(config), messenger_(messenger) {}
+
+void ExchangeModule::addInput(std::shared_ptr<BaseMessage> message) {
+    input_.push_back(std::move(message));
+}
+
+std::vector<std::shared_ptr<BaseMessage>> ExchangeModule::takeOutput() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::shared_ptr<BaseMessage>> output;
+    output.swap(output_);
+    return output;
+}
+
+void ExchangeModule::run(unsigned int) {
+    LOG(DEBUG) << "Dispatching " << input_.size() << " message(s) of the application";
+    for(auto& message : input_) {
+        messenger_->dispatchMessage(this, message);
+    }
+    input_.clear();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief Definition of the module exchanging messages with an application embedding the framework
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_EXCHANGE_MODULE_H
+#define ALLPIX_EXCHANGE_MODULE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Module.hpp"
+#include "core/config/Configuration.hpp"
+#include "core/messenger/Message.hpp"
+#include "core/messenger/Messenger.hpp"
+
+namespace allpix {
+    /**
+     * @brief Module passing messages between the modules of an event and an application embedding the framework
+     *
+     * The module is not loaded from a library but added in front of all configured modules. It dispatches the messages
+     * handed over by the application for the next event as if they were created by a module, and keeps the messages of the
+     * types bound as output which are dispatched by the modules of the event. The messages are not stored in any file.
+     */
+    class ExchangeModule : public Module {
+    public:
+        /**
+         * @brief Constructor of the exchange module
+         * @param config Configuration of the module, which has to outlive the module
+         * @param messenger Pointer to the messenger to dispatch and receive the messages
+         */
+        ExchangeModule(Configuration& config, Messenger* messenger);
+
+        /**
+         * @brief Add a message to dispatch in the next event
+         * @param message Message to dispatch
+         */
+        void addInput(std::shared_ptr<BaseMessage> message);
+
+        /**
+         * @brief Keep all messages of a type dispatched by the modules, regardless of their name
+         * @warning Has to be called before running the first event
+         */
+        template <typename T> void bindOutput() {
+            messenger_->registerListener(this, &ExchangeModule::receive_output<T>, MsgFlags::IGNORE_NAME);
+        }
+
+        /**
+         * @brief Take the messages kept since the last call
+         * @return Messages of the bound types in the order they were dispatched
+         */
+        std::vector<std::shared_ptr<BaseMessage>> takeOutput();
+
+        /**
+         * @brief Dispatch the messages added for this event
+         */
+        void run(unsigned int) override;
+
+    private:
+        template <typename T> void receive_output(std::shared_ptr<T> message) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            output_.push_back(std::move(message));
+        }
+
+        Messenger* messenger_;
+
+        // Messages dispatched in the next event and kept from the events run, the later ones are received concurrently
+        std::vector<std::shared_ptr<BaseMessage>> input_;
+        std::mutex mutex_;
+        std::vector<std::shared_ptr<BaseMessage>> output_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_EXCHANGE_MODULE_H */
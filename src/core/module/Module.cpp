@@ -10,8 +10,11 @@
 
 #include "Module.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <utility>
 
@@ -90,7 +93,8 @@ std::string Module::createOutputFile(const std::string& path, bool global, bool
         file += "/";
         file += path;
 
-        if(path_is_file(file)) {
+        // Output files of a resumed run are continued by the modules
+        if(path_is_file(file) && !resuming_) {
             auto global_overwrite = getConfigManager()->getGlobalConfiguration().get<bool>("deny_overwrite", false);
             if(config_.get<bool>("deny_overwrite", global_overwrite)) {
                 throw ModuleError("Overwriting of existing file " + file + " denied.");
@@ -137,6 +141,84 @@ uint64_t Module::getRandomSeed() {
     return random_generator_();
 }
 
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+uint64_t Module::getEventSeed() const {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot access event seed outside the run method");
+    }
+
+    return Event::derive_seed(config_.get<uint64_t>("_seed"), event->getSeed());
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+PhiloxRandomEngine Module::getRandomStream(uint64_t stream) const {
+    return PhiloxRandomEngine(getEventSeed(), stream);
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+size_t Module::getEventMemoryUsage() const {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot access event memory outside the run method");
+    }
+    return event->getMemoryUsage();
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+uint64_t Module::getEventMemoryBudget() const {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot access event memory budget outside the run method");
+    }
+    return event->getMemoryBudget();
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+double Module::getEventWeight() const {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot access event weight outside the run method");
+    }
+    return event->getWeight();
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+void Module::scaleEventWeight(double factor) {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot change event weight outside the run method");
+    }
+    std::lock_guard<std::mutex> lock(event->mutex_);
+    event->weight_ *= factor;
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called outside the run method
+ */
+void Module::vetoEvent() {
+    auto* event = Event::get_current();
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Cannot veto event outside the run method");
+    }
+    if(!event->vetoed_.exchange(true)) {
+        LOG(DEBUG) << "Vetoed event " << event->getNumber();
+    }
+    ++vetoed_events_;
+}
+
 /**
  * @throws InvalidModuleActionException If the thread pool is accessed outside the run-method
  * @warning Any multithreaded task should be carefully checked to ensure it is thread-safe
@@ -156,6 +238,38 @@ void Module::set_thread_pool(std::shared_ptr<ThreadPool> thread_pool) {
     thread_pool_ = std::move(thread_pool);
 }
 
+/**
+ * @throws InvalidModuleActionException If asynchronous tasks are already enabled or the queue size is zero
+ */
+void Module::enable_async_tasks(size_t queue_size) {
+    if(async_tasks_ != nullptr) {
+        throw InvalidModuleActionException("Asynchronous tasks are already enabled");
+    }
+    if(queue_size == 0) {
+        throw InvalidModuleActionException("Queue of asynchronous tasks cannot be empty");
+    }
+    async_tasks_ = std::make_unique<AsyncTaskQueue>(queue_size);
+}
+void Module::run_async(std::function<void()> task) {
+    if(async_tasks_ == nullptr) {
+        task();
+        return;
+    }
+    async_tasks_->push(std::move(task));
+}
+void Module::wait_async_tasks() {
+    if(async_tasks_ != nullptr) {
+        async_tasks_->wait();
+    }
+}
+void Module::stop_async_tasks() {
+    if(async_tasks_ != nullptr) {
+        // Reset the queue before propagating exceptions, as it cannot be used anymore
+        auto async_tasks = std::move(async_tasks_);
+        async_tasks->stop();
+    }
+}
+
 /**
  * @throws InvalidModuleActionException If this method is called from the constructor or destructor
  * @warning Cannot be used from the constructor, because the instantiation logic has not finished yet
@@ -170,6 +284,62 @@ TDirectory* Module::getROOTDirectory() const {
 
     return directory_;
 }
+
+/**
+ * The subdirectories are created while holding the lock of the output file of the modules, such that several threads can
+ * request the same subdirectory at the same time.
+ */
+TDirectory* Module::getROOTDirectory(const std::string& path) const {
+    auto* directory = getROOTDirectory();
+
+    std::lock_guard<std::recursive_mutex> lock(root_output_mutex());
+    std::stringstream path_stream(path);
+    std::string name;
+    while(std::getline(path_stream, name, '/')) {
+        if(name.empty()) {
+            continue;
+        }
+        auto* subdirectory = directory->GetDirectory(name.c_str());
+        if(subdirectory == nullptr) {
+            subdirectory = directory->mkdir(name.c_str());
+            if(subdirectory == nullptr) {
+                throw ModuleError("Cannot create ROOT directory " + path);
+            }
+        }
+        directory = subdirectory;
+    }
+    return directory;
+}
+
+/**
+ * @throws InvalidModuleActionException If this method is called from the constructor or destructor
+ */
+void Module::writeROOTObject(const TObject* object, const std::string& name, const std::string& path) const {
+    auto* directory = (path.empty() ? getROOTDirectory() : getROOTDirectory(path));
+
+    std::lock_guard<std::recursive_mutex> lock(root_output_mutex());
+    directory->WriteTObject(object, name.empty() ? nullptr : name.c_str());
+}
+
+void Module::setMetric(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    auto metric = std::find_if(metrics_.begin(), metrics_.end(), [&](const auto& entry) { return entry.first == name; });
+    if(metric == metrics_.end()) {
+        metrics_.emplace_back(name, value);
+    } else {
+        metric->second = value;
+    }
+}
+std::vector<std::pair<std::string, double>> Module::get_metrics() const {
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    return metrics_;
+}
+
+std::recursive_mutex& Module::root_output_mutex() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
 void Module::set_ROOT_directory(TDirectory* directory) {
     directory_ = directory;
 }
@@ -195,6 +365,63 @@ void Module::enable_parallelization() {
     parallelize_ = true;
 }
 
+bool Module::canParallelizeEvents() {
+    return parallelize_events_;
+}
+void Module::enable_event_parallelization() {
+    parallelize_ = true;
+    parallelize_events_ = true;
+}
+
+bool Module::canUseDedicatedThread() {
+    return dedicated_thread_;
+}
+void Module::enable_dedicated_thread() {
+    dedicated_thread_ = true;
+}
+
+bool Module::canParallelizeInit() {
+    return parallel_init_;
+}
+void Module::enable_parallel_init() {
+    parallel_init_ = true;
+}
+
+bool Module::canParallelizeFinalization() {
+    return parallel_finalization_;
+}
+void Module::enable_parallel_finalization() {
+    parallel_finalization_ = true;
+}
+
+bool Module::has_concurrent_events() const {
+    return concurrent_events_;
+}
+void Module::set_concurrent_events(bool concurrent_events) {
+    concurrent_events_ = concurrent_events;
+}
+
+bool Module::has_event_seeding() const {
+    return concurrent_events_ || event_seeding_;
+}
+void Module::set_event_seeding(bool event_seeding) {
+    event_seeding_ = event_seeding;
+}
+
+bool Module::is_resuming() const {
+    return resuming_;
+}
+void Module::set_resuming(bool resuming) {
+    resuming_ = resuming;
+}
+
+bool Module::has_object_history() const {
+    return object_history_;
+}
+void Module::set_object_history(bool object_history) {
+    object_history_ = object_history;
+}
+
 Configuration& Module::get_configuration() {
     return config_;
 }
@@ -208,19 +435,45 @@ ModuleIdentifier Module::get_identifier() const {
 
 void Module::add_delegate(Messenger* messenger, BaseDelegate* delegate) {
     delegates_.emplace_back(messenger, delegate);
+    delegate->setReadiness(&readiness_);
+    if((delegate->getFlags() & MsgFlags::REQUIRED) != MsgFlags::NONE) {
+        ++required_delegates_;
+        ++readiness_.missing_messages;
+    }
 }
+/**
+ * The messages sent in the event are released by the messenger of the delegates, all delegates are registered with the same
+ * messenger. Delegates are only reset if any of them received a message, such that modules not receiving any messages in an
+ * event do not visit their delegates.
+ */
 void Module::reset_delegates() {
-    for(auto& delegate : delegates_) {
-        delegate.first->clearMessages();
-        delegate.second->reset();
+    if(!delegates_.empty()) {
+        delegates_.front().first->clearMessages();
     }
+    if(readiness_.received_messages.exchange(false)) {
+        for(auto& delegate : delegates_) {
+            delegate.second->reset();
+        }
+    }
+    readiness_.missing_messages = required_delegates_;
 }
 bool Module::check_delegates() {
+    // All required delegates count down the missing messages when receiving their first message of the event
+    return readiness_.missing_messages == 0;
+}
+bool Module::check_delegates(Event* event) {
     for(auto& delegate : delegates_) {
-        // Return false if any delegate is not satisfied
-        if(!delegate.second->isSatisfied()) {
+        // Return false if any required delegate did not receive a message in this event
+        if((delegate.second->getFlags() & MsgFlags::REQUIRED) != MsgFlags::NONE && !event->has_messages(delegate.second)) {
             return false;
         }
     }
     return true;
 }
+void Module::deliver_messages(Event* event) {
+    for(auto& delegate : delegates_) {
+        for(auto& message : event->get_messages(delegate.second)) {
+            delegate.second->process(message.first, message.second);
+        }
+    }
+}
@@ -10,19 +10,27 @@
 #ifndef ALLPIX_MODULE_H
 #define ALLPIX_MODULE_H
 
+#include <algorithm>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <TDirectory.h>
 
+#include "AsyncTaskQueue.hpp"
+#include "Event.hpp"
 #include "ModuleIdentifier.hpp"
 #include "ThreadPool.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/geometry/Detector.hpp"
 #include "core/messenger/delegates.h"
+#include "core/utils/prng.h"
 #include "exceptions.h"
 
 namespace allpix {
@@ -112,6 +120,89 @@ namespace allpix {
          */
         uint64_t getRandomSeed();
 
+        /**
+         * @brief Get seed to initialize random generators for the current event
+         * @warning This method can only be used from the run method
+         *
+         * The seed only depends on the seed of the module and the number of the current event. Random generators seeded
+         * with this value thus produce reproducible results independent of the order in which events are processed.
+         */
+        uint64_t getEventSeed() const;
+
+        /**
+         * @brief Get a counter-based random generator for an independent stream of the current event
+         * @param stream Number of the stream, typically the index of a task the work of the event is split into
+         * @warning This method can only be used from the run method
+         *
+         * The generator is keyed with the event seed of this module and only depends on the module seed, the event seed and
+         * the stream number. Streams can thus be created cheaply for every task executed in parallel, and produce results
+         * independent of the number of threads and the order in which tasks are executed.
+         */
+        PhiloxRandomEngine getRandomStream(uint64_t stream) const;
+
+        /**
+         * @brief Get the memory held by the messages dispatched in the current event so far
+         * @return Number of bytes
+         * @warning This method can only be used from the run method
+         */
+        size_t getEventMemoryUsage() const;
+
+        /**
+         * @brief Get the memory budget of a single event
+         * @return Number of bytes the messages of the current event should not exceed, zero if unlimited
+         * @warning This method can only be used from the run method
+         *
+         * Modules creating large amounts of data can reduce their temporary memory once the budget is exceeded, for example
+         * by processing their data in smaller chunks.
+         */
+        uint64_t getEventMemoryBudget() const;
+
+        /**
+         * @brief Get the statistical weight of the current event
+         * @return Weight of the event, one unless a module biased the sampling of the event
+         * @warning This method can only be used from the run method
+         *
+         * Modules filling histograms or writing events should account for this weight, such that the results of a biased
+         * simulation represent the unbiased distributions.
+         */
+        double getEventWeight() const;
+
+        /**
+         * @brief Scale the statistical weight of the current event
+         * @param factor Ratio of the probability of the event in the unbiased and the biased sampling
+         * @warning This method can only be used from the run method
+         *
+         * Modules sampling the event from a biased distribution, as done for importance sampling, multiply the event weight
+         * with the ratio of the unbiased and the biased probability density of the sampled values.
+         */
+        void scaleEventWeight(double factor);
+
+        /**
+         * @brief Veto the current event, skipping all remaining modules for this event
+         * @warning This method can only be used from the run method
+         *
+         * Modules which find an event to be of no further interest, for example because no energy has been deposited in
+         * any sensor, can veto it to avoid running the subsequent modules. The run method of the calling module continues
+         * normally, and the number of vetoed events is reported per module at the end of the run.
+         */
+        void vetoEvent();
+
+        /**
+         * @brief Get the number of events vetoed by this module
+         * @return Number of vetoed events
+         */
+        unsigned int getVetoedEvents() const { return vetoed_events_; }
+
+        /**
+         * @brief Set the current value of a counter of this module reported in the metrics of the run
+         * @param name Name of the counter
+         * @param value Current value of the counter
+         *
+         * Modules keeping statistics of their work, such as the number of integration steps of a propagation, can publish
+         * their totals in the metrics file of the run, which is written periodically while the simulation is running.
+         */
+        void setMetric(const std::string& name, double value);
+
         /**
          * @brief Get thread pool to submit asynchronous tasks to
          */
@@ -123,6 +214,24 @@ namespace allpix {
          */
         TDirectory* getROOTDirectory() const;
 
+        /**
+         * @brief Get a subdirectory of the ROOT directory of this module, creating it if it does not exist yet
+         * @param path Path of the subdirectory relative to the ROOT directory of the module, separated by slashes
+         * @return ROOT directory for storage
+         * @note Can be called from several threads at the same time and does not change the current ROOT directory
+         */
+        TDirectory* getROOTDirectory(const std::string& path) const;
+
+        /**
+         * @brief Write an object to the ROOT directory of this module or one of its subdirectories
+         * @param object Object to write
+         * @param name Name of the object in the directory, the name of the object is used if empty
+         * @param path Path of the subdirectory relative to the ROOT directory of the module, created if it does not exist
+         * @note Can be called from several threads at the same time, as all writes to the output file of the modules are
+         * serialized, and does not change the current ROOT directory
+         */
+        void writeROOTObject(const TObject* object, const std::string& name = "", const std::string& path = "") const;
+
         /**
          * @brief Get the config manager object to allow to read the global and other module configurations
          * @return Pointer to the config manager
@@ -135,6 +244,30 @@ namespace allpix {
          */
         bool canParallelize();
 
+        /**
+         * @brief Returns if this module can process several events at the same time
+         * @return True if event parallelization is enabled, false otherwise (the default)
+         */
+        bool canParallelizeEvents();
+
+        /**
+         * @brief Returns if this module can be executed on a dedicated thread when processing events at the same time
+         * @return True if a dedicated thread can be used, false otherwise (the default)
+         */
+        bool canUseDedicatedThread();
+
+        /**
+         * @brief Returns if this module can be initialized at the same time as the other instantiations of the module
+         * @return True if a concurrent initialization is enabled, false otherwise (the default)
+         */
+        bool canParallelizeInit();
+
+        /**
+         * @brief Returns if this module can be finalized at the same time as other modules
+         * @return True if a concurrent finalization is enabled, false otherwise (the default)
+         */
+        bool canParallelizeFinalization();
+
         /**
          * @brief Initialize the module before the event sequence
          *
@@ -159,12 +292,147 @@ namespace allpix {
          */
         virtual void finalize() {}
 
+        /**
+         * @brief Store the state of the module in a checkpoint of the run
+         * @param directory ROOT directory in the checkpoint file to store the state in
+         *
+         * Called between events if checkpoints are enabled, after all events up to the checkpoint have been processed by
+         * all modules, and once more after the last event. Modules keeping state across events, which is not derived from
+         * the event seeds, should store it to allow resuming the run. Does nothing if not overloaded.
+         */
+        virtual void checkpoint(TDirectory* directory) { (void)directory; }
+
+        /**
+         * @brief Restore the state of the module from the checkpoint the run is resumed from
+         * @param directory ROOT directory in the checkpoint file containing the state stored by \ref checkpoint
+         *
+         * Called after the initialization of all modules if the run is resumed, before the first event after the checkpoint
+         * is processed. Does nothing if not overloaded.
+         */
+        virtual void resume(TDirectory* directory) { (void)directory; }
+
     protected:
         /**
          * @brief Enable parallelization for this module
          */
         void enable_parallelization();
 
+        /**
+         * @brief Enable processing of several events at the same time for this module
+         * @warning Modules enabling this should only fetch their messages through \ref Messenger::fetchMessage and should
+         *          not keep any event-specific state in members, as the run method can be called by several threads at once
+         * @note This also enables parallelization of the module
+         */
+        void enable_event_parallelization();
+
+        /**
+         * @brief Allow the initialization of this module at the same time as the other instantiations of the module
+         * @warning Modules enabling this should not modify any state shared between the instantiations in their init method
+         *          without synchronization, and should not create ROOT objects outside of their own directory
+         */
+        void enable_parallel_init();
+
+        /**
+         * @brief Allow the finalization of this module at the same time as the finalization of other modules
+         * @warning Modules enabling this should only write to output files of their own or to their directory in the main
+         *          ROOT file through \ref writeROOTObject, and should not create ROOT objects in the main ROOT file
+         */
+        void enable_parallel_finalization();
+
+        /**
+         * @brief Allow the execution of this module on a dedicated thread instead of the main thread
+         *
+         * Modules which cannot process several events at the same time are executed by the main thread in the order of the
+         * events. Modules enabling this are instead executed by a thread of their own, such that they can run at the same
+         * time as the other modules of this kind, still in the order of the events.
+         * @warning Modules enabling this should not depend on state only available on the thread executing the init method
+         */
+        void enable_dedicated_thread();
+
+        /**
+         * @brief Enable the asynchronous execution of tasks on a thread dedicated to this module
+         * @param queue_size Largest number of tasks waiting for execution, submitting more tasks waits for a free slot
+         * @note Should be called in the init method, tasks are executed directly by \ref run_async if not enabled
+         */
+        void enable_async_tasks(size_t queue_size);
+
+        /**
+         * @brief Execute a task after all tasks submitted before, asynchronously if enabled by \ref enable_async_tasks
+         * @param task Task to execute, which should own all data it needs
+         * @throws Any exception thrown by a previous asynchronous task
+         *
+         * Modules dominated by input or output, such as writers, can hand the work of every event to this method. The run
+         * method returns immediately, such that the next events are processed while the task is executed. All tasks are
+         * finished by the framework before the finalize and checkpoint methods of the module are called.
+         * @warning The task is executed at the same time as other methods of the module and should not share any state with
+         * them without synchronization
+         */
+        void run_async(std::function<void()> task);
+
+        /**
+         * @brief Wait until all asynchronous tasks submitted so far are executed
+         * @throws Any exception thrown by an asynchronous task
+         */
+        void wait_async_tasks();
+
+        /**
+         * @brief Returns if the framework actually processes several events at the same time in this module
+         * @return True if the run method can be called for different events concurrently, false otherwise
+         * @note Only meaningful during the run phase of the module
+         */
+        bool has_concurrent_events() const;
+
+        /**
+         * @brief Returns if the random generators of this module have to be seeded for every event
+         * @return True if events are processed concurrently or if event seeding is enabled for the run, false otherwise
+         *
+         * Modules drawing random numbers in the run method should seed their generator with \ref getEventSeed if this method
+         * returns true, such that the random numbers of an event do not depend on the events processed before.
+         */
+        bool has_event_seeding() const;
+
+        /**
+         * @brief Returns if the run is resumed from a checkpoint
+         * @return True if the run continues from a checkpoint, in which case \ref resume is called after the initialization
+         * @note Existing output files are not deleted by \ref createOutputFile when resuming a run
+         */
+        bool is_resuming() const;
+
+        /**
+         * @brief Returns if the objects created by the module should be linked to the objects they originate from
+         * @return True if the history is required, false if no consumer requests the links such as to the Monte-Carlo truth
+         * @note Modules should only skip the links which are expensive to keep, such as lists of objects per pixel
+         */
+        bool has_object_history() const;
+
+        /**
+         * @brief Execute a function for chunks of a range of indices in parallel using the tasks of this module
+         * @param begin First index of the range
+         * @param end Index past the last index of the range
+         * @param grain Number of indices per chunk, the last chunk can be smaller
+         * @param function Function called with the first index, the index past the last index and the number of a chunk
+         * @note The chunks are executed directly by the calling thread if no thread pool is available or if the range
+         * fits into a single chunk. All chunks are finished before returning, also if any of them throws an exception.
+         * @warning The function is called by several threads at the same time and should be thread-safe
+         */
+        template <typename Func> void parallel_for(size_t begin, size_t end, size_t grain, Func&& function);
+
+        /**
+         * @brief Compute results for chunks of a range of indices in parallel and combine them in the order of the chunks
+         * @param begin First index of the range
+         * @param end Index past the last index of the range
+         * @param grain Number of indices per chunk, the last chunk can be smaller
+         * @param identity Initial value of the combined result
+         * @param function Function called with the first index, the index past the last index and the number of a chunk,
+         * returning the result of the chunk
+         * @param reduce Function combining the results so far with the result of the next chunk
+         * @return Combined result of all chunks
+         * @note The results are combined by the calling thread in the order of the chunks, such that the result does not
+         * depend on the number of threads or the order of execution
+         */
+        template <typename T, typename Func, typename Reduce>
+        T parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Func&& function, Reduce&& reduce);
+
         /**
          * @brief Get the module configuration for internal use
          * @return Configuration of the module
@@ -192,6 +460,13 @@ namespace allpix {
         void set_thread_pool(std::shared_ptr<ThreadPool> thread_pool);
         std::shared_ptr<ThreadPool> thread_pool_;
 
+        /**
+         * @brief Execute all remaining asynchronous tasks and stop their thread
+         * @throws Any exception thrown by an asynchronous task
+         */
+        void stop_async_tasks();
+        std::unique_ptr<AsyncTaskQueue> async_tasks_;
+
         /**
          * @brief Set the output ROOT directory for this module
          * @param directory ROOT directory for storage
@@ -199,6 +474,21 @@ namespace allpix {
         void set_ROOT_directory(TDirectory* directory);
         TDirectory* directory_{nullptr};
 
+        /**
+         * @brief Get the lock serializing the modifications of the output file of the modules
+         * @return Mutex shared by all modules, recursive such that it can be held while finalizing a module writing to the
+         *         file through \ref writeROOTObject
+         */
+        static std::recursive_mutex& root_output_mutex();
+
+        /**
+         * @brief Get the counters of this module reported in the metrics of the run
+         * @return List of the names and current values of the counters in the order they were first set
+         */
+        std::vector<std::pair<std::string, double>> get_metrics() const;
+        std::vector<std::pair<std::string, double>> metrics_;
+        mutable std::mutex metrics_mutex_;
+
         /**
          * @brief Set the link to the config manager
          * @param conf_manager ConfigManager holding all relevant configurations
@@ -214,13 +504,27 @@ namespace allpix {
         void add_delegate(Messenger* messenger, BaseDelegate* delegate);
         /**
          * @brief Resets messenger delegates after every event
+         * @note Only resets the delegates if any of them received a message since the last reset
          */
         void reset_delegates();
         /**
          * @brief Check if all delegates are satisfied
+         * @note Only checks the number of required delegates still missing a message, without visiting the delegates
          */
         bool check_delegates();
+        /**
+         * @brief Check if all required delegates received a message in the given event
+         * @param event Event to check the stored messages of
+         */
+        bool check_delegates(Event* event);
+        /**
+         * @brief Deliver all messages stored in the given event to the delegates
+         * @param event Event to deliver the messages of
+         */
+        void deliver_messages(Event* event);
         std::vector<std::pair<Messenger*, BaseDelegate*>> delegates_;
+        size_t required_delegates_{};
+        DelegateReadiness readiness_;
 
         bool initialized_random_generator_{false};
         std::mt19937_64 random_generator_;
@@ -228,8 +532,46 @@ namespace allpix {
         std::shared_ptr<Detector> detector_;
 
         bool parallelize_{false};
+        bool parallelize_events_{false};
+        bool dedicated_thread_{false};
+        bool parallel_init_{false};
+        bool parallel_finalization_{false};
+
+        /**
+         * @brief Set if several events are processed concurrently by this module
+         * @param concurrent_events True if the run method can be called for different events concurrently
+         */
+        void set_concurrent_events(bool concurrent_events);
+        bool concurrent_events_{false};
+
+        /**
+         * @brief Set if the random generators are seeded for every event
+         * @param event_seeding True if all modules derive their random numbers of an event from the event seed
+         */
+        void set_event_seeding(bool event_seeding);
+        bool event_seeding_{false};
+
+        /**
+         * @brief Set if the run is resumed from a checkpoint
+         * @param resuming True if the run continues from a checkpoint
+         */
+        void set_resuming(bool resuming);
+        bool resuming_{false};
+
+        // Number of events vetoed by this module
+        std::atomic<unsigned int> vetoed_events_{0};
+
+        /**
+         * @brief Set if the objects created by the module should be linked to the objects they originate from
+         * @param object_history True if the history is required
+         */
+        void set_object_history(bool object_history);
+        bool object_history_{true};
     };
 
 } // namespace allpix
 
+// Include template members
+#include "Module.tpp"
+
 #endif /* ALLPIX_MODULE_H */
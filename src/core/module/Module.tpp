@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Template implementation of module
+ *
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+namespace allpix {
+    /**
+     * The chunks are submitted as tasks of this module and the calling thread executes tasks until all have been started.
+     * The tasks refer to the function of the caller, hence all of them have to finish before an exception is propagated.
+     */
+    template <typename Func> void Module::parallel_for(size_t begin, size_t end, size_t grain, Func&& function) {
+        if(end <= begin) {
+            return;
+        }
+        grain = std::max(grain, static_cast<size_t>(1));
+        auto chunks = (end - begin + grain - 1) / grain;
+
+        // Execute the chunks directly if they cannot be distributed
+        if(thread_pool_ == nullptr || chunks == 1) {
+            for(size_t chunk = 0; chunk < chunks; ++chunk) {
+                auto chunk_begin = begin + chunk * grain;
+                function(chunk_begin, std::min(chunk_begin + grain, end), chunk);
+            }
+            return;
+        }
+
+        std::vector<std::future<void>> futures;
+        futures.reserve(chunks);
+        for(size_t chunk = 0; chunk < chunks; ++chunk) {
+            auto chunk_begin = begin + chunk * grain;
+            auto chunk_end = std::min(chunk_begin + grain, end);
+            futures.push_back(thread_pool_->submit(
+                this, [&function, chunk_begin, chunk_end, chunk]() { function(chunk_begin, chunk_end, chunk); }));
+        }
+
+        auto wait_all = [&futures]() {
+            for(auto& future : futures) {
+                if(future.valid()) {
+                    future.wait();
+                }
+            }
+        };
+        try {
+            thread_pool_->execute(this);
+        } catch(...) {
+            wait_all();
+            throw;
+        }
+        wait_all();
+
+        // Propagate the first exception thrown by any chunk
+        for(auto& future : futures) {
+            future.get();
+        }
+    }
+
+    template <typename T, typename Func, typename Reduce>
+    T Module::parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Func&& function, Reduce&& reduce) {
+        if(end <= begin) {
+            return identity;
+        }
+        grain = std::max(grain, static_cast<size_t>(1));
+        auto chunks = (end - begin + grain - 1) / grain;
+
+        // Every chunk stores its own result, which are combined in order afterwards
+        std::vector<T> results(chunks, identity);
+        parallel_for(begin, end, grain, [&](size_t chunk_begin, size_t chunk_end, size_t chunk) {
+            results[chunk] = function(chunk_begin, chunk_end, chunk);
+        });
+
+        T result = std::move(identity);
+        for(auto& chunk_result : results) {
+            result = reduce(std::move(result), std::move(chunk_result));
+        }
+        return result;
+    }
+} // namespace allpix
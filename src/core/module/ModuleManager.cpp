@@ -14,16 +14,26 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <limits>
+#include <mutex>
 #include <random>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
-#include <TProcessID.h>
+#include <TMemFile.h>
 #include <TSystem.h>
 
 #include "core/config/ConfigManager.hpp"
@@ -31,8 +41,13 @@
 #include "core/config/exceptions.h"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
+#include "core/module/EventTracer.hpp"
 #include "core/utils/file.h"
 #include "core/utils/log.h"
+#include "core/utils/numa.h"
+#include "core/utils/text.h"
+#include "core/utils/type.h"
+#include "core/utils/unit.h"
 
 // Common prefix for all modules
 // TODO [doc] Should be provided by the build system
@@ -46,6 +61,20 @@ using namespace allpix;
 
 ModuleManager::ModuleManager() : terminate_(false) {}
 
+/**
+ * Asynchronous tasks of modules which have not been finalized, for example after an exception, can still access the
+ * members of the module. They are executed and stopped first, such that the module can be destroyed safely.
+ */
+ModuleManager::~ModuleManager() {
+    for(auto& module : modules_) {
+        try {
+            module->stop_async_tasks();
+        } catch(std::exception& e) {
+            LOG(WARNING) << "Asynchronous task of " << module->get_identifier().getUniqueName() << " failed: " << e.what();
+        }
+    }
+}
+
 /**
  * Loads the modules specified in the configuration file. Each module is contained within its own library which is loaded
  * automatically. After that the required modules are created from the configuration.
@@ -70,117 +99,117 @@ void ModuleManager::load(Messenger* messenger,
         LOG(WARNING) << "Main ROOT file " << path << " exists and will be overwritten.";
         allpix::remove_file(path);
     }
-    modules_file_ = std::make_unique<TFile>(path.c_str(), "RECREATE");
+    // The main ROOT file is only kept in memory when embedded in another application, such that no file is written
+    if(global_config.get<bool>("_embedded", false)) {
+        modules_file_ = std::make_unique<TMemFile>(path.c_str(), "RECREATE");
+    } else {
+        modules_file_ = std::make_unique<TFile>(path.c_str(), "RECREATE");
+    }
     if(modules_file_->IsZombie()) {
         throw RuntimeError("Cannot create main ROOT file " + path);
     }
-    modules_file_->cd();
-
-    // Loop through all non-global configurations
-    for(auto& config : configs) {
-        // Load library for each module. Libraries are named (by convention + CMAKE) libAllpixModule Name.suffix
-        std::string lib_name = std::string(ALLPIX_MODULE_PREFIX).append(config.getName()).append(SHARED_LIBRARY_SUFFIX);
-        LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loading module " << config.getName();
 
-        void* lib = nullptr;
-        bool load_error = false;
-        dlerror();
-        if(loaded_libraries_.count(lib_name) == 0) {
-            // If library is not loaded then try to load it first from the config directories
-            if(global_config.has("library_directories")) {
-                std::vector<std::string> lib_paths = global_config.getPathArray("library_directories", true);
-                for(auto& lib_path : lib_paths) {
-                    std::string full_lib_path = lib_path;
-                    full_lib_path += "/";
-                    full_lib_path += lib_name;
-
-                    // Check if the absolute file exists and try to load if it exists
-                    std::ifstream check_file(full_lib_path);
-                    if(check_file.good()) {
-                        lib = dlopen(full_lib_path.c_str(), RTLD_NOW);
-                        if(lib != nullptr) {
-                            LOG(DEBUG) << "Found library in configuration specified directory at " << full_lib_path;
-                        } else {
-                            load_error = true;
-                        }
-                        break;
-                    }
-                }
-            }
+    // Enable the detailed profiling of the modules if requested
+    if(global_config.has("profiling_file")) {
+        profiling_file_ = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("profiling_file");
+        profiling_file_ = allpix::add_file_extension(profiling_file_, "json");
+        profiler_ = std::make_unique<ModuleProfiler>(global_config.get<bool>("profiling_hardware_counters", false));
+        LOG(DEBUG) << "Writing profiling report of the modules to " << profiling_file_;
+    }
 
-            // Otherwise try to load from the standard paths if not found already
-            if(!load_error && lib == nullptr) {
-                lib = dlopen(lib_name.c_str(), RTLD_NOW);
+    // Record a trace of the execution of the modules on all threads if requested
+    if(global_config.has("trace_file")) {
+        trace_file_ = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("trace_file");
+        trace_file_ = allpix::add_file_extension(trace_file_, "json");
+        auto trace_buffer_size = global_config.get<size_t>("trace_buffer_size", 65536);
+        if(trace_buffer_size == 0) {
+            throw InvalidValueError(global_config, "trace_buffer_size", "buffer size should be larger than zero");
+        }
+        EventTracer::enable(trace_buffer_size);
+        LOG(DEBUG) << "Writing trace of the module execution to " << trace_file_;
+    }
 
-                if(lib != nullptr) {
-                    Dl_info dl_info;
-                    dl_info.dli_fname = "";
+    // Write the metrics of the run periodically if requested
+    if(global_config.has("metrics_file")) {
+        metrics_file_ = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("metrics_file");
+        metrics_file_ = allpix::add_file_extension(metrics_file_, "prom");
+        metrics_interval_ = std::chrono::duration<double>(
+            Units::convert(global_config.get<double>("metrics_interval", Units::get(10.0, "s")), "s"));
+        if(metrics_interval_.count() <= 0) {
+            throw InvalidValueError(global_config, "metrics_interval", "interval should be larger than zero");
+        }
+        LOG(DEBUG) << "Writing metrics of the run every " << metrics_interval_.count() << " seconds to " << metrics_file_;
+    }
 
-                    // workaround to get the location of the library
-                    int ret = dladdr(dlsym(lib, ALLPIX_UNIQUE_FUNCTION), &dl_info);
-                    if(ret != 0) {
-                        LOG(DEBUG) << "Found library during global search in runtime paths at " << dl_info.dli_fname;
-                    } else {
-                        LOG(WARNING)
-                            << "Found library during global search but could not deduce location, likely broken library";
-                    }
-                } else {
-                    load_error = true;
-                }
-            }
+    // Write checkpoints of the run if requested and resume from the last one if available
+    checkpoint_interval_ = global_config.get<unsigned int>("checkpoint_interval", 0u);
+    checkpoint_file_ = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("checkpoint_file", "checkpoint");
+    checkpoint_file_ = allpix::add_file_extension(checkpoint_file_, "root");
+    if(global_config.get<bool>("resume", false)) {
+        if(allpix::path_is_file(checkpoint_file_)) {
+            LOG(STATUS) << "Resuming run from checkpoint " << checkpoint_file_;
+            resume_ = true;
         } else {
-            // Otherwise just fetch it from the cache
-            lib = loaded_libraries_[lib_name];
-        }
-
-        // If library did not load then throw exception
-        if(load_error) {
-            const char* lib_error = dlerror();
-
-            // Find the name of the loaded library if it exists
-            std::string lib_error_str = lib_error;
-            size_t end_pos = lib_error_str.find(':');
-            std::string problem_lib;
-            if(end_pos != std::string::npos) {
-                problem_lib = lib_error_str.substr(0, end_pos);
-            }
-
-            // FIXME is checking the error in this way portable?
-            if(lib_error != nullptr && std::strstr(lib_error, "cannot allocate memory in static TLS block") != nullptr) {
-                LOG(ERROR) << "Library could not be loaded: not enough thread local storage available" << std::endl
-                           << "Try one of below workarounds:" << std::endl
-                           << "- Rerun library with the environmental variable LD_PRELOAD='" << problem_lib << "'"
-                           << std::endl
-                           << "- Recompile the library " << problem_lib << " with tls-model=global-dynamic";
-            } else if(lib_error != nullptr && std::strstr(lib_error, "cannot open shared object file") != nullptr &&
-                      problem_lib.find(ALLPIX_MODULE_PREFIX) == std::string::npos) {
-                LOG(ERROR) << "Library could not be loaded: one of its dependencies is missing" << std::endl
-                           << "The name of the missing library is " << problem_lib << std::endl
-                           << "Please make sure the library is properly initialized and try again";
-            } else {
-                LOG(ERROR) << "Library could not be loaded: it is not available" << std::endl
-                           << " - Did you enable the library during building? " << std::endl
-                           << " - Did you spell the library name correctly (case-sensitive)? ";
-                if(lib_error != nullptr) {
-                    LOG(DEBUG) << "Detailed error: " << lib_error;
-                }
-            }
+            LOG(WARNING) << "No checkpoint found at " << checkpoint_file_ << ", starting the run from the beginning";
+        }
+    }
+    if(checkpoint_interval_ > 0) {
+        LOG(DEBUG) << "Writing checkpoints every " << checkpoint_interval_ << " events to " << checkpoint_file_;
+    }
+
+    // Check if the history of the objects is required by any consumer
+    object_history_ = global_config.get<bool>("object_history", true);
+    if(!object_history_) {
+        LOG(STATUS) << "Object history disabled, objects are not linked to the objects they originate from";
+    }
+
+    modules_file_->cd();
+
+    // Construct and initialize the detector instances of modules allowing it on several threads if multithreading is enabled
+    if(global_config.get<bool>("experimental_multithreading", false)) {
+        startup_threads_ =
+            std::max(global_config.get<unsigned int>("workers", std::max(std::thread::hardware_concurrency(), 1u)), 1u);
+    }
 
-            throw allpix::DynamicLibraryError(config.getName());
+    // Load the libraries of all modules first, such that missing libraries are reported before constructing any module
+    for(auto& config : configs) {
+        LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loading module " << config.getName();
+        if(static_modules().count(config.getName()) == 0) {
+            load_library(global_config, config.getName());
         }
-        // Remember that this library was loaded
-        loaded_libraries_[lib_name] = lib;
+    }
 
+    // Loop through all non-global configurations
+    for(auto& config : configs) {
         // Check if this module is produced once, or once per detector
         bool unique = true;
-        void* uniqueFunction = dlsym(loaded_libraries_[lib_name], ALLPIX_UNIQUE_FUNCTION);
-
-        // If the unique function was not found, throw an error
-        if(uniqueFunction == nullptr) {
-            LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
-            throw allpix::DynamicLibraryError(config.getName());
+        void* generator = nullptr;
+
+        // Use the modules built into the executable before loading their libraries
+        auto static_module = static_modules().find(config.getName());
+        if(static_module != static_modules().end()) {
+            LOG(DEBUG) << "Using module " << config.getName() << " built into the executable";
+            unique = static_module->second.unique;
+            generator = static_module->second.generator;
         } else {
-            unique = reinterpret_cast<bool (*)()>(uniqueFunction)(); // NOLINT
+            void* library = load_library(global_config, config.getName());
+            void* uniqueFunction = dlsym(library, ALLPIX_UNIQUE_FUNCTION);
+
+            // If the unique function was not found, throw an error
+            if(uniqueFunction == nullptr) {
+                LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
+                throw allpix::DynamicLibraryError(config.getName());
+            } else {
+                unique = reinterpret_cast<bool (*)()>(uniqueFunction)(); // NOLINT
+            }
+
+            // Get the generator function for this module
+            generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
+            // If the generator function was not found, throw an error
+            if(generator == nullptr) {
+                LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
+                throw allpix::DynamicLibraryError(config.getName());
+            }
         }
 
         // Add the global internal parameters to the configuration
@@ -194,10 +223,9 @@ void ModuleManager::load(Messenger* messenger,
         // Create the modules from the library depending on the module type
         std::vector<std::pair<ModuleIdentifier, Module*>> mod_list;
         if(unique) {
-            mod_list.emplace_back(
-                create_unique_modules(loaded_libraries_[lib_name], config, messenger, geo_manager, seeder));
+            mod_list.emplace_back(create_unique_modules(generator, config, messenger, geo_manager, seeder));
         } else {
-            mod_list = create_detector_modules(loaded_libraries_[lib_name], config, messenger, geo_manager, seeder);
+            mod_list = create_detector_modules(generator, config, messenger, geo_manager, seeder);
         }
 
         // Loop through all created instantiations
@@ -216,6 +244,10 @@ void ModuleManager::load(Messenger* messenger,
                                << " with instance with higher priority.";
 
                     module_execution_time_.erase(iter->second->get());
+                    constructor_keys_.erase(iter->second->get());
+                    if(profiler_) {
+                        profiler_->remove(iter->second->get());
+                    }
                     iter->second = modules_.erase(iter->second);
                     iter = id_to_module_.erase(iter);
                 } else {
@@ -237,13 +269,218 @@ void ModuleManager::load(Messenger* messenger,
         }
     }
     LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loaded " << configs.size() << " modules";
+
+    // Run the event loop for several values of a module parameter if requested, keeping all other modules initialized
+    if(global_config.has("parameter_sweep")) {
+        sweep_name_ = global_config.get<std::string>("parameter_sweep");
+        auto separator = sweep_name_.rfind('.');
+        if(separator == std::string::npos || separator == 0 || separator + 1 == sweep_name_.size()) {
+            throw InvalidValueError(global_config, "parameter_sweep", "expected parameter given as <module>.<parameter>");
+        }
+        auto module_name = sweep_name_.substr(0, separator);
+        sweep_key_ = sweep_name_.substr(separator + 1);
+        sweep_values_ = global_config.getArray<std::string>("parameter_sweep_values");
+        if(sweep_values_.empty()) {
+            throw InvalidValueError(global_config, "parameter_sweep_values", "at least one value has to be given");
+        }
+        if(checkpoint_interval_ > 0 || resume_) {
+            throw InvalidValueError(
+                global_config, "parameter_sweep", "parameter sweeps cannot be combined with checkpoints");
+        }
+
+        for(auto& module : modules_) {
+            if(module->get_configuration().getName() == module_name) {
+                sweep_modules_.push_back(module.get());
+            }
+        }
+        if(sweep_modules_.empty()) {
+            throw InvalidValueError(global_config, "parameter_sweep", "module " + module_name + " is not configured");
+        }
+        for(auto* module : sweep_modules_) {
+            if(constructor_keys_[module].count(sweep_key_) != 0) {
+                throw InvalidValueError(global_config,
+                                        "parameter_sweep",
+                                        "parameter is read when constructing " + module->get_identifier().getUniqueName() +
+                                            " and cannot be changed by initializing it again");
+            }
+        }
+
+        // Apply the first value before the modules are initialized
+        apply_sweep_point(0);
+        LOG(STATUS) << "Sweeping " << sweep_name_ << " over " << sweep_values_.size() << " values";
+    }
+
+    // Draw the base seed for the events after all module seeds
+    event_seed_ = seeder();
+
+    // Seed the random generators of all modules for every event, such that any event can be simulated on its own
+    event_seeding_ = global_config.get<bool>("event_seeding", false);
+    bool checkpointing = (checkpoint_interval_ > 0 || global_config.get<bool>("resume", false));
+    if(checkpointing) {
+        // Checkpoints do not contain the state of external random engines such as the one of Geant4, a resumed run only
+        // continues the random sequence of the full run if every event is seeded on its own
+        if(!event_seeding_) {
+            LOG(INFO) << "Enabling event seeding, as checkpoints cannot store the random engines of all modules";
+            event_seeding_ = true;
+        }
+
+        // Histograms of the modules are not stored in the checkpoint and would only cover the events after it
+        for(auto& module : modules_) {
+            auto& config = module->get_configuration();
+            if(config.get<bool>("output_plots", false)) {
+                throw InvalidValueError(
+                    config, "output_plots", "output plots are not stored in checkpoints and cannot be used when resuming");
+            }
+        }
+    }
+    if(event_seeding_) {
+        LOG(STATUS) << "Seeding the random generators of all modules for every event";
+    }
+    auto skip_events = global_config.get<unsigned int>("skip_events", 0u);
+    if(skip_events > 0) {
+        if(resume_ || !sweep_values_.empty()) {
+            throw InvalidCombinationError(global_config,
+                                          {"skip_events", "resume", "parameter_sweep"},
+                                          "events cannot be skipped when resuming a run or sweeping a parameter");
+        }
+        if(skip_events >= global_config.get<unsigned int>("number_of_events", 1u)) {
+            throw InvalidValueError(global_config, "skip_events", "all events of the run would be skipped");
+        }
+        if(!event_seeding_) {
+            LOG(WARNING) << "Skipping events without event seeding, the following events differ from the full run";
+        }
+        LOG(STATUS) << "Skipping the first " << skip_events << " events";
+        first_event_ = skip_events;
+    }
+}
+
+/**
+ * The module is identified by the name of its configuration and is not seeded, it should not draw random numbers.
+ */
+void ModuleManager::addModule(std::unique_ptr<Module> module) {
+    ModuleIdentifier identifier(module->get_configuration().getName(), "", 0);
+    if(id_to_module_.find(identifier) != id_to_module_.end()) {
+        throw AmbiguousInstantiationError(identifier.getName());
+    }
+    module->set_identifier(identifier);
+    modules_.emplace_front(std::move(module));
+    id_to_module_[identifier] = modules_.begin();
+}
+
+void ModuleManager::registerStaticModule(const std::string& name, bool unique, void* generator) {
+    static_modules()[name] = {unique, generator};
+}
+
+/**
+ * The registry is constructed on first use, such that modules can register themselves during the static initialization.
+ */
+std::map<std::string, ModuleManager::StaticModule>& ModuleManager::static_modules() {
+    static std::map<std::string, StaticModule> modules;
+    return modules;
+}
+
+/**
+ * Libraries are named libAllpixModule followed by the name of the module, by convention of the build system. They are first
+ * searched for in the configured library directories and then in the standard runtime paths.
+ */
+void* ModuleManager::load_library(const Configuration& global_config, const std::string& module_name) {
+    std::string lib_name = std::string(ALLPIX_MODULE_PREFIX).append(module_name).append(SHARED_LIBRARY_SUFFIX);
+
+    void* lib = nullptr;
+    bool load_error = false;
+    dlerror();
+    if(loaded_libraries_.count(lib_name) == 0) {
+        // If library is not loaded then try to load it first from the config directories
+        if(global_config.has("library_directories")) {
+            std::vector<std::string> lib_paths = global_config.getPathArray("library_directories", true);
+            for(auto& lib_path : lib_paths) {
+                std::string full_lib_path = lib_path;
+                full_lib_path += "/";
+                full_lib_path += lib_name;
+
+                // Check if the absolute file exists and try to load if it exists
+                std::ifstream check_file(full_lib_path);
+                if(check_file.good()) {
+                    lib = dlopen(full_lib_path.c_str(), RTLD_NOW);
+                    if(lib != nullptr) {
+                        LOG(DEBUG) << "Found library in configuration specified directory at " << full_lib_path;
+                    } else {
+                        load_error = true;
+                    }
+                    break;
+                }
+            }
+        }
+
+        // Otherwise try to load from the standard paths if not found already
+        if(!load_error && lib == nullptr) {
+            lib = dlopen(lib_name.c_str(), RTLD_NOW);
+
+            if(lib != nullptr) {
+                Dl_info dl_info;
+                dl_info.dli_fname = "";
+
+                // workaround to get the location of the library
+                int ret = dladdr(dlsym(lib, ALLPIX_UNIQUE_FUNCTION), &dl_info);
+                if(ret != 0) {
+                    LOG(DEBUG) << "Found library during global search in runtime paths at " << dl_info.dli_fname;
+                } else {
+                    LOG(WARNING)
+                        << "Found library during global search but could not deduce location, likely broken library";
+                }
+            } else {
+                load_error = true;
+            }
+        }
+    } else {
+        // Otherwise just fetch it from the cache
+        lib = loaded_libraries_[lib_name];
+    }
+
+    // If library did not load then throw exception
+    if(load_error) {
+        const char* lib_error = dlerror();
+
+        // Find the name of the loaded library if it exists
+        std::string lib_error_str = lib_error;
+        size_t end_pos = lib_error_str.find(':');
+        std::string problem_lib;
+        if(end_pos != std::string::npos) {
+            problem_lib = lib_error_str.substr(0, end_pos);
+        }
+
+        // FIXME is checking the error in this way portable?
+        if(lib_error != nullptr && std::strstr(lib_error, "cannot allocate memory in static TLS block") != nullptr) {
+            LOG(ERROR) << "Library could not be loaded: not enough thread local storage available" << std::endl
+                       << "Try one of below workarounds:" << std::endl
+                       << "- Rerun library with the environmental variable LD_PRELOAD='" << problem_lib << "'" << std::endl
+                       << "- Recompile the library " << problem_lib << " with tls-model=global-dynamic";
+        } else if(lib_error != nullptr && std::strstr(lib_error, "cannot open shared object file") != nullptr &&
+                  problem_lib.find(ALLPIX_MODULE_PREFIX) == std::string::npos) {
+            LOG(ERROR) << "Library could not be loaded: one of its dependencies is missing" << std::endl
+                       << "The name of the missing library is " << problem_lib << std::endl
+                       << "Please make sure the library is properly initialized and try again";
+        } else {
+            LOG(ERROR) << "Library could not be loaded: it is not available" << std::endl
+                       << " - Did you enable the library during building? " << std::endl
+                       << " - Did you spell the library name correctly (case-sensitive)? ";
+            if(lib_error != nullptr) {
+                LOG(DEBUG) << "Detailed error: " << lib_error;
+            }
+        }
+
+        throw allpix::DynamicLibraryError(module_name);
+    }
+    // Remember that this library was loaded
+    loaded_libraries_[lib_name] = lib;
+    return lib;
 }
 
 /**
  * For unique modules a single instance is created per section
  */
 std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
-    void* library, Configuration& config, Messenger* messenger, GeometryManager* geo_manager, std::mt19937_64& seeder) {
+    void* generator, Configuration& config, Messenger* messenger, GeometryManager* geo_manager, std::mt19937_64& seeder) {
     // Make the vector to return
     std::string module_name = config.getName();
 
@@ -268,14 +505,6 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
     }
     ModuleIdentifier identifier(module_name, identifier_str, 0);
 
-    // Get the generator function for this module
-    void* generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
-    // If the generator function was not found, throw an error
-    if(generator == nullptr) {
-        LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
-        throw allpix::DynamicLibraryError(module_name);
-    }
-
     // Create and add module instance config
     Configuration& instance_config = conf_manager_->addInstanceConfiguration(identifier, config);
 
@@ -295,6 +524,7 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
 
     // Get current time
     auto start = std::chrono::steady_clock::now();
+    auto sample = (profiler_ ? profiler_->start() : ModuleProfiler::Sample());
     // Set the log section header
     std::string old_section_name = Log::getSection();
     std::string section_name = "C:";
@@ -302,14 +532,19 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
     Log::setSection(section_name);
     // Set module specific log settings
     auto old_settings = set_module_before(identifier.getUniqueName(), instance_config);
+    auto framework_keys = instance_config.getParsedKeys();
     // Build module
     Module* module = module_generator(instance_config, messenger, geo_manager);
+    record_constructor_keys(module, framework_keys);
     // Reset log
     Log::setSection(old_section_name);
     set_module_after(old_settings);
     // Update execution time
     auto end = std::chrono::steady_clock::now();
     module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+    if(profiler_) {
+        profiler_->stop(module, ModuleProfiler::Stage::CONSTRUCTION, sample);
+    }
 
     // Set the module directory afterwards to catch invalid access in constructor
     module->get_configuration().set<std::string>("_output_dir", output_dir);
@@ -325,7 +560,7 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
  * no selection parameters are provided. Otherwise instantiations are created for every linked detector name and type.
  */
 std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector_modules(
-    void* library, Configuration& config, Messenger* messenger, GeometryManager* geo_manager, std::mt19937_64& seeder) {
+    void* generator, Configuration& config, Messenger* messenger, GeometryManager* geo_manager, std::mt19937_64& seeder) {
     std::string module_name = config.getName();
     LOG(DEBUG) << "Creating instantions for detector module " << module_name;
 
@@ -340,13 +575,6 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         identifier += config.get<std::string>("output");
     }
 
-    // Open the library and get the module generator function
-    void* generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
-    // If the generator function was not found, throw an error
-    if(generator == nullptr) {
-        LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
-        throw allpix::DynamicLibraryError(module_name);
-    }
     // Convert to correct generator function
     auto module_generator =
         reinterpret_cast<Module* (*)(Configuration&, Messenger*, std::shared_ptr<Detector>)>(generator); // NOLINT
@@ -396,13 +624,10 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         }
     }
 
-    // Construct instantiations from the list of requests
-    std::vector<std::pair<ModuleIdentifier, Module*>> module_list;
+    // Create the instance configurations first, such that the seeds do not depend on the order of construction
+    std::vector<std::string> output_dirs;
+    std::vector<Configuration*> instance_configs;
     for(auto& instance : instantiations) {
-        LOG(DEBUG) << "Creating detector instantiation " << instance.second.getUniqueName();
-        // Get current time
-        auto start = std::chrono::steady_clock::now();
-
         // Create and add module instance config
         Configuration& instance_config = conf_manager_->addInstanceConfiguration(instance.second, config);
 
@@ -415,24 +640,68 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         std::replace(path_mod_name.begin(), path_mod_name.end(), ':', '/');
         output_dir += path_mod_name;
 
+        instance_configs.push_back(&instance_config);
+        output_dirs.push_back(std::move(output_dir));
+    }
+
+    // Construct a single instantiation, only accessing state of the module manager which is safe to use concurrently
+    std::vector<std::unique_ptr<Module>> modules(instantiations.size());
+    std::vector<long double> construction_times(instantiations.size());
+    std::vector<std::set<std::string>> framework_keys(instantiations.size());
+    auto construct = [&](size_t index) {
+        auto& instance = instantiations[index];
+        LOG(DEBUG) << "Creating detector instantiation " << instance.second.getUniqueName();
+        // Get current time
+        auto start = std::chrono::steady_clock::now();
+        auto sample = (profiler_ ? profiler_->start() : ModuleProfiler::Sample());
+
         // Set the log section header
         std::string old_section_name = Log::getSection();
         std::string section_name = "C:";
         section_name += instance.second.getUniqueName();
         Log::setSection(section_name);
         // Set module specific log settings
-        auto old_settings = set_module_before(instance.second.getUniqueName(), instance_config);
+        auto old_settings = set_module_before(instance.second.getUniqueName(), *instance_configs[index]);
+        framework_keys[index] = instance_configs[index]->getParsedKeys();
         // Build module
-        Module* module = module_generator(instance_config, messenger, instance.first);
+        modules[index].reset(module_generator(*instance_configs[index], messenger, instance.first));
         // Reset logging
         Log::setSection(old_section_name);
         set_module_after(old_settings);
         // Update execution time
         auto end = std::chrono::steady_clock::now();
-        module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+        construction_times[index] = static_cast<std::chrono::duration<long double>>(end - start).count();
+        if(profiler_) {
+            profiler_->stop(modules[index].get(), ModuleProfiler::Stage::CONSTRUCTION, sample);
+        }
+    };
+
+    // Construct the first instantiation, and all others concurrently if the module allows multithreading. The constructors
+    // of modules allowing multithreading are expected not to modify any state shared between the instantiations.
+    if(!instantiations.empty()) {
+        construct(0);
+    }
+    size_t threads_num =
+        (instantiations.size() > 1 ? std::min<size_t>(startup_threads_, instantiations.size() - 1) : 0);
+    if(threads_num > 1 && modules.front()->canParallelize()) {
+        LOG(DEBUG) << "Creating remaining instantiations of " << module_name << " on " << threads_num << " threads";
+        run_concurrently(instantiations.size() - 1, [&](size_t index) { construct(index + 1); });
+    } else {
+        for(size_t index = 1; index < instantiations.size(); ++index) {
+            construct(index);
+        }
+    }
+
+    // Check the constructed instantiations in the order of the requests
+    std::vector<std::pair<ModuleIdentifier, Module*>> module_list;
+    for(size_t index = 0; index < instantiations.size(); ++index) {
+        auto& instance = instantiations[index];
+        auto& module = modules[index];
+        module_execution_time_[module.get()] += construction_times[index];
+        record_constructor_keys(module.get(), framework_keys[index]);
 
         // Set the module directory afterwards to catch invalid access in constructor
-        module->get_configuration().set<std::string>("_output_dir", output_dir);
+        module->get_configuration().set<std::string>("_output_dir", output_dirs[index]);
 
         // Check if the module called the correct base class constructor
         if(module->getDetector().get() != instance.first.get()) {
@@ -440,48 +709,60 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
                 "Module " + module_name +
                 " does not call the correct base Module constructor: the provided detector should be forwarded");
         }
+    }
 
-        // Store the module
-        module_list.emplace_back(instance.second, module);
+    // Store the modules
+    for(size_t index = 0; index < instantiations.size(); ++index) {
+        module_list.emplace_back(instantiations[index].second, modules[index].release());
     }
 
     return module_list;
 }
 
 // Helper functions to set the module specific log settings if necessary
-std::tuple<LogLevel, LogFormat> ModuleManager::set_module_before(const std::string&, const Configuration& config) {
-    // Set new log level if necessary
-    LogLevel prev_level = Log::getReportingLevel();
+std::pair<std::optional<LogLevel>, std::optional<LogFormat>>
+ModuleManager::get_module_log_settings(const Configuration& config) {
+    std::optional<LogLevel> log_level;
     if(config.has("log_level")) {
         auto log_level_string = config.get<std::string>("log_level");
         std::transform(log_level_string.begin(), log_level_string.end(), log_level_string.begin(), ::toupper);
         try {
-            LogLevel log_level = Log::getLevelFromString(log_level_string);
-            if(log_level != prev_level) {
-                LOG(TRACE) << "Local log level is set to " << log_level_string;
-                Log::setReportingLevel(log_level);
-            }
+            log_level = Log::getLevelFromString(log_level_string);
         } catch(std::invalid_argument& e) {
             throw InvalidValueError(config, "log_level", e.what());
         }
     }
 
-    // Set new log format if necessary
-    LogFormat prev_format = Log::getFormat();
+    std::optional<LogFormat> log_format;
     if(config.has("log_format")) {
         auto log_format_string = config.get<std::string>("log_format");
         std::transform(log_format_string.begin(), log_format_string.end(), log_format_string.begin(), ::toupper);
         try {
-            LogFormat log_format = Log::getFormatFromString(log_format_string);
-            if(log_format != prev_format) {
-                LOG(TRACE) << "Local log format is set to " << log_format_string;
-                Log::setFormat(log_format);
-            }
+            log_format = Log::getFormatFromString(log_format_string);
         } catch(std::invalid_argument& e) {
             throw InvalidValueError(config, "log_format", e.what());
         }
     }
 
+    return {log_level, log_format};
+}
+std::tuple<LogLevel, LogFormat> ModuleManager::set_module_before(const std::string&, const Configuration& config) {
+    auto [log_level, log_format] = get_module_log_settings(config);
+
+    // Set new log level if necessary
+    LogLevel prev_level = Log::getReportingLevel();
+    if(log_level.has_value() && log_level.value() != prev_level) {
+        LOG(TRACE) << "Local log level is set to " << Log::getStringFromLevel(log_level.value());
+        Log::setReportingLevel(log_level.value());
+    }
+
+    // Set new log format if necessary
+    LogFormat prev_format = Log::getFormat();
+    if(log_format.has_value() && log_format.value() != prev_format) {
+        LOG(TRACE) << "Local log format is set to " << Log::getStringFromFormat(log_format.value());
+        Log::setFormat(log_format.value());
+    }
+
     return std::make_tuple(prev_level, prev_format);
 }
 void ModuleManager::set_module_after(std::tuple<LogLevel, LogFormat> prev) {
@@ -509,180 +790,556 @@ void ModuleManager::set_module_after(std::tuple<LogLevel, LogFormat> prev) {
 void ModuleManager::init() {
     auto start_time = std::chrono::steady_clock::now();
     LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initializing " << modules_.size() << " module instantiations";
-    for(auto& module : modules_) {
-        LOG_PROGRESS(TRACE, "INIT_LOOP") << "Initializing " << module->get_identifier().getUniqueName();
-
-        // Pass the config manager to this instance
-        module->set_config_manager(conf_manager_);
-
-        // Create main ROOT directory for this module class if it does not exists yet
-        LOG(TRACE) << "Creating and accessing ROOT directory";
-        std::string module_name = module->get_configuration().getName();
-        auto directory = modules_file_->GetDirectory(module_name.c_str());
-        if(directory == nullptr) {
-            directory = modules_file_->mkdir(module_name.c_str());
-            if(directory == nullptr) {
-                throw RuntimeError("Cannot create or access overall ROOT directory for module " + module_name);
-            }
+    for(auto iter = modules_.begin(); iter != modules_.end();) {
+        // Collect the following instantiations of the same module which can be initialized at the same time
+        std::vector<Module*> modules;
+        auto module_name = (*iter)->get_configuration().getName();
+        do {
+            modules.push_back(iter->get());
+            ++iter;
+        } while(startup_threads_ > 1 && modules.front()->canParallelizeInit() && iter != modules_.end() &&
+                (*iter)->get_configuration().getName() == module_name && (*iter)->canParallelizeInit());
+
+        // Prepare the instantiations in their order, as the directories in the main ROOT file are shared
+        for(auto* module : modules) {
+            LOG_PROGRESS(TRACE, "INIT_LOOP") << "Initializing " << module->get_identifier().getUniqueName();
+            prepare_init(module);
         }
-        directory->cd();
 
-        // Create local directory for this instance
-        TDirectory* local_directory = nullptr;
-        if(module->get_identifier().getIdentifier().empty()) {
-            local_directory = directory;
+        std::vector<long double> init_times(modules.size());
+        if(modules.size() > 1) {
+            LOG(DEBUG) << "Initializing " << modules.size() << " instantiations of " << module_name << " on "
+                       << std::min<size_t>(startup_threads_, modules.size()) << " threads";
+            run_concurrently(modules.size(), [&](size_t index) { init_times[index] = init_module(modules[index]); });
         } else {
-            local_directory = directory->mkdir(module->get_identifier().getIdentifier().c_str());
-            if(local_directory == nullptr) {
-                throw RuntimeError("Cannot create or access local ROOT directory for module " + module->getUniqueName());
-            }
+            init_times.front() = init_module(modules.front());
+        }
+        for(size_t index = 0; index < modules.size(); ++index) {
+            module_execution_time_[modules[index]] += init_times[index];
+            prepare_run_context(modules[index]);
         }
-
-        // Change to the directory and save it in the module
-        local_directory->cd();
-        module->set_ROOT_directory(local_directory);
-
-        // Get current time
-        auto start = std::chrono::steady_clock::now();
-        // Set init module section header
-        std::string old_section_name = Log::getSection();
-        std::string section_name = "I:";
-        section_name += module->get_identifier().getUniqueName();
-        Log::setSection(section_name);
-        // Set module specific settings
-        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
-        // Change to our ROOT directory
-        module->getROOTDirectory()->cd();
-        // Init module
-        module->init();
-        // Reset delegates
-        LOG(TRACE) << "Resetting messages";
-        module->reset_delegates();
-        // Reset logging
-        Log::setSection(old_section_name);
-        set_module_after(old_settings);
-        // Update execution time
-        auto end = std::chrono::steady_clock::now();
-        module_execution_time_[module.get()] += static_cast<std::chrono::duration<long double>>(end - start).count();
     }
     LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initialized " << modules_.size() << " module instantiations";
+    // Objects created while running without explicit directory do not end up in the directory of the last module
+    modules_file_->cd();
+
+    // Restore the state of the modules after initializing all of them
+    if(resume_) {
+        read_checkpoint();
+    }
     auto end_time = std::chrono::steady_clock::now();
     total_time_ += static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
 }
 
 /**
- * Initializes the thread pool for executing multiple modules and module tasks in parallel. The run for a module is skipped
- * if its delegates are not \ref Module::check_delegates() "satisfied". Sets the section header and logging settings before
- * executing the \ref Module::run() function. \ref Module::reset_delegates() "Resets" the delegates and the logging after
- * initialization
+ * Passes the framework state to the module and creates the ROOT directory of the instantiation in the main ROOT file
  */
-void ModuleManager::run() {
-    Configuration& global_config = conf_manager_->getGlobalConfiguration();
-
-    global_config.setDefault("experimental_multithreading", false);
-    unsigned int threads_num;
-
-    if(global_config.get<bool>("experimental_multithreading")) {
-        // Try to fetch a suitable number of workers if multithreading is enabled
-        threads_num = global_config.get<unsigned int>("workers", std::max(std::thread::hardware_concurrency(), 1u));
-        if(threads_num == 0) {
-            throw InvalidValueError(global_config, "workers", "number of workers should be strictly more than zero");
+void ModuleManager::prepare_init(Module* module) {
+    // Pass the config manager to this instance
+    module->set_config_manager(conf_manager_);
+    module->set_resuming(resume_);
+    module->set_event_seeding(event_seeding_);
+    module->set_object_history(object_history_);
+
+    // Create main ROOT directory for this module class if it does not exists yet
+    LOG(TRACE) << "Creating and accessing ROOT directory";
+    std::string module_name = module->get_configuration().getName();
+    auto directory = modules_file_->GetDirectory(module_name.c_str());
+    if(directory == nullptr) {
+        directory = modules_file_->mkdir(module_name.c_str());
+        if(directory == nullptr) {
+            throw RuntimeError("Cannot create or access overall ROOT directory for module " + module_name);
         }
-        LOG(WARNING) << "Experimental multithreading enabled - using " << threads_num << " worker threads.";
-        --threads_num;
-    } else {
-        // Default to no additional thread without multithreading
-        threads_num = 0;
     }
+    directory->cd();
 
-    // Creates the thread pool
-    LOG(DEBUG) << "Initializing thread pool with " << threads_num << " additional thread(s)";
-    std::vector<Module*> module_list;
-    for(auto& module : modules_) {
-        module_list.emplace_back(module.get());
-    }
-    auto init_function = [log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
-        // Initialize the threads to the same log level and format as the master setting
-        Log::setReportingLevel(log_level);
-        Log::setFormat(log_format);
-    };
-    std::shared_ptr<ThreadPool> thread_pool = std::make_shared<ThreadPool>(threads_num, module_list, init_function);
-    for(auto& module : modules_) {
-        module->set_thread_pool(thread_pool);
+    // Create local directory for this instance
+    TDirectory* local_directory = nullptr;
+    if(module->get_identifier().getIdentifier().empty()) {
+        local_directory = directory;
+    } else {
+        local_directory = directory->mkdir(module->get_identifier().getIdentifier().c_str());
+        if(local_directory == nullptr) {
+            throw RuntimeError("Cannot create or access local ROOT directory for module " + module->getUniqueName());
+        }
     }
 
-    // Loop over all the events
-    auto start_time = std::chrono::steady_clock::now();
-    global_config.setDefault<unsigned int>("number_of_events", 1u);
-    auto number_of_events = global_config.get<unsigned int>("number_of_events");
-    for(unsigned int i = 0; i < number_of_events; ++i) {
-        // Check for termination
-        if(terminate_) {
-            LOG(INFO) << "Interrupting event loop after " << i << " events because of request to terminate";
-            number_of_events = i;
-            global_config.set<unsigned int>("number_of_events", i);
-            break;
-        }
+    // Change to the directory and save it in the module
+    local_directory->cd();
+    module->set_ROOT_directory(local_directory);
+}
 
-        LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Running event " << (i + 1) << " of " << number_of_events;
+/**
+ * The section header and the log settings of the module are only derived once from its configuration, and the timing maps
+ * are accessed through pointers to their entries, such that running a module for an event does not allocate or look up
+ * anything besides its context.
+ */
+void ModuleManager::prepare_run_context(Module* module) {
+    auto& context = run_contexts_[module];
+    context.section = "R:" + module->get_identifier().getUniqueName();
+    std::tie(context.log_level, context.log_format) = get_module_log_settings(module->get_configuration());
+    context.execution_time = &module_execution_time_[module];
+    context.run_time = &module_run_time_[module];
+}
 
-        // Get object count for linking objects in current event
-        auto save_id = TProcessID::GetObjectCount();
+/**
+ * Sets the section header and logging settings before executing the \ref Module::init() function and \ref
+ * Module::reset_delegates() "resets" the delegates and the logging afterwards
+ */
+long double ModuleManager::init_module(Module* module) {
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    auto sample = (profiler_ ? profiler_->start() : ModuleProfiler::Sample());
+    // Set init module section header
+    std::string old_section_name = Log::getSection();
+    std::string section_name = "I:";
+    section_name += module->get_identifier().getUniqueName();
+    Log::setSection(section_name);
+    // Set module specific settings
+    auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
+    // Change to our ROOT directory
+    module->getROOTDirectory()->cd();
+    // Init module
+    module->init();
+    // Reset delegates
+    LOG(TRACE) << "Resetting messages";
+    module->reset_delegates();
+    // Reset logging
+    Log::setSection(old_section_name);
+    set_module_after(old_settings);
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    if(profiler_) {
+        profiler_->stop(module, ModuleProfiler::Stage::INITIALIZATION, sample);
+    }
+    return static_cast<std::chrono::duration<long double>>(end - start).count();
+}
 
-        std::string module_name;
-        if(!modules_.empty()) {
-            module_name = modules_.front()->get_identifier().getName();
-        }
+/**
+ * Sets the section header and logging settings before executing the \ref Module::finalize() function, after finishing the
+ * asynchronous tasks of the module, and resets the logging afterwards
+ */
+long double ModuleManager::finalize_module(Module* module) {
+    LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing " << module->get_identifier().getUniqueName();
+
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    auto sample = (profiler_ ? profiler_->start() : ModuleProfiler::Sample());
+    // Set finalize module section header
+    std::string old_section_name = Log::getSection();
+    std::string section_name = "F:";
+    section_name += module->get_identifier().getUniqueName();
+    Log::setSection(section_name);
+    // Set module specific settings
+    auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
+    // Change to our ROOT directory
+    module->getROOTDirectory()->cd();
+    // Finish all asynchronous tasks and finalize module
+    module->stop_async_tasks();
+    module->finalize();
+    // Remove the pointer to the ROOT directory after finalizing
+    module->set_ROOT_directory(nullptr);
+    // Remove the config manager
+    module->set_config_manager(nullptr);
+    // Reset logging
+    Log::setSection(old_section_name);
+    set_module_after(old_settings);
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    if(profiler_) {
+        profiler_->stop(module, ModuleProfiler::Stage::FINALIZATION, sample);
+    }
+    return static_cast<std::chrono::duration<long double>>(end - start).count();
+}
+
+/**
+ * The tasks are distributed over the threads as they become available. All threads use the log settings of the calling
+ * thread. The first exception thrown by any task is rethrown after all threads are finished.
+ */
+void ModuleManager::run_concurrently(size_t count, const std::function<void(size_t)>& task) {
+    std::atomic<size_t> next_index{0};
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < std::min<size_t>(startup_threads_, count); ++i) {
+        threads.emplace_back([&, log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
+            // Set the log level and format of the calling thread
+            Log::setReportingLevel(log_level);
+            Log::setFormat(log_format);
+
+            for(auto index = next_index++; index < count; index = next_index++) {
+                try {
+                    task(index);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    if(!exception) {
+                        exception = std::current_exception();
+                    }
+                }
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    if(exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ModuleManager::record_constructor_keys(Module* module, const std::set<std::string>& framework_keys) {
+    auto& keys = constructor_keys_[module];
+    keys.clear();
+    for(auto& key : module->get_configuration().getParsedKeys()) {
+        if(framework_keys.count(key) == 0) {
+            keys.insert(key);
+        }
+    }
+}
+
+/**
+ * The value is set in the configuration of all instantiations of the swept module, the instantiations are only reported as
+ * changed if their configuration differs from the one of the previous point.
+ */
+std::vector<Module*> ModuleManager::apply_sweep_point(size_t point) {
+    std::vector<Module*> changed_modules;
+    for(auto* module : sweep_modules_) {
+        auto& config = module->get_configuration();
+        auto hash = config.getHash();
+        config.setText(sweep_key_, sweep_values_.at(point));
+        if(config.getHash() != hash) {
+            changed_modules.push_back(module);
+        }
+    }
+    return changed_modules;
+}
+
+/**
+ * Without a parameter sweep, the event loop is executed once for the configured number of events. With a sweep, the event
+ * loop is executed once for every value of the swept parameter with the configured number of events each. Only the
+ * instantiations of the swept module whose configuration changed are initialized again before every point, all other
+ * modules keep their state such as the geometry and the physics tables. The events of all points are numbered
+ * consecutively, such that every event has a unique number and random seed.
+ */
+void ModuleManager::run() {
+    if(sweep_values_.empty()) {
+        run_events();
+        return;
+    }
+
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+    global_config.setDefault<unsigned int>("number_of_events", 1u);
+    auto events_per_point = global_config.get<unsigned int>("number_of_events");
+    unsigned int events_run = 0;
+    for(size_t point = 0; point < sweep_values_.size() && !terminate_; ++point) {
+        if(point > 0) {
+            for(auto* module : apply_sweep_point(point)) {
+                LOG(DEBUG) << "Reinitializing " << module->get_identifier().getUniqueName();
+                module_execution_time_[module] += init_module(module);
+                prepare_run_context(module);
+            }
+            modules_file_->cd();
+        }
+
+        LOG(STATUS) << "Running sweep point " << (point + 1) << " of " << sweep_values_.size() << " with " << sweep_name_
+                    << " = " << sweep_values_[point];
+        first_event_ = events_run;
+        global_config.set<unsigned int>("number_of_events", events_run + events_per_point);
+        run_events();
+        events_run = global_config.get<unsigned int>("number_of_events");
+    }
+
+    // Report the run as a whole to the modules and in the summary
+    first_event_ = 0;
+    global_config.set<unsigned int>("number_of_events", events_run);
+}
+
+/**
+ * The parameters are applied to all instantiations of the module in the same way as the values of a parameter sweep. With
+ * a seed, the event seeds of the job are derived from it and from the number of the event within the job, such that a job
+ * with the same seed reproduces the same event seeds. Random generators of the modules not seeded per event continue their
+ * sequence from the previous job.
+ */
+unsigned int ModuleManager::runJob(unsigned int number_of_events,
+                                   std::optional<uint64_t> seed,
+                                   const std::vector<std::pair<std::string, std::string>>& parameters) {
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+
+    // Check all parameters of the job before changing any configuration
+    std::vector<std::tuple<std::string, std::string, std::string>> job_parameters;
+    for(const auto& [parameter, value] : parameters) {
+        auto separator = parameter.rfind('.');
+        if(separator == std::string::npos || separator == 0 || separator + 1 == parameter.size()) {
+            throw InvalidJobError("Job parameter '" + parameter + "' is not given as <module>.<parameter>");
+        }
+        auto module_name = parameter.substr(0, separator);
+        if(std::none_of(modules_.begin(), modules_.end(), [&](const auto& module) {
+               return module->get_configuration().getName() == module_name;
+           })) {
+            throw InvalidJobError("Job parameter '" + parameter + "' refers to module " + module_name +
+                                  ", which is not configured");
+        }
+        for(auto& module : modules_) {
+            if(module->get_configuration().getName() == module_name &&
+               constructor_keys_[module.get()].count(parameter.substr(separator + 1)) != 0) {
+                throw InvalidJobError("Job parameter '" + parameter + "' is read when constructing " +
+                                      module->get_identifier().getUniqueName() +
+                                      " and cannot be changed by initializing it again");
+            }
+        }
+        job_parameters.emplace_back(module_name, parameter.substr(separator + 1), value);
+    }
+
+    // Apply the parameters to all instantiations of their module and initialize the changed instantiations again
+    std::set<Module*> changed_modules;
+    for(const auto& [module_name, key, value] : job_parameters) {
+        for(auto& module : modules_) {
+            auto& config = module->get_configuration();
+            if(config.getName() != module_name) {
+                continue;
+            }
+            auto hash = config.getHash();
+            config.setText(key, value);
+            if(config.getHash() != hash) {
+                changed_modules.insert(module.get());
+            }
+        }
+    }
+    for(auto& module : modules_) {
+        if(changed_modules.count(module.get()) != 0) {
+            LOG(DEBUG) << "Reinitializing " << module->get_identifier().getUniqueName();
+            module_execution_time_[module.get()] += init_module(module.get());
+            prepare_run_context(module.get());
+        }
+    }
+    modules_file_->cd();
+
+    if(seed.has_value()) {
+        event_seed_ = seed.value();
+        job_seed_offset_ = job_events_;
+    }
+
+    first_event_ = job_events_;
+    global_config.set<unsigned int>("number_of_events", job_events_ + number_of_events);
+    run_events();
+    auto events_run = global_config.get<unsigned int>("number_of_events") - job_events_;
+    job_events_ += events_run;
+
+    // Report all jobs as a single run to the modules and in the summary
+    first_event_ = 0;
+    global_config.set<unsigned int>("number_of_events", job_events_);
+    return events_run;
+}
+
+/**
+ * Initializes the thread pool for executing multiple modules and module tasks in parallel. The run for a module is skipped
+ * if its delegates are not \ref Module::check_delegates() "satisfied". Sets the section header and logging settings before
+ * executing the \ref Module::run() function. \ref Module::reset_delegates() "Resets" the delegates and the logging after
+ * initialization
+ */
+void ModuleManager::run_events() {
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+
+    global_config.setDefault("experimental_multithreading", false);
+    global_config.setDefault<unsigned int>("parallel_events", 1u);
+    global_config.setDefault("dedicated_module_threads", true);
+    unsigned int threads_num;
+    unsigned int parallel_events = global_config.get<unsigned int>("parallel_events");
+    if(parallel_events == 0) {
+        throw InvalidValueError(
+            global_config, "parallel_events", "number of parallel events should be strictly more than zero");
+    }
+
+    if(global_config.get<bool>("experimental_multithreading")) {
+        // Try to fetch a suitable number of workers if multithreading is enabled
+        threads_num = global_config.get<unsigned int>("workers", std::max(std::thread::hardware_concurrency(), 1u));
+        if(threads_num == 0) {
+            throw InvalidValueError(global_config, "workers", "number of workers should be strictly more than zero");
+        }
+        LOG(WARNING) << "Experimental multithreading enabled - using " << threads_num << " worker threads.";
+        workers_ = threads_num;
+        --threads_num;
+
+        // Several events can only be processed at the same time if there are additional threads available
+        if(parallel_events > 1 && threads_num == 0) {
+            LOG(WARNING) << "Processing multiple events in parallel requires more than one worker, disabling";
+            parallel_events = 1;
+        }
+    } else {
+        // Default to no additional thread without multithreading
+        threads_num = 0;
+
+        if(parallel_events > 1) {
+            LOG(WARNING) << "Processing multiple events in parallel requires experimental multithreading, disabling";
+            parallel_events = 1;
+        }
+    }
+
+    // The main thread only executes the modules which cannot process events concurrently, use all workers for the pool
+    if(parallel_events > 1) {
+        ++threads_num;
+    }
+
+    // Creates the thread pool
+    LOG(DEBUG) << "Initializing thread pool with " << threads_num << " additional thread(s)";
+    std::vector<Module*> module_list;
+    for(auto& module : modules_) {
+        module_list.emplace_back(module.get());
+    }
+    auto init_function = [log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
+        // Initialize the threads to the same log level and format as the master setting
+        Log::setReportingLevel(log_level);
+        Log::setFormat(log_format);
+    };
+
+    // Place the workers on the processors according to the configured policy
+    std::vector<unsigned int> cpus;
+    try {
+        cpus = worker_cpus(global_config.get<std::string>("worker_affinity", "none"), threads_num);
+    } catch(std::invalid_argument& e) {
+        throw InvalidValueError(global_config, "worker_affinity", e.what());
+    }
+    if(!cpus.empty()) {
+        LOG(DEBUG) << "Pinning workers to processors on " << numa_node_count() << " memory node(s)";
+    }
+    std::shared_ptr<ThreadPool> thread_pool =
+        std::make_shared<ThreadPool>(threads_num, module_list, init_function, std::move(cpus));
+    for(auto& module : modules_) {
+        module->set_thread_pool(thread_pool);
+    }
+
+    // Loop over all the events
+    auto start_time = std::chrono::steady_clock::now();
+    metrics_start_time_ = start_time;
+    metrics_time_ = start_time;
+    global_config.setDefault<unsigned int>("number_of_events", 1u);
+    auto number_of_events = global_config.get<unsigned int>("number_of_events");
+    memory_budget_ = global_config.get<uint64_t>("memory_budget", 0);
+    event_memory_budget_ = global_config.get<uint64_t>("event_memory_budget", 0);
+    if(first_event_ > number_of_events) {
+        throw InvalidValueError(global_config,
+                                "number_of_events",
+                                "checkpoint to resume from already contains " + std::to_string(first_event_) + " events");
+    }
+    metrics_number_of_events_ = number_of_events;
+    if(parallel_events > 1) {
+        LOG(STATUS) << "Processing up to " << parallel_events << " events in parallel";
+        for(auto& module : modules_) {
+            if(module->canParallelizeEvents()) {
+                LOG(DEBUG) << "Module " << module->get_identifier().getUniqueName() << " processes events concurrently";
+                module->set_concurrent_events(true);
+            }
+        }
+
+        auto events_run = run_concurrent_events(
+            thread_pool, number_of_events, parallel_events, global_config.get<bool>("dedicated_module_threads"));
+        if(events_run < number_of_events) {
+            LOG(INFO) << "Interrupting event loop after " << events_run << " events because of request to terminate";
+            number_of_events = events_run;
+            global_config.set<unsigned int>("number_of_events", events_run);
+        }
+
+        for(auto& module : modules_) {
+            module->set_concurrent_events(false);
+        }
+    }
+    // Without concurrent events, execute the modules in the order of their dependencies if there are workers to run them
+    global_config.setDefault("dependency_scheduling", true);
+    bool dependency_scheduling =
+        (parallel_events == 1 && threads_num > 0 && global_config.get<bool>("dependency_scheduling"));
+    if(dependency_scheduling) {
+        build_module_graph(global_config.get<bool>("dedicated_module_threads"));
+    }
+    global_config.setDefault("priority_scheduling", true);
+    priority_scheduling_ = global_config.get<bool>("priority_scheduling");
+    if(priority_scheduling_ && parallel_events == 1 && threads_num > 0) {
+        LOG(DEBUG) << "Starting the modules with the longest execution time in the previous events first";
+    }
+    for(unsigned int i = first_event_; parallel_events == 1 && i < number_of_events; ++i) {
+        // Check for termination
+        if(terminate_) {
+            LOG(INFO) << "Interrupting event loop after " << i << " events because of request to terminate";
+            number_of_events = i;
+            global_config.set<unsigned int>("number_of_events", i);
+            break;
+        }
+
+        LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Running event " << (i + 1) << " of " << number_of_events;
+        run_event(thread_pool, i, number_of_events, dependency_scheduling);
+
+        // Write a checkpoint after every interval of events, the last one is written after the run
+        if(checkpoint_interval_ > 0 && (i + 1) % checkpoint_interval_ == 0 && i + 1 < number_of_events) {
+            write_checkpoint(i + 1);
+        }
+    }
+    if(checkpoint_interval_ > 0) {
+        write_checkpoint(number_of_events);
+    }
+    LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Finished run of " << number_of_events << " events";
+    LOG(INFO) << "Largest memory held by the messages of a single event: "
+              << Units::display(static_cast<double>(peak_event_memory_), {"kB", "MB", "GB"});
+    for(auto& [key, bytes] : peak_message_memory_) {
+        LOG(DEBUG) << "Largest memory of " << key.second << " from " << key.first << ": "
+                   << Units::display(static_cast<double>(bytes), {"kB", "MB", "GB"});
+    }
+    auto end_time = std::chrono::steady_clock::now();
+    auto event_loop_time = static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
+    event_loop_time_ += event_loop_time;
+    total_time_ += event_loop_time;
+
+    // Update the metrics with the final state of the event loop
+    if(!metrics_file_.empty()) {
+        write_metrics(*thread_pool);
+    }
+
+    // Remove pool from modules, wait for the threads to finish and destroy pool
+    LOG(TRACE) << "Destroying thread pool";
+    for(auto& module : modules_) {
+        module->set_thread_pool(nullptr);
+    }
+    thread_pool.reset();
+    assert(thread_pool.use_count() == 0);
+}
+
+/**
+ * Without dependency scheduling, modules which can be parallelized are submitted to the thread pool until the next module
+ * of another type or a module which cannot be parallelized is reached. The delegates of all modules are reset afterwards.
+ */
+void ModuleManager::run_event(const std::shared_ptr<ThreadPool>& thread_pool,
+                              unsigned int event_index,
+                              unsigned int number_of_events,
+                              bool dependency_scheduling) {
+    // Create the state of the current event
+    Event event(event_index + 1, Event::derive_seed(event_seed_, event_index + 1 - job_seed_offset_));
+    event.memory_budget_ = event_memory_budget_;
+    ++started_events_;
+
+    if(dependency_scheduling) {
+        run_module_graph(thread_pool, &event, number_of_events);
+    } else {
+        std::string module_name;
+        if(!modules_.empty()) {
+            module_name = modules_.front()->get_identifier().getName();
+        }
         for(auto& module : modules_) {
+            // Stop submitting modules once the event is vetoed, modules already submitted are skipped when executed
+            if(event.vetoed_) {
+                break;
+            }
+
             // Execute all remaining jobs in the thread pool when switching to a new module type
             if(module->get_identifier().getName() != module_name) {
                 module_name = module->get_identifier().getName();
                 thread_pool->execute_all();
             }
 
-            auto execute_module = [module = module.get(), event_num = i + 1, this, number_of_events]() {
-                LOG_PROGRESS(TRACE, "EVENT_LOOP") << "Running event " << event_num << " of " << number_of_events << " ["
-                                                  << module->get_identifier().getUniqueName() << "]";
-                // Check if module is satisfied to run
-                if(!module->check_delegates()) {
-                    LOG(TRACE) << "Not all required messages are received for " << module->get_identifier().getUniqueName()
-                               << ", skipping module!";
-                    return;
-                }
-
-                // Get current time
-                auto start = std::chrono::steady_clock::now();
-                // Set run module section header
-                std::string old_section_name = Log::getSection();
-                std::string section_name = "R:";
-                section_name += module->get_identifier().getUniqueName();
-                Log::setSection(section_name);
-                // Set module specific settings
-                auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
-                // Change to ROOT directory is not thread safe, only do this for module without parallelization support
-                if(!module->canParallelize()) {
-                    // DEPRECATED: Switching to the directory should be removed, but can break current modules
-                    module->getROOTDirectory()->cd();
-                }
-                // Run module
-                try {
-                    module->run(event_num);
-                } catch(EndOfRunException& e) {
-                    // Terminate if the module threw the EndOfRun request exception:
-                    LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
-                    terminate_ = true;
-                }
-                // Reset logging
-                Log::setSection(old_section_name);
-                set_module_after(old_settings);
-                // Update execution time
-                auto end = std::chrono::steady_clock::now();
-                module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+            auto execute_module = [module = module.get(), event = &event, this, number_of_events]() {
+                run_module(module, event, number_of_events);
             };
 
             if(module->canParallelize()) {
                 // Submit the module function
-                thread_pool->submit_module_function(execute_module);
+                thread_pool->submit_module_function(execute_module, get_priority(module.get()));
             } else {
                 // Finish thread pool
                 thread_pool->execute_all();
@@ -693,27 +1350,665 @@ void ModuleManager::run() {
 
         // Finish executing the last remaining tasks
         thread_pool->execute_all();
+    }
+
+    // Resetting delegates
+    for(auto& module : modules_) {
+        LOG(TRACE) << "Resetting messages";
+        module->reset_delegates();
+    }
+    record_event(event, *thread_pool);
+}
 
-        // Resetting delegates
+/**
+ * The thread pool is created for the first event and kept for all following events, such that running an event does not
+ * start any thread. Modules which can be parallelized are executed on the calling thread as well. The number of events of
+ * the run is updated with every event, it is only known to the modules once they are finalized.
+ */
+unsigned int ModuleManager::runEvent() {
+    auto start_time = std::chrono::steady_clock::now();
+    if(event_thread_pool_ == nullptr) {
+        LOG(DEBUG) << "Running events on demand on the calling thread";
+        std::vector<Module*> module_list;
         for(auto& module : modules_) {
-            LOG(TRACE) << "Resetting messages";
-            module->reset_delegates();
+            module_list.emplace_back(module.get());
         }
-
-        // Reset object count for next event
-        TProcessID::SetObjectCount(save_id);
+        event_thread_pool_ = std::make_shared<ThreadPool>(0, module_list, []() {});
+        for(auto& module : modules_) {
+            module->set_thread_pool(event_thread_pool_);
+        }
+        metrics_start_time_ = start_time;
+        metrics_time_ = start_time;
     }
-    LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Finished run of " << number_of_events << " events";
+
+    auto event_index = first_event_ + events_on_demand_++;
+    metrics_number_of_events_ = event_index + 1;
+    LOG(TRACE) << "Running event " << (event_index + 1) << " on demand";
+    run_event(event_thread_pool_, event_index, event_index + 1, false);
+
     auto end_time = std::chrono::steady_clock::now();
-    total_time_ += static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
+    auto event_time = static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
+    event_loop_time_ += event_time;
+    total_time_ += event_time;
+    return event_index + 1;
+}
 
-    // Remove pool from modules, wait for the threads to finish and destroy pool
-    LOG(TRACE) << "Destroying thread pool";
+/**
+ * Sets the section header, the logging settings and the current event before executing the \ref Module::run() function.
+ * Modules are skipped if the event has been vetoed by a previous module or if not all of their required messages are
+ * received in the event. If the messages of the event are deferred, they are delivered to modules which do not process
+ * events concurrently just before their execution.
+ */
+void ModuleManager::run_module(Module* module, Event* event, unsigned int number_of_events) {
+    // Skip all modules once the event has been vetoed
+    if(event->vetoed_) {
+        LOG(TRACE) << "Skipping " << module->get_identifier().getUniqueName() << " for vetoed event " << event->getNumber();
+        return;
+    }
+
+    LOG_PROGRESS(TRACE, "EVENT_LOOP") << "Running event " << event->getNumber() << " of " << number_of_events << " ["
+                                      << module->get_identifier().getUniqueName() << "]";
+    // Set the event processed by this thread
+    Event::set_current(event);
+
+    // Check if module is satisfied to run
+    bool satisfied = true;
+    if(!event->deferred_) {
+        satisfied = module->check_delegates();
+    } else if(module->has_concurrent_events()) {
+        satisfied = module->check_delegates(event);
+    } else {
+        module->deliver_messages(event);
+        satisfied = module->check_delegates();
+    }
+    if(!satisfied) {
+        LOG(TRACE) << "Not all required messages are received for " << module->get_identifier().getUniqueName()
+                   << ", skipping module!";
+        Event::set_current(nullptr);
+        return;
+    }
+
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    auto sample = (profiler_ ? profiler_->start() : ModuleProfiler::Sample());
+    // Set run module section header and module specific settings prepared before the event loop
+    const auto& context = run_contexts_.at(module);
+    const auto* old_section = Log::swapSection(&context.section);
+    auto old_level = Log::getReportingLevel();
+    auto old_format = Log::getFormat();
+    if(context.log_level.has_value()) {
+        Log::setReportingLevel(context.log_level.value());
+    }
+    if(context.log_format.has_value()) {
+        Log::setFormat(context.log_format.value());
+    }
+    // The current ROOT directory is not changed while running, modules write through Module::writeROOTObject
+    // Run module
+    try {
+        EventTracer::Scope trace(EventTracer::Category::MODULE, module, event->getNumber());
+        module->run(event->getNumber());
+    } catch(EndOfRunException& e) {
+        // Terminate if the module threw the EndOfRun request exception:
+        LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
+        terminate_ = true;
+    }
+    // Reset logging
+    Log::swapSection(old_section);
+    Log::setReportingLevel(old_level);
+    Log::setFormat(old_format);
+    Event::set_current(nullptr);
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    if(profiler_) {
+        profiler_->stop(module, ModuleProfiler::Stage::RUN, sample);
+    }
+    auto duration = static_cast<std::chrono::duration<long double>>(end - start).count();
+    std::lock_guard<std::mutex> lock(module_execution_time_mutex_);
+    *context.execution_time += duration;
+    *context.run_time += duration;
+}
+
+/**
+ * A module depends on an earlier module in the list if any of the two can receive messages dispatched by the other. Messages
+ * can only be received by delegates of unique modules or by delegates of detector modules bound to the same detector, as
+ * detector modules only dispatch messages for their own detector. Instances of the same module without support for
+ * parallelization are executed in order, as are all modules which have to be executed by the main thread, such that modules
+ * sharing the state of Geant4 keep their order.
+ */
+void ModuleManager::build_module_graph(bool dedicated_threads) {
+    module_graph_.clear();
+
+    // Check if a module has a delegate which can receive the messages of the sending module
+    auto can_receive = [](const Module* receiver, const Module* sender) {
+        auto sender_detector = sender->getDetector();
+        for(const auto& delegate : receiver->delegates_) {
+            auto detector = delegate.second->getDetector();
+            if(detector == nullptr || sender_detector == nullptr || detector->getName() == sender_detector->getName()) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<Module*> previous_modules;
+    for(auto& module_ptr : modules_) {
+        auto* module = module_ptr.get();
+        auto& node = module_graph_[module];
+        node.index = previous_modules.size();
+        node.main_thread = !module->canParallelize() && !(dedicated_threads && module->canUseDedicatedThread());
+
+        std::string dependencies;
+        for(auto* previous : previous_modules) {
+            auto& previous_node = module_graph_[previous];
+            bool depends = false;
+            if(node.main_thread && previous_node.main_thread) {
+                depends = true;
+            } else if(module->get_identifier().getName() == previous->get_identifier().getName()) {
+                depends = !previous->canParallelize();
+            } else {
+                depends = can_receive(module, previous) || can_receive(previous, module);
+            }
+
+            if(depends) {
+                previous_node.dependents.push_back(module);
+                ++node.dependencies;
+                dependencies += (dependencies.empty() ? "" : ", ") + previous->getUniqueName();
+            }
+        }
+        LOG(DEBUG) << "Module " << module->getUniqueName() << (node.main_thread ? " (main thread)" : "")
+                   << (dependencies.empty() ? " has no dependencies" : " depends on " + dependencies);
+        previous_modules.push_back(module);
+    }
+}
+
+/**
+ * Modules without remaining dependencies are submitted to the thread pool, or queued for the main thread if they have to be
+ * executed by it. The main thread executes its modules in the order of the module list while waiting for the others. The
+ * first exception thrown by any module is propagated after all running modules are finished.
+ */
+void ModuleManager::run_module_graph(const std::shared_ptr<ThreadPool>& thread_pool,
+                                     Event* event,
+                                     unsigned int number_of_events) {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::exception_ptr exception;
+    size_t finished = 0;
+    size_t running = 0;
+
+    std::map<Module*, size_t> dependencies;
+    std::map<size_t, Module*> main_thread_modules;
+
+    // Start a module without remaining dependencies, with the lock held
+    std::function<void(Module*)> finish_module;
+    auto start_module = [&](Module* module) {
+        const auto& node = module_graph_.at(module);
+        if(node.main_thread) {
+            main_thread_modules.emplace(node.index, module);
+            return;
+        }
+
+        ++running;
+        auto module_function = [&, module]() {
+            std::exception_ptr error;
+            try {
+                run_module(module, event, number_of_events);
+            } catch(...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if(error && !exception) {
+                exception = error;
+            }
+            --running;
+            finish_module(module);
+            condition.notify_all();
+        };
+        thread_pool->submit_module_function(std::move(module_function), node.critical_path);
+    };
+    // Mark a module as finished and start all modules only waiting for it, with the lock held
+    finish_module = [&](Module* module) {
+        ++finished;
+        if(exception) {
+            return;
+        }
+        for(auto* dependent : module_graph_.at(module).dependents) {
+            if(--dependencies.at(dependent) == 0) {
+                start_module(dependent);
+            }
+        }
+    };
+
+    // Update the longest path of execution times through the dependents of every module, which are later in the list
+    for(auto iter = modules_.rbegin(); iter != modules_.rend(); ++iter) {
+        auto& node = module_graph_.at(iter->get());
+        long double longest_dependent = 0;
+        for(auto* dependent : node.dependents) {
+            longest_dependent = std::max(longest_dependent, module_graph_.at(dependent).critical_path);
+        }
+        node.critical_path = get_priority(iter->get()) + longest_dependent;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for(auto& [module, node] : module_graph_) {
+        dependencies.emplace(module, node.dependencies);
+    }
+    for(auto& [module, node] : module_graph_) {
+        if(node.dependencies == 0) {
+            start_module(module);
+        }
+    }
+
+    // Execute the modules of the main thread until all modules are finished, periodically checking if the thread pool has
+    // been invalidated by an exception in a task submitted by a module
+    auto can_continue = [&]() { return !main_thread_modules.empty() || finished == module_graph_.size() || exception; };
+    while(finished < module_graph_.size() && !exception) {
+        if(!condition.wait_for(lock, std::chrono::milliseconds(100), can_continue)) {
+            if(!thread_pool->valid_) {
+                break;
+            }
+            continue;
+        }
+        if(main_thread_modules.empty()) {
+            continue;
+        }
+
+        auto* module = main_thread_modules.begin()->second;
+        main_thread_modules.erase(main_thread_modules.begin());
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            run_module(module, event, number_of_events);
+        } catch(...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if(error && !exception) {
+            exception = error;
+        }
+        finish_module(module);
+    }
+
+    // Wait for the running modules before propagating any exception
+    while(running > 0 && thread_pool->valid_) {
+        condition.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    lock.unlock();
+    thread_pool->execute_all();
+    if(exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+/**
+ * Keeps up to the requested number of events in flight. Modules that can process events concurrently are executed by the
+ * thread pool, while all other modules are executed by the main thread strictly in the order of the events. This ensures
+ * that modules without support for concurrent events, such as the output writers, still receive the events in order. If
+ * enabled, modules allowing it are executed by a dedicated thread each instead of the main thread, such that these modules
+ * form a pipeline processing different events at the same time. The first exception thrown while processing any event is
+ * propagated after all running tasks are finished.
+ */
+/**
+ * Modules which took longest in the previous events are expected to take longest in the current event as well, and are
+ * started first to reduce the time until all modules of the event are finished
+ */
+long double ModuleManager::get_priority(Module* module) {
+    if(!priority_scheduling_) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(module_execution_time_mutex_);
+    auto iter = module_run_time_.find(module);
+    return (iter == module_run_time_.end() ? 0 : iter->second);
+}
+
+unsigned int ModuleManager::run_concurrent_events(const std::shared_ptr<ThreadPool>& thread_pool,
+                                                  unsigned int number_of_events,
+                                                  unsigned int parallel_events,
+                                                  bool dedicated_threads) {
+    // State of an event in flight, pointing to the next module to execute for the event
+    struct EventState {
+        std::unique_ptr<Event> event;
+        ModuleList::iterator module;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::exception_ptr exception;
+    bool finished = false;
+    unsigned int started_events = first_event_;
+    unsigned int running_events = 0;
+    // Events are only started up to the next checkpoint, which is written once all of them are finished
+    auto next_checkpoint = (checkpoint_interval_ > 0 ? (first_event_ / checkpoint_interval_ + 1) * checkpoint_interval_
+                                                     : std::numeric_limits<unsigned int>::max());
+
+    // Events waiting for a sequential thread to execute their next module
+    std::map<unsigned int, std::shared_ptr<EventState>> waiting_events;
+    // Sequential thread executing every module that cannot process events concurrently (zero for the main thread) and the
+    // next event to execute for it (only accessed by the thread executing the module)
+    std::map<Module*, unsigned int> module_thread;
+    std::map<Module*, unsigned int> next_event;
+    unsigned int threads_num = 0;
     for(auto& module : modules_) {
-        module->set_thread_pool(nullptr);
+        if(!module->has_concurrent_events()) {
+            unsigned int thread = 0;
+            if(dedicated_threads && module->canUseDedicatedThread()) {
+                thread = ++threads_num;
+                LOG(DEBUG) << "Module " << module->get_identifier().getUniqueName() << " is executed on a dedicated thread";
+            }
+            module_thread.emplace(module.get(), thread);
+            next_event.emplace(module.get(), first_event_ + 1);
+        }
+    }
+
+    // Execute the modules of an event in the thread pool until a module which cannot process concurrent events is reached
+    auto run_parallel = [&](const std::shared_ptr<EventState>& state) {
+        try {
+            while(state->module != modules_.end() && (*state->module)->has_concurrent_events()) {
+                run_module(state->module->get(), state->event.get(), number_of_events);
+                ++state->module;
+            }
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!exception) {
+                exception = std::current_exception();
+            }
+            --running_events;
+            condition.notify_all();
+            return;
+        }
+
+        // Hand the event back to the sequential threads
+        std::lock_guard<std::mutex> lock(mutex);
+        if(state->module == modules_.end()) {
+            record_event(*state->event, *thread_pool);
+            --running_events;
+        } else {
+            waiting_events.emplace(state->event->getNumber(), state);
+        }
+        condition.notify_all();
+    };
+
+    // Check if the next module of an event is executed by a sequential thread and the event is next in line for it
+    auto is_next = [&](unsigned int thread, const std::shared_ptr<EventState>& state) {
+        // Finished events and events continuing in the thread pool are handled by the main thread
+        if(state->module == modules_.end() || (*state->module)->has_concurrent_events()) {
+            return thread == 0;
+        }
+        auto* module = state->module->get();
+        return module_thread.at(module) == thread && next_event.at(module) == state->event->getNumber();
+    };
+
+    // Execute the modules of the first waiting event which is next in line for a sequential thread, with the lock held on
+    // entry and exit. Returns false if no event can continue on this thread.
+    auto run_sequential = [&](unsigned int thread, std::unique_lock<std::mutex>& lock) {
+        auto iter = std::find_if(waiting_events.begin(), waiting_events.end(), [&](const auto& item) {
+            return is_next(thread, item.second);
+        });
+        if(iter == waiting_events.end()) {
+            return false;
+        }
+        auto state = iter->second;
+        waiting_events.erase(iter);
+        lock.unlock();
+
+        // Execute all modules of this event on this thread for which the event is next in line
+        try {
+            while(state->module != modules_.end() && !(*state->module)->has_concurrent_events() &&
+                  is_next(thread, state)) {
+                auto* module = state->module->get();
+                run_module(module, state->event.get(), number_of_events);
+                module->reset_delegates();
+                ++next_event.at(module);
+                ++state->module;
+            }
+        } catch(...) {
+            lock.lock();
+            if(!exception) {
+                exception = std::current_exception();
+            }
+            condition.notify_all();
+            return true;
+        }
+
+        lock.lock();
+        if(state->module == modules_.end()) {
+            record_event(*state->event, *thread_pool);
+            --running_events;
+        } else if((*state->module)->has_concurrent_events()) {
+            thread_pool->submit_module_function([&run_parallel, state]() { run_parallel(state); });
+        } else {
+            waiting_events.emplace(state->event->getNumber(), state);
+        }
+        condition.notify_all();
+        return true;
+    };
+
+    // Start the dedicated threads with the same log level and format as the main thread
+    std::vector<std::thread> threads;
+    for(unsigned int thread = 1; thread <= threads_num; ++thread) {
+        threads.emplace_back([&, thread, log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
+            Log::setReportingLevel(log_level);
+            Log::setFormat(log_format);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!exception && !finished) {
+                if(!run_sequential(thread, lock)) {
+                    condition.wait(lock);
+                }
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!exception) {
+        // Start new events until the maximum number of events in flight or the memory budget is reached, at least one
+        // event is always kept in flight
+        while(!terminate_ && started_events < number_of_events && started_events < next_checkpoint &&
+              running_events < parallel_events &&
+              (memory_budget_ == 0 || running_events == 0 || memory_in_flight_ < memory_budget_)) {
+            ++started_events;
+            ++started_events_;
+            ++running_events;
+            LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Running event " << started_events << " of " << number_of_events;
+
+            auto state = std::make_shared<EventState>();
+            state->event = std::make_unique<Event>(started_events,
+                                                   Event::derive_seed(event_seed_, started_events - job_seed_offset_));
+            state->event->deferred_ = true;
+            state->event->memory_budget_ = event_memory_budget_;
+            state->event->memory_counter_ = &memory_in_flight_;
+            state->module = modules_.begin();
+            waiting_events.emplace(started_events, std::move(state));
+        }
+        if(running_events == 0) {
+            if(terminate_ || started_events >= number_of_events) {
+                break;
+            }
+
+            // All events up to the checkpoint are finished and no other event is in flight
+            try {
+                write_checkpoint(started_events);
+            } catch(...) {
+                exception = std::current_exception();
+                break;
+            }
+            next_checkpoint += checkpoint_interval_;
+            continue;
+        }
+
+        // Continue the first event which is next in line for the main thread, otherwise wait for events to be handed back
+        if(!run_sequential(0, lock)) {
+            condition.wait(lock);
+        }
+    }
+    finished = true;
+    condition.notify_all();
+    lock.unlock();
+
+    // Wait for the dedicated threads and all remaining tasks to finish before propagating exceptions
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    thread_pool->execute_all();
+    if(exception) {
+        std::rethrow_exception(exception);
+    }
+    return started_events;
+}
+
+/**
+ * Called once per event after all modules executed it, by the main thread or with the lock of the event loop held
+ */
+void ModuleManager::record_memory(const Event& event) {
+    peak_event_memory_ = std::max(peak_event_memory_, event.getMemoryUsage());
+
+    std::lock_guard<std::mutex> lock(event.mutex_);
+    for(auto& [key, bytes] : event.memory_per_message_) {
+        auto& peak = peak_message_memory_[std::make_pair(key.first->get_identifier().getUniqueName(),
+                                                         allpix::demangle(key.second.name()))];
+        peak = std::max(peak, bytes);
+    }
+    if(event.getMemoryBudget() > 0 && event.getMemoryUsage() > event.getMemoryBudget()) {
+        LOG(WARNING) << "Messages of event " << event.getNumber() << " exceed the memory budget with "
+                     << Units::display(static_cast<double>(event.getMemoryUsage()), {"kB", "MB", "GB"});
+    }
+}
+
+/**
+ * Called once per event after all modules executed it, by the main thread or with the lock of the event loop held
+ */
+void ModuleManager::record_event(const Event& event, const ThreadPool& thread_pool) {
+    record_memory(event);
+    ++finished_events_;
+    if(metrics_file_.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(event.mutex_);
+        for(auto& [type, objects] : event.objects_per_type_) {
+            dispatched_objects_[type] += objects;
+        }
+    }
+    if(std::chrono::steady_clock::now() - metrics_time_ >= metrics_interval_) {
+        write_metrics(thread_pool);
+    }
+}
+
+/**
+ * @brief Get the resident memory of the process
+ * @return Resident memory in bytes, zero if it is not available
+ */
+static uint64_t resident_memory() {
+    uint64_t size = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    if(!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+/**
+ * @brief Quote a label value of the metrics
+ * @param value Value of the label
+ * @return Quoted and escaped value
+ */
+static std::string metrics_label(const std::string& value) {
+    std::string result = "\"";
+    for(auto character : value) {
+        if(character == '"' || character == '\\') {
+            result += '\\';
+            result += character;
+        } else if(character == '\n') {
+            result += "\\n";
+        } else {
+            result += character;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+/**
+ * The metrics are written in the text format of Prometheus, such that the file can be exported by the textfile collector of
+ * the node exporter or parsed directly. The file is replaced atomically by writing to a temporary file first. Failing to
+ * write the metrics only results in a warning, as it should not abort a long run.
+ */
+void ModuleManager::write_metrics(const ThreadPool& thread_pool) {
+    auto now = std::chrono::steady_clock::now();
+    metrics_time_ = now;
+    auto elapsed = std::chrono::duration<double>(now - metrics_start_time_).count();
+
+    // Time spent in the run method of every module
+    std::vector<std::pair<std::string, long double>> run_times;
+    long double total_run_time = 0;
+    {
+        std::lock_guard<std::mutex> lock(module_execution_time_mutex_);
+        for(auto& module : modules_) {
+            auto iter = module_run_time_.find(module.get());
+            auto run_time = (iter == module_run_time_.end() ? 0 : iter->second);
+            run_times.emplace_back(module->get_identifier().getUniqueName(), run_time);
+            total_run_time += run_time;
+        }
+    }
+
+    auto metric = [](std::ostream& out, const std::string& name, const std::string& type, const std::string& help) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+    };
+
+    auto temporary_file = metrics_file_ + ".tmp";
+    std::ofstream out(temporary_file);
+    metric(out, "allpix_elapsed_seconds", "gauge", "Time since the start of the event loop");
+    out << "allpix_elapsed_seconds " << elapsed << "\n";
+    metric(out, "allpix_events_processed", "counter", "Number of events finished, including the events resumed from");
+    out << "allpix_events_processed " << (first_event_ + finished_events_) << "\n";
+    metric(out, "allpix_events_total", "gauge", "Number of events of the run");
+    out << "allpix_events_total " << metrics_number_of_events_ << "\n";
+    metric(out, "allpix_events_in_flight", "gauge", "Number of events started but not finished");
+    out << "allpix_events_in_flight " << (started_events_ - finished_events_) << "\n";
+    metric(out, "allpix_event_rate", "gauge", "Average number of events finished per second since the start of the loop");
+    out << "allpix_event_rate " << (elapsed > 0 ? finished_events_ / elapsed : 0) << "\n";
+    metric(out, "allpix_queued_tasks", "gauge", "Number of tasks waiting in the queues of the thread pool");
+    out << "allpix_queued_tasks " << thread_pool.queuedTasks() << "\n";
+    metric(out, "allpix_running_tasks", "gauge", "Number of tasks executed by the thread pool");
+    out << "allpix_running_tasks " << thread_pool.runningTasks() << "\n";
+    metric(out, "allpix_resident_memory_bytes", "gauge", "Resident memory of the process");
+    out << "allpix_resident_memory_bytes " << resident_memory() << "\n";
+
+    metric(out, "allpix_module_run_seconds_total", "counter", "Time spent in the run method of the module");
+    for(auto& [name, run_time] : run_times) {
+        out << "allpix_module_run_seconds_total{module=" << metrics_label(name) << "} " << run_time << "\n";
+    }
+    metric(out, "allpix_module_run_time_share", "gauge", "Fraction of the time in the run methods spent by the module");
+    for(auto& [name, run_time] : run_times) {
+        out << "allpix_module_run_time_share{module=" << metrics_label(name) << "} "
+            << (total_run_time > 0 ? run_time / total_run_time : 0) << "\n";
+    }
+
+    metric(out, "allpix_module_counter_total", "counter", "Counters of the work done by the module");
+    for(auto& module : modules_) {
+        for(auto& [counter, value] : module->get_metrics()) {
+            out << "allpix_module_counter_total{module=" << metrics_label(module->get_identifier().getUniqueName())
+                << ",counter=" << metrics_label(counter) << "} " << value << "\n";
+        }
+    }
+
+    metric(out, "allpix_objects_dispatched_total", "counter", "Number of objects dispatched in messages of the type");
+    for(auto& [type, objects] : dispatched_objects_) {
+        out << "allpix_objects_dispatched_total{type=" << metrics_label(allpix::demangle(type.name())) << "} " << objects
+            << "\n";
+    }
+    metric(out, "allpix_object_rate", "gauge", "Average number of objects dispatched per second in messages of the type");
+    for(auto& [type, objects] : dispatched_objects_) {
+        out << "allpix_object_rate{type=" << metrics_label(allpix::demangle(type.name())) << "} "
+            << (elapsed > 0 ? static_cast<double>(objects) / elapsed : 0) << "\n";
+    }
+    out.close();
+
+    if(!out || std::rename(temporary_file.c_str(), metrics_file_.c_str()) != 0) {
+        LOG(WARNING) << "Cannot write metrics of the run to " << metrics_file_;
     }
-    thread_pool.reset();
-    assert(thread_pool.use_count() == 0);
 }
 
 static std::string seconds_to_time(long double seconds) {
@@ -740,37 +2035,59 @@ static std::string seconds_to_time(long double seconds) {
 
 /**
  * Sets the section header and logging settings before executing the  \ref Module::finalize() function. Reset the logging
- * after finalization. No method will be called after finalizing the module (except the destructor).
+ * after finalization. No method will be called after finalizing the module (except the destructor). If multithreading is
+ * enabled, the instantiations allowing it are finalized concurrently on the startup threads. All other instantiations may
+ * write to the main ROOT file directly, they are finalized one after another in their order by a single thread holding the
+ * lock of the main ROOT file, at the same time as the concurrent ones.
  */
 void ModuleManager::finalize() {
     auto start_time = std::chrono::steady_clock::now();
+
+    // Finish the events run on demand, reporting them as the run to the modules and in the summary
+    if(event_thread_pool_ != nullptr) {
+        auto number_of_events = first_event_ + events_on_demand_;
+        conf_manager_->getGlobalConfiguration().set<unsigned int>("number_of_events", number_of_events);
+        LOG(STATUS) << "Finished run of " << number_of_events << " events on demand";
+        for(auto& module : modules_) {
+            module->set_thread_pool(nullptr);
+        }
+        event_thread_pool_.reset();
+    }
     LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing module instantiations";
+    std::vector<Module*> sequential_modules, concurrent_modules;
     for(auto& module : modules_) {
-        LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing " << module->get_identifier().getUniqueName();
+        if(startup_threads_ > 1 && module->canParallelizeFinalization()) {
+            concurrent_modules.push_back(module.get());
+        } else {
+            sequential_modules.push_back(module.get());
+        }
+    }
 
-        // Get current time
-        auto start = std::chrono::steady_clock::now();
-        // Set finalize module section header
-        std::string old_section_name = Log::getSection();
-        std::string section_name = "F:";
-        section_name += module->get_identifier().getUniqueName();
-        Log::setSection(section_name);
-        // Set module specific settings
-        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
-        // Change to our ROOT directory
-        module->getROOTDirectory()->cd();
-        // Finalize module
-        module->finalize();
-        // Remove the pointer to the ROOT directory after finalizing
-        module->set_ROOT_directory(nullptr);
-        // Remove the config manager
-        module->set_config_manager(nullptr);
-        // Reset logging
-        Log::setSection(old_section_name);
-        set_module_after(old_settings);
-        // Update execution time
-        auto end = std::chrono::steady_clock::now();
-        module_execution_time_[module.get()] += static_cast<std::chrono::duration<long double>>(end - start).count();
+    std::vector<long double> sequential_times(sequential_modules.size()), concurrent_times(concurrent_modules.size());
+    if(concurrent_modules.empty()) {
+        for(size_t index = 0; index < sequential_modules.size(); ++index) {
+            sequential_times[index] = finalize_module(sequential_modules[index]);
+        }
+    } else {
+        LOG(DEBUG) << "Finalizing " << concurrent_modules.size() << " instantiations concurrently with the other "
+                   << sequential_modules.size() << " instantiations on "
+                   << std::min<size_t>(startup_threads_, concurrent_modules.size() + 1) << " threads";
+        run_concurrently(concurrent_modules.size() + 1, [&](size_t index) {
+            if(index > 0) {
+                concurrent_times[index - 1] = finalize_module(concurrent_modules[index - 1]);
+                return;
+            }
+            for(size_t sequential_index = 0; sequential_index < sequential_modules.size(); ++sequential_index) {
+                std::lock_guard<std::recursive_mutex> lock(Module::root_output_mutex());
+                sequential_times[sequential_index] = finalize_module(sequential_modules[sequential_index]);
+            }
+        });
+    }
+    for(size_t index = 0; index < sequential_modules.size(); ++index) {
+        module_execution_time_[sequential_modules[index]] += sequential_times[index];
+    }
+    for(size_t index = 0; index < concurrent_modules.size(); ++index) {
+        module_execution_time_[concurrent_modules[index]] += concurrent_times[index];
     }
     // Close module ROOT file
     modules_file_->Close();
@@ -791,17 +2108,174 @@ void ModuleManager::finalize() {
                 << slowest_module;
     for(auto& module : modules_) {
         LOG(INFO) << " Module " << module->getUniqueName() << " took " << module_execution_time_[module.get()] << " seconds";
+        if(module->getVetoedEvents() > 0) {
+            LOG(INFO) << " Module " << module->getUniqueName() << " vetoed " << module->getVetoedEvents() << " events";
+        }
     }
 
     Configuration& global_config = conf_manager_->getGlobalConfiguration();
     long double processing_time = 0;
-    auto total_events = global_config.get<unsigned int>("number_of_events");
+    // Only the events after the checkpoint a run is resumed from have been processed
+    auto total_events = global_config.get<unsigned int>("number_of_events") - first_event_;
     if(total_events > 0) {
         processing_time = std::round((1000 * total_time_) / total_events);
     }
 
     LOG(STATUS) << "Average processing time is \x1B[1m" << processing_time << " ms/event\x1B[0m, event generation at \x1B[1m"
-                << std::round(global_config.get<double>("number_of_events") / total_time_) << " Hz\x1B[0m";
+                << std::round(static_cast<double>(total_events) / total_time_) << " Hz\x1B[0m";
+
+    // Write the detailed profiling report
+    if(profiler_) {
+        std::vector<const Module*> modules;
+        for(auto& module : modules_) {
+            modules.push_back(module.get());
+        }
+        std::ofstream file(profiling_file_);
+        if(!file) {
+            throw RuntimeError("Cannot write profiling report to " + profiling_file_);
+        }
+        profiler_->write(file, modules, total_time_, event_loop_time_, total_events, workers_);
+        LOG(STATUS) << "Wrote profiling report of the modules to " << profiling_file_;
+    }
+
+    // Write the trace of the module execution
+    if(!trace_file_.empty()) {
+        std::ofstream file(trace_file_);
+        if(!file) {
+            throw RuntimeError("Cannot write trace of the module execution to " + trace_file_);
+        }
+        EventTracer::write(file);
+        LOG(STATUS) << "Wrote trace of the module execution to " << trace_file_;
+    }
+}
+
+/**
+ * @brief Get the directory of a module in a checkpoint file, using the same layout as the main ROOT file
+ * @param file Checkpoint file
+ * @param name Name of the module
+ * @param identifier Identifier of the instantiation
+ * @param create True if the directory should be created, false if it should be read
+ * @return Directory of the instantiation or a null pointer if it does not exist
+ */
+static TDirectory* checkpoint_directory(TFile& file, const std::string& name, const std::string& identifier, bool create) {
+    auto* directory = file.GetDirectory(name.c_str());
+    if(directory == nullptr && create) {
+        directory = file.mkdir(name.c_str());
+    }
+    if(directory == nullptr || identifier.empty()) {
+        return directory;
+    }
+    auto* local_directory = directory->GetDirectory(identifier.c_str());
+    if(local_directory == nullptr && create) {
+        local_directory = directory->mkdir(identifier.c_str());
+    }
+    return local_directory;
+}
+
+/**
+ * The checkpoint is written to a temporary file first, which replaces the previous checkpoint once it is complete. Besides
+ * the state stored by the modules themselves, it contains the number of events processed, the seeds of the run and the
+ * state of the random generator of every module.
+ */
+void ModuleManager::write_checkpoint(unsigned int events) {
+    LOG(INFO) << "Writing checkpoint after " << events << " events";
+    auto temporary_file = checkpoint_file_ + ".tmp";
+    {
+        TFile file(temporary_file.c_str(), "RECREATE");
+        if(file.IsZombie()) {
+            throw RuntimeError("Cannot create checkpoint file " + temporary_file);
+        }
+
+        Configuration& global_config = conf_manager_->getGlobalConfiguration();
+        auto* global_dir = file.mkdir("Allpix");
+        auto events_str = std::to_string(events);
+        global_dir->WriteObject(&events_str, "events");
+        for(const auto& key : {"random_seed", "random_seed_core"}) {
+            auto seed = global_config.get<std::string>(key);
+            global_dir->WriteObject(&seed, key);
+        }
+
+        for(auto& module : modules_) {
+            auto* directory = checkpoint_directory(
+                file, module->get_configuration().getName(), module->get_identifier().getIdentifier(), true);
+            if(directory == nullptr) {
+                throw RuntimeError("Cannot create checkpoint directory for module " + module->getUniqueName());
+            }
+
+            // Store the state of the random generator if it has been used
+            if(module->initialized_random_generator_) {
+                std::stringstream random_state;
+                random_state << module->random_generator_;
+                auto random_state_str = random_state.str();
+                directory->WriteObject(&random_state_str, "random_generator");
+            }
+
+            std::string old_section_name = Log::getSection();
+            Log::setSection("R:" + module->get_identifier().getUniqueName());
+            auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
+            directory->cd();
+            module->wait_async_tasks();
+            module->checkpoint(directory);
+            Log::setSection(old_section_name);
+            set_module_after(old_settings);
+        }
+        file.Write();
+        file.Close();
+    }
+
+    // Replace the previous checkpoint only by a complete one
+    if(std::rename(temporary_file.c_str(), checkpoint_file_.c_str()) != 0) {
+        throw RuntimeError("Cannot replace checkpoint file " + checkpoint_file_);
+    }
+    modules_file_->cd();
+}
+
+/**
+ * The random generators of the modules are restored before the modules restore their own state. The seeds of the run are
+ * restored earlier by the framework, since they are required to construct the modules.
+ */
+void ModuleManager::read_checkpoint() {
+    TFile file(checkpoint_file_.c_str(), "READ");
+    if(file.IsZombie()) {
+        throw RuntimeError("Cannot read checkpoint file " + checkpoint_file_);
+    }
+
+    std::string* events = nullptr;
+    file.GetObject("Allpix/events", events);
+    if(events == nullptr) {
+        throw RuntimeError("Checkpoint file " + checkpoint_file_ + " does not contain the number of processed events");
+    }
+    first_event_ = allpix::from_string<unsigned int>(*events);
+    delete events;
+
+    for(auto& module : modules_) {
+        auto* directory = checkpoint_directory(
+            file, module->get_configuration().getName(), module->get_identifier().getIdentifier(), false);
+        if(directory == nullptr) {
+            throw RuntimeError("Checkpoint file " + checkpoint_file_ + " does not contain the state of module " +
+                               module->getUniqueName());
+        }
+
+        std::string* random_state = nullptr;
+        directory->GetObject("random_generator", random_state);
+        if(random_state != nullptr) {
+            std::stringstream random_state_stream(*random_state);
+            random_state_stream >> module->random_generator_;
+            module->initialized_random_generator_ = true;
+            delete random_state;
+        }
+
+        std::string old_section_name = Log::getSection();
+        Log::setSection("I:" + module->get_identifier().getUniqueName());
+        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
+        directory->cd();
+        module->resume(directory);
+        Log::setSection(old_section_name);
+        set_module_after(old_settings);
+    }
+    file.Close();
+    modules_file_->cd();
+    LOG(STATUS) << "Resuming run after " << first_event_ << " events";
 }
 
 /**
@@ -11,16 +11,26 @@
 #define ALLPIX_MODULE_MANAGER_H
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <queue>
 #include <random>
+#include <set>
+#include <string>
+#include <typeindex>
+#include <vector>
 
 #include <TDirectory.h>
 #include <TFile.h>
 
+#include "Event.hpp"
 #include "Module.hpp"
+#include "ModuleProfiler.hpp"
 #include "ThreadPool.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/utils/log.h"
@@ -49,9 +59,9 @@ namespace allpix {
          */
         ModuleManager();
         /**
-         * @brief Use default destructor
+         * @brief Destroy manager, stopping the asynchronous tasks of all modules before they are destroyed
          */
-        ~ModuleManager() = default;
+        ~ModuleManager();
 
         /// @{
         /**
@@ -78,6 +88,13 @@ namespace allpix {
          */
         void load(Messenger* messenger, ConfigManager* conf_manager, GeometryManager* geo_manager, std::mt19937_64& seeder);
 
+        /**
+         * @brief Add a module which is not loaded from a module library in front of all loaded modules
+         * @param module Module to add, its configuration has to outlive the manager
+         * @warning Should be called after the \ref ModuleManager::load "load function" and before initializing
+         */
+        void addModule(std::unique_ptr<Module> module);
+
         /**
          * @brief Initialize all modules before the event sequence
          * @warning Should be called after the \ref ModuleManager::load "load function"
@@ -85,11 +102,35 @@ namespace allpix {
         void init();
 
         /**
-         * @brief Run all modules for the number of events
+         * @brief Run all modules for the number of events, once for every value of the parameter sweep if configured
          * @warning Should be called after the \ref ModuleManager::init "init function"
          */
         void run();
 
+        /**
+         * @brief Run all modules for a single event on demand, keeping the state of the run between the calls
+         * @return Number of the event
+         * @warning Should be called after the \ref ModuleManager::init "init function" and not be combined with the \ref
+         * ModuleManager::run "run function". The events are executed sequentially on the calling thread.
+         */
+        unsigned int runEvent();
+
+        /**
+         * @brief Run a job of events with the already initialized modules, as done by the simulation server
+         * @param number_of_events Number of events of the job
+         * @param seed Seed of the events of the job, the events continue the seeds of the previous job if not given
+         * @param parameters Module parameters to change as pairs of <module>.<parameter> and value
+         * @return Number of events run, which is lower than requested if the run has been terminated
+         * @throws InvalidJobError If a parameter does not refer to a configured module or is read when constructing it,
+         * nothing is changed in this case
+         *
+         * Only the instantiations of modules whose configuration changed are initialized again before the job. The events
+         * of all jobs are numbered consecutively and written to the same output, the modules are finalized once at the end.
+         */
+        unsigned int runJob(unsigned int number_of_events,
+                            std::optional<uint64_t> seed,
+                            const std::vector<std::pair<std::string, std::string>>& parameters);
+
         /**
          * @brief Finalize all modules after the event sequence
          * @warning Should be called after the \ref ModuleManager::init "run function"
@@ -102,10 +143,37 @@ namespace allpix {
          */
         void terminate();
 
+        /**
+         * @brief Register a module built into the executable, which is used instead of loading the library of the module
+         * @param name Name of the module
+         * @param unique True if the module is unique, false if it is instantiated per detector
+         * @param generator Function instantiating the module, with the signature of the generator of its library
+         * @warning Should be called before the modules are loaded, e.g. during the static initialization of the executable
+         */
+        static void registerStaticModule(const std::string& name, bool unique, void* generator);
+
     private:
+        /**
+         * @brief Modules built into the executable, with their type and generator function
+         */
+        struct StaticModule {
+            bool unique;
+            void* generator;
+        };
+        static std::map<std::string, StaticModule>& static_modules();
+
+        /**
+         * @brief Load the library of a module, or get it from the already loaded libraries
+         * @param global_config Global configuration with the directories to search the library in
+         * @param module_name Name of the module
+         * @return Handle of the loaded library
+         * @throws DynamicLibraryError If the library could not be loaded
+         */
+        void* load_library(const Configuration& global_config, const std::string& module_name);
+
         /**
          * @brief Create unique modules
-         * @param library Void pointer to the loaded library
+         * @param generator Void pointer to the generator function of the module
          * @param config Configuration of the module
          * @param messenger Pointer to the messenger
          * @param geo_manager Pointer to the geometry manager
@@ -117,7 +185,7 @@ namespace allpix {
 
         /**
          * @brief Create detector modules
-         * @param library Void pointer to the loaded library
+         * @param generator Void pointer to the generator function of the module
          * @param config Configuration of the module
          * @param messenger Pointer to the messenger
          * @param geo_manager Pointer to the geometry manager
@@ -127,6 +195,106 @@ namespace allpix {
         std::vector<std::pair<ModuleIdentifier, Module*>>
         create_detector_modules(void*, Configuration&, Messenger*, GeometryManager*, std::mt19937_64& seeder);
 
+        /**
+         * @brief Prepare a module for its initialization
+         * @param module Module to prepare
+         */
+        void prepare_init(Module* module);
+
+        /**
+         * @brief Initialize a module which has been prepared before
+         * @param module Module to initialize
+         * @return Time spent in the initialization of the module
+         */
+        long double init_module(Module* module);
+
+        /**
+         * @brief Finalize a module and detach it from the framework
+         * @param module Module to finalize
+         * @return Time spent in the finalization of the module
+         */
+        long double finalize_module(Module* module);
+
+        /**
+         * @brief Execute a number of tasks on the threads used for constructing and initializing the modules
+         * @param count Number of tasks to execute
+         * @param task Function executing the task with the given index
+         */
+        void run_concurrently(size_t count, const std::function<void(size_t)>& task);
+
+        /**
+         * @brief Run the event loop for the events from the first event up to the configured number of events
+         */
+        void run_events();
+
+        /**
+         * @brief Execute all modules for a single event without processing other events at the same time
+         * @param thread_pool Thread pool executing the modules that can be parallelized
+         * @param event_index Index of the event in the run, starting at zero
+         * @param number_of_events Total number of events in the run, used for reporting the progress
+         * @param dependency_scheduling If the modules are executed in the order of their dependencies
+         */
+        void run_event(const std::shared_ptr<ThreadPool>& thread_pool,
+                       unsigned int event_index,
+                       unsigned int number_of_events,
+                       bool dependency_scheduling);
+
+        /**
+         * @brief Set the value of a point of the parameter sweep in the configuration of the swept module
+         * @param point Index of the value in the sweep
+         * @return Instantiations of the swept module whose configuration changed
+         */
+        std::vector<Module*> apply_sweep_point(size_t point);
+
+        /**
+         * @brief Store the parameters read by the constructor of a module, which cannot be changed by a sweep or a job
+         * @param module Module constructed from its instantiation configuration
+         * @param framework_keys Parameters read by the framework before constructing the module, such as the log settings
+         */
+        void record_constructor_keys(Module* module, const std::set<std::string>& framework_keys);
+
+        /**
+         * @brief Execute the run method of a module for an event
+         * @param module Module to execute
+         * @param event Event to execute the module for
+         * @param number_of_events Total number of events in the run, used for reporting the progress
+         */
+        void run_module(Module* module, Event* event, unsigned int number_of_events);
+
+        /**
+         * @brief Run the event sequence processing several events at the same time
+         * @param thread_pool Thread pool executing the modules that can process events concurrently
+         * @param number_of_events Total number of events to run
+         * @param parallel_events Maximum number of events processed at the same time
+         * @param dedicated_threads If modules allowing it are executed on dedicated threads instead of the main thread
+         * @return Number of events processed, which is lower than requested if the run has been terminated
+         */
+        unsigned int run_concurrent_events(const std::shared_ptr<ThreadPool>& thread_pool,
+                                           unsigned int number_of_events,
+                                           unsigned int parallel_events,
+                                           bool dedicated_threads);
+
+        /**
+         * @brief Build the graph of the dependencies between all module instances from their message bindings
+         * @param dedicated_threads If modules allowing it can be executed on other threads than the main thread
+         */
+        void build_module_graph(bool dedicated_threads);
+
+        /**
+         * @brief Execute all modules of an event as soon as the modules they depend on are finished
+         * @param thread_pool Thread pool executing the modules that do not need the main thread
+         * @param event Event to execute the modules for
+         * @param number_of_events Total number of events in the run, used for reporting the progress
+         */
+        void run_module_graph(const std::shared_ptr<ThreadPool>& thread_pool, Event* event, unsigned int number_of_events);
+
+        /**
+         * @brief Get the priority of a module submitted to the thread pool
+         * @param module Module to get the priority for
+         * @return Time spent in the run method of the module in the previous events, zero if priority scheduling is disabled
+         */
+        long double get_priority(Module* module);
+
         /**
          * @brief Set module specific log setting before running init/run/finalize
          */
@@ -135,6 +303,51 @@ namespace allpix {
          * @brief Reset global log setting after running init/run/finalize
          */
         void set_module_after(std::tuple<LogLevel, LogFormat> prev);
+        /**
+         * @brief Get the module specific log settings from the configuration of a module
+         * @param config Configuration of the module
+         * @return Log level and format of the module, empty if the global setting is used
+         */
+        static std::pair<std::optional<LogLevel>, std::optional<LogFormat>>
+        get_module_log_settings(const Configuration& config);
+
+        /**
+         * @brief Prepare the logging context and the timing of a module for running events
+         * @param module Module to prepare the context for
+         * @note Has to be called again whenever the module is initialized again
+         */
+        void prepare_run_context(Module* module);
+
+        /**
+         * @brief Write a checkpoint of the run containing the state of all modules
+         * @param events Number of events processed by all modules
+         */
+        void write_checkpoint(unsigned int events);
+        /**
+         * @brief Restore the state of all modules from the checkpoint the run is resumed from
+         */
+        void read_checkpoint();
+
+        /**
+         * @brief Record the memory held by the messages of a finished event for the summary of the run
+         * @param event Finished event
+         */
+        void record_memory(const Event& event);
+
+        /**
+         * @brief Record a finished event for the summary and the metrics of the run
+         * @param event Finished event
+         * @param thread_pool Thread pool of the run
+         *
+         * The metrics are written if the interval since they were last written has passed.
+         */
+        void record_event(const Event& event, const ThreadPool& thread_pool);
+
+        /**
+         * @brief Write the current metrics of the run to the metrics file, replacing its previous content
+         * @param thread_pool Thread pool of the run, used to report the number of its tasks
+         */
+        void write_metrics(const ThreadPool& thread_pool);
 
         using ModuleList = std::list<std::unique_ptr<Module>>;
         using IdentifierToModuleMap = std::map<ModuleIdentifier, ModuleList::iterator>;
@@ -147,11 +360,98 @@ namespace allpix {
         std::unique_ptr<TFile> modules_file_;
 
         std::map<Module*, long double> module_execution_time_;
+        // Time spent in the run method only, used to prioritize the modules
+        std::map<Module*, long double> module_run_time_;
+        std::mutex module_execution_time_mutex_;
+
+        // Context of the run method of a module, prepared before the event loop to avoid per event string operations and
+        // parsing of the log settings
+        struct RunContext {
+            std::string section;
+            std::optional<LogLevel> log_level;
+            std::optional<LogFormat> log_format;
+            long double* execution_time{};
+            long double* run_time{};
+        };
+        std::map<const Module*, RunContext> run_contexts_;
+
+        // Parameters read by the constructor of every module, which cannot be changed by initializing the module again
+        std::map<const Module*, std::set<std::string>> constructor_keys_;
         long double total_time_{};
+        // Time of the event loop and number of workers used for it
+        long double event_loop_time_{};
+        unsigned int workers_{1};
+
+        std::unique_ptr<ModuleProfiler> profiler_;
+        std::string profiling_file_;
+        std::string trace_file_;
+
+        // Checkpoints of the run and first event to process when resuming from one
+        std::string checkpoint_file_;
+        unsigned int checkpoint_interval_{};
+        bool resume_{false};
+        unsigned int first_event_{};
+
+        // Flag if the random generators of all modules are seeded for every event
+        bool event_seeding_{false};
+
+        // Number of events run in previous jobs and first event of the current job, from which the event seeds are derived
+        unsigned int job_events_{};
+        unsigned int job_seed_offset_{};
+
+        // Thread pool of the events run on demand, kept until finalizing, and the number of these events
+        std::shared_ptr<ThreadPool> event_thread_pool_;
+        unsigned int events_on_demand_{};
+
+        // Parameter sweep given as module and key, its values and the instantiations of the swept module
+        std::string sweep_name_;
+        std::string sweep_key_;
+        std::vector<std::string> sweep_values_;
+        std::vector<Module*> sweep_modules_;
+
+        // Memory budgets of all events in flight and of a single event (zero if unlimited), the memory of the messages of
+        // all events in flight, and the largest memory of a single event in total and per module and message type
+        uint64_t memory_budget_{};
+        uint64_t event_memory_budget_{};
+        std::atomic<size_t> memory_in_flight_{0};
+        size_t peak_event_memory_{};
+        std::map<std::pair<std::string, std::string>, size_t> peak_message_memory_;
+
+        // Metrics of the run written periodically: the events started and finished in this run, the total number of events
+        // and the number of objects dispatched per message type
+        std::string metrics_file_;
+        std::chrono::duration<double> metrics_interval_{};
+        std::chrono::steady_clock::time_point metrics_start_time_;
+        std::chrono::steady_clock::time_point metrics_time_;
+        unsigned int started_events_{};
+        unsigned int finished_events_{};
+        unsigned int metrics_number_of_events_{};
+        std::map<std::type_index, uint64_t> dispatched_objects_;
+
+        // Node of a module in the dependency graph: its position in the module list, if it is executed by the main thread,
+        // the number of modules it depends on, the modules depending on it and the longest time of the previous events along
+        // any path through the modules depending on it
+        struct ModuleNode {
+            size_t index{};
+            bool main_thread{};
+            size_t dependencies{};
+            std::vector<Module*> dependents;
+            long double critical_path{};
+        };
+        std::map<Module*, ModuleNode> module_graph_;
+        // Flag whether modules submitted to the thread pool are prioritized by their execution time in previous events
+        bool priority_scheduling_{true};
+
+        // Flag whether modules should link the objects they create to the objects they originate from
+        bool object_history_{true};
 
         std::map<std::string, void*> loaded_libraries_;
+        // Number of threads constructing and initializing the instantiations of modules which allow it
+        unsigned int startup_threads_{1};
 
         std::atomic<bool> terminate_;
+
+        uint64_t event_seed_{};
     };
 } // namespace allpix
 
@@ -0,0 +1,220 @@
+/**
+ * @file
+ * @brief Implementation of the profiler measuring the execution of the modules
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ModuleProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Module.hpp"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Hardware counters of the current thread, opened on first use
+     *
+     * Counters are unavailable if the kernel does not allow to access them, in which case they always read zero.
+     */
+    class ThreadCounters {
+    public:
+        ThreadCounters() {
+#ifdef __linux__
+            const std::array<uint64_t, 3> events{
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+            for(size_t i = 0; i < events.size(); ++i) {
+                perf_event_attr attributes{};
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.size = sizeof(perf_event_attr);
+                attributes.config = events[i];
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+                descriptors_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+            }
+            if(std::any_of(descriptors_.begin(), descriptors_.end(), [](int fd) { return fd < 0; })) {
+                LOG(WARNING) << "Hardware counters are not available for this thread, check the value of "
+                             << "/proc/sys/kernel/perf_event_paranoid";
+            }
+#endif
+        }
+        ~ThreadCounters() {
+#ifdef __linux__
+            for(auto fd : descriptors_) {
+                if(fd >= 0) {
+                    close(fd);
+                }
+            }
+#endif
+        }
+        ThreadCounters(const ThreadCounters&) = delete;
+        ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+        std::array<uint64_t, 3> read() const {
+            std::array<uint64_t, 3> values{};
+#ifdef __linux__
+            for(size_t i = 0; i < descriptors_.size(); ++i) {
+                if(descriptors_[i] < 0 || ::read(descriptors_[i], &values[i], sizeof(uint64_t)) != sizeof(uint64_t)) {
+                    values[i] = 0;
+                }
+            }
+#endif
+            return values;
+        }
+
+    private:
+        std::array<int, 3> descriptors_{-1, -1, -1};
+    };
+
+    const ThreadCounters& thread_counters() {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    // Escape a string for use in JSON
+    std::string json_string(const std::string& str) {
+        std::string result = "\"";
+        for(auto character : str) {
+            if(character == '"' || character == '\\') {
+                result += '\\';
+            }
+            result += character;
+        }
+        result += '"';
+        return result;
+    }
+} // namespace
+
+ModuleProfiler::ModuleProfiler(bool hardware_counters) : hardware_counters_(hardware_counters) {}
+
+ModuleProfiler::Sample ModuleProfiler::start() const {
+    Sample sample;
+    if(hardware_counters_) {
+        sample.counters = thread_counters().read();
+    }
+    // Take the time last to exclude reading the counters
+    sample.time = std::chrono::steady_clock::now();
+    return sample;
+}
+
+void ModuleProfiler::stop(const Module* module, Stage stage, const Sample& sample) {
+    auto time = static_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - sample.time).count();
+    std::array<uint64_t, 3> counters{};
+    if(hardware_counters_) {
+        counters = thread_counters().read();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& statistics = statistics_[module];
+    statistics.stage_time[static_cast<unsigned int>(stage)] += time;
+    for(size_t i = 0; i < counters.size(); ++i) {
+        statistics.counters[i] += counters[i] - sample.counters[i];
+    }
+    if(stage != Stage::RUN) {
+        return;
+    }
+
+    // Fill the histogram of the run time per event
+    statistics.min_time = (statistics.events == 0 ? time : std::min(statistics.min_time, time));
+    statistics.max_time = (statistics.events == 0 ? time : std::max(statistics.max_time, time));
+    ++statistics.events;
+
+    size_t bin = 0;
+    if(time > 0) {
+        auto position = std::floor((std::log10(time) - min_decade_) * bins_per_decade_) + 1;
+        bin = static_cast<size_t>(std::clamp(position, 0.0, static_cast<double>(bins_ - 1)));
+    }
+    ++statistics.histogram[bin];
+}
+
+void ModuleProfiler::remove(const Module* module) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.erase(module);
+}
+
+double ModuleProfiler::percentile(const Statistics& statistics, double fraction) {
+    auto target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(statistics.events)));
+    uint64_t count = 0;
+    size_t bin = 0;
+    for(; bin < bins_; ++bin) {
+        count += statistics.histogram[bin];
+        if(count >= target) {
+            break;
+        }
+    }
+    auto upper_edge = std::pow(10.0, min_decade_ + static_cast<double>(bin) / bins_per_decade_);
+    return std::clamp(upper_edge, statistics.min_time, statistics.max_time);
+}
+
+/**
+ * Times are given in seconds. The statistics of the run time per event are only written for modules which have been
+ * executed for at least one event, and the hardware counters only if they have been requested.
+ */
+void ModuleProfiler::write(std::ostream& out,
+                           const std::vector<const Module*>& modules,
+                           long double total_time,
+                           long double event_loop_time,
+                           unsigned int events,
+                           unsigned int workers) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto precision = out.precision(std::numeric_limits<double>::digits10);
+
+    out << "{\n";
+    out << "  \"total_time\": " << total_time << ",\n";
+    out << "  \"event_loop_time\": " << event_loop_time << ",\n";
+    out << "  \"events\": " << events << ",\n";
+    out << "  \"event_rate\": " << (event_loop_time > 0 ? events / event_loop_time : 0) << ",\n";
+    out << "  \"workers\": " << workers << ",\n";
+    out << "  \"modules\": [";
+    for(size_t i = 0; i < modules.size(); ++i) {
+        auto iter = statistics_.find(modules[i]);
+        Statistics statistics = (iter != statistics_.end() ? iter->second : Statistics());
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\n";
+        out << "      \"name\": " << json_string(modules[i]->getUniqueName()) << ",\n";
+        out << "      \"construction_time\": " << statistics.stage_time[0] << ",\n";
+        out << "      \"initialization_time\": " << statistics.stage_time[1] << ",\n";
+        out << "      \"run_time\": " << statistics.stage_time[2] << ",\n";
+        out << "      \"finalization_time\": " << statistics.stage_time[3] << ",\n";
+        out << "      \"events\": " << statistics.events;
+        if(statistics.events > 0) {
+            out << ",\n";
+            out << "      \"run_time_per_event\": {\n";
+            out << "        \"mean\": " << statistics.stage_time[2] / statistics.events << ",\n";
+            out << "        \"min\": " << statistics.min_time << ",\n";
+            out << "        \"p50\": " << percentile(statistics, 0.5) << ",\n";
+            out << "        \"p90\": " << percentile(statistics, 0.9) << ",\n";
+            out << "        \"p99\": " << percentile(statistics, 0.99) << ",\n";
+            out << "        \"max\": " << statistics.max_time << "\n";
+            out << "      }";
+        }
+        if(hardware_counters_) {
+            out << ",\n";
+            out << "      \"counters\": {\n";
+            out << "        \"cycles\": " << statistics.counters[0] << ",\n";
+            out << "        \"instructions\": " << statistics.counters[1] << ",\n";
+            out << "        \"cache_misses\": " << statistics.counters[2] << "\n";
+            out << "      }";
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+
+    out.precision(precision);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief Definition of the profiler measuring the execution of the modules
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_MODULE_PROFILER_H
+#define ALLPIX_MODULE_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace allpix {
+    class Module;
+
+    /**
+     * @brief Profiler collecting detailed timing information of all module instantiations
+     *
+     * Records the time spent in the construction, initialization, run and finalization of every module. The run times are
+     * additionally filled into a histogram with logarithmic bins to derive the percentiles of the time per event. If
+     * requested, hardware counters of the thread executing a module are read using the Linux perf events interface. Only the
+     * calling thread is measured, work a module distributes to the thread pool is therefore not included in its counters.
+     */
+    class ModuleProfiler {
+    public:
+        /**
+         * @brief Stages in the lifetime of a module
+         */
+        enum class Stage : unsigned int { CONSTRUCTION = 0, INITIALIZATION, RUN, FINALIZATION };
+
+        /**
+         * @brief State at the start of a measurement
+         */
+        struct Sample {
+            std::chrono::steady_clock::time_point time;
+            std::array<uint64_t, 3> counters{};
+        };
+
+        /**
+         * @brief Construct the profiler
+         * @param hardware_counters If the hardware counters should be read for every measurement
+         */
+        explicit ModuleProfiler(bool hardware_counters);
+
+        /**
+         * @brief Start a measurement on the calling thread
+         * @return Sample to pass to \ref stop
+         */
+        Sample start() const;
+
+        /**
+         * @brief Finish a measurement on the calling thread and add it to the statistics of a module
+         * @param module Module which has been executed
+         * @param stage Stage of the module which has been executed
+         * @param sample Sample returned by \ref start on the same thread
+         */
+        void stop(const Module* module, Stage stage, const Sample& sample);
+
+        /**
+         * @brief Discard all measurements of a module, used if the module is replaced before the run
+         * @param module Module to discard
+         */
+        void remove(const Module* module);
+
+        /**
+         * @brief Write the report of all measurements as JSON
+         * @param out Stream to write the report to
+         * @param modules Modules to include in the report, in the order of execution
+         * @param total_time Total time of the run in seconds
+         * @param event_loop_time Time of the event loop in seconds, excluding the initialization and finalization
+         * @param events Number of events processed
+         * @param workers Number of worker threads used for the run
+         */
+        void write(std::ostream& out,
+                   const std::vector<const Module*>& modules,
+                   long double total_time,
+                   long double event_loop_time,
+                   unsigned int events,
+                   unsigned int workers) const;
+
+    private:
+        // Logarithmic histogram of the run time from 100 ns to 10000 s, with additional underflow and overflow bins
+        static constexpr int bins_per_decade_ = 20;
+        static constexpr int min_decade_ = -7;
+        static constexpr int max_decade_ = 4;
+        static constexpr size_t bins_ = bins_per_decade_ * (max_decade_ - min_decade_) + 2;
+
+        /**
+         * @brief Statistics of a single module
+         */
+        struct Statistics {
+            std::array<long double, 4> stage_time{};
+            uint64_t events{};
+            double min_time{};
+            double max_time{};
+            std::array<uint64_t, bins_> histogram{};
+            std::array<uint64_t, 3> counters{};
+        };
+
+        /**
+         * @brief Get the run time per event below which a fraction of all events is
+         * @param statistics Statistics of the module
+         * @param fraction Fraction of the events
+         * @return Upper edge of the histogram bin containing the percentile, restricted to the observed range
+         */
+        static double percentile(const Statistics& statistics, double fraction);
+
+        bool hardware_counters_;
+
+        std::map<const Module*, Statistics> statistics_;
+        mutable std::mutex mutex_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_PROFILER_H */
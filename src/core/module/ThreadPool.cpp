@@ -10,44 +10,137 @@
 
 #include "ThreadPool.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "EventTracer.hpp"
 #include "Module.hpp"
+#include "core/utils/log.h"
+#include "core/utils/numa.h"
 
 using namespace allpix;
 
+// Thread local pointer to the pool of the current worker and the index of its queue
+static std::pair<ThreadPool*, unsigned int>& current_worker() {
+    thread_local std::pair<ThreadPool*, unsigned int> worker{nullptr, 0};
+    return worker;
+}
+
 /**
  * The threads are created in an exception-safe way and all of them will be destroyed when creation of one fails
  */
 ThreadPool::ThreadPool(unsigned int num_threads,
                        const std::vector<Module*>& modules,
-                       const std::function<void()>& worker_init_function) {
+                       const std::function<void()>& worker_init_function,
+                       std::vector<unsigned int> worker_cpus)
+    : modules_(modules.begin(), modules.end()), worker_cpus_(std::move(worker_cpus)) {
+    // Create a queue for every worker, or a single queue for the submitting thread if there are no workers
+    for(unsigned int i = 0u; i < std::max(num_threads, 1u); ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+
     // Create threads
     try {
         for(unsigned int i = 0u; i < num_threads; ++i) {
-            threads_.emplace_back(&ThreadPool::worker, this, worker_init_function);
+            threads_.emplace_back(&ThreadPool::worker, this, i, worker_init_function);
         }
     } catch(...) {
         destroy();
         throw;
     }
-
-    // Add module module queues
-    for(auto& module : modules) {
-        // Default constructs a queue for all modules
-        // NOTE: this is the only valid method due to SafeTask not being movable
-        task_queues_[module];
-    }
-    run_cnt_ = 0;
 }
 
-void ThreadPool::submit_module_function(std::function<void()> module_function) {
-    module_queue_.push(std::make_unique<std::packaged_task<void()>>(std::move(module_function)));
-    all_queue_.push(&module_queue_);
+void ThreadPool::submit_module_function(std::function<void()> module_function, long double priority) {
+    push_task({nullptr, std::make_unique<std::packaged_task<void()>>(std::move(module_function)), priority});
 }
 
 ThreadPool::~ThreadPool() {
     destroy();
 }
 
+/**
+ * @throws std::out_of_range If the module is not registered in this thread pool
+ *
+ * Workers add the task to their own queue, other threads distribute the tasks over all queues in turn
+ */
+void ThreadPool::push_task(Task task) {
+    if(task.module != nullptr && modules_.count(task.module) == 0) {
+        throw std::out_of_range("module not registered in thread pool");
+    }
+
+    // Count the task before it becomes visible, to never have a task in the queues which is not counted
+    ++queued_cnt_;
+
+    auto& worker = current_worker();
+    if(worker.first == this) {
+        queues_[worker.second]->push(std::move(task));
+    } else {
+        queues_[next_queue_++ % queues_.size()]->push(std::move(task));
+    }
+
+    notify_waiting();
+}
+
+/**
+ * Waiting threads are only notified if there are any, to avoid taking the mutex for every task
+ */
+void ThreadPool::notify_waiting() {
+    if(waiting_cnt_ > 0) {
+        std::lock_guard<std::mutex> lock{wait_mutex_};
+        wait_condition_.notify_all();
+    }
+}
+
+bool ThreadPool::find_task(Task& out, unsigned int index) {
+    auto num_queues = static_cast<unsigned int>(queues_.size());
+
+    // Take the most recent task from the own queue
+    if(index < num_queues && queues_[index]->pop(out)) {
+        return true;
+    }
+    // Steal the oldest task from any of the other queues
+    for(unsigned int i = 1; i <= num_queues; ++i) {
+        if(queues_[(index + i) % num_queues]->steal(out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * If an exception is thrown by the task, the first exception is saved to propagate in the main thread
+ */
+void ThreadPool::run_task(Task& task) {
+    // Mark the task as running before removing it from the queued count
+    ++run_cnt_;
+    --queued_cnt_;
+
+    try {
+        // Execute task
+        EventTracer::Scope trace(EventTracer::Category::TASK, task.module);
+        (*task.function)();
+        // Fetch the future to propagate exceptions
+        task.function->get_future().get();
+    } catch(...) {
+        // Check if the first exception thrown
+        if(!has_exception_.test_and_set()) {
+            // Save first exception
+            exception_ptr_ = std::current_exception();
+            // Invalidate the queues to terminate other threads
+            valid_ = false;
+            for(auto& queue : queues_) {
+                queued_cnt_ -= static_cast<unsigned int>(queue->clear());
+            }
+        }
+    }
+    task.function.reset();
+
+    // Propagate that the task has been finished
+    --run_cnt_;
+    notify_waiting();
+}
+
 /**
  * @warning This function does not wait for the all the running tasks to finish
  * @warning The module running this function is responsible for handling exceptions in the function called
@@ -56,52 +149,59 @@ ThreadPool::~ThreadPool() {
  * available to execute them.
  */
 bool ThreadPool::execute(Module* module) {
-    // Run tasks until the queue is empty
-    Task task{nullptr};
-    while(task_queues_.at(module).pop(task, false)) {
-        // Execute task
-        (*task)();
-        // Fetch the future to propagate exceptions
-        task->get_future().get();
+    // Run tasks of this module until none are queued anymore
+    Task task;
+    while(valid_) {
+        bool found = false;
+        for(auto& queue : queues_) {
+            if(queue->steal(task, module)) {
+                found = true;
+                break;
+            }
+        }
+        if(!found) {
+            break;
+        }
+
+        ++run_cnt_;
+        --queued_cnt_;
+        try {
+            // Execute task
+            (*task.function)();
+            // Fetch the future to propagate exceptions
+            task.function->get_future().get();
+        } catch(...) {
+            --run_cnt_;
+            notify_waiting();
+            throw;
+        }
+        --run_cnt_;
+        notify_waiting();
     }
-    return task_queues_.at(module).isValid();
+    return valid_;
 }
 
 /**
  * Run by the \ref ModuleManager to ensure all tasks and modules are completed before moving to the next instantiations.
- * Besides waiting for the queue to empty this will also wait for all the tasks to be completed. If an exception is
+ * Besides waiting for the queues to empty this will also wait for all the tasks to be completed. If an exception is
  * thrown by another thread, the exception will be propagated to the main thread by this function.
  */
 bool ThreadPool::execute_all() {
     while(true) {
-        // Run tasks until the queue is empty
-        SafeQueue<Task>* queue_ptr;
-        while(all_queue_.pop(queue_ptr, false)) {
-            Task task{nullptr};
-            if(queue_ptr->pop(task, false)) {
-                try {
-                    // Execute task
-                    (*task)();
-                    // Fetch the future to propagate exceptions
-                    task->get_future().get();
-                } catch(...) {
-                    // Check if the first exception thrown
-                    if(has_exception_.test_and_set()) {
-                        // Check if the first exception thrown
-                        exception_ptr_ = std::current_exception();
-                        // Invalidate the queue to terminate other threads
-                        all_queue_.invalidate();
-                    }
-                }
-            }
+        // Run tasks until all queues are empty
+        Task task;
+        while(valid_ && find_task(task, 0)) {
+            run_task(task);
         }
 
         // Wait for the threads to complete their task, continue helping if a new task was pushed
-        std::unique_lock<std::mutex> lock{run_mutex_};
-        run_condition_.wait(lock, [this]() { return !all_queue_.empty() || run_cnt_ == 0; });
+        std::unique_lock<std::mutex> lock{wait_mutex_};
+        ++waiting_cnt_;
+        wait_condition_.wait(lock, [this]() { return (valid_ && queued_cnt_ > 0) || run_cnt_ == 0; });
+        --waiting_cnt_;
 
-        // Only stop when both the queue is empty and the run count is zero
-        if(all_queue_.empty() && run_cnt_ == 0) {
+        // Only stop when both the queues are empty and the run count is zero
+        if((!valid_ || queued_cnt_ == 0) && run_cnt_ == 0) {
             break;
         }
     }
@@ -113,57 +213,53 @@ bool ThreadPool::execute_all() {
         std::rethrow_exception(exception_ptr_);
     }
 
-    return all_queue_.isValid();
+    return valid_;
 }
 
 /**
- * If an exception is thrown by a module, the first exception is saved to propagate in the main thread
+ * Workers are pinned before running any task, such that memory first touched by a task is allocated on their node
  */
-void ThreadPool::worker(const std::function<void()>& init_function) {
+void ThreadPool::worker(unsigned int index, const std::function<void()>& init_function) {
     // Initialize the worker
     init_function();
-
-    // Safe lambda to increase the atomic run count
-    auto increase_run_cnt_func = [this]() { ++run_cnt_; };
+    current_worker() = std::make_pair(this, index);
+    if(!worker_cpus_.empty()) {
+        auto cpu = worker_cpus_[index % worker_cpus_.size()];
+        if(pin_current_thread(cpu)) {
+            LOG(DEBUG) << "Pinned worker " << index << " to processor " << cpu << " on node " << current_numa_node();
+        } else {
+            LOG(WARNING) << "Could not pin worker " << index << " to processor " << cpu;
+        }
+    }
 
     // Continue running until the thread pool is finished
     while(!done_) {
-        SafeQueue<Task>* queue_ptr;
-        if(all_queue_.pop(queue_ptr, true, increase_run_cnt_func)) {
-            Task task{nullptr};
-            if(queue_ptr->pop(task, false)) {
-                // Try to run task
-                try {
-                    // Execute task
-                    (*task)();
-                    // Fetch the future to propagate exceptions
-                    task->get_future().get();
-                } catch(...) {
-                    // Check if the first exception thrown
-                    if(has_exception_.test_and_set()) {
-                        // Save first exception
-                        exception_ptr_ = std::current_exception();
-                        // Invalidate the queue to terminate other threads
-                        all_queue_.invalidate();
-                    }
-                }
-            }
-
-            // Propagate that the task has been finished
-            std::lock_guard<std::mutex> lock{run_mutex_};
-            --run_cnt_;
-            run_condition_.notify_all();
+        Task task;
+        if(valid_ && find_task(task, index)) {
+            run_task(task);
+            continue;
         }
+
+        // Wait until new tasks are available
+        std::unique_lock<std::mutex> lock{wait_mutex_};
+        ++waiting_cnt_;
+        wait_condition_.wait(lock, [this]() { return (valid_ && queued_cnt_ > 0) || done_; });
+        --waiting_cnt_;
     }
+
+    current_worker() = std::make_pair(nullptr, 0u);
 }
 
 void ThreadPool::destroy() {
     done_ = true;
+    valid_ = false;
 
-    all_queue_.invalidate();
-    module_queue_.invalidate();
-    for(auto& queue : task_queues_) {
-        queue.second.invalidate();
+    for(auto& queue : queues_) {
+        queued_cnt_ -= static_cast<unsigned int>(queue->clear());
+    }
+    {
+        std::lock_guard<std::mutex> lock{wait_mutex_};
+        wait_condition_.notify_all();
     }
 
     for(auto& thread : threads_) {
@@ -172,3 +268,51 @@ void ThreadPool::destroy() {
         }
     }
 }
+
+void ThreadPool::WorkQueue::push(Task task) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if(tasks_.empty() || tasks_.back().priority <= task.priority) {
+        tasks_.push_back(std::move(task));
+        return;
+    }
+    auto iter = std::upper_bound(tasks_.begin(), tasks_.end(), task.priority, [](long double priority, const Task& other) {
+        return priority < other.priority;
+    });
+    tasks_.insert(iter, std::move(task));
+}
+
+bool ThreadPool::WorkQueue::pop(Task& out) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if(tasks_.empty()) {
+        return false;
+    }
+    out = std::move(tasks_.back());
+    tasks_.pop_back();
+    return true;
+}
+
+/**
+ * The tasks are ordered by priority, hence the first task with the priority of the last matching task is stolen
+ */
+bool ThreadPool::WorkQueue::steal(Task& out, Module* module) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto matches = [module](const Task& task) { return module == nullptr || task.module == module; };
+    auto last = std::find_if(tasks_.rbegin(), tasks_.rend(), matches);
+    if(last == tasks_.rend()) {
+        return false;
+    }
+    auto priority = last->priority;
+    auto iter = std::find_if(tasks_.begin(), tasks_.end(), [&](const Task& task) {
+        return task.priority == priority && matches(task);
+    });
+    out = std::move(*iter);
+    tasks_.erase(iter);
+    return true;
+}
+
+size_t ThreadPool::WorkQueue::clear() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto size = tasks_.size();
+    tasks_.clear();
+    return size;
+}
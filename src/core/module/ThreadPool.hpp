@@ -13,13 +13,17 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <exception>
 #include <functional>
 #include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 #include <type_traits>
 #include <utility>
@@ -32,6 +36,11 @@ namespace allpix {
 
     /**
      * @brief Pool of threads where module tasks can be submitted to
+     *
+     * Every worker owns a queue of tasks. Tasks submitted by a worker are added to its own queue, while tasks submitted by
+     * other threads are distributed over the queues of all workers. Workers first execute the most recent tasks of their
+     * own queue and steal the oldest tasks from the queues of other workers if their own queue is empty. This avoids that
+     * short tasks are serialized on a single lock shared by all threads.
      */
     class ThreadPool {
         friend class ModuleManager;
@@ -96,11 +105,13 @@ namespace allpix {
          * @param num_threads Number of threads in the pool
          * @param modules List of module instantiations to create a task queue for
          * @param worker_init_function Function run by all the workers to initialize
+         * @param worker_cpus Processors the workers are pinned to in turn, workers are not pinned if empty
          * @warning Only module instantiations that are registered in this constructor can spawn tasks
          */
         explicit ThreadPool(unsigned int num_threads,
                             const std::vector<Module*>& modules,
-                            const std::function<void()>& worker_init_function);
+                            const std::function<void()>& worker_init_function,
+                            std::vector<unsigned int> worker_cpus = {});
 
         /// @{
         /**
@@ -126,19 +137,83 @@ namespace allpix {
         template <typename Func, typename... Args> auto submit(Module* module, Func&& func, Args&&... args);
 
         /**
-         * @brief Execute jobs from the module queue until all module tasks are finished or an interrupt happened
+         * @brief Execute jobs of the module until all module tasks are started or an interrupt happened
          * @param module Module to run tasks for
          * @return True if module task queue finished, false if stopped for other reason
          */
         bool execute(Module* module);
 
+        /**
+         * @brief Get the number of tasks waiting in the queues of the pool
+         * @return Number of queued tasks, not including the tasks which are executed
+         */
+        unsigned int queuedTasks() const { return queued_cnt_; }
+
+        /**
+         * @brief Get the number of tasks currently executed
+         * @return Number of running tasks
+         */
+        unsigned int runningTasks() const { return run_cnt_; }
+
     private:
+        /**
+         * @brief Task to execute together with the module it belongs to
+         */
+        struct Task {
+            Module* module{nullptr};
+            std::unique_ptr<std::packaged_task<void()>> function;
+            // Tasks with a higher priority are started first, tasks of equal priority keep the order of the queue
+            long double priority{};
+        };
+
+        /**
+         * @brief Queue of tasks owned by a single worker
+         *
+         * The owner adds and takes tasks at the back of the queue, other threads steal tasks from the front. The tasks are
+         * ordered by their priority, such that both the owner and other threads take the tasks with the highest priority
+         * first.
+         */
+        class WorkQueue {
+        public:
+            /**
+             * @brief Add a task to the back of the queue, before all tasks with a higher priority
+             * @param task Task to add
+             */
+            void push(Task task);
+
+            /**
+             * @brief Take the most recently added task from the queue
+             * @param out Reference where the task will be written to
+             * @return True if a task was acquired, false if the queue is empty
+             */
+            bool pop(Task& out);
+
+            /**
+             * @brief Steal the oldest task with the highest priority from the queue
+             * @param out Reference where the task will be written to
+             * @param module Only steal tasks belonging to this module (or any task if a null pointer is given)
+             * @return True if a task was acquired, false if no suitable task is available
+             */
+            bool steal(Task& out, Module* module = nullptr);
+
+            /**
+             * @brief Remove all tasks from the queue
+             * @return Number of removed tasks
+             */
+            size_t clear();
+
+        private:
+            std::mutex mutex_;
+            std::deque<Task> tasks_;
+        };
+
         /**
          * @brief Function to run a single event for a module by the \ref ModuleManager
          * @param module_function Function to execute (should call the run-method of the module)
+         * @param priority Priority of the module, such as its expected execution time, higher priorities are started first
          * @warning This method can only be called by the \ref ModuleManager
          */
-        void submit_module_function(std::function<void()> module_function);
+        void submit_module_function(std::function<void()> module_function, long double priority = 0);
 
         /**
          * @brief Execute jobs from the queue until all tasks and modules are finished or an interrupt happened
@@ -148,30 +223,58 @@ namespace allpix {
         bool execute_all();
 
         /**
-         * @brief Constantly running internal function each thread uses to acquire work items from the queue.
+         * @brief Constantly running internal function each thread uses to acquire work items from the queues
+         * @param index Index of the queue owned by this worker
          * @param init_function Function to initialize the relevant thread_local variables
          */
-        void worker(const std::function<void()>& init_function);
+        void worker(unsigned int index, const std::function<void()>& init_function);
+
+        /**
+         * @brief Add a task to the queue of the current worker or distribute it over the workers for other threads
+         * @param task Task to add
+         */
+        void push_task(Task task);
+
+        /**
+         * @brief Find a task starting with the given queue and stealing from the other queues otherwise
+         * @param out Reference where the task will be written to
+         * @param index Index of the queue to start with (popped from the back, all other queues are stolen from)
+         * @return True if a task was acquired, false if no task is available
+         */
+        bool find_task(Task& out, unsigned int index);
+
+        /**
+         * @brief Execute a task and save the first exception thrown to propagate it later
+         * @param task Task to execute
+         */
+        void run_task(Task& task);
+
+        /**
+         * @brief Wake up threads waiting for new tasks or for all tasks to finish
+         */
+        void notify_waiting();
 
         /**
          * @brief Invalidate all queues and joins all running threads when the pool is destroyed.
          */
         void destroy();
 
-        using Task = std::unique_ptr<std::packaged_task<void()>>;
-
         std::atomic_bool done_{false};
+        std::atomic_bool valid_{true};
 
-        SafeQueue<SafeQueue<Task>*> all_queue_;
-        SafeQueue<Task> module_queue_;
-        std::map<Module*, SafeQueue<Task>> task_queues_;
+        std::vector<std::unique_ptr<WorkQueue>> queues_;
+        std::atomic<unsigned int> next_queue_{0};
+        std::set<Module*> modules_;
 
-        std::atomic<unsigned int> run_cnt_;
-        mutable std::mutex run_mutex_;
-        std::condition_variable run_condition_;
+        std::atomic<unsigned int> queued_cnt_{0};
+        std::atomic<unsigned int> run_cnt_{0};
+        std::atomic<unsigned int> waiting_cnt_{0};
+        mutable std::mutex wait_mutex_;
+        std::condition_variable wait_condition_;
         std::vector<std::thread> threads_;
+        std::vector<unsigned int> worker_cpus_;
 
-        std::atomic_flag has_exception_;
+        std::atomic_flag has_exception_ = ATOMIC_FLAG_INIT;
         std::exception_ptr exception_ptr_{nullptr};
     };
 } // namespace allpix
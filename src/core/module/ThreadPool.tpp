@@ -20,8 +20,7 @@ namespace allpix {
         // Get future and wrapper to add to vector
         auto future = task.get_future();
         auto task_function = [task = std::move(task)]() mutable { task(); };
-        task_queues_.at(module).push(std::make_unique<std::packaged_task<void()>>(std::move(task_function)));
-        all_queue_.push(&task_queues_.at(module));
+        push_task({module, std::make_unique<std::packaged_task<void()>>(std::move(task_function))});
         return future;
     }
 
@@ -7,6 +7,10 @@
  * - ALLPIX_MODULE_HEADER: name of the header defining the module
  * - ALLPIX_MODULE_UNIQUE: true if the module is unique, false otherwise
  *
+ * Modules built into the executable additionally need the following names, see \ref ModuleManager::registerStaticModule
+ * - ALLPIX_MODULE_STATIC_NAME: name of the module used in the configuration
+ * - ALLPIX_MODULE_STATIC_REGISTER: name of the function registering the module, called by the executable
+ *
  * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
  * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
  * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
@@ -24,13 +28,22 @@
 #include "core/geometry/Detector.hpp"
 #include "core/utils/log.h"
 
+#ifdef ALLPIX_MODULE_STATIC_REGISTER
+#include "core/module/ModuleManager.hpp"
+#endif
+
 #include ALLPIX_MODULE_HEADER
 
 namespace allpix {
     class Messenger;
     class GeometryManager;
 
+    // Modules built into the executable keep their interface functions local, such that they do not clash between modules
+#ifdef ALLPIX_MODULE_STATIC_REGISTER
+    namespace {
+#else
     extern "C" {
+#endif
     /**
      * @brief Returns the type of the Module it is linked to
      *
@@ -81,4 +94,18 @@ namespace allpix {
     bool allpix_module_is_unique() { return false; }
 #endif
     }
+
+#ifdef ALLPIX_MODULE_STATIC_REGISTER
+    /**
+     * @brief Registers the module built into the executable with the ModuleManager
+     *
+     * Called by the executable on startup, which also ensures that the module is linked into it.
+     */
+    void ALLPIX_MODULE_STATIC_REGISTER();
+    void ALLPIX_MODULE_STATIC_REGISTER() {
+        ModuleManager::registerStaticModule(ALLPIX_MODULE_STATIC_NAME,
+                                            allpix_module_is_unique(),
+                                            reinterpret_cast<void*>(&allpix_module_generator)); // NOLINT
+    }
+#endif
 } // namespace allpix
@@ -121,6 +121,20 @@ namespace allpix {
         // TODO [doc] the module itself is missing
         explicit EndOfRunException(std::string reason) { error_message_ = std::move(reason); }
     };
+
+    /**
+     * @ingroup Exceptions
+     * @brief Exception for a job of the simulation server that cannot be run
+     * @note Non-fatal error raised before any module configuration is changed, the server continues with the next job
+     */
+    class InvalidJobError : public RuntimeError {
+    public:
+        /**
+         * @brief Constructs error with a description
+         * @param reason Text explaining why the job cannot be run
+         */
+        explicit InvalidJobError(std::string reason) { error_message_ = std::move(reason); }
+    };
 } // namespace allpix
 
 #endif /* ALLPIX_MODULE_EXCEPTIONS_H */
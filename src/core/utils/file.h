@@ -18,9 +18,11 @@
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <dirent.h>
 #include <ftw.h>
+#include <glob.h>
 #include <libgen.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -133,6 +135,33 @@ namespace allpix {
         return files;
     }
 
+    /**
+     * @brief Get all files matching a shell wildcard pattern
+     * @param pattern Path to the files, which can contain the wildcards `*`, `?` and `[...]`
+     * @return A list with the full names of all matching files, sorted by name
+     *
+     * Paths without wildcards are returned unchanged, independent of the existence of the file.
+     */
+    inline std::vector<std::string> get_files_matching(const std::string& pattern) {
+        if(pattern.find_first_of("*?[") == std::string::npos) {
+            return {pattern};
+        }
+
+        std::vector<std::string> files;
+        glob_t matches;
+        if(glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+            for(size_t i = 0; i < matches.gl_pathc; ++i) {
+                // Ignore subdirectories
+                struct stat st;
+                if(stat(matches.gl_pathv[i], &st) == 0 && (st.st_mode & S_IFDIR) == 0) {
+                    files.emplace_back(matches.gl_pathv[i]);
+                }
+            }
+        }
+        globfree(&matches);
+        return files;
+    }
+
     /**
      * @brief Create a directory
      * @param path The path to create
@@ -0,0 +1,107 @@
+/**
+ * @file
+ * @brief Implementation of the utilities to back large arrays with huge pages
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "huge_pages.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "log.h"
+
+using namespace allpix;
+
+namespace {
+    std::atomic<HugePages> huge_page_mode{HugePages::NONE};
+    std::atomic<bool> reported_fallback{false};
+
+    // Size of the transparent huge pages, which is the size of the huge pages of most systems
+    constexpr size_t transparent_page_size = size_t(2) << 20;
+
+    size_t round_up(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+} // namespace
+
+void allpix::set_huge_pages(HugePages mode) {
+    huge_page_mode = mode;
+}
+
+HugePages allpix::huge_pages() {
+    return huge_page_mode;
+}
+
+/**
+ * Transparent huge pages are only used for full pages of 2MB, so the mapping is padded by one page to align its start.
+ */
+std::shared_ptr<void> allpix::allocate_huge_pages(size_t size) {
+#ifdef __linux__
+    auto mode = huge_page_mode.load();
+    if(mode != HugePages::NONE && size > 0) {
+#ifdef MAP_HUGE_SHIFT
+        if(mode == HugePages::EXPLICIT_2MB || mode == HugePages::EXPLICIT_1GB) {
+            auto page_shift = (mode == HugePages::EXPLICIT_1GB ? 30 : 21);
+            auto length = round_up(size, size_t(1) << page_shift);
+            void* mapping = mmap(nullptr,
+                                 length,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT),
+                                 -1,
+                                 0);
+            if(mapping != MAP_FAILED) { // NOLINT
+                return {mapping, [length](void* memory) { munmap(memory, length); }};
+            }
+            if(!reported_fallback.exchange(true)) {
+                LOG(WARNING) << "Not enough huge pages of " << (mode == HugePages::EXPLICIT_1GB ? "1GB" : "2MB")
+                             << " reserved, using transparent huge pages instead";
+            }
+        }
+#endif
+
+        auto length = round_up(size, transparent_page_size) + transparent_page_size;
+        void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapping != MAP_FAILED) { // NOLINT
+            auto address = reinterpret_cast<uintptr_t>(mapping);
+            auto* aligned = reinterpret_cast<void*>(round_up(address, transparent_page_size));
+#ifdef MADV_HUGEPAGE
+            madvise(aligned, round_up(size, transparent_page_size), MADV_HUGEPAGE);
+#endif
+            return {aligned, [mapping, length](void*) { munmap(mapping, length); }};
+        }
+    }
+#endif
+    return {::operator new(size), [](void* memory) { ::operator delete(memory); }};
+}
+
+void allpix::advise_huge_pages(const void* data, size_t size) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if(huge_page_mode.load() == HugePages::NONE || data == nullptr) {
+        return;
+    }
+
+    // Only advise the full huge pages covered by the array
+    auto begin = round_up(reinterpret_cast<uintptr_t>(data), transparent_page_size);
+    auto end = (reinterpret_cast<uintptr_t>(data) + size) / transparent_page_size * transparent_page_size;
+    if(end <= begin) {
+        return;
+    }
+    auto* address = reinterpret_cast<void*>(begin);
+    if(madvise(address, end - begin, MADV_HUGEPAGE) != 0) {
+        return;
+    }
+#ifdef MADV_COLLAPSE
+    madvise(address, end - begin, MADV_COLLAPSE);
+#endif
+#else
+    (void)data;
+    (void)size;
+#endif
+}
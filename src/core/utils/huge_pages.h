@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Utilities to back large read-mostly arrays such as field grids with huge pages
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_HUGE_PAGES_H
+#define ALLPIX_HUGE_PAGES_H
+
+#include <cstddef>
+#include <memory>
+
+namespace allpix {
+
+    /**
+     * @brief Type of huge pages used for large arrays
+     */
+    enum class HugePages {
+        NONE = 0,     ///< Regular pages
+        TRANSPARENT,  ///< Transparent huge pages of the kernel, requested through memory advice
+        EXPLICIT_2MB, ///< Huge pages of 2MB reserved by the system administrator
+        EXPLICIT_1GB, ///< Huge pages of 1GB reserved by the system administrator
+    };
+
+    /**
+     * @brief Select the huge pages used for arrays allocated or advised afterwards
+     * @param mode Type of huge pages
+     */
+    void set_huge_pages(HugePages mode);
+
+    /**
+     * @brief Get the type of huge pages used for large arrays
+     * @return Type of huge pages, regular pages by default
+     */
+    HugePages huge_pages();
+
+    /**
+     * @brief Allocate memory for a large array, backed by huge pages as selected
+     * @param size Size of the memory in bytes
+     * @return Shared pointer to the memory, aligned to at least the size of the pages and released with the last reference
+     *
+     * Explicit huge pages are mapped from the pages reserved on the system. If not enough pages are reserved, a warning is
+     * logged once and transparent huge pages are used instead. Transparent huge pages are mapped aligned to 2MB and advised
+     * before the memory is touched, such that the kernel backs it with huge pages on first use. Without huge pages, the
+     * memory is allocated with the regular allocator.
+     */
+    std::shared_ptr<void> allocate_huge_pages(size_t size);
+
+    /**
+     * @brief Advise the kernel to back an existing array with transparent huge pages
+     * @param data Pointer to the first byte of the array
+     * @param size Size of the array in bytes
+     *
+     * Only the part of the array covering full huge pages of 2MB is advised. Pages of the array already in use are collapsed
+     * into huge pages right away if supported by the kernel, otherwise they are collapsed in the background. Does nothing
+     * without huge pages or for memory which cannot be backed by transparent huge pages, such as read-only file mappings.
+     */
+    void advise_huge_pages(const void* data, size_t size);
+} // namespace allpix
+
+#endif /* ALLPIX_HUGE_PAGES_H */
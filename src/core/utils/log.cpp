@@ -13,11 +13,11 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <condition_variable>
 #include <exception>
 #include <iomanip>
 #include <iostream>
 #include <ostream>
-#include <regex>
 #include <string>
 #include <thread>
 #include <unistd.h>
@@ -30,6 +30,38 @@ std::string DefaultLogger::last_identifier_;
 std::string DefaultLogger::last_message_;
 // Mutex to guard output writing
 std::mutex DefaultLogger::write_mutex_;
+// Mutex to guard the list of streams and writing to them
+std::mutex DefaultLogger::streams_mutex_;
+
+namespace {
+    /**
+     * @brief State of the background thread writing the log messages in asynchronous mode
+     */
+    struct AsyncWriter {
+        ~AsyncWriter() { stop(); }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            condition.notify_one();
+            if(thread.joinable()) {
+                thread.join();
+            }
+        }
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<std::string> queue;
+        bool running{false};
+    };
+    AsyncWriter& async_writer() {
+        static AsyncWriter writer;
+        return writer;
+    }
+} // namespace
 
 /**
  * The logger will save the number of uncaught exceptions during construction to compare that with the number of exceptions
@@ -97,6 +129,26 @@ DefaultLogger::~DefaultLogger() {
         out += '\n';
     }
 
+    // Queue the message for the background thread if writing asynchronously, keeping the order of the messages
+    auto& writer = async_writer();
+    if(writer.running) {
+        {
+            std::lock_guard<std::mutex> queue_lock(writer.mutex);
+            writer.queue.push_back(std::move(out));
+        }
+        writer.condition.notify_one();
+        return;
+    }
+
+    write_streams(out);
+}
+
+/**
+ * Terminals receive the message as is, all other streams receive a version without special terminal characters where
+ * carriage returns are replaced by newlines. The streams are guarded by their own mutex instead of the write mutex, as the
+ * background thread is joined while the write mutex is held.
+ */
+void DefaultLogger::write_streams(const std::string& out) {
     // Create a version without any special terminal characters
     std::string out_no_special;
     size_t prev = 0, pos = 0;
@@ -110,12 +162,10 @@ DefaultLogger::~DefaultLogger() {
     out_no_special += out.substr(prev);
 
     // Replace carriage return by newline:
-    try {
-        out_no_special = std::regex_replace(out_no_special, std::regex("\\\r"), "\n");
-    } catch(std::regex_error&) {
-    }
+    std::replace(out_no_special.begin(), out_no_special.end(), '\r', '\n');
 
     // Print output to streams
+    std::lock_guard<std::mutex> streams_lock(streams_mutex_);
     for(auto stream : get_streams()) {
         if(is_terminal(*stream)) {
             (*stream) << out;
@@ -124,7 +174,48 @@ DefaultLogger::~DefaultLogger() {
         }
         (*stream).flush();
     }
-    lock.unlock();
+}
+
+/**
+ * The background thread is only accessed while holding the write mutex, such that no message can be queued after the thread
+ * has been stopped. Messages queued before are written by the thread before it terminates.
+ */
+void DefaultLogger::setAsynchronous(bool asynchronous) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto& writer = async_writer();
+    if(asynchronous == writer.running) {
+        return;
+    }
+
+    if(!asynchronous) {
+        writer.stop();
+        return;
+    }
+
+    writer.running = true;
+    writer.thread = std::thread([&writer]() {
+        std::vector<std::string> messages;
+        std::unique_lock<std::mutex> queue_lock(writer.mutex);
+        while(true) {
+            writer.condition.wait(queue_lock, [&writer]() { return !writer.queue.empty() || !writer.running; });
+            if(writer.queue.empty()) {
+                break;
+            }
+
+            // Write all queued messages without blocking the logging threads
+            messages.swap(writer.queue);
+            queue_lock.unlock();
+            for(auto& message : messages) {
+                write_streams(message);
+            }
+            messages.clear();
+            queue_lock.lock();
+        }
+    });
+}
+bool DefaultLogger::isAsynchronous() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return async_writer().running;
 }
 
 /**
@@ -132,8 +223,12 @@ DefaultLogger::~DefaultLogger() {
  * @note Does not close the streams
  */
 void DefaultLogger::finish() {
+    // Write all queued messages first
+    setAsynchronous(false);
+
     // Lock the mutex to guard output writing
     std::lock_guard<std::mutex> lock(write_mutex_);
+    std::lock_guard<std::mutex> streams_lock(streams_mutex_);
 
     if(!last_identifier_.empty()) {
         // Flush final line if necessary
@@ -202,9 +297,10 @@ DefaultLogger::getStream(LogLevel level, const std::string& file, const std::str
     os << "\x1B[0m"; // RESET
 
     // Add section if available
-    if(!get_section().empty()) {
+    const auto& section = get_current_section();
+    if(!section.empty()) {
         os << "\x1B[1m"; // BOLD
-        os << "[" << get_section() << "] ";
+        os << "[" << section << "] ";
         os << "\x1B[0m"; // RESET
     }
 
@@ -337,6 +433,7 @@ std::vector<std::ostream*>& DefaultLogger::get_streams() {
     return streams;
 }
 void DefaultLogger::clearStreams() {
+    std::lock_guard<std::mutex> streams_lock(streams_mutex_);
     get_streams().clear();
 }
 /**
@@ -346,6 +443,8 @@ void DefaultLogger::clearStreams() {
  * @note Streams cannot be individually removed at the moment and only all at once using \ref clearStreams().
  */
 void DefaultLogger::addStream(std::ostream& stream) {
+    std::lock_guard<std::mutex> streams_lock(streams_mutex_);
+
     // Disable cursor if stream supports it
     if(is_terminal(stream)) {
         stream << "\x1B[?25l";
@@ -359,11 +458,25 @@ std::string& DefaultLogger::get_section() {
     thread_local std::string section;
     return section;
 }
+const std::string*& DefaultLogger::get_section_pointer() {
+    thread_local const std::string* section = nullptr;
+    return section;
+}
+const std::string& DefaultLogger::get_current_section() {
+    const auto* section = get_section_pointer();
+    return (section != nullptr ? *section : get_section());
+}
 void DefaultLogger::setSection(std::string section) {
     get_section() = std::move(section);
+    get_section_pointer() = nullptr;
 }
 std::string DefaultLogger::getSection() {
-    return get_section();
+    return get_current_section();
+}
+const std::string* DefaultLogger::swapSection(const std::string* section) {
+    auto* previous = get_section_pointer();
+    get_section_pointer() = section;
+    return previous;
 }
 
 /**
@@ -111,6 +111,21 @@ namespace allpix {
          */
         static void finish();
 
+        /**
+         * @brief Enable or disable writing the log messages asynchronously
+         * @param asynchronous True if messages should be written by a background thread, false to write them directly
+         *
+         * If enabled, finished log messages are only queued and the streams are written by a dedicated thread, such that
+         * threads logging concurrently do not wait for the output. Disabling the asynchronous mode, or calling \ref finish,
+         * writes all queued messages before returning.
+         */
+        static void setAsynchronous(bool asynchronous);
+        /**
+         * @brief Check if the log messages are written asynchronously
+         * @return True if messages are written by a background thread, false otherwise
+         */
+        static bool isAsynchronous();
+
         /**
          * @brief Get the reporting level for logging
          * @return The current log level
@@ -184,6 +199,16 @@ namespace allpix {
          * @return Header used
          */
         static std::string getSection();
+        /**
+         * @brief Use a section header from now on without copying it
+         * @param header Pointer to the header to use, which has to outlive its use, or nullptr to use the header set last by
+         * \ref setSection
+         * @return Pointer to the header used before, to be passed to this method again to restore it
+         *
+         * Allows to switch between headers prepared in advance without any allocation, for example for every module and
+         * event. Setting a header with \ref setSection stops using the given header.
+         */
+        static const std::string* swapSection(const std::string* header);
 
     private:
         /**
@@ -204,6 +229,12 @@ namespace allpix {
          */
         static bool is_terminal(std::ostream& stream);
 
+        /**
+         * @brief Write a finished log message to all streams
+         * @param out Formatted message including special terminal characters
+         */
+        static void write_streams(const std::string& out);
+
         // Output stream
         std::ostringstream os;
 
@@ -214,6 +245,8 @@ namespace allpix {
 
         // Internal methods to store static values
         static std::string& get_section();
+        static const std::string*& get_section_pointer();
+        static const std::string& get_current_section();
         static LogLevel& get_reporting_level();
         static LogFormat& get_format();
         static std::vector<std::ostream*>& get_streams();
@@ -224,6 +257,7 @@ namespace allpix {
         static std::string last_identifier_;
 
         static std::mutex write_mutex_;
+        static std::mutex streams_mutex_;
     };
 
     using Log = DefaultLogger;
@@ -0,0 +1,212 @@
+/**
+ * @file
+ * @brief Implementation of the utilities to place threads and memory on the nodes of the system
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "numa.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace allpix;
+
+namespace {
+    std::atomic<bool> replication_enabled{false};
+
+    // Node of the calling thread, determined on first use
+    int& thread_node() {
+        thread_local int node = -1;
+        return node;
+    }
+
+    // Parse a list of processors in the format used by sysfs, e.g. "0-3,8-11"
+    std::vector<unsigned int> parse_cpu_list(const std::string& list) {
+        std::vector<unsigned int> cpus;
+        std::stringstream stream(list);
+        std::string range;
+        while(std::getline(stream, range, ',')) {
+            auto dash = range.find('-');
+            try {
+                auto first = static_cast<unsigned int>(std::stoul(range.substr(0, dash)));
+                auto last = first;
+                if(dash != std::string::npos) {
+                    last = static_cast<unsigned int>(std::stoul(range.substr(dash + 1)));
+                }
+                for(auto cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            } catch(std::logic_error&) {
+                continue;
+            }
+        }
+        return cpus;
+    }
+
+    std::vector<std::vector<unsigned int>> read_topology() {
+        std::vector<std::vector<unsigned int>> nodes;
+#ifdef __linux__
+        // Only keep the processors the process is allowed to run on
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool has_mask = (sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+        auto is_allowed = [&](unsigned int cpu) { return !has_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)); };
+
+        std::map<unsigned int, std::vector<unsigned int>> node_cpus;
+        DIR* directory = opendir("/sys/devices/system/node");
+        if(directory != nullptr) {
+            struct dirent* entry = nullptr;
+            while((entry = readdir(directory)) != nullptr) {
+                std::string name = entry->d_name;
+                if(name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                   name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                    continue;
+                }
+                std::ifstream file("/sys/devices/system/node/" + name + "/cpulist");
+                std::string list;
+                std::getline(file, list);
+                auto cpus = parse_cpu_list(list);
+                cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](unsigned int cpu) { return !is_allowed(cpu); }),
+                           cpus.end());
+                if(!cpus.empty()) {
+                    node_cpus[static_cast<unsigned int>(std::stoul(name.substr(4)))] = cpus;
+                }
+            }
+            closedir(directory);
+        }
+        for(auto& node : node_cpus) {
+            nodes.push_back(node.second);
+        }
+
+        // Fall back to a single node with all allowed processors
+        if(nodes.empty() && has_mask) {
+            std::vector<unsigned int> cpus;
+            for(unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if(CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            nodes.push_back(cpus);
+        }
+#endif
+        if(nodes.empty()) {
+            std::vector<unsigned int> cpus;
+            for(unsigned int cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu) {
+                cpus.push_back(cpu);
+            }
+            nodes.push_back(cpus);
+        }
+        return nodes;
+    }
+
+    // Find the node of a processor, defaulting to the first node
+    unsigned int node_of_cpu(unsigned int cpu) {
+        const auto& nodes = numa_node_cpus();
+        for(unsigned int node = 0; node < nodes.size(); ++node) {
+            if(std::find(nodes[node].begin(), nodes[node].end(), cpu) != nodes[node].end()) {
+                return node;
+            }
+        }
+        return 0;
+    }
+} // namespace
+
+const std::vector<std::vector<unsigned int>>& allpix::numa_node_cpus() {
+    static const std::vector<std::vector<unsigned int>> nodes = read_topology();
+    return nodes;
+}
+
+unsigned int allpix::numa_node_count() {
+    return static_cast<unsigned int>(numa_node_cpus().size());
+}
+
+unsigned int allpix::current_numa_node() {
+    auto& node = thread_node();
+    if(node < 0) {
+#ifdef __linux__
+        auto cpu = sched_getcpu();
+        node = (cpu < 0 ? 0 : static_cast<int>(node_of_cpu(static_cast<unsigned int>(cpu))));
+#else
+        node = 0;
+#endif
+    }
+    return static_cast<unsigned int>(node);
+}
+
+bool allpix::pin_current_thread(unsigned int cpu) {
+#ifdef __linux__
+    if(cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        return false;
+    }
+    thread_node() = static_cast<int>(node_of_cpu(cpu));
+    return true;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/**
+ * With the compact policy, the workers fill the processors of the first node before moving to the next node. With the
+ * scatter policy, consecutive workers are placed on different nodes. If there are more workers than processors, the
+ * assignment starts again from the first processor.
+ */
+std::vector<unsigned int> allpix::worker_cpus(const std::string& policy, unsigned int workers) {
+    const auto& nodes = numa_node_cpus();
+    std::vector<unsigned int> order;
+    if(policy == "none") {
+        return {};
+    } else if(policy == "compact") {
+        for(const auto& node : nodes) {
+            order.insert(order.end(), node.begin(), node.end());
+        }
+    } else if(policy == "scatter") {
+        size_t max_size = 0;
+        for(const auto& node : nodes) {
+            max_size = std::max(max_size, node.size());
+        }
+        for(size_t i = 0; i < max_size; ++i) {
+            for(const auto& node : nodes) {
+                if(i < node.size()) {
+                    order.push_back(node[i]);
+                }
+            }
+        }
+    } else {
+        throw std::invalid_argument("unknown placement policy '" + policy + "', use 'none', 'compact' or 'scatter'");
+    }
+
+    std::vector<unsigned int> cpus;
+    for(unsigned int worker = 0; worker < workers && !order.empty(); ++worker) {
+        cpus.push_back(order[worker % order.size()]);
+    }
+    return cpus;
+}
+
+void allpix::set_numa_replication(bool enable) {
+    replication_enabled = enable;
+}
+
+bool allpix::numa_replication() {
+    return replication_enabled && numa_node_count() > 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file
+ * @brief Utilities to place threads and memory on the nodes of systems with non-uniform memory access
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_NUMA_H
+#define ALLPIX_NUMA_H
+
+#include <string>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Get the processors of all memory nodes the current process is allowed to run on
+     * @return List of the processor numbers of every node, with empty nodes removed
+     *
+     * The topology is read from the sysfs interface of the Linux kernel once and cached. If it is unavailable, all allowed
+     * processors are assigned to a single node.
+     */
+    const std::vector<std::vector<unsigned int>>& numa_node_cpus();
+
+    /**
+     * @brief Get the number of memory nodes with processors the current process is allowed to run on
+     * @return Number of memory nodes, at least one
+     */
+    unsigned int numa_node_count();
+
+    /**
+     * @brief Get the memory node of the calling thread
+     * @return Index of the node in the list of \ref numa_node_cpus
+     *
+     * The node is determined at the first call of every thread, or when the thread is pinned by \ref pin_current_thread.
+     * Threads which are not pinned can migrate to another node later, such that the node should only be used as hint.
+     */
+    unsigned int current_numa_node();
+
+    /**
+     * @brief Restrict the calling thread to run on a single processor
+     * @param cpu Number of the processor
+     * @return True if the thread has been pinned, false if this is not supported or not allowed
+     */
+    bool pin_current_thread(unsigned int cpu);
+
+    /**
+     * @brief Get the processors to pin a number of workers to
+     * @param policy Placement of the workers, either "none", "compact" to fill the nodes one after another or "scatter" to
+     * distribute the workers over the nodes in turn
+     * @param workers Number of workers
+     * @return Processor for every worker, empty if the workers should not be pinned
+     * @throws std::invalid_argument If the policy is unknown
+     */
+    std::vector<unsigned int> worker_cpus(const std::string& policy, unsigned int workers);
+
+    /**
+     * @brief Enable or disable replicating read-only field grids on every memory node
+     * @param enable True if fields set up afterwards should be replicated
+     */
+    void set_numa_replication(bool enable);
+
+    /**
+     * @brief Check if read-only field grids should be replicated on every memory node
+     * @return True if replication is enabled and the system has more than one node
+     */
+    bool numa_replication();
+} // namespace allpix
+
+#endif /* ALLPIX_NUMA_H */
@@ -0,0 +1,139 @@
+/**
+ * @file
+ * @brief Counter-based pseudo-random number generator
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PRNG_H
+#define ALLPIX_PRNG_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace allpix {
+
+    /**
+     * @brief Counter-based random engine implementing the Philox4x32-10 algorithm
+     *
+     * Implementation of the Philox generator from https://doi.org/10.1145/2063384.2063405. Every block of random numbers is
+     * computed by encrypting a counter with a key, such that the engine only stores the key, the counter and a single output
+     * block. Engines are therefore cheap to construct, and any number of independent streams can be obtained from the same
+     * key by using different stream numbers, without any seeding procedure. The engine satisfies the requirements of a
+     * uniform random bit generator and can be used with all standard random number distributions.
+     *
+     * The 128 bit counter is split into the 64 bit number of the stream and the 64 bit index of the block in the stream.
+     */
+    class PhiloxRandomEngine {
+    public:
+        using result_type = uint64_t;
+
+        /**
+         * @brief Construct the engine for a stream of a key
+         * @param key Key of the engine, typically a seed provided by the framework
+         * @param stream Number of the independent stream for the key
+         */
+        explicit PhiloxRandomEngine(uint64_t key = 0, uint64_t stream = 0) { seed(key, stream); }
+
+        /**
+         * @brief Reset the engine to the start of a stream of a key
+         * @param key Key of the engine, typically a seed provided by the framework
+         * @param stream Number of the independent stream for the key
+         */
+        void seed(uint64_t key, uint64_t stream = 0) {
+            key_ = {static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32u)};
+            stream_ = stream;
+            block_ = 0;
+            index_ = results_per_block;
+        }
+
+        /**
+         * @brief Generate the next random number
+         * @return Random number uniformly distributed over all values of the result type
+         */
+        result_type operator()() {
+            if(index_ == results_per_block) {
+                generate_block();
+                block_++;
+                index_ = 0;
+            }
+
+            auto result = (static_cast<uint64_t>(output_[2 * index_]) << 32u) | output_[2 * index_ + 1];
+            index_++;
+            return result;
+        }
+
+        /**
+         * @brief Advance the engine by a number of random numbers
+         * @param count Number of random numbers to skip
+         *
+         * Skipping random numbers only changes the counter and therefore takes constant time.
+         */
+        void discard(unsigned long long count) {
+            auto position = block_ * results_per_block - (results_per_block - index_) + count;
+            block_ = position / results_per_block;
+            index_ = results_per_block;
+            if(position % results_per_block != 0) {
+                generate_block();
+                block_++;
+                index_ = static_cast<unsigned int>(position % results_per_block);
+            }
+        }
+
+        /**
+         * @brief Smallest value returned by the engine
+         */
+        static constexpr result_type min() { return std::numeric_limits<result_type>::min(); }
+        /**
+         * @brief Largest value returned by the engine
+         */
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        /**
+         * @brief Compare two engines
+         * @return True if both engines produce the same sequence of random numbers, false otherwise
+         */
+        bool operator==(const PhiloxRandomEngine& other) const {
+            return key_ == other.key_ && stream_ == other.stream_ &&
+                   block_ * results_per_block + index_ == other.block_ * results_per_block + other.index_;
+        }
+        bool operator!=(const PhiloxRandomEngine& other) const { return !(*this == other); }
+
+    private:
+        static constexpr unsigned int results_per_block = 2;
+
+        /**
+         * @brief Compute the output block for the current counter
+         */
+        void generate_block() {
+            std::array<uint32_t, 4> counter{static_cast<uint32_t>(block_),
+                                            static_cast<uint32_t>(block_ >> 32u),
+                                            static_cast<uint32_t>(stream_),
+                                            static_cast<uint32_t>(stream_ >> 32u)};
+            auto key = key_;
+            for(unsigned int round = 0; round < 10; ++round) {
+                auto product0 = static_cast<uint64_t>(0xD2511F53u) * counter[0];
+                auto product1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2];
+                counter = {static_cast<uint32_t>(product1 >> 32u) ^ counter[1] ^ key[0],
+                           static_cast<uint32_t>(product1),
+                           static_cast<uint32_t>(product0 >> 32u) ^ counter[3] ^ key[1],
+                           static_cast<uint32_t>(product0)};
+                key[0] += 0x9E3779B9u;
+                key[1] += 0xBB67AE85u;
+            }
+            output_ = counter;
+        }
+
+        std::array<uint32_t, 2> key_{};
+        uint64_t stream_{};
+        uint64_t block_{};
+
+        std::array<uint32_t, 4> output_{};
+        unsigned int index_{results_per_block};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PRNG_H */
@@ -11,12 +11,14 @@
 #include "unit.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 
 #include "text.h"
 
@@ -24,6 +26,14 @@ using namespace allpix;
 
 std::map<std::string, allpix::Units::UnitType> Units::unit_map_;
 
+namespace {
+    // Generation of the unit definitions, incremented whenever a unit is added to invalidate the caches of parsed units
+    std::atomic<unsigned int> unit_generation{0};
+
+    // Largest number of parsed unit strings kept in the cache of a single thread
+    constexpr size_t max_cached_units = 1024;
+} // namespace
+
 /**
  * @throws std::invalid_argument If the unit already exists
  *
@@ -41,6 +51,7 @@ void Units::add(std::string str, UnitType value) {
         throw std::invalid_argument("unit " + str + " already defined");
     }
     unit_map_.emplace(str, value);
+    ++unit_generation;
 }
 
 /**
@@ -64,6 +75,31 @@ allpix::Units::UnitType Units::getSingle(std::string str) {
     return iter->second;
 }
 
+/**
+ * @throws std::invalid_argument If the string contains a unit which does not exist
+ *
+ * Every thread keeps a cache of the strings parsed before, which is cleared when new units are added or when it grows too
+ * large. Strings with invalid units are not cached and throw again on the next lookup.
+ */
+allpix::Units::UnitType Units::get(const std::string& str) {
+    thread_local std::unordered_map<std::string, UnitType> cache;
+    thread_local unsigned int cache_generation = 0;
+
+    auto generation = unit_generation.load(std::memory_order_relaxed);
+    if(cache_generation != generation || cache.size() >= max_cached_units) {
+        cache.clear();
+        cache_generation = generation;
+    }
+
+    auto iter = cache.find(str);
+    if(iter != cache.end()) {
+        return iter->second;
+    }
+    auto value = parse(str);
+    cache.emplace(str, value);
+    return value;
+}
+
 /**
  * @throws invalid_argument If one tries to get the value of an empty unit
  *
@@ -71,7 +107,7 @@ allpix::Units::UnitType Units::getSingle(std::string str) {
  * always multiplied, following common sense. Grouping units together within brackets or parentheses is not supported. Thus
  * any other character then a name of a unit, * or \ should lead to an error
  */
-allpix::Units::UnitType Units::get(const std::string& str) {
+allpix::Units::UnitType Units::parse(const std::string& str) {
     UnitType ret_value = 1;
     if(allpix::trim(str).empty()) {
         return ret_value;
@@ -104,34 +140,11 @@ allpix::Units::UnitType Units::get(const std::string& str) {
     return ret_value;
 }
 
+/**
+ * The input is divided by the value of the combined units, which is taken from the cache of parsed units
+ */
 allpix::Units::UnitType Units::convert(UnitType input, std::string str) {
-    // Do not distinguish between different case for units
-    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-
-    // Go through all units
-    char lst = '*';
-    std::string unit;
-    for(char ch : str) {
-        if(ch == '*' || ch == '/') {
-            if(lst == '*') {
-                input = getSingleInverse(input, unit);
-                unit.clear();
-            } else if(lst == '/') {
-                input = getSingle(input, unit);
-                unit.clear();
-            }
-            lst = ch;
-        } else {
-            unit += ch;
-        }
-    }
-    // Handle last unit
-    if(lst == '*') {
-        input = getSingleInverse(input, unit);
-    } else if(lst == '/') {
-        input = getSingle(input, unit);
-    }
-    return input;
+    return input / get(str);
 }
 
 /**
@@ -142,29 +155,34 @@ allpix::Units::UnitType Units::convert(UnitType input, std::string str) {
  * - If there exists at least one unit for which the value is larger than one, the unit with value nearest to one is chosen
  *   from all units with values larger than one
  * - Otherwise the unit is chosen that has a value as close as possible to one (from below)
+ *
+ * The string is only formatted when this function is called. Inside a logging statement this only happens if the message
+ * is actually logged, as the whole statement is skipped otherwise.
  */
 std::string Units::display(UnitType input, std::initializer_list<std::string> units) {
     if(units.size() == 0) {
         throw std::invalid_argument("list of possible units cannot be empty");
     }
 
-    std::ostringstream stream;
-    // Find best unit
+    // Find best unit, keeping its converted value to not convert the input twice
     int best_exponent = std::numeric_limits<int>::min();
-    std::string best_unit;
+    const std::string* best_unit = nullptr;
+    Units::UnitType best_value = 0;
     for(auto& unit : units) {
         Units::UnitType value = convert(input, unit);
         int exponent = 0;
         std::frexp(value, &exponent);
         if((best_exponent <= 0 && exponent > best_exponent) || (exponent > 0 && exponent < best_exponent)) {
             best_exponent = exponent;
-            best_unit = unit;
+            best_unit = &unit;
+            best_value = value;
         }
     }
 
     // Write unit
-    stream << convert(input, best_unit);
-    stream << best_unit;
+    std::ostringstream stream;
+    stream << best_value;
+    stream << *best_unit;
     return stream.str();
 }
 std::string Units::display(UnitType input, std::string unit) {
@@ -16,8 +16,6 @@
 #include <string>
 #include <utility>
 
-// TODO [doc] Check if this class can be constexpressed?
-
 namespace allpix {
 
     /**
@@ -76,6 +74,8 @@ namespace allpix {
          * @brief Get value of a unit in the base units
          * @param str Name of the unit
          * @return Value in the base unit
+         * @note The values of parsed combinations of units are cached per thread, such that repeated lookups of the same
+         * string only cost a hash lookup
          * @warning Conversions should not be done with the result of this function. The \ref get(std::string) version should
          *          be used for that purpose instead.
          */
@@ -131,8 +131,75 @@ namespace allpix {
         template <typename T> static std::string display(T input, std::initializer_list<std::string> units);
 
     private:
+        /**
+         * @brief Parse a combination of units and get its value in the base units
+         * @param str Units combined with the multiplication and division operators
+         * @return Value in the base unit
+         */
+        static UnitType parse(const std::string& str);
+
         static std::map<std::string, UnitType> unit_map_;
     };
+
+    /**
+     * @brief Compile-time constants of the framework units in the base units
+     *
+     * These constants are the values registered with the unit system in \ref allpix::register_units, with the same double
+     * precision. They can be used in performance critical code instead of parsing the name of a unit, for example to fill
+     * a histogram in micrometers: `histogram->Fill(length / units::um)`.
+     */
+    namespace units {
+        // Length
+        constexpr Units::UnitType nm = 1e-6;
+        constexpr Units::UnitType um = 1e-3;
+        constexpr Units::UnitType mm = 1.0;
+        constexpr Units::UnitType cm = 1e1;
+        constexpr Units::UnitType dm = 1e2;
+        constexpr Units::UnitType m = 1e3;
+        constexpr Units::UnitType km = 1e6;
+
+        // Time
+        constexpr Units::UnitType ps = 1e-3;
+        constexpr Units::UnitType ns = 1.0;
+        constexpr Units::UnitType us = 1e3;
+        constexpr Units::UnitType ms = 1e6;
+        constexpr Units::UnitType s = 1e9;
+
+        // Temperature
+        constexpr Units::UnitType K = 1.0;
+
+        // Energy
+        constexpr Units::UnitType eV = 1e-6;
+        constexpr Units::UnitType keV = 1e-3;
+        constexpr Units::UnitType MeV = 1.0;
+        constexpr Units::UnitType GeV = 1e3;
+
+        // Charge
+        constexpr Units::UnitType e = 1.0;
+        constexpr Units::UnitType ke = 1e3;
+        constexpr Units::UnitType fC = 1 / 1.602176634e-4;
+        constexpr Units::UnitType C = 1 / 1.602176634e-19;
+
+        // Voltage
+        constexpr Units::UnitType mV = 1e-9;
+        constexpr Units::UnitType V = 1e-6;
+        constexpr Units::UnitType kV = 1e-3;
+
+        // Magnetic field
+        constexpr Units::UnitType T = 1e-3;
+        constexpr Units::UnitType mT = 1e-6;
+
+        // Memory
+        constexpr Units::UnitType B = 1.0;
+        constexpr Units::UnitType kB = 1e3;
+        constexpr Units::UnitType MB = 1e6;
+        constexpr Units::UnitType GB = 1e9;
+
+        // Angles
+        constexpr Units::UnitType deg = 3.14159265358979323846 / 180.0;
+        constexpr Units::UnitType rad = 1.0;
+        constexpr Units::UnitType mrad = 1e-3;
+    } // namespace units
 } // namespace allpix
 
 // Include template definitions
@@ -57,13 +57,14 @@ namespace allpix {
         auto split = allpix::split<Units::UnitType>(allpix::to_string(inp));
 
         std::string ret_str;
+        ret_str.reserve(16 * split.size() + 2);
         if(split.size() > 1) {
             ret_str += "(";
         }
 
         for(auto& element : split) {
             ret_str += Units::display(element, units);
-            ret_str += ",";
+            ret_str += ',';
         }
 
         if(split.size() > 1) {
@@ -8,18 +8,29 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 #include <atomic>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "core/Allpix.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/geometry/GeometryManager.hpp"
+#include "core/module/exceptions.h"
 #include "core/utils/exceptions.h"
+#include "core/utils/text.h"
 
 #include "core/utils/log.h"
 
@@ -28,9 +39,11 @@ using namespace allpix;
 void clean();
 void abort_handler(int);
 void interrupt_handler(int);
+void serve(const std::string& socket_path);
 
 std::unique_ptr<Allpix> apx;
 std::atomic<bool> apx_ready{false};
+std::atomic<bool> server_stop{false};
 
 /**
  * @brief Handle user abort (CTRL+\) which should stop the framework immediately
@@ -55,6 +68,7 @@ void interrupt_handler(int) {
         LOG(STATUS) << "Interrupted! Finishing up current event...";
         apx->terminate();
     }
+    server_stop = true;
 }
 
 /**
@@ -67,6 +81,126 @@ void clean() {
     }
 }
 
+/**
+ * @brief Run the jobs received on a local socket with the initialized framework until shutdown is requested
+ * @param socket_path Path of the Unix domain socket to listen on
+ *
+ * Every connection submits a single job as lines of "key = value", terminated by an empty line or the end of the stream.
+ * The keys "number_of_events" and "random_seed" set the events of the job, all other keys of the form <module>.<parameter>
+ * change a module parameter before the job. A line with "shutdown" stops the server after the job. The server answers
+ * with "OK" followed by the first and last event number of the job, or with "ERROR" followed by the reason.
+ */
+void serve(const std::string& socket_path) {
+    sockaddr_un address{};
+    if(socket_path.size() >= sizeof(address.sun_path)) {
+        throw RuntimeError("Server socket path " + socket_path + " is too long");
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server_fd < 0) {
+        throw RuntimeError("Cannot create server socket: " + std::string(std::strerror(errno)));
+    }
+    unlink(socket_path.c_str());
+    if(bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(server_fd, 16) != 0) {
+        auto error = std::string(std::strerror(errno));
+        close(server_fd);
+        throw RuntimeError("Cannot listen on server socket " + socket_path + ": " + error);
+    }
+    LOG(STATUS) << "Serving simulation jobs on socket " << socket_path;
+
+    unsigned int jobs = 0;
+    unsigned int events_served = 0;
+    bool shutdown = false;
+    while(!shutdown && !server_stop) {
+        // Wake up regularly to check for an interrupt
+        pollfd server_poll{server_fd, POLLIN, 0};
+        if(poll(&server_poll, 1, 500) <= 0) {
+            continue;
+        }
+        int client_fd = accept(server_fd, nullptr, nullptr);
+        if(client_fd < 0) {
+            continue;
+        }
+
+        // Read the job until an empty line or the end of the stream
+        std::string request;
+        char buffer[4096]; // NOLINT
+        ssize_t length = 0;
+        while(request.find("\n\n") == std::string::npos && (length = read(client_fd, buffer, sizeof(buffer))) > 0) {
+            request.append(buffer, static_cast<size_t>(length));
+        }
+
+        std::string response;
+        try {
+            unsigned int number_of_events = 1;
+            std::optional<uint64_t> seed;
+            std::vector<std::pair<std::string, std::string>> parameters;
+            std::istringstream request_stream(request);
+            std::string line;
+            while(std::getline(request_stream, line)) {
+                line = allpix::trim(line);
+                if(line.empty()) {
+                    break;
+                }
+                if(line == "shutdown") {
+                    shutdown = true;
+                    continue;
+                }
+                auto separator = line.find('=');
+                if(separator == std::string::npos) {
+                    throw InvalidJobError("Job line '" + line + "' is not given as key = value");
+                }
+                auto key = allpix::trim(line.substr(0, separator));
+                auto value = allpix::trim(line.substr(separator + 1));
+                try {
+                    if(key == "number_of_events") {
+                        number_of_events = allpix::from_string<unsigned int>(value);
+                    } else if(key == "random_seed") {
+                        seed = allpix::from_string<uint64_t>(value);
+                    } else {
+                        parameters.emplace_back(key, value);
+                    }
+                } catch(std::invalid_argument& e) {
+                    throw InvalidJobError("Job value of " + key + " is invalid: " + e.what());
+                }
+            }
+
+            if(number_of_events > 0) {
+                auto first_event = events_served + 1;
+                auto events_run = apx->runJob(number_of_events, seed, parameters);
+                events_served += events_run;
+                response = "OK " + std::to_string(first_event) + " " + std::to_string(first_event + events_run - 1);
+                LOG(STATUS) << "Finished job " << ++jobs << " with events " << first_event << " to "
+                            << (first_event + events_run - 1);
+            } else {
+                response = "OK";
+            }
+        } catch(InvalidJobError& e) {
+            LOG(ERROR) << "Rejected job: " << e.what();
+            response = "ERROR " + std::string(e.what());
+        } catch(std::exception& e) {
+            // Errors of the simulation itself stop the server
+            response = "ERROR " + std::string(e.what());
+            response += "\n";
+            (void)!write(client_fd, response.data(), response.size());
+            close(client_fd);
+            close(server_fd);
+            unlink(socket_path.c_str());
+            throw;
+        }
+
+        response += "\n";
+        (void)!write(client_fd, response.data(), response.size());
+        close(client_fd);
+    }
+
+    close(server_fd);
+    unlink(socket_path.c_str());
+    LOG(STATUS) << "Stopped serving simulation jobs after " << jobs << " jobs";
+}
+
 /**
  * @brief Main function running the application
  */
@@ -96,6 +230,7 @@ int main(int argc, const char* argv[]) {
     std::string log_file_name;
     std::vector<std::string> module_options;
     std::vector<std::string> detector_options;
+    std::string socket_path;
     for(int i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-h") == 0) {
             print_help = true;
@@ -125,6 +260,23 @@ int main(int argc, const char* argv[]) {
             module_options.emplace_back(std::string(argv[++i]));
         } else if(strcmp(argv[i], "-g") == 0 && (i + 1 < argc)) {
             detector_options.emplace_back(std::string(argv[++i]));
+        } else if(strcmp(argv[i], "--resume") == 0) {
+            module_options.emplace_back("resume=true");
+        } else if(strcmp(argv[i], "--serve") == 0 && (i + 1 < argc)) {
+            socket_path = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "--shard") == 0 && (i + 1 < argc)) {
+            // Shard given as <index>/<count>, passed on as framework parameters
+            std::string shard(argv[++i]);
+            auto separator = shard.find('/');
+            if(separator == 0 || separator + 1 >= shard.size() || shard.find('/', separator + 1) != std::string::npos ||
+               shard.find_first_not_of("0123456789/") != std::string::npos) {
+                LOG(ERROR) << "Invalid shard \"" << shard << "\", expected <index>/<count>";
+                print_help = true;
+                return_code = 1;
+                continue;
+            }
+            module_options.emplace_back("shard_index=" + shard.substr(0, separator));
+            module_options.emplace_back("number_of_shards=" + shard.substr(separator + 1));
         } else {
             LOG(ERROR) << "Unrecognized command line argument \"" << argv[i] << "\"";
             print_help = true;
@@ -145,6 +297,12 @@ int main(int argc, const char* argv[]) {
         std::cout << "  -o <option>  extra module configuration option(s) to pass" << std::endl;
         std::cout << "  -g <option>  extra detector configuration options(s) to pass" << std::endl;
         std::cout << "  -v <level>   verbosity level, overwriting the global level" << std::endl;
+        std::cout << "  --resume     resume the run from the last checkpoint if available" << std::endl;
+        std::cout << "  --shard <index>/<count>" << std::endl;
+        std::cout << "               run only the shard with the given index of a run split into count shards" << std::endl;
+        std::cout << "  --serve <socket>" << std::endl;
+        std::cout << "               keep the framework initialized and run the jobs received on the local socket"
+                  << std::endl;
         std::cout << "  --version    print version information and quit" << std::endl;
         std::cout << std::endl;
         std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
@@ -184,8 +342,12 @@ int main(int argc, const char* argv[]) {
         // Initialize modules (pre-run)
         apx->init();
 
-        // Run modules and event-loop
-        apx->run();
+        // Run modules and event-loop, or the jobs received by the server
+        if(socket_path.empty()) {
+            apx->run();
+        } else {
+            serve(socket_path);
+        }
 
         // Finalize modules (post-run)
         apx->finalize();
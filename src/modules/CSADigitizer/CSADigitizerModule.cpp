@@ -9,6 +9,8 @@
 
 #include "CSADigitizerModule.hpp"
 
+#include <limits>
+
 #include "core/utils/unit.h"
 #include "tools/ROOT.h"
 
@@ -24,10 +26,12 @@ using namespace allpix;
 
 CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
     : Module(config, std::move(detector)), messenger_(messenger), pixel_message_(nullptr) {
-    // Enable parallelization of this module if multithreading is enabled
+    // Enable parallelization of this module if multithreading is enabled, the histograms are filled per thread such that
+    // also several events can be digitized at the same time
     enable_parallelization();
+    enable_event_parallelization();
 
-    // Require PixelCharge message for single detector
+    // Require PixelCharge message for single detector, fetched in the run method
     messenger_->bindSingle(this, &CSADigitizerModule::pixel_message_, MsgFlags::REQUIRED);
 
     // Seed the random generator with the global seed
@@ -126,17 +130,29 @@ void CSADigitizerModule::init() {
         auto nbins = config_.get<int>("output_plots_bins");
 
         // Create histograms if needed
-        h_tot = new TH1D("tot", "time over threshold;time over threshold [ns];pixels", nbins, 0, tmax_);
-        h_toa = new TH1D("toa", "time of arrival;time of arrival [ns];pixels", nbins, 0, tmax_);
-        h_pxq_vs_tot =
-            new TH2D("pxqvstot", "ToT vs raw pixel charge;pixel charge [ke];ToT [ns]", nbins, 0, maximum, nbins, 0, tmax_);
+        h_tot = std::make_unique<ThreadedHistogram<TH1D>>(
+            "tot", "time over threshold;time over threshold [ns];pixels", nbins, 0, tmax_);
+        h_toa = std::make_unique<ThreadedHistogram<TH1D>>(
+            "toa", "time of arrival;time of arrival [ns];pixels", nbins, 0, tmax_);
+        h_pxq_vs_tot = std::make_unique<ThreadedHistogram<TH2D>>(
+            "pxqvstot", "ToT vs raw pixel charge;pixel charge [ke];ToT [ns]", nbins, 0, maximum, nbins, 0, tmax_);
     }
 }
 
 void CSADigitizerModule::run(unsigned int event_num) {
+    auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this);
+
+    // Use a random generator seeded for this event if the modules are seeded for every event, such that several events can
+    // be digitized at the same time
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
+
     // Loop through all pixels with charges
     std::vector<PixelHit> hits;
-    for(auto& pixel_charge : pixel_message_->getData()) {
+    for(auto& pixel_charge : pixel_message->getData()) {
         auto pixel = pixel_charge.getPixel();
         auto pixel_index = pixel.getIndex();
         auto inputcharge = static_cast<double>(pixel_charge.getCharge());
@@ -144,58 +160,72 @@ void CSADigitizerModule::run(unsigned int event_num) {
         LOG(DEBUG) << "Received pixel " << pixel_index << ", charge " << Units::display(inputcharge, "e");
 
         const auto& pulse = pixel_charge.getPulse(); // the pulse containing charges and times
-        auto pulse_vec = pulse.getPulse();           // the vector of the charges
+        const auto& pulse_vec = pulse.getWindow();   // the vector of the charges, starting at the pulse offset
         auto timestep = pulse.getBinning();
         auto ntimepoints = static_cast<size_t>(ceil(tmax_ / timestep));
 
         std::call_once(first_event_flag_, [&]() {
             // initialize impulse response function - assume all time bins are equal
-            impulse_response_function_.reserve(ntimepoints);
+            std::vector<double> impulse_response_function;
+            impulse_response_function.reserve(ntimepoints);
             auto calculate_impulse_response = [&](double x) {
                 return (resistance_feedback_ * (exp(-x / tauF_) - exp(-x / tauR_)) / (tauF_ - tauR_));
             };
             for(size_t itimepoint = 0; itimepoint < ntimepoints; ++itimepoint) {
-                impulse_response_function_.push_back(calculate_impulse_response(timestep * static_cast<double>(itimepoint)));
+                impulse_response_function.push_back(calculate_impulse_response(timestep * static_cast<double>(itimepoint)));
             }
+            // transform the impulse response once for the convolution of all pulses
+            impulse_response_ = FFTConvolution(std::move(impulse_response_function));
             LOG(TRACE) << "impulse response initialised. timestep  : " << timestep << ", tmax_ : " << tmax_
-                       << ", ntimepoints " << ntimepoints;
+                       << ", ntimepoints " << ntimepoints << ", transform length "
+                       << impulse_response_.getTransformLength();
         });
 
-        std::vector<double> amplified_pulse_vec(ntimepoints);
-        auto input_length = pulse_vec.size();
         LOG(TRACE) << "Preparing pulse for pixel " << pixel_index << ", " << pulse_vec.size() << " bins of "
-                   << Units::display(timestep, {"ps", "ns"}) << ", total charge: " << Units::display(pulse.getCharge(), "e");
-        // convolution of the pulse (size input_length) with the impulse response (size ntimepoints)
-        for(size_t k = 0; k < ntimepoints; ++k) {
-            double outsum{};
-            // convolution: multiply pulse_vec.at(k - i) * impulse_response_function_.at(i), when (k - i) < input_length
-            // -> no point to start i at 0, start from jmin:
-            size_t jmin = (k >= input_length - 1) ? k - (input_length - 1) : 0;
-            for(size_t i = jmin; i <= k; ++i) {
-                if((k - i) < input_length) {
-                    outsum += pulse_vec.at(k - i) * impulse_response_function_.at(i);
+                   << Units::display(timestep, {"ps", "ns"}) << " starting at bin " << pulse.getOffset()
+                   << ", total charge: " << Units::display(pulse.getCharge(), "e");
+        // convolution of the pulse with the impulse response, truncated to ntimepoints
+        std::vector<double> amplified_pulse_vec;
+        impulse_response_.convolve(pulse_vec, amplified_pulse_vec, pulse.getOffset());
+
+        // The noise is only drawn for the samples compared with the threshold, unless the full noisy pulse is required for
+        // the pulse graphs or the pulse integral
+        std::normal_distribution<double> pulse_smearing(0, sigmaNoise_);
+        std::vector<double> amplified_pulse_with_noise;
+        std::pair<double, double> compare_result;
+        if(store_tot_ && !output_pulsegraphs_) {
+            // The samples are accessed in increasing order, with the same bin possibly sampled by successive clock cycles
+            size_t noisy_index = std::numeric_limits<size_t>::max();
+            double noisy_sample{};
+            compare_result = compare_with_threshold(timestep, [&](size_t index) {
+                if(index != noisy_index) {
+                    noisy_index = index;
+                    noisy_sample = amplified_pulse_vec.at(index) + pulse_smearing(random_generator);
                 }
+                return noisy_sample;
+            });
+        } else {
+            // Apply noise on the amplified pulse, keeping the pulse without noise only for the pulse graphs
+            if(output_pulsegraphs_) {
+                amplified_pulse_with_noise = amplified_pulse_vec;
+            } else {
+                amplified_pulse_with_noise = std::move(amplified_pulse_vec);
+            }
+            for(auto& sample : amplified_pulse_with_noise) {
+                sample += pulse_smearing(random_generator);
             }
-            amplified_pulse_vec.at(k) = outsum;
-        }
 
-        // apply noise on the amplified pulse
-        std::normal_distribution<double> pulse_smearing(0, sigmaNoise_);
-        std::vector<double> amplified_pulse_with_noise(amplified_pulse_vec.size());
-        std::transform(amplified_pulse_vec.begin(),
-                       amplified_pulse_vec.end(),
-                       amplified_pulse_with_noise.begin(),
-                       [&pulse_smearing, this](auto& c) { return c + (pulse_smearing(random_generator_)); });
-
-        // TOA and TOT logic
-        std::pair<double, double> compare_result = compare_with_threshold(timestep, amplified_pulse_with_noise);
+            // TOA and TOT logic
+            compare_result =
+                compare_with_threshold(timestep, [&](size_t index) { return amplified_pulse_with_noise.at(index); });
+        }
         LOG(TRACE) << "TOA " << compare_result.first << " ns, TOT " << compare_result.second << " ns";
 
         // Fill histograms if requested
         if(output_plots_) {
-            h_tot->Fill(compare_result.second);
-            h_toa->Fill(compare_result.first);
-            h_pxq_vs_tot->Fill(inputcharge / 1e3, compare_result.second);
+            h_tot->fill(compare_result.second);
+            h_toa->fill(compare_result.first);
+            h_pxq_vs_tot->fill(inputcharge / 1e3, compare_result.second);
         }
 
         // Fill a graphs with the individual pixel pulses:
@@ -239,15 +269,20 @@ void CSADigitizerModule::run(unsigned int event_num) {
     }
 }
 
+/**
+ * The time of arrival is the first cycle of the ToA clock with a sample above threshold, the time over threshold is counted
+ * in cycles of the ToT clock until the first sample below threshold. Samples after the signal has returned below threshold
+ * are never requested.
+ */
 std::pair<double, double> CSADigitizerModule::compare_with_threshold(double timestep,
-                                                                     const std::vector<double>& amplified_pulse_with_noise) {
+                                                                     const std::function<double(size_t)>& sample) {
 
     bool is_over_threshold = false;
     double toa{}, tot{};
     double jtoa{}, jtot{};
     // first find the point where the signal crosses the threshold, latch toa
     while(jtoa < tmax_) {
-        if(amplified_pulse_with_noise.at(static_cast<size_t>(floor(jtoa / timestep))) > threshold_) {
+        if(sample(static_cast<size_t>(floor(jtoa / timestep))) > threshold_) {
             is_over_threshold = true;
             toa = jtoa;
             break;
@@ -259,7 +294,7 @@ std::pair<double, double> CSADigitizerModule::compare_with_threshold(double time
     // start from the next tot clock cycle following toa
     jtot = clockToT_ * (ceil(toa / clockToT_));
     while(is_over_threshold && jtot < tmax_) {
-        if(amplified_pulse_with_noise.at(static_cast<size_t>(floor(jtot / timestep))) > threshold_) {
+        if(sample(static_cast<size_t>(floor(jtot / timestep))) > threshold_) {
             tot += clockToT_;
         } else {
             is_over_threshold = false;
@@ -294,15 +329,15 @@ void CSADigitizerModule::create_output_pulsegraphs(const std::string& s_event_nu
     csa_pulse_graph->GetXaxis()->SetTitle("t [ns]");
     csa_pulse_graph->GetYaxis()->SetTitle("CSA output [mV]");
     csa_pulse_graph->SetTitle((s_title + " in pixel (" + s_pixel_index + ")").c_str());
-    getROOTDirectory()->WriteTObject(csa_pulse_graph, name.c_str());
+    writeROOTObject(csa_pulse_graph, name);
 }
 
 void CSADigitizerModule::finalize() {
     if(output_plots_) {
         // Write histograms
         LOG(TRACE) << "Writing output plots to file";
-        h_tot->Write();
-        h_toa->Write();
-        h_pxq_vs_tot->Write();
+        h_tot->merge()->Write();
+        h_toa->merge()->Write();
+        h_pxq_vs_tot->merge()->Write();
     }
 }
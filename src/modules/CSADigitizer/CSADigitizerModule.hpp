@@ -10,6 +10,7 @@
 #ifndef ALLPIX_CSA_DIGITIZER_MODULE_H
 #define ALLPIX_CSA_DIGITIZER_MODULE_H
 
+#include <functional>
 #include <memory>
 #include <random>
 #include <string>
@@ -19,6 +20,8 @@
 #include "core/module/Module.hpp"
 
 #include "objects/PixelCharge.hpp"
+#include "tools/convolution.h"
+#include "tools/threaded_histogram.h"
 
 #include <TF1.h>
 #include <TH1D.h>
@@ -89,18 +92,20 @@ namespace allpix {
 
         // helper variables for transfer function
         double transconductance_feedback_{}, resistance_feedback_{}, tmax_{};
-        std::vector<double> impulse_response_function_;
+        FFTConvolution impulse_response_;
         std::once_flag first_event_flag_;
 
         // Output histograms
-        TH1D *h_tot{}, *h_toa{};
-        TH2D* h_pxq_vs_tot{};
+        std::unique_ptr<ThreadedHistogram<TH1D>> h_tot, h_toa;
+        std::unique_ptr<ThreadedHistogram<TH2D>> h_pxq_vs_tot;
 
         /**
          * @brief Compare output pulse with threshold for ToA/ToT
+         * @param timestep Binning of the pulse
+         * @param sample Function returning the amplified pulse with noise in the given bin
+         * @return Time of arrival and time over threshold
          */
-        std::pair<double, double> compare_with_threshold(double timestep,
-                                                         const std::vector<double>& amplified_pulse_with_noise);
+        std::pair<double, double> compare_with_threshold(double timestep, const std::function<double(size_t)>& sample);
 
         /**
          * @brief Create output plots of the pulses
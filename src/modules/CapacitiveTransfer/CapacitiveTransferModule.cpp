@@ -22,6 +22,7 @@
 #include "tools/ROOT.h"
 
 #include <Eigen/Core>
+#include <Eigen/SVD>
 
 #include "objects/PixelCharge.hpp"
 
@@ -39,12 +40,17 @@ CapacitiveTransferModule::CapacitiveTransferModule(Configuration& config,
     config_.setDefault("cross_coupling", 1);
     config_.setDefault("nominal_gap", 0.0);
     config_.setDefault("minimum_gap", config_.get<double>("nominal_gap"));
+    config_.setDefault("coupling_convolution", false);
+    config_.setDefault("max_depth_distance", Units::get(5.0, "um"));
 
     // Require propagated deposits for single detector
     messenger->bindSingle(this, &CapacitiveTransferModule::propagated_message_, MsgFlags::REQUIRED);
 }
 
 void CapacitiveTransferModule::init() {
+    if(!PixelKey::supports(detector_->getModel()->getNPixels())) {
+        throw ModuleError("Pixel grid exceeds " + std::to_string(PixelKey::max_coordinate) + " pixels in x or y");
+    }
 
     if(config_.count({"coupling_matrix", "coupling_file", "coupling_scan_file"}) > 1) {
         throw InvalidCombinationError(
@@ -53,6 +59,8 @@ void CapacitiveTransferModule::init() {
         relative_coupling = config_.getMatrix<double>("coupling_matrix");
         max_row = static_cast<unsigned int>(relative_coupling.size());
         max_col = static_cast<unsigned int>(relative_coupling[0].size());
+        matrix_rows = max_row;
+        matrix_cols = max_col;
 
         if(config_.get<bool>("output_plots")) {
             LOG(TRACE) << "Creating output plots";
@@ -249,19 +257,160 @@ void CapacitiveTransferModule::init() {
             "Capacitive coupling was not defined. Please, check the README file for configuration options or use "
             "the SimpleTransfer module.");
     }
+
+    cross_coupling = config_.get<int>("cross_coupling");
+    max_depth_distance_ = config_.get<double>("max_depth_distance");
+    implant_z_ = model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0;
+    init_coupling();
+
+    coupling_convolution_ = config_.get<bool>("coupling_convolution");
+    if(coupling_convolution_) {
+        if(config_.has("coupling_scan_file")) {
+            throw InvalidCombinationError(config_,
+                                          {"coupling_convolution", "coupling_scan_file"},
+                                          "the coupling of a scan file depends on the pixel and cannot be convolved");
+        }
+        init_kernel();
+    }
+}
+
+/**
+ * The pixels a propagated charge couples to and their coupling factors only depend on the offset to the nearest pixel of the
+ * charge, and for a capacitance scan additionally on the gap of the coupled pixel. All factors are therefore calculated
+ * once, for a scan for every pixel of the grid, such that a single multiplication remains per charge and coupled pixel.
+ */
+void CapacitiveTransferModule::init_coupling() {
+    coupling_offsets_.clear();
+    auto add_offset = [&](size_t row, size_t col) {
+        CouplingOffset offset{};
+        offset.row = row;
+        offset.col = col;
+        offset.dx = static_cast<int>(col) - static_cast<int>(matrix_cols / 2);
+        offset.dy = static_cast<int>(row) - static_cast<int>(matrix_rows / 2);
+        if(config_.has("coupling_file")) {
+            offset.factor = relative_coupling[col][row];
+        } else if(config_.has("coupling_matrix")) {
+            offset.factor = relative_coupling[max_row - row - 1][col];
+        }
+        coupling_offsets_.push_back(offset);
+    };
+
+    // Without cross-coupling only the nearest pixel receives the charge
+    if(cross_coupling == 0 || (max_row == 1 && max_col == 1)) {
+        add_offset(matrix_rows / 2, matrix_cols / 2);
+    } else {
+        for(size_t row = 0; row < max_row; row++) {
+            for(size_t col = 0; col < max_col; col++) {
+                add_offset(row, col);
+            }
+        }
+    }
+
+    // The coupling of a scan depends on the gap between sensor and chip at the coupled pixel
+    pixel_coupling_.clear();
+    if(config_.has("coupling_scan_file")) {
+        auto n_pixels_x = model_->getNPixels().x();
+        auto n_pixels_y = model_->getNPixels().y();
+        pixel_coupling_.resize(static_cast<size_t>(n_pixels_x) * n_pixels_y * coupling_offsets_.size());
+        auto* factor = pixel_coupling_.data();
+        for(unsigned int x = 0; x < n_pixels_x; ++x) {
+            for(unsigned int y = 0; y < n_pixels_y; ++y) {
+                Eigen::Vector3d pixel_point(x * model_->getPixelSize().x(), y * model_->getPixelSize().y(), 0);
+                auto gap = static_cast<double>(Units::convert(plane.projection(pixel_point)[2], "um"));
+                for(const auto& offset : coupling_offsets_) {
+                    *factor++ = capacitances[offset.row * 3 + offset.col]->Eval(gap, nullptr, "S") * normalization;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * The kernel contains the same coupling factors as used for the transfer of every single propagated charge. A separable
+ * decomposition is obtained from the singular value decomposition of the kernel, keeping all components with a singular
+ * value above a negligible fraction of the largest one, and is used if applying it requires fewer operations per pixel.
+ */
+void CapacitiveTransferModule::init_kernel() {
+    auto full_rows = static_cast<int>(max_row);
+    auto full_cols = static_cast<int>(max_col);
+    auto coupling = [&](int row, int col) {
+        if(config_.has("coupling_file")) {
+            return relative_coupling[static_cast<size_t>(col)][static_cast<size_t>(row)];
+        }
+        return relative_coupling[static_cast<size_t>(full_rows - row - 1)][static_cast<size_t>(col)];
+    };
+
+    // Without cross-coupling only the central element of the matrix is used
+    auto first_row = 0, first_col = 0;
+    kernel_rows_ = full_rows;
+    kernel_cols_ = full_cols;
+    if(cross_coupling == 0) {
+        first_row = static_cast<int>(matrix_rows / 2);
+        first_col = static_cast<int>(matrix_cols / 2);
+        kernel_rows_ = 1;
+        kernel_cols_ = 1;
+    }
+    kernel_row_offset_ = first_row - static_cast<int>(matrix_rows / 2);
+    kernel_col_offset_ = first_col - static_cast<int>(matrix_cols / 2);
+
+    Eigen::MatrixXd kernel(kernel_rows_, kernel_cols_);
+    kernel_.resize(static_cast<size_t>(kernel_rows_ * kernel_cols_));
+    for(int row = 0; row < kernel_rows_; ++row) {
+        for(int col = 0; col < kernel_cols_; ++col) {
+            kernel(row, col) = coupling(first_row + row, first_col + col);
+            kernel_[static_cast<size_t>(row * kernel_cols_ + col)] = kernel(row, col);
+        }
+    }
+
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(kernel, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const auto& singular_values = svd.singularValues();
+    int rank = 0;
+    while(rank < singular_values.size() && singular_values[rank] > 1e-12 * singular_values[0]) {
+        ++rank;
+    }
+
+    kernel_row_factors_.clear();
+    kernel_col_factors_.clear();
+    if(rank * (kernel_rows_ + kernel_cols_) < kernel_rows_ * kernel_cols_) {
+        for(int component = 0; component < rank; ++component) {
+            std::vector<double> row_factors(static_cast<size_t>(kernel_rows_));
+            std::vector<double> col_factors(static_cast<size_t>(kernel_cols_));
+            for(int row = 0; row < kernel_rows_; ++row) {
+                row_factors[static_cast<size_t>(row)] = svd.matrixU()(row, component) * singular_values[component];
+            }
+            for(int col = 0; col < kernel_cols_; ++col) {
+                col_factors[static_cast<size_t>(col)] = svd.matrixV()(col, component);
+            }
+            kernel_row_factors_.push_back(std::move(row_factors));
+            kernel_col_factors_.push_back(std::move(col_factors));
+        }
+    }
+    LOG(INFO) << "Convolving pixel charges with " << kernel_cols_ << "x" << kernel_rows_ << " coupling kernel"
+              << (kernel_row_factors_.empty() ? "" : " of rank " + std::to_string(rank));
 }
 
 void CapacitiveTransferModule::run(unsigned int) {
+    // Collect the charges on the pixels first and apply the coupling to the pixel grid if requested
+    if(coupling_convolution_) {
+        std::vector<PixelCharge> pixel_charges;
+        auto transferred_charges_count = transfer_convolved(pixel_charges);
+        LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_charges.size() << " pixels";
+        total_transferred_charges_ += transferred_charges_count;
+
+        auto pixel_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+        messenger_->dispatchMessage(this, pixel_message);
+        return;
+    }
 
     // Find corresponding pixels for all propagated charges
     LOG(TRACE) << "Transferring charges to pixels";
     unsigned int transferred_charges_count = 0;
-    std::map<Pixel::Index, std::pair<double, std::vector<const PropagatedCharge*>>> pixel_map;
+    std::map<PixelKey, std::pair<double, std::vector<const PropagatedCharge*>>> pixel_map;
+    auto n_pixels_y = model_->getNPixels().y();
     for(auto& propagated_charge : propagated_message_->getData()) {
         auto position = propagated_charge.getLocalPosition();
         // Ignore if outside depth range of implant
-        if(std::fabs(position.z() - (model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0)) >
-           config_.get<double>("max_depth_distance")) {
+        if(std::fabs(position.z() - implant_z_) > max_depth_distance_) {
             LOG(DEBUG) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                        << propagated_charge.getLocalPosition() << " because their local position is not in implant range";
             continue;
@@ -272,65 +421,39 @@ void CapacitiveTransferModule::run(unsigned int) {
         auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
         LOG(DEBUG) << "Hit at pixel " << xpixel << ", " << ypixel;
 
-        Pixel::Index pixel_index;
-        double neighbour_charge = 0;
-        double ccpd_factor = 0;
-
-        Eigen::Vector3d pixel_point;
-        Eigen::Vector3d pixel_projection;
-
-        for(size_t row = 0; row < max_row; row++) {
-            for(size_t col = 0; col < max_col; col++) {
-                if(config_.get<int>("cross_coupling") == 0) {
-                    col = static_cast<size_t>(std::floor(matrix_cols / 2));
-                    row = static_cast<size_t>(std::floor(matrix_rows / 2));
-                }
-
-                auto xcoord = xpixel + static_cast<int>(col - static_cast<size_t>(std::floor(matrix_cols / 2)));
-                auto ycoord = ypixel + static_cast<int>(row - static_cast<size_t>(std::floor(matrix_rows / 2)));
-
-                // Ignore if out of pixel grid
-                if(!detector_->isWithinPixelGrid(xcoord, ycoord)) {
-                    LOG(DEBUG) << "Skipping set of propagated charges at " << propagated_charge.getLocalPosition()
-                               << " because their nearest pixel (" << xpixel << "," << ypixel
-                               << ") is outside the pixel matrix";
-                    continue;
-                }
-
-                pixel_index = Pixel::Index(static_cast<unsigned int>(xcoord), static_cast<unsigned int>(ycoord));
-
-                if(config_.has("coupling_scan_file")) {
-                    double local_x = pixel_index.x() * model_->getPixelSize().x();
-                    double local_y = pixel_index.y() * model_->getPixelSize().y();
-                    pixel_point = Eigen::Vector3d(local_x, local_y, 0);
-                    pixel_projection = plane.projection(pixel_point);
-                    pixel_gap = pixel_projection[2];
-
-                    ccpd_factor = capacitances[row * 3 + col]->Eval(
-                                      static_cast<double>(Units::convert(pixel_gap, "um")), nullptr, "S") *
-                                  normalization;
-                } else if(config_.has("coupling_file")) {
-                    ccpd_factor = relative_coupling[col][row];
-                } else if(config_.has("coupling_matrix")) {
-                    ccpd_factor = relative_coupling[max_row - row - 1][col];
-                } else {
-                    ccpd_factor = 1;
-                    LOG(ERROR) << "This shouldn't happen. Transferring 100% of detected charge";
-                }
-
-                // Update statistics
-                unique_pixels_.insert(pixel_index);
-
-                transferred_charges_count += static_cast<unsigned int>(propagated_charge.getCharge() * ccpd_factor);
-                neighbour_charge = propagated_charge.getCharge() * ccpd_factor;
-
-                LOG(DEBUG) << "Set of " << propagated_charge.getCharge() * ccpd_factor << " charges brought to neighbour "
-                           << col << "," << row << " pixel " << pixel_index << "with cross-coupling of " << ccpd_factor * 100
-                           << "%";
+        auto charge = static_cast<double>(propagated_charge.getCharge());
+        for(size_t index = 0; index < coupling_offsets_.size(); ++index) {
+            const auto& offset = coupling_offsets_[index];
+            auto xcoord = xpixel + offset.dx;
+            auto ycoord = ypixel + offset.dy;
+
+            // Ignore if out of pixel grid
+            if(!detector_->isWithinPixelGrid(xcoord, ycoord)) {
+                LOG(DEBUG) << "Skipping set of propagated charges at " << propagated_charge.getLocalPosition()
+                           << " because their nearest pixel (" << xpixel << "," << ypixel
+                           << ") is outside the pixel matrix";
+                continue;
+            }
 
-                // Add the pixel the list of hit pixels
-                pixel_map[pixel_index].first += neighbour_charge;
-                pixel_map[pixel_index].second.emplace_back(&propagated_charge);
+            PixelKey pixel_index(static_cast<unsigned int>(xcoord), static_cast<unsigned int>(ycoord));
+            auto ccpd_factor =
+                (pixel_coupling_.empty()
+                     ? offset.factor
+                     : pixel_coupling_[(static_cast<size_t>(pixel_index.x()) * n_pixels_y + pixel_index.y()) *
+                                           coupling_offsets_.size() +
+                                       index]);
+            auto neighbour_charge = charge * ccpd_factor;
+            transferred_charges_count += static_cast<unsigned int>(neighbour_charge);
+
+            LOG(DEBUG) << "Set of " << neighbour_charge << " charges brought to neighbour " << offset.col << ","
+                       << offset.row << " pixel " << pixel_index.getIndex() << "with cross-coupling of "
+                       << ccpd_factor * 100 << "%";
+
+            // Add the pixel the list of hit pixels
+            auto& pixel_entry = pixel_map[pixel_index];
+            pixel_entry.first += neighbour_charge;
+            if(has_object_history()) {
+                pixel_entry.second.emplace_back(&propagated_charge);
             }
         }
     }
@@ -344,6 +467,7 @@ void CapacitiveTransferModule::run(unsigned int) {
         // Get pixel object from detector
         auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
         pixel_charges.emplace_back(pixel, charge, pixel_index_charge.second.second);
+        unique_pixels_.insert(pixel_index_charge.first);
         LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
     }
 
@@ -356,6 +480,197 @@ void CapacitiveTransferModule::run(unsigned int) {
     messenger_->dispatchMessage(this, pixel_message);
 }
 
+/**
+ * The propagated charges are first summed on the pixel closest to them, for a region of interest covering all such pixels
+ * which can couple to a pixel of the grid. The coupling kernel is then applied to all pixels of the region at once, either
+ * directly or through its separable components. Every pixel for which a propagated charge is within the extent of the kernel
+ * receives a pixel charge, linked to these propagated charges in their original order, as for the transfer of every single
+ * propagated charge. The number of transferred charges is however summed after the combination of the charges per pixel.
+ */
+unsigned int CapacitiveTransferModule::transfer_convolved(std::vector<PixelCharge>& pixel_charges) {
+    const auto& propagated_charges = propagated_message_->getData();
+    auto n_pixels_x = static_cast<int>(model_->getNPixels().x());
+    auto n_pixels_y = static_cast<int>(model_->getNPixels().y());
+    auto no_cell = std::numeric_limits<size_t>::max();
+
+    // Pixels outside of this range do not couple to any pixel of the grid
+    auto min_x = -(kernel_col_offset_ + kernel_cols_ - 1), max_x = n_pixels_x - 1 - kernel_col_offset_;
+    auto min_y = -(kernel_row_offset_ + kernel_rows_ - 1), max_y = n_pixels_y - 1 - kernel_row_offset_;
+
+    // Find the nearest pixel of every propagated charge and the region of interest around them
+    std::vector<std::pair<int, int>> nearest_pixels(propagated_charges.size());
+    auto roi_x0 = std::numeric_limits<int>::max(), roi_x1 = std::numeric_limits<int>::min();
+    auto roi_y0 = std::numeric_limits<int>::max(), roi_y1 = std::numeric_limits<int>::min();
+    charge_cells_.assign(propagated_charges.size(), no_cell);
+    for(size_t i = 0; i < propagated_charges.size(); ++i) {
+        auto position = propagated_charges[i].getLocalPosition();
+        if(std::fabs(position.z() - implant_z_) > max_depth_distance_) {
+            continue;
+        }
+        auto xpixel = static_cast<int>(std::round(position.x() / model_->getPixelSize().x()));
+        auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
+        if(xpixel < min_x || xpixel > max_x || ypixel < min_y || ypixel > max_y) {
+            continue;
+        }
+        nearest_pixels[i] = {xpixel, ypixel};
+        charge_cells_[i] = 0;
+        roi_x0 = std::min(roi_x0, xpixel);
+        roi_x1 = std::max(roi_x1, xpixel);
+        roi_y0 = std::min(roi_y0, ypixel);
+        roi_y1 = std::max(roi_y1, ypixel);
+    }
+    if(roi_x0 > roi_x1) {
+        return 0;
+    }
+
+    // Sum the charges on the region of interest and sort the propagated charges by cell, keeping their order
+    auto width = static_cast<size_t>(roi_x1 - roi_x0 + 1);
+    auto height = static_cast<size_t>(roi_y1 - roi_y0 + 1);
+    auto cell = [&](int x, int y) { return static_cast<size_t>(x - roi_x0) * height + static_cast<size_t>(y - roi_y0); };
+    source_charges_.assign(width * height, 0.0);
+    source_offsets_.assign(width * height + 1, 0);
+    for(size_t i = 0; i < propagated_charges.size(); ++i) {
+        if(charge_cells_[i] == no_cell) {
+            continue;
+        }
+        charge_cells_[i] = cell(nearest_pixels[i].first, nearest_pixels[i].second);
+        source_charges_[charge_cells_[i]] += propagated_charges[i].getCharge();
+        ++source_offsets_[charge_cells_[i] + 1];
+    }
+    for(size_t c = 0; c < width * height; ++c) {
+        source_offsets_[c + 1] += source_offsets_[c];
+    }
+    source_list_.resize(source_offsets_.back());
+    occupancy_.assign(source_offsets_.begin(), source_offsets_.end());
+    for(size_t i = 0; i < propagated_charges.size(); ++i) {
+        if(charge_cells_[i] != no_cell) {
+            source_list_[occupancy_[charge_cells_[i]]++] = i;
+        }
+    }
+
+    // Integral image of the occupied cells to find pixels with propagated charges within the extent of the kernel
+    occupancy_.assign((width + 1) * (height + 1), 0);
+    for(size_t x = 0; x < width; ++x) {
+        for(size_t y = 0; y < height; ++y) {
+            auto occupied = static_cast<size_t>(source_offsets_[x * height + y + 1] > source_offsets_[x * height + y]);
+            occupancy_[(x + 1) * (height + 1) + y + 1] = occupied + occupancy_[x * (height + 1) + y + 1] +
+                                                         occupancy_[(x + 1) * (height + 1) + y] -
+                                                         occupancy_[x * (height + 1) + y];
+        }
+    }
+    auto occupied_cells = [&](int x0, int x1, int y0, int y1) {
+        // Number of occupied cells in the inclusive range, clipped to the region of interest
+        x0 = std::max(x0, roi_x0) - roi_x0;
+        x1 = std::min(x1, roi_x1) - roi_x0 + 1;
+        y0 = std::max(y0, roi_y0) - roi_y0;
+        y1 = std::min(y1, roi_y1) - roi_y0 + 1;
+        if(x0 >= x1 || y0 >= y1) {
+            return size_t(0);
+        }
+        auto at = [&](int x, int y) { return occupancy_[static_cast<size_t>(x) * (height + 1) + static_cast<size_t>(y)]; };
+        return at(x1, y1) - at(x0, y1) - at(x1, y0) + at(x0, y0);
+    };
+    auto source_charge = [&](int x, int y) {
+        return (x < roi_x0 || x > roi_x1 || y < roi_y0 || y > roi_y1) ? 0.0 : source_charges_[cell(x, y)];
+    };
+
+    // Target pixels of the grid that can receive charge from the region of interest
+    auto target_x0 = std::max(0, roi_x0 + kernel_col_offset_);
+    auto target_x1 = std::min(n_pixels_x - 1, roi_x1 + kernel_col_offset_ + kernel_cols_ - 1);
+    auto target_y0 = std::max(0, roi_y0 + kernel_row_offset_);
+    auto target_y1 = std::min(n_pixels_y - 1, roi_y1 + kernel_row_offset_ + kernel_rows_ - 1);
+
+    // Apply the columns of the separable components for all rows of the region of interest in advance
+    auto target_width = static_cast<size_t>(target_x1 - target_x0 + 1);
+    if(!kernel_col_factors_.empty()) {
+        separable_buffer_.assign(kernel_col_factors_.size() * target_width * height, 0.0);
+        for(size_t component = 0; component < kernel_col_factors_.size(); ++component) {
+            const auto& col_factors = kernel_col_factors_[component];
+            for(auto x = target_x0; x <= target_x1; ++x) {
+                for(auto y = roi_y0; y <= roi_y1; ++y) {
+                    double sum = 0;
+                    for(int col = 0; col < kernel_cols_; ++col) {
+                        sum += col_factors[static_cast<size_t>(col)] * source_charge(x - kernel_col_offset_ - col, y);
+                    }
+                    separable_buffer_[(component * target_width + static_cast<size_t>(x - target_x0)) * height +
+                                      static_cast<size_t>(y - roi_y0)] = sum;
+                }
+            }
+        }
+    }
+
+    unsigned int transferred_charges_count = 0;
+    std::vector<const PropagatedCharge*> pixel_propagated_charges;
+    for(auto x = target_x0; x <= target_x1; ++x) {
+        for(auto y = target_y0; y <= target_y1; ++y) {
+            // Skip pixels without any propagated charge within the extent of the kernel
+            if(occupied_cells(x - kernel_col_offset_ - kernel_cols_ + 1,
+                              x - kernel_col_offset_,
+                              y - kernel_row_offset_ - kernel_rows_ + 1,
+                              y - kernel_row_offset_) == 0) {
+                continue;
+            }
+
+            double charge = 0;
+            if(kernel_col_factors_.empty()) {
+                for(int row = 0; row < kernel_rows_; ++row) {
+                    for(int col = 0; col < kernel_cols_; ++col) {
+                        charge += kernel_[static_cast<size_t>(row * kernel_cols_ + col)] *
+                                  source_charge(x - kernel_col_offset_ - col, y - kernel_row_offset_ - row);
+                    }
+                }
+            } else {
+                for(size_t component = 0; component < kernel_row_factors_.size(); ++component) {
+                    const auto& row_factors = kernel_row_factors_[component];
+                    for(int row = 0; row < kernel_rows_; ++row) {
+                        auto source_y = y - kernel_row_offset_ - row;
+                        if(source_y < roi_y0 || source_y > roi_y1) {
+                            continue;
+                        }
+                        charge += row_factors[static_cast<size_t>(row)] *
+                                  separable_buffer_[(component * target_width + static_cast<size_t>(x - target_x0)) *
+                                                        height +
+                                                    static_cast<size_t>(source_y - roi_y0)];
+                    }
+                }
+            }
+
+            pixel_propagated_charges.clear();
+            // Link the propagated charges within the kernel extent in their original order if the history is required
+            if(has_object_history()) {
+                target_list_.clear();
+                for(int col = 0; col < kernel_cols_; ++col) {
+                    for(int row = 0; row < kernel_rows_; ++row) {
+                        auto source_x = x - kernel_col_offset_ - col;
+                        auto source_y = y - kernel_row_offset_ - row;
+                        if(source_x < roi_x0 || source_x > roi_x1 || source_y < roi_y0 || source_y > roi_y1) {
+                            continue;
+                        }
+                        auto c = cell(source_x, source_y);
+                        target_list_.insert(target_list_.end(),
+                                            source_list_.begin() + static_cast<std::ptrdiff_t>(source_offsets_[c]),
+                                            source_list_.begin() + static_cast<std::ptrdiff_t>(source_offsets_[c + 1]));
+                    }
+                }
+                std::sort(target_list_.begin(), target_list_.end());
+                for(auto index : target_list_) {
+                    pixel_propagated_charges.push_back(&propagated_charges[index]);
+                }
+            }
+
+            Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
+            unique_pixels_.emplace(pixel_index);
+            transferred_charges_count += static_cast<unsigned int>(charge);
+
+            auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+            pixel_charges.emplace_back(pixel, charge, pixel_propagated_charges);
+            LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+        }
+    }
+
+    return transferred_charges_count;
+}
+
 void CapacitiveTransferModule::finalize() {
     // Print statistics
     LOG(INFO) << "Transferred total of " << total_transferred_charges_ << " charges to " << unique_pixels_.size()
@@ -8,6 +8,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <TFile.h>
@@ -75,7 +76,7 @@ namespace allpix {
 
         // Statistical information
         unsigned int total_transferred_charges_{};
-        std::set<Pixel::Index> unique_pixels_;
+        std::unordered_set<PixelKey> unique_pixels_;
 
         // Matrix to store cross-coupling values
         std::vector<std::vector<double>> relative_coupling;
@@ -90,6 +91,47 @@ namespace allpix {
         double minimum_gap;
 
         int cross_coupling;
+        double max_depth_distance_{};
+        double implant_z_{};
+
+        // Coupling to the pixel at an offset from the nearest pixel of a charge, with its element of the coupling matrix
+        struct CouplingOffset {
+            int dx, dy;
+            size_t row, col;
+            double factor;
+        };
+        std::vector<CouplingOffset> coupling_offsets_;
+        // Coupling factors of all offsets for every pixel of the grid, only used for a capacitance scan
+        std::vector<double> pixel_coupling_;
+
+        /**
+         * @brief Calculate the coupling factors of all pixel offsets from the coupling matrix or the capacitance scan
+         */
+        void init_coupling();
+
+        // Coupling kernel for the two-stage transfer, indexed by row (y) and column (x) offset to the collecting pixel
+        bool coupling_convolution_{};
+        int kernel_rows_{}, kernel_cols_{};
+        int kernel_row_offset_{}, kernel_col_offset_{};
+        std::vector<double> kernel_;
+        // Separable components of the kernel, only used if cheaper than the full kernel
+        std::vector<std::vector<double>> kernel_row_factors_, kernel_col_factors_;
+
+        // Work buffers of the two-stage transfer, kept for the next event
+        std::vector<double> source_charges_, separable_buffer_;
+        std::vector<size_t> source_offsets_, source_list_, charge_cells_, occupancy_, target_list_;
+
+        /**
+         * @brief Build the coupling kernel and its separable decomposition from the coupling matrix
+         */
+        void init_kernel();
+
+        /**
+         * @brief Transfer all charges by first collecting them on the pixel grid and convolving with the coupling kernel
+         * @param pixel_charges Vector to add the pixel charges to
+         * @return Number of charges transferred
+         */
+        unsigned int transfer_convolved(std::vector<PixelCharge>& pixel_charges);
 
         void getCapacitanceScan(TFile* root_file);
         TGraph* capacitances[9];
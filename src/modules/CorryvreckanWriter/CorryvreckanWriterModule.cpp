@@ -22,6 +22,8 @@ using namespace allpix;
 
 CorryvreckanWriterModule::CorryvreckanWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geoManager)
     : Module(config), messenger_(messenger), geometryManager_(geoManager) {
+    // Writing the output and geometry files of this module can overlap with the finalization of other modules
+    enable_parallel_finalization();
 
     // Require PixelCharge messages for single detector
     messenger_->bindMulti(this, &CorryvreckanWriterModule::pixel_messages_, MsgFlags::REQUIRED);
@@ -60,6 +62,7 @@ void CorryvreckanWriterModule::init() {
     // Create trees:
     LOG(TRACE) << "Booking event tree";
     event_tree_ = std::make_unique<TTree>("Event", (std::string("Tree of Events").c_str()));
+    event_ = &event_data_;
     event_tree_->Bronch("global", "corryvreckan::Event", &event_);
 
     LOG(TRACE) << "Booking pixel tree";
@@ -70,6 +73,23 @@ void CorryvreckanWriterModule::init() {
         mcparticle_tree_ = std::make_unique<TTree>("MCParticle", (std::string("Tree of MCParticles").c_str()));
     }
 
+    // Create the branches of all detectors upfront, such that no branch has to be filled for past events later on
+    for(auto& detector : geometryManager_->getDetectors()) {
+        auto detector_name = detector->getName();
+        auto& output = detector_output_[detector_name];
+
+        output.pixels_address = &output.pixels;
+        pixel_tree_->Bronch(
+            detector_name.c_str(), std::string("std::vector<corryvreckan::Pixel*>").c_str(), &output.pixels_address);
+
+        if(output_mc_truth_) {
+            output.mcparticles_address = &output.mcparticles;
+            mcparticle_tree_->Bronch(detector_name.c_str(),
+                                     std::string("std::vector<corryvreckan::MCParticle*>").c_str(),
+                                     &output.mcparticles_address);
+        }
+    }
+
     // Initialise the time
     time_ = 0;
 }
@@ -79,63 +99,32 @@ void CorryvreckanWriterModule::run(unsigned int event) {
 
     LOG(TRACE) << "Processing event " << event;
 
-    // Create and store a new Event:
-    event_ = new corryvreckan::Event(time_, time_ + 5);
+    // Store the new Event:
+    event_data_ = corryvreckan::Event(time_, time_ + 5);
     LOG(DEBUG) << "Defining event for Corryvreckan: [" << Units::display(event_->start(), {"ns", "um"}) << ","
                << Units::display(event_->end(), {"ns", "um"}) << "]";
     event_tree_->Fill();
 
-    // Events start with 1, pre-filling only with empty events before:
-    event--;
-
     // Loop through all received messages
     for(auto& message : pixel_messages_) {
 
         auto detector_name = message->getDetector()->getName();
         LOG(DEBUG) << "Received " << message->getData().size() << " pixel hits from detector " << detector_name;
+        auto& output = detector_output_.at(detector_name);
 
-        if(write_list_px_.find(detector_name) == write_list_px_.end()) {
-            write_list_px_[detector_name] = new std::vector<corryvreckan::Pixel*>();
-            pixel_tree_->Bronch(detector_name.c_str(),
-                                std::string("std::vector<corryvreckan::Pixel*>").c_str(),
-                                &write_list_px_[detector_name]);
-
-            if(event > 0) {
-                LOG(DEBUG) << "Pre-filling new branch " << detector_name << " of corryvreckan::Pixel with " << event
-                           << " empty events";
-                auto* branch = pixel_tree_->GetBranch(detector_name.c_str());
-                for(unsigned int i = 0; i < event; ++i) {
-                    branch->Fill();
-                }
-            }
-        }
-
-        if(output_mc_truth_ && write_list_mcp_.find(detector_name) == write_list_mcp_.end()) {
-            write_list_mcp_[detector_name] = new std::vector<corryvreckan::MCParticle*>();
-            mcparticle_tree_->Bronch(detector_name.c_str(),
-                                     std::string("std::vector<corryvreckan::MCParticle*>").c_str(),
-                                     &write_list_mcp_[detector_name]);
-
-            if(event > 0) {
-
-                LOG(DEBUG) << "Pre-filling new branch " << detector_name << " of corryvreckan::MCParticle with " << event
-                           << " empty events";
-                auto* branch = mcparticle_tree_->GetBranch(detector_name.c_str());
-                for(unsigned int i = 0; i < event; ++i) {
-                    branch->Fill();
-                }
-            }
-        }
-
-        // Fill the branch vector
+        // Fill the branch vector, reusing the objects of the pool
         for(auto& apx_pixel : message->getData()) {
-            auto corry_pixel = new corryvreckan::Pixel(detector_name,
-                                                       static_cast<int>(apx_pixel.getPixel().getIndex().X()),
-                                                       static_cast<int>(apx_pixel.getPixel().getIndex().Y()),
-                                                       static_cast<int>(apx_pixel.getSignal()),
-                                                       apx_pixel.getSignal(),
-                                                       event_->start());
-            write_list_px_[detector_name]->push_back(corry_pixel);
+            if(output.pixels.size() == output.pixel_pool.size()) {
+                output.pixel_pool.push_back(std::make_unique<corryvreckan::Pixel>());
+            }
+            auto* corry_pixel = output.pixel_pool[output.pixels.size()].get();
+            *corry_pixel = corryvreckan::Pixel(detector_name,
+                                               static_cast<int>(apx_pixel.getPixel().getIndex().X()),
+                                               static_cast<int>(apx_pixel.getPixel().getIndex().Y()),
+                                               static_cast<int>(apx_pixel.getSignal()),
+                                               apx_pixel.getSignal(),
+                                               event_->start());
+            output.pixels.push_back(corry_pixel);
 
             // If writing MC truth then also write out associated particle info
             if(!output_mc_truth_) {
@@ -146,12 +135,16 @@ void CorryvreckanWriterModule::run(unsigned int event) {
             auto mcp = apx_pixel.getMCParticles();
             LOG(DEBUG) << "Received " << mcp.size() << " Monte Carlo particles from pixel hit";
             for(auto& particle : mcp) {
-                auto mcParticle = new corryvreckan::MCParticle(detector_name,
-                                                               particle->getParticleID(),
-                                                               particle->getLocalStartPoint(),
-                                                               particle->getLocalEndPoint(),
-                                                               event_->start());
-                write_list_mcp_[detector_name]->push_back(mcParticle);
+                if(output.mcparticles.size() == output.mcparticle_pool.size()) {
+                    output.mcparticle_pool.push_back(std::make_unique<corryvreckan::MCParticle>());
+                }
+                auto* mcParticle = output.mcparticle_pool[output.mcparticles.size()].get();
+                *mcParticle = corryvreckan::MCParticle(detector_name,
+                                                       particle->getParticleID(),
+                                                       particle->getLocalStartPoint(),
+                                                       particle->getLocalEndPoint(),
+                                                       event_->start());
+                output.mcparticles.push_back(mcParticle);
             }
         }
     }
@@ -164,20 +157,10 @@ void CorryvreckanWriterModule::run(unsigned int event) {
         mcparticle_tree_->Fill();
     }
 
-    // Clear the current write lists
-    for(auto& index_data : write_list_px_) {
-        for(auto& pixel : (*index_data.second)) {
-            delete pixel;
-        }
-        index_data.second->clear();
-    }
-
-    // Clear the current write lists
-    for(auto& index_data : write_list_mcp_) {
-        for(auto& mcp : (*index_data.second)) {
-            delete mcp;
-        }
-        index_data.second->clear();
+    // Clear the current write lists, keeping the objects in the pools
+    for(auto& output : detector_output_) {
+        output.second.pixels.clear();
+        output.second.mcparticles.clear();
     }
 
     // Increment the time till the next event
@@ -7,7 +7,10 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -75,11 +78,28 @@ namespace allpix {
         std::vector<std::string> dut_;
 
         std::unique_ptr<TTree> event_tree_;
+        corryvreckan::Event event_data_;
         corryvreckan::Event* event_{};
 
+        /**
+         * @brief Output of a single detector, with the objects written in the current event and the pools they are taken
+         * from
+         *
+         * The objects are kept in the pools over all events and only overwritten, such that no objects need to be allocated
+         * once the pools are large enough for the largest event.
+         */
+        struct DetectorOutput {
+            std::vector<corryvreckan::Pixel*> pixels;
+            std::vector<corryvreckan::Pixel*>* pixels_address{};
+            std::vector<std::unique_ptr<corryvreckan::Pixel>> pixel_pool;
+
+            std::vector<corryvreckan::MCParticle*> mcparticles;
+            std::vector<corryvreckan::MCParticle*>* mcparticles_address{};
+            std::vector<std::unique_ptr<corryvreckan::MCParticle>> mcparticle_pool;
+        };
+
         std::unique_ptr<TTree> pixel_tree_;
         std::unique_ptr<TTree> mcparticle_tree_;
-        std::map<std::string, std::vector<corryvreckan::Pixel*>*> write_list_px_;
-        std::map<std::string, std::vector<corryvreckan::MCParticle*>*> write_list_mcp_;
+        std::map<std::string, DetectorOutput> detector_output_;
     };
 } // namespace allpix
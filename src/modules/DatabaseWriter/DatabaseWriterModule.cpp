@@ -9,8 +9,10 @@
 
 #include "DatabaseWriterModule.hpp"
 
+#include <cmath>
 #include <fstream>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #include <TBranchElement.h>
@@ -26,7 +28,26 @@
 
 using namespace allpix;
 
+namespace {
+    // Number of row numbers reserved at once for the bulk insertion
+    constexpr int id_block_size = 1000;
+
+    template <typename T> struct is_optional : std::false_type {};
+    template <typename T> struct is_optional<std::optional<T>> : std::true_type {};
+
+    // Parameters of the prepared statements, references which are not set are passed as -1 and converted to NULL
+    template <typename T> const T& parameter(const T& value) {
+        return value;
+    }
+    int parameter(const std::optional<int>& value) {
+        return value.value_or(-1);
+    }
+} // namespace
+
 DatabaseWriterModule::DatabaseWriterModule(Configuration& config, Messenger* messenger, GeometryManager*) : Module(config) {
+    // The last transaction can be committed while other modules are finalized
+    enable_parallel_finalization();
+
     // Bind to all messages
     messenger->registerListener(this, &DatabaseWriterModule::receive);
 
@@ -57,11 +78,135 @@ void DatabaseWriterModule::init() {
         throw ModuleError("Could not connect to database " + database_name_ + " at host " + host_);
     }
 
-    W_ = std::make_shared<pqxx::nontransaction>(*conn_);
-
     // inserting run entry in the database
-    pqxx::result runR = W_->exec("INSERT INTO Run (run_id) VALUES ('" + run_id_ + "') RETURNING run_nr;");
-    run_nr_ = atoi(runR[0][0].c_str());
+    {
+        pqxx::work transaction(*conn_);
+        pqxx::result runR = transaction.exec("INSERT INTO Run (run_id) VALUES (" + transaction.quote(run_id_) +
+                                             ") RETURNING run_nr;");
+        transaction.commit();
+        run_nr_ = runR[0][0].as<int>();
+    }
+
+    // Insert the rows in bulk using COPY, or one by one using prepared statements
+    bulk_insert_ = config_.get<bool>("bulk_insert", false);
+    commit_interval_ = config_.get<unsigned int>("commit_interval", 1);
+    if(commit_interval_ == 0) {
+        throw InvalidValueError(config_, "commit_interval", "commit interval should be larger than zero");
+    }
+
+    // Write the events asynchronously if requested, the event loop then does not wait for the database
+    auto async_queue_size = config_.get<size_t>("async_queue_size", 16);
+    if(async_queue_size == 0) {
+        throw InvalidValueError(config_, "async_queue_size", "queue size should be larger than zero");
+    }
+    if(config_.get<bool>("async_write", false)) {
+        LOG(DEBUG) << "Writing events asynchronously with a queue of " << async_queue_size << " events";
+        enable_async_tasks(async_queue_size);
+    }
+
+    event_table_ = {"event", "event_nr", {"run_nr", "eventid"}};
+    mctrack_table_ = {"mctrack",
+                      "mctrack_nr",
+                      {"run_nr",
+                       "event_nr",
+                       "detector",
+                       "address",
+                       "parentaddress",
+                       "particleid",
+                       "productionprocess",
+                       "productionvolume",
+                       "initialpositionx",
+                       "initialpositiony",
+                       "initialpositionz",
+                       "finalpositionx",
+                       "finalpositiony",
+                       "finalpositionz",
+                       "initialkineticenergy",
+                       "finalkineticenergy"}};
+    mcparticle_table_ = {"mcparticle",
+                         "mcparticle_nr",
+                         {"run_nr",
+                          "event_nr",
+                          "mctrack_nr",
+                          "detector",
+                          "address",
+                          "parentaddress",
+                          "trackaddress",
+                          "particleid",
+                          "localstartpointx",
+                          "localstartpointy",
+                          "localstartpointz",
+                          "localendpointx",
+                          "localendpointy",
+                          "localendpointz",
+                          "globalstartpointx",
+                          "globalstartpointy",
+                          "globalstartpointz",
+                          "globalendpointx",
+                          "globalendpointy",
+                          "globalendpointz"}};
+    depositedcharge_table_ = {"depositedcharge",
+                              "depositedcharge_nr",
+                              {"run_nr",
+                               "event_nr",
+                               "mcparticle_nr",
+                               "detector",
+                               "carriertype",
+                               "charge",
+                               "localx",
+                               "localy",
+                               "localz",
+                               "globalx",
+                               "globaly",
+                               "globalz"}};
+    propagatedcharge_table_ = {"propagatedcharge",
+                               "propagatedcharge_nr",
+                               {"run_nr",
+                                "event_nr",
+                                "depositedcharge_nr",
+                                "detector",
+                                "carriertype",
+                                "charge",
+                                "localx",
+                                "localy",
+                                "localz",
+                                "globalx",
+                                "globaly",
+                                "globalz"}};
+    pixelcharge_table_ = {"pixelcharge",
+                          "pixelcharge_nr",
+                          {"run_nr",
+                           "event_nr",
+                           "propagatedcharge_nr",
+                           "detector",
+                           "charge",
+                           "x",
+                           "y",
+                           "localx",
+                           "localy",
+                           "globalx",
+                           "globaly"}};
+    pixelhit_table_ = {"pixelhit",
+                       "pixelhit_nr",
+                       {"run_nr",
+                        "event_nr",
+                        "mcparticle_nr",
+                        "pixelcharge_nr",
+                        "detector",
+                        "x",
+                        "y",
+                        "signal",
+                        "hittime"}};
+
+    if(!bulk_insert_) {
+        prepare(event_table_);
+        prepare(mctrack_table_);
+        prepare(mcparticle_table_);
+        prepare(depositedcharge_table_);
+        prepare(propagatedcharge_table_);
+        prepare(pixelcharge_table_);
+        prepare(pixelhit_table_);
+    }
 
     // Read include and exclude list
     if(config_.has("include") && config_.has("exclude")) {
@@ -123,6 +268,11 @@ void DatabaseWriterModule::receive(std::shared_ptr<BaseMessage> message, std::st
     }
 }
 
+/**
+ * The rows of the event are collected from the objects with the references between them given as the index of the
+ * referenced row in the rows of the event, such that no row numbers of the database are required. The rows are then
+ * written by \ref write_event, on the thread of the asynchronous tasks if enabled.
+ */
 void DatabaseWriterModule::run(unsigned int event_num) {
 
     // TO BE NOTED
@@ -130,26 +280,25 @@ void DatabaseWriterModule::run(unsigned int event_num) {
     // within one event always follows this order: MCTrack -> MCParticle -> DepositedCharge -> PropagatedCharge ->
     // PixelCharge -> PixelHit
 
-    // initializing database referenced parameters to negative
-    // if negative values are retained (i.e. the corresponding object is excluded), no reference is created when inserting a
+    // initializing database referenced parameters to empty
+    // if empty values are retained (i.e. the corresponding object is excluded), no reference is created when inserting a
     // new entry in the table
-    int mctrack_nr = -1;
-    int mcparticle_nr = -1;
-    int depositedcharge_nr = -1;
-    int propagatedcharge_nr = -1;
-    int pixelcharge_nr = -1;
-
-    LOG(TRACE) << "Writing new objects to database";
+    std::optional<int> mctrack_nr;
+    std::optional<int> mcparticle_nr;
+    std::optional<int> depositedcharge_nr;
+    std::optional<int> propagatedcharge_nr;
+    std::optional<int> pixelcharge_nr;
 
-    std::stringstream insertionLine;
-    pqxx::result insertionResult;
+    LOG(TRACE) << "Collecting new objects for database";
 
-    // Writing entry to event table
-    insertionLine.str(std::string());
-    insertionLine << "INSERT INTO Event (run_nr, eventID) VALUES (" << run_nr_ << ", " << event_num
-                  << ") RETURNING event_nr;";
-    insertionResult = W_->exec(insertionLine.str());
-    int event_nr = atoi(insertionResult[0][0].c_str());
+    // The event number is filled in when the event row is written
+    auto rows = std::make_shared<EventRows>();
+    rows->event_num = event_num;
+    int event_nr = 0;
+    auto add_row = [](auto& table_rows, auto values) {
+        table_rows.emplace_back(std::move(values));
+        return static_cast<int>(table_rows.size() - 1);
+    };
 
     // Looping through messages
     for(auto& message : keep_messages_) {
@@ -173,119 +322,109 @@ void DatabaseWriterModule::run(unsigned int event_num) {
             // Writing objects to corresponding database tables
             if(class_name == "PixelHit") {
                 LOG(TRACE) << "inserting PixelHit" << std::endl;
-                PixelHit hit = static_cast<PixelHit&>(current_object);
-                insertionLine.str(std::string());
-                insertionLine << "INSERT INTO PixelHit (run_nr, event_nr, ";
-                if(mcparticle_nr >= 0)
-                    insertionLine << "mcparticle_nr, ";
-                if(pixelcharge_nr >= 0)
-                    insertionLine << "pixelcharge_nr, ";
-                insertionLine << "detector, x, y, signal, hittime) VALUES (" << run_nr_ << ", " << event_nr << ", ";
-                if(mcparticle_nr >= 0)
-                    insertionLine << mcparticle_nr << ", ";
-                if(pixelcharge_nr >= 0)
-                    insertionLine << pixelcharge_nr << ", ";
-                insertionLine << "'" << detectorName << "', " << hit.getIndex().X() << ", " << hit.getIndex().Y() << ", "
-                              << hit.getSignal() << ", " << hit.getTime() << ") RETURNING pixelHit_nr;";
-                insertionResult = W_->exec(insertionLine.str());
+                auto& hit = static_cast<PixelHit&>(current_object);
+                // The hit time is stored as integer, rounded as done by the database
+                add_row(rows->pixelhits,
+                        std::make_tuple(run_nr_,
+                                        event_nr,
+                                        mcparticle_nr,
+                                        pixelcharge_nr,
+                                        detectorName,
+                                        hit.getIndex().X(),
+                                        hit.getIndex().Y(),
+                                        hit.getSignal(),
+                                        static_cast<int>(std::lround(hit.getTime()))));
             } else if(class_name == "PixelCharge") {
                 LOG(TRACE) << "inserting PixelCharge" << std::endl;
-                PixelCharge charge = static_cast<PixelCharge&>(current_object);
-                insertionLine.str(std::string());
-                insertionLine << "INSERT INTO PixelCharge (run_nr, event_nr, ";
-                if(propagatedcharge_nr >= 0)
-                    insertionLine << "propagatedcharge_nr, ";
-                insertionLine << "detector, charge, x, y, localx, localy, globalx, globaly) VALUES (" << run_nr_ << ", "
-                              << event_nr << ", ";
-                if(propagatedcharge_nr >= 0)
-                    insertionLine << propagatedcharge_nr << ", ";
-                insertionLine << "'" << detectorName << "', " << charge.getCharge() << ", " << charge.getIndex().X() << ", "
-                              << charge.getIndex().Y() << ", " << charge.getPixel().getLocalCenter().X() << ", "
-                              << charge.getPixel().getLocalCenter().Y() << ", " << charge.getPixel().getGlobalCenter().X()
-                              << ", " << charge.getPixel().getGlobalCenter().Y() << ") RETURNING pixelCharge_nr";
-                insertionResult = W_->exec(insertionLine.str());
-                pixelcharge_nr = atoi(insertionResult[0][0].c_str());
+                auto& charge = static_cast<PixelCharge&>(current_object);
+                pixelcharge_nr = add_row(rows->pixelcharges,
+                                         std::make_tuple(run_nr_,
+                                                         event_nr,
+                                                         propagatedcharge_nr,
+                                                         detectorName,
+                                                         charge.getCharge(),
+                                                         charge.getIndex().X(),
+                                                         charge.getIndex().Y(),
+                                                         charge.getPixel().getLocalCenter().X(),
+                                                         charge.getPixel().getLocalCenter().Y(),
+                                                         charge.getPixel().getGlobalCenter().X(),
+                                                         charge.getPixel().getGlobalCenter().Y()));
             } else if(class_name == "PropagatedCharge") { // not recommended, this will slow down the simulation considerably
                 LOG(TRACE) << "inserting PropagatedCharge" << std::endl;
-                PropagatedCharge charge = static_cast<PropagatedCharge&>(current_object);
-                insertionLine.str(std::string());
-                insertionLine << "INSERT INTO PropagatedCharge (run_nr, event_nr, ";
-                if(depositedcharge_nr >= 0)
-                    insertionLine << "depositedcharge_nr, ";
-                insertionLine << "detector, carriertype, charge, localx, localy, localz, globalx, globaly, globalz) VALUES ("
-                              << run_nr_ << ", " << event_nr << ", ";
-                if(depositedcharge_nr >= 0)
-                    insertionLine << depositedcharge_nr << ", ";
-                insertionLine << "'" << detectorName << "', " << static_cast<int>(charge.getType()) << ", "
-                              << charge.getCharge() << ", " << charge.getLocalPosition().X() << ", "
-                              << charge.getLocalPosition().Y() << ", " << charge.getLocalPosition().Z() << ", "
-                              << charge.getGlobalPosition().X() << ", " << charge.getGlobalPosition().Y() << ", "
-                              << charge.getGlobalPosition().Z() << ") RETURNING propagatedcharge_nr;";
-                insertionResult = W_->exec(insertionLine.str());
-                propagatedcharge_nr = atoi(insertionResult[0][0].c_str());
+                auto& charge = static_cast<PropagatedCharge&>(current_object);
+                propagatedcharge_nr = add_row(rows->propagatedcharges,
+                                              std::make_tuple(run_nr_,
+                                                              event_nr,
+                                                              depositedcharge_nr,
+                                                              detectorName,
+                                                              static_cast<int>(charge.getType()),
+                                                              charge.getCharge(),
+                                                              charge.getLocalPosition().X(),
+                                                              charge.getLocalPosition().Y(),
+                                                              charge.getLocalPosition().Z(),
+                                                              charge.getGlobalPosition().X(),
+                                                              charge.getGlobalPosition().Y(),
+                                                              charge.getGlobalPosition().Z()));
             } else if(class_name == "MCTrack") {
                 LOG(TRACE) << "inserting MCTrack" << std::endl;
-                MCTrack track = static_cast<MCTrack&>(current_object);
-                insertionLine.str(std::string());
-                insertionLine << "INSERT INTO MCTrack (run_nr, event_nr, detector, address, parentAddress, particleID, "
-                                 "productionProcess, productionVolume, initialPositionX, initialPositionY, "
-                                 "initialPositionZ, finalPositionX, finalPositionY, finalPositionZ, initialKineticEnergy, "
-                                 "finalKineticEnergy) VALUES ("
-                              << run_nr_ << ", " << event_nr << ", '" << detectorName << "', "
-                              << reinterpret_cast<uintptr_t>(&current_object) << ", "
-                              << reinterpret_cast<uintptr_t>(track.getParent()) << ", " << track.getParticleID() << ", '"
-                              << track.getCreationProcessName() << "', '" << track.getOriginatingVolumeName() << "', "
-                              << track.getStartPoint().X() << ", " << track.getStartPoint().Y() << ", "
-                              << track.getStartPoint().Z() << ", " << track.getEndPoint().X() << ", "
-                              << track.getEndPoint().Y() << ", " << track.getEndPoint().Z() << ", "
-                              << track.getKineticEnergyInitial() << ", " << track.getKineticEnergyFinal()
-                              << ") RETURNING mctrack_nr;";
-                insertionResult = W_->exec(insertionLine.str());
-                mctrack_nr = atoi(insertionResult[0][0].c_str());
+                auto& track = static_cast<MCTrack&>(current_object);
+                mctrack_nr = add_row(rows->mctracks,
+                                     std::make_tuple(run_nr_,
+                                                     event_nr,
+                                                     detectorName,
+                                                     reinterpret_cast<uintptr_t>(&current_object),
+                                                     reinterpret_cast<uintptr_t>(track.getParent()),
+                                                     track.getParticleID(),
+                                                     track.getCreationProcessName(),
+                                                     track.getOriginatingVolumeName(),
+                                                     track.getStartPoint().X(),
+                                                     track.getStartPoint().Y(),
+                                                     track.getStartPoint().Z(),
+                                                     track.getEndPoint().X(),
+                                                     track.getEndPoint().Y(),
+                                                     track.getEndPoint().Z(),
+                                                     track.getKineticEnergyInitial(),
+                                                     track.getKineticEnergyFinal()));
             } else if(class_name == "DepositedCharge") {
                 LOG(TRACE) << "inserting DepositedCharge" << std::endl;
-                DepositedCharge charge = static_cast<DepositedCharge&>(current_object);
-                insertionLine.str(std::string());
-                insertionLine << "INSERT INTO DepositedCharge (run_nr, event_nr, ";
-                if(mcparticle_nr >= 0)
-                    insertionLine << "mcparticle_nr, ";
-                insertionLine << "detector, carriertype, charge, localx, localy, localz, globalx, globaly, globalz) VALUES ("
-                              << run_nr_ << ", " << event_nr << ", ";
-                if(mcparticle_nr >= 0)
-                    insertionLine << mcparticle_nr << ", ";
-                insertionLine << "'" << detectorName << "', " << static_cast<int>(charge.getType()) << ", "
-                              << charge.getCharge() << ", " << charge.getLocalPosition().X() << ", "
-                              << charge.getLocalPosition().Y() << ", " << charge.getLocalPosition().Z() << ", "
-                              << charge.getGlobalPosition().X() << ", " << charge.getGlobalPosition().Y() << ", "
-                              << charge.getGlobalPosition().Z() << ") RETURNING depositedcharge_nr";
-                insertionResult = W_->exec(insertionLine.str());
-                depositedcharge_nr = atoi(insertionResult[0][0].c_str());
+                auto& charge = static_cast<DepositedCharge&>(current_object);
+                depositedcharge_nr = add_row(rows->depositedcharges,
+                                             std::make_tuple(run_nr_,
+                                                             event_nr,
+                                                             mcparticle_nr,
+                                                             detectorName,
+                                                             static_cast<int>(charge.getType()),
+                                                             charge.getCharge(),
+                                                             charge.getLocalPosition().X(),
+                                                             charge.getLocalPosition().Y(),
+                                                             charge.getLocalPosition().Z(),
+                                                             charge.getGlobalPosition().X(),
+                                                             charge.getGlobalPosition().Y(),
+                                                             charge.getGlobalPosition().Z()));
             } else if(class_name == "MCParticle") {
                 LOG(TRACE) << "inserting MCParticle" << std::endl;
-                MCParticle particle = static_cast<MCParticle&>(current_object);
-                insertionLine.str(std::string());
-                insertionLine << "INSERT INTO MCParticle (run_nr, event_nr, ";
-                if(mctrack_nr >= 0)
-                    insertionLine << "mctrack_nr, ";
-                insertionLine
-                    << "detector, address, parentAddress, trackAddress, particleID, localStartPointX, localStartPointY, "
-                       "localStartPointZ, localEndPointX, localEndPointY, localEndPointZ, globalStartPointX, "
-                       "globalStartPointY, globalStartPointZ, globalEndPointX, globalEndPointY, globalEndPointZ) VALUES ("
-                    << run_nr_ << ", " << event_nr << ", ";
-                if(mctrack_nr >= 0)
-                    insertionLine << mctrack_nr << ", ";
-                insertionLine << "'" << detectorName << "', " << reinterpret_cast<uintptr_t>(&current_object) << ", "
-                              << reinterpret_cast<uintptr_t>(particle.getParent()) << ", "
-                              << reinterpret_cast<uintptr_t>(particle.getTrack()) << ", " << particle.getParticleID() << ", "
-                              << particle.getLocalStartPoint().X() << ", " << particle.getLocalStartPoint().Y() << ", "
-                              << particle.getLocalStartPoint().Z() << ", " << particle.getLocalEndPoint().X() << ", "
-                              << particle.getLocalEndPoint().Y() << ", " << particle.getLocalEndPoint().Z() << ", "
-                              << particle.getGlobalStartPoint().X() << ", " << particle.getGlobalStartPoint().Y() << ", "
-                              << particle.getGlobalStartPoint().Z() << ", " << particle.getGlobalEndPoint().X() << ", "
-                              << particle.getGlobalEndPoint().Y() << ", " << particle.getGlobalEndPoint().Z()
-                              << ") RETURNING mcparticle_nr;";
-                insertionResult = W_->exec(insertionLine.str());
-                mcparticle_nr = atoi(insertionResult[0][0].c_str());
+                auto& particle = static_cast<MCParticle&>(current_object);
+                mcparticle_nr = add_row(rows->mcparticles,
+                                        std::make_tuple(run_nr_,
+                                                        event_nr,
+                                                        mctrack_nr,
+                                                        detectorName,
+                                                        reinterpret_cast<uintptr_t>(&current_object),
+                                                        reinterpret_cast<uintptr_t>(particle.getParent()),
+                                                        reinterpret_cast<uintptr_t>(particle.getTrack()),
+                                                        particle.getParticleID(),
+                                                        particle.getLocalStartPoint().X(),
+                                                        particle.getLocalStartPoint().Y(),
+                                                        particle.getLocalStartPoint().Z(),
+                                                        particle.getLocalEndPoint().X(),
+                                                        particle.getLocalEndPoint().Y(),
+                                                        particle.getLocalEndPoint().Z(),
+                                                        particle.getGlobalStartPoint().X(),
+                                                        particle.getGlobalStartPoint().Y(),
+                                                        particle.getGlobalStartPoint().Z(),
+                                                        particle.getGlobalEndPoint().X(),
+                                                        particle.getGlobalEndPoint().Y(),
+                                                        particle.getGlobalEndPoint().Z()));
             } else {
                 LOG(WARNING) << "Following object type is not yet accounted for in database output: " << class_name
                              << std::endl;
@@ -297,9 +436,79 @@ void DatabaseWriterModule::run(unsigned int event_num) {
 
     // Clear the messages we have to keep because they contain the internal pointers
     keep_messages_.clear();
+
+    // Write the rows, the task owns them such that it can be executed after the event
+    run_async([this, rows]() { write_event(*rows); });
+}
+
+/**
+ * The references of the rows are converted from the index of the referenced row in the event to the row number of the
+ * database assigned when inserting the referenced row, following the order of the references between the tables.
+ */
+void DatabaseWriterModule::write_event(EventRows& rows) {
+    LOG(TRACE) << "Writing new objects to database";
+
+    // Start a new transaction for the next events
+    if(transaction_ == nullptr) {
+        transaction_ = std::make_unique<pqxx::work>(*conn_);
+    }
+
+    // Writing entry to event table
+    int event_nr = insert(event_table_, std::make_tuple(run_nr_, rows.event_num));
+
+    auto link = [](std::optional<int>& reference, const std::vector<int>& row_numbers) {
+        if(reference.has_value()) {
+            reference = row_numbers[static_cast<size_t>(*reference)];
+        }
+    };
+
+    std::vector<int> mctrack_nrs;
+    for(auto& values : rows.mctracks) {
+        std::get<1>(values) = event_nr;
+        mctrack_nrs.push_back(insert(mctrack_table_, std::move(values)));
+    }
+    std::vector<int> mcparticle_nrs;
+    for(auto& values : rows.mcparticles) {
+        std::get<1>(values) = event_nr;
+        link(std::get<2>(values), mctrack_nrs);
+        mcparticle_nrs.push_back(insert(mcparticle_table_, std::move(values)));
+    }
+    std::vector<int> depositedcharge_nrs;
+    for(auto& values : rows.depositedcharges) {
+        std::get<1>(values) = event_nr;
+        link(std::get<2>(values), mcparticle_nrs);
+        depositedcharge_nrs.push_back(insert(depositedcharge_table_, std::move(values)));
+    }
+    std::vector<int> propagatedcharge_nrs;
+    for(auto& values : rows.propagatedcharges) {
+        std::get<1>(values) = event_nr;
+        link(std::get<2>(values), depositedcharge_nrs);
+        propagatedcharge_nrs.push_back(insert(propagatedcharge_table_, std::move(values)));
+    }
+    std::vector<int> pixelcharge_nrs;
+    for(auto& values : rows.pixelcharges) {
+        std::get<1>(values) = event_nr;
+        link(std::get<2>(values), propagatedcharge_nrs);
+        pixelcharge_nrs.push_back(insert(pixelcharge_table_, std::move(values)));
+    }
+    for(auto& values : rows.pixelhits) {
+        std::get<1>(values) = event_nr;
+        link(std::get<2>(values), mcparticle_nrs);
+        link(std::get<3>(values), pixelcharge_nrs);
+        insert(pixelhit_table_, std::move(values));
+    }
+
+    // Commit the events written since the last commit
+    if(++uncommitted_events_ >= commit_interval_) {
+        commit();
+    }
 }
 
 void DatabaseWriterModule::finalize() {
+    // Commit the remaining events
+    if(transaction_ != nullptr) {
+        commit();
+    }
 
     // disconnecting from database
     conn_->disconnect();
@@ -307,3 +516,80 @@ void DatabaseWriterModule::finalize() {
     // Print statistics
     LOG(STATUS) << "Wrote " << write_cnt_ << " objects from " << msg_cnt_ << " messages to database" << std::endl;
 }
+
+void DatabaseWriterModule::commit() {
+    // Copy the buffered rows in the order of the references between the tables
+    if(bulk_insert_) {
+        LOG(DEBUG) << "Copying rows of " << uncommitted_events_ << " events to database";
+        stream_rows(event_table_);
+        stream_rows(mctrack_table_);
+        stream_rows(mcparticle_table_);
+        stream_rows(depositedcharge_table_);
+        stream_rows(propagatedcharge_table_);
+        stream_rows(pixelcharge_table_);
+        stream_rows(pixelhit_table_);
+    }
+
+    transaction_->commit();
+    transaction_.reset();
+    uncommitted_events_ = 0;
+}
+
+template <typename... T> void DatabaseWriterModule::prepare(const Table<T...>& table) {
+    std::vector<bool> nullable = {is_optional<T>::value...};
+
+    std::string columns;
+    std::string values;
+    for(size_t i = 0; i < table.columns.size(); ++i) {
+        if(i > 0) {
+            columns += ", ";
+            values += ", ";
+        }
+        columns += table.columns[i];
+        auto placeholder = "$" + std::to_string(i + 1);
+        values += (nullable[i] ? "NULLIF(" + placeholder + ", -1)" : placeholder);
+    }
+    conn_->prepare(table.name,
+                   "INSERT INTO " + table.name + " (" + columns + ") VALUES (" + values + ") RETURNING " + table.id_column +
+                       ";");
+}
+
+template <typename... T>
+int DatabaseWriterModule::insert(Table<T...>& table, typename Table<T...>::Values values) {
+    if(!bulk_insert_) {
+        auto result = std::apply(
+            [&](const auto&... args) { return transaction_->exec_prepared(table.name, parameter(args)...); }, values);
+        return result[0][0].template as<int>();
+    }
+
+    // Reserve the row numbers from the sequence of the table, as they are needed for the references before the rows are
+    // actually inserted
+    if(table.next_id == table.ids.size()) {
+        auto result = transaction_->exec("SELECT nextval(pg_get_serial_sequence('" + table.name + "', '" + table.id_column +
+                                         "')) FROM generate_series(1, " + std::to_string(id_block_size) + ");");
+        table.ids.clear();
+        for(const auto& row : result) {
+            table.ids.push_back(row[0].template as<int>());
+        }
+        table.next_id = 0;
+    }
+
+    auto id = table.ids[table.next_id++];
+    table.rows.push_back(std::tuple_cat(std::make_tuple(id), std::move(values)));
+    return id;
+}
+
+template <typename... T> void DatabaseWriterModule::stream_rows(Table<T...>& table) {
+    if(table.rows.empty()) {
+        return;
+    }
+
+    std::vector<std::string> columns = {table.id_column};
+    columns.insert(columns.end(), table.columns.begin(), table.columns.end());
+    pqxx::stream_to stream(*transaction_, table.name, columns);
+    for(const auto& row : table.rows) {
+        stream << row;
+    }
+    stream.complete();
+    table.rows.clear();
+}
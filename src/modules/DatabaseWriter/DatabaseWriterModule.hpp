@@ -7,9 +7,15 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <cstdint>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -63,13 +69,141 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Table of the database with its columns, the rows buffered for bulk insertion and the reserved row numbers
+         *
+         * The values of the rows exclude the row number of the table itself, which is the first column of the buffered rows.
+         * References to other tables which are not set are passed as empty optionals.
+         */
+        template <typename... T> struct Table {
+            using Values = std::tuple<T...>;
+
+            Table() = default;
+            Table(std::string table_name, std::string table_id_column, std::vector<std::string> table_columns)
+                : name(std::move(table_name)), id_column(std::move(table_id_column)), columns(std::move(table_columns)) {}
+
+            std::string name;
+            std::string id_column;
+            std::vector<std::string> columns;
+            std::vector<std::tuple<int, T...>> rows;
+            std::vector<int> ids;
+            size_t next_id{};
+        };
+
+        /**
+         * @brief Prepare the insertion statement of a table, returning the number of the inserted row
+         * @param table Table to prepare the statement for
+         */
+        template <typename... T> void prepare(const Table<T...>& table);
+
+        /**
+         * @brief Insert a row into a table, directly or buffered for the next bulk insertion
+         * @param table Table to insert the row in
+         * @param values Values of all columns except the row number
+         * @return Number of the inserted row
+         */
+        template <typename... T> int insert(Table<T...>& table, typename Table<T...>::Values values);
+
+        /**
+         * @brief Copy all buffered rows of a table to the database
+         * @param table Table to write the rows of
+         */
+        template <typename... T> void stream_rows(Table<T...>& table);
+
+        /**
+         * @brief Write all buffered rows and commit the current transaction
+         */
+        void commit();
+
+        using EventTable = Table<int, unsigned int>;
+        using MCTrackTable = Table<int,
+                                   int,
+                                   std::string,
+                                   uintptr_t,
+                                   uintptr_t,
+                                   int,
+                                   std::string,
+                                   std::string,
+                                   double,
+                                   double,
+                                   double,
+                                   double,
+                                   double,
+                                   double,
+                                   double,
+                                   double>;
+        using MCParticleTable = Table<int,
+                                      int,
+                                      std::optional<int>,
+                                      std::string,
+                                      uintptr_t,
+                                      uintptr_t,
+                                      uintptr_t,
+                                      int,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double,
+                                      double>;
+        using SensorChargeTable = Table<int,
+                                        int,
+                                        std::optional<int>,
+                                        std::string,
+                                        int,
+                                        unsigned int,
+                                        double,
+                                        double,
+                                        double,
+                                        double,
+                                        double,
+                                        double>;
+        using PixelChargeTable = Table<int,
+                                       int,
+                                       std::optional<int>,
+                                       std::string,
+                                       unsigned int,
+                                       unsigned int,
+                                       unsigned int,
+                                       double,
+                                       double,
+                                       double,
+                                       double>;
+        using PixelHitTable =
+            Table<int, int, std::optional<int>, std::optional<int>, std::string, unsigned int, unsigned int, double, int>;
+
+        /**
+         * @brief Rows of all tables collected for an event, with references given as index of the row in the event
+         */
+        struct EventRows {
+            unsigned int event_num{};
+            std::vector<MCTrackTable::Values> mctracks;
+            std::vector<MCParticleTable::Values> mcparticles;
+            std::vector<SensorChargeTable::Values> depositedcharges;
+            std::vector<SensorChargeTable::Values> propagatedcharges;
+            std::vector<PixelChargeTable::Values> pixelcharges;
+            std::vector<PixelHitTable::Values> pixelhits;
+        };
+
+        /**
+         * @brief Write the rows of an event to the database, converting the references to the row numbers of the database
+         * @param rows Rows of the event
+         */
+        void write_event(EventRows& rows);
+
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
         // postgreSQL objects
         std::shared_ptr<pqxx::connection> conn_;
-        std::shared_ptr<pqxx::nontransaction> W_;
+        std::unique_ptr<pqxx::work> transaction_;
         std::string host_;
         std::string port_;
         std::string database_name_;
@@ -78,7 +212,21 @@ namespace allpix {
         std::string run_id_;
         int run_nr_;
 
-        // List of messages to keep so they can be stored in the tree
+        // Tables of the database
+        EventTable event_table_;
+        MCTrackTable mctrack_table_;
+        MCParticleTable mcparticle_table_;
+        SensorChargeTable depositedcharge_table_;
+        SensorChargeTable propagatedcharge_table_;
+        PixelChargeTable pixelcharge_table_;
+        PixelHitTable pixelhit_table_;
+
+        // Insertion of the rows in bulk, and number of events committed together
+        bool bulk_insert_{};
+        unsigned int commit_interval_{};
+        unsigned int uncommitted_events_{};
+
+        // List of messages to keep until their objects are converted to rows
         std::vector<std::shared_ptr<BaseMessage>> keep_messages_;
         // List of objects of a particular type, bound to a specific detector and having a particular name
         std::map<std::tuple<std::type_index, std::string, std::string>, std::vector<Object*>*> write_list_;
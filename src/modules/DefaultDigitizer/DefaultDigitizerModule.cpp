@@ -17,14 +17,56 @@
 #include <TH1D.h>
 #include <TProfile.h>
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
 using namespace allpix;
 
+namespace {
+    /**
+     * @brief Fill an array with standard normal distributed random numbers using the Box-Muller transform
+     * @param engine Random engine to draw the uniform random numbers from
+     * @param values Vector to fill, all elements are overwritten
+     *
+     * The uniform random numbers are drawn first, such that the transform itself is a single loop without dependencies
+     * between the elements which can be vectorized by the compiler.
+     */
+    void fill_normal(PhiloxRandomEngine& engine, std::vector<double>& values) {
+        auto pairs = (values.size() + 1) / 2;
+        values.resize(2 * pairs);
+        for(auto& value : values) {
+            // Uniform numbers in (0, 1] to avoid the logarithm of zero
+            value = (static_cast<double>(engine() >> 11u) + 1.0) * 0x1.0p-53;
+        }
+        for(size_t i = 0; i < pairs; ++i) {
+            auto radius = std::sqrt(-2.0 * std::log(values[2 * i]));
+            auto angle = 2.0 * M_PI * values[2 * i + 1];
+            values[2 * i] = radius * std::cos(angle);
+            values[2 * i + 1] = radius * std::sin(angle);
+        }
+    }
+
+    /**
+     * @brief Draw a single standard normal distributed random number using the Box-Muller transform
+     * @param uniform Function returning uniform random numbers in (0, 1]
+     * @return Standard normal distributed random number
+     */
+    template <typename Uniform> double draw_normal(Uniform& uniform) {
+        auto radius = std::sqrt(-2.0 * std::log(uniform()));
+        return radius * std::cos(2.0 * M_PI * uniform());
+    }
+} // namespace
+
 DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
                                                Messenger* messenger,
                                                std::shared_ptr<Detector> detector)
     : Module(config, std::move(detector)), messenger_(messenger), pixel_message_(nullptr) {
-    // Enable parallelization of this module if multithreading is enabled
+    // Enable parallelization of this module if multithreading is enabled, the histograms are filled per thread such that
+    // also several events can be digitized at the same time
     enable_parallelization();
+    enable_event_parallelization();
 
     // Require PixelCharge message for single detector
     messenger_->bindSingle(this, &DefaultDigitizerModule::pixel_message_, MsgFlags::REQUIRED);
@@ -64,9 +106,34 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
     config_.setDefault<int>("output_plots_scale", Units::get(30, "ke"));
     config_.setDefault<int>("output_plots_timescale", Units::get(300, "ns"));
     config_.setDefault<int>("output_plots_bins", 100);
+
+    config_.setDefault<bool>("batched_noise", false);
+    config_.setDefault<double>("noise_occupancy", 0.0);
+    config_.setDefault<std::string>("sweep_parameter", "threshold");
+    batched_noise_ = config_.get<bool>("batched_noise");
 }
 
 void DefaultDigitizerModule::init() {
+    // Bind the parameters used for every pixel to avoid parsing them in every event. They are bound here rather than in the
+    // constructor such that parameter sweeps and jobs changing them take effect when the module is initialized again.
+    config_.bind("output_plots", output_plots_);
+    config_.bind("electronics_noise", electronics_noise_);
+    config_.bind("gain", gain_);
+    config_.bind("gain_smearing", gain_smearing_);
+    config_.bind("threshold", threshold_);
+    config_.bind("threshold_smearing", threshold_smearing_);
+    config_.bind("qdc_resolution", qdc_resolution_);
+    config_.bind("qdc_smearing", qdc_smearing_);
+    config_.bind("qdc_offset", qdc_offset_);
+    config_.bind("qdc_slope", qdc_slope_);
+    config_.bind("allow_zero_qdc", allow_zero_qdc_);
+    config_.bind("tdc_resolution", tdc_resolution_);
+    config_.bind("tdc_smearing", tdc_smearing_);
+    config_.bind("tdc_offset", tdc_offset_);
+    config_.bind("tdc_slope", tdc_slope_);
+    config_.bind("allow_zero_tdc", allow_zero_tdc_);
+    config_.bind("noise_occupancy", noise_occupancy_);
+
     // Conversion to ADC units requested:
     if(config_.get<int>("qdc_resolution") > 31) {
         throw InvalidValueError(config_, "qdc_resolution", "precision higher than 31bit is not possible");
@@ -83,6 +150,61 @@ void DefaultDigitizerModule::init() {
                   << "bit, max. value " << ((1 << config_.get<int>("tdc_resolution")) - 1);
     }
 
+    if(noise_occupancy_ < 0 || noise_occupancy_ >= 1) {
+        throw InvalidValueError(config_, "noise_occupancy", "noise occupancy has to be within [0, 1)");
+    }
+    if(noise_occupancy_ > 0) {
+        log_noise_complement_ = std::log1p(-noise_occupancy_);
+        auto npixels = getDetector()->getModel()->getNPixels();
+        LOG(INFO) << "Adding noise hits with an occupancy of " << noise_occupancy_ << ", on average "
+                  << noise_occupancy_ * npixels.x() * npixels.y() << " hits per event";
+    }
+
+    // Set up the points of the parameter sweep, every point varies a single parameter of the nominal configuration
+    if(config_.has("sweep_values")) {
+        auto parameter = config_.get<std::string>("sweep_parameter");
+        std::transform(parameter.begin(), parameter.end(), parameter.begin(), ::tolower);
+        auto values = config_.getArray<double>("sweep_values");
+        auto names = config_.getArray<std::string>("sweep_names", {});
+        if(!names.empty() && names.size() != values.size()) {
+            throw InvalidValueError(config_, "sweep_names", "number of names has to match the number of sweep values");
+        }
+
+        const std::map<std::string, double SweepPoint::*> parameters = {{"gain", &SweepPoint::gain},
+                                                                         {"threshold", &SweepPoint::threshold},
+                                                                         {"qdc_offset", &SweepPoint::qdc_offset},
+                                                                         {"qdc_slope", &SweepPoint::qdc_slope},
+                                                                         {"tdc_offset", &SweepPoint::tdc_offset},
+                                                                         {"tdc_slope", &SweepPoint::tdc_slope}};
+        auto swept = parameters.find(parameter);
+        if(swept == parameters.end()) {
+            throw InvalidValueError(config_,
+                                    "sweep_parameter",
+                                    "only 'gain', 'threshold', 'qdc_offset', 'qdc_slope', 'tdc_offset' and 'tdc_slope' "
+                                    "can be swept");
+        }
+
+        std::set<std::string> unique_names;
+        for(size_t i = 0; i < values.size(); ++i) {
+            SweepPoint point{(names.empty() ? parameter + "_" + std::to_string(i) : names[i]),
+                             gain_,
+                             static_cast<double>(threshold_),
+                             qdc_offset_,
+                             qdc_slope_,
+                             tdc_offset_,
+                             tdc_slope_};
+            if(!unique_names.insert(point.name).second) {
+                throw InvalidValueError(config_, "sweep_names", "names of the sweep points have to be unique");
+            }
+            point.*(swept->second) = values[i];
+            if((parameter == "qdc_slope" || parameter == "tdc_slope") && values[i] == 0) {
+                throw InvalidValueError(config_, "sweep_values", "slope of the conversion cannot be zero");
+            }
+            sweep_points_.push_back(point);
+        }
+        LOG(INFO) << "Sweeping " << parameter << " over " << sweep_points_.size() << " points";
+    }
+
     if(config_.get<bool>("output_plots")) {
         LOG(TRACE) << "Creating output plots";
 
@@ -91,104 +213,165 @@ void DefaultDigitizerModule::init() {
         auto nbins = config_.get<int>("output_plots_bins");
 
         // Create histograms if needed
-        h_pxq = new TH1D("pixelcharge", "raw pixel charge;pixel charge [ke];pixels", nbins, 0, maximum);
-        h_pxq_noise = new TH1D("pixelcharge_noise", "pixel charge w/ el. noise;pixel charge [ke];pixels", nbins, 0, maximum);
-        h_gain = new TH1D("gain", "applied gain; gain factor;events", 40, -20, 20);
-        h_pxq_gain =
-            new TH1D("pixelcharge_gain", "pixel charge w/ gain applied;pixel charge [ke];pixels", nbins, 0, maximum);
-        h_thr = new TH1D("threshold", "applied threshold; threshold [ke];events", maximum, 0, maximum / 10);
-        h_pxq_thr =
-            new TH1D("pixelcharge_threshold", "pixel charge above threshold;pixel charge [ke];pixels", nbins, 0, maximum);
+        h_pxq = std::make_unique<ThreadedHistogram<TH1D>>(
+            "pixelcharge", "raw pixel charge;pixel charge [ke];pixels", nbins, 0, maximum);
+        h_pxq_noise = std::make_unique<ThreadedHistogram<TH1D>>(
+            "pixelcharge_noise", "pixel charge w/ el. noise;pixel charge [ke];pixels", nbins, 0, maximum);
+        h_gain = std::make_unique<ThreadedHistogram<TH1D>>("gain", "applied gain; gain factor;events", 40, -20, 20);
+        h_pxq_gain = std::make_unique<ThreadedHistogram<TH1D>>(
+            "pixelcharge_gain", "pixel charge w/ gain applied;pixel charge [ke];pixels", nbins, 0, maximum);
+        h_thr = std::make_unique<ThreadedHistogram<TH1D>>(
+            "threshold", "applied threshold; threshold [ke];events", maximum, 0, maximum / 10);
+        h_pxq_thr = std::make_unique<ThreadedHistogram<TH1D>>(
+            "pixelcharge_threshold", "pixel charge above threshold;pixel charge [ke];pixels", nbins, 0, maximum);
 
         // Create final pixel charge plot with different axis, depending on whether ADC simulation is enabled or not
         if(config_.get<int>("qdc_resolution") > 0) {
-            h_pxq_adc_smear = new TH1D(
+            h_pxq_adc_smear = std::make_unique<ThreadedHistogram<TH1D>>(
                 "pixelcharge_adc_smeared", "pixel charge after QDC smearing;pixel charge [ke];pixels", nbins, 0, maximum);
 
             int adcbins = (1 << config_.get<int>("qdc_resolution"));
-            h_pxq_adc = new TH1D("pixelcharge_adc", "pixel charge after QDC;pixel charge [QDC];pixels", adcbins, 0, adcbins);
-            h_calibration = new TH2D("charge_adc_calibration",
-                                     "calibration curve of pixel charge to QDC units;pixel charge [ke];pixel charge [QDC]",
-                                     nbins,
-                                     0,
-                                     maximum,
-                                     adcbins,
-                                     0,
-                                     adcbins);
+            h_pxq_adc = std::make_unique<ThreadedHistogram<TH1D>>(
+                "pixelcharge_adc", "pixel charge after QDC;pixel charge [QDC];pixels", adcbins, 0, adcbins);
+            h_calibration = std::make_unique<ThreadedHistogram<TH2D>>(
+                "charge_adc_calibration",
+                "calibration curve of pixel charge to QDC units;pixel charge [ke];pixel charge [QDC]",
+                nbins,
+                0,
+                maximum,
+                adcbins,
+                0,
+                adcbins);
         } else {
-            h_pxq_adc = new TH1D("pixelcharge_adc", "final pixel charge;pixel charge [ke];pixels", nbins, 0, maximum);
+            h_pxq_adc = std::make_unique<ThreadedHistogram<TH1D>>(
+                "pixelcharge_adc", "final pixel charge;pixel charge [ke];pixels", nbins, 0, maximum);
         }
 
         int time_maximum = static_cast<int>(Units::convert(config_.get<int>("output_plots_timescale"), "ns"));
-        h_px_toa = new TH1D("pixel_toa", "pixel time-of-arrival;pixel ToA [ns];pixels", nbins, 0, maximum);
+        h_px_toa = std::make_unique<ThreadedHistogram<TH1D>>(
+            "pixel_toa", "pixel time-of-arrival;pixel ToA [ns];pixels", nbins, 0, maximum);
 
         // Create time-of-arrival plot with different axis, depending on whether TDC simulation is enabled or not
         if(config_.get<int>("tdc_resolution") > 0) {
-            h_px_tdc_smear = new TH1D("pixel_tdc_smeared",
-                                      "pixel time-of-arrival after TDC smearing;pixel ToA [ns];pixels",
-                                      nbins,
-                                      0,
-                                      time_maximum);
+            h_px_tdc_smear =
+                std::make_unique<ThreadedHistogram<TH1D>>("pixel_tdc_smeared",
+                                                          "pixel time-of-arrival after TDC smearing;pixel ToA [ns];pixels",
+                                                          nbins,
+                                                          0,
+                                                          time_maximum);
 
             int adcbins = (1 << config_.get<int>("tdc_resolution"));
-            h_px_tdc = new TH1D("pixel_tdc", "pixel time-of-arrival after TDC;pixel ToA [TDC];pixels", adcbins, 0, adcbins);
-            h_toa_calibration =
-                new TH2D("tdc_calibration",
-                         "calibration curve of pixel time-of-arrival to TDC units;pixel ToA [ns];pixel ToA [TDC]",
-                         nbins,
-                         0,
-                         time_maximum,
-                         adcbins,
-                         0,
-                         adcbins);
+            h_px_tdc = std::make_unique<ThreadedHistogram<TH1D>>(
+                "pixel_tdc", "pixel time-of-arrival after TDC;pixel ToA [TDC];pixels", adcbins, 0, adcbins);
+            h_toa_calibration = std::make_unique<ThreadedHistogram<TH2D>>(
+                "tdc_calibration",
+                "calibration curve of pixel time-of-arrival to TDC units;pixel ToA [ns];pixel ToA [TDC]",
+                nbins,
+                0,
+                time_maximum,
+                adcbins,
+                0,
+                adcbins);
         } else {
-            h_px_tdc = new TH1D("pixel_tdc", "final pixel time-of-arrival;pixel ToA [ns];pixels", nbins, 0, time_maximum);
+            h_px_tdc = std::make_unique<ThreadedHistogram<TH1D>>(
+                "pixel_tdc", "final pixel time-of-arrival;pixel ToA [ns];pixels", nbins, 0, time_maximum);
         }
     }
 }
 
 void DefaultDigitizerModule::run(unsigned int) {
+    // Fetch the pixel charges of the current event
+    auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this);
+
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
+
+    auto hits = MessageDataPool<PixelHit>::acquire();
+    if(batched_noise_) {
+        digitize_batched(pixel_message->getData(), hits);
+    } else {
+        digitize_sequential(pixel_message->getData(), random_generator, hits);
+    }
+
+    if(noise_occupancy_ > 0) {
+        add_noise_hits(pixel_message->getData(), hits);
+    }
+
+    // Output summary and update statistics
+    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
+    total_hits_ += hits.size();
+
+    if(!hits.empty()) {
+        // Create and dispatch hit message
+        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
+        messenger_->dispatchMessage(this, hits_message);
+    }
+
+    // Digitize the pixel charges once more for every point of the sweep, with random numbers shared between the points
+    if(!sweep_points_.empty()) {
+        thread_local std::vector<double> sweep_gaussians;
+        auto random_stream = getRandomStream(2);
+        sweep_gaussians.resize(5 * pixel_message->getData().size());
+        fill_normal(random_stream, sweep_gaussians);
+
+        for(const auto& point : sweep_points_) {
+            auto sweep_hits = MessageDataPool<PixelHit>::acquire();
+            digitize_sweep(pixel_message->getData(), point, sweep_gaussians, sweep_hits);
+            LOG(DEBUG) << "Digitized " << sweep_hits.size() << " pixel hits for sweep point " << point.name;
+            if(!sweep_hits.empty()) {
+                auto sweep_message = std::make_shared<PixelHitMessage>(std::move(sweep_hits), getDetector());
+                messenger_->dispatchMessage(this, sweep_message, point.name);
+            }
+        }
+    }
+}
+
+void DefaultDigitizerModule::digitize_sequential(const std::vector<PixelCharge>& pixel_charges,
+                                                 std::mt19937_64& random_generator,
+                                                 std::vector<PixelHit>& hits) {
     // Loop through all pixels with charges
-    std::vector<PixelHit> hits;
-    for(auto& pixel_charge : pixel_message_->getData()) {
+    for(auto& pixel_charge : pixel_charges) {
         auto pixel = pixel_charge.getPixel();
         auto pixel_index = pixel.getIndex();
         auto charge = static_cast<double>(pixel_charge.getCharge());
 
         LOG(DEBUG) << "Received pixel " << pixel_index << ", charge " << Units::display(charge, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq->Fill(charge / 1e3);
+        if(output_plots_) {
+            h_pxq->fill(charge / 1e3);
         }
 
         // Add electronics noise from Gaussian:
-        std::normal_distribution<double> el_noise(0, config_.get<unsigned int>("electronics_noise"));
-        charge += el_noise(random_generator_);
+        std::normal_distribution<double> el_noise(0, electronics_noise_);
+        charge += el_noise(random_generator);
 
         LOG(DEBUG) << "Charge with noise: " << Units::display(charge, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq_noise->Fill(charge / 1e3);
+        if(output_plots_) {
+            h_pxq_noise->fill(charge / 1e3);
         }
 
         // Smear the gain factor, Gaussian distribution around "gain" with width "gain_smearing"
-        std::normal_distribution<double> gain_smearing(config_.get<double>("gain"), config_.get<double>("gain_smearing"));
-        double gain = gain_smearing(random_generator_);
-        if(config_.get<bool>("output_plots")) {
-            h_gain->Fill(gain);
+        std::normal_distribution<double> gain_smearing(gain_, gain_smearing_);
+        double gain = gain_smearing(random_generator);
+        if(output_plots_) {
+            h_gain->fill(gain);
         }
 
         // Apply the gain to the charge:
         charge *= gain;
         LOG(DEBUG) << "Charge after amplifier (gain): " << Units::display(charge, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq_gain->Fill(charge / 1e3);
+        if(output_plots_) {
+            h_pxq_gain->fill(charge / 1e3);
         }
 
         // Smear the threshold, Gaussian distribution around "threshold" with width "threshold_smearing"
-        std::normal_distribution<double> thr_smearing(config_.get<unsigned int>("threshold"),
-                                                      config_.get<unsigned int>("threshold_smearing"));
-        double threshold = thr_smearing(random_generator_);
-        if(config_.get<bool>("output_plots")) {
-            h_thr->Fill(threshold / 1e3);
+        std::normal_distribution<double> thr_smearing(threshold_, threshold_smearing_);
+        double threshold = thr_smearing(random_generator);
+        if(output_plots_) {
+            h_thr->fill(threshold / 1e3);
         }
 
         // Discard charges below threshold:
@@ -198,85 +381,273 @@ void DefaultDigitizerModule::run(unsigned int) {
             continue;
         }
 
-        LOG(DEBUG) << "Passed threshold: " << Units::display(charge, "e") << " > " << Units::display(threshold, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq_thr->Fill(charge / 1e3);
+        // Draw the QDC and TDC smearing in the order of the processing stages
+        double qdc_noise = 0;
+        if(qdc_resolution_ > 0) {
+            std::normal_distribution<double> adc_smearing(0, qdc_smearing_);
+            qdc_noise = adc_smearing(random_generator);
         }
+        double tdc_noise = 0;
+        if(tdc_resolution_ > 0) {
+            std::normal_distribution<double> tdc_smearing(0, tdc_smearing_);
+            tdc_noise = tdc_smearing(random_generator);
+        }
+        digitize_pixel(pixel_charge, charge, threshold, qdc_noise, tdc_noise, hits);
+    }
+}
 
-        // Simulate QDC if resolution set to more than 0bit
-        if(config_.get<int>("qdc_resolution") > 0) {
-            // temporarily store old charge for histogramming:
-            auto original_charge = charge;
-
-            // Add ADC smearing:
-            std::normal_distribution<double> adc_smearing(0, config_.get<unsigned int>("qdc_smearing"));
-            charge += adc_smearing(random_generator_);
-            if(config_.get<bool>("output_plots")) {
-                h_pxq_adc_smear->Fill(charge / 1e3);
-            }
-            LOG(DEBUG) << "Smeared for simulating limited QDC sensitivity: " << Units::display(charge, "e");
+/**
+ * The noise, gain and threshold smearing of all pixels is drawn from the first random stream of the event, the QDC and TDC
+ * smearing of the pixels above threshold from the second. The results are therefore reproducible, but differ from the
+ * sequential processing of the pixels with the random generator of the module.
+ */
+void DefaultDigitizerModule::digitize_batched(const std::vector<PixelCharge>& pixel_charges, std::vector<PixelHit>& hits) {
+    auto pixels = pixel_charges.size();
+
+    // Work buffers in structure-of-arrays layout, kept for the next event on the same thread
+    thread_local std::vector<double> charges, thresholds, gaussians;
+    thread_local std::vector<size_t> selected;
+
+    // Draw the noise, gain and threshold for all pixels at once
+    auto random_stream = getRandomStream(0);
+    gaussians.resize(3 * pixels);
+    fill_normal(random_stream, gaussians);
+
+    charges.resize(pixels);
+    thresholds.resize(pixels);
+    auto* noise = gaussians.data();
+    auto* gain = noise + pixels;
+    auto* threshold = gain + pixels;
+    for(size_t i = 0; i < pixels; ++i) {
+        gain[i] = gain_ + gain_smearing_ * gain[i];
+        charges[i] = (static_cast<double>(pixel_charges[i].getCharge()) + electronics_noise_ * noise[i]) * gain[i];
+        thresholds[i] = threshold_ + threshold_smearing_ * threshold[i];
+    }
 
-            // Convert to ADC units and precision, make sure ADC count is at least 1:
-            charge = static_cast<double>(std::max(
-                std::min(static_cast<int>((config_.get<double>("qdc_offset") + charge) / config_.get<double>("qdc_slope")),
-                         (1 << config_.get<int>("qdc_resolution")) - 1),
-                (config_.get<bool>("allow_zero_qdc") ? 0 : 1)));
-            LOG(DEBUG) << "Charge converted to QDC units: " << charge;
-
-            if(config_.get<bool>("output_plots")) {
-                h_calibration->Fill(original_charge / 1e3, charge);
-                h_pxq_adc->Fill(charge);
-            }
-        } else if(config_.get<bool>("output_plots")) {
-            h_pxq_adc->Fill(charge / 1e3);
+    // Select the pixels above threshold without branching in the loop
+    selected.resize(pixels);
+    size_t above_threshold = 0;
+    for(size_t i = 0; i < pixels; ++i) {
+        selected[above_threshold] = i;
+        above_threshold += static_cast<size_t>(charges[i] >= thresholds[i]);
+    }
+    selected.resize(above_threshold);
+    LOG(DEBUG) << above_threshold << " of " << pixels << " pixels passed the smeared threshold";
+
+    if(output_plots_) {
+        for(size_t i = 0; i < pixels; ++i) {
+            auto raw_charge = static_cast<double>(pixel_charges[i].getCharge());
+            h_pxq->fill(raw_charge / 1e3);
+            h_pxq_noise->fill((raw_charge + electronics_noise_ * noise[i]) / 1e3);
+            h_gain->fill(gain[i]);
+            h_pxq_gain->fill(charges[i] / 1e3);
+            h_thr->fill(thresholds[i] / 1e3);
         }
+    }
 
-        auto time = time_of_arrival(pixel_charge, threshold);
-        LOG(DEBUG) << "Time of arrival: " << Units::display(time, {"ns", "ps"});
-        if(config_.get<bool>("output_plots")) {
-            h_px_toa->Fill(time);
+    // Draw the QDC and TDC smearing only for the pixels above threshold
+    random_stream = getRandomStream(1);
+    gaussians.resize(2 * above_threshold);
+    fill_normal(random_stream, gaussians);
+    auto* qdc_noise = gaussians.data();
+    auto* tdc_noise = qdc_noise + above_threshold;
+
+    for(size_t j = 0; j < above_threshold; ++j) {
+        auto i = selected[j];
+        digitize_pixel(
+            pixel_charges[i], charges[i], thresholds[i], qdc_smearing_ * qdc_noise[j], tdc_smearing_ * tdc_noise[j], hits);
+    }
+}
+
+/**
+ * The smearing of the QDC and TDC is drawn by the caller, such that the pixels digitized sequentially and in batches only
+ * differ by the random numbers used.
+ */
+void DefaultDigitizerModule::digitize_pixel(const PixelCharge& pixel_charge,
+                                            double charge,
+                                            double threshold,
+                                            double qdc_noise,
+                                            double tdc_noise,
+                                            std::vector<PixelHit>& hits) {
+    LOG(DEBUG) << "Passed threshold: " << Units::display(charge, "e") << " > " << Units::display(threshold, "e");
+    if(output_plots_) {
+        h_pxq_thr->fill(charge / 1e3);
+    }
+
+    // Simulate QDC if resolution set to more than 0bit
+    if(qdc_resolution_ > 0) {
+        // temporarily store old charge for histogramming:
+        auto original_charge = charge;
+
+        // Add ADC smearing:
+        charge += qdc_noise;
+        if(output_plots_) {
+            h_pxq_adc_smear->fill(charge / 1e3);
         }
+        LOG(DEBUG) << "Smeared for simulating limited QDC sensitivity: " << Units::display(charge, "e");
 
-        // Simulate TDC if resolution set to more than 0bit
-        if(config_.get<int>("tdc_resolution") > 0) {
-            // temporarily store full arrival time for histogramming:
-            auto original_time = time;
-
-            // Add TDC smearing:
-            std::normal_distribution<double> tdc_smearing(0, config_.get<unsigned int>("tdc_smearing"));
-            time += tdc_smearing(random_generator_);
-            if(config_.get<bool>("output_plots")) {
-                h_px_tdc_smear->Fill(time);
+        // Convert to ADC units and precision, make sure ADC count is at least 1:
+        charge = static_cast<double>(
+            std::max(std::min(static_cast<int>((qdc_offset_ + charge) / qdc_slope_), (1 << qdc_resolution_) - 1),
+                     (allow_zero_qdc_ ? 0 : 1)));
+        LOG(DEBUG) << "Charge converted to QDC units: " << charge;
+
+        if(output_plots_) {
+            h_calibration->fill(original_charge / 1e3, charge);
+            h_pxq_adc->fill(charge);
+        }
+    } else if(output_plots_) {
+        h_pxq_adc->fill(charge / 1e3);
+    }
+
+    auto time = time_of_arrival(pixel_charge, threshold);
+    LOG(DEBUG) << "Time of arrival: " << Units::display(time, {"ns", "ps"});
+    if(output_plots_) {
+        h_px_toa->fill(time);
+    }
+
+    // Simulate TDC if resolution set to more than 0bit
+    if(tdc_resolution_ > 0) {
+        // temporarily store full arrival time for histogramming:
+        auto original_time = time;
+
+        // Add TDC smearing:
+        time += tdc_noise;
+        if(output_plots_) {
+            h_px_tdc_smear->fill(time);
+        }
+        LOG(DEBUG) << "Smeared for simulating limited TDC sensitivity: " << Units::display(time, {"ns", "ps"});
+
+        // Convert to TDC units and precision, make sure TDC count is at least 1:
+        time = static_cast<double>(
+            std::max(std::min(static_cast<int>((tdc_offset_ + time) / tdc_slope_), (1 << tdc_resolution_) - 1),
+                     (allow_zero_tdc_ ? 0 : 1)));
+        LOG(DEBUG) << "Time converted to TDC units: " << time;
+
+        if(output_plots_) {
+            h_toa_calibration->fill(original_time, time);
+            h_px_tdc->fill(time);
+        }
+    } else if(output_plots_) {
+        h_px_tdc->fill(time);
+    }
+
+    // Add the hit to the hitmap
+    hits.emplace_back(pixel_charge.getPixel(), time, charge, &pixel_charge);
+}
+
+/**
+ * Pixels with charge are skipped, as the electronics noise has already been simulated for them. The charge of a noise hit is
+ * drawn from the tail of the Gaussian noise above the smeared threshold, approximated by an exponential distribution with a
+ * decay length of the squared noise divided by the threshold. Noise hits carry no time information and no reference to a
+ * pixel charge. All random numbers are taken from the fourth random stream of the event.
+ */
+void DefaultDigitizerModule::add_noise_hits(const std::vector<PixelCharge>& pixel_charges, std::vector<PixelHit>& hits) {
+    auto npixels = getDetector()->getModel()->getNPixels();
+    auto columns = static_cast<unsigned long long>(npixels.x());
+    auto total_pixels = columns * static_cast<unsigned long long>(npixels.y());
+
+    // Flat indices of the pixels with charge, sorted to be skipped while walking along the matrix
+    thread_local std::vector<unsigned long long> charged;
+    charged.clear();
+    for(const auto& pixel_charge : pixel_charges) {
+        auto index = pixel_charge.getPixel().getIndex();
+        charged.push_back(static_cast<unsigned long long>(index.y()) * columns + static_cast<unsigned long long>(index.x()));
+    }
+    std::sort(charged.begin(), charged.end());
+
+    auto random_stream = getRandomStream(3);
+    auto uniform = [&random_stream]() { return (static_cast<double>(random_stream() >> 11u) + 1.0) * 0x1.0p-53; };
+
+    unsigned long long noise_hits = 0;
+    auto next_charged = charged.begin();
+    // Offset of the next pixel to test, the skip distance is the number of pixels not firing before the next noise hit
+    unsigned long long index = 0;
+    while(true) {
+        auto skip = std::floor(std::log(uniform()) / log_noise_complement_);
+        if(skip >= static_cast<double>(total_pixels - index)) {
+            break;
+        }
+        index += static_cast<unsigned long long>(skip);
+
+        next_charged = std::lower_bound(next_charged, charged.end(), index);
+        if(next_charged == charged.end() || *next_charged != index) {
+            auto threshold = threshold_ + threshold_smearing_ * draw_normal(uniform);
+            auto charge = std::max(threshold, 0.0) +
+                          (threshold > 0 ? electronics_noise_ * electronics_noise_ / threshold : 0.0) * -std::log(uniform());
+            charge *= gain_;
+
+            // Simulate QDC if resolution set to more than 0bit
+            if(qdc_resolution_ > 0) {
+                charge += qdc_smearing_ * draw_normal(uniform);
+                charge = static_cast<double>(
+                    std::max(std::min(static_cast<int>((qdc_offset_ + charge) / qdc_slope_), (1 << qdc_resolution_) - 1),
+                             (allow_zero_qdc_ ? 0 : 1)));
             }
-            LOG(DEBUG) << "Smeared for simulating limited TDC sensitivity: " << Units::display(time, {"ns", "ps"});
 
-            // Convert to TDC units and precision, make sure TDC count is at least 1:
-            time = static_cast<double>(std::max(
-                std::min(static_cast<int>((config_.get<double>("tdc_offset") + time) / config_.get<double>("tdc_slope")),
-                         (1 << config_.get<int>("tdc_resolution")) - 1),
-                (config_.get<bool>("allow_zero_tdc") ? 0 : 1)));
-            LOG(DEBUG) << "Time converted to TDC units: " << time;
-
-            if(config_.get<bool>("output_plots")) {
-                h_toa_calibration->Fill(original_time, time);
-                h_px_tdc->Fill(time);
+            // Noise hits carry no time information
+            double time = 0;
+            if(tdc_resolution_ > 0) {
+                time = static_cast<double>(
+                    std::max(std::min(static_cast<int>(tdc_offset_ / tdc_slope_), (1 << tdc_resolution_) - 1),
+                             (allow_zero_tdc_ ? 0 : 1)));
             }
-        } else if(config_.get<bool>("output_plots")) {
-            h_px_tdc->Fill(time);
-        }
 
-        // Add the hit to the hitmap
-        hits.emplace_back(pixel, time, charge, &pixel_charge);
+            auto x = static_cast<unsigned int>(index % columns);
+            auto y = static_cast<unsigned int>(index / columns);
+            LOG(DEBUG) << "Adding noise hit on pixel (" << x << "," << y << ") with charge " << charge;
+            hits.emplace_back(getDetector()->getPixel(x, y), time, charge);
+            ++noise_hits;
+        }
+        ++index;
     }
 
-    // Output summary and update statistics
-    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
-    total_hits_ += hits.size();
+    LOG(DEBUG) << "Added " << noise_hits << " noise hits";
+    total_noise_hits_ += noise_hits;
+}
 
-    if(!hits.empty()) {
-        // Create and dispatch hit message
-        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
-        messenger_->dispatchMessage(this, hits_message);
+/**
+ * The sweep points are digitized without filling the output plots, which only describe the nominal configuration of the
+ * module. The random numbers are taken from the third random stream of the event.
+ */
+void DefaultDigitizerModule::digitize_sweep(const std::vector<PixelCharge>& pixel_charges,
+                                            const SweepPoint& point,
+                                            const std::vector<double>& gaussians,
+                                            std::vector<PixelHit>& hits) {
+    auto pixels = pixel_charges.size();
+    const auto* noise = gaussians.data();
+    const auto* gain_noise = noise + pixels;
+    const auto* threshold_noise = gain_noise + pixels;
+    const auto* qdc_noise = threshold_noise + pixels;
+    const auto* tdc_noise = qdc_noise + pixels;
+
+    for(size_t i = 0; i < pixels; ++i) {
+        const auto& pixel_charge = pixel_charges[i];
+        auto gain = point.gain + gain_smearing_ * gain_noise[i];
+        auto charge = (static_cast<double>(pixel_charge.getCharge()) + electronics_noise_ * noise[i]) * gain;
+        auto threshold = point.threshold + threshold_smearing_ * threshold_noise[i];
+        if(charge < threshold) {
+            continue;
+        }
+
+        // Simulate QDC if resolution set to more than 0bit
+        if(qdc_resolution_ > 0) {
+            charge += qdc_smearing_ * qdc_noise[i];
+            charge = static_cast<double>(std::max(
+                std::min(static_cast<int>((point.qdc_offset + charge) / point.qdc_slope), (1 << qdc_resolution_) - 1),
+                (allow_zero_qdc_ ? 0 : 1)));
+        }
+
+        // Simulate TDC if resolution set to more than 0bit
+        auto time = time_of_arrival(pixel_charge, threshold);
+        if(tdc_resolution_ > 0) {
+            time += tdc_smearing_ * tdc_noise[i];
+            time = static_cast<double>(std::max(
+                std::min(static_cast<int>((point.tdc_offset + time) / point.tdc_slope), (1 << tdc_resolution_) - 1),
+                (allow_zero_tdc_ ? 0 : 1)));
+        }
+
+        hits.emplace_back(pixel_charge.getPixel(), time, charge, &pixel_charge);
     }
 }
 
@@ -285,16 +656,21 @@ double DefaultDigitizerModule::time_of_arrival(const PixelCharge& pixel_charge,
     // If this PixelCharge has a pulse, we can find out when it crossed the threshold:
     const auto& pulse = pixel_charge.getPulse();
     if(pulse.isInitialized()) {
-        auto charges = pulse.getPulse();
-        std::vector<double>::iterator bin;
+        // The empty bins before the stored window of the pulse only cross a threshold of zero or below
         double integrated_charge = 0;
-        for(bin = charges.begin(); bin != charges.end(); bin++) {
+        if(pulse.getOffset() > 0 && integrated_charge >= threshold) {
+            return 0;
+        }
+        const auto& charges = pulse.getWindow();
+        auto bin = charges.begin();
+        for(; bin != charges.end(); bin++) {
             integrated_charge += *bin;
             if(integrated_charge >= threshold) {
                 break;
             }
         }
-        return pulse.getBinning() * static_cast<double>(std::distance(charges.begin(), bin));
+        return pulse.getBinning() *
+               static_cast<double>(pulse.getOffset() + static_cast<size_t>(std::distance(charges.begin(), bin)));
     } else {
         LOG_ONCE(WARNING) << "Simulation chain does not allow for time-of-arrival calculation";
         return 0;
@@ -307,27 +683,30 @@ void DefaultDigitizerModule::finalize() {
         LOG(TRACE) << "Writing output plots to file";
 
         // Charge plots
-        h_pxq->Write();
-        h_pxq_noise->Write();
-        h_gain->Write();
-        h_pxq_gain->Write();
-        h_thr->Write();
-        h_pxq_thr->Write();
-
-        h_pxq_adc->Write();
+        h_pxq->merge()->Write();
+        h_pxq_noise->merge()->Write();
+        h_gain->merge()->Write();
+        h_pxq_gain->merge()->Write();
+        h_thr->merge()->Write();
+        h_pxq_thr->merge()->Write();
+
+        h_pxq_adc->merge()->Write();
         if(config_.get<int>("qdc_resolution") > 0) {
-            h_pxq_adc_smear->Write();
-            h_calibration->Write();
+            h_pxq_adc_smear->merge()->Write();
+            h_calibration->merge()->Write();
         }
 
         // Time plots
-        h_px_toa->Write();
+        h_px_toa->merge()->Write();
         if(config_.get<int>("tdc_resolution") > 0) {
-            h_px_tdc_smear->Write();
-            h_toa_calibration->Write();
+            h_px_tdc_smear->merge()->Write();
+            h_toa_calibration->merge()->Write();
         }
-        h_px_tdc->Write();
+        h_px_tdc->merge()->Write();
     }
 
     LOG(INFO) << "Digitized " << total_hits_ << " pixel hits in total";
+    if(noise_occupancy_ > 0) {
+        LOG(INFO) << "Added " << total_noise_hits_ << " noise hits in total";
+    }
 }
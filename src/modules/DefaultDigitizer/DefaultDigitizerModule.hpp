@@ -10,15 +10,20 @@
 #ifndef ALLPIX_DEFAULT_DIGITIZER_MODULE_H
 #define ALLPIX_DEFAULT_DIGITIZER_MODULE_H
 
+#include <atomic>
 #include <memory>
 #include <random>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
 
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+
+#include "tools/threaded_histogram.h"
 
 #include <TH1D.h>
 #include <TH2D.h>
@@ -63,7 +68,7 @@ namespace allpix {
 
         Messenger* messenger_;
 
-        // Input message with the charges on the pixels
+        // Input message with the charges on the pixels, only used to register the message (fetched in the run method)
         std::shared_ptr<PixelChargeMessage> pixel_message_;
 
         /**
@@ -74,13 +79,105 @@ namespace allpix {
          */
         double time_of_arrival(const PixelCharge& pixel_charge, double threshold) const;
 
+        /**
+         * @brief Digitize the pixels of the event one after the other with the random numbers drawn for every pixel
+         * @param pixel_charges Charges on the pixels of the event
+         * @param random_generator Random generator to draw the smearing of every processing stage from
+         * @param hits Vector to add the pixel hits to
+         */
+        void digitize_sequential(const std::vector<PixelCharge>& pixel_charges,
+                                 std::mt19937_64& random_generator,
+                                 std::vector<PixelHit>& hits);
+
+        /**
+         * @brief Digitize all pixels of the event with the random numbers drawn in batches
+         * @param pixel_charges Charges on the pixels of the event
+         * @param hits Vector to add the pixel hits to
+         *
+         * All Gaussian random numbers of a processing stage are drawn at once from the random streams of the event, and the
+         * threshold is applied to all pixels before the QDC and TDC are only simulated for the pixels above threshold.
+         */
+        void digitize_batched(const std::vector<PixelCharge>& pixel_charges, std::vector<PixelHit>& hits);
+
+        /**
+         * @brief Simulate the QDC and TDC of a pixel above threshold and add its hit
+         * @param pixel_charge Charge on the pixel
+         * @param charge Charge of the pixel after noise and gain
+         * @param threshold Smeared threshold of the pixel
+         * @param qdc_noise Smearing of the charge, only used if the QDC is simulated
+         * @param tdc_noise Smearing of the time, only used if the TDC is simulated
+         * @param hits Vector to add the pixel hit to
+         */
+        void digitize_pixel(const PixelCharge& pixel_charge,
+                            double charge,
+                            double threshold,
+                            double qdc_noise,
+                            double tdc_noise,
+                            std::vector<PixelHit>& hits);
+
+        /**
+         * @brief Add hits of pixels firing from noise alone to the pixel hits of the event
+         * @param pixel_charges Charges on the pixels of the event, these pixels do not fire from noise alone
+         * @param hits Vector to add the noise hits to
+         *
+         * Only the pixels firing are sampled by drawing the distance to the next noise hit along the flat pixel index from a
+         * geometric distribution, such that the cost is proportional to the number of noise hits and not to the number of
+         * pixels of the matrix.
+         */
+        void add_noise_hits(const std::vector<PixelCharge>& pixel_charges, std::vector<PixelHit>& hits);
+
+        /**
+         * @brief Parameters of the digitization which can be varied in a sweep, and the name of its output message
+         */
+        struct SweepPoint {
+            std::string name;
+            double gain;
+            double threshold;
+            double qdc_offset;
+            double qdc_slope;
+            double tdc_offset;
+            double tdc_slope;
+        };
+
+        /**
+         * @brief Digitize all pixels of the event for one point of the parameter sweep
+         * @param pixel_charges Charges on the pixels of the event
+         * @param point Parameters of the sweep point
+         * @param gaussians Standard normal random numbers for the noise, gain, threshold, QDC and TDC smearing of all pixels
+         * @param hits Vector to add the pixel hits to
+         *
+         * The same random numbers are used for all points of the sweep, such that the points only differ by the swept
+         * parameter and not by statistical fluctuations of the noise.
+         */
+        void digitize_sweep(const std::vector<PixelCharge>& pixel_charges,
+                            const SweepPoint& point,
+                            const std::vector<double>& gaussians,
+                            std::vector<PixelHit>& hits);
+
+        // Points of the optional parameter sweep
+        std::vector<SweepPoint> sweep_points_;
+
+        // Parameters of the digitization bound to the configuration
+        bool output_plots_{};
+        unsigned int electronics_noise_{}, threshold_{}, threshold_smearing_{}, qdc_smearing_{}, tdc_smearing_{};
+        double gain_{}, gain_smearing_{}, qdc_offset_{}, qdc_slope_{}, tdc_offset_{}, tdc_slope_{};
+        int qdc_resolution_{}, tdc_resolution_{};
+        bool allow_zero_qdc_{}, allow_zero_tdc_{};
+        bool batched_noise_{};
+        double noise_occupancy_{};
+
+        // Logarithm of the probability of a pixel not to fire from noise, precalculated for the geometric sampling
+        double log_noise_complement_{};
+
         // Statistics
-        unsigned long long total_hits_{};
+        std::atomic<unsigned long long> total_hits_{};
+        std::atomic<unsigned long long> total_noise_hits_{};
 
         // Output histograms
-        TH1D *h_pxq{}, *h_pxq_noise{}, *h_gain{}, *h_pxq_gain{}, *h_thr{}, *h_pxq_thr{}, *h_pxq_adc_smear{}, *h_pxq_adc{};
-        TH1D *h_px_toa{}, *h_px_tdc_smear{}, *h_px_tdc{};
-        TH2D *h_calibration{}, *h_toa_calibration;
+        std::unique_ptr<ThreadedHistogram<TH1D>> h_pxq, h_pxq_noise, h_gain, h_pxq_gain, h_thr, h_pxq_thr, h_pxq_adc_smear,
+            h_pxq_adc;
+        std::unique_ptr<ThreadedHistogram<TH1D>> h_px_toa, h_px_tdc_smear, h_px_tdc;
+        std::unique_ptr<ThreadedHistogram<TH2D>> h_calibration, h_toa_calibration;
     };
 } // namespace allpix
 
@@ -0,0 +1,45 @@
+/**
+ * @file
+ * @brief Implements the construction of the user actions of the Geant4 worker threads
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ActionInitializationG4.hpp"
+
+#include <utility>
+
+#include "EventActionG4.hpp"
+#include "GeneratorActionG4.hpp"
+#include "SetTrackInfoUserHookG4.hpp"
+
+using namespace allpix;
+
+ActionInitializationG4::ActionInitializationG4(const Configuration& config,
+                                               EventMergerG4* merger,
+                                               SensorBuilder sensor_builder,
+                                               TrackInfoManager::TruthLevel truth_level,
+                                               StackingActionG4::Policy* stacking_policy)
+    : config_(config), merger_(merger), sensor_builder_(std::move(sensor_builder)), truth_level_(truth_level),
+      stacking_policy_(stacking_policy) {}
+
+/**
+ * Called by Geant4 on every worker thread. The user actions are owned by the worker, the track managers by this class.
+ */
+void ActionInitializationG4::Build() const {
+    TrackInfoManager* track_info_manager = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        track_info_managers_.push_back(std::make_unique<TrackInfoManager>(truth_level_));
+        track_info_manager = track_info_managers_.back().get();
+    }
+
+    SetUserAction(new GeneratorActionG4(config_));
+    SetUserAction(new SetTrackInfoUserHookG4(track_info_manager));
+    SetUserAction(new EventActionG4(merger_, track_info_manager, sensor_builder_(track_info_manager)));
+    if(stacking_policy_ != nullptr) {
+        SetUserAction(new StackingActionG4(stacking_policy_));
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * @file
+ * @brief Defines the construction of the user actions of the Geant4 worker threads
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_ACTION_INITIALIZATION_H
+#define ALLPIX_SIMPLE_DEPOSITION_MODULE_ACTION_INITIALIZATION_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <G4VUserActionInitialization.hh>
+
+#include "core/config/Configuration.hpp"
+
+#include "EventMergerG4.hpp"
+#include "SensitiveDetectorActionG4.hpp"
+#include "StackingActionG4.hpp"
+#include "TrackInfoManager.hpp"
+
+namespace allpix {
+    /**
+     * @brief Constructs the particle source, the track information hook and the event action of every worker thread
+     */
+    class ActionInitializationG4 : public G4VUserActionInitialization {
+    public:
+        /**
+         * @brief Function constructing the sensitive detector actions of a worker on the calling thread
+         */
+        using SensorBuilder = std::function<std::vector<SensitiveDetectorActionG4*>(TrackInfoManager*)>;
+
+        /**
+         * @brief Construct the action initialization
+         * @param config Configuration of the \ref DepositionGeant4Module module
+         * @param merger Merger of the results of all workers
+         * @param sensor_builder Function constructing the sensitive detector actions of a worker
+         * @param truth_level Level of Monte-Carlo truth information recorded by the track managers of the workers
+         * @param stacking_policy Policy for killing secondaries far from the sensors, no tracks are killed if null
+         */
+        ActionInitializationG4(const Configuration& config,
+                               EventMergerG4* merger,
+                               SensorBuilder sensor_builder,
+                               TrackInfoManager::TruthLevel truth_level,
+                               StackingActionG4::Policy* stacking_policy = nullptr);
+
+        /**
+         * @brief Construct the user actions for a worker thread
+         */
+        void Build() const override;
+
+    private:
+        const Configuration& config_;
+        EventMergerG4* merger_;
+        SensorBuilder sensor_builder_;
+        TrackInfoManager::TruthLevel truth_level_;
+        StackingActionG4::Policy* stacking_policy_;
+
+        // Track managers of all workers, which are built concurrently
+        mutable std::mutex mutex_;
+        mutable std::vector<std::unique_ptr<TrackInfoManager>> track_info_managers_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_SIMPLE_DEPOSITION_MODULE_ACTION_INITIALIZATION_H */
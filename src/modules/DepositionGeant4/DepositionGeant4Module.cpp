@@ -10,19 +10,35 @@
 
 #include "DepositionGeant4Module.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
 #include <limits>
+#include <random>
+#include <sstream>
 #include <string>
 #include <utility>
 
 #include <G4EmParameters.hh>
 #include <G4HadronicProcessStore.hh>
 #include <G4LogicalVolume.hh>
+#include <G4Material.hh>
 #include <G4PhysListFactory.hh>
+#include <G4ProductionCuts.hh>
 #include <G4RadioactiveDecayPhysics.hh>
+#include <G4RegionStore.hh>
 #include <G4RunManager.hh>
+#ifdef G4MULTITHREADED
+#include <G4MTRunManager.hh>
+#endif
 #include <G4StepLimiterPhysics.hh>
 #include <G4UImanager.hh>
 #include <G4UserLimits.hh>
+#include <G4Version.hh>
+#include <Randomize.hh>
 
 #include "G4FieldManager.hh"
 #include "G4TransportationManager.hh"
@@ -31,14 +47,19 @@
 #include "core/config/exceptions.h"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/module/exceptions.h"
+#include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+#include "objects/MCTrack.hpp"
 #include "tools/ROOT.h"
 #include "tools/geant4.h"
 
+#include "ActionInitializationG4.hpp"
 #include "GeneratorActionG4.hpp"
 #include "SensitiveDetectorActionG4.hpp"
 #include "SetTrackInfoUserHookG4.hpp"
+#include "StackingActionG4.hpp"
 
 #define G4_NUM_SEEDS 10
 
@@ -59,6 +80,7 @@ DepositionGeant4Module::DepositionGeant4Module(Configuration& config, Messenger*
     config_.setDefault<double>("max_step_length", Units::get(1.0, "um"));
     // Default value chosen to ensure proper gamma generation for Cs137 decay
     config_.setDefault<double>("cutoff_time", 2.21e+11);
+    config_.bind("veto_empty_events", veto_empty_events_, false);
 
     // Set alias for support of old particle source definition
     config_.setAlias("source_position", "beam_position");
@@ -111,20 +133,28 @@ void DepositionGeant4Module::init() {
     // Get UI manager for sending commands
     G4UImanager* ui_g4 = G4UImanager::GetUIpointer();
 
+    // Get the region of the sensor of a detector, which is created the first time it is requested
+    auto get_sensor_region = [this](const std::shared_ptr<Detector>& detector) {
+        auto name = detector->getName() + "_sensor_region";
+        auto* region = G4RegionStore::GetInstance()->GetRegion(name, false);
+        if(region == nullptr) {
+            auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
+            if(logical_volume == nullptr) {
+                throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
+            }
+            region = new G4Region(name);
+            region->AddRootLogicalVolume(logical_volume.get());
+        }
+        return region;
+    };
+
     // Apply optional PAI model
     if(config_.get<bool>("enable_pai", false)) {
         LOG(TRACE) << "Enabling PAI model on all detectors";
         G4EmParameters::Instance();
 
         for(auto& detector : geo_manager_->getDetectors()) {
-            // Get logical volume
-            auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
-            if(logical_volume == nullptr) {
-                throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
-            }
-            // Create region
-            G4Region* region = new G4Region(detector->getName() + "_sensor_region");
-            region->AddRootLogicalVolume(logical_volume.get());
+            auto* region = get_sensor_region(detector);
 
             auto pai_model = config_.get<std::string>("pai_model", "pai");
             auto lcase_model = pai_model;
@@ -199,34 +229,122 @@ void DepositionGeant4Module::init() {
     }
     ui_g4->ApplyCommand("/run/setCut " + std::to_string(production_cut));
 
+    // Use a separate production cut in the sensors, such that the cut elsewhere can be coarse
+    if(config_.has("sensor_range_cut")) {
+        auto sensor_cut = config_.get<double>("sensor_range_cut");
+        if(sensor_cut <= 0) {
+            throw InvalidValueError(config_, "sensor_range_cut", "production cut has to be positive");
+        }
+        LOG(INFO) << "Setting G4 production cut in the sensors to " << Units::display(sensor_cut, {"mm", "um"});
+        for(auto& detector : geo_manager_->getDetectors()) {
+            auto* cuts = new G4ProductionCuts();
+            cuts->SetProductionCut(sensor_cut);
+            get_sensor_region(detector)->SetProductionCuts(cuts);
+        }
+    }
+
+    // Kill low-energy secondaries created far from all sensors, which never reach any of them
+    if(config_.has("kill_distance")) {
+        stacking_policy_ = std::make_unique<StackingActionG4::Policy>();
+        stacking_policy_->kill_distance = config_.get<double>("kill_distance");
+        stacking_policy_->kill_energy = config_.get<double>("kill_energy", Units::get(1.0, "MeV"));
+        if(stacking_policy_->kill_distance < 0) {
+            throw InvalidValueError(config_, "kill_distance", "distance cannot be negative");
+        }
+        for(auto& detector : geo_manager_->getDetectors()) {
+            auto model = detector->getModel();
+            auto center = detector->getGlobalPosition(model->getSensorCenter());
+            stacking_policy_->sensor_centers.emplace_back(center.x(), center.y(), center.z());
+            stacking_policy_->sensor_radii.push_back(std::sqrt(model->getSensorSize().Mag2()) / 2);
+        }
+        LOG(INFO) << "Killing secondaries below " << Units::display(stacking_policy_->kill_energy, {"keV", "MeV"})
+                  << " created further than " << Units::display(stacking_policy_->kill_distance, {"mm", "cm"})
+                  << " from all sensors";
+    }
+
+    // Retrieve the physics tables from the cache if they have been stored for the same setup before, otherwise store them
+    if(config_.has("physics_table_cache")) {
+        // The tables depend on the Geant4 version, the physics list, the production cuts and the materials of the geometry
+        std::stringstream setup;
+        setup << G4VERSION_NUMBER << ";" << config_.get<std::string>("physics_list") << ";" << production_cut << ";"
+              << config_.get<double>("sensor_range_cut", 0) << ";" << config_.get<bool>("enable_pai", false) << ";"
+              << config_.get<std::string>("pai_model", "pai");
+        for(const auto* material : *G4Material::GetMaterialTable()) {
+            setup << ";" << material->GetName() << ":" << material->GetDensity();
+        }
+
+        // Use a stable FNV-1a hash of the setup as name of the cache entry
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for(auto character : setup.str()) {
+            hash = (hash ^ static_cast<unsigned char>(character)) * 0x100000001b3ULL;
+        }
+        std::stringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << hash;
+        physics_table_directory_ = config_.getPath("physics_table_cache") + "/" + key.str();
+
+        if(allpix::path_is_directory(physics_table_directory_)) {
+            LOG(INFO) << "Retrieving G4 physics tables from " << physics_table_directory_;
+            physicsList->SetPhysicsTableRetrieved(physics_table_directory_);
+        } else {
+            LOG(INFO) << "Storing G4 physics tables in " << physics_table_directory_ << " at the end of the run";
+            physics_list_ = physicsList;
+        }
+    }
+
     // Set user limits on world volume:
     auto world_log_volume = geo_manager_->getExternalObject<G4LogicalVolume>("", "world_log");
     if(world_log_volume != nullptr) {
         world_log_volume->SetUserLimits(user_limits_world_.get());
     }
 
-    // Initialize the physics list
-    LOG(TRACE) << "Initializing physics processes";
-    run_manager_g4_->SetUserInitialization(physicsList);
-    run_manager_g4_->InitializePhysics();
+    // Get the creation energy for charge (default is silicon electron hole pair energy)
+    auto charge_creation_energy = config_.get<double>("charge_creation_energy", Units::get(3.64, "eV"));
+    auto fano_factor = config_.get<double>("fano_factor", 0.115);
 
-    // Initialize the full run manager to ensure correct state flags
-    run_manager_g4_->Initialize();
+    // Get the length within which consecutive steps of a track are merged into a single deposit
+    auto deposit_merge_length = config_.get<double>("deposit_merge_length", 0);
+    if(deposit_merge_length < 0) {
+        throw InvalidValueError(config_, "deposit_merge_length", "merge length cannot be negative");
+    } else if(deposit_merge_length > 0) {
+        LOG(DEBUG) << "Merging energy deposits of consecutive steps of a track within "
+                   << Units::display(deposit_merge_length, {"um", "mm"});
+    }
+
+    // Find the detectors to deposit charges in
+    std::vector<std::shared_ptr<Detector>> sensitive_detectors;
+    for(auto& detector : geo_manager_->getDetectors()) {
+        // Do not add sensitive detector for detectors that have no listeners for the deposited charges or the particles
+        if(!messenger_->hasReceiver<DepositedChargeMessage>(this, detector) &&
+           !messenger_->hasReceiver<MCParticleMessage>(this, detector)) {
+            LOG(INFO) << "Not depositing charges in " << detector->getName()
+                      << " because there is no listener for its output";
+            continue;
+        }
 
-    // Build particle generator
-    LOG(TRACE) << "Constructing particle source";
-    auto generator = new GeneratorActionG4(config_);
-    run_manager_g4_->SetUserAction(generator);
+        auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
+        if(logical_volume == nullptr) {
+            throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
+        }
+        sensitive_detectors.push_back(detector);
+    }
 
-    track_info_manager_ = std::make_unique<TrackInfoManager>();
+    if(sensitive_detectors.empty()) {
+        LOG(ERROR) << "Not a single listener for deposited charges, module is useless!";
+    }
 
-    // User hook to store additional information at track initialization and termination as well as custom track ids
-    auto userTrackIDHook = new SetTrackInfoUserHookG4(track_info_manager_.get());
-    run_manager_g4_->SetUserAction(userTrackIDHook);
+    // Only create the Monte-Carlo tracks if they are received by any module
+    create_tracks_ = messenger_->hasReceiver<MCTrackMessage>(this, nullptr);
+    if(!create_tracks_) {
+        LOG(INFO) << "Not creating Monte-Carlo tracks because there is no listener for them";
+    }
 
-    if(geo_manager_->hasMagneticField()) {
-        MagneticFieldType magnetic_field_type_ = geo_manager_->getMagneticFieldType();
+    // Set the magnetic field of the calling thread
+    auto set_magnetic_field = [this]() {
+        if(!geo_manager_->hasMagneticField()) {
+            return;
+        }
 
+        MagneticFieldType magnetic_field_type_ = geo_manager_->getMagneticFieldType();
         if(magnetic_field_type_ == MagneticFieldType::CONSTANT) {
             ROOT::Math::XYZVector b_field = geo_manager_->getMagneticField(ROOT::Math::XYZPoint(0., 0., 0.));
             G4MagneticField* magField = new G4UniformMagField(G4ThreeVector(b_field.x(), b_field.y(), b_field.z()));
@@ -236,11 +354,96 @@ void DepositionGeant4Module::init() {
         } else {
             throw ModuleError("Magnetic field enabled, but not constant. This can't be handled by this module yet.");
         }
+    };
+
+    // Initialize the physics list
+    LOG(TRACE) << "Initializing physics processes";
+    run_manager_g4_->SetUserInitialization(physicsList);
+    run_manager_g4_->InitializePhysics();
+
+    // Get the level of Monte-Carlo truth information to record for the tracks
+    auto truth_level_name = config_.get<std::string>("truth_level", "sensors");
+    std::transform(truth_level_name.begin(), truth_level_name.end(), truth_level_name.begin(), ::tolower);
+    TrackInfoManager::TruthLevel truth_level{};
+    if(truth_level_name == "none") {
+        truth_level = TrackInfoManager::TruthLevel::NONE;
+    } else if(truth_level_name == "primaries") {
+        truth_level = TrackInfoManager::TruthLevel::PRIMARIES;
+    } else if(truth_level_name == "sensors") {
+        truth_level = TrackInfoManager::TruthLevel::SENSORS;
+    } else if(truth_level_name == "full") {
+        truth_level = TrackInfoManager::TruthLevel::FULL;
+    } else {
+        throw InvalidValueError(config_, "truth_level", "truth level should be 'none', 'primaries', 'sensors' or 'full'");
     }
+    LOG(DEBUG) << "Recording Monte-Carlo truth information at level " << truth_level_name;
+    track_info_manager_ = std::make_unique<TrackInfoManager>(truth_level);
+
+    // The actions of the worker threads have to be known before initializing a multithreaded run manager
+#ifdef G4MULTITHREADED
+    if(dynamic_cast<G4MTRunManager*>(run_manager_g4_) != nullptr) {
+        // The weights of the primaries generated on the workers are not collected
+        if(config_.has("bias_beam_size") || config_.has("bias_beam_offset") || config_.has("bias_energy_spread")) {
+            throw InvalidCombinationError(config_,
+                                          {"bias_beam_size", "bias_energy_spread"},
+                                          "biased sampling is not supported with Geant4 worker threads");
+        }
+        LOG(DEBUG) << "Using Geant4 worker threads, merging their results in the order of the Geant4 events";
+        event_merger_ = std::make_unique<EventMergerG4>(track_info_manager_.get(), sensors_);
+
+        // Construct the sensitive detector actions on every worker, which are bound to the thread constructing them
+        auto sensor_builder = [this,
+                               sensitive_detectors,
+                               charge_creation_energy,
+                               fano_factor,
+                               deposit_merge_length,
+                               set_magnetic_field](TrackInfoManager* track_info_manager) {
+            std::vector<SensitiveDetectorActionG4*> sensors;
+            for(auto& detector : sensitive_detectors) {
+                auto sensitive_detector_action = new SensitiveDetectorActionG4(this,
+                                                                               detector,
+                                                                               messenger_,
+                                                                               track_info_manager,
+                                                                               charge_creation_energy,
+                                                                               fano_factor,
+                                                                               deposit_merge_length,
+                                                                               0);
+                auto logical_volume =
+                    geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
+                logical_volume->SetSensitiveDetector(sensitive_detector_action);
+                sensors.push_back(sensitive_detector_action);
+            }
+            set_magnetic_field();
+            return sensors;
+        };
+        run_manager_g4_->SetUserInitialization(
+            new ActionInitializationG4(
+                config_, event_merger_.get(), std::move(sensor_builder), truth_level, stacking_policy_.get()));
+    }
+#endif
 
-    // Get the creation energy for charge (default is silicon electron hole pair energy)
-    auto charge_creation_energy = config_.get<double>("charge_creation_energy", Units::get(3.64, "eV"));
-    auto fano_factor = config_.get<double>("fano_factor", 0.115);
+    // Initialize the full run manager to ensure correct state flags
+    run_manager_g4_->Initialize();
+
+    if(event_merger_ == nullptr) {
+        // Build particle generator
+        LOG(TRACE) << "Constructing particle source";
+        auto generator = new GeneratorActionG4(config_);
+        run_manager_g4_->SetUserAction(generator);
+        if(generator->isBiased()) {
+            biased_generator_ = generator;
+        }
+
+        // User hook to store additional information at track initialization and termination as well as custom track ids
+        auto userTrackIDHook = new SetTrackInfoUserHookG4(track_info_manager_.get());
+        run_manager_g4_->SetUserAction(userTrackIDHook);
+
+        if(stacking_policy_ != nullptr) {
+            run_manager_g4_->SetUserAction(new StackingActionG4(stacking_policy_.get()));
+        }
+    }
+
+    set_magnetic_field();
 
     // Prepare seeds for Geant4:
     // NOTE Assumes this is the only Geant4 module using random numbers
@@ -253,25 +456,17 @@ void DepositionGeant4Module::init() {
     }
 
     // Loop through all detectors and set the sensitive detector action that handles the particle passage
-    bool useful_deposition = false;
-    for(auto& detector : geo_manager_->getDetectors()) {
-        // Do not add sensitive detector for detectors that have no listeners for the deposited charges
-        // FIXME Probably the MCParticle has to be checked as well
-        if(!messenger_->hasReceiver(this,
-                                    std::make_shared<DepositedChargeMessage>(std::vector<DepositedCharge>(), detector))) {
-            LOG(INFO) << "Not depositing charges in " << detector->getName()
-                      << " because there is no listener for its output";
-            continue;
-        }
-        useful_deposition = true;
-
+    for(auto& detector : sensitive_detectors) {
         // Get model of the sensitive device
-        auto sensitive_detector_action = new SensitiveDetectorActionG4(
-            this, detector, messenger_, track_info_manager_.get(), charge_creation_energy, fano_factor, getRandomSeed());
+        auto sensitive_detector_action = new SensitiveDetectorActionG4(this,
+                                                                       detector,
+                                                                       messenger_,
+                                                                       track_info_manager_.get(),
+                                                                       charge_creation_energy,
+                                                                       fano_factor,
+                                                                       deposit_merge_length,
+                                                                       getRandomSeed());
         auto logical_volume = geo_manager_->getExternalObject<G4LogicalVolume>(detector->getName(), "sensor_log");
-        if(logical_volume == nullptr) {
-            throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
-        }
 
         // Apply the user limits to this element
         logical_volume->SetUserLimits(user_limits_.get());
@@ -295,10 +490,6 @@ void DepositionGeant4Module::init() {
         }
     }
 
-    if(!useful_deposition) {
-        LOG(ERROR) << "Not a single listener for deposited charges, module is useless!";
-    }
-
     // Disable verbose messages from processes
     ui_g4->ApplyCommand("/process/verbose 0");
     ui_g4->ApplyCommand("/process/em/verbose 0");
@@ -308,6 +499,13 @@ void DepositionGeant4Module::init() {
     // Set the random seed for Geant4 generation
     ui_g4->ApplyCommand(seed_command);
 
+    // Simulate all events in a single Geant4 run to avoid the overhead of starting and terminating a run for every event
+    single_run_ = config_.get<bool>("single_geant4_run", false);
+    if(single_run_ && event_merger_ != nullptr) {
+        LOG(WARNING) << "Events cannot be simulated in a single run with Geant4 worker threads, starting a run per event";
+        single_run_ = false;
+    }
+
     // Release the output stream
     RELEASE_STREAM(G4cout);
 }
@@ -319,21 +517,67 @@ void DepositionGeant4Module::run(unsigned int event_num) {
         SUPPRESS_STREAM(G4cout);
     }
 
+    // Seed Geant4 and the charge fluctuations from the event seed, such that the event does not depend on the ones before
+    uint64_t merger_seed = 0;
+    if(has_event_seeding()) {
+        std::mt19937_64 event_seeder(getEventSeed());
+        std::array<long, G4_NUM_SEEDS + 1> seeds{};
+        for(int i = 0; i < G4_NUM_SEEDS; ++i) {
+            seeds[static_cast<size_t>(i)] = static_cast<long>(event_seeder() % INT_MAX);
+        }
+        G4Random::setTheSeeds(seeds.data());
+        for(auto* sensor : sensors_) {
+            sensor->seed(event_seeder());
+        }
+        merger_seed = event_seeder();
+    }
+
     // Start a single event from the beam
     LOG(TRACE) << "Enabling beam";
-    run_manager_g4_->BeamOn(static_cast<int>(config_.get<unsigned int>("number_of_particles", 1)));
+    if(event_merger_ != nullptr) {
+        event_merger_->reset(has_event_seeding() ? merger_seed : getRandomSeed());
+    }
+    if(biased_generator_ != nullptr) {
+        biased_generator_->resetWeight();
+    }
+    auto number_of_particles = static_cast<int>(config_.get<unsigned int>("number_of_particles", 1));
+    auto start = std::chrono::steady_clock::now();
+    if(single_run_) {
+        // Start the run with the first event, the event loop of every following event continues the same run
+        if(!run_started_) {
+            LOG(DEBUG) << "Starting single Geant4 run for all events";
+            if(!run_manager_g4_->ConfirmBeamOnCondition()) {
+                throw ModuleError("Cannot start the Geant4 run");
+            }
+            run_manager_g4_->RunInitialization();
+            run_started_ = true;
+        }
+        run_manager_g4_->DoEventLoop(number_of_particles);
+    } else {
+        run_manager_g4_->BeamOn(number_of_particles);
+    }
+    geant4_time_ += static_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
     last_event_num_ = event_num;
 
+    // Weight the event with the ratio of the unbiased and biased probabilities of its primary particles
+    if(biased_generator_ != nullptr) {
+        LOG(DEBUG) << "Weight of biased primary particles is " << biased_generator_->getWeight();
+        scaleEventWeight(biased_generator_->getWeight());
+    }
+
     // Release the stream (if it was suspended)
     RELEASE_STREAM(G4cout);
 
-    track_info_manager_->createMCTracks();
-
-    // Dispatch the necessary messages
-    track_info_manager_->dispatchMessage(this, messenger_);
+    // Dispatch the necessary messages, the particles are not linked to any track if the tracks are not created
+    if(create_tracks_) {
+        track_info_manager_->createMCTracks();
+        track_info_manager_->dispatchMessage(this, messenger_);
+    }
 
+    unsigned int deposited_charge = 0;
     for(auto& sensor : sensors_) {
         sensor->dispatchMessages();
+        deposited_charge += sensor->getDepositedCharge();
 
         // Fill output plots if requested:
         if(config_.get<bool>("output_plots")) {
@@ -343,13 +587,50 @@ void DepositionGeant4Module::run(unsigned int event_num) {
     }
 
     track_info_manager_->resetTrackInfoManager();
+
+    // Skip the remaining modules if no charge has been deposited in any sensor
+    if(deposited_charge == 0 && veto_empty_events_) {
+        LOG(DEBUG) << "No charge deposited in any sensor, vetoing event";
+        vetoEvent();
+    }
 }
 
 void DepositionGeant4Module::finalize() {
+    // Terminate the Geant4 run spanning all events
+    if(run_started_) {
+        SUPPRESS_STREAM(G4cout);
+        run_manager_g4_->RunTermination();
+        RELEASE_STREAM(G4cout);
+        run_started_ = false;
+    }
+
+    // Store the physics tables built for the first event in the cache, they are written to a temporary directory first
+    // such that concurrent jobs with the same setup never retrieve incomplete tables
+    if(physics_list_ != nullptr && last_event_num_ > 0) {
+        auto temporary_directory = physics_table_directory_ + ".tmp" + std::to_string(getpid());
+        try {
+            allpix::create_directories(temporary_directory);
+            SUPPRESS_STREAM(G4cout);
+            auto stored = physics_list_->StorePhysicsTable(temporary_directory);
+            RELEASE_STREAM(G4cout);
+            if(!stored || std::rename(temporary_directory.c_str(), physics_table_directory_.c_str()) != 0) {
+                LOG(WARNING) << "Could not store G4 physics tables in " << physics_table_directory_;
+                allpix::remove_path(temporary_directory);
+            } else {
+                LOG(INFO) << "Stored G4 physics tables in " << physics_table_directory_;
+            }
+        } catch(std::invalid_argument& e) {
+            LOG(WARNING) << "Could not store G4 physics tables: " << e.what();
+        }
+    }
+
     size_t total_charges = 0;
     for(auto& sensor : sensors_) {
         total_charges += sensor->getTotalDepositedCharge();
+        LOG(DEBUG) << "Created at most " << sensor->getMaxDepositsPerEvent() << " deposits from "
+                   << sensor->getMaxTracksPerEvent() << " tracks in a single event in " << sensor->getName();
     }
+    LOG(DEBUG) << "Created at most " << track_info_manager_->getMaxTracksPerEvent() << " tracks in a single event";
 
     if(config_.get<bool>("output_plots")) {
         // Write histograms
@@ -359,6 +640,18 @@ void DepositionGeant4Module::finalize() {
         }
     }
 
+    // Report the time spent in Geant4 and the tracks killed far from the sensors, to compare runs with different policies
+    if(last_event_num_ > 0) {
+        LOG(INFO) << "Spent " << Units::display(Units::get(geant4_time_ / last_event_num_, "s"), {"us", "ms", "s"})
+                  << " per event simulating the particles in Geant4";
+    }
+    if(stacking_policy_ != nullptr && stacking_policy_->secondary_tracks > 0) {
+        LOG(INFO) << "Killed " << stacking_policy_->killed_tracks << " of " << stacking_policy_->secondary_tracks
+                  << " secondary tracks (" << (100.0 * static_cast<double>(stacking_policy_->killed_tracks) /
+                                               static_cast<double>(stacking_policy_->secondary_tracks))
+                  << "%) created far from all sensors";
+    }
+
     // Print summary or warns if module did not output any charges
     if(!sensors_.empty() && total_charges > 0 && last_event_num_ > 0) {
         size_t average_charge = total_charges / sensors_.size() / last_event_num_;
@@ -18,15 +18,20 @@
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
 
+#include "EventMergerG4.hpp"
 #include "SensitiveDetectorActionG4.hpp"
+#include "StackingActionG4.hpp"
 #include "TrackInfoManager.hpp"
 
 #include <TH1D.h>
 
 class G4UserLimits;
 class G4RunManager;
+class G4VModularPhysicsList;
 
 namespace allpix {
+    class GeneratorActionG4;
+
     /**
      * @ingroup Modules
      * @brief Module to simulate the particle beam and generating the charge deposits in the sensor
@@ -67,20 +72,43 @@ namespace allpix {
 
         // The track manager which this module uses to assign custom track IDs and manage & create MCTracks
         std::unique_ptr<TrackInfoManager> track_info_manager_;
+        // Flag if the tracks are created, only if there is any listener for them
+        bool create_tracks_{true};
 
         // Handling of the charge deposition in all the sensitive devices
         std::vector<SensitiveDetectorActionG4*> sensors_;
 
+        // Merger of the results of the Geant4 worker threads (only used with a multithreaded run manager)
+        std::unique_ptr<EventMergerG4> event_merger_;
+
+        // Particle generator sampling from biased distributions, owned by the run manager (only set if biased)
+        GeneratorActionG4* biased_generator_{nullptr};
+
         // Number of the last event
         unsigned int last_event_num_;
 
+        // Flag if all events are simulated in a single Geant4 run, and if this run has been started
+        bool single_run_{false};
+        bool run_started_{false};
+
+        // Flag if events without any charge deposited in the sensors are vetoed
+        bool veto_empty_events_{false};
+
         // Class holding the limits for the step size
         std::unique_ptr<G4UserLimits> user_limits_;
         std::unique_ptr<G4UserLimits> user_limits_world_;
 
+        // Policy for killing secondaries far from the sensors (only used if configured), and time spent in Geant4 in seconds
+        std::unique_ptr<StackingActionG4::Policy> stacking_policy_;
+        double geant4_time_{};
+
         // Pointer to the Geant4 manager (owned by GeometryBuilderGeant4)
         G4RunManager* run_manager_g4_;
 
+        // Cache entry of the physics tables, and the physics list (owned by the run manager) if the tables are stored
+        std::string physics_table_directory_;
+        G4VModularPhysicsList* physics_list_{};
+
         // Vector of histogram pointers for debugging plots
         std::map<std::string, TH1D*> charge_per_event_;
     };
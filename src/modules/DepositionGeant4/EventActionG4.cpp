@@ -0,0 +1,27 @@
+/**
+ * @file
+ * @brief Implements the event action of the Geant4 worker threads
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "EventActionG4.hpp"
+
+#include <utility>
+
+using namespace allpix;
+
+EventActionG4::EventActionG4(EventMergerG4* merger,
+                             TrackInfoManager* track_info_manager,
+                             std::vector<SensitiveDetectorActionG4*> sensors)
+    : merger_(merger), track_info_manager_(track_info_manager), sensors_(std::move(sensors)) {}
+
+void EventActionG4::BeginOfEventAction(const G4Event* event) {
+    merger_->seed(event->GetEventID(), sensors_);
+}
+
+void EventActionG4::EndOfEventAction(const G4Event* event) {
+    merger_->merge(event->GetEventID(), *track_info_manager_, sensors_);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file
+ * @brief Defines the event action of the Geant4 worker threads
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_EVENT_ACTION_H
+#define ALLPIX_SIMPLE_DEPOSITION_MODULE_EVENT_ACTION_H
+
+#include <vector>
+
+#include <G4Event.hh>
+#include <G4UserEventAction.hh>
+
+#include "EventMergerG4.hpp"
+#include "SensitiveDetectorActionG4.hpp"
+#include "TrackInfoManager.hpp"
+
+namespace allpix {
+    /**
+     * @brief Hands over the results of every Geant4 event processed by a worker thread to the \ref EventMergerG4
+     */
+    class EventActionG4 : public G4UserEventAction {
+    public:
+        /**
+         * @brief Construct the event action of a worker
+         * @param merger Merger of the results of all workers
+         * @param track_info_manager Track manager of the worker
+         * @param sensors Sensitive detector actions of the worker, in the order of the detectors
+         */
+        EventActionG4(EventMergerG4* merger,
+                      TrackInfoManager* track_info_manager,
+                      std::vector<SensitiveDetectorActionG4*> sensors);
+
+        /**
+         * @brief Seed the sensitive detector actions for the event
+         * @param event Geant4 event
+         */
+        void BeginOfEventAction(const G4Event* event) override;
+
+        /**
+         * @brief Merge the deposits and tracks of the event
+         * @param event Geant4 event
+         */
+        void EndOfEventAction(const G4Event* event) override;
+
+    private:
+        EventMergerG4* merger_;
+        TrackInfoManager* track_info_manager_;
+        std::vector<SensitiveDetectorActionG4*> sensors_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_SIMPLE_DEPOSITION_MODULE_EVENT_ACTION_H */
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * @brief Implements the merging of the results of Geant4 worker threads
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "EventMergerG4.hpp"
+
+#include "core/utils/prng.h"
+
+using namespace allpix;
+
+EventMergerG4::EventMergerG4(TrackInfoManager* track_info_manager, const std::vector<SensitiveDetectorActionG4*>& sensors)
+    : track_info_manager_(track_info_manager), sensors_(sensors) {}
+
+void EventMergerG4::reset(uint64_t random_seed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_event_ = 0;
+    random_seed_ = random_seed;
+}
+
+/**
+ * Every Geant4 event uses its own random stream, from which the seeds of all sensitive detector actions are drawn
+ */
+void EventMergerG4::seed(int event_id, const std::vector<SensitiveDetectorActionG4*>& sensors) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PhiloxRandomEngine random_engine(random_seed_, static_cast<uint64_t>(event_id));
+    for(auto& sensor : sensors) {
+        sensor->seed(random_engine());
+    }
+}
+
+/**
+ * Geant4 hands out the events to the workers in the order of their ids, such that all events with a lower id are either
+ * merged already or processed by another worker at this point.
+ */
+void EventMergerG4::merge(int event_id,
+                          TrackInfoManager& track_info_manager,
+                          const std::vector<SensitiveDetectorActionG4*>& sensors) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [&]() { return next_event_ == event_id; });
+
+    auto track_id_offset = track_info_manager.moveTracksTo(*track_info_manager_);
+    for(size_t i = 0; i < sensors.size(); ++i) {
+        sensors[i]->moveDepositsTo(*sensors_[i], track_id_offset);
+    }
+
+    ++next_event_;
+    condition_.notify_all();
+}
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @brief Defines the merging of the results of Geant4 worker threads
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_EVENT_MERGER_H
+#define ALLPIX_SIMPLE_DEPOSITION_MODULE_EVENT_MERGER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "SensitiveDetectorActionG4.hpp"
+#include "TrackInfoManager.hpp"
+
+namespace allpix {
+    /**
+     * @brief Merges the deposits and tracks of the Geant4 events processed by worker threads
+     *
+     * Worker threads hand over the results of every Geant4 event in the order of the event ids, such that the merged
+     * deposits, particles and tracks do not depend on the distribution of the events over the threads. The random numbers
+     * of the sensitive detector actions are seeded for every Geant4 event for the same reason.
+     */
+    class EventMergerG4 {
+    public:
+        /**
+         * @brief Construct the merger
+         * @param track_info_manager Track manager receiving the tracks of all workers
+         * @param sensors Sensitive detector actions receiving the deposits of all workers, in the order of the detectors
+         */
+        EventMergerG4(TrackInfoManager* track_info_manager, const std::vector<SensitiveDetectorActionG4*>& sensors);
+
+        /**
+         * @brief Prepare for a new run of Geant4 events
+         * @param random_seed Seed to derive the seeds of the Geant4 events from
+         */
+        void reset(uint64_t random_seed);
+
+        /**
+         * @brief Seed the sensitive detector actions of a worker for a Geant4 event
+         * @param event_id Id of the Geant4 event in the current run
+         * @param sensors Sensitive detector actions of the worker, in the order of the detectors
+         */
+        void seed(int event_id, const std::vector<SensitiveDetectorActionG4*>& sensors) const;
+
+        /**
+         * @brief Merge the results of a Geant4 event processed by a worker
+         * @param event_id Id of the Geant4 event in the current run
+         * @param track_info_manager Track manager of the worker
+         * @param sensors Sensitive detector actions of the worker, in the order of the detectors
+         *
+         * Blocks until the results of all events with a lower id are merged.
+         */
+        void merge(int event_id,
+                   TrackInfoManager& track_info_manager,
+                   const std::vector<SensitiveDetectorActionG4*>& sensors);
+
+    private:
+        TrackInfoManager* track_info_manager_;
+        const std::vector<SensitiveDetectorActionG4*>& sensors_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+        int next_event_{};
+        uint64_t random_seed_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_SIMPLE_DEPOSITION_MODULE_EVENT_MERGER_H */
@@ -10,6 +10,7 @@
 
 #include "GeneratorActionG4.hpp"
 
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <regex>
@@ -20,16 +21,17 @@
 #include <G4ParticleTable.hh>
 #include <G4RunManager.hh>
 #include <G4UImanager.hh>
+#include <Randomize.hh>
 #include <core/module/exceptions.h>
 
 #include "core/config/exceptions.h"
 #include "core/utils/log.h"
+#include "core/utils/unit.h"
 #include "tools/geant4.h"
 
 using namespace allpix;
 
-GeneratorActionG4::GeneratorActionG4(const Configuration& config)
-    : particle_source_(std::make_unique<G4GeneralParticleSource>()) {
+GeneratorActionG4::GeneratorActionG4(const Configuration& config) {
 
     // Define radioactive isotopes:
     static std::map<std::string, std::tuple<int, int, int, double>> isotopes = {
@@ -40,12 +42,22 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
         {"cs137", std::make_tuple(55, 137, 0, 0.)},
     };
 
-    // Set verbosity of source to off
-    particle_source_->SetVerbosity(0);
-
     // Get source specific parameters
     auto source_type = config.get<std::string>("source_type");
 
+    // Use the particle gun for all predefined shapes which do not require features of the general particle source
+    auto use_particle_gun = config.get<bool>("use_particle_gun", false) &&
+                            (source_type == "beam" || source_type == "point" || source_type == "square");
+    if(use_particle_gun) {
+        LOG(DEBUG) << "Using particle gun for " << source_type << " source";
+        particle_gun_ = std::make_unique<G4ParticleGun>(1);
+    } else {
+        particle_source_ = std::make_unique<G4GeneralParticleSource>();
+
+        // Set verbosity of source to off
+        particle_source_->SetVerbosity(0);
+    }
+
     if(source_type == "macro") {
         LOG(INFO) << "Using user macro for particle source.";
 
@@ -73,20 +85,16 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
     } else {
 
         // Get the source and set the centre coordinate of the source
-        auto single_source = particle_source_->GetCurrentSource();
-        single_source->GetPosDist()->SetCentreCoords(config.get<G4ThreeVector>("source_position"));
+        G4SingleParticleSource* single_source = nullptr;
+        source_position_ = config.get<G4ThreeVector>("source_position");
+        if(!use_particle_gun) {
+            single_source = particle_source_->GetCurrentSource();
+            single_source->GetPosDist()->SetCentreCoords(source_position_);
+        }
 
         // Set position and direction parameters according to shape
         if(source_type == "beam") {
 
-            // Set position parameters
-            single_source->GetPosDist()->SetPosDisType("Beam");
-            single_source->GetPosDist()->SetBeamSigmaInR(config.get<double>("beam_size", 0));
-
-            // Set angle distribution parameters
-            // NOTE beam2d will always fire in the -z direction of the system
-            single_source->GetAngDist()->SetAngDistType("beam2d");
-
             // Align the -z axis of the system with the direction vector
             auto direction = config.get<G4ThreeVector>("beam_direction");
             if(fabs(direction.mag() - 1.0) > std::numeric_limits<double>::epsilon()) {
@@ -102,12 +110,28 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
                 angref1 = direction.cross({0, 0, 1});
             }
             G4ThreeVector angref2 = angref1.cross(direction);
-
-            single_source->GetAngDist()->DefineAngRefAxes("angref1", angref1);
-            single_source->GetAngDist()->DefineAngRefAxes("angref2", angref2);
             auto divergence = config.get<G4TwoVector>("beam_divergence", G4TwoVector(0., 0.));
-            single_source->GetAngDist()->SetBeamSigmaInAngX(divergence.x());
-            single_source->GetAngDist()->SetBeamSigmaInAngY(divergence.y());
+
+            if(use_particle_gun) {
+                gun_shape_ = GunShape::BEAM;
+                beam_size_ = config.get<double>("beam_size", 0);
+                beam_direction_ = direction.unit();
+                angref1_ = angref1.unit();
+                angref2_ = angref2.unit();
+                beam_divergence_ = divergence;
+            } else {
+                // Set position parameters
+                single_source->GetPosDist()->SetPosDisType("Beam");
+                single_source->GetPosDist()->SetBeamSigmaInR(config.get<double>("beam_size", 0));
+
+                // Set angle distribution parameters
+                // NOTE beam2d will always fire in the -z direction of the system
+                single_source->GetAngDist()->SetAngDistType("beam2d");
+                single_source->GetAngDist()->DefineAngRefAxes("angref1", angref1);
+                single_source->GetAngDist()->DefineAngRefAxes("angref2", angref2);
+                single_source->GetAngDist()->SetBeamSigmaInAngX(divergence.x());
+                single_source->GetAngDist()->SetBeamSigmaInAngY(divergence.y());
+            }
 
         } else if(source_type == "sphere") {
 
@@ -127,23 +151,34 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
 
         } else if(source_type == "square") {
 
-            // Set position parameters
-            single_source->GetPosDist()->SetPosDisType("Plane");
-            single_source->GetPosDist()->SetPosDisShape("Square");
-            single_source->GetPosDist()->SetHalfX(config.get<double>("square_side") / 2);
-            single_source->GetPosDist()->SetHalfY(config.get<double>("square_side") / 2);
-
-            // Set angle distribution parameters
-            single_source->GetAngDist()->SetAngDistType("iso");
-            single_source->GetAngDist()->SetMaxTheta(config.get<double>("square_angle", ROOT::Math::Pi()) / 2);
+            if(use_particle_gun) {
+                gun_shape_ = GunShape::SQUARE;
+                square_half_side_ = config.get<double>("square_side") / 2;
+                cos_max_theta_ = std::cos(config.get<double>("square_angle", ROOT::Math::Pi()) / 2);
+            } else {
+                // Set position parameters
+                single_source->GetPosDist()->SetPosDisType("Plane");
+                single_source->GetPosDist()->SetPosDisShape("Square");
+                single_source->GetPosDist()->SetHalfX(config.get<double>("square_side") / 2);
+                single_source->GetPosDist()->SetHalfY(config.get<double>("square_side") / 2);
+
+                // Set angle distribution parameters
+                single_source->GetAngDist()->SetAngDistType("iso");
+                single_source->GetAngDist()->SetMaxTheta(config.get<double>("square_angle", ROOT::Math::Pi()) / 2);
+            }
 
         } else if(source_type == "point") {
 
-            // Set position parameters
-            single_source->GetPosDist()->SetPosDisType("Point");
+            if(use_particle_gun) {
+                gun_shape_ = GunShape::POINT;
+                cos_max_theta_ = -1.;
+            } else {
+                // Set position parameters
+                single_source->GetPosDist()->SetPosDisType("Point");
 
-            // Set angle distribution parameters
-            single_source->GetAngDist()->SetAngDistType("iso");
+                // Set angle distribution parameters
+                single_source->GetAngDist()->SetAngDistType("iso");
+            }
 
         } else {
 
@@ -156,6 +191,8 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
         std::transform(particle_type.begin(), particle_type.end(), particle_type.begin(), ::tolower);
         auto particle_code = config.get<int>("particle_code", 0);
         G4ParticleDefinition* particle = nullptr;
+        // Charge of ions, set before the particle definition
+        auto particle_charge = std::numeric_limits<double>::quiet_NaN();
 
         if(!particle_type.empty() && particle_code != 0) {
             if(pdg_table->FindParticle(particle_type) == pdg_table->FindParticle(particle_code)) {
@@ -183,7 +220,7 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
             // Force the radioactive isotope to decay immediately:
             particle->SetPDGLifeTime(0.);
 
-            single_source->SetParticleCharge(std::get<2>(isotope));
+            particle_charge = std::get<2>(isotope);
 
             // Warn about non-zero source energy:
             if(config.get<double>("source_energy") > 0) {
@@ -198,7 +235,7 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
                ion.ready()) {
                 particle = G4IonTable::GetIonTable()->GetIon(
                     allpix::from_string<int>(ion[1]), allpix::from_string<int>(ion[2]), allpix::from_string<double>(ion[4]));
-                single_source->SetParticleCharge(allpix::from_string<int>(ion[3]));
+                particle_charge = allpix::from_string<int>(ion[3]);
             } else {
                 throw InvalidValueError(config, "particle_type", "cannot parse parameters for ion.");
             }
@@ -211,22 +248,142 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
 
         LOG(DEBUG) << "Using particle " << particle->GetParticleName() << " (ID " << particle->GetPDGEncoding() << ").";
 
-        // Set global parameters of the source
-        single_source->SetNumberOfParticles(1);
-        single_source->SetParticleDefinition(particle);
-        // Set the primary track's start time in for the current event to zero:
-        single_source->SetParticleTime(0.0);
+        source_energy_ = config.get<double>("source_energy");
+        source_energy_spread_ = config.get<double>("source_energy_spread", 0.);
+
+        // Importance sampling of the beam profile and the energy, only available for the lightweight particle gun
+        if(config.has("bias_beam_size") || config.has("bias_beam_offset") || config.has("bias_energy_spread")) {
+            if(!use_particle_gun) {
+                throw InvalidCombinationError(config,
+                                              {"use_particle_gun", "bias_beam_size", "bias_energy_spread"},
+                                              "biased sampling requires the particle gun");
+            }
+        }
+        if(config.has("bias_beam_size") || config.has("bias_beam_offset")) {
+            if(gun_shape_ != GunShape::BEAM || beam_size_ <= 0) {
+                throw InvalidCombinationError(config,
+                                              {"source_type", "beam_size", "bias_beam_size"},
+                                              "biased beam requires a beam with a finite size");
+            }
+            biased_beam_ = true;
+            bias_beam_size_ = config.get<double>("bias_beam_size", beam_size_);
+            bias_beam_offset_ = config.get<G4TwoVector>("bias_beam_offset", G4TwoVector(0., 0.));
+            if(bias_beam_size_ <= 0) {
+                throw InvalidValueError(config, "bias_beam_size", "biased beam size has to be positive");
+            }
+            LOG(INFO) << "Sampling beam profile with biased size " << Units::display(bias_beam_size_, {"um", "mm"})
+                      << " around offset " << Units::display(bias_beam_offset_.x(), {"um", "mm"}) << ","
+                      << Units::display(bias_beam_offset_.y(), {"um", "mm"});
+        }
+        if(config.has("bias_energy_spread")) {
+            bias_energy_spread_ = config.get<double>("bias_energy_spread");
+            if(source_energy_spread_ <= 0 || bias_energy_spread_ <= 0) {
+                throw InvalidCombinationError(config,
+                                              {"source_energy_spread", "bias_energy_spread"},
+                                              "biased energy requires a positive energy spread and biased spread");
+            }
+            biased_energy_ = true;
+            LOG(INFO) << "Sampling energy with biased spread "
+                      << Units::display(bias_energy_spread_, {"keV", "MeV", "GeV"});
+        }
+
+        if(use_particle_gun) {
+            // Set global parameters of the particle gun, the energy is sampled for every particle
+            particle_gun_->SetParticleDefinition(particle);
+            if(!std::isnan(particle_charge)) {
+                particle_gun_->SetParticleCharge(particle_charge);
+            }
+            particle_gun_->SetParticleTime(0.0);
+        } else {
+            if(!std::isnan(particle_charge)) {
+                single_source->SetParticleCharge(particle_charge);
+            }
+
+            // Set global parameters of the source
+            single_source->SetNumberOfParticles(1);
+            single_source->SetParticleDefinition(particle);
+            // Set the primary track's start time in for the current event to zero:
+            single_source->SetParticleTime(0.0);
 
-        // Set energy parameters
-        single_source->GetEneDist()->SetEnergyDisType("Gauss");
-        single_source->GetEneDist()->SetMonoEnergy(config.get<double>("source_energy"));
-        single_source->GetEneDist()->SetBeamSigmaInE(config.get<double>("source_energy_spread", 0.));
+            // Set energy parameters
+            single_source->GetEneDist()->SetEnergyDisType("Gauss");
+            single_source->GetEneDist()->SetMonoEnergy(source_energy_);
+            single_source->GetEneDist()->SetBeamSigmaInE(source_energy_spread_);
+        }
     }
 }
 
+/**
+ * The distributions follow the ones of the general particle source: the beam profile is Gaussian in the global x-y plane and
+ * the angles to the beam direction are Gaussian, while the point and square sources emit isotropically into the cone given
+ * by the maximum angle around the negative z-axis.
+ */
+void GeneratorActionG4::sample_particle_gun() {
+    G4ThreeVector position = source_position_;
+    G4ThreeVector direction;
+
+    // Ratio of the unbiased and the biased Gaussian probability density of a sampled value
+    auto density_ratio = [](double value, double sigma, double biased_mean, double biased_sigma) {
+        auto biased = (value - biased_mean) / biased_sigma;
+        return biased_sigma / sigma * std::exp(0.5 * (biased * biased - value * value / (sigma * sigma)));
+    };
+
+    if(gun_shape_ == GunShape::BEAM) {
+        if(biased_beam_) {
+            auto x = G4RandGauss::shoot(bias_beam_offset_.x(), bias_beam_size_);
+            auto y = G4RandGauss::shoot(bias_beam_offset_.y(), bias_beam_size_);
+            weight_ *= density_ratio(x, beam_size_, bias_beam_offset_.x(), bias_beam_size_) *
+                       density_ratio(y, beam_size_, bias_beam_offset_.y(), bias_beam_size_);
+            position += G4ThreeVector(x, y, 0.);
+        } else {
+            position += G4ThreeVector(G4RandGauss::shoot(0., beam_size_), G4RandGauss::shoot(0., beam_size_), 0.);
+        }
+
+        // Rotate the beam direction by the Gaussian angles around the reference axes
+        auto angle_x = G4RandGauss::shoot(0., beam_divergence_.x());
+        auto angle_y = G4RandGauss::shoot(0., beam_divergence_.y());
+        auto theta = std::sqrt(angle_x * angle_x + angle_y * angle_y);
+        direction = std::cos(theta) * beam_direction_;
+        if(theta > 0) {
+            direction -= std::sin(theta) / theta * (angle_x * angref1_ + angle_y * angref2_);
+        }
+    } else {
+        if(gun_shape_ == GunShape::SQUARE) {
+            position += G4ThreeVector((2. * G4UniformRand() - 1.) * square_half_side_,
+                                      (2. * G4UniformRand() - 1.) * square_half_side_,
+                                      0.);
+        }
+
+        // Isotropic emission with the cosine of the polar angle distributed uniformly
+        auto cos_theta = 1. - G4UniformRand() * (1. - cos_max_theta_);
+        auto sin_theta = std::sqrt(std::max(0., 1. - cos_theta * cos_theta));
+        auto phi = CLHEP::twopi * G4UniformRand();
+        direction = G4ThreeVector(-sin_theta * std::cos(phi), -sin_theta * std::sin(phi), -cos_theta);
+    }
+
+    particle_gun_->SetParticlePosition(position);
+    particle_gun_->SetParticleMomentumDirection(direction);
+
+    // Gaussian energy distribution, only sampled with a finite spread
+    auto energy = source_energy_;
+    if(biased_energy_) {
+        auto deviation = G4RandGauss::shoot(0., bias_energy_spread_);
+        weight_ *= density_ratio(deviation, source_energy_spread_, 0., bias_energy_spread_);
+        energy = std::max(0., source_energy_ + deviation);
+    } else if(source_energy_spread_ > 0) {
+        energy = std::max(0., G4RandGauss::shoot(source_energy_, source_energy_spread_));
+    }
+    particle_gun_->SetParticleEnergy(energy);
+}
+
 /**
  * Called automatically for every event
  */
 void GeneratorActionG4::GeneratePrimaries(G4Event* event) {
+    if(particle_gun_ != nullptr) {
+        sample_particle_gun();
+        particle_gun_->GeneratePrimaryVertex(event);
+        return;
+    }
     particle_source_->GeneratePrimaryVertex(event);
 }
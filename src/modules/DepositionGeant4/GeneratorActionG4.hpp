@@ -14,6 +14,7 @@
 
 #include <G4GeneralParticleSource.hh>
 #include <G4ParticleDefinition.hh>
+#include <G4ParticleGun.hh>
 #include <G4SDManager.hh>
 #include <G4ThreeVector.hh>
 #include <G4TwoVector.hh>
@@ -24,6 +25,10 @@
 namespace allpix {
     /**
      * @brief Generates the particles in every event
+     *
+     * The particles are generated with the general particle source of Geant4. If requested, simple beam, point and square
+     * sources are instead generated with a lightweight particle gun, sampling the position, direction and energy of every
+     * primary particle directly with the same distributions as the general particle source.
      */
     class GeneratorActionG4 : public G4VUserPrimaryGeneratorAction {
     public:
@@ -38,8 +43,55 @@ namespace allpix {
          */
         void GeneratePrimaries(G4Event*) override;
 
+        /**
+         * @brief Check if the sampling of the primary particles is biased
+         * @return True if the beam profile or the energy is sampled from a biased distribution
+         */
+        bool isBiased() const { return biased_beam_ || biased_energy_; }
+
+        /**
+         * @brief Get the weight of the primary particles generated since the last reset
+         * @return Product of the ratios of the unbiased and the biased probability densities of all sampled particles
+         */
+        double getWeight() const { return weight_; }
+
+        /**
+         * @brief Reset the weight before the primary particles of the next event are generated
+         */
+        void resetWeight() { weight_ = 1.; }
+
     private:
+        /**
+         * @brief Sample the properties of the next primary particle of the particle gun
+         */
+        void sample_particle_gun();
+
+        // Shapes of the sources generated with the particle gun
+        enum class GunShape { BEAM, POINT, SQUARE };
+
         std::unique_ptr<G4GeneralParticleSource> particle_source_;
+        std::unique_ptr<G4ParticleGun> particle_gun_;
+
+        // Parameters of the source generated with the particle gun
+        GunShape gun_shape_{GunShape::BEAM};
+        G4ThreeVector source_position_;
+        G4ThreeVector beam_direction_;
+        G4ThreeVector angref1_;
+        G4ThreeVector angref2_;
+        double beam_size_{};
+        G4TwoVector beam_divergence_;
+        double square_half_side_{};
+        double cos_max_theta_{-1.};
+        double source_energy_{};
+        double source_energy_spread_{};
+
+        // Biased distributions of the beam profile and the energy, and the weight of the sampled particles
+        bool biased_beam_{false};
+        double bias_beam_size_{};
+        G4TwoVector bias_beam_offset_;
+        bool biased_energy_{false};
+        double bias_energy_spread_{};
+        double weight_{1.};
     };
 } // namespace allpix
 
@@ -11,6 +11,7 @@
 #include "SensitiveDetectorActionG4.hpp"
 #include "TrackInfoG4.hpp"
 
+#include <algorithm>
 #include <memory>
 
 #include "G4DecayTable.hh"
@@ -39,10 +40,11 @@ SensitiveDetectorActionG4::SensitiveDetectorActionG4(Module* module,
                                                      TrackInfoManager* track_info_manager,
                                                      double charge_creation_energy,
                                                      double fano_factor,
+                                                     double deposit_merge_length,
                                                      uint64_t random_seed)
     : G4VSensitiveDetector("SensitiveDetector_" + detector->getName()), module_(module), detector_(detector),
       messenger_(msg), track_info_manager_(track_info_manager), charge_creation_energy_(charge_creation_energy),
-      fano_factor_(fano_factor) {
+      fano_factor_(fano_factor), deposit_merge_length_(deposit_merge_length) {
 
     // Add the sensor to the internal sensitive detector manager
     G4SDManager* sd_man_g4 = G4SDManager::GetSDMpointer();
@@ -52,6 +54,12 @@ SensitiveDetectorActionG4::SensitiveDetectorActionG4(Module* module,
     random_generator_.seed(random_seed);
 }
 
+/**
+ * Only the deposited energy is recorded for every step, the charge carriers are created for all recorded energy deposits
+ * of the event together in \ref create_charges. If a merge length is configured, the energy of consecutive steps of the
+ * same track is accumulated as long as the steps stay within the merge length from the first merged step. It is recorded
+ * as a single energy deposit at the energy-weighted mean position and time of the merged steps.
+ */
 G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*) {
     // Get the step parameters
     auto edep = step->GetTotalEnergyDeposit();
@@ -59,9 +67,6 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     G4StepPoint* postStep = step->GetPostStepPoint();
     LOG(TRACE) << "Distance of this step: " << (postStep->GetPosition() - preStep->GetPosition()).mag();
 
-    // Get Transportaion Matrix
-    G4TouchableHandle theTouchable = step->GetPreStepPoint()->GetTouchableHandle();
-
     // Put the charge deposit in the middle of the step unless it is a photon:
     auto is_photon = (step->GetTrack()->GetDynamicParticle()->GetPDGcode() == 22);
     LOG(DEBUG) << "Placing energy deposit "
@@ -69,21 +74,6 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     G4ThreeVector step_pos = is_photon ? postStep->GetPosition() : (preStep->GetPosition() + postStep->GetPosition()) / 2;
     double step_time = is_photon ? postStep->GetGlobalTime() : (preStep->GetGlobalTime() + postStep->GetGlobalTime()) / 2;
 
-    // Calculate the charge deposit at a local position
-    auto deposit_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(step_pos));
-    auto deposit_position_g4 = theTouchable->GetHistory()->GetTopTransform().TransformPoint(step_pos);
-
-    // Calculate number of electron hole pairs produced, taking into account fluctuations between ionization and lattice
-    // excitations via the Fano factor. We assume Gaussian statistics here.
-    auto mean_charge = static_cast<unsigned int>(edep / charge_creation_energy_);
-    std::normal_distribution<double> charge_fluctuation(mean_charge, std::sqrt(mean_charge * fano_factor_));
-    auto charge = charge_fluctuation(random_generator_);
-
-    auto deposit_position_g4loc =
-        ROOT::Math::XYZPoint(deposit_position_g4.x() + detector_->getModel()->getSensorCenter().x(),
-                             deposit_position_g4.y() + detector_->getModel()->getSensorCenter().y(),
-                             deposit_position_g4.z() + detector_->getModel()->getSensorCenter().z());
-
     const auto userTrackInfo = dynamic_cast<TrackInfoG4*>(step->GetTrack()->GetUserInformation());
     if(userTrackInfo == nullptr) {
         throw ModuleError("No track information attached to track.");
@@ -91,45 +81,125 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     auto trackID = userTrackInfo->getID();
     auto parentTrackID = userTrackInfo->getParentID();
 
-    // Save begin point when track is seen for the first time
-    if(track_begin_.find(trackID) == track_begin_.end()) {
+    // Save begin point when track is seen for the first time, if its passage is recorded at the configured truth level
+    auto* track = find_track(trackID);
+    if(track == nullptr && track_info_manager_->recordParticle(parentTrackID)) {
         track_info_manager_->setTrackInfoToBeStored(trackID);
-        auto start_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(preStep->GetPosition()));
-        track_begin_.emplace(trackID, start_position);
-        track_parents_.emplace(trackID, parentTrackID);
-        track_time_.emplace(trackID, step_time);
-        track_pdg_.emplace(trackID, step->GetTrack()->GetDynamicParticle()->GetPDGcode());
+        track = &add_track(trackID);
+        track->parent_id = parentTrackID;
+        track->pdg_code = step->GetTrack()->GetDynamicParticle()->GetPDGcode();
+        track->time = step_time;
+        track->begin = static_cast<ROOT::Math::XYZPoint>(preStep->GetPosition());
     }
 
     // Update current end point with the current last step
-    auto end_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(postStep->GetPosition()));
-    track_end_[trackID] = end_position;
+    if(track != nullptr) {
+        track->end = static_cast<ROOT::Math::XYZPoint>(postStep->GetPosition());
+    }
+
+    if(deposit_merge_length_ <= 0) {
+        // Record every step, the charge is only created when the event is finished
+        energy_deposits_.push_back({edep, step_pos, step_time, trackID});
+        if(edep <= 0) {
+            return false;
+        }
+
+        // Compare the local position with the transformation of Geant4
+        auto deposit_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(step_pos));
+        G4TouchableHandle theTouchable = preStep->GetTouchableHandle();
+        auto deposit_position_g4 = theTouchable->GetHistory()->GetTopTransform().TransformPoint(step_pos);
+        auto deposit_position_g4loc =
+            ROOT::Math::XYZPoint(deposit_position_g4.x() + detector_->getModel()->getSensorCenter().x(),
+                                 deposit_position_g4.y() + detector_->getModel()->getSensorCenter().y(),
+                                 deposit_position_g4.z() + detector_->getModel()->getSensorCenter().z());
+        LOG(DEBUG) << "Geant4 transformation to local: " << Units::display(deposit_position_g4loc, {"mm", "um"});
+        if((deposit_position_g4loc - deposit_position).mag2() > 0.001) {
+            LOG(ERROR) << "Difference G4 to internal: "
+                       << Units::display((deposit_position_g4loc - deposit_position), {"mm", "um"});
+        }
+        return true;
+    }
 
-    // Add new deposit if the charge is more than zero
-    if(charge == 0) {
+    // Steps without energy deposit do not interrupt the merging
+    if(edep <= 0) {
         return false;
     }
 
-    auto global_deposit_position = detector_->getGlobalPosition(deposit_position);
+    // Deposit the merged steps if this step belongs to another track or is too far away
+    if(merged_deposit_.energy > 0 &&
+       (merged_deposit_.track_id != trackID ||
+        (step_pos - merged_deposit_.begin).mag() > deposit_merge_length_)) {
+        flush_merged_deposit();
+    }
+    if(merged_deposit_.energy <= 0) {
+        merged_deposit_.track_id = trackID;
+        merged_deposit_.begin = step_pos;
+    }
+    merged_deposit_.energy += edep;
+    merged_deposit_.position_sum += edep * step_pos;
+    merged_deposit_.time_sum += edep * step_time;
+    return true;
+}
+
+/**
+ * The mean number of charges is calculated for all energy deposits before sampling their fluctuations in the order of
+ * the deposits, such that the random numbers are drawn in the same sequence as when creating the charges step by step.
+ */
+void SensitiveDetectorActionG4::create_charges() {
+    mean_charges_.resize(energy_deposits_.size());
+    std::transform(energy_deposits_.begin(),
+                   energy_deposits_.end(),
+                   mean_charges_.begin(),
+                   [this](const EnergyDeposit& deposit) {
+                       return static_cast<unsigned int>(deposit.energy / charge_creation_energy_);
+                   });
+
+    deposits_.reserve(deposits_.size() + 2 * energy_deposits_.size());
+    deposit_to_id_.reserve(deposit_to_id_.size() + 2 * energy_deposits_.size());
+    for(size_t i = 0; i < energy_deposits_.size(); ++i) {
+        const auto& deposit = energy_deposits_[i];
+
+        // Calculate number of electron hole pairs produced, taking into account fluctuations between ionization and
+        // lattice excitations via the Fano factor. We assume Gaussian statistics here.
+        auto mean_charge = mean_charges_[i];
+        std::normal_distribution<double> charge_fluctuation(mean_charge, std::sqrt(mean_charge * fano_factor_));
+        auto charge = charge_fluctuation(random_generator_);
+
+        // Add new deposit if the charge is more than zero
+        if(charge == 0) {
+            continue;
+        }
 
-    // Deposit electron
-    deposits_.emplace_back(deposit_position, global_deposit_position, CarrierType::ELECTRON, charge, step_time);
-    deposit_to_id_.push_back(trackID);
+        // Calculate the charge deposit at a local position
+        auto global_deposit_position = static_cast<ROOT::Math::XYZPoint>(deposit.position);
+        auto deposit_position = detector_->getLocalPosition(global_deposit_position);
 
-    // Deposit hole
-    deposits_.emplace_back(deposit_position, global_deposit_position, CarrierType::HOLE, charge, step_time);
-    deposit_to_id_.push_back(trackID);
+        // Deposit electron
+        deposits_.emplace_back(deposit_position, global_deposit_position, CarrierType::ELECTRON, charge, deposit.time);
+        deposit_to_id_.push_back(deposit.track_id);
 
-    LOG(DEBUG) << "Created deposit of " << charge << " charges at " << Units::display(step_pos, {"mm", "um"})
-               << " locally on " << Units::display(deposit_position, {"mm", "um"}) << " in " << detector_->getName()
-               << " after " << Units::display(step_time, {"ns", "ps"});
+        // Deposit hole
+        deposits_.emplace_back(deposit_position, global_deposit_position, CarrierType::HOLE, charge, deposit.time);
+        deposit_to_id_.push_back(deposit.track_id);
 
-    LOG(DEBUG) << "Geant4 transformation to local: " << Units::display(deposit_position_g4loc, {"mm", "um"});
-    if((deposit_position_g4loc - deposit_position).mag2() > 0.001) {
-        LOG(ERROR) << "Difference G4 to internal: "
-                   << Units::display((deposit_position_g4loc - deposit_position), {"mm", "um"});
+        LOG(DEBUG) << "Created deposit of " << charge << " charges at "
+                   << Units::display(global_deposit_position, {"mm", "um"}) << " locally on "
+                   << Units::display(deposit_position, {"mm", "um"}) << " in " << detector_->getName() << " after "
+                   << Units::display(deposit.time, {"ns", "ps"});
     }
-    return true;
+    energy_deposits_.clear();
+}
+
+void SensitiveDetectorActionG4::flush_merged_deposit() {
+    if(merged_deposit_.energy <= 0) {
+        return;
+    }
+
+    energy_deposits_.push_back({merged_deposit_.energy,
+                                merged_deposit_.position_sum / merged_deposit_.energy,
+                                merged_deposit_.time_sum / merged_deposit_.energy,
+                                merged_deposit_.track_id});
+    merged_deposit_ = MergedDeposit();
 }
 
 std::string SensitiveDetectorActionG4::getName() {
@@ -144,53 +214,113 @@ unsigned int SensitiveDetectorActionG4::getDepositedCharge() {
     return deposited_charge_;
 }
 
+SensitiveDetectorActionG4::TrackRecord* SensitiveDetectorActionG4::find_track(int track_id) {
+    if(track_id <= 0 || static_cast<size_t>(track_id) >= track_index_.size() || track_index_[track_id] == no_track_) {
+        return nullptr;
+    }
+    return &tracks_[track_index_[track_id]];
+}
+
+SensitiveDetectorActionG4::TrackRecord& SensitiveDetectorActionG4::add_track(int track_id) {
+    if(static_cast<size_t>(track_id) >= track_index_.size()) {
+        track_index_.resize(static_cast<size_t>(track_id) + 1, no_track_);
+    }
+    track_index_[track_id] = tracks_.size();
+    tracks_.emplace_back();
+    tracks_.back().id = track_id;
+    return tracks_.back();
+}
+
+void SensitiveDetectorActionG4::clear_tracks() {
+    for(auto& track : tracks_) {
+        track_index_[track.id] = no_track_;
+    }
+    tracks_.clear();
+}
+
+/**
+ * The parent id of primary tracks is zero and is not shifted. The data of this action is cleared afterwards.
+ */
+void SensitiveDetectorActionG4::moveDepositsTo(SensitiveDetectorActionG4& target, int track_id_offset) {
+    flush_merged_deposit();
+    create_charges();
+
+    for(auto& deposit : deposits_) {
+        target.deposits_.push_back(std::move(deposit));
+    }
+    for(auto track_id : deposit_to_id_) {
+        target.deposit_to_id_.push_back(track_id + track_id_offset);
+    }
+    for(auto& track : tracks_) {
+        auto& target_track = target.add_track(track.id + track_id_offset);
+        target_track.parent_id = (track.parent_id == 0 ? 0 : track.parent_id + track_id_offset);
+        target_track.pdg_code = track.pdg_code;
+        target_track.time = track.time;
+        target_track.begin = track.begin;
+        target_track.end = track.end;
+    }
+
+    deposits_.clear();
+    deposit_to_id_.clear();
+    clear_tracks();
+}
+
+void SensitiveDetectorActionG4::seed(uint64_t random_seed) {
+    random_generator_.seed(random_seed);
+}
+
+size_t SensitiveDetectorActionG4::getMaxDepositsPerEvent() const {
+    return max_deposits_;
+}
+
+size_t SensitiveDetectorActionG4::getMaxTracksPerEvent() const {
+    return max_tracks_;
+}
+
+/**
+ * The MC particles are created in the order of the track ids. The containers of this action keep their memory for the next
+ * event, and the deposits are filled into a vector from the \ref MessageDataPool.
+ */
 void SensitiveDetectorActionG4::dispatchMessages() {
+    flush_merged_deposit();
+    create_charges();
+
+    max_deposits_ = std::max(max_deposits_, deposits_.size());
+    max_tracks_ = std::max(max_tracks_, tracks_.size());
+
     // Create the mc particles
-    std::vector<MCParticle> mc_particles;
-    for(auto& track_id_point : track_begin_) {
-        auto track_id = track_id_point.first;
-        auto local_begin = track_id_point.second;
-
-        ROOT::Math::XYZPoint end_point;
-        auto local_end = track_end_.at(track_id);
-        auto pdg_code = track_pdg_.at(track_id);
-        auto track_time = track_time_.at(track_id);
-
-        auto global_begin = detector_->getGlobalPosition(local_begin);
-        auto global_end = detector_->getGlobalPosition(local_end);
-        mc_particles.emplace_back(local_begin, global_begin, local_end, global_end, pdg_code, track_time);
-        mc_particles.back().setTrack(track_info_manager_->findMCTrack(track_id));
-        id_to_particle_[track_id] = mc_particles.size() - 1;
-
-        LOG(DEBUG) << "Found MC particle " << pdg_code << " crossing detector " << detector_->getName() << " from "
+    auto mc_particles = MessageDataPool<MCParticle>::acquire();
+    for(auto index : track_index_) {
+        if(index == no_track_) {
+            continue;
+        }
+        auto& track = tracks_[index];
+
+        auto local_begin = detector_->getLocalPosition(track.begin);
+        auto local_end = detector_->getLocalPosition(track.end);
+        mc_particles.emplace_back(local_begin, track.begin, local_end, track.end, track.pdg_code, track.time);
+        mc_particles.back().setTrack(track_info_manager_->findMCTrack(track.id));
+        track.particle = mc_particles.size() - 1;
+
+        LOG(DEBUG) << "Found MC particle " << track.pdg_code << " crossing detector " << detector_->getName() << " from "
                    << Units::display(local_begin, {"mm", "um"}) << " to " << Units::display(local_end, {"mm", "um"})
-                   << " (local coordinates) at " << Units::display(track_time, {"us", "ns", "ps"});
+                   << " (local coordinates) at " << Units::display(track.time, {"us", "ns", "ps"});
     }
 
-    for(auto& track_parent : track_parents_) {
-        auto track_id = track_parent.first;
-        auto parent_id = track_parent.second;
-        if(id_to_particle_.find(parent_id) == id_to_particle_.end()) {
+    for(auto& track : tracks_) {
+        auto* parent = find_track(track.parent_id);
+        if(parent == nullptr) {
             // Skip tracks without direct parents with deposits
             // FIXME: Geant4 does not allow for an easy way retrieve the whole hierarchy
             continue;
         }
-        auto track_idx = id_to_particle_.at(track_id);
-        auto parent_idx = id_to_particle_.at(parent_id);
-        mc_particles.at(track_idx).setParent(&mc_particles.at(parent_idx));
+        mc_particles.at(track.particle).setParent(&mc_particles.at(parent->particle));
     }
 
     // Send the mc particle information
     auto mc_particle_message = std::make_shared<MCParticleMessage>(std::move(mc_particles), detector_);
     messenger_->dispatchMessage(module_, mc_particle_message);
 
-    // Clear track data for the next event
-    track_parents_.clear();
-    track_begin_.clear();
-    track_end_.clear();
-    track_pdg_.clear();
-    track_time_.clear();
-
     // Send a deposit message if we have any deposits
     unsigned int charges = 0;
     if(!deposits_.empty()) {
@@ -200,10 +330,12 @@ void SensitiveDetectorActionG4::dispatchMessages() {
         }
         LOG(INFO) << "Deposited " << charges << " charges in sensor of detector " << detector_->getName();
 
-        // Match deposit with mc particle if possible
+        // Match deposit with mc particle if possible, which is not recorded for all tracks at the lower truth levels
         for(size_t i = 0; i < deposits_.size(); ++i) {
-            auto track_id = deposit_to_id_.at(i);
-            deposits_.at(i).setMCParticle(&mc_particle_message->getData().at(id_to_particle_.at(track_id)));
+            auto* track = find_track(deposit_to_id_[i]);
+            if(track != nullptr) {
+                deposits_[i].setMCParticle(&mc_particle_message->getData().at(track->particle));
+            }
         }
 
         // Create a new charge deposit message
@@ -211,14 +343,14 @@ void SensitiveDetectorActionG4::dispatchMessages() {
 
         // Dispatch the message
         messenger_->dispatchMessage(module_, deposit_message);
+
+        // Continue with recycled memory for the next event
+        deposits_ = MessageDataPool<DepositedCharge>::acquire();
     }
     // Store the number of charge carriers:
     deposited_charge_ = charges;
 
-    // Clear deposits for next event
-    deposits_ = std::vector<DepositedCharge>();
-
-    // Clear link tables for next event
+    // Clear the track data and link tables for the next event
     deposit_to_id_.clear();
-    id_to_particle_.clear();
+    clear_tracks();
 }
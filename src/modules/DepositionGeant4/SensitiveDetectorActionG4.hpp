@@ -10,8 +10,11 @@
 #ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ACTION_H
 #define ALLPIX_SIMPLE_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ACTION_H
 
+#include <limits>
 #include <memory>
+#include <vector>
 
+#include <G4ThreeVector.hh>
 #include <G4VSensitiveDetector.hh>
 #include <G4WrapperProcess.hh>
 
@@ -36,6 +39,8 @@ namespace allpix {
          * @param msg Pointer to the messenger to send the charge deposits
          * @param charge_creation_energy Energy needed per deposited charge
          * @param fano_factor Fano factor for fluctuations in the energy fraction going into e/h pair creation
+         * @param deposit_merge_length Length within which consecutive steps of a track are merged into a single deposit,
+         * zero to create a deposit for every step
          * @param random_seed Seed for the random number generator for Fano fluctuations
          */
         SensitiveDetectorActionG4(Module* module,
@@ -44,6 +49,7 @@ namespace allpix {
                                   TrackInfoManager* track_info_manager,
                                   double charge_creation_energy,
                                   double fano_factor,
+                                  double deposit_merge_length,
                                   uint64_t random_seed);
 
         /**
@@ -75,6 +81,29 @@ namespace allpix {
          */
         void dispatchMessages();
 
+        /**
+         * @brief Move the deposits and tracks of the current event to the action of the same detector on another thread
+         * @param target Action receiving the deposits and tracks
+         * @param track_id_offset Offset added to all track ids, as returned by \ref TrackInfoManager::moveTracksTo
+         */
+        void moveDepositsTo(SensitiveDetectorActionG4& target, int track_id_offset);
+
+        /**
+         * @brief Reseed the random number generator for Fano fluctuations
+         * @param random_seed New seed for the random number generator
+         */
+        void seed(uint64_t random_seed);
+
+        /**
+         * @brief Get the largest number of charge deposits created in the sensitive device in a single event
+         */
+        size_t getMaxDepositsPerEvent() const;
+
+        /**
+         * @brief Get the largest number of tracks passing through the sensitive device in a single event
+         */
+        size_t getMaxTracksPerEvent() const;
+
     private:
         // Instantatiation of the deposition module
         Module* module_;
@@ -85,6 +114,7 @@ namespace allpix {
 
         double charge_creation_energy_;
         double fano_factor_;
+        double deposit_merge_length_;
 
         // Random number generator for e/h pair creation fluctuation
         std::mt19937_64 random_generator_;
@@ -95,22 +125,87 @@ namespace allpix {
 
         // Set of deposited charges in this event
         std::vector<DepositedCharge> deposits_;
-
-        // List of begin points for tracks
-        std::map<int, ROOT::Math::XYZPoint> track_begin_;
-        // List of end points for tracks
-        std::map<int, ROOT::Math::XYZPoint> track_end_;
-        // Parent of all mc tracks
-        std::map<int, int> track_parents_;
-        // PDG code of the tracks
-        std::map<int, int> track_pdg_;
-        // Arrival timestamp of the tracks
-        std::map<int, double> track_time_;
-
         // Map from deposit index to track id
         std::vector<int> deposit_to_id_;
-        // Map from track id to mc particle index
-        std::map<int, size_t> id_to_particle_;
+
+        /**
+         * @brief Energy deposited by consecutive steps of a single track which are merged into a single deposit
+         */
+        struct MergedDeposit {
+            int track_id{};
+            double energy{};
+            // Global position of the first step and energy-weighted sums of the global positions and times of all steps
+            G4ThreeVector begin;
+            G4ThreeVector position_sum;
+            double time_sum{};
+        };
+        MergedDeposit merged_deposit_;
+
+        /**
+         * @brief Energy deposited in the sensor, converted to charge carriers at the end of the event
+         */
+        struct EnergyDeposit {
+            double energy;
+            // Global position and time of the deposit
+            G4ThreeVector position;
+            double time;
+            int track_id;
+        };
+        // Energy deposits of this event which are not converted to charges yet, and their mean number of charges
+        std::vector<EnergyDeposit> energy_deposits_;
+        std::vector<unsigned int> mean_charges_;
+
+        /**
+         * @brief Create the electron and hole deposits for all recorded energy deposits of the event in a single pass
+         */
+        void create_charges();
+        /**
+         * @brief Record the energy deposit of the merged steps, if any
+         */
+        void flush_merged_deposit();
+
+        /**
+         * @brief Information about a track passing through the sensitive device
+         */
+        struct TrackRecord {
+            int id{};
+            int parent_id{};
+            int pdg_code{};
+            // Arrival timestamp of the track
+            double time{};
+            // Begin and end points of the track in global coordinates, converted to local coordinates when dispatching
+            ROOT::Math::XYZPoint begin;
+            ROOT::Math::XYZPoint end;
+            // Index of the MC particle of the track in the dispatched message
+            size_t particle{};
+        };
+
+        /**
+         * @brief Find the record of a track
+         * @param track_id Id of the track
+         * @return Pointer to the record or a null pointer if the track did not pass the sensitive device in this event
+         */
+        TrackRecord* find_track(int track_id);
+        /**
+         * @brief Add a record for a track passing through the sensitive device for the first time in this event
+         * @param track_id Id of the track
+         * @return Reference to the new record
+         */
+        TrackRecord& add_track(int track_id);
+        /**
+         * @brief Remove the records of all tracks, keeping the allocated memory for the next event
+         */
+        void clear_tracks();
+
+        // Records of the tracks in order of their first step in this event
+        std::vector<TrackRecord> tracks_;
+        // Index of the record for every track id, kept across events together with the records to retain their capacity
+        static constexpr size_t no_track_ = std::numeric_limits<size_t>::max();
+        std::vector<size_t> track_index_;
+
+        // Largest number of deposits and tracks in a single event
+        size_t max_deposits_{};
+        size_t max_tracks_{};
     };
 } // namespace allpix
 
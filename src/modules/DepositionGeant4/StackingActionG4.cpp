@@ -0,0 +1,38 @@
+/**
+ * @file
+ * @brief Implements the stacking action killing low-energy secondaries far from all sensors
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "StackingActionG4.hpp"
+
+#include <G4Track.hh>
+
+using namespace allpix;
+
+/**
+ * Primary particles are never killed. The distance to a sensor is the distance to the surface of its bounding sphere.
+ */
+G4ClassificationOfNewTrack StackingActionG4::ClassifyNewTrack(const G4Track* track) {
+    if(track->GetParentID() == 0) {
+        return fUrgent;
+    }
+
+    policy_->secondary_tracks.fetch_add(1, std::memory_order_relaxed);
+    if(track->GetKineticEnergy() >= policy_->kill_energy) {
+        return fUrgent;
+    }
+
+    const auto& position = track->GetPosition();
+    for(size_t i = 0; i < policy_->sensor_centers.size(); ++i) {
+        if((position - policy_->sensor_centers[i]).mag() - policy_->sensor_radii[i] <= policy_->kill_distance) {
+            return fUrgent;
+        }
+    }
+
+    policy_->killed_tracks.fetch_add(1, std::memory_order_relaxed);
+    return fKill;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @brief Defines the stacking action killing low-energy secondaries far from all sensors
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_STACKING_ACTION_H
+#define ALLPIX_SIMPLE_DEPOSITION_MODULE_STACKING_ACTION_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <G4ThreeVector.hh>
+#include <G4UserStackingAction.hh>
+
+namespace allpix {
+    /**
+     * @brief Kills secondary tracks which are created with a low energy far away from all sensors
+     *
+     * Secondary particles created in passive material or in the world volume are only tracked if they can reach a sensor.
+     * Particles below an energy threshold created further away from all sensors than a configurable distance are killed
+     * before they are tracked. The sensors are approximated by their bounding spheres, such that the distance to the sensor
+     * is never overestimated.
+     */
+    class StackingActionG4 : public G4UserStackingAction {
+    public:
+        /**
+         * @brief Policy for killing tracks shared by the stacking actions of all worker threads
+         */
+        struct Policy {
+            // Centers and radii of the bounding spheres of all sensors in global coordinates
+            std::vector<G4ThreeVector> sensor_centers;
+            std::vector<double> sensor_radii;
+
+            // Tracks below the energy are killed if created further away from all sensors than the distance
+            double kill_distance{};
+            double kill_energy{};
+
+            // Number of secondary tracks classified and killed by all threads
+            std::atomic<uint64_t> secondary_tracks{};
+            std::atomic<uint64_t> killed_tracks{};
+        };
+
+        /**
+         * @brief Construct the stacking action
+         * @param policy Policy for killing tracks, which has to outlive the stacking action
+         */
+        explicit StackingActionG4(Policy* policy) : policy_(policy) {}
+
+        /**
+         * @brief Classify a new track, killing it if it cannot contribute to any sensor
+         * @param track New track to classify
+         * @return Classification of the track, either killed or the default urgent classification
+         */
+        G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+
+    private:
+        Policy* policy_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_SIMPLE_DEPOSITION_MODULE_STACKING_ACTION_H */
@@ -39,6 +39,13 @@ int TrackInfoG4::getParentID() const {
     return parent_track_id_;
 }
 
+void TrackInfoG4::shiftID(int offset) {
+    custom_track_id_ += offset;
+    if(parent_track_id_ != 0) {
+        parent_track_id_ += offset;
+    }
+}
+
 ROOT::Math::XYZPoint TrackInfoG4::getStartPoint() const {
     return start_point_;
 }
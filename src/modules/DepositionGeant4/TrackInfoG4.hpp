@@ -45,6 +45,12 @@ namespace allpix {
          */
         int getParentID() const;
 
+        /**
+         * @brief Shift the custom id of the track and of its parent
+         * @param offset Offset added to both ids (the parent id of primary tracks stays zero)
+         */
+        void shiftID(int offset);
+
         /**
          * @brief Update track info from the G4Track
          * @param aTrack A pointer to a G4Track instance which represents this track's final state
@@ -9,37 +9,47 @@
 
 #include "TrackInfoManager.hpp"
 
+#include <algorithm>
+
 using namespace allpix;
 
-TrackInfoManager::TrackInfoManager() : counter_(1) {}
+TrackInfoManager::TrackInfoManager(TruthLevel truth_level) : truth_level_(truth_level), counter_(1) {}
 
+/**
+ * All tracks are registered to be stored at full truth level, and the primary tracks at primaries truth level.
+ */
 std::unique_ptr<TrackInfoG4> TrackInfoManager::makeTrackInfo(const G4Track* const track) {
     auto custom_id = counter_++;
     auto G4ParentID = track->GetParentID();
-    auto parent_track_id = G4ParentID == 0 ? G4ParentID : g4_to_custom_id_.at(G4ParentID);
-    g4_to_custom_id_[track->GetTrackID()] = custom_id;
-    track_id_to_parent_id_[custom_id] = parent_track_id;
+    auto parent_track_id = G4ParentID == 0 ? G4ParentID : g4_to_custom_id_.at(static_cast<size_t>(G4ParentID));
+    at_id(g4_to_custom_id_, track->GetTrackID()) = custom_id;
+    at_id(track_id_to_parent_id_, custom_id) = parent_track_id;
+    if(truth_level_ == TruthLevel::FULL || (truth_level_ == TruthLevel::PRIMARIES && parent_track_id == 0)) {
+        at_id(to_store_track_ids_, custom_id) = 1;
+    }
     return std::make_unique<TrackInfoG4>(custom_id, parent_track_id, track);
 }
 
+/**
+ * Only tracks passing through a sensor are registered, which is only required at sensors truth level. At the other levels
+ * the tracks to be stored are registered when they are created.
+ */
 void TrackInfoManager::setTrackInfoToBeStored(int track_id) {
-    auto element = std::find(to_store_track_ids_.begin(), to_store_track_ids_.end(), track_id);
-    // If track id is not present we add it, otherwise skip as we only need each track once
-    if(element == to_store_track_ids_.end()) {
-        to_store_track_ids_.emplace_back(track_id);
+    if(truth_level_ == TruthLevel::SENSORS) {
+        at_id(to_store_track_ids_, track_id) = 1;
     }
 }
 
 void TrackInfoManager::storeTrackInfo(std::unique_ptr<TrackInfoG4> the_track_info) {
-    auto track_id = the_track_info->getID();
-    auto element = std::find(to_store_track_ids_.begin(), to_store_track_ids_.end(), track_id);
-    if(element != to_store_track_ids_.end()) {
+    auto track_id = static_cast<size_t>(the_track_info->getID());
+    if(track_id < to_store_track_ids_.size() && to_store_track_ids_[track_id] != 0) {
         stored_track_infos_.push_back(std::move(the_track_info));
-        to_store_track_ids_.erase(element);
+        to_store_track_ids_[track_id] = 0;
     }
 }
 
 void TrackInfoManager::resetTrackInfoManager() {
+    max_tracks_ = std::max(max_tracks_, static_cast<size_t>(counter_ - 1));
     counter_ = 1;
     stored_tracks_.clear();
     to_store_track_ids_.clear();
@@ -50,6 +60,23 @@ void TrackInfoManager::resetTrackInfoManager() {
     id_to_track_.clear();
 }
 
+int TrackInfoManager::moveTracksTo(TrackInfoManager& target) {
+    auto offset = target.counter_ - 1;
+    for(size_t track_id = 1; track_id < track_id_to_parent_id_.size(); ++track_id) {
+        auto parent_id = track_id_to_parent_id_[track_id];
+        at_id(target.track_id_to_parent_id_, static_cast<int>(track_id) + offset) =
+            (parent_id == 0 ? 0 : parent_id + offset);
+    }
+    for(auto& track_info : stored_track_infos_) {
+        track_info->shiftID(offset);
+        target.stored_track_infos_.push_back(std::move(track_info));
+    }
+    target.counter_ += counter_ - 1;
+
+    resetTrackInfoManager();
+    return offset;
+}
+
 void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger) {
     set_all_track_parents();
     IFLOG(DEBUG) {
@@ -64,8 +91,8 @@ void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger) {
 }
 
 MCTrack const* TrackInfoManager::findMCTrack(int track_id) const {
-    auto it = id_to_track_.find(track_id);
-    return (it == id_to_track_.end()) ? nullptr : it->second;
+    auto index = static_cast<size_t>(track_id);
+    return (track_id <= 0 || index >= id_to_track_.size()) ? nullptr : id_to_track_[index];
 }
 
 void TrackInfoManager::createMCTracks() {
@@ -84,7 +111,7 @@ void TrackInfoManager::createMCTracks() {
                                     track_info->getTotalEnergyInitial(),
                                     track_info->getTotalEnergyFinal());
 
-        id_to_track_[track_info->getID()] = &stored_tracks_.back();
+        at_id(id_to_track_, track_info->getID()) = &stored_tracks_.back();
         stored_track_ids_.emplace_back(track_info->getID());
     }
 }
@@ -92,7 +119,7 @@ void TrackInfoManager::createMCTracks() {
 void TrackInfoManager::set_all_track_parents() {
     for(size_t ix = 0; ix < stored_track_ids_.size(); ++ix) {
         auto track_id = stored_track_ids_[ix];
-        auto parent_id = track_id_to_parent_id_[track_id];
+        auto parent_id = track_id_to_parent_id_[static_cast<size_t>(track_id)];
         stored_tracks_[ix].setParent(findMCTrack(parent_id));
     }
 }
@@ -11,7 +11,7 @@
 #ifndef TrackInfoManager_H
 #define TrackInfoManager_H 1
 
-#include <map>
+#include <vector>
 
 #include "G4Track.hh"
 #include "TrackInfoG4.hpp"
@@ -26,9 +26,20 @@ namespace allpix {
     class TrackInfoManager {
     public:
         /**
-         * @brief Default constructor
+         * @brief Level of Monte-Carlo truth information recorded for the tracks of an event
          */
-        TrackInfoManager();
+        enum class TruthLevel {
+            NONE,      ///< No MCTrack and MCParticle objects are created
+            PRIMARIES, ///< Only the primary tracks are stored and only their passages through the sensors are recorded
+            SENSORS,   ///< All tracks passing through a sensor are stored and recorded
+            FULL,      ///< All tracks are stored, all passages through the sensors are recorded
+        };
+
+        /**
+         * @brief Constructor
+         * @param truth_level Level of Monte-Carlo truth information to record
+         */
+        explicit TrackInfoManager(TruthLevel truth_level = TruthLevel::SENSORS);
 
         /**
          * @brief Factory method for TrackInfoG4 instances
@@ -56,6 +67,22 @@ namespace allpix {
          */
         void setTrackInfoToBeStored(int track_id);
 
+        /**
+         * @brief Check if the passage of a track through a sensor should be recorded as MCParticle
+         * @param parent_id The id of the parent of the track, zero for primary tracks
+         * @return True if the track should be recorded at the configured truth level
+         */
+        bool recordParticle(int parent_id) const {
+            return truth_level_ == TruthLevel::SENSORS || truth_level_ == TruthLevel::FULL ||
+                   (truth_level_ == TruthLevel::PRIMARIES && parent_id == 0);
+        }
+
+        /**
+         * @brief Get the level of Monte-Carlo truth information recorded
+         * @return Truth level of this manager
+         */
+        TruthLevel getTruthLevel() const { return truth_level_; }
+
         /**
          * @brief Reset of the TrackInfoManager instance
          *
@@ -65,6 +92,15 @@ namespace allpix {
          */
         void resetTrackInfoManager();
 
+        /**
+         * @brief Move all stored tracks to another instance, assigning them ids following the ids used there
+         * @param target TrackInfoManager receiving the tracks
+         * @return Offset added to the ids of the tracks
+         *
+         * Used to merge the tracks of Geant4 worker threads. This instance is reset afterwards, see #resetTrackInfoManager
+         */
+        int moveTracksTo(TrackInfoManager& target);
+
         /**
          * @brief Dispatch the stored tracks as a MCTrackMessage
          * @param module The module which is responsible for dispatching the message
@@ -87,6 +123,11 @@ namespace allpix {
          */
         MCTrack const* findMCTrack(int track_id) const;
 
+        /**
+         * @brief Get the largest number of tracks created in a single event
+         */
+        size_t getMaxTracksPerEvent() const { return max_tracks_; }
+
     private:
         /**
          * @brief Will internally set all the parent-child relations between stored tracks
@@ -95,22 +136,43 @@ namespace allpix {
          */
         void set_all_track_parents();
 
+        /**
+         * @brief Access the element of a table indexed by track id, growing the table if needed
+         * @param table Table indexed by the track id
+         * @param track_id Id of the track, has to be non-negative
+         * @return Reference to the element of the track
+         */
+        template <typename T> static T& at_id(std::vector<T>& table, int track_id) {
+            auto index = static_cast<size_t>(track_id);
+            if(index >= table.size()) {
+                table.resize(index + 1);
+            }
+            return table[index];
+        }
+
+        TruthLevel truth_level_;
+
         // Counter to store highest assigned track id
         int counter_{};
+        // Largest number of tracks in a single event
+        size_t max_tracks_{};
+
+        // The tables below are indexed by track id and only cleared between events, such that they retain the memory
+        // required by the largest event so far. Geant4 assigns consecutive ids as well, such that the tables are dense.
         // Geant4 id to custom id translation
-        std::map<int, int> g4_to_custom_id_{};
+        std::vector<int> g4_to_custom_id_;
         // Custom id to custom parent id tracking
-        std::map<int, int> track_id_to_parent_id_{};
-        // List of track ids to be stored if they are provided via #storeTrackInfo
-        std::vector<int> to_store_track_ids_;
+        std::vector<int> track_id_to_parent_id_;
+        // Flags of the track ids to be stored if they are provided via #storeTrackInfo
+        std::vector<char> to_store_track_ids_;
         // The TrackInfoG4 instances which are handed over to this track manager
         std::vector<std::unique_ptr<TrackInfoG4>> stored_track_infos_;
         // The MCTrack vector which is dispatched via #dispatchMessage
         std::vector<MCTrack> stored_tracks_;
         // Ids ins same order as tracks stored in #stored_tracks_
         std::vector<int> stored_track_ids_;
-        // Id to index in #stored_tracks_ for easier handling
-        std::map<int, MCTrack const*> id_to_track_;
+        // Id to track in #stored_tracks_ for easier handling
+        std::vector<MCTrack const*> id_to_track_;
     };
 } // namespace allpix
 #endif /* TrackInfoManager_H */
@@ -0,0 +1,308 @@
+/**
+ * @file
+ * @brief Implementation of a module to deposit charges along straight tracks with a parametrised energy loss
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "DepositionLandauModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include <Math/QuantFuncMathCore.h>
+
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+namespace {
+    // Particles which can be shot with their PDG code and mass in MeV
+    struct ParticleProperties {
+        int code;
+        double mass;
+    };
+    const std::map<std::string, ParticleProperties> particles = {{"pi+", {211, 139.57039}},
+                                                                 {"pi-", {-211, 139.57039}},
+                                                                 {"kaon+", {321, 493.677}},
+                                                                 {"kaon-", {-321, 493.677}},
+                                                                 {"mu+", {-13, 105.6583755}},
+                                                                 {"mu-", {13, 105.6583755}},
+                                                                 {"proton", {2212, 938.27208816}},
+                                                                 {"anti_proton", {-2212, 938.27208816}}};
+
+    // Constants of the energy loss calculation in MeV, g and cm
+    constexpr double electron_mass = 0.51099895;
+    constexpr double bethe_constant = 0.307075;
+    constexpr double speed_of_light = 299.792458; // mm/ns
+
+    // Properties of silicon and its parameters of the density effect correction by Sternheimer
+    constexpr double silicon_z_over_a = 0.49848;
+    constexpr double silicon_density = 2.329;
+    constexpr double silicon_excitation_energy = 173e-6;
+    constexpr double sternheimer_x0 = 0.2015;
+    constexpr double sternheimer_x1 = 2.8716;
+    constexpr double sternheimer_a = 0.14921;
+    constexpr double sternheimer_k = 3.2546;
+    constexpr double sternheimer_c = 4.4355;
+    constexpr double sternheimer_delta0 = 0.14;
+
+    // Position of the maximum of the standard Landau distribution
+    constexpr double landau_maximum = -0.22278;
+} // namespace
+
+DepositionLandauModule::DepositionLandauModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
+    : Module(config), geo_manager_(geo_manager), messenger_(messenger) {
+    // Tracks are independent of other events, as every event uses its own random generator
+    enable_event_parallelization();
+
+    // Seed the random generator with the seed received
+    random_generator_.seed(getRandomSeed());
+
+    // Allow to use the same syntax as in DepositionGeant4
+    config_.setAlias("source_position", "beam_position");
+    config_.setAlias("source_energy", "beam_energy");
+
+    config_.setDefault<ROOT::Math::XYZPoint>("source_position", ROOT::Math::XYZPoint());
+    config_.setDefault<double>("beam_size", 0);
+    config_.setDefault<unsigned int>("number_of_particles", 1);
+    config_.setDefault<double>("charge_creation_energy", Units::get(3.64, "eV"));
+    config_.setDefault<double>("fano_factor", 0.115);
+    config_.setDefault<double>("max_step_length", Units::get(1.0, "um"));
+
+    // Read the particle type
+    auto particle_type = config_.get<std::string>("particle_type");
+    std::transform(particle_type.begin(), particle_type.end(), particle_type.begin(), ::tolower);
+    auto particle = particles.find(particle_type);
+    if(particle == particles.end()) {
+        std::string supported;
+        for(const auto& entry : particles) {
+            supported += (supported.empty() ? "'" : ", '") + entry.first + "'";
+        }
+        throw InvalidValueError(config_, "particle_type", "unsupported particle, possible types are " + supported);
+    }
+    particle_code_ = particle->second.code;
+    particle_mass_ = particle->second.mass;
+
+    // Kinematics of the particles, which are neither slowed down nor scattered in the setup
+    auto energy = config_.get<double>("source_energy");
+    if(energy <= 0) {
+        throw InvalidValueError(config_, "source_energy", "kinetic energy of the particles has to be positive");
+    }
+    auto gamma = 1 + energy / particle_mass_;
+    beta_gamma_ = std::sqrt(gamma * gamma - 1);
+    beta_ = beta_gamma_ / gamma;
+    auto mass_ratio = electron_mass / particle_mass_;
+    max_energy_transfer_ =
+        2 * electron_mass * beta_gamma_ * beta_gamma_ / (1 + 2 * gamma * mass_ratio + mass_ratio * mass_ratio);
+
+    // Beam with a Gaussian profile perpendicular to its direction
+    source_position_ = config_.get<ROOT::Math::XYZPoint>("source_position");
+    beam_direction_ = config_.get<ROOT::Math::XYZVector>("beam_direction");
+    if(std::fabs(beam_direction_.Mag2() - 1.0) > std::numeric_limits<double>::epsilon()) {
+        LOG(WARNING) << "Momentum direction is not a unit vector: magnitude is ignored";
+    }
+    if(beam_direction_.Mag2() == 0) {
+        throw InvalidValueError(config_, "beam_direction", "direction of the beam cannot be a null vector");
+    }
+    beam_direction_ = beam_direction_.Unit();
+    auto reference =
+        (std::fabs(beam_direction_.x()) < 0.9 ? ROOT::Math::XYZVector(1, 0, 0) : ROOT::Math::XYZVector(0, 1, 0));
+    beam_axis_u_ = beam_direction_.Cross(reference).Unit();
+    beam_axis_v_ = beam_direction_.Cross(beam_axis_u_);
+    beam_size_ = config_.get<double>("beam_size");
+    number_of_particles_ = config_.get<unsigned int>("number_of_particles");
+
+    charge_creation_energy_ = config_.get<double>("charge_creation_energy");
+    fano_factor_ = config_.get<double>("fano_factor");
+    max_step_length_ = config_.get<double>("max_step_length");
+    if(max_step_length_ <= 0) {
+        throw InvalidValueError(config_, "max_step_length", "maximum step length has to be positive");
+    }
+}
+
+void DepositionLandauModule::init() {
+    // Only deposit charges in detectors with a module listening for them
+    for(auto& detector : geo_manager_->getDetectors()) {
+        if(!messenger_->hasReceiver<DepositedChargeMessage>(this, detector) &&
+           !messenger_->hasReceiver<MCParticleMessage>(this, detector)) {
+            LOG(INFO) << "Not depositing charges in detector " << detector->getName()
+                      << " because there is no listener for its deposits";
+            continue;
+        }
+        detector_index_[detector.get()] = detectors_.size();
+        detectors_.push_back(detector);
+
+        auto energy_loss = most_probable_energy_loss(detector->getModel()->getSensorSize().z());
+        LOG(INFO) << "Most probable energy loss at perpendicular incidence in detector " << detector->getName() << ": "
+                  << Units::display(energy_loss.first, {"keV", "MeV"}) << ", Landau width "
+                  << Units::display(energy_loss.second, {"keV", "MeV"});
+    }
+
+    // Report the sensors along the nominal beam axis, looked up by the geometry manager
+    auto source_detector = geo_manager_->findDetector(source_position_);
+    if(source_detector != nullptr) {
+        LOG(WARNING) << "Source position is inside the sensor of detector " << source_detector->getName()
+                     << ", charges are only deposited along the track after the source";
+    }
+    std::string crossed;
+    for(auto& detector : geo_manager_->intersect(source_position_, beam_direction_)) {
+        crossed += (crossed.empty() ? "" : ", ") + detector->getName();
+    }
+    LOG(INFO) << "Beam axis crosses the sensors of " << (crossed.empty() ? "no detectors" : "detectors " + crossed);
+}
+
+void DepositionLandauModule::run(unsigned int) {
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
+
+    // Deposits of all detectors and their particles, reserved such that the deposits can refer to their particle
+    std::vector<std::vector<DepositedCharge>> charges(detectors_.size());
+    std::vector<std::vector<MCParticle>> mcparticles(detectors_.size());
+    for(auto& particles_list : mcparticles) {
+        particles_list.reserve(number_of_particles_);
+    }
+
+    std::normal_distribution<double> beam_profile(0, beam_size_);
+    for(unsigned int particle = 0; particle < number_of_particles_; ++particle) {
+        auto position = source_position_;
+        if(beam_size_ > 0) {
+            position += beam_profile(random_generator) * beam_axis_u_ + beam_profile(random_generator) * beam_axis_v_;
+        }
+
+        // Only intersect the track with the sensors it crosses, as found in the bounding volume hierarchy of the geometry
+        for(auto& detector : geo_manager_->intersect(position, beam_direction_)) {
+            auto index = detector_index_.find(detector.get());
+            if(index == detector_index_.end()) {
+                continue;
+            }
+            auto i = index->second;
+            deposit_track(detectors_[i], position, beam_direction_, random_generator, charges[i], mcparticles[i]);
+        }
+    }
+
+    // Dispatch the messages of all detectors traversed by any particle
+    for(size_t i = 0; i < detectors_.size(); ++i) {
+        if(mcparticles[i].empty()) {
+            continue;
+        }
+
+        auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles[i]), detectors_[i]);
+        messenger_->dispatchMessage(this, mcparticle_message);
+
+        auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges[i]), detectors_[i]);
+        messenger_->dispatchMessage(this, deposit_message);
+    }
+}
+
+void DepositionLandauModule::deposit_track(const std::shared_ptr<Detector>& detector,
+                                           const ROOT::Math::XYZPoint& position,
+                                           const ROOT::Math::XYZVector& direction,
+                                           std::mt19937_64& random_generator,
+                                           std::vector<DepositedCharge>& charges,
+                                           std::vector<MCParticle>& mcparticles) const {
+    auto model = detector->getModel();
+
+    // Transform the track to the local coordinates of the detector
+    auto origin = detector->getLocalPosition(position);
+    auto local_direction = detector->getLocalPosition(position + direction) - origin;
+
+    // Intersect the track with the sensor box, following the slab method
+    auto lower = model->getSensorCenter() - model->getSensorSize() / 2.0;
+    auto upper = model->getSensorCenter() + model->getSensorSize() / 2.0;
+    double entry = 0;
+    double exit = std::numeric_limits<double>::max();
+    auto intersect_slab = [&](double start, double step, double low, double high) {
+        if(step == 0) {
+            return start >= low && start <= high;
+        }
+        auto first = (low - start) / step;
+        auto second = (high - start) / step;
+        entry = std::max(entry, std::min(first, second));
+        exit = std::min(exit, std::max(first, second));
+        return entry < exit;
+    };
+    if(!intersect_slab(origin.x(), local_direction.x(), lower.x(), upper.x()) ||
+       !intersect_slab(origin.y(), local_direction.y(), lower.y(), upper.y()) ||
+       !intersect_slab(origin.z(), local_direction.z(), lower.z(), upper.z())) {
+        return;
+    }
+
+    auto start_local = origin + entry * local_direction;
+    auto end_local = origin + exit * local_direction;
+    auto path_length = exit - entry;
+
+    // Create the MCParticle, arriving at the sensor after flying from the source
+    auto time = entry / (beta_ * speed_of_light);
+    mcparticles.emplace_back(start_local,
+                             detector->getGlobalPosition(start_local),
+                             end_local,
+                             detector->getGlobalPosition(end_local),
+                             particle_code_,
+                             time);
+
+    // Sample the energy loss from a Landau distribution, limited by the maximum energy transfer to a single electron
+    auto energy_loss = most_probable_energy_loss(path_length);
+    auto lambda = ROOT::Math::landau_quantile(std::uniform_real_distribution<double>(0, 1)(random_generator));
+    auto energy = std::min(std::max(energy_loss.first + energy_loss.second * (lambda - landau_maximum), 0.0),
+                           max_energy_transfer_);
+
+    // Convert the energy into charge carriers, including the Fano fluctuations
+    auto mean_charge = energy / charge_creation_energy_;
+    std::normal_distribution<double> charge_fluctuation(mean_charge, std::sqrt(mean_charge * fano_factor_));
+    auto charge = static_cast<unsigned int>(std::max(std::round(charge_fluctuation(random_generator)), 0.0));
+    LOG(DEBUG) << "Particle traversed " << Units::display(path_length, {"um", "mm"}) << " in detector "
+               << detector->getName() << ", depositing " << charge << " e/h pairs";
+
+    // Split the charge carriers equally over steps along the track, placed at the center of every step
+    auto steps = static_cast<unsigned int>(std::ceil(path_length / max_step_length_));
+    for(unsigned int step = 0; step < steps; ++step) {
+        auto step_charge = charge / steps + (step < charge % steps ? 1 : 0);
+        if(step_charge == 0) {
+            continue;
+        }
+
+        auto distance = entry + (step + 0.5) * path_length / steps;
+        auto position_local = origin + distance * local_direction;
+        auto position_global = detector->getGlobalPosition(position_local);
+        auto step_time = distance / (beta_ * speed_of_light);
+
+        charges.emplace_back(
+            position_local, position_global, CarrierType::ELECTRON, step_charge, step_time, &(mcparticles.back()));
+        charges.emplace_back(
+            position_local, position_global, CarrierType::HOLE, step_charge, step_time, &(mcparticles.back()));
+    }
+}
+
+/**
+ * The most probable energy loss follows the Landau-Vavilov-Bichsel expression given by the Particle Data Group, including
+ * the density effect correction with the Sternheimer parameters of silicon.
+ */
+std::pair<double, double> DepositionLandauModule::most_probable_energy_loss(double path_length) const {
+    auto beta2 = beta_ * beta_;
+    auto x = std::log10(beta_gamma_);
+    double delta = 0;
+    if(x >= sternheimer_x1) {
+        delta = 2 * std::log(10) * x - sternheimer_c;
+    } else if(x >= sternheimer_x0) {
+        delta = 2 * std::log(10) * x - sternheimer_c + sternheimer_a * std::pow(sternheimer_x1 - x, sternheimer_k);
+    } else {
+        delta = sternheimer_delta0 * std::pow(10, 2 * (x - sternheimer_x0));
+    }
+
+    auto thickness = silicon_density * Units::convert(path_length, "cm");
+    auto xi = bethe_constant / 2 * silicon_z_over_a * thickness / beta2;
+    auto mpv = xi * (std::log(2 * electron_mass * beta_gamma_ * beta_gamma_ / silicon_excitation_energy) +
+                     std::log(xi / silicon_excitation_energy) + 0.200 - beta2 - delta);
+    return {mpv, xi};
+}
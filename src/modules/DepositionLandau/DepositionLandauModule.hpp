@@ -0,0 +1,103 @@
+/**
+ * @file
+ * @brief Definition of a module to deposit charges along straight tracks with a parametrised energy loss
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to deposit charges along straight tracks through all sensors without a full particle simulation
+     *
+     * Particles are shot from a source along straight lines through the setup. The energy lost in every traversed sensor
+     * is sampled from a Landau distribution around the most probable energy loss of the Landau-Vavilov-Bichsel theory for
+     * the path length in the sensor, and converted into charge carriers deposited along the track.
+     */
+    class DepositionLandauModule : public Module {
+    public:
+        /**
+         * @brief Constructor for the parametrised deposition module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_manager Pointer to the geometry manager, containing the detectors
+         */
+        DepositionLandauModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
+
+        /**
+         * @brief Select the detectors to deposit charges in
+         */
+        void init() override;
+
+        /**
+         * @brief Shoot the particles of the event and deposit their charges in all traversed sensors
+         */
+        void run(unsigned int) override;
+
+    private:
+        /**
+         * @brief Deposit the charges of a straight track through the sensor of a detector
+         * @param detector Detector to deposit charges in
+         * @param position Global position of the particle source
+         * @param direction Global direction of the particle, normalized
+         * @param random_generator Random generator of the event
+         * @param charges List the deposited charges are added to
+         * @param mcparticles List the generated particle is added to, needs to have reserved memory for it
+         */
+        void deposit_track(const std::shared_ptr<Detector>& detector,
+                           const ROOT::Math::XYZPoint& position,
+                           const ROOT::Math::XYZVector& direction,
+                           std::mt19937_64& random_generator,
+                           std::vector<DepositedCharge>& charges,
+                           std::vector<MCParticle>& mcparticles) const;
+
+        /**
+         * @brief Calculate the most probable energy loss in silicon
+         * @param path_length Length of the path through the sensor
+         * @return Most probable energy loss and width of the Landau distribution
+         */
+        std::pair<double, double> most_probable_energy_loss(double path_length) const;
+
+        GeometryManager* geo_manager_;
+        Messenger* messenger_;
+
+        std::mt19937_64 random_generator_;
+
+        // Detectors with a listener for the deposits or particles, and their index in this list
+        std::vector<std::shared_ptr<Detector>> detectors_;
+        std::map<const Detector*, size_t> detector_index_;
+
+        // Properties of the particles shot in every event
+        ROOT::Math::XYZPoint source_position_;
+        ROOT::Math::XYZVector beam_direction_;
+        ROOT::Math::XYZVector beam_axis_u_, beam_axis_v_;
+        double beam_size_{};
+        unsigned int number_of_particles_{};
+        int particle_code_{};
+        double particle_mass_{};
+        double beta_{}, beta_gamma_{};
+        double max_energy_transfer_{};
+
+        double charge_creation_energy_{};
+        double fano_factor_{};
+        double max_step_length_{};
+    };
+} // namespace allpix
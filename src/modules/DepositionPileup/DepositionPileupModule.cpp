@@ -0,0 +1,181 @@
+/**
+ * @file
+ * @brief Implementation of a module to overlay cached minimum-bias deposits on the deposits of an event
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "DepositionPileupModule.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TBranch.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include "core/config/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+DepositionPileupModule::DepositionPileupModule(Configuration& config,
+                                               Messenger* messenger,
+                                               std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Seed the random generator with the global seed
+    random_generator_.seed(getRandomSeed());
+
+    // The library is only read after initialization, such that several events can be processed at the same time
+    enable_event_parallelization();
+
+    // Set defaults for the pileup
+    config_.setDefault("pileup_mean", 1.);
+    config_.setDefaultArray<double>("time_window", {-Units::get(25., "ns"), Units::get(25., "ns")});
+    config_.setDefault("random_shift", true);
+    config_.setDefault("library_events", 0);
+
+    // The signal deposits are optional, such that events with pileup only can be simulated
+    messenger_->bindSingle(this, &DepositionPileupModule::deposits_message_);
+}
+
+void DepositionPileupModule::init() {
+    geometry_ = detector_->getGeometryView();
+
+    // The module would receive its own deposits if the signal is read with the same name
+    if(config_.get<std::string>("input") == config_.get<std::string>("output")) {
+        throw InvalidCombinationError(config_,
+                                      {"input", "output"},
+                                      "the signal deposits have to be read with a different name than the one of the "
+                                      "overlaid deposits");
+    }
+
+    pileup_mean_ = config_.get<double>("pileup_mean");
+    if(pileup_mean_ < 0) {
+        throw InvalidValueError(config_, "pileup_mean", "mean number of pileup events cannot be negative");
+    }
+    auto time_window = config_.getArray<double>("time_window");
+    if(time_window.size() != 2 || time_window[0] > time_window[1]) {
+        throw InvalidValueError(config_, "time_window", "time window has to be given as increasing start and end time");
+    }
+    time_window_min_ = time_window[0];
+    time_window_max_ = time_window[1];
+    random_shift_ = config_.get<bool>("random_shift");
+
+    // Read the deposits of the detector from the tree written by the ROOTObjectWriter
+    auto file_name = config_.getPathWithExtension("file_name", "root", true);
+    auto input_file = std::make_unique<TFile>(file_name.c_str());
+    TTree* tree = nullptr;
+    input_file->GetObject("DepositedCharge", tree);
+    if(tree == nullptr) {
+        throw InvalidValueError(config_, "file_name", "file does not contain a tree of DepositedCharge objects");
+    }
+    auto branch_name = config_.get<std::string>("branch_name", detector_->getName());
+    auto* branch = tree->GetBranch(branch_name.c_str());
+    if(branch == nullptr) {
+        throw InvalidValueError(config_, "branch_name", "tree of DepositedCharge objects has no branch " + branch_name);
+    }
+
+    auto* objects = new std::vector<Object*>;
+    branch->SetAddress(&objects);
+    auto entries = static_cast<unsigned long>(tree->GetEntries());
+    auto library_events = config_.get<unsigned long>("library_events");
+    if(library_events > 0 && library_events < entries) {
+        entries = library_events;
+    }
+    for(unsigned long entry = 0; entry < entries; ++entry) {
+        branch->GetEntry(static_cast<Long64_t>(entry));
+
+        // Keep empty events in the library, they represent interactions without any deposit in the sensor
+        library_offsets_.push_back(library_deposits_.size());
+        for(auto* object : *objects) {
+            auto* deposit = static_cast<DepositedCharge*>(object);
+            library_deposits_.push_back(
+                {deposit->getLocalPosition(), deposit->getType(), deposit->getCharge(), deposit->getEventTime()});
+        }
+    }
+    library_offsets_.push_back(library_deposits_.size());
+    branch->ResetAddress();
+    for(auto* object : *objects) {
+        delete object;
+    }
+    delete objects;
+    input_file->Close();
+
+    if(entries == 0) {
+        throw InvalidValueError(config_, "file_name", "library does not contain any minimum-bias event");
+    }
+    LOG(INFO) << "Loaded pileup library of " << entries << " events for detector " << detector_->getName();
+    LOG(DEBUG) << "Pileup library holds " << library_deposits_.size() << " deposits";
+}
+
+void DepositionPileupModule::run(unsigned int) {
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
+
+    // Start from a copy of the signal deposits, which keep their link to the Monte-Carlo particles
+    auto deposits = MessageDataPool<DepositedCharge>::acquire();
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this);
+    if(deposits_message != nullptr) {
+        deposits.insert(deposits.end(), deposits_message->getData().begin(), deposits_message->getData().end());
+    }
+    auto signal_deposits = deposits.size();
+
+    auto pileup_events = std::poisson_distribution<unsigned int>(pileup_mean_)(random_generator);
+    std::uniform_int_distribution<size_t> library_event(0, library_offsets_.size() - 2);
+    std::uniform_real_distribution<double> time_offset(time_window_min_, time_window_max_);
+    const auto& npixels = geometry_.getNPixels();
+    std::uniform_int_distribution<int> shift_x(0, npixels[0] - 1);
+    std::uniform_int_distribution<int> shift_y(0, npixels[1] - 1);
+    for(unsigned int i = 0; i < pileup_events; ++i) {
+        auto event = library_event(random_generator);
+        auto offset = time_offset(random_generator);
+        auto dx = (random_shift_ ? shift_x(random_generator) : 0);
+        auto dy = (random_shift_ ? shift_y(random_generator) : 0);
+
+        for(auto index = library_offsets_[event]; index < library_offsets_[event + 1]; ++index) {
+            const auto& cached = library_deposits_[index];
+            auto local_position = cached.local_position;
+
+            // Move the deposit to the shifted pixel, wrapping around the pixel grid to keep its position within the pixel
+            if(random_shift_) {
+                auto pixel = geometry_.getPixel(local_position);
+                if(geometry_.isWithinPixelGrid(pixel.first, pixel.second)) {
+                    auto center = geometry_.getPixelCenter(pixel.first, pixel.second);
+                    auto shifted =
+                        geometry_.getPixelCenter((pixel.first + dx) % npixels[0], (pixel.second + dy) % npixels[1]);
+                    local_position += shifted - center;
+                }
+            }
+            if(!detector_->isWithinSensor(local_position)) {
+                continue;
+            }
+            deposits.emplace_back(local_position,
+                                  detector_->getGlobalPosition(local_position),
+                                  cached.type,
+                                  cached.charge,
+                                  cached.time + offset);
+        }
+    }
+
+    LOG(DEBUG) << "Overlaid " << (deposits.size() - signal_deposits) << " deposits of " << pileup_events
+               << " pileup events on " << signal_deposits << " signal deposits";
+    total_pileup_events_ += pileup_events;
+    total_pileup_deposits_ += deposits.size() - signal_deposits;
+
+    auto message = std::make_shared<DepositedChargeMessage>(std::move(deposits), detector_);
+    messenger_->dispatchMessage(this, message);
+}
+
+void DepositionPileupModule::finalize() {
+    LOG(INFO) << "Overlaid total of " << total_pileup_deposits_ << " deposits from " << total_pileup_events_
+              << " pileup events";
+}
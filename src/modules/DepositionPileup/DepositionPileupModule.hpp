@@ -0,0 +1,100 @@
+/**
+ * @file
+ * @brief Definition of a module to overlay cached minimum-bias deposits on the deposits of an event
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_DEPOSITION_PILEUP_MODULE_H
+#define ALLPIX_DEPOSITION_PILEUP_MODULE_H
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorGeometryView.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to overlay pileup deposits from a library of minimum-bias events on the deposits of every event
+     * @note This module supports parallelization
+     *
+     * The deposits of the minimum-bias events are read once from a file written by the ROOTObjectWriter and kept in memory.
+     * For every event, a number of library events drawn from a Poisson distribution is overlaid on the signal deposits,
+     * each shifted by a random time offset and optionally by a random number of pixels. The overlaid deposits are not linked
+     * to any Monte-Carlo particle.
+     */
+    class DepositionPileupModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        DepositionPileupModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Read the deposits of all minimum-bias events of the library into memory
+         */
+        void init() override;
+
+        /**
+         * @brief Overlay the pileup deposits on the signal deposits of the event
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Display statistical summary
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+        std::shared_ptr<Detector> detector_;
+        DetectorGeometryView geometry_;
+
+        // Random generator used if the modules are not seeded for every event
+        std::mt19937_64 random_generator_;
+
+        // Message containing the signal deposits of the event, if any
+        std::shared_ptr<DepositedChargeMessage> deposits_message_;
+
+        /**
+         * @brief Deposit of the library, holding only the information needed to create the overlaid deposit
+         */
+        struct CachedDeposit {
+            ROOT::Math::XYZPoint local_position;
+            CarrierType type;
+            unsigned int charge;
+            double time;
+        };
+
+        // Deposits of all library events, the deposits of an event start at its offset
+        std::vector<CachedDeposit> library_deposits_;
+        std::vector<size_t> library_offsets_;
+
+        double pileup_mean_{};
+        double time_window_min_{};
+        double time_window_max_{};
+        bool random_shift_{};
+
+        // Statistical information
+        std::atomic<unsigned long> total_pileup_events_{};
+        std::atomic<unsigned long> total_pileup_deposits_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DEPOSITION_PILEUP_MODULE_H */
@@ -36,6 +36,7 @@ DepositionPointChargeModule::DepositionPointChargeModule(Configuration& config,
     config_.setDefault("number_of_steps", 100);
     config_.setDefault("position", ROOT::Math::XYZPoint(0., 0., 0.));
     config_.setDefault("source_type", "point");
+    config_.setDefault("voxels_per_event", 1);
 
     // Read type:
     auto type = config_.get<std::string>("source_type");
@@ -62,6 +63,16 @@ DepositionPointChargeModule::DepositionPointChargeModule(Configuration& config,
         throw InvalidValueError(
             config_, "model", "Invalid deposition model, only 'fixed', 'scan' and 'spot' are supported.");
     }
+
+    // Number of voxels scanned in every event
+    voxels_per_event_ = config_.get<unsigned int>("voxels_per_event");
+    if(voxels_per_event_ == 0) {
+        throw InvalidValueError(config_, "voxels_per_event", "at least one voxel has to be scanned per event");
+    }
+    if(voxels_per_event_ > 1 && model_ != DepositionModel::SCAN) {
+        LOG(WARNING) << "Multiple voxels per event are only scanned in the 'scan' model, ignoring";
+        voxels_per_event_ = 1;
+    }
 }
 
 void DepositionPointChargeModule::init() {
@@ -84,15 +95,16 @@ void DepositionPointChargeModule::init() {
 
     // Set up the different scan methods
     if(model_ == DepositionModel::SCAN) {
-        // Get the config manager and retrieve total number of events:
+        // Get the config manager and retrieve total number of events, every event scans a fixed number of voxels:
         ConfigManager* conf_manager = getConfigManager();
-        auto events = conf_manager->getGlobalConfiguration().get<unsigned int>("number_of_events");
+        auto events = conf_manager->getGlobalConfiguration().get<unsigned int>("number_of_events") * voxels_per_event_;
+        std::string scanned = (voxels_per_event_ > 1 ? "Number of events times voxels per event" : "Number of events");
 
         // Scan with points required 3D scanning, scan with MIPs only 2D:
         if(type_ == SourceType::MIP) {
             root_ = static_cast<unsigned int>(std::round(std::sqrt(events)));
             if(events != root_ * root_) {
-                LOG(WARNING) << "Number of events is not a square, pixel cell volume cannot fully be covered in scan. "
+                LOG(WARNING) << scanned << " is not a square, pixel cell volume cannot fully be covered in scan. "
                              << "Closest square is " << root_ * root_;
             }
             // Calculate voxel size:
@@ -101,7 +113,7 @@ void DepositionPointChargeModule::init() {
         } else {
             root_ = static_cast<unsigned int>(std::round(std::cbrt(events)));
             if(events != root_ * root_ * root_) {
-                LOG(WARNING) << "Number of events is not a cube, pixel cell volume cannot fully be covered in scan. "
+                LOG(WARNING) << scanned << " is not a cube, pixel cell volume cannot fully be covered in scan. "
                              << "Closest cube is " << root_ * root_ * root_;
             }
             // Calculate voxel size:
@@ -109,12 +121,19 @@ void DepositionPointChargeModule::init() {
                 model->getPixelSize().x() / root_, model->getPixelSize().y() / root_, model->getSensorSize().z() / root_);
         }
         LOG(INFO) << "Voxel size for scan of pixel volume: " << Units::display(voxel_, {"um", "mm"});
+        if(voxels_per_event_ > 1) {
+            LOG(INFO) << "Scanning " << voxels_per_event_ << " voxels per event";
+        }
     }
 }
 
 void DepositionPointChargeModule::run(unsigned int event) {
+    // Seed the random generator for this event if the modules are seeded for every event
+    if(has_event_seeding()) {
+        random_generator_.seed(getEventSeed());
+    }
 
-    ROOT::Math::XYZPoint position;
+    std::vector<ROOT::Math::XYZPoint> positions;
     auto model = detector_->getModel();
 
     auto get_position = [&]() {
@@ -128,7 +147,7 @@ void DepositionPointChargeModule::run(unsigned int event) {
 
     if(model_ == DepositionModel::FIXED) {
         // Fixed position as read from the configuration:
-        position = get_position();
+        positions.push_back(get_position());
     } else if(model_ == DepositionModel::SCAN) {
         // Center the volume to be scanned in the center of the sensor,
         // reference point is lower left corner of one pixel volume
@@ -136,10 +155,14 @@ void DepositionPointChargeModule::run(unsigned int event) {
                    ROOT::Math::XYZVector(
                        model->getPixelSize().x() / 2.0, model->getPixelSize().y() / 2.0, model->getSensorSize().z() / 2.0);
         LOG(DEBUG) << "Reference: " << ref;
-        position = ROOT::Math::XYZPoint(voxel_.x() * ((event - 1) % root_),
-                                        voxel_.y() * (((event - 1) / root_) % root_),
-                                        voxel_.z() * (((event - 1) / root_ / root_) % root_)) +
-                   ref;
+
+        // Scan the consecutive voxels belonging to this event
+        for(unsigned int voxel = (event - 1) * voxels_per_event_; voxel < event * voxels_per_event_; ++voxel) {
+            positions.push_back(ROOT::Math::XYZPoint(voxel_.x() * (voxel % root_),
+                                                     voxel_.y() * ((voxel / root_) % root_),
+                                                     voxel_.z() * ((voxel / root_ / root_) % root_)) +
+                                ref);
+        }
     } else {
         // Calculate random offset from configured position
         auto shift = [&](auto size) {
@@ -150,22 +173,38 @@ void DepositionPointChargeModule::run(unsigned int event) {
         };
 
         // Spot around the configured position
-        position = get_position() + shift(config_.get<double>("spot_size"));
-    }
-
-    // Create charge carriers at requested position
-    if(type_ == SourceType::MIP) {
-        DepositLine(position);
-    } else {
-        DepositPoint(position);
+        positions.push_back(get_position() + shift(config_.get<double>("spot_size")));
     }
-}
 
-void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& position) {
-    // Vector of deposited charges and their "MCParticle"
+    // Vector of deposited charges and their "MCParticle", reserved such that the deposits can refer to their particle
     std::vector<DepositedCharge> charges;
     std::vector<MCParticle> mcparticles;
+    mcparticles.reserve(positions.size());
+
+    // Create charge carriers at requested positions
+    for(auto& position : positions) {
+        if(type_ == SourceType::MIP) {
+            DepositLine(position, charges, mcparticles);
+        } else {
+            DepositPoint(position, charges, mcparticles);
+        }
+    }
+
+    // Dispatch the messages to the framework if any charge carrier has been deposited
+    if(mcparticles.empty()) {
+        return;
+    }
 
+    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
+    messenger_->dispatchMessage(this, mcparticle_message);
+
+    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
+    messenger_->dispatchMessage(this, deposit_message);
+}
+
+void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& position,
+                                               std::vector<DepositedCharge>& charges,
+                                               std::vector<MCParticle>& mcparticles) {
     LOG(DEBUG) << "Position (local coordinates): " << Units::display(position, {"um", "mm"});
     // Cross-check calculated position to be within sensor:
     if(!detector_->isWithinSensor(position)) {
@@ -185,21 +224,13 @@ void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& posit
     LOG(DEBUG) << "Deposited " << carriers_ << " charge carriers of both types at global position "
                << Units::display(position_global, {"um", "mm"}) << " in detector " << detector_->getName();
 
-    // Dispatch the messages to the framework
-    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
-    messenger_->dispatchMessage(this, mcparticle_message);
-
-    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
-    messenger_->dispatchMessage(this, deposit_message);
 }
 
-void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& position) {
+void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& position,
+                                              std::vector<DepositedCharge>& charges,
+                                              std::vector<MCParticle>& mcparticles) {
     auto model = detector_->getModel();
 
-    // Vector of deposited charges and their "MCParticle"
-    std::vector<DepositedCharge> charges;
-    std::vector<MCParticle> mcparticles;
-
     // Cross-check calculated position to be within sensor:
     if(!detector_->isWithinSensor(ROOT::Math::XYZPoint(position.x(), position.y(), 0))) {
         LOG(DEBUG) << "Requested position is outside active sensor volume.";
@@ -229,10 +260,4 @@ void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& positi
                    << Units::display(position_global, {"um", "mm"}) << " in detector " << detector_->getName();
     }
 
-    // Dispatch the messages to the framework
-    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
-    messenger_->dispatchMessage(this, mcparticle_message);
-
-    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
-    messenger_->dispatchMessage(this, deposit_message);
 }
@@ -8,8 +8,11 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "core/module/Module.hpp"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
 
 namespace allpix {
     /**
@@ -60,15 +63,23 @@ namespace allpix {
     private:
         /**
          * @brief Helper function to deposit charges at a single point
-         * @param event event number
+         * @param position Local position of the deposition
+         * @param charges List the deposited charges are added to
+         * @param mcparticles List the generated particle is added to, needs to have reserved memory for it
          */
-        void DepositPoint(const ROOT::Math::XYZPoint& position);
+        void DepositPoint(const ROOT::Math::XYZPoint& position,
+                          std::vector<DepositedCharge>& charges,
+                          std::vector<MCParticle>& mcparticles);
 
         /**
          * @brief Helper function to deposit charges along a line
-         * @param event event number
+         * @param position Local position of the line in the sensor plane
+         * @param charges List the deposited charges are added to
+         * @param mcparticles List the generated particle is added to, needs to have reserved memory for it
          */
-        void DepositLine(const ROOT::Math::XYZPoint& position);
+        void DepositLine(const ROOT::Math::XYZPoint& position,
+                         std::vector<DepositedCharge>& charges,
+                         std::vector<MCParticle>& mcparticles);
 
         std::shared_ptr<Detector> detector_;
         Messenger* messenger_;
@@ -81,5 +92,6 @@ namespace allpix {
         ROOT::Math::XYZVector voxel_;
         double step_size_z_{};
         unsigned int root_{}, carriers_{};
+        unsigned int voxels_per_event_{};
     };
 } // namespace allpix
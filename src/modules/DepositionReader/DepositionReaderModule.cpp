@@ -10,13 +10,82 @@
 
 #include "DepositionReaderModule.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <TROOT.h>
+
 #include "core/utils/log.h"
 
 using namespace allpix;
 
+namespace {
+    // Whitespace trimmed from lines and values of CSV files
+    bool is_whitespace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v';
+    }
+    void trim(const char*& begin, const char*& end) {
+        while(begin < end && is_whitespace(*begin)) {
+            ++begin;
+        }
+        while(end > begin && is_whitespace(*(end - 1))) {
+            --end;
+        }
+    }
+
+    /**
+     * @brief Get the next comma-separated value of a line and advance to the following value
+     * @return Boundaries of the value, trimmed of whitespace
+     */
+    std::pair<const char*, const char*> next_value(const char*& position, const char* line_end) {
+        const auto* begin = position;
+        const auto* end = static_cast<const char*>(std::memchr(begin, ',', static_cast<size_t>(line_end - begin)));
+        if(end == nullptr) {
+            end = line_end;
+            position = line_end;
+        } else {
+            position = end + 1;
+        }
+        trim(begin, end);
+        return {begin, end};
+    }
+
+    // Event number of an event header line, following the header keyword
+    unsigned int parse_event_header(const char* begin, const char* end) {
+        while(begin < end && !is_whitespace(*begin)) {
+            ++begin;
+        }
+        return static_cast<unsigned int>(begin == end ? 0 : std::strtoul(begin, nullptr, 10));
+    }
+
+    // Size and modification time of a file to check if an index file belongs to it
+    bool get_file_stat(const std::string& path, std::uint64_t& size, std::int64_t& mtime) {
+        struct stat file_stat {};
+        if(stat(path.c_str(), &file_stat) != 0) {
+            return false;
+        }
+        size = static_cast<std::uint64_t>(file_stat.st_size);
+        mtime = static_cast<std::int64_t>(file_stat.st_mtime);
+        return true;
+    }
+
+    // Conversion of values, which are terminated by a comma or line break, empty values are converted to zero
+    double to_double(const std::pair<const char*, const char*>& value) {
+        return (value.first == value.second ? 0 : std::strtod(value.first, nullptr));
+    }
+    int to_int(const std::pair<const char*, const char*>& value) {
+        return (value.first == value.second ? 0 : static_cast<int>(std::strtol(value.first, nullptr, 10)));
+    }
+} // namespace
+
 DepositionReaderModule::DepositionReaderModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
     : Module(config), geo_manager_(geo_manager), messenger_(messenger) {
 
@@ -42,6 +111,11 @@ DepositionReaderModule::DepositionReaderModule(Configuration& config, Messenger*
                                           "track_id",
                                           "parent_id"});
 
+    config_.setDefault<std::uint64_t>("event_offset", 0);
+    config_.setDefault<bool>("event_index", false);
+    config_.setDefault<bool>("prefetch_events", false);
+    config_.setDefault<double>("time_slice", 0);
+
     config_.setDefault<bool>("output_plots", false);
     config_.setDefault<int>("output_plots_scale", Units::get(100, "ke"));
 
@@ -50,9 +124,10 @@ DepositionReaderModule::DepositionReaderModule(Configuration& config, Messenger*
     fano_factor_ = config_.get<double>("fano_factor");
     volume_chars_ = config_.get<size_t>("detector_name_chars");
 
-    unit_length_ = config_.get<std::string>("unit_length");
-    unit_time_ = config_.get<std::string>("unit_time");
-    unit_energy_ = config_.get<std::string>("unit_energy");
+    // Convert the units once instead of parsing them for every deposit
+    unit_length_ = Units::get(config_.get<std::string>("unit_length"));
+    unit_time_ = Units::get(config_.get<std::string>("unit_time"));
+    unit_energy_ = Units::get(config_.get<std::string>("unit_energy"));
 }
 
 void DepositionReaderModule::init() {
@@ -62,14 +137,28 @@ void DepositionReaderModule::init() {
     std::transform(file_model_.begin(), file_model_.end(), file_model_.begin(), ::tolower);
     if(file_model_ == "csv") {
         // Open the file with the objects
-        auto file_path = config_.getPathWithExtension("file_name", "csv", true);
-        input_file_ = std::make_unique<std::ifstream>(file_path);
-        if(!input_file_->is_open()) {
-            throw InvalidValueError(config_, "file_name", "could not open input file");
+        file_path_ = config_.getPathWithExtension("file_name", "csv", true);
+        map_input_file(file_path_);
+    } else if(file_model_ == "binary") {
+        file_path_ = config_.getPathWithExtension("file_name", "bin", true);
+        map_input_file(file_path_);
+
+        // Check the header of the file
+        BinaryHeader header{};
+        if(input_size_ < sizeof(header)) {
+            throw InvalidValueError(config_, "file_name", "file does not contain a valid header");
         }
+        std::memcpy(&header, input_data_.get(), sizeof(header));
+        if(std::memcmp(header.magic, binary_magic, sizeof(binary_magic)) != 0 || header.version != binary_version ||
+           header.record_size != sizeof(BinaryRecord)) {
+            throw InvalidValueError(config_, "file_name", "file is not a binary deposit file of a supported version");
+        }
+        input_offset_ = sizeof(header);
+        LOG(INFO) << "Mapped binary deposit file with " << (input_size_ - input_offset_) / sizeof(BinaryRecord)
+                  << " deposits";
     } else if(file_model_ == "root") {
-        auto file_path = config_.getPathWithExtension("file_name", "root", true);
-        input_file_root_ = std::make_unique<TFile>(file_path.c_str(), "READ");
+        file_path_ = config_.getPathWithExtension("file_name", "root", true);
+        input_file_root_ = std::make_unique<TFile>(file_path_.c_str(), "READ");
         if(!input_file_root_->IsOpen()) {
             throw InvalidValueError(config_, "file_name", "could not open input file");
         }
@@ -115,11 +204,62 @@ void DepositionReaderModule::init() {
         check_tree_reader(pdg_code_);
         check_tree_reader(track_id_);
         check_tree_reader(parent_id_);
+
+        // Cache the baskets of all branches read, skipping the learning phase of the cache
+        auto* input_tree = tree_reader_->GetTree();
+        if(config_.has("cache_size") && input_tree != nullptr) {
+            input_tree->SetCacheSize(config_.get<long long>("cache_size"));
+            for(auto& branch : branches) {
+                input_tree->AddBranchToCache(branch.c_str(), true);
+            }
+            input_tree->StopCacheLearningPhase();
+        }
     } else {
-        throw InvalidValueError(config_, "model", "only models 'root' and 'csv' are currently supported");
+        throw InvalidValueError(config_, "model", "only models 'root', 'csv' and 'binary' are currently supported");
+    }
+
+    // Move to the first event to read
+    event_offset_ = config_.get<std::uint64_t>("event_offset");
+    seek_event(event_offset_);
+
+    // Intern the names of all detectors, the views refer to the names stored in the list which is not modified afterwards
+    detectors_ = geo_manager_->getDetectors();
+    for(auto& detector : detectors_) {
+        detector_names_.push_back(detector->getName());
+    }
+    for(size_t id = 0; id < detector_names_.size(); ++id) {
+        detector_ids_.emplace(detector_names_[id], id);
+    }
+
+    // Read the deposits of the next event on the thread of the asynchronous tasks while the current event is processed
+    current_deposits_ = std::make_unique<EventDeposits>();
+    staged_deposits_ = std::make_unique<EventDeposits>();
+    prefetch_events_ = config_.get<bool>("prefetch_events");
+
+    // Divide the input into time slices of fixed length instead of reading one input event per event
+    time_slice_ = config_.get<double>("time_slice");
+    if(time_slice_ < 0) {
+        throw InvalidValueError(config_, "time_slice", "length of the time slices should not be negative");
+    }
+    if(time_slice_ > 0) {
+        if(prefetch_events_) {
+            throw InvalidCombinationError(
+                config_, {"time_slice", "prefetch_events"}, "input events cannot be read ahead for time slices");
+        }
+        last_input_time_ = -std::numeric_limits<double>::infinity();
+        pending_deposits_.input_position = get_input_position();
+        LOG(INFO) << "Dividing the input into time slices of " << Units::display(time_slice_, {"ns", "us", "ms"});
+    }
+    if(prefetch_events_) {
+        if(file_model_ == "root") {
+            // The tree is read by another thread than the one executing the module
+            ROOT::EnableThreadSafety();
+        }
+        LOG(DEBUG) << "Reading the deposits of the next event asynchronously";
+        enable_async_tasks(1);
     }
 
-    for(auto& detector : geo_manager_->getDetectors()) {
+    for(auto& detector : detectors_) {
         // If requested, prepare output plots
         if(config_.get<bool>("output_plots")) {
             LOG(TRACE) << "Creating output plots";
@@ -136,6 +276,179 @@ void DepositionReaderModule::init() {
     }
 }
 
+void DepositionReaderModule::map_input_file(const std::string& file_path) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw InvalidValueError(config_, "file_name", "could not open input file");
+    }
+    struct stat file_stat {};
+    if(fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw InvalidValueError(config_, "file_name", "could not open input file");
+    }
+
+    // Empty files cannot be mapped, but contain no events anyway
+    input_size_ = static_cast<size_t>(file_stat.st_size);
+    input_offset_ = 0;
+    if(input_size_ == 0) {
+        close(fd);
+        input_data_.reset();
+        return;
+    }
+
+    void* mapping = mmap(nullptr, input_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) { // NOLINT
+        throw InvalidValueError(config_, "file_name", "could not map input file into memory");
+    }
+    // The file is read once from the beginning to the end
+    madvise(mapping, input_size_, MADV_SEQUENTIAL);
+
+    auto size = input_size_;
+    input_data_ = std::shared_ptr<const char>(static_cast<const char*>(mapping),
+                                              [size](const char* ptr) { munmap(const_cast<char*>(ptr), size); });
+}
+
+/**
+ * Binary files are searched by bisection of the records. For the other formats, the positions of the events are read from
+ * the index file if enabled, or the index file is created from a scan of the full input file. Without index file, the input
+ * file is only scanned up to the requested event.
+ */
+void DepositionReaderModule::seek_event(std::uint64_t file_event) {
+    if(file_model_ == "binary") {
+        if(file_event == 0) {
+            return;
+        }
+        const auto* records = reinterpret_cast<const BinaryRecord*>(input_data_.get() + sizeof(BinaryHeader));
+        auto count = (input_size_ - sizeof(BinaryHeader)) / sizeof(BinaryRecord);
+        const auto* first = std::partition_point(records, records + count, [&](const BinaryRecord& record) {
+            return static_cast<unsigned int>(record.event) < file_event;
+        });
+        input_offset_ = sizeof(BinaryHeader) + static_cast<size_t>(first - records) * sizeof(BinaryRecord);
+        LOG(INFO) << "Skipped " << (first - records) << " deposits before event " << file_event;
+        return;
+    }
+
+    EventIndex index;
+    if(config_.get<bool>("event_index")) {
+        if(read_index(index)) {
+            LOG(INFO) << "Read positions of " << index.size() << " events from index file";
+        } else {
+            index = scan_events();
+            write_index(index);
+        }
+    } else if(file_event > 0) {
+        index = scan_events(file_event);
+    }
+    if(file_event == 0) {
+        return;
+    }
+
+    auto iter = std::lower_bound(index.begin(), index.end(), file_event, [](const auto& entry, std::uint64_t event) {
+        return entry.first < event;
+    });
+    if(file_model_ == "csv") {
+        input_offset_ = (iter == index.end() ? input_size_ : static_cast<size_t>(iter->second));
+    } else if(file_model_ == "root") {
+        auto entry = (iter == index.end() ? static_cast<std::uint64_t>(tree_reader_->GetEntries(false)) : iter->second);
+        tree_reader_->SetEntry(static_cast<Long64_t>(entry));
+    }
+    LOG(INFO) << "Moved input to event " << (iter == index.end() ? file_event : iter->first);
+}
+
+DepositionReaderModule::EventIndex DepositionReaderModule::scan_events(std::uint64_t last_event) {
+    LOG(DEBUG) << "Scanning input file for the positions of the events";
+    EventIndex index;
+    if(file_model_ == "csv") {
+        // Collect the positions of the event headers
+        const char* data = input_data_.get();
+        size_t offset = 0;
+        while(offset < input_size_) {
+            const auto* newline = static_cast<const char*>(std::memchr(data + offset, '\n', input_size_ - offset));
+            if(newline == nullptr) {
+                break;
+            }
+            const auto* line_begin = data + offset;
+            const auto* line_end = newline;
+            trim(line_begin, line_end);
+            if(line_begin != line_end && *line_begin == 'E') {
+                auto event = parse_event_header(line_begin, line_end);
+                index.emplace_back(event, offset);
+                if(event >= last_event) {
+                    break;
+                }
+            }
+            offset = static_cast<size_t>(newline - data) + 1;
+        }
+    } else if(file_model_ == "root") {
+        // Only read the branch with the event number and collect the first entry of every event
+        TTreeReader reader(config_.get<std::string>("tree_name").c_str(), input_file_root_.get());
+        TTreeReaderValue<int> event_number(reader, config_.getArray<std::string>("branch_names").at(0).c_str());
+        while(reader.Next()) {
+            auto event = static_cast<unsigned int>(*event_number.Get());
+            if(index.empty() || index.back().first != event) {
+                index.emplace_back(event, reader.GetCurrentEntry());
+                if(event >= last_event) {
+                    break;
+                }
+            }
+        }
+    }
+    return index;
+}
+
+bool DepositionReaderModule::read_index(EventIndex& index) const {
+    auto index_file = file_path_ + ".index";
+    std::ifstream file(index_file, std::ios::binary);
+    if(!file) {
+        return false;
+    }
+
+    IndexHeader header{};
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, index_magic, sizeof(header.magic)) != 0 || !get_file_stat(file_path_, size, mtime) ||
+       header.source_size != size || header.source_mtime != mtime) {
+        LOG(INFO) << "Index file \"" << index_file << "\" does not match input file, scanning input file";
+        return false;
+    }
+
+    index.resize(header.events);
+    for(auto& entry : index) {
+        std::uint64_t values[2];
+        if(!file.read(reinterpret_cast<char*>(values), sizeof(values))) {
+            LOG(WARNING) << "Index file \"" << index_file << "\" is incomplete, scanning input file";
+            index.clear();
+            return false;
+        }
+        entry = {values[0], values[1]};
+    }
+    return true;
+}
+
+void DepositionReaderModule::write_index(const EventIndex& index) const {
+    auto index_file = file_path_ + ".index";
+    IndexHeader header{};
+    std::memcpy(header.magic, index_magic, sizeof(header.magic));
+    if(!get_file_stat(file_path_, header.source_size, header.source_mtime)) {
+        return;
+    }
+    header.events = index.size();
+
+    std::ofstream file(index_file, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(const auto& entry : index) {
+        std::uint64_t values[2] = {entry.first, entry.second};
+        file.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+    if(!file.good()) {
+        LOG(WARNING) << "Could not write index file \"" << index_file << "\"";
+        return;
+    }
+    LOG(INFO) << "Stored positions of " << index.size() << " events in index file \"" << index_file << "\"";
+}
+
 template <typename T>
 void DepositionReaderModule::create_tree_reader(std::shared_ptr<T>& branch_ptr, const std::string& name) {
     branch_ptr = std::make_shared<T>(*tree_reader_, name.c_str());
@@ -148,51 +461,185 @@ template <typename T> void DepositionReaderModule::check_tree_reader(std::shared
     }
 }
 
-void DepositionReaderModule::run(unsigned int event) {
+size_t DepositionReaderModule::find_detector(std::string_view volume) const {
+    // Select the detector name from the volume name
+    if(volume_chars_ != 0) {
+        volume = volume.substr(0, volume_chars_);
+    }
 
-    // Set of deposited charges in this event
-    std::map<std::shared_ptr<Detector>, std::vector<DepositedCharge>> deposits;
-    std::map<std::shared_ptr<Detector>, std::vector<MCParticle>> mc_particles;
-    std::map<std::shared_ptr<Detector>, std::vector<int>> particles_to_deposits;
-    std::map<std::shared_ptr<Detector>, std::map<int, size_t>> track_id_to_mcparticle;
+    auto id = detector_ids_.find(volume);
+    if(id == detector_ids_.end()) {
+        LOG(TRACE) << "Ignored detector \"" << volume << "\", not found in current simulation";
+        return unknown_detector;
+    }
+    return id->second;
+}
 
-    LOG(DEBUG) << "Start reading event " << event;
-    bool end_of_run = false;
-    std::string eof_message;
+/**
+ * The deposits of an event are read until the next event starts or the end of the input file is reached. The end of the run
+ * is only requested after the deposits read so far have been dispatched.
+ */
+void DepositionReaderModule::read_event(unsigned int event_num, EventDeposits& deposits) {
+    deposits.clear();
+    deposits.input_position = get_input_position();
+    if(file_model_ == "root") {
+        read_root_event(event_num, deposits);
+        return;
+    }
 
-    do {
-        bool read_status = false;
-        ROOT::Math::XYZPoint global_deposit_position;
-        std::string volume;
-        double energy, time;
-        int pdg_code, track_id, parent_id;
+    try {
+        do {
+            ROOT::Math::XYZPoint position;
+            size_t detector = unknown_detector;
+            double energy, time;
+            int pdg_code, track_id, parent_id;
 
-        try {
+            bool read_status = false;
             if(file_model_ == "csv") {
-                read_status = read_csv(event, volume, global_deposit_position, time, energy, pdg_code, track_id, parent_id);
-            } else if(file_model_ == "root") {
-                read_status = read_root(event, volume, global_deposit_position, time, energy, pdg_code, track_id, parent_id);
+                read_status = read_csv(event_num, detector, position, time, energy, pdg_code, track_id, parent_id);
+            } else if(file_model_ == "binary") {
+                read_status = read_binary(event_num, detector, position, time, energy, pdg_code, track_id, parent_id);
+            }
+            if(!read_status) {
+                break;
+            }
+            if(detector == unknown_detector) {
+                continue;
             }
-        } catch(EndOfRunException& e) {
-            end_of_run = true;
-            eof_message = e.what();
-        }
 
-        if(!read_status || end_of_run) {
-            break;
+            deposits.detector.push_back(detector);
+            deposits.position_x.push_back(position.x());
+            deposits.position_y.push_back(position.y());
+            deposits.position_z.push_back(position.z());
+            deposits.time.push_back(time);
+            deposits.energy.push_back(energy);
+            deposits.pdg_code.push_back(pdg_code);
+            deposits.track_id.push_back(track_id);
+            deposits.parent_id.push_back(parent_id);
+        } while(true);
+    } catch(EndOfRunException& e) {
+        deposits.end_of_run = e.what();
+    }
+}
+
+/**
+ * The input events are read in order until an input event starts after the end of the time slice, such that the input
+ * events have to be ordered by the time of their earliest deposit. The deposits within the slice are handed to the event
+ * with their time relative to the start of the slice, while the later deposits are kept for the following slices. Only the
+ * deposits of the input events overlapping with the current slice are thus kept in memory, independent of the length of
+ * the input.
+ */
+void DepositionReaderModule::read_time_slice(unsigned int event_num, EventDeposits& deposits) {
+    deposits.clear();
+    auto slice_begin = static_cast<double>(event_num - 1) * time_slice_;
+    auto slice_end = slice_begin + time_slice_;
+
+    // Read the input events starting before the end of the slice, using the buffer of the staged deposits
+    auto& input = *staged_deposits_;
+    while(pending_deposits_.end_of_run.empty() && last_input_time_ < slice_end) {
+        auto input_event = next_input_event_++;
+        read_event(input_event, input);
+        if(pending_deposits_.time.empty()) {
+            pending_deposits_.input_position = input.input_position;
+        }
+        pending_deposits_.end_of_run = input.end_of_run;
+        if(!input.time.empty()) {
+            last_input_time_ = *std::min_element(input.time.begin(), input.time.end());
+        }
+        for(size_t i = 0; i < input.time.size(); ++i) {
+            pending_deposits_.push_back(input, i, input_event);
         }
+    }
 
-        auto detectors = geo_manager_->getDetectors();
-        auto pos = std::find_if(detectors.begin(), detectors.end(), [volume](const std::shared_ptr<Detector>& d) {
-            return d->getName() == volume;
-        });
-        if(pos == detectors.end()) {
-            LOG(TRACE) << "Ignored detector \"" << volume << "\", not found in current simulation";
-            continue;
+    // Hand the deposits of the slice to the event, and keep the later ones for the following slices
+    input.clear();
+    size_t discarded = 0;
+    for(size_t i = 0; i < pending_deposits_.time.size(); ++i) {
+        auto time = pending_deposits_.time[i];
+        if(time >= slice_end) {
+            input.push_back(pending_deposits_, i, pending_deposits_.input_event[i]);
+        } else if(time < slice_begin) {
+            ++discarded;
+        } else {
+            deposits.push_back(pending_deposits_, i, pending_deposits_.input_event[i]);
+            deposits.time.back() -= slice_begin;
         }
+    }
+    input.input_position = (input.time.empty() ? get_input_position() : pending_deposits_.input_position);
+    input.end_of_run = pending_deposits_.end_of_run;
+    std::swap(pending_deposits_, input);
+
+    if(discarded > 0 && !resumed_time_slice_) {
+        LOG(WARNING) << "Discarded " << discarded
+                     << " deposits before the start of the time slice, the input events are not ordered in time";
+    }
+    resumed_time_slice_ = false;
+    LOG(DEBUG) << "Time slice starting at " << Units::display(slice_begin, {"ns", "us", "ms"}) << " contains "
+               << deposits.time.size() << " deposits, keeping " << pending_deposits_.time.size()
+               << " deposits for the following slices";
+
+    // End the run once all deposits of the input have been assigned to a time slice
+    if(pending_deposits_.time.empty()) {
+        deposits.end_of_run = pending_deposits_.end_of_run;
+    }
+}
+
+std::uint64_t DepositionReaderModule::get_input_position() const {
+    return (file_model_ == "root" ? static_cast<std::uint64_t>(tree_reader_->GetCurrentEntry())
+                                  : static_cast<std::uint64_t>(input_offset_));
+}
+
+void DepositionReaderModule::run(unsigned int event) {
+    // Seed the random generator for this event if the modules are seeded for every event
+    if(has_event_seeding()) {
+        random_generator_.seed(getEventSeed());
+    }
+
+    // Take over the deposits read ahead during the previous event, or read them now
+    LOG(DEBUG) << "Start reading event " << event;
+    if(time_slice_ > 0) {
+        read_time_slice(event, *current_deposits_);
+    } else if(has_staged_deposits_) {
+        wait_async_tasks();
+        std::swap(current_deposits_, staged_deposits_);
+        has_staged_deposits_ = false;
+    } else {
+        read_event(event, *current_deposits_);
+    }
+    const auto& input = *current_deposits_;
+    LOG(INFO) << "Finished reading event " << event;
+
+    // Read the next event while the current one is processed, the staged deposits are only accessed by the asynchronous task
+    if(prefetch_events_ && input.end_of_run.empty()) {
+        has_staged_deposits_ = true;
+        run_async([this, next_event = event + 1, staged = staged_deposits_.get()]() { read_event(next_event, *staged); });
+    }
+
+    // Set of deposited charges in this event, for every detector in the list of detectors
+    std::vector<std::vector<DepositedCharge>> deposits(detectors_.size());
+    std::vector<std::vector<MCParticle>> mc_particles(detectors_.size());
+    std::vector<std::vector<std::uint64_t>> particles_to_deposits(detectors_.size());
+    std::vector<std::unordered_map<std::uint64_t, size_t>> track_id_to_mcparticle(detectors_.size());
+
+    // Track ids are only unique within an input event, such that they are combined with the number of the input event
+    auto track_key = [&input](size_t deposit, int track_id) {
+        auto input_event = (input.input_event.empty() ? 0u : input.input_event[deposit]);
+        return (static_cast<std::uint64_t>(input_event) << 32u) | static_cast<std::uint32_t>(track_id);
+    };
+
+    for(size_t i = 0; i < input.detector.size(); ++i) {
+        auto detector_id = input.detector[i];
+        ROOT::Math::XYZPoint global_deposit_position(input.position_x[i], input.position_y[i], input.position_z[i]);
+        auto time = input.time[i];
+        auto energy = input.energy[i];
+        auto pdg_code = input.pdg_code[i];
+        auto track_id = input.track_id[i];
+        auto parent_id = input.parent_id[i];
+        auto track = track_key(i, track_id);
+
         // Assign detector
-        auto detector = (*pos);
-        LOG(DEBUG) << "Found detector \"" << detector->getName() << "\"";
+        const auto& detector = detectors_[detector_id];
+        LOG(DEBUG) << "Found detector \"" << detector_names_[detector_id] << "\"";
 
         auto deposit_position = detector->getLocalPosition(global_deposit_position);
         if(!detector->isWithinSensor(deposit_position)) {
@@ -208,22 +655,24 @@ void DepositionReaderModule::run(unsigned int event) {
         auto charge = charge_fluctuation(random_generator_);
 
         LOG(DEBUG) << "Found deposition of " << charge << " e/h pairs inside sensor at "
-                   << Units::display(deposit_position, {"mm", "um"}) << " in detector " << detector->getName() << ", global "
-                   << Units::display(global_deposit_position, {"mm", "um"}) << ", particleID " << pdg_code;
+                   << Units::display(deposit_position, {"mm", "um"}) << " in detector " << detector_names_[detector_id]
+                   << ", global " << Units::display(global_deposit_position, {"mm", "um"}) << ", particleID " << pdg_code;
 
         // MCParticle:
-        if(track_id_to_mcparticle[detector].find(track_id) == track_id_to_mcparticle[detector].end()) {
+        auto& detector_particles = mc_particles[detector_id];
+        auto& detector_tracks = track_id_to_mcparticle[detector_id];
+        if(detector_tracks.find(track) == detector_tracks.end()) {
             // We have not yet seen this MCParticle, let's store it and keep track of the track id
             LOG(DEBUG) << "Adding new MCParticle, track id " << track_id << ", PDG code " << pdg_code;
-            mc_particles[detector].emplace_back(
+            detector_particles.emplace_back(
                 deposit_position, global_deposit_position, deposit_position, global_deposit_position, pdg_code, time);
-            track_id_to_mcparticle[detector][track_id] = (mc_particles[detector].size() - 1);
+            detector_tracks[track] = (detector_particles.size() - 1);
 
             // Check if we know the parent - and set it:
-            auto parent = track_id_to_mcparticle[detector].find(parent_id);
-            if(parent != track_id_to_mcparticle[detector].end()) {
+            auto parent = detector_tracks.find(track_key(i, parent_id));
+            if(parent != detector_tracks.end()) {
                 LOG(DEBUG) << "Adding parent relation to MCParticle with track id " << parent_id;
-                mc_particles[detector].back().setParent(&mc_particles[detector].at(parent->second));
+                detector_particles.back().setParent(&detector_particles.at(parent->second));
             } else {
                 LOG(DEBUG) << "Parent MCParticle is unknown, parent id " << parent_id;
             }
@@ -232,37 +681,36 @@ void DepositionReaderModule::run(unsigned int event) {
         }
 
         // Deposit electron
-        deposits[detector].emplace_back(deposit_position, global_deposit_position, CarrierType::ELECTRON, charge, time);
-        particles_to_deposits[detector].push_back(track_id);
+        deposits[detector_id].emplace_back(deposit_position, global_deposit_position, CarrierType::ELECTRON, charge, time);
+        particles_to_deposits[detector_id].push_back(track);
 
         // Deposit hole
-        deposits[detector].emplace_back(deposit_position, global_deposit_position, CarrierType::HOLE, charge, time);
-        particles_to_deposits[detector].push_back(track_id);
-    } while(true);
-
-    LOG(INFO) << "Finished reading event " << event;
+        deposits[detector_id].emplace_back(deposit_position, global_deposit_position, CarrierType::HOLE, charge, time);
+        particles_to_deposits[detector_id].push_back(track);
+    }
 
     // Loop over all known detectors and dispatch messages for them
-    for(const auto& detector : geo_manager_->getDetectors()) {
-        LOG(DEBUG) << "Detector " << detector->getName() << " has " << mc_particles[detector].size() << " MC particles";
+    for(size_t id = 0; id < detectors_.size(); ++id) {
+        const auto& detector = detectors_[id];
+        LOG(DEBUG) << "Detector " << detector_names_[id] << " has " << mc_particles[id].size() << " MC particles";
 
         // Send the mc particle information
-        auto mc_particle_message = std::make_shared<MCParticleMessage>(std::move(mc_particles[detector]), detector);
+        auto mc_particle_message = std::make_shared<MCParticleMessage>(std::move(mc_particles[id]), detector);
         messenger_->dispatchMessage(this, mc_particle_message);
 
-        if(!deposits[detector].empty()) {
+        if(!deposits[id].empty()) {
             double total_deposits = 0;
 
             // Assign MCParticles:
-            for(size_t i = 0; i < deposits[detector].size(); ++i) {
-                total_deposits += deposits[detector].at(i).getCharge();
-                deposits[detector].at(i).setMCParticle(&mc_particle_message->getData().at(
-                    track_id_to_mcparticle[detector].at(particles_to_deposits[detector].at(i))));
+            for(size_t i = 0; i < deposits[id].size(); ++i) {
+                total_deposits += deposits[id].at(i).getCharge();
+                deposits[id].at(i).setMCParticle(
+                    &mc_particle_message->getData().at(track_id_to_mcparticle[id].at(particles_to_deposits[id].at(i))));
             }
 
             // Create a new charge deposit message
-            LOG(DEBUG) << "Detector " << detector->getName() << " has " << deposits[detector].size() << " deposits";
-            auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(deposits[detector]), detector);
+            LOG(DEBUG) << "Detector " << detector_names_[id] << " has " << deposits[id].size() << " deposits";
+            auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(deposits[id]), detector);
 
             // Dispatch the message
             messenger_->dispatchMessage(this, deposit_message);
@@ -270,14 +718,14 @@ void DepositionReaderModule::run(unsigned int event) {
             // Fill output plots if requested:
             if(config_.get<bool>("output_plots")) {
                 double charge = static_cast<double>(Units::convert(total_deposits, "ke"));
-                charge_per_event_[detector->getName()]->Fill(charge);
+                charge_per_event_[detector_names_[id]]->Fill(charge);
             }
         }
     }
 
     // Request end-of-run since we don't have events anymore
-    if(end_of_run) {
-        throw EndOfRunException(eof_message);
+    if(!input.end_of_run.empty()) {
+        throw EndOfRunException(input.end_of_run);
     }
 }
 
@@ -290,50 +738,97 @@ void DepositionReaderModule::finalize() {
         }
     }
 }
-bool DepositionReaderModule::read_root(unsigned int event_num,
-                                       std::string& volume,
-                                       ROOT::Math::XYZPoint& position,
-                                       double& time,
-                                       double& energy,
-                                       int& pdg_code,
-                                       int& track_id,
-                                       int& parent_id) {
-
-    auto status = tree_reader_->GetEntryStatus();
-    if(status == TTreeReader::kEntryNotFound || status == TTreeReader::kEntryBeyondEnd) {
-        throw EndOfRunException("Requesting end of run: end of tree reached");
-    } else if(status != TTreeReader::kEntryValid) {
-        throw EndOfRunException("Problem reading from tree, error: " + std::to_string(static_cast<int>(status)));
+void DepositionReaderModule::checkpoint(TDirectory* directory) {
+    // The input position is the tree entry or the offset in the mapped file of the next deposit to read, the deposits
+    // read ahead for the next event are read again after resuming. For time slices, the input events with deposits kept for
+    // the following slices are read again, and their deposits of the previous slices are discarded after resuming.
+    auto input_position = (time_slice_ > 0 ? pending_deposits_.input_position : get_input_position());
+    auto position = std::to_string(has_staged_deposits_ ? staged_deposits_->input_position : input_position);
+    directory->WriteObject(&position, "input_position");
+    for(auto& plot : charge_per_event_) {
+        directory->WriteTObject(plot.second);
     }
+}
 
-    // Separate individual events
-    if(static_cast<unsigned int>(*event_->Get()) > event_num - 1) {
-        return false;
+void DepositionReaderModule::resume(TDirectory* directory) {
+    std::string* position = nullptr;
+    directory->GetObject("input_position", position);
+    if(position == nullptr) {
+        throw ModuleError("Checkpoint does not contain the position in the input file");
     }
+    auto input_position = allpix::from_string<std::uint64_t>(*position);
+    delete position;
 
-    // Read detector name
-    // NOTE volume_->GetSize() is the full length, we might want to cut only part of the name
-    auto length = (volume_chars_ != 0 ? std::min(volume_chars_, volume_->GetSize()) : volume_->GetSize());
-    volume = std::string(static_cast<char*>(volume_->GetAddress()), length);
+    if(file_model_ == "root") {
+        tree_reader_->SetEntry(static_cast<Long64_t>(input_position));
+    } else {
+        if(input_position > input_size_) {
+            throw ModuleError("Position of the checkpoint is beyond the end of input file " + file_path_);
+        }
+        input_offset_ = static_cast<size_t>(input_position);
+    }
+    has_staged_deposits_ = false;
+    pending_deposits_.clear();
+    pending_deposits_.input_position = input_position;
+    last_input_time_ = -std::numeric_limits<double>::infinity();
+    resumed_time_slice_ = true;
+    LOG(DEBUG) << "Continuing to read input file at position " << input_position;
+
+    for(auto& plot : charge_per_event_) {
+        TH1D* stored = nullptr;
+        directory->GetObject(plot.second->GetName(), stored);
+        if(stored != nullptr) {
+            plot.second->Add(stored);
+        }
+    }
+}
 
-    // Read other information, interpret in framework units:
-    position = ROOT::Math::XYZPoint(
-        Units::get(*px_->Get(), unit_length_), Units::get(*py_->Get(), unit_length_), Units::get(*pz_->Get(), unit_length_));
-    time = Units::get(*time_->Get(), unit_time_);
-    energy = Units::get(*edep_->Get(), unit_energy_);
+/**
+ * The tree entries are read until the event number changes, and the values of the deposits in known detectors are stored
+ * column by column. The baskets of the branches are read in bulk through the tree cache, such that processing the deposits
+ * afterwards only iterates over contiguous arrays.
+ */
+void DepositionReaderModule::read_root_event(unsigned int event_num, EventDeposits& columns) {
+    while(true) {
+        auto status = tree_reader_->GetEntryStatus();
+        if(status == TTreeReader::kEntryNotFound || status == TTreeReader::kEntryBeyondEnd) {
+            columns.end_of_run = "Requesting end of run: end of tree reached";
+            break;
+        } else if(status != TTreeReader::kEntryValid) {
+            columns.end_of_run = "Problem reading from tree, error: " + std::to_string(static_cast<int>(status));
+            break;
+        }
 
-    // Read PDG code and track ids
-    pdg_code = (*pdg_code_->Get());
-    track_id = (*track_id_->Get());
-    parent_id = (*parent_id_->Get());
+        // Separate individual events
+        if(static_cast<unsigned int>(*event_->Get()) > event_num - 1 + event_offset_) {
+            break;
+        }
 
-    // Return and advance to next tree entry:
-    tree_reader_->Next();
-    return true;
+        // Read detector name, entries of unknown detectors are not stored
+        auto detector = find_detector(std::string_view(static_cast<char*>(volume_->GetAddress()), volume_->GetSize()));
+        if(detector != unknown_detector) {
+            // Read other information, interpret in framework units:
+            columns.detector.push_back(detector);
+            columns.position_x.push_back(*px_->Get() * unit_length_);
+            columns.position_y.push_back(*py_->Get() * unit_length_);
+            columns.position_z.push_back(*pz_->Get() * unit_length_);
+            columns.time.push_back(*time_->Get() * unit_time_);
+            columns.energy.push_back(*edep_->Get() * unit_energy_);
+
+            // Read PDG code and track ids
+            columns.pdg_code.push_back(*pdg_code_->Get());
+            columns.track_id.push_back(*track_id_->Get());
+            columns.parent_id.push_back(*parent_id_->Get());
+        }
+
+        // Advance to next tree entry:
+        tree_reader_->Next();
+    }
+    LOG(TRACE) << "Read " << columns.detector.size() << " deposits of event " << event_num << " from tree";
 }
 
 bool DepositionReaderModule::read_csv(unsigned int event_num,
-                                      std::string& volume,
+                                      size_t& detector,
                                       ROOT::Math::XYZPoint& position,
                                       double& time,
                                       double& energy,
@@ -341,70 +836,94 @@ bool DepositionReaderModule::read_csv(unsigned int event_num,
                                       int& track_id,
                                       int& parent_id) {
 
-    std::string line, tmp;
+    const char* line_begin = nullptr;
+    const char* line_end = nullptr;
     do {
         // Read input file line-by-line and trim whitespaces at beginning and end:
-        std::getline(*input_file_, line);
-        line = allpix::trim(line);
-        LOG(TRACE) << "Line read: " << line;
-
-        // Request end of run if we reached end of file:
-        if(input_file_->eof()) {
+        const char* data = input_data_.get();
+        const auto* newline = (input_offset_ < input_size_ ? static_cast<const char*>(std::memchr(
+                                                                 data + input_offset_, '\n', input_size_ - input_offset_))
+                                                           : nullptr);
+
+        // Request end of run if we reached end of file, a last line without line break is ignored:
+        if(newline == nullptr) {
+            input_offset_ = input_size_;
             throw EndOfRunException("Requesting end of run, CSV file only contains data for " + std::to_string(event_num) +
                                     " events");
         }
 
+        line_begin = data + input_offset_;
+        line_end = newline;
+        input_offset_ = static_cast<size_t>(newline - data) + 1;
+        trim(line_begin, line_end);
+        LOG(TRACE) << "Line read: " << std::string(line_begin, line_end);
+
         // Check for event header:
-        if(line.front() == 'E') {
-            std::stringstream lse(line);
-            unsigned int event_read;
-            lse >> tmp >> event_read;
-            if(event_read + 1 > event_num) {
+        if(line_begin != line_end && *line_begin == 'E') {
+            auto event_read = parse_event_header(line_begin, line_end);
+            if(event_read + 1 > event_num + event_offset_) {
                 return false;
             }
             LOG(DEBUG) << "Parsed header of event " << event_read << ", continuing";
             continue;
         }
-    } while(line.empty() || line.front() == '#' || line.front() == 'E');
-
-    std::istringstream ls(line);
-    double px, py, pz;
-
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> pdg_code;
+    } while(line_begin == line_end || *line_begin == '#' || *line_begin == 'E');
+
+    // Values are parsed in place, they are terminated by the following comma or the line break
+    const auto* position_in_line = line_begin;
+    pdg_code = to_int(next_value(position_in_line, line_end));
+    time = to_double(next_value(position_in_line, line_end));
+    energy = to_double(next_value(position_in_line, line_end));
+    auto px = to_double(next_value(position_in_line, line_end));
+    auto py = to_double(next_value(position_in_line, line_end));
+    auto pz = to_double(next_value(position_in_line, line_end));
+    auto volume = next_value(position_in_line, line_end);
+    detector = find_detector(std::string_view(volume.first, static_cast<size_t>(volume.second - volume.first)));
+    track_id = to_int(next_value(position_in_line, line_end));
+    parent_id = to_int(next_value(position_in_line, line_end));
 
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> time;
-
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> energy;
+    // Calculate the charge deposit at a global position and convert the proper units
+    position = ROOT::Math::XYZPoint(px * unit_length_, py * unit_length_, pz * unit_length_);
+    time *= unit_time_;
+    energy *= unit_energy_;
 
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> px;
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> py;
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> pz;
+    return true;
+}
 
-    std::getline(ls, volume, ',');
-    volume = allpix::trim(volume);
+bool DepositionReaderModule::read_binary(unsigned int event_num,
+                                         size_t& detector,
+                                         ROOT::Math::XYZPoint& position,
+                                         double& time,
+                                         double& energy,
+                                         int& pdg_code,
+                                         int& track_id,
+                                         int& parent_id) {
+
+    if(input_offset_ + sizeof(BinaryRecord) > input_size_) {
+        throw EndOfRunException("Requesting end of run, binary file only contains data for " + std::to_string(event_num) +
+                                " events");
+    }
 
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> track_id;
-    std::getline(ls, tmp, ',');
-    std::istringstream(tmp) >> parent_id;
+    // The records are read directly from the mapped file, they are aligned since the header size is a multiple of eight
+    const auto* record = reinterpret_cast<const BinaryRecord*>(input_data_.get() + input_offset_);
 
-    // Select the detector name from this:
-    if(volume_chars_ != 0) {
-        volume = volume.substr(0, std::min(volume_chars_, volume.size()));
-        LOG(TRACE) << "Truncated detector name: " << volume;
+    // Separate individual events
+    if(static_cast<unsigned int>(record->event) > event_num - 1 + event_offset_) {
+        return false;
     }
+    input_offset_ += sizeof(BinaryRecord);
 
-    // Calculate the charge deposit at a global position and convert the proper units
-    position =
-        ROOT::Math::XYZPoint(Units::get(px, unit_length_), Units::get(py, unit_length_), Units::get(pz, unit_length_));
-    time = Units::get(time, unit_time_);
-    energy = Units::get(energy, unit_energy_);
+    // Read detector name, which is padded with null characters
+    detector = find_detector(std::string_view(record->detector, strnlen(record->detector, sizeof(record->detector))));
+
+    // Read other information, interpret in framework units:
+    position = ROOT::Math::XYZPoint(
+        record->position[0] * unit_length_, record->position[1] * unit_length_, record->position[2] * unit_length_);
+    time = record->time * unit_time_;
+    energy = record->energy * unit_energy_;
 
+    pdg_code = record->pdg_code;
+    track_id = record->track_id;
+    parent_id = record->parent_id;
     return true;
 }
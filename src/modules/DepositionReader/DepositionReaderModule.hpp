@@ -13,8 +13,15 @@
  * Refer to the User's Manual for more details.
  */
 
+#include <cstdint>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <TFile.h>
 #include <TH1D.h>
@@ -38,6 +45,45 @@ namespace allpix {
      */
     class DepositionReaderModule : public Module {
     public:
+        /**
+         * @brief Header at the beginning of binary deposit files, followed by the deposit records
+         */
+        struct BinaryHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t record_size;
+        };
+
+        /**
+         * @brief Record of a single energy deposit in binary deposit files, with the values in units of the configured units
+         */
+        struct BinaryRecord {
+            std::int32_t event;
+            std::int32_t pdg_code;
+            std::int32_t track_id;
+            std::int32_t parent_id;
+            double time;
+            double energy;
+            double position[3];
+            char detector[32];
+        };
+
+        /**
+         * @brief Header of event index files, followed by the event number and the position of every indexed event
+         */
+        struct IndexHeader {
+            char magic[8];
+            std::uint64_t source_size;
+            std::int64_t source_mtime;
+            std::uint64_t events;
+        };
+
+        // Identifier and layout version of binary deposit files
+        static constexpr char binary_magic[8] = {'A', 'P', 'X', 'D', 'E', 'P', 'O', '\0'};
+        static constexpr std::uint32_t binary_version = 1;
+        // Identifier of event index files
+        static constexpr char index_magic[8] = {'A', 'P', 'X', 'E', 'V', 'I', 'X', '\0'};
+
         /**
          * @brief Constructor for this unique module
          * @param config Configuration object for this module as retrieved from the steering file
@@ -61,15 +107,69 @@ namespace allpix {
          */
         void finalize() override;
 
+        /**
+         * @brief Store the position in the input file and the histograms with the checkpoint
+         * @param directory Directory of the checkpoint file for this module
+         */
+        void checkpoint(TDirectory* directory) override;
+
+        /**
+         * @brief Continue reading the input file at the position stored with the checkpoint
+         * @param directory Directory of the checkpoint file for this module
+         */
+        void resume(TDirectory* directory) override;
+
     private:
         // General module members
         GeometryManager* geo_manager_;
         Messenger* messenger_;
 
-        // File containing the input data
-        std::unique_ptr<std::ifstream> input_file_;
+        // File containing the input data, text and binary files are mapped into memory and read from the current offset
+        std::shared_ptr<const char> input_data_;
+        size_t input_size_{};
+        size_t input_offset_{};
         std::unique_ptr<TFile> input_file_root_;
 
+        std::string file_path_;
+
+        /**
+         * @brief Map the input file into memory
+         * @param file_path Path of the file
+         */
+        void map_input_file(const std::string& file_path);
+
+        // Position of the first line or tree entry of events, ordered by the event number
+        using EventIndex = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+        /**
+         * @brief Move the input to the first event with at least the given event number
+         * @param file_event Event number in the input file
+         */
+        void seek_event(std::uint64_t file_event);
+
+        /**
+         * @brief Scan the input file for the positions of the events
+         * @param last_event Event number after which the scan is stopped, all events are indexed by default
+         * @return Position of all events scanned
+         */
+        EventIndex scan_events(std::uint64_t last_event = UINT64_MAX);
+
+        /**
+         * @brief Read the event index of the input file from its index file
+         * @param index Event index read
+         * @return True if the index file exists and was written for the current input file, false otherwise
+         */
+        bool read_index(EventIndex& index) const;
+
+        /**
+         * @brief Write the event index of the input file to its index file
+         * @param index Event index to write
+         */
+        void write_index(const EventIndex& index) const;
+
+        // Offset between the event numbers of the framework and the input file
+        std::uint64_t event_offset_{};
+
         // Helper to create and check tree branches
         template <typename T> void create_tree_reader(std::shared_ptr<T>& branch_ptr, const std::string& name);
         template <typename T> void check_tree_reader(std::shared_ptr<T> branch_ptr);
@@ -89,26 +189,135 @@ namespace allpix {
         double charge_creation_energy_;
         double fano_factor_;
 
+        /**
+         * @brief Deposits of an event read from the input file, stored column by column
+         */
+        struct EventDeposits {
+            std::vector<size_t> detector;
+            std::vector<double> position_x, position_y, position_z;
+            std::vector<double> time, energy;
+            std::vector<int> pdg_code, track_id, parent_id;
+            // Number of the input event of every deposit, only filled for time slices combining several input events
+            std::vector<unsigned int> input_event;
+            // Position in the input file before the event was read
+            std::uint64_t input_position{};
+            // Reason to end the run after the deposits of the event, empty if the input contains more events
+            std::string end_of_run;
+
+            /**
+             * @brief Remove all deposits, keeping the memory of the columns for the following events
+             */
+            void clear() {
+                detector.clear();
+                position_x.clear();
+                position_y.clear();
+                position_z.clear();
+                time.clear();
+                energy.clear();
+                pdg_code.clear();
+                track_id.clear();
+                parent_id.clear();
+                input_event.clear();
+                end_of_run.clear();
+            }
+
+            /**
+             * @brief Append a deposit of another event
+             * @param other Deposits to take the deposit from
+             * @param deposit Index of the deposit to append
+             * @param event Number of the input event of the deposit
+             */
+            void push_back(const EventDeposits& other, size_t deposit, unsigned int event) {
+                detector.push_back(other.detector[deposit]);
+                position_x.push_back(other.position_x[deposit]);
+                position_y.push_back(other.position_y[deposit]);
+                position_z.push_back(other.position_z[deposit]);
+                time.push_back(other.time[deposit]);
+                energy.push_back(other.energy[deposit]);
+                pdg_code.push_back(other.pdg_code[deposit]);
+                track_id.push_back(other.track_id[deposit]);
+                parent_id.push_back(other.parent_id[deposit]);
+                input_event.push_back(event);
+            }
+        };
+
+        /**
+         * @brief Read all deposits of an event from the input file
+         * @param event_num Event number of the framework
+         * @param deposits Deposits of the event, replacing the previous content
+         */
+        void read_event(unsigned int event_num, EventDeposits& deposits);
+
+        /**
+         * @brief Read all tree entries of an event into the deposit columns
+         * @param event_num Event number of the framework
+         * @param deposits Deposits of the event
+         */
+        void read_root_event(unsigned int event_num, EventDeposits& deposits);
+
+        /**
+         * @brief Collect the deposits of a time slice from the input events overlapping with it
+         * @param event_num Event number of the framework, selecting the time slice
+         * @param deposits Deposits of the time slice with times relative to its start, replacing the previous content
+         */
+        void read_time_slice(unsigned int event_num, EventDeposits& deposits);
+
+        /**
+         * @brief Get the current position in the input file
+         * @return Entry of the tree or offset in the mapped file of the next deposit to read
+         */
+        std::uint64_t get_input_position() const;
+
+        // Deposits of the current event, and of the next event read ahead by the thread of the asynchronous tasks
+        std::unique_ptr<EventDeposits> current_deposits_, staged_deposits_;
+        bool prefetch_events_{};
+        bool has_staged_deposits_{};
+
+        // Length of the time slices the input is divided into, zero if every input event is read as one event
+        double time_slice_{};
+        // Deposits of the input events read which belong to the following time slices
+        EventDeposits pending_deposits_;
+        // Number of the next input event to read and earliest deposit time of the last input event read
+        unsigned int next_input_event_{1};
+        double last_input_time_{};
+        // Deposits before the start of the first time slice after resuming have been assigned before the checkpoint
+        bool resumed_time_slice_{};
+
         std::string file_model_;
         size_t volume_chars_{};
-        std::string unit_length_{}, unit_time_{}, unit_energy_{};
+        // Factors to convert the values of the input file to framework units
+        double unit_length_{}, unit_time_{}, unit_energy_{};
+
+        // Detectors to read deposits for, deposits refer to the detectors by their position in this list
+        std::vector<std::shared_ptr<Detector>> detectors_;
+        std::vector<std::string> detector_names_;
+        // Names of the detectors interned at initialization, such that volume names are looked up without copying them
+        std::unordered_map<std::string_view, size_t> detector_ids_;
+        static constexpr size_t unknown_detector = std::numeric_limits<size_t>::max();
+
+        /**
+         * @brief Find the detector for the volume name of a deposit
+         * @param volume Volume name read from the input file, truncated to the configured number of characters
+         * @return Position of the detector in the list of detectors, or unknown_detector if not part of the simulation
+         */
+        size_t find_detector(std::string_view volume) const;
 
         bool read_csv(unsigned int event_num,
-                      std::string& volume,
+                      size_t& detector,
                       ROOT::Math::XYZPoint& position,
                       double& time,
                       double& energy,
                       int& pdg_code,
                       int& track_id,
                       int& parent_id);
-        bool read_root(unsigned int event_num,
-                       std::string& volume,
-                       ROOT::Math::XYZPoint& position,
-                       double& time,
-                       double& energy,
-                       int& pdg_code,
-                       int& track_id,
-                       int& parent_id);
+        bool read_binary(unsigned int event_num,
+                         size_t& detector,
+                         ROOT::Math::XYZPoint& position,
+                         double& time,
+                         double& energy,
+                         int& pdg_code,
+                         int& track_id,
+                         int& parent_id);
 
         // Random number generator for e/h pair creation fluctuation
         std::mt19937_64 random_generator_;
@@ -11,12 +11,16 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
 #include <utility>
 
 #include "core/geometry/HybridPixelDetectorModel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/log.h"
+#include "core/utils/text.h"
 
 #include "tools/ROOT.h"
 
@@ -25,10 +29,18 @@ using namespace allpix;
 DetectorHistogrammerModule::DetectorHistogrammerModule(Configuration& config,
                                                        Messenger* messenger,
                                                        std::shared_ptr<Detector> detector)
-    : Module(config, detector), detector_(std::move(detector)), pixels_message_(nullptr) {
+    : Module(config, detector), detector_(std::move(detector)), messenger_(messenger), pixels_message_(nullptr) {
+    // Enable parallelization of this module if multithreading is enabled, the histograms are filled per thread such that
+    // also several events can be processed at the same time
+    enable_event_parallelization();
+
+    // Merging the histograms can overlap with the finalization of other modules, the histograms are written through the
+    // lock of the module output file
+    enable_parallel_finalization();
+
     // Bind messages
-    messenger->bindSingle(this, &DetectorHistogrammerModule::pixels_message_);
-    messenger->bindSingle(this, &DetectorHistogrammerModule::mcparticle_message_, MsgFlags::REQUIRED);
+    messenger_->bindSingle(this, &DetectorHistogrammerModule::pixels_message_);
+    messenger_->bindSingle(this, &DetectorHistogrammerModule::mcparticle_message_, MsgFlags::REQUIRED);
 
     // Seed the random generator with the global seed
     random_generator_.seed(getRandomSeed());
@@ -53,16 +65,17 @@ void DetectorHistogrammerModule::init() {
     // Create histogram of hitmap
     LOG(TRACE) << "Creating histograms";
     std::string hit_map_title = "Hitmap for " + detector_->getName() + ";x (pixels);y (pixels);hits";
-    hit_map = new TH2D("hit_map", hit_map_title.c_str(), xpixels, -0.5, xpixels - 0.5, ypixels, -0.5, ypixels - 0.5);
+    hit_map = std::make_unique<ThreadedHistogram<TH2D>>(
+        "hit_map", hit_map_title.c_str(), xpixels, -0.5, xpixels - 0.5, ypixels, -0.5, ypixels - 0.5);
 
     std::string charge_map_title = "Charge map for " + detector_->getName() + ";x (pixels);y (pixels); charge [ke]";
-    charge_map =
-        new TH2D("charge_map", charge_map_title.c_str(), xpixels, -0.5, xpixels - 0.5, ypixels, -0.5, ypixels - 0.5);
+    charge_map = std::make_unique<ThreadedHistogram<TH2D>>(
+        "charge_map", charge_map_title.c_str(), xpixels, -0.5, xpixels - 0.5, ypixels, -0.5, ypixels - 0.5);
 
     // Create histogram of cluster map
     std::string cluster_map_title = "Cluster map for " + detector_->getName() + ";x (pixels);y (pixels); clusters";
-    cluster_map =
-        new TH2D("cluster_map", cluster_map_title.c_str(), xpixels, -0.5, xpixels - 0.5, ypixels, -0.5, ypixels - 0.5);
+    cluster_map = std::make_unique<ThreadedHistogram<TH2D>>(
+        "cluster_map", cluster_map_title.c_str(), xpixels, -0.5, xpixels - 0.5, ypixels, -0.5, ypixels - 0.5);
 
     // Calculate the granularity of in-pixel maps:
     auto inpixel_bins = config_.get<DisplacementVector2D<Cartesian2D<int>>>(
@@ -78,182 +91,218 @@ void DetectorHistogrammerModule::init() {
     // Create histogram of cluster map
     std::string cluster_size_map_title = "Cluster size as function of in-pixel impact position for " + detector_->getName() +
                                          ";x%pitch [#mum];y%pitch [#mum]";
-    cluster_size_map = new TProfile2D(
+    cluster_size_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "cluster_size_map", cluster_size_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
 
     std::string cluster_size_x_map_title = "Cluster size in X as function of in-pixel impact position for " +
                                            detector_->getName() + ";x%pitch [#mum];y%pitch [#mum]";
-    cluster_size_x_map = new TProfile2D("cluster_size_x_map",
-                                        cluster_size_x_map_title.c_str(),
-                                        inpixel_bins.x(),
-                                        0.,
-                                        pitch_x,
-                                        inpixel_bins.y(),
-                                        0.,
-                                        pitch_y);
+    cluster_size_x_map = std::make_unique<ThreadedHistogram<TProfile2D>>("cluster_size_x_map",
+                                                                         cluster_size_x_map_title.c_str(),
+                                                                         inpixel_bins.x(),
+                                                                         0.,
+                                                                         pitch_x,
+                                                                         inpixel_bins.y(),
+                                                                         0.,
+                                                                         pitch_y);
 
     std::string cluster_size_y_map_title = "Cluster size in Y as function of in-pixel impact position for " +
                                            detector_->getName() + ";x%pitch [#mum];y%pitch [#mum]";
-    cluster_size_y_map = new TProfile2D("cluster_size_y_map",
-                                        cluster_size_y_map_title.c_str(),
-                                        inpixel_bins.x(),
-                                        0.,
-                                        pitch_x,
-                                        inpixel_bins.y(),
-                                        0.,
-                                        pitch_y);
+    cluster_size_y_map = std::make_unique<ThreadedHistogram<TProfile2D>>("cluster_size_y_map",
+                                                                         cluster_size_y_map_title.c_str(),
+                                                                         inpixel_bins.x(),
+                                                                         0.,
+                                                                         pitch_x,
+                                                                         inpixel_bins.y(),
+                                                                         0.,
+                                                                         pitch_y);
 
     // Charge maps:
     std::string cluster_charge_map_title = "Cluster charge as function of in-pixel impact position for " +
                                            detector_->getName() + ";x%pitch [#mum];y%pitch [#mum];<cluster charge> [ke]";
-    cluster_charge_map = new TProfile2D("cluster_charge_map",
-                                        cluster_charge_map_title.c_str(),
-                                        inpixel_bins.x(),
-                                        0.,
-                                        pitch_x,
-                                        inpixel_bins.y(),
-                                        0.,
-                                        pitch_y);
+    cluster_charge_map = std::make_unique<ThreadedHistogram<TProfile2D>>("cluster_charge_map",
+                                                                         cluster_charge_map_title.c_str(),
+                                                                         inpixel_bins.x(),
+                                                                         0.,
+                                                                         pitch_x,
+                                                                         inpixel_bins.y(),
+                                                                         0.,
+                                                                         pitch_y);
     std::string seed_charge_map_title = "Seed pixel charge as function of in-pixel impact position for " +
                                         detector_->getName() + ";x%pitch [#mum];y%pitch [#mum];<seed pixel charge> [ke]";
-    seed_charge_map = new TProfile2D(
+    seed_charge_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "seed_charge_map", seed_charge_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
 
     // Create cluster size plots, preventing a zero-bin histogram by scaling with integer ceiling: (x + y - 1) / y
     std::string cluster_size_title = "Cluster size for " + detector_->getName() + ";cluster size [px];clusters";
-    cluster_size = new TH1D(
+    cluster_size = std::make_unique<ThreadedHistogram<TH1D>>(
         "cluster_size", cluster_size_title.c_str(), (xpixels * ypixels + 9) / 10, 0.5, (xpixels * ypixels + 9) / 10 + 0.5);
 
     std::string cluster_size_x_title = "Cluster size X for " + detector_->getName() + ";cluster size x [px];clusters";
-    cluster_size_x = new TH1D("cluster_size_x", cluster_size_x_title.c_str(), xpixels, 0.5, xpixels + 0.5);
+    cluster_size_x = std::make_unique<ThreadedHistogram<TH1D>>(
+        "cluster_size_x", cluster_size_x_title.c_str(), xpixels, 0.5, xpixels + 0.5);
 
     std::string cluster_size_y_title = "Cluster size Y for " + detector_->getName() + ";cluster size y [px];clusters";
-    cluster_size_y = new TH1D("cluster_size_y", cluster_size_y_title.c_str(), ypixels, 0.5, ypixels + 0.5);
+    cluster_size_y = std::make_unique<ThreadedHistogram<TH1D>>(
+        "cluster_size_y", cluster_size_y_title.c_str(), ypixels, 0.5, ypixels + 0.5);
 
     // Create event size plot
     std::string event_size_title = "Event size for " + detector_->getName() + ";event size [px];events";
-    event_size = new TH1D("event_size", event_size_title.c_str(), xpixels * ypixels, 0.5, xpixels * ypixels + 0.5);
+    event_size = std::make_unique<ThreadedHistogram<TH1D>>(
+        "event_size", event_size_title.c_str(), xpixels * ypixels, 0.5, xpixels * ypixels + 0.5);
 
     // Create residual plots
     std::string residual_x_title = "Residual in X for " + detector_->getName() + ";x_{track} - x_{cluster} [#mum];events";
-    residual_x = new TH1D("residual_x", residual_x_title.c_str(), static_cast<int>(12 * pitch_x), -2 * pitch_x, 2 * pitch_x);
+    residual_x = std::make_unique<ThreadedHistogram<TH1D>>(
+        "residual_x", residual_x_title.c_str(), static_cast<int>(12 * pitch_x), -2 * pitch_x, 2 * pitch_x);
     std::string residual_y_title = "Residual in Y for " + detector_->getName() + ";y_{track} - y_{cluster} [#mum];events";
-    residual_y = new TH1D("residual_y", residual_y_title.c_str(), static_cast<int>(12 * pitch_y), -2 * pitch_y, 2 * pitch_y);
+    residual_y = std::make_unique<ThreadedHistogram<TH1D>>(
+        "residual_y", residual_y_title.c_str(), static_cast<int>(12 * pitch_y), -2 * pitch_y, 2 * pitch_y);
 
     // Residual projections
     std::string residual_x_vs_x_title = "Mean absolute deviation of residual in X as function of in-pixel X position for " +
                                         detector_->getName() + ";x%pitch [#mum];MAD(#Deltax) [#mum]";
-    residual_x_vs_x = new TProfile("residual_x_vs_x", residual_x_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
+    residual_x_vs_x = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_x_vs_x", residual_x_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
     std::string residual_y_vs_y_title = "Mean absolute deviation of residual in Y as function of in-pixel Y position for " +
                                         detector_->getName() + ";y%pitch [#mum];MAD(#Deltay) [#mum]";
-    residual_y_vs_y = new TProfile("residual_y_vs_y", residual_y_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
+    residual_y_vs_y = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_y_vs_y", residual_y_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
     std::string residual_x_vs_y_title = "Mean absolute deviation of residual in X as function of in-pixel Y position for " +
                                         detector_->getName() + ";y%pitch [#mum];MAD(#Deltax) [#mum]";
-    residual_x_vs_y = new TProfile("residual_x_vs_y", residual_x_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
+    residual_x_vs_y = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_x_vs_y", residual_x_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
     std::string residual_y_vs_x_title = "Mean absolute deviation of residual in Y as function of in-pixel X position for " +
                                         detector_->getName() + ";x%pitch [#mum];MAD(#Deltay) [#mum]";
-    residual_y_vs_x = new TProfile("residual_y_vs_x", residual_y_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
+    residual_y_vs_x = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_y_vs_x", residual_y_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
 
     // Residual maps
     std::string residual_map_title = "Mean absolute deviation of residual as function of in-pixel impact position for " +
                                      detector_->getName() +
                                      ";x%pitch [#mum];y%pitch [#mum];MAD(#sqrt{#Deltax^{2}+#Deltay^{2}}) [#mum]";
-    residual_map = new TProfile2D(
+    residual_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "residual_map", residual_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
     std::string residual_x_map_title =
         "Mean absolute deviation of residual in X as function of in-pixel impact position for " + detector_->getName() +
         ";x%pitch [#mum];y%pitch [#mum];MAD(#Deltax) [#mum]";
-    residual_x_map = new TProfile2D(
+    residual_x_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "residual_x_map", residual_x_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
     std::string residual_y_map_title =
         "Mean absolute deviation of residual in Y as function of in-pixel impact position for " + detector_->getName() +
         ";x%pitch [#mum];y%pitch [#mum];MAD(#Deltay) [#mum]";
-    residual_y_map = new TProfile2D(
+    residual_y_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "residual_y_map", residual_y_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
 
     // Efficiency maps:
     std::string efficiency_map_title = "Efficiency as function of in-pixel impact position for " + detector_->getName() +
                                        ";x%pitch [#mum];y%pitch [#mum];efficiency";
-    efficiency_map = new TProfile2D(
+    efficiency_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "efficiency_map", efficiency_map_title.c_str(), inpixel_bins.x(), 0, pitch_x, inpixel_bins.y(), 0, pitch_y, 0, 1);
     std::string efficiency_detector_title = "Efficiency of " + detector_->getName() + ";x (pixels);y (pixels);efficiency";
-    efficiency_detector = new TProfile2D("efficiency_detector",
-                                         efficiency_detector_title.c_str(),
-                                         xpixels,
-                                         -0.5,
-                                         xpixels - 0.5,
-                                         ypixels,
-                                         -0.5,
-                                         ypixels - 0.5,
-                                         0,
-                                         1);
+    efficiency_detector = std::make_unique<ThreadedHistogram<TProfile2D>>("efficiency_detector",
+                                                                          efficiency_detector_title.c_str(),
+                                                                          xpixels,
+                                                                          -0.5,
+                                                                          xpixels - 0.5,
+                                                                          ypixels,
+                                                                          -0.5,
+                                                                          ypixels - 0.5,
+                                                                          0,
+                                                                          1);
     // Efficiency projections
     std::string efficiency_vs_x_title =
         "Efficiency as function of in-pixel X position for " + detector_->getName() + ";x%pitch [#mum];efficiency";
-    efficiency_vs_x = new TProfile("efficiency_vs_x", efficiency_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x, 0, 1);
+    efficiency_vs_x = std::make_unique<ThreadedHistogram<TProfile>>(
+        "efficiency_vs_x", efficiency_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x, 0, 1);
     std::string efficiency_vs_y_title =
         "Efficiency as function of in-pixel Y position for " + detector_->getName() + ";y%pitch [#mum];efficiency";
-    efficiency_vs_y = new TProfile("efficiency_vs_y", efficiency_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y, 0, 1);
+    efficiency_vs_y = std::make_unique<ThreadedHistogram<TProfile>>(
+        "efficiency_vs_y", efficiency_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y, 0, 1);
 
     // Create number of clusters plot
     std::string n_cluster_title = "Number of clusters for " + detector_->getName() + ";clusters;events";
-    n_cluster = new TH1D("n_cluster", n_cluster_title.c_str(), xpixels * ypixels, 0.5, xpixels * ypixels + 0.5);
+    n_cluster = std::make_unique<ThreadedHistogram<TH1D>>(
+        "n_cluster", n_cluster_title.c_str(), xpixels * ypixels, 0.5, xpixels * ypixels + 0.5);
 
     // Create cluster charge plot
     auto max_cluster_charge = Units::convert(config_.get<double>("max_cluster_charge", Units::get(50., "ke")), "ke");
     std::string cluster_charge_title = "Cluster charge for " + detector_->getName() + ";cluster charge [ke];clusters";
-    cluster_charge =
-        new TH1D("cluster_charge", cluster_charge_title.c_str(), 1000, 0., static_cast<double>(max_cluster_charge));
+    cluster_charge = std::make_unique<ThreadedHistogram<TH1D>>(
+        "cluster_charge", cluster_charge_title.c_str(), 1000, 0., static_cast<double>(max_cluster_charge));
 }
 
 void DetectorHistogrammerModule::run(unsigned int) {
     using namespace ROOT::Math;
 
+    // Fetch the messages of the current event
+    auto pixels_message = messenger_->fetchMessage<PixelHitMessage>(this);
+    auto mcparticle_message = messenger_->fetchMessage<MCParticleMessage>(this);
+
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
+
+    // Fill all histograms with the weight of the event, which differs from one for biased simulations
+    auto weight = getEventWeight();
+
     // Check that we actually received pixel hits - we might have none and just received MCParticles!
-    LOG(DEBUG) << "Received " << (pixels_message_ != nullptr ? std::to_string(pixels_message_->getData().size()) : "no")
+    LOG(DEBUG) << "Received " << (pixels_message != nullptr ? std::to_string(pixels_message->getData().size()) : "no")
                << " pixel hits";
-    if(pixels_message_ != nullptr) {
+    std::vector<Cluster> clusters;
+    if(pixels_message != nullptr) {
+        const auto& pixel_hits = pixels_message->getData();
 
         // Fill 2D hitmap histogram
-        for(auto& pixel_hit : pixels_message_->getData()) {
+        ROOT::Math::XYVector event_vector{};
+        for(auto& pixel_hit : pixel_hits) {
             auto pixel_idx = pixel_hit.getPixel().getIndex();
 
             // Add pixel
-            hit_map->Fill(pixel_idx.x(), pixel_idx.y());
-            charge_map->Fill(pixel_idx.x(), pixel_idx.y(), static_cast<double>(Units::convert(pixel_hit.getSignal(), "ke")));
+            hit_map->fill(pixel_idx.x(), pixel_idx.y(), weight);
+            charge_map->fill(pixel_idx.x(),
+                             pixel_idx.y(),
+                             weight * static_cast<double>(Units::convert(pixel_hit.getSignal(), "ke")));
+            event_vector += pixel_idx;
+        }
 
-            // Update statistics
-            total_vector_ += pixel_idx;
-            total_hits_ += 1;
+        // Update statistics
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            total_vector_ += event_vector;
+            total_hits_ += pixel_hits.size();
         }
-    }
 
-    // Perform a clustering
-    std::vector<Cluster> clusters = doClustering();
+        // Perform a clustering with the cluster finder of this thread, keeping its lookup table for the next events
+        thread_local ClusterFinder<Cluster> cluster_finder;
+        clusters = cluster_finder.find(detector_->getModel()->getNPixels(), pixel_hits);
+    }
 
     // Lambda for smearing the Monte Carlo truth position with the track resolution
     auto track_smearing = [&](auto residuals) {
-        double dx = std::normal_distribution<double>(0, residuals.x())(random_generator_);
-        double dy = std::normal_distribution<double>(0, residuals.y())(random_generator_);
+        double dx = std::normal_distribution<double>(0, residuals.x())(random_generator);
+        double dy = std::normal_distribution<double>(0, residuals.y())(random_generator);
         return DisplacementVector3D<Cartesian3D<double>>(dx, dy, 0);
     };
 
     // Retrieve all MC particles in this detector which are primary particles (not produced within the sensor):
-    auto primary_particles = getPrimaryParticles();
+    auto primary_particles = getPrimaryParticles(mcparticle_message->getData());
     LOG(DEBUG) << "Found " << primary_particles.size() << " primary particles in this event";
 
     // Evaluate the clusters
     for(const auto& clus : clusters) {
         // Fill cluster histograms
-        cluster_size->Fill(static_cast<double>(clus.getSize()));
+        cluster_size->fill(static_cast<double>(clus.getSize()), weight);
         auto clusSizesXY = clus.getSizeXY();
-        cluster_size_x->Fill(clusSizesXY.first);
-        cluster_size_y->Fill(clusSizesXY.second);
+        cluster_size_x->fill(clusSizesXY.first, weight);
+        cluster_size_y->fill(clusSizesXY.second, weight);
 
         auto clusterPos = clus.getPosition();
         LOG(DEBUG) << "Cluster at coordinates " << clusterPos << " with charge " << Units::display(clus.getCharge(), "ke");
-        cluster_map->Fill(clusterPos.x(), clusterPos.y());
-        cluster_charge->Fill(static_cast<double>(Units::convert(clus.getCharge(), "ke")));
+        cluster_map->fill(clusterPos.x(), clusterPos.y(), weight);
+        cluster_charge->fill(static_cast<double>(Units::convert(clus.getCharge(), "ke")), weight);
 
         auto cluster_particles = clus.getMCParticles();
         LOG(DEBUG) << "This cluster is connected to " << cluster_particles.size() << " MC particles";
@@ -279,13 +328,13 @@ void DetectorHistogrammerModule::run(unsigned int) {
 
             auto inPixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
             auto inPixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
-            cluster_size_map->Fill(inPixel_um_x, inPixel_um_y, static_cast<double>(clus.getSize()));
-            cluster_size_x_map->Fill(inPixel_um_x, inPixel_um_y, clusSizesXY.first);
-            cluster_size_y_map->Fill(inPixel_um_x, inPixel_um_y, clusSizesXY.second);
+            cluster_size_map->fill(inPixel_um_x, inPixel_um_y, static_cast<double>(clus.getSize()), weight);
+            cluster_size_x_map->fill(inPixel_um_x, inPixel_um_y, clusSizesXY.first, weight);
+            cluster_size_y_map->fill(inPixel_um_x, inPixel_um_y, clusSizesXY.second, weight);
 
             // Charge maps:
-            cluster_charge_map->Fill(
-                inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(clus.getCharge(), "ke")));
+            cluster_charge_map->fill(
+                inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(clus.getCharge(), "ke")), weight);
 
             // Find the nearest pixel
             auto xpixel = static_cast<unsigned int>(std::round(particlePos.x() / pitch.x()));
@@ -294,24 +343,25 @@ void DetectorHistogrammerModule::run(unsigned int) {
             // Retrieve the pixel to which this MCParticle points:
             auto pixel = clus.getPixelHit(xpixel, ypixel);
             if(pixel != nullptr) {
-                seed_charge_map->Fill(
-                    inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(pixel->getSignal(), "ke")));
+                seed_charge_map->fill(
+                    inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(pixel->getSignal(), "ke")), weight);
             }
 
             // Calculate residual with cluster position:
             auto residual_um_x = static_cast<double>(Units::convert(particlePos.x() - clusterPos.x() * pitch.x(), "um"));
             auto residual_um_y = static_cast<double>(Units::convert(particlePos.y() - clusterPos.y() * pitch.y(), "um"));
-            residual_x->Fill(residual_um_x);
-            residual_y->Fill(residual_um_y);
-            residual_x_vs_x->Fill(inPixel_um_x, std::fabs(residual_um_x));
-            residual_y_vs_y->Fill(inPixel_um_y, std::fabs(residual_um_y));
-            residual_x_vs_y->Fill(inPixel_um_y, std::fabs(residual_um_x));
-            residual_y_vs_x->Fill(inPixel_um_x, std::fabs(residual_um_y));
-            residual_map->Fill(inPixel_um_x,
+            residual_x->fill(residual_um_x, weight);
+            residual_y->fill(residual_um_y, weight);
+            residual_x_vs_x->fill(inPixel_um_x, std::fabs(residual_um_x), weight);
+            residual_y_vs_y->fill(inPixel_um_y, std::fabs(residual_um_y), weight);
+            residual_x_vs_y->fill(inPixel_um_y, std::fabs(residual_um_x), weight);
+            residual_y_vs_x->fill(inPixel_um_x, std::fabs(residual_um_y), weight);
+            residual_map->fill(inPixel_um_x,
                                inPixel_um_y,
-                               std::fabs(std::sqrt(residual_um_x * residual_um_x + residual_um_y * residual_um_y)));
-            residual_x_map->Fill(inPixel_um_x, inPixel_um_y, std::fabs(residual_um_x));
-            residual_y_map->Fill(inPixel_um_x, inPixel_um_y, std::fabs(residual_um_y));
+                               std::fabs(std::sqrt(residual_um_x * residual_um_x + residual_um_y * residual_um_y)),
+                               weight);
+            residual_x_map->fill(inPixel_um_x, inPixel_um_y, std::fabs(residual_um_x), weight);
+            residual_y_map->fill(inPixel_um_x, inPixel_um_y, std::fabs(residual_um_y), weight);
         }
     }
 
@@ -341,15 +391,15 @@ void DetectorHistogrammerModule::run(unsigned int) {
         LOG(DEBUG) << "Particle at " << Units::display(particlePos, {"mm", "um"})
                    << (matched ? " has a matching cluster" : " has no matching cluster");
 
-        efficiency_vs_x->Fill(inPixel_um_x, static_cast<double>(matched));
-        efficiency_vs_y->Fill(inPixel_um_y, static_cast<double>(matched));
-        efficiency_map->Fill(inPixel_um_x, inPixel_um_y, static_cast<double>(matched));
-        efficiency_detector->Fill(xpixel, ypixel, static_cast<double>(matched));
+        efficiency_vs_x->fill(inPixel_um_x, static_cast<double>(matched), weight);
+        efficiency_vs_y->fill(inPixel_um_y, static_cast<double>(matched), weight);
+        efficiency_map->fill(inPixel_um_x, inPixel_um_y, static_cast<double>(matched), weight);
+        efficiency_detector->fill(xpixel, ypixel, static_cast<double>(matched), weight);
     }
 
     // Fill further histograms
-    event_size->Fill(pixels_message_ != nullptr ? static_cast<double>(pixels_message_->getData().size()) : 0.);
-    n_cluster->Fill(static_cast<double>(clusters.size()));
+    event_size->fill(pixels_message != nullptr ? static_cast<double>(pixels_message->getData().size()) : 0., weight);
+    n_cluster->fill(static_cast<double>(clusters.size()), weight);
 }
 
 void DetectorHistogrammerModule::finalize() {
@@ -359,171 +409,100 @@ void DetectorHistogrammerModule::finalize() {
                   << total_vector_ / static_cast<double>(total_hits_);
     }
 
-    // FIXME Set more useful spacing maximum for cluster size histogram
-    auto xmax = std::ceil(cluster_size->GetBinCenter(cluster_size->FindLastBinAbove()) + 1);
-    cluster_size->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_size->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    xmax = std::ceil(cluster_size_x->GetBinCenter(cluster_size_x->FindLastBinAbove()) + 1);
-    cluster_size_x->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size_x axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_size_x->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    xmax = std::ceil(cluster_size_y->GetBinCenter(cluster_size_y->FindLastBinAbove()) + 1);
-    cluster_size_y->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size_y axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_size_y->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // FIXME Set more useful spacing maximum for event size histogram
-    xmax = std::ceil(event_size->GetBinCenter(event_size->FindLastBinAbove()) + 1);
-    event_size->GetXaxis()->SetRangeUser(0, xmax);
-    // Set event size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        event_size->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // FIXME Set more useful spacing maximum for n_cluster histogram
-    xmax = std::ceil(n_cluster->GetBinCenter(n_cluster->FindLastBinAbove()) + 1);
-    n_cluster->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        n_cluster->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // FIXME Set more useful spacing maximum for cluster_charge histogram
-    xmax = std::ceil(cluster_charge->GetBinCenter(cluster_charge->FindLastBinAbove()) + 1);
-    cluster_charge->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_charge->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // Set default drawing option histogram for hitmap
-    hit_map->SetOption("colz");
-    // Set hit_map axis spacing
-    if(static_cast<int>(hit_map->GetXaxis()->GetXmax()) < 10) {
-        hit_map->GetXaxis()->SetNdivisions(static_cast<int>(hit_map->GetXaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-    if(static_cast<int>(hit_map->GetYaxis()->GetXmax()) < 10) {
-        hit_map->GetYaxis()->SetNdivisions(static_cast<int>(hit_map->GetYaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-
-    charge_map->SetOption("colz");
-    // Set hit_map axis spacing
-    if(static_cast<int>(charge_map->GetXaxis()->GetXmax()) < 10) {
-        charge_map->GetXaxis()->SetNdivisions(static_cast<int>(charge_map->GetXaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-    if(static_cast<int>(charge_map->GetYaxis()->GetXmax()) < 10) {
-        charge_map->GetYaxis()->SetNdivisions(static_cast<int>(charge_map->GetYaxis()->GetXmax()) + 1, 0, 0, true);
+    // Merge the histograms filled by all threads
+    auto histograms = merge_histograms();
+
+    // FIXME Set more useful spacing maximum for the distributions
+    for(TH1* histogram : {cluster_size->getHistogram(),
+                          cluster_size_x->getHistogram(),
+                          cluster_size_y->getHistogram(),
+                          event_size->getHistogram(),
+                          n_cluster->getHistogram(),
+                          cluster_charge->getHistogram()}) {
+        auto xmax = std::ceil(histogram->GetBinCenter(histogram->FindLastBinAbove()) + 1);
+        histogram->GetXaxis()->SetRangeUser(0, xmax);
+        // Set axis spacing
+        if(static_cast<int>(xmax) < 10) {
+            histogram->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
+        }
     }
 
-    cluster_map->SetOption("colz");
-    // Set cluster_map axis spacing
-    if(static_cast<int>(cluster_map->GetXaxis()->GetXmax()) < 10) {
-        cluster_map->GetXaxis()->SetNdivisions(static_cast<int>(cluster_map->GetXaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-    if(static_cast<int>(cluster_map->GetYaxis()->GetXmax()) < 10) {
-        cluster_map->GetYaxis()->SetNdivisions(static_cast<int>(cluster_map->GetYaxis()->GetXmax()) + 1, 0, 0, true);
+    // Set default drawing option and axis spacing for the maps
+    for(TH1* histogram : {hit_map->getHistogram(), charge_map->getHistogram(), cluster_map->getHistogram()}) {
+        histogram->SetOption("colz");
+        if(static_cast<int>(histogram->GetXaxis()->GetXmax()) < 10) {
+            histogram->GetXaxis()->SetNdivisions(static_cast<int>(histogram->GetXaxis()->GetXmax()) + 1, 0, 0, true);
+        }
+        if(static_cast<int>(histogram->GetYaxis()->GetXmax()) < 10) {
+            histogram->GetYaxis()->SetNdivisions(static_cast<int>(histogram->GetYaxis()->GetXmax()) + 1, 0, 0, true);
+        }
     }
 
     // Write histograms
     LOG(TRACE) << "Writing histograms to file";
-    hit_map->Write();
-    charge_map->Write();
-    cluster_map->Write();
-    cluster_size_map->Write();
-    cluster_size_x_map->Write();
-    cluster_size_y_map->Write();
-    cluster_size->Write();
-    cluster_size_x->Write();
-    cluster_size_y->Write();
-    event_size->Write();
-    residual_x->Write();
-    residual_y->Write();
-    residual_x_vs_x->Write();
-    residual_y_vs_y->Write();
-    residual_x_vs_y->Write();
-    residual_y_vs_x->Write();
-    residual_map->Write();
-    residual_x_map->Write();
-    residual_y_map->Write();
-    efficiency_vs_x->Write();
-    efficiency_vs_y->Write();
-    efficiency_detector->Write();
-    efficiency_map->Write();
-    n_cluster->Write();
-    cluster_charge->Write();
-    cluster_charge_map->Write();
-    seed_charge_map->Write();
+    for(auto* histogram : histograms) {
+        writeROOTObject(histogram);
+    }
 }
 
-std::vector<Cluster> DetectorHistogrammerModule::doClustering() {
-    std::vector<Cluster> clusters;
-    std::map<const PixelHit*, bool> usedPixel;
-
-    if(pixels_message_ == nullptr) {
-        return clusters;
+void DetectorHistogrammerModule::checkpoint(TDirectory* directory) {
+    for(auto* histogram : merge_histograms()) {
+        directory->WriteTObject(histogram);
     }
 
-    auto pixel_it = pixels_message_->getData().begin();
-    for(; pixel_it != pixels_message_->getData().end(); pixel_it++) {
-        const PixelHit* pixel_hit = &(*pixel_it);
+    std::stringstream state;
+    state << random_generator_;
+    auto random_generator = state.str();
+    directory->WriteObject(&random_generator, "random_generator");
+    auto total_hits = std::to_string(total_hits_);
+    directory->WriteObject(&total_hits, "total_hits");
+    auto total_vector = allpix::to_string(total_vector_);
+    directory->WriteObject(&total_vector, "total_vector");
+}
 
-        // Check if the pixel has been used:
-        if(usedPixel[pixel_hit]) {
-            continue;
+void DetectorHistogrammerModule::resume(TDirectory* directory) {
+    for(auto* histogram : merge_histograms()) {
+        TH1* stored = nullptr;
+        directory->GetObject(histogram->GetName(), stored);
+        if(stored == nullptr) {
+            throw ModuleError("Checkpoint does not contain histogram " + std::string(histogram->GetName()));
         }
+        histogram->Add(stored);
+    }
 
-        // Create new cluster
-        Cluster cluster(pixel_hit);
-        usedPixel[pixel_hit] = true;
-        LOG(TRACE) << "Creating new cluster with seed: " << pixel_hit->getPixel().getIndex();
-
-        auto touching = [&](const PixelHit* pixel) {
-            auto pxi1 = pixel->getIndex();
-            for(auto& cluster_pixel : cluster.getPixelHits()) {
-
-                auto distance = [](unsigned int lhs, unsigned int rhs) { return (lhs > rhs ? lhs - rhs : rhs - lhs); };
-
-                auto pxi2 = cluster_pixel->getIndex();
-                if(distance(pxi1.x(), pxi2.x()) <= 1 && distance(pxi1.y(), pxi2.y()) <= 1) {
-                    return true;
-                }
-            }
-            return false;
-        };
-
-        // Keep adding pixels to the cluster:
-        for(auto other_pixel = pixel_it + 1; other_pixel != pixels_message_->getData().end(); other_pixel++) {
-            const PixelHit* neighbor = &(*other_pixel);
-
-            // Check if neighbor has been used or if it touches the current cluster:
-            if(usedPixel[neighbor] || !touching(neighbor)) {
-                continue;
-            }
-
-            cluster.addPixelHit(neighbor);
-            LOG(TRACE) << "Adding pixel: " << neighbor->getPixel().getIndex();
-            usedPixel[neighbor] = true;
-            other_pixel = pixel_it;
-        }
-        clusters.push_back(cluster);
+    std::string* random_generator = nullptr;
+    std::string* total_hits = nullptr;
+    std::string* total_vector = nullptr;
+    directory->GetObject("random_generator", random_generator);
+    directory->GetObject("total_hits", total_hits);
+    directory->GetObject("total_vector", total_vector);
+    if(random_generator == nullptr || total_hits == nullptr || total_vector == nullptr) {
+        throw ModuleError("Checkpoint does not contain the statistics of the histogrammer");
     }
-    return clusters;
+    std::stringstream state(*random_generator);
+    state >> random_generator_;
+    total_hits_ = allpix::from_string<unsigned long>(*total_hits);
+    total_vector_ = allpix::from_string<ROOT::Math::XYVector>(*total_vector);
+    delete random_generator;
+    delete total_hits;
+    delete total_vector;
+}
+
+std::vector<TH1*> DetectorHistogrammerModule::merge_histograms() {
+    return {hit_map->merge(), charge_map->merge(), cluster_map->merge(), cluster_size_map->merge(),
+            cluster_size_x_map->merge(), cluster_size_y_map->merge(), cluster_size->merge(), cluster_size_x->merge(),
+            cluster_size_y->merge(), event_size->merge(), residual_x->merge(), residual_y->merge(), residual_x_vs_x->merge(),
+            residual_y_vs_y->merge(), residual_x_vs_y->merge(), residual_y_vs_x->merge(), residual_map->merge(),
+            residual_x_map->merge(), residual_y_map->merge(), efficiency_vs_x->merge(), efficiency_vs_y->merge(),
+            efficiency_detector->merge(), efficiency_map->merge(), n_cluster->merge(), cluster_charge->merge(),
+            cluster_charge_map->merge(), seed_charge_map->merge()};
 }
 
-std::vector<const MCParticle*> DetectorHistogrammerModule::getPrimaryParticles() const {
+std::vector<const MCParticle*> DetectorHistogrammerModule::getPrimaryParticles(const std::vector<MCParticle>& mc_particles) {
     std::vector<const MCParticle*> primaries;
 
     // Loop over all MCParticles available
-    for(auto& mc_particle : mcparticle_message_->getData()) {
+    for(auto& mc_particle : mc_particles) {
         // Check for possible parents:
         auto parent = mc_particle.getParent();
         if(parent != nullptr) {
@@ -11,7 +11,8 @@
 #define ALLPIX_MODULE_DETECTOR_HISTOGRAMMER_H
 
 #include <memory>
-
+#include <mutex>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -26,14 +27,18 @@
 #include "core/module/Module.hpp"
 
 #include "Cluster.hpp"
+#include "objects/MCParticle.hpp"
 #include "objects/PixelHit.hpp"
+#include "tools/cluster_finder.h"
+#include "tools/threaded_histogram.h"
 
 namespace allpix {
     /**
      * @ingroup Modules
      * @brief Module to plot the final digitized pixel data
      *
-     * Generates a hitmap of all the produced pixel hits, together with a histogram of the cluster size
+     * Generates a hitmap of all the produced pixel hits, together with a histogram of the cluster size. The histograms are
+     * filled separately by every thread, such that several events can be processed at the same time.
      */
     class DetectorHistogrammerModule : public Module {
     public:
@@ -60,25 +65,41 @@ namespace allpix {
          */
         void finalize() override;
 
+        /**
+         * @brief Store the histograms and statistics filled so far with the checkpoint
+         * @param directory Directory of the checkpoint file for this module
+         */
+        void checkpoint(TDirectory* directory) override;
+
+        /**
+         * @brief Add the histograms and statistics of the checkpoint to continue filling them
+         * @param directory Directory of the checkpoint file for this module
+         */
+        void resume(TDirectory* directory) override;
+
     private:
         /**
-         * @brief Perform a sparse clustering on the PixelHits
+         * @brief Merge the histograms filled by all threads
+         * @return All merged histograms of this module
          */
-        std::vector<Cluster> doClustering();
+        std::vector<TH1*> merge_histograms();
 
         /**
          * @brief analyze the available MCParticles and return the all particles identified as primary (i.e. that do not have
          * a parent). This might be several particles.
+         * @param mc_particles MCParticles of the event
          */
-        std::vector<const MCParticle*> getPrimaryParticles() const;
+        static std::vector<const MCParticle*> getPrimaryParticles(const std::vector<MCParticle>& mc_particles);
 
         std::shared_ptr<Detector> detector_;
+        Messenger* messenger_;
 
-        // List of pixel hits and MC particles
+        // List of pixel hits and MC particles, only used to register the messages (fetched in the run method)
         std::shared_ptr<PixelHitMessage> pixels_message_;
         std::shared_ptr<MCParticleMessage> mcparticle_message_;
 
         // Statistics to compute mean position
+        std::mutex stats_mutex_;
         ROOT::Math::XYVector total_vector_{};
         unsigned long total_hits_{};
 
@@ -89,19 +110,19 @@ namespace allpix {
         ROOT::Math::XYVector track_resolution_{};
         std::mt19937_64 random_generator_;
 
-        // Histograms to output
-        TH2D *hit_map, *charge_map, *cluster_map;
-        TProfile2D *cluster_size_map, *cluster_size_x_map, *cluster_size_y_map;
-        TProfile2D *cluster_charge_map, *seed_charge_map;
-        TProfile2D *residual_map, *residual_x_map, *residual_y_map;
-        TH1D *residual_x, *residual_y;
-        TProfile *residual_x_vs_x, *residual_y_vs_y, *residual_x_vs_y, *residual_y_vs_x;
-        TProfile2D *efficiency_map, *efficiency_detector;
-        TProfile *efficiency_vs_x, *efficiency_vs_y;
-        TH1D* event_size;
-        TH1D *cluster_size, *cluster_size_x, *cluster_size_y;
-        TH1D* n_cluster;
-        TH1D* cluster_charge;
+        // Histograms to output, filled separately by every thread
+        std::unique_ptr<ThreadedHistogram<TH2D>> hit_map, charge_map, cluster_map;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> cluster_size_map, cluster_size_x_map, cluster_size_y_map;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> cluster_charge_map, seed_charge_map;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> residual_map, residual_x_map, residual_y_map;
+        std::unique_ptr<ThreadedHistogram<TH1D>> residual_x, residual_y;
+        std::unique_ptr<ThreadedHistogram<TProfile>> residual_x_vs_x, residual_y_vs_y, residual_x_vs_y, residual_y_vs_x;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> efficiency_map, efficiency_detector;
+        std::unique_ptr<ThreadedHistogram<TProfile>> efficiency_vs_x, efficiency_vs_y;
+        std::unique_ptr<ThreadedHistogram<TH1D>> event_size;
+        std::unique_ptr<ThreadedHistogram<TH1D>> cluster_size, cluster_size_x, cluster_size_y;
+        std::unique_ptr<ThreadedHistogram<TH1D>> n_cluster;
+        std::unique_ptr<ThreadedHistogram<TH1D>> cluster_charge;
     };
 } // namespace allpix
 
@@ -9,6 +9,7 @@
 
 #include "ElectricFieldReaderModule.hpp"
 
+#include <cmath>
 #include <fstream>
 #include <limits>
 #include <memory>
@@ -29,6 +30,9 @@ using namespace allpix;
 
 ElectricFieldReaderModule::ElectricFieldReaderModule(Configuration& config, Messenger*, std::shared_ptr<Detector> detector)
     : Module(config, detector), detector_(std::move(detector)) {
+    // Allow the instantiations for the different detectors to read their fields at the same time
+    enable_parallel_init();
+
     // NOTE use voltage as a synonym for bias voltage
     config_.setAlias("bias_voltage", "voltage");
 
@@ -87,10 +91,78 @@ void ElectricFieldReaderModule::init() {
         LOG(DEBUG) << "Electric field starts with offset " << offset << " to pixel boundary";
         std::array<double, 2> field_offset{{model->getPixelSize().x() * offset.x(), model->getPixelSize().y() * offset.y()}};
 
-        auto field_data = read_field(thickness_domain, field_scale);
+        // Select the interpolation between the grid points, defaulting to the nearest grid point
+        auto interpolation_name = config_.get<std::string>("interpolation", "nearest");
+        auto interpolation = FieldInterpolation::NEAREST;
+        if(interpolation_name == "linear") {
+            interpolation = FieldInterpolation::LINEAR;
+        } else if(interpolation_name != "nearest") {
+            throw InvalidValueError(config_, "interpolation", "interpolation should be 'nearest' or 'linear'");
+        }
+
+        // Select the precision used to store the grid values, defaulting to double precision
+        auto storage_name = config_.get<std::string>("storage", "double");
+        auto storage = FieldStorage::DOUBLE;
+        if(storage_name == "float") {
+            storage = FieldStorage::FLOAT;
+        } else if(storage_name == "half") {
+            storage = FieldStorage::HALF;
+        } else if(storage_name != "double") {
+            throw InvalidValueError(config_, "storage", "storage should be 'double', 'float' or 'half'");
+        }
+
+        // Select the layout of the grid values in memory, defaulting to the flat layout of the field file
+        auto layout_name = config_.get<std::string>("field_layout", "flat");
+        auto layout = FieldLayout::FLAT;
+        if(layout_name == "bricked") {
+            layout = FieldLayout::BRICKED;
+            LOG(DEBUG) << "Electric field grid is stored in bricks of 4x4x4 grid points";
+        } else if(layout_name != "flat") {
+            throw InvalidValueError(config_, "field_layout", "field layout should be 'flat' or 'bricked'");
+        }
+
+        // Select the symmetry of the field within the field cell, quadrant grids only cover half of the field scale
+        auto symmetry_name = config_.get<std::string>("field_symmetry", "none");
+        auto symmetry = FieldSymmetry::NONE;
+        auto grid_scale = field_scale;
+        if(symmetry_name == "quadrant") {
+            symmetry = FieldSymmetry::QUADRANT;
+            grid_scale = {{field_scale[0] / 2.0, field_scale[1] / 2.0}};
+            LOG(DEBUG) << "Electric field grid covers a quadrant of the field cell";
+        } else if(symmetry_name != "none") {
+            throw InvalidValueError(config_, "field_symmetry", "field symmetry should be 'none' or 'quadrant'");
+        }
 
-        detector_->setElectricFieldGrid(
-            field_data.getData(), field_data.getDimensions(), field_scale, field_offset, thickness_domain);
+        auto load_field =
+            [this, thickness_domain, field_scale, grid_scale, field_offset, interpolation, storage, symmetry, layout]() {
+                // Grids converted to another precision or layout do not use the parsed data after this call
+                auto keep_cached = (storage == FieldStorage::DOUBLE && layout == FieldLayout::FLAT);
+                auto field_data = read_field(thickness_domain, grid_scale, keep_cached);
+                detector_->setElectricFieldGrid(field_data.getValues(),
+                                                field_data.getValuesSize(),
+                                                field_data.getDimensions(),
+                                                field_scale,
+                                                field_offset,
+                                                thickness_domain,
+                                                interpolation,
+                                                storage,
+                                                symmetry,
+                                                layout);
+                add_time_slices(field_data);
+                add_refinements(field_data);
+            };
+
+        // Load the field right away or only at its first lookup
+        if(config_.get<bool>("lazy_loading", false)) {
+            LOG(INFO) << "Electric field will be loaded at its first lookup";
+            if(!is_memory_mapped(storage, layout)) {
+                LOG(WARNING) << "Lazy loading cannot bound the memory used by the electric field, which is kept in memory "
+                                "once loaded unless it is mapped from an APF2 file in double precision and flat layout";
+            }
+            detector_->setElectricFieldGridLoader(load_field, thickness_domain);
+        } else {
+            load_field();
+        }
     } else if(field_model == "constant") {
         LOG(TRACE) << "Adding constant electric field";
         type = FieldType::CONSTANT;
@@ -156,13 +228,15 @@ ElectricFieldReaderModule::get_linear_field_function(double depletion_voltage, s
  */
 FieldParser<double> ElectricFieldReaderModule::field_parser_(FieldQuantity::VECTOR);
 FieldData<double> ElectricFieldReaderModule::read_field(std::pair<double, double> thickness_domain,
-                                                        std::array<double, 2> field_scale) {
+                                                        std::array<double, 2> field_scale,
+                                                        bool keep_cached) {
 
     try {
         LOG(TRACE) << "Fetching electric field from mesh file";
 
         // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true), "V/cm");
+        auto field_data = field_parser_.getByFileName(
+            config_.getPath("file_name", true), "V/cm", config_.get<bool>("cache_init_file", false), keep_cached);
 
         // Check if electric field matches chip
         check_detector_match(field_data.getSize(), thickness_domain, field_scale);
@@ -181,6 +255,105 @@ FieldData<double> ElectricFieldReaderModule::read_field(std::pair<double, double
     }
 }
 
+/**
+ * Only APF2 files, including those cached for INIT files, are mapped into memory, and the mapping is only used directly if
+ * the field grid is neither converted to another precision nor reordered into another layout.
+ */
+bool ElectricFieldReaderModule::is_memory_mapped(FieldStorage storage, FieldLayout layout) {
+    if(storage != FieldStorage::DOUBLE || layout != FieldLayout::FLAT) {
+        return false;
+    }
+    try {
+        auto file_type = FieldParser<double>::getInfoByFileName(config_.getPath("file_name", true)).type;
+        return file_type == FileType::APF2 || (file_type == FileType::INIT && config_.get<bool>("cache_init_file", false));
+    } catch(std::runtime_error&) {
+        return false;
+    }
+}
+
+void ElectricFieldReaderModule::add_refinements(const FieldData<double>& field_data) {
+    if(!config_.has("refinement_file_name")) {
+        return;
+    }
+
+    auto file_names = config_.getPathArray("refinement_file_name", true);
+    auto begins = config_.getMatrix<size_t>("refinement_begin");
+    if(begins.size() != file_names.size()) {
+        throw InvalidValueError(
+            config_, "refinement_begin", "number of refined blocks does not match the number of refinement files");
+    }
+
+    for(size_t n = 0; n < file_names.size(); ++n) {
+        if(begins[n].size() != 3) {
+            throw InvalidValueError(config_, "refinement_begin", "first cell of refined blocks requires three indices");
+        }
+
+        try {
+            auto block_data =
+                field_parser_.getByFileName(file_names[n], "V/cm", config_.get<bool>("cache_init_file", false));
+
+            // Derive the number of cells of the field grid covered by the block from its size
+            std::array<size_t, 3> cells{};
+            for(size_t i = 0; i < 3; ++i) {
+                auto cell_size = field_data.getSize()[i] / static_cast<double>(field_data.getDimensions()[i]);
+                auto block_cells = block_data.getSize()[i] / cell_size;
+                if(std::fabs(block_cells - std::round(block_cells)) > 1e-3 || std::round(block_cells) < 1) {
+                    throw std::invalid_argument("size of refined block is not a multiple of the field grid cells");
+                }
+                cells[i] = static_cast<size_t>(std::round(block_cells));
+            }
+
+            detector_->addElectricFieldGridRefinement(block_data.getValues(),
+                                                      block_data.getValuesSize(),
+                                                      block_data.getDimensions(),
+                                                      {{begins[n][0], begins[n][1], begins[n][2]}},
+                                                      cells);
+            LOG(INFO) << "Refined " << cells[0] << "x" << cells[1] << "x" << cells[2] << " cells of electric field with "
+                      << block_data.getDimensions()[0] << "x" << block_data.getDimensions()[1] << "x"
+                      << block_data.getDimensions()[2] << " cells from " << file_names[n];
+        } catch(std::invalid_argument& e) {
+            throw InvalidValueError(config_, "refinement_file_name", e.what());
+        } catch(std::runtime_error& e) {
+            throw InvalidValueError(config_, "refinement_file_name", e.what());
+        } catch(std::bad_alloc& e) {
+            throw InvalidValueError(config_, "refinement_file_name", "file too large");
+        }
+    }
+}
+
+void ElectricFieldReaderModule::add_time_slices(const FieldData<double>& field_data) {
+    if(!config_.has("time_slice_file_name")) {
+        return;
+    }
+
+    auto file_names = config_.getPathArray("time_slice_file_name", true);
+    auto times = config_.getArray<double>("time_slice_times");
+    if(times.size() != file_names.size()) {
+        throw InvalidValueError(
+            config_, "time_slice_times", "number of times does not match the number of time slice files");
+    }
+
+    for(size_t n = 0; n < file_names.size(); ++n) {
+        try {
+            auto slice_data =
+                field_parser_.getByFileName(file_names[n], "V/cm", config_.get<bool>("cache_init_file", false));
+            if(slice_data.getDimensions() != field_data.getDimensions()) {
+                throw std::invalid_argument("dimensions of time slice do not match the electric field grid");
+            }
+
+            detector_->addElectricFieldTimeSlice(times[n], slice_data.getValues(), slice_data.getValuesSize());
+            LOG(INFO) << "Added time slice of electric field at " << Units::display(times[n], {"ns", "us"}) << " from "
+                      << file_names[n];
+        } catch(std::invalid_argument& e) {
+            throw InvalidValueError(config_, "time_slice_file_name", e.what());
+        } catch(std::runtime_error& e) {
+            throw InvalidValueError(config_, "time_slice_file_name", e.what());
+        } catch(std::bad_alloc& e) {
+            throw InvalidValueError(config_, "time_slice_file_name", "file too large");
+        }
+    }
+}
+
 void ElectricFieldReaderModule::create_output_plots() {
     LOG(TRACE) << "Creating output plots";
 
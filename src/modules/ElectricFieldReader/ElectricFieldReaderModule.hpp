@@ -57,10 +57,34 @@ namespace allpix {
          * @brief Read field from a file in init or apf format and apply it
          * @param thickness_domain Domain of the thickness where the field is defined
          * @param field_scale Scaling parameters for the field size in x and y
+         * @param keep_cached Keep the field data in the cache of the parser, only useful if the grid uses the data directly
          */
-        FieldData<double> read_field(std::pair<double, double> thickness_domain, std::array<double, 2> field_scale);
+        FieldData<double>
+        read_field(std::pair<double, double> thickness_domain, std::array<double, 2> field_scale, bool keep_cached);
         static FieldParser<double> field_parser_;
 
+        /**
+         * @brief Read the refined blocks of the field grid from their files and add them to the field
+         * @param field_data Field grid the blocks refine
+         *
+         * The number of cells of the field grid covered by a block is derived from the size of the block.
+         */
+        void add_refinements(const FieldData<double>& field_data);
+
+        /**
+         * @brief Read the time slices of the field grid from their files and add them to the field
+         * @param field_data Field grid at time zero, which the time slices have to match
+         */
+        void add_time_slices(const FieldData<double>& field_data);
+
+        /**
+         * @brief Check if the field grid is used directly from the memory mapping of its file
+         * @param storage Precision the field grid is stored in
+         * @param layout Layout the field grid is stored in
+         * @return True if the operating system can page out the field grid, false if it is copied into memory
+         */
+        bool is_memory_mapped(FieldStorage storage, FieldLayout layout);
+
         /**
          * @brief Create output plots of the electric field profile
          */
@@ -10,7 +10,11 @@
 
 #include "GenericPropagationModule.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <future>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
@@ -30,6 +34,7 @@
 #include <TPaveText.h>
 #include <TPolyLine3D.h>
 #include <TPolyMarker3D.h>
+#include <TROOT.h>
 #include <TStyle.h>
 
 #include "core/config/Configuration.hpp"
@@ -38,13 +43,104 @@
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
 #include "tools/ROOT.h"
+#include "tools/charge_grouping.h"
+#include "tools/normal_pool.h"
+#include "tools/pixel_accumulator.h"
 #include "tools/runge_kutta.h"
 
 #include "objects/DepositedCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
+#include "objects/PropagatedChargeArray.hpp"
 
 using namespace allpix;
 
+namespace {
+    // Append the propagated charges of a task to the output of the event
+    void append_propagated_charges(std::vector<PropagatedCharge>& output, std::vector<PropagatedCharge>& task_output) {
+        std::move(task_output.begin(), task_output.end(), std::back_inserter(output));
+    }
+    void append_propagated_charges(PropagatedChargeArray& output, PropagatedChargeArray& task_output) {
+        output.append(task_output);
+    }
+
+    /**
+     * @brief Transfer of propagated charges to the nearest pixel, used instead of a list of propagated charges
+     *
+     * Only the pixel, the charge and the deposit of every set of propagated charges within the implant range, the pixel grid
+     * and the region of interest are kept. The selection of the pixel is identical to the one of the SimpleTransfer module.
+     */
+    class PixelTransfer {
+    public:
+        struct Entry {
+            Pixel::Index index;
+            unsigned int charge;
+            const DepositedCharge* deposited_charge;
+        };
+
+        PixelTransfer(const Detector* detector, double max_depth_distance, bool collect_from_implant)
+            : detector_(detector), geometry_(detector->getGeometryView()), max_depth_distance_(max_depth_distance),
+              collect_from_implant_(collect_from_implant) {}
+
+        // Add a set of propagated charges with the same arguments as a columnar set without global positions
+        void emplace_back(const ROOT::Math::XYZPoint& local_position,
+                          CarrierType,
+                          unsigned int charge,
+                          double,
+                          const DepositedCharge* deposited_charge) {
+            if(std::fabs(local_position.z() - geometry_.getSensorTop()) > max_depth_distance_) {
+                return;
+            }
+            auto [xpixel, ypixel] = geometry_.getPixel(local_position);
+            if(!geometry_.isWithinPixelGrid(xpixel, ypixel) ||
+               (collect_from_implant_ && !geometry_.isWithinImplant(local_position))) {
+                return;
+            }
+            Pixel::Index index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel));
+            if(!detector_->isWithinRegionOfInterest(index)) {
+                return;
+            }
+            entries_.push_back({index, charge, deposited_charge});
+        }
+
+        void append(const PixelTransfer& other) {
+            entries_.insert(entries_.end(), other.entries_.begin(), other.entries_.end());
+        }
+
+        const std::vector<Entry>& getEntries() const { return entries_; }
+
+    private:
+        const Detector* detector_;
+        DetectorGeometryView geometry_;
+        double max_depth_distance_;
+        bool collect_from_implant_;
+
+        std::vector<Entry> entries_;
+    };
+    void append_propagated_charges(PixelTransfer& output, PixelTransfer& task_output) { output.append(task_output); }
+
+    // Add a set of propagated charges to the output, only objects require the global position to be computed right away
+    void add_to_output(std::vector<PropagatedCharge>& output,
+                       const Detector& detector,
+                       const ROOT::Math::XYZPoint& local_position,
+                       CarrierType type,
+                       unsigned int charge,
+                       double event_time,
+                       const DepositedCharge* deposited_charge) {
+        output.emplace_back(
+            local_position, detector.getGlobalPosition(local_position), type, charge, event_time, deposited_charge);
+    }
+    template <typename Output>
+    void add_to_output(Output& output,
+                       const Detector&,
+                       const ROOT::Math::XYZPoint& local_position,
+                       CarrierType type,
+                       unsigned int charge,
+                       double event_time,
+                       const DepositedCharge* deposited_charge) {
+        output.emplace_back(local_position, type, charge, event_time, deposited_charge);
+    }
+} // namespace
+
 /**
  * Besides binding the message and setting defaults for the configuration, the module copies some configuration variables to
  * local copies to speed up computation.
@@ -67,10 +163,15 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     config_.setDefault<double>("timestep_start", Units::get(0.01, "ns"));
     config_.setDefault<double>("timestep_min", Units::get(0.001, "ns"));
     config_.setDefault<double>("timestep_max", Units::get(0.5, "ns"));
+    config_.setDefault<bool>("timestep_error_control", false);
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<unsigned int>("charge_per_step", 10);
     config_.setDefault<double>("temperature", 293.15);
 
+    // By default all deposits are split into sets of the same maximum size
+    config_.setDefault<unsigned int>("max_charge_per_step", config_.get<unsigned int>("charge_per_step"));
+    config_.setDefault<double>("grouping_tolerance", 0.05);
+
     config_.setDefault<bool>("output_linegraphs", false);
     config_.setDefault<bool>("output_animations", false);
     config_.setDefault<bool>("output_plots",
@@ -82,6 +183,12 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     config_.setDefault<double>("output_plots_theta", 0.0f);
     config_.setDefault<double>("output_plots_phi", 0.0f);
     config_.setDefault<bool>("output_plots_lines_at_implants", false);
+    config_.setDefault<bool>("output_plots_use_equal_scaling", true);
+    config_.setDefault<double>("output_animations_time_scaling", 1e9);
+    config_.setDefault<double>("output_animations_marker_size", 1);
+    config_.setDefault<double>("output_animations_contour_max_scaling", 10);
+    config_.setDefault<bool>("output_plots_async", false);
+    config_.setDefault<unsigned int>("output_plots_queue_size", 4);
 
     // Set defaults for charge carrier propagation:
     config_.setDefault<bool>("propagate_electrons", true);
@@ -95,11 +202,56 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
 
     config_.setDefault<bool>("ignore_magnetic_field", false);
 
+    // By default the mobility is evaluated exactly for every step
+    config_.setDefault<double>("mobility_precision", 0);
+    config_.setDefault<double>("mobility_max_field", Units::get(100, "kV/cm"));
+
+    // By default all deposits of an event are propagated by the thread executing the module
+    config_.setDefault<unsigned int>("deposits_per_task", 0);
+
+    // By default every set of charge carriers is propagated on its own
+    config_.setDefault<bool>("batch_propagation", false);
+    config_.setDefault<std::string>("batch_precision", "double");
+
+    // By default the diffusion is computed from the electric field at the end of every step
+    config_.setDefault<bool>("diffusion_at_step_start", false);
+
+    // By default the diffusion is drawn from a normal distribution created for every step
+    config_.setDefault<bool>("pooled_diffusion", false);
+
+    // By default every set of charge carriers is propagated with its own drift and diffusion
+    config_.setDefault<bool>("drift_line_cache", false);
+    config_.setDefault<ROOT::Math::XYZVector>("drift_line_lattice",
+                                              {Units::get(5.0, "um"), Units::get(5.0, "um"), Units::get(5.0, "um")});
+    config_.setDefault<size_t>("drift_line_cache_size", 0);
+
+    // By default the propagated charges are dispatched as objects with their global positions
+    config_.setDefault<bool>("columnar_output", false);
+    config_.setDefault<bool>("defer_global_positions", false);
+
+    // By default the charge carriers are propagated on the host
+    config_.setDefault<std::string>("backend", "cpu");
+
+    // By default all propagated charges of an event are dispatched in a single message
+    config_.setDefault<unsigned int>("chunk_size", 0);
+
+    // By default all sets of charge carriers are propagated without thinning
+    config_.setDefault<unsigned int>("thinning_budget", 0);
+
+    // By default the propagated charges are not transferred to the pixels by this module
+    config_.setDefault<bool>("transfer_to_pixels", false);
+    config_.setDefault("max_depth_distance", Units::get(5.0, "um"));
+    config_.setDefault("collect_from_implant", false);
+
+    // By default deposits are only skipped if they are further away from the region of interest than the sensor thickness
+    config_.setDefault<double>("region_of_interest_margin", model_->getSensorSize().z());
+
     // Copy some variables from configuration to avoid lookups:
     temperature_ = config_.get<double>("temperature");
     timestep_min_ = config_.get<double>("timestep_min");
     timestep_max_ = config_.get<double>("timestep_max");
     timestep_start_ = config_.get<double>("timestep_start");
+    timestep_error_control_ = config_.get<bool>("timestep_error_control");
     integration_time_ = config_.get<double>("integration_time");
     target_spatial_precision_ = config_.get<double>("spatial_precision");
     output_plots_ = config_.get<bool>("output_plots");
@@ -107,20 +259,111 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     output_animations_ = config_.get<bool>("output_animations");
     output_plots_step_ = config_.get<double>("output_plots_step");
     output_plots_lines_at_implants_ = config_.get<bool>("output_plots_lines_at_implants");
+    output_plots_use_pixel_units_ = config_.get<bool>("output_plots_use_pixel_units");
+    output_plots_use_equal_scaling_ = config_.get<bool>("output_plots_use_equal_scaling");
+    output_plots_align_pixels_ = config_.get<bool>("output_plots_align_pixels");
+    output_plots_theta_ = config_.get<double>("output_plots_theta");
+    output_plots_phi_ = config_.get<double>("output_plots_phi");
+    output_animations_color_markers_ = config_.get<bool>("output_animations_color_markers");
+    output_animations_time_scaling_ = config_.get<double>("output_animations_time_scaling");
+    output_animations_marker_size_ = config_.get<double>("output_animations_marker_size");
+    output_animations_contour_max_scaling_ = config_.get<double>("output_animations_contour_max_scaling");
+    deposits_per_task_ = config_.get<unsigned int>("deposits_per_task");
+    batch_propagation_ = config_.get<bool>("batch_propagation");
+    auto batch_precision = config_.get<std::string>("batch_precision");
+    if(batch_precision == "float") {
+        batch_float_ = true;
+    } else if(batch_precision != "double") {
+        throw InvalidValueError(config_, "batch_precision", "precision should be 'double' or 'float'");
+    }
+    diffusion_at_step_start_ = config_.get<bool>("diffusion_at_step_start");
+    pooled_diffusion_ = config_.get<bool>("pooled_diffusion");
+    drift_line_cache_ = config_.get<bool>("drift_line_cache");
+    drift_line_lattice_ = config_.get<ROOT::Math::XYZVector>("drift_line_lattice");
+    drift_line_cache_size_ = config_.get<size_t>("drift_line_cache_size");
+    columnar_output_ = config_.get<bool>("columnar_output");
+    defer_global_positions_ = config_.get<bool>("defer_global_positions");
+    chunk_size_ = config_.get<unsigned int>("chunk_size");
+    thinning_budget_ = config_.get<unsigned int>("thinning_budget");
+    auto backend = config_.get<std::string>("backend");
+    if(backend == "offload") {
+        offload_backend_ = true;
+    } else if(backend != "cpu") {
+        throw InvalidValueError(config_, "backend", "unknown backend, use 'cpu' or 'offload'");
+    }
+    transfer_to_pixels_ = config_.get<bool>("transfer_to_pixels");
+    max_depth_distance_ = config_.get<double>("max_depth_distance");
+    collect_from_implant_ = config_.get<bool>("collect_from_implant");
+    config_.bind("propagate_electrons", propagate_electrons_);
+    config_.bind("propagate_holes", propagate_holes_);
+    config_.bind("charge_per_step", charge_per_step_);
+    max_charge_per_step_ = config_.get<unsigned int>("max_charge_per_step");
+    grouping_tolerance_ = config_.get<double>("grouping_tolerance");
+    region_of_interest_margin_ = config_.get<double>("region_of_interest_margin");
+    if(max_charge_per_step_ < charge_per_step_) {
+        throw InvalidValueError(config_, "max_charge_per_step", "should not be smaller than charge_per_step");
+    }
+
+    // Line graphs are filled during the propagation and cannot be shared between tasks
+    if(deposits_per_task_ > 0 && output_linegraphs_) {
+        throw InvalidCombinationError(config_,
+                                      {"deposits_per_task", "output_linegraphs"},
+                                      "The propagation cannot be split into tasks if line graphs are produced");
+    }
+
+    // Line graphs are filled per set of charge carriers, which are not propagated one after another in batches
+    if(batch_propagation_ && output_linegraphs_) {
+        throw InvalidCombinationError(config_,
+                                      {"batch_propagation", "output_linegraphs"},
+                                      "Line graphs cannot be produced if the charge carriers are propagated in batches");
+    }
+
+    // Line graphs are filled on the host, while the offload backend propagates all sets of an event at once
+    if(offload_backend_ && output_linegraphs_) {
+        throw InvalidCombinationError(
+            config_, {"backend", "output_linegraphs"}, "Line graphs cannot be produced with the offload backend");
+    }
+
+    // Cached drift lines replace the propagation of the individual sets, which is neither done in batches nor drawn
+    if(drift_line_cache_) {
+        if(drift_line_lattice_.x() <= 0 || drift_line_lattice_.y() <= 0 || drift_line_lattice_.z() <= 0) {
+            throw InvalidValueError(config_, "drift_line_lattice", "spacing of the lattice has to be positive");
+        }
+        if(batch_propagation_ || offload_backend_) {
+            throw InvalidCombinationError(config_,
+                                          {"drift_line_cache", "batch_propagation", "backend"},
+                                          "Cached drift lines cannot be combined with batch propagation or offloading");
+        }
+        if(output_linegraphs_) {
+            throw InvalidCombinationError(config_,
+                                          {"drift_line_cache", "output_linegraphs"},
+                                          "Line graphs cannot be produced from cached drift lines");
+        }
+    }
+
+    // The sets of all detectors of a batch group are collected at once and propagated together in batches
+    if(config_.has("batch_group")) {
+        if(!batch_propagation_ || offload_backend_) {
+            throw InvalidCombinationError(config_,
+                                          {"batch_group", "batch_propagation", "backend"},
+                                          "Batch groups require batch propagation on the host");
+        }
+        if(deposits_per_task_ > 0 || chunk_size_ > 0) {
+            throw InvalidCombinationError(config_,
+                                          {"batch_group", "deposits_per_task", "chunk_size"},
+                                          "The deposits of a batch group cannot be split into tasks or chunks");
+        }
+    }
 
-    // Enable parallelization of this module if multithreading is enabled and no per-event output plots are requested:
+    // Enable parallelization of this module if multithreading is enabled and no per-event output plots are requested. The
+    // histograms are filled per thread, such that also several events can be propagated at the same time.
     if(!(output_animations_ || output_linegraphs_)) {
         enable_parallelization();
+        enable_event_parallelization();
     }
 
-    // Parameterization variables from https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2)
-    electron_Vm_ = Units::get(1.53e9 * std::pow(temperature_, -0.87), "cm/s");
-    electron_Ec_ = Units::get(1.01 * std::pow(temperature_, 1.55), "V/cm");
-    electron_Beta_ = 2.57e-2 * std::pow(temperature_, 0.66);
-
-    hole_Vm_ = Units::get(1.62e8 * std::pow(temperature_, -0.52), "cm/s");
-    hole_Ec_ = Units::get(1.24 * std::pow(temperature_, 1.68), "V/cm");
-    hole_Beta_ = 0.46 * std::pow(temperature_, 0.17);
+    // Mobility parameterization for the configured temperature
+    mobility_ = JacoboniCanaliMobility(temperature_);
 
     boltzmann_kT_ = Units::get(8.6173e-5, "eV/K") * temperature_;
 
@@ -130,13 +373,20 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     hole_Hall_ = 0.9;
 }
 
-void GenericPropagationModule::create_output_plots(unsigned int event_num) {
+/**
+ * The plots are only created from the recorded drift lines and the cached configuration parameters, such that they can be
+ * rendered by the thread of the asynchronous tasks while the next events are propagated.
+ */
+void GenericPropagationModule::create_output_plots(unsigned int event_num,
+                                                   std::vector<OutputPlotLine>& output_plot_lines,
+                                                   const std::array<std::string, 4>& file_names) const {
     LOG(TRACE) << "Writing output plots";
+    const std::string axis_unit = (output_plots_use_pixel_units_ ? "(pixels)" : "(mm)");
 
     // Convert to pixel units if necessary
-    if(config_.get<bool>("output_plots_use_pixel_units")) {
-        for(auto& deposit_points : output_plot_points_) {
-            for(auto& point : deposit_points.second) {
+    if(output_plots_use_pixel_units_) {
+        for(auto& plot_line : output_plot_lines) {
+            for(auto& point : plot_line.points) {
                 point.SetX(point.x() / model_->getPixelSize().x());
                 point.SetY(point.y() / model_->getPixelSize().y());
             }
@@ -150,26 +400,26 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     double start_time = std::numeric_limits<double>::max();
     unsigned int total_charge = 0;
     unsigned int max_charge = 0;
-    for(auto& deposit_points : output_plot_points_) {
-        for(auto& point : deposit_points.second) {
+    for(auto& plot_line : output_plot_lines) {
+        for(auto& point : plot_line.points) {
             minX = std::min(minX, point.x());
             maxX = std::max(maxX, point.x());
 
             minY = std::min(minY, point.y());
             maxY = std::max(maxY, point.y());
         }
-        start_time = std::min(start_time, deposit_points.first.getEventTime());
-        total_charge += deposit_points.first.getCharge();
-        max_charge = std::max(max_charge, deposit_points.first.getCharge());
+        start_time = std::min(start_time, plot_line.event_time);
+        total_charge += plot_line.charge;
+        max_charge = std::max(max_charge, plot_line.charge);
 
-        tot_point_cnt += deposit_points.second.size();
+        tot_point_cnt += plot_line.points.size();
     }
 
     // Compute frame axis sizes if equal scaling is requested
-    if(config_.get<bool>("output_plots_use_equal_scaling", true)) {
+    if(output_plots_use_equal_scaling_) {
         double centerX = (minX + maxX) / 2.0;
         double centerY = (minY + maxY) / 2.0;
-        if(config_.get<bool>("output_plots_use_pixel_units")) {
+        if(output_plots_use_pixel_units_) {
             minX = centerX - model_->getSensorSize().z() / model_->getPixelSize().x() / 2.0;
             maxX = centerX + model_->getSensorSize().z() / model_->getPixelSize().x() / 2.0;
 
@@ -185,8 +435,8 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     }
 
     // Align on pixels if requested
-    if(config_.get<bool>("output_plots_align_pixels")) {
-        if(config_.get<bool>("output_plots_use_pixel_units")) {
+    if(output_plots_align_pixels_) {
+        if(output_plots_use_pixel_units_) {
             minX = std::floor(minX - 0.5) + 0.5;
             minY = std::floor(minY + 0.5) - 0.5;
             maxX = std::ceil(maxX - 0.5) + 0.5;
@@ -205,18 +455,18 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     }
 
     // Use a histogram to create the underlying frame
-    auto* histogram_frame = new TH3F(("frame_" + getUniqueName() + "_" + std::to_string(event_num)).c_str(),
-                                     "",
-                                     10,
-                                     minX,
-                                     maxX,
-                                     10,
-                                     minY,
-                                     maxY,
-                                     10,
-                                     model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0,
-                                     model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0);
-    histogram_frame->SetDirectory(getROOTDirectory());
+    auto histogram_frame = std::make_unique<TH3F>(("frame_" + getUniqueName() + "_" + std::to_string(event_num)).c_str(),
+                                                  "",
+                                                  10,
+                                                  minX,
+                                                  maxX,
+                                                  10,
+                                                  minY,
+                                                  maxY,
+                                                  10,
+                                                  model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0,
+                                                  model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0);
+    histogram_frame->SetDirectory(nullptr);
 
     // Create the canvas for the line plot and set orientation
     auto canvas = std::make_unique<TCanvas>(("line_plot_" + std::to_string(event_num)).c_str(),
@@ -224,14 +474,12 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
                                             1280,
                                             1024);
     canvas->cd();
-    canvas->SetTheta(config_.get<float>("output_plots_theta") * 180.0f / ROOT::Math::Pi());
-    canvas->SetPhi(config_.get<float>("output_plots_phi") * 180.0f / ROOT::Math::Pi());
+    canvas->SetTheta(output_plots_theta_ * 180.0 / ROOT::Math::Pi());
+    canvas->SetPhi(output_plots_phi_ * 180.0 / ROOT::Math::Pi());
 
     // Draw the frame on the canvas
-    histogram_frame->GetXaxis()->SetTitle(
-        (std::string("x ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)")).c_str());
-    histogram_frame->GetYaxis()->SetTitle(
-        (std::string("y ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)")).c_str());
+    histogram_frame->GetXaxis()->SetTitle(("x " + axis_unit).c_str());
+    histogram_frame->GetYaxis()->SetTitle(("y " + axis_unit).c_str());
     histogram_frame->GetZaxis()->SetTitle("z (mm)");
     histogram_frame->Draw();
 
@@ -239,14 +487,14 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     // The vector of unique_pointers is required in order not to delete the objects before the canvas is drawn.
     std::vector<std::unique_ptr<TPolyLine3D>> lines;
     short current_color = 1;
-    for(auto& deposit_points : output_plot_points_) {
+    for(auto& plot_line : output_plot_lines) {
         auto line = std::make_unique<TPolyLine3D>();
-        for(auto& point : deposit_points.second) {
+        for(auto& point : plot_line.points) {
             line->SetNextPoint(point.x(), point.y(), point.z());
         }
         // Plot all lines with at least three points with different color
         if(line->GetN() >= 3) {
-            EColor plot_color = (deposit_points.first.getType() == CarrierType::ELECTRON ? EColor::kAzure : EColor::kOrange);
+            EColor plot_color = (plot_line.type == CarrierType::ELECTRON ? EColor::kAzure : EColor::kOrange);
             current_color = static_cast<short int>(plot_color - 9 + (static_cast<int>(current_color) + 1) % 19);
             line->SetLineColor(current_color);
             line->Draw("same");
@@ -256,7 +504,7 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
 
     // Draw and write canvas to module output file, then clear the stored lines
     canvas->Draw();
-    getROOTDirectory()->WriteTObject(canvas.get());
+    writeROOTObject(canvas.get());
     lines.clear();
 
     // Create canvas for GIF animition of process
@@ -267,10 +515,10 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     canvas->cd();
 
     // Change axis labels if close to zero or PI as they behave different here
-    if(std::fabs(config_.get<double>("output_plots_theta") / (ROOT::Math::Pi() / 2.0) -
-                 std::round(config_.get<double>("output_plots_theta") / (ROOT::Math::Pi() / 2.0))) < 1e-6 ||
-       std::fabs(config_.get<double>("output_plots_phi") / (ROOT::Math::Pi() / 2.0) -
-                 std::round(config_.get<double>("output_plots_phi") / (ROOT::Math::Pi() / 2.0))) < 1e-6) {
+    if(std::fabs(output_plots_theta_ / (ROOT::Math::Pi() / 2.0) -
+                 std::round(output_plots_theta_ / (ROOT::Math::Pi() / 2.0))) < 1e-6 ||
+       std::fabs(output_plots_phi_ / (ROOT::Math::Pi() / 2.0) -
+                 std::round(output_plots_phi_ / (ROOT::Math::Pi() / 2.0))) < 1e-6) {
         histogram_frame->GetXaxis()->SetLabelOffset(-0.1f);
         histogram_frame->GetYaxis()->SetLabelOffset(-0.075f);
     } else {
@@ -283,41 +531,46 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
 
     if(output_animations_) {
         // Create the contour histogram
+        auto sensor_min_z = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
+        auto sensor_max_z = model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0;
+        auto contour_name = [&](char axis) {
+            return "contour" + std::string(1, axis) + "_" + getUniqueName() + "_" + std::to_string(event_num);
+        };
         std::vector<std::string> file_name_contour;
-        std::vector<TH2F*> histogram_contour;
-        file_name_contour.push_back(createOutputFile("contourX" + std::to_string(event_num) + ".gif"));
-        histogram_contour.push_back(new TH2F(("contourX_" + getUniqueName() + "_" + std::to_string(event_num)).c_str(),
-                                             "",
-                                             100,
-                                             minY,
-                                             maxY,
-                                             100,
-                                             model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0,
-                                             model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0));
-        histogram_contour.back()->SetDirectory(getROOTDirectory());
-        file_name_contour.push_back(createOutputFile("contourY" + std::to_string(event_num) + ".gif"));
-        histogram_contour.push_back(new TH2F(("contourY_" + getUniqueName() + "_" + std::to_string(event_num)).c_str(),
-                                             "",
-                                             100,
-                                             minX,
-                                             maxX,
-                                             100,
-                                             model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0,
-                                             model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0));
-        histogram_contour.back()->SetDirectory(getROOTDirectory());
-        file_name_contour.push_back(createOutputFile("contourZ" + std::to_string(event_num) + ".gif"));
-        histogram_contour.push_back(new TH2F(("contourZ_" + getUniqueName() + "_" + std::to_string(event_num)).c_str(),
-                                             "",
-                                             100,
-                                             minX,
-                                             maxX,
-                                             100,
-                                             minY,
-                                             maxY));
-        histogram_contour.back()->SetDirectory(getROOTDirectory());
+        std::vector<std::unique_ptr<TH2F>> histogram_contour;
+        file_name_contour.push_back(file_names[1]);
+        histogram_contour.push_back(std::make_unique<TH2F>(contour_name('X').c_str(),
+                                                           "",
+                                                           100,
+                                                           minY,
+                                                           maxY,
+                                                           100,
+                                                           sensor_min_z,
+                                                           sensor_max_z));
+        histogram_contour.back()->SetDirectory(nullptr);
+        file_name_contour.push_back(file_names[2]);
+        histogram_contour.push_back(std::make_unique<TH2F>(contour_name('Y').c_str(),
+                                                           "",
+                                                           100,
+                                                           minX,
+                                                           maxX,
+                                                           100,
+                                                           sensor_min_z,
+                                                           sensor_max_z));
+        histogram_contour.back()->SetDirectory(nullptr);
+        file_name_contour.push_back(file_names[3]);
+        histogram_contour.push_back(std::make_unique<TH2F>(contour_name('Z').c_str(),
+                                                           "",
+                                                           100,
+                                                           minX,
+                                                           maxX,
+                                                           100,
+                                                           minY,
+                                                           maxY));
+        histogram_contour.back()->SetDirectory(nullptr);
 
         // Create file and disable statistics for histogram
-        std::string file_name_anim = createOutputFile("animation" + std::to_string(event_num) + ".gif");
+        const auto& file_name_anim = file_names[0];
         for(size_t i = 0; i < 3; ++i) {
             histogram_contour[i]->SetStats(false);
         }
@@ -343,8 +596,8 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
 
         // Create animation of moving charges
         auto animation_time = static_cast<unsigned int>(
-            std::round((Units::convert(config_.get<long double>("output_plots_step"), "ms") / 10.0) *
-                       config_.get<long double>("output_animations_time_scaling", 1e9)));
+            std::round((Units::convert(output_plots_step_, "ms") / 10.0) *
+                       output_animations_time_scaling_));
         unsigned long plot_idx = 0;
         unsigned int point_cnt = 0;
         LOG_PROGRESS(INFO, getUniqueName() + "_OUTPUT_PLOTS") << "Written 0 of " << tot_point_cnt << " points for animation";
@@ -354,21 +607,19 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
 
             // Reset the canvas
             canvas->Clear();
-            canvas->SetTheta(config_.get<float>("output_plots_theta") * 180.0f / ROOT::Math::Pi());
-            canvas->SetPhi(config_.get<float>("output_plots_phi") * 180.0f / ROOT::Math::Pi());
+            canvas->SetTheta(output_plots_theta_ * 180.0 / ROOT::Math::Pi());
+            canvas->SetPhi(output_plots_phi_ * 180.0 / ROOT::Math::Pi());
             canvas->Draw();
 
             // Reset the histogram frame
             histogram_frame->SetTitle("Charge propagation in sensor");
-            histogram_frame->GetXaxis()->SetTitle(
-                (std::string("x ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)")).c_str());
-            histogram_frame->GetYaxis()->SetTitle(
-                (std::string("y ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)")).c_str());
+            histogram_frame->GetXaxis()->SetTitle(("x " + axis_unit).c_str());
+            histogram_frame->GetYaxis()->SetTitle(("y " + axis_unit).c_str());
             histogram_frame->GetZaxis()->SetTitle("z (mm)");
             histogram_frame->Draw();
 
             auto text = std::make_unique<TPaveText>(-0.75, -0.75, -0.60, -0.65);
-            auto time_ns = Units::convert(plot_idx * config_.get<long double>("output_plots_step"), "ns");
+            auto time_ns = Units::convert(plot_idx * output_plots_step_, "ns");
             std::stringstream sstr;
             sstr << std::fixed << std::setprecision(2) << time_ns << "ns";
             auto time_str = std::string(8 - sstr.str().size(), ' ');
@@ -377,11 +628,11 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
             text->Draw();
 
             // Plot all the required points
-            for(auto& deposit_points : output_plot_points_) {
-                auto points = deposit_points.second;
+            for(auto& plot_line : output_plot_lines) {
+                const auto& points = plot_line.points;
 
-                auto diff = static_cast<unsigned long>(std::round((deposit_points.first.getEventTime() - start_time) /
-                                                                  config_.get<long double>("output_plots_step")));
+                auto diff = static_cast<unsigned long>(std::round((plot_line.event_time - start_time) /
+                                                                  output_plots_step_));
                 if(static_cast<long>(plot_idx) - static_cast<long>(diff) < 0) {
                     min_idx_diff = std::min(min_idx_diff, diff - plot_idx);
                     continue;
@@ -394,22 +645,21 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
 
                 auto marker = std::make_unique<TPolyMarker3D>();
                 marker->SetMarkerStyle(kFullCircle);
-                marker->SetMarkerSize(static_cast<float>(deposit_points.first.getCharge() *
-                                                         config_.get<double>("output_animations_marker_size", 1)) /
+                marker->SetMarkerSize(static_cast<float>(plot_line.charge * output_animations_marker_size_) /
                                       static_cast<float>(max_charge));
                 auto initial_z_perc = static_cast<int>(
                     ((points[0].z() + model_->getSensorSize().z() / 2.0) / model_->getSensorSize().z()) * 80);
                 initial_z_perc = std::max(std::min(79, initial_z_perc), 0);
-                if(config_.get<bool>("output_animations_color_markers")) {
+                if(output_animations_color_markers_) {
                     marker->SetMarkerColor(static_cast<Color_t>(colors[initial_z_perc]->GetNumber()));
                 }
                 marker->SetNextPoint(points[idx].x(), points[idx].y(), points[idx].z());
                 marker->Draw();
                 markers.push_back(std::move(marker));
 
-                histogram_contour[0]->Fill(points[idx].y(), points[idx].z(), deposit_points.first.getCharge());
-                histogram_contour[1]->Fill(points[idx].x(), points[idx].z(), deposit_points.first.getCharge());
-                histogram_contour[2]->Fill(points[idx].x(), points[idx].y(), deposit_points.first.getCharge());
+                histogram_contour[0]->Fill(points[idx].y(), points[idx].z(), plot_line.charge);
+                histogram_contour[1]->Fill(points[idx].x(), points[idx].z(), plot_line.charge);
+                histogram_contour[2]->Fill(points[idx].x(), points[idx].y(), plot_line.charge);
                 ++point_cnt;
             }
 
@@ -433,30 +683,21 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
                                          .c_str());
                     switch(i) {
                     case 0 /* x */:
-                        histogram_contour[i]->GetXaxis()->SetTitle(
-                            (std::string("y ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)"))
-                                .c_str());
+                        histogram_contour[i]->GetXaxis()->SetTitle(("y " + axis_unit).c_str());
                         histogram_contour[i]->GetYaxis()->SetTitle("z (mm)");
                         break;
                     case 1 /* y */:
-                        histogram_contour[i]->GetXaxis()->SetTitle(
-                            (std::string("x ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)"))
-                                .c_str());
+                        histogram_contour[i]->GetXaxis()->SetTitle(("x " + axis_unit).c_str());
                         histogram_contour[i]->GetYaxis()->SetTitle("z (mm)");
                         break;
                     case 2 /* z */:
-                        histogram_contour[i]->GetXaxis()->SetTitle(
-                            (std::string("x ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)"))
-                                .c_str());
-                        histogram_contour[i]->GetYaxis()->SetTitle(
-                            (std::string("y ") + (config_.get<bool>("output_plots_use_pixel_units") ? "(pixels)" : "(mm)"))
-                                .c_str());
+                        histogram_contour[i]->GetXaxis()->SetTitle(("x " + axis_unit).c_str());
+                        histogram_contour[i]->GetYaxis()->SetTitle(("y " + axis_unit).c_str());
                         break;
                     default:;
                     }
                     histogram_contour[i]->SetMinimum(1);
-                    histogram_contour[i]->SetMaximum(total_charge /
-                                                     config_.get<double>("output_animations_contour_max_scaling", 10));
+                    histogram_contour[i]->SetMaximum(total_charge / output_animations_contour_max_scaling_);
                     histogram_contour[i]->Draw("CONTZ 0");
                     if(point_cnt < tot_point_cnt - 1) {
                         canvas->Print((file_name_contour[i] + "+" + std::to_string(animation_time)).c_str());
@@ -472,19 +713,37 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
             LOG_PROGRESS(INFO, getUniqueName() + "_OUTPUT_PLOTS")
                 << "Written " << point_cnt << " of " << tot_point_cnt << " points for animation";
         }
+
+        for(auto& histogram : histogram_contour) {
+            writeROOTObject(histogram.get());
+        }
     }
-    output_plot_points_.clear();
+
+    // The histograms are not attached to the output directory by the thread rendering the plots, but written explicitly
+    writeROOTObject(histogram_frame.get());
 }
 
 void GenericPropagationModule::init() {
 
     auto detector = getDetector();
+    geometry_ = detector->getGeometryView();
 
     // Check for electric field and output warning for slow propagation if not defined
     if(!detector->hasElectricField()) {
         LOG(WARNING) << "This detector does not have an electric field.";
     }
 
+    // Precompute the mobility table if requested
+    auto mobility_precision = config_.get<double>("mobility_precision");
+    if(mobility_precision > 0) {
+        if(!mobility_.tabulate(config_.get<double>("mobility_max_field"), mobility_precision)) {
+            throw InvalidValueError(
+                config_, "mobility_precision", "precision of the mobility table cannot be reached, increase the value");
+        }
+        LOG(DEBUG) << "Interpolating mobility from table with " << mobility_.getTableBins() << " bins up to "
+                   << Units::display(config_.get<double>("mobility_max_field"), "V/cm");
+    }
+
     // For linear fields we can in addition check if the correct carriers are propagated
     if(detector->getElectricFieldType() == FieldType::LINEAR) {
         auto model = detector_->getModel();
@@ -504,6 +763,30 @@ void GenericPropagationModule::init() {
         }
     }
 
+    // Only create the propagated charges when transferring to the pixels directly if any module listens to them
+    if(transfer_to_pixels_) {
+        if(collect_from_implant_ && detector->getElectricFieldType() == FieldType::LINEAR) {
+            throw InvalidValueError(config_,
+                                    "collect_from_implant",
+                                    "charge collection from implant region should not be used with linear electric fields");
+        }
+
+        dispatch_propagated_charges_ = (columnar_output_
+                                            ? messenger_->hasReceiver<PropagatedChargeArrayMessage>(this, detector_)
+                                            : messenger_->hasReceiver<PropagatedChargeMessage>(this, detector_));
+        if(!dispatch_propagated_charges_) {
+            LOG(INFO) << "Transferring charges to pixels without creating propagated charges, as there is no listener";
+        }
+    }
+
+    // Chunks are dispatched as separate messages, which have to be accepted by all receivers of the event
+    if(chunk_size_ > 0 && dispatch_propagated_charges_ &&
+       (columnar_output_ ? messenger_->hasSingleReceiver<PropagatedChargeArrayMessage>(this, detector_)
+                         : messenger_->hasSingleReceiver<PropagatedChargeMessage>(this, detector_))) {
+        throw InvalidValueError(
+            config_, "chunk_size", "propagated charges are received by a module accepting only a single message per event");
+    }
+
     // Check for magnetic field
     has_magnetic_field_ = detector->hasMagneticField();
     if(has_magnetic_field_) {
@@ -513,128 +796,832 @@ void GenericPropagationModule::init() {
         } else {
             LOG(DEBUG) << "This detector sees a magnetic field.";
             magnetic_field_ = detector_->getMagneticField();
+            has_magnetic_field_grid_ = detector_->hasMagneticFieldGrid();
         }
     }
 
+    // The lateral drift in the magnetic field is not accounted for when grouping the carriers
+    if(has_magnetic_field_ && max_charge_per_step_ > charge_per_step_) {
+        LOG(WARNING) << "Carriers are not grouped adaptively in a magnetic field, using charge_per_step for all deposits";
+        max_charge_per_step_ = charge_per_step_;
+    }
+
+    // Time-dependent fields are only looked up at the time of every carrier when propagating the sets one by one, and the
+    // grouping only probes the field at the time of the deposit
+    if((batch_propagation_ || max_charge_per_step_ > charge_per_step_) && detector->hasTimeDependentElectricField()) {
+        if(batch_propagation_) {
+            throw InvalidValueError(
+                config_, "batch_propagation", "time-dependent electric fields are not supported by batch propagation");
+        }
+        LOG(WARNING) << "Carriers are not grouped adaptively in a time-dependent electric field, using charge_per_step for "
+                        "all deposits";
+        max_charge_per_step_ = charge_per_step_;
+    }
+    if(batch_propagation_) {
+        LOG(DEBUG) << "Propagating charge carriers in batches in " << (batch_float_ ? "single" : "double") << " precision";
+    }
+
+    // Drift lines are integrated once for all events and cannot follow a field changing within the event
+    if(drift_line_cache_ && detector->hasTimeDependentElectricField()) {
+        throw InvalidValueError(
+            config_, "drift_line_cache", "time-dependent electric fields are not supported by cached drift lines");
+    }
+
+    // Propagate the sets together with the identical detectors of the batch group. The magnetic field is given in the local
+    // coordinates of every detector and thus differs between detectors of different orientation.
+    if(config_.has("batch_group")) {
+        if(has_magnetic_field_) {
+            throw InvalidValueError(config_, "batch_group", "magnetic fields are not supported by batch groups");
+        }
+        join_batch_group(config_.get<std::string>("batch_group"));
+    }
+
+    // Copy the electric field grid to the accelerator once and set up the parameters of the offload backend
+    if(offload_backend_) {
+        if(has_magnetic_field_) {
+            throw InvalidValueError(config_, "backend", "magnetic fields are not supported by the offload backend");
+        }
+        if(mobility_.isTabulated()) {
+            throw InvalidCombinationError(config_,
+                                          {"backend", "mobility_precision"},
+                                          "the tabulated mobility is not supported by the offload backend");
+        }
+        auto& parameters = offload_parameters_;
+        if(!detector_->getElectricFieldGridView(parameters.field)) {
+            throw InvalidValueError(config_,
+                                    "backend",
+                                    "the offload backend requires a static full electric field grid in double precision "
+                                    "and the flat layout");
+        }
+        offload_field(parameters.field);
+
+        auto sensor_center = model_->getSensorCenter();
+        auto sensor_size = model_->getSensorSize();
+        parameters.sensor_center = {sensor_center.x(), sensor_center.y(), sensor_center.z()};
+        parameters.sensor_size = {sensor_size.x(), sensor_size.y(), sensor_size.z()};
+        parameters.boltzmann_kT = boltzmann_kT_;
+        parameters.integration_time = integration_time_;
+        parameters.timestep_start = timestep_start_;
+        parameters.timestep_min = timestep_min_;
+        parameters.timestep_max = timestep_max_;
+        parameters.target_spatial_precision = target_spatial_precision_;
+        parameters.timestep_error_control = timestep_error_control_;
+        parameters.diffusion_at_step_start = diffusion_at_step_start_;
+        for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+            auto index = (type == CarrierType::ELECTRON ? 0 : 1);
+            parameters.zero_field_mobility[index] = mobility_.getZeroFieldMobility(type);
+            parameters.critical_field[index] = mobility_.getCriticalField(type);
+            parameters.beta[index] = mobility_.getBeta(type);
+        }
+        LOG(INFO) << "Propagating charge carriers with the offload backend on "
+                  << (offload_device_available() ? "the accelerator" : "the host, no accelerator is available");
+    }
+
     if(output_plots_) {
-        step_length_histo_ = new TH1D("step_length_histo",
-                                      "Step length;length [#mum];integration steps",
-                                      100,
-                                      0,
-                                      static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
-
-        drift_time_histo_ = new TH1D("drift_time_histo",
-                                     "Drift time;Drift time [ns];charge carriers",
-                                     static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                     0,
-                                     static_cast<double>(Units::convert(integration_time_, "ns")));
-
-        uncertainty_histo_ =
-            new TH1D("uncertainty_histo",
-                     "Position uncertainty;uncertainty [nm];integration steps",
-                     100,
-                     0,
-                     static_cast<double>(4 * Units::convert(config_.get<double>("spatial_precision"), "nm")));
-
-        group_size_histo_ = new TH1D("group_size_histo",
-                                     "Charge carrier group size;group size;number of groups trasnported",
-                                     config_.get<int>("charge_per_step") - 1,
-                                     1,
-                                     static_cast<double>(config_.get<unsigned int>("charge_per_step")));
+        step_length_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "step_length_histo",
+            "Step length;length [#mum];integration steps",
+            100,
+            0,
+            static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
+
+        drift_time_histo_ =
+            std::make_unique<ThreadedHistogram<TH1D>>("drift_time_histo",
+                                                      "Drift time;Drift time [ns];charge carriers",
+                                                      static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+                                                      0,
+                                                      static_cast<double>(Units::convert(integration_time_, "ns")));
+
+        uncertainty_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "uncertainty_histo",
+            "Position uncertainty;uncertainty [nm];integration steps",
+            100,
+            0,
+            static_cast<double>(4 * Units::convert(config_.get<double>("spatial_precision"), "nm")));
+
+        group_size_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "group_size_histo",
+            "Charge carrier group size;group size;number of groups trasnported",
+            static_cast<int>(max_charge_per_step_) - 1,
+            1,
+            static_cast<double>(max_charge_per_step_));
+    }
+
+    // Render the per-event output plots on a dedicated thread if requested, while the next events are propagated
+    if(output_linegraphs_ && config_.get<bool>("output_plots_async")) {
+        auto queue_size = config_.get<size_t>("output_plots_queue_size");
+        if(queue_size == 0) {
+            throw InvalidValueError(config_, "output_plots_queue_size", "queue size should be larger than zero");
+        }
+        // The canvases and histograms are created by another thread than the one executing the module
+        ROOT::EnableThreadSafety();
+        LOG(DEBUG) << "Rendering output plots asynchronously with a queue of " << queue_size << " events";
+        enable_async_tasks(queue_size);
     }
 }
 
 void GenericPropagationModule::run(unsigned int event_num) {
+    // Fetch the deposits of the current event
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this);
+
+    // Use a random generator for this event only if the modules are seeded for every event. Members of a batch group are
+    // always seeded for every event, such that the member collecting the sets of the group draws the same random numbers.
+    std::mt19937_64 event_random_generator;
+    bool event_seeding = has_event_seeding() || batch_group_ != nullptr;
+    if(event_seeding) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = event_seeding ? event_random_generator : random_generator_;
+
+    // Propagate all deposits and dispatch the propagated charges in the requested form
+    PropagationSummary summary;
+    const auto& deposits = deposits_message->getData();
+    PixelTransfer pixel_transfer(detector_.get(), max_depth_distance_, collect_from_implant_);
+
+    // Propagate the batched sets in chunks instead of collecting all of them once the memory budget of the event is exceeded
+    auto max_batch_sets = std::numeric_limits<size_t>::max();
+    if(batch_propagation_ && getEventMemoryBudget() > 0 && getEventMemoryUsage() > getEventMemoryBudget()) {
+        max_batch_sets = batch_chunk_sets_;
+        LOG(INFO) << "Memory budget of the event exceeded, propagating batches of at most " << max_batch_sets << " sets";
+    }
 
-    // Create vector of propagated charges to output
-    std::vector<PropagatedCharge> propagated_charges;
+    // Thin out the sets of charge carriers if the event exceeds the budget, estimated from the charge per step
+    size_t total_sets = 0;
+    auto keep_fraction = get_keep_fraction(deposits, total_sets);
+    if(keep_fraction < 1.0) {
+        LOG(INFO) << "Thinning " << total_sets << " sets of charge carriers to a budget of " << thinning_budget_
+                  << " sets, propagating a fraction of " << keep_fraction << " with scaled charges";
+    }
 
-    // Loop over all deposits for propagation
-    LOG(TRACE) << "Propagating charges in sensor";
-    unsigned int propagated_charges_count = 0;
-    unsigned int step_count = 0;
-    long double total_time = 0;
-    for(auto& deposit : deposits_message_->getData()) {
-
-        if((deposit.getType() == CarrierType::ELECTRON && !config_.get<bool>("propagate_electrons")) ||
-           (deposit.getType() == CarrierType::HOLE && !config_.get<bool>("propagate_holes"))) {
-            LOG(DEBUG) << "Skipping charge carriers (" << deposit.getType() << ") on "
-                       << Units::display(deposit.getLocalPosition(), {"mm", "um"});
-            continue;
+    // Propagate a range of deposits and dispatch a message with their propagated charges
+    size_t first_task = 0;
+    auto propagate_chunk = [&](size_t begin, size_t end) {
+        if(!dispatch_propagated_charges_) {
+            // Transfer the propagated charges to the pixels directly without creating them
+            propagate_event(deposits,
+                            begin,
+                            end,
+                            first_task,
+                            random_generator,
+                            pixel_transfer,
+                            summary,
+                            max_batch_sets,
+                            keep_fraction);
+            return;
         }
 
-        // Loop over all charges in the deposit
-        unsigned int charges_remaining = deposit.getCharge();
+        std::shared_ptr<BaseMessage> propagated_charge_message;
+        if(columnar_output_) {
+            PropagatedChargeArray propagated_charges;
+            propagate_event(deposits,
+                            begin,
+                            end,
+                            first_task,
+                            random_generator,
+                            propagated_charges,
+                            summary,
+                            max_batch_sets,
+                            keep_fraction);
+
+            // Convert all positions to the global frame at once, unless deferred until the objects are requested
+            if(!defer_global_positions_) {
+                std::vector<double> global_x, global_y, global_z;
+                detector_->getGlobalPositions(propagated_charges.getLocalX(),
+                                              propagated_charges.getLocalY(),
+                                              propagated_charges.getLocalZ(),
+                                              global_x,
+                                              global_y,
+                                              global_z);
+                propagated_charges.setGlobalPositions(std::move(global_x), std::move(global_y), std::move(global_z));
+            }
 
-        LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
-                   << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+            if(transfer_to_pixels_) {
+                for(size_t i = 0; i < propagated_charges.size(); ++i) {
+                    pixel_transfer.emplace_back(propagated_charges.getLocalPosition(i),
+                                                propagated_charges.getTypes()[i],
+                                                propagated_charges.getCharges()[i],
+                                                propagated_charges.getEventTimes()[i],
+                                                propagated_charges.getDepositedCharges()[i]);
+                }
+            }
+            propagated_charge_message =
+                std::make_shared<PropagatedChargeArrayMessage>(std::move(propagated_charges), detector_);
+        } else {
+            auto propagated_charges = MessageDataPool<PropagatedCharge>::acquire();
+            propagate_event(deposits,
+                            begin,
+                            end,
+                            first_task,
+                            random_generator,
+                            propagated_charges,
+                            summary,
+                            max_batch_sets,
+                            keep_fraction);
+            if(transfer_to_pixels_) {
+                for(auto& propagated_charge : propagated_charges) {
+                    pixel_transfer.emplace_back(propagated_charge.getLocalPosition(),
+                                                propagated_charge.getType(),
+                                                propagated_charge.getCharge(),
+                                                propagated_charge.getEventTime(),
+                                                propagated_charge.getDepositedCharge());
+                }
+            }
+            propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+        }
 
-        auto charge_per_step = config_.get<unsigned int>("charge_per_step");
-        while(charges_remaining > 0) {
-            // Define number of charges to be propagated and remove charges of this step from the total
-            if(charge_per_step > charges_remaining) {
-                charge_per_step = charges_remaining;
+        // Dispatch the message with propagated charges
+        messenger_->dispatchMessage(this, propagated_charge_message);
+    };
+
+    if(chunk_size_ == 0 || !dispatch_propagated_charges_) {
+        propagate_chunk(0, deposits.size());
+    } else {
+        // Split the deposits into chunks of at most the requested number of sets, estimated from the charge per step. A
+        // deposit is never split, such that a single deposit with more sets forms a chunk of its own.
+        size_t begin = 0;
+        size_t chunk_sets = 0;
+        unsigned int chunks = 0;
+        for(size_t i = 0; i < deposits.size(); ++i) {
+            size_t deposit_sets = (deposits[i].getCharge() + charge_per_step_ - 1) / charge_per_step_;
+            if(i > begin && chunk_sets + deposit_sets > chunk_size_) {
+                propagate_chunk(begin, i);
+                ++chunks;
+                begin = i;
+                chunk_sets = 0;
             }
-            charges_remaining -= charge_per_step;
+            chunk_sets += deposit_sets;
+        }
+        propagate_chunk(begin, deposits.size());
+        ++chunks;
+        LOG(DEBUG) << "Dispatched propagated charges of " << deposits.size() << " deposits in " << chunks << " chunks";
+    }
+
+    // Output plots if required, the recorded drift lines are handed over such that they can be rendered asynchronously
+    if(output_linegraphs_) {
+        std::array<std::string, 4> file_names;
+        if(output_animations_) {
+            auto event_str = std::to_string(event_num);
+            file_names = {{createOutputFile("animation" + event_str + ".gif"),
+                           createOutputFile("contourX" + event_str + ".gif"),
+                           createOutputFile("contourY" + event_str + ".gif"),
+                           createOutputFile("contourZ" + event_str + ".gif")}};
+        }
+        run_async([this, event_num, output_plot_lines = std::move(output_plot_lines_), file_names]() mutable {
+            create_output_plots(event_num, output_plot_lines, file_names);
+            // Only counted by the tasks, which are executed one after the other
+            ++rendered_plots_;
+        });
+        output_plot_lines_.clear();
+    }
+
+    // Write summary and update statistics
+    long double average_time = summary.total_time / std::max(1u, summary.propagated_charges);
+    LOG(INFO) << "Propagated " << summary.propagated_charges << " charges in " << summary.steps
+              << " steps in average time of " << Units::display(average_time, "ns");
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        total_propagated_charges_ += summary.propagated_charges;
+        total_steps_ += summary.steps;
+        total_saved_sets_ += summary.saved_sets;
+        total_skipped_charges_ += summary.skipped_charges;
+        total_thinned_sets_ += summary.thinned_sets;
+        total_cached_sets_ += summary.cached_sets;
+        total_drift_line_misses_ += summary.drift_line_misses;
+        thinned_events_ += (keep_fraction < 1.0 ? 1 : 0);
+        total_time_ += summary.total_time;
+        total_counters_ += summary.counters;
+        for(const auto& [name, value] : total_counters_.getValues()) {
+            setMetric(name, value);
+        }
+        if(detector_->hasRegionOfInterest()) {
+            setMetric("skipped_charges", total_skipped_charges_);
+        }
+        if(thinning_budget_ > 0) {
+            setMetric("thinned_sets", total_thinned_sets_);
+        }
+        if(drift_line_cache_) {
+            setMetric("drift_line_lookups", total_cached_sets_);
+            setMetric("drift_line_misses", total_drift_line_misses_);
+        }
+    }
+
+    if(!transfer_to_pixels_) {
+        return;
+    }
+
+    // Combine the transferred charges at the same pixel, linking them to the Monte-Carlo particles of their deposits
+    LOG(TRACE) << "Combining charges at same pixel";
+    unsigned int transferred_charges_count = 0;
+    thread_local PixelAccumulator<std::pair<unsigned int, const DepositedCharge*>> pixel_map;
+    pixel_map.reset(model_->getNPixels());
+    for(auto& entry : pixel_transfer.getEntries()) {
+        transferred_charges_count += entry.charge;
+        pixel_map.add(entry.index, {entry.charge, entry.deposited_charge});
+    }
+
+    auto pixel_charges = MessageDataPool<PixelCharge>::acquire();
+    std::vector<const DepositedCharge*> pixel_deposited_charges;
+    pixel_map.forEachPixel([&](const Pixel::Index& pixel_index, auto begin, auto end) {
+        unsigned int charge = 0;
+        pixel_deposited_charges.clear();
+        for(auto iter = begin; iter != end; ++iter) {
+            charge += iter->first;
+            if(has_object_history()) {
+                pixel_deposited_charges.push_back(iter->second);
+            }
+        }
+
+        auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+        pixel_charges.emplace_back(pixel, charge, pixel_deposited_charges);
+        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+    });
+
+    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_charges.size() << " pixels";
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        total_transferred_charges_ += transferred_charges_count;
+    }
+
+    // Dispatch message of pixel charges
+    auto pixel_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    messenger_->dispatchMessage(this, pixel_message);
+}
 
+double GenericPropagationModule::get_keep_fraction(const std::vector<DepositedCharge>& deposits, size_t& total_sets) const {
+    total_sets = 0;
+    if(thinning_budget_ == 0) {
+        return 1.0;
+    }
+    for(const auto& deposit : deposits) {
+        if(((deposit.getType() == CarrierType::ELECTRON && propagate_electrons_) ||
+            (deposit.getType() == CarrierType::HOLE && propagate_holes_)) &&
+           detector_->isNearRegionOfInterest(deposit.getLocalPosition(), region_of_interest_margin_)) {
+            total_sets += (deposit.getCharge() + charge_per_step_ - 1) / charge_per_step_;
+        }
+    }
+    if(total_sets <= thinning_budget_) {
+        return 1.0;
+    }
+    return static_cast<double>(thinning_budget_) / static_cast<double>(total_sets);
+}
+
+/**
+ * The deposits are either propagated directly by the calling thread, or split into tasks of fixed size executed by the
+ * thread pool. The propagated charges are appended to the output in the order of the deposits in both cases.
+ */
+template <typename Output>
+void GenericPropagationModule::propagate_event(const std::vector<DepositedCharge>& deposits,
+                                               size_t begin,
+                                               size_t end,
+                                               size_t& first_task,
+                                               std::mt19937_64& random_generator,
+                                               Output& propagated_charges,
+                                               PropagationSummary& summary,
+                                               size_t max_batch_sets,
+                                               double keep_fraction) {
+    // Loop over all deposits for propagation
+    LOG(TRACE) << "Propagating charges in sensor";
+    if(deposits_per_task_ == 0) {
+        propagate_deposits(
+            deposits, begin, end, random_generator, propagated_charges, summary, max_batch_sets, keep_fraction);
+    } else {
+        // Split the deposits into tasks of fixed size. Every task uses its own random generator seeded from the random
+        // stream of the task, which makes the result independent of the number of threads and the order of execution.
+        auto tasks_num = (end - begin + deposits_per_task_ - 1) / deposits_per_task_;
+        std::vector<uint64_t> seeds;
+        for(size_t task = 0; task < tasks_num; ++task) {
+            seeds.push_back(getRandomStream(first_task + task)());
+        }
+        // Every task fills its own copy of the output, which is still empty at this point
+        std::vector<Output> task_propagated_charges(tasks_num, propagated_charges);
+        std::vector<PropagationSummary> task_summaries(tasks_num);
+        parallel_for(begin, end, deposits_per_task_, [&](size_t task_begin, size_t task_end, size_t task) {
+            std::mt19937_64 task_random_generator(seeds[task]);
+            propagate_deposits(deposits,
+                               task_begin,
+                               task_end,
+                               task_random_generator,
+                               task_propagated_charges[task],
+                               task_summaries[task],
+                               max_batch_sets,
+                               keep_fraction);
+        });
+
+        // Collect the results in the order of the deposits
+        for(size_t task = 0; task < tasks_num; ++task) {
+            append_propagated_charges(propagated_charges, task_propagated_charges[task]);
+            summary.propagated_charges += task_summaries[task].propagated_charges;
+            summary.steps += task_summaries[task].steps;
+            summary.saved_sets += task_summaries[task].saved_sets;
+            summary.skipped_charges += task_summaries[task].skipped_charges;
+            summary.thinned_sets += task_summaries[task].thinned_sets;
+            summary.cached_sets += task_summaries[task].cached_sets;
+            summary.drift_line_misses += task_summaries[task].drift_line_misses;
+            summary.total_time += task_summaries[task].total_time;
+            summary.counters += task_summaries[task].counters;
+        }
+        first_task += tasks_num;
+    }
+}
+
+/**
+ * All charges of the deposits in the given range are propagated in sets of at most charge_per_step carriers. The propagated
+ * charges are appended to the output in the order of the deposits. If batch propagation is enabled, all sets are collected
+ * first and then propagated together in batches.
+ */
+template <typename Output>
+void GenericPropagationModule::propagate_deposits(const std::vector<DepositedCharge>& deposits,
+                                                  size_t begin,
+                                                  size_t end,
+                                                  std::mt19937_64& random_generator,
+                                                  Output& propagated_charges,
+                                                  PropagationSummary& summary,
+                                                  size_t max_batch_sets,
+                                                  double keep_fraction) {
+    // Create a new propagated charge from the result of the propagation and add it to the list
+    auto add_propagated_charge = [&](const DepositedCharge& deposit,
+                                     unsigned int charge,
+                                     const std::pair<ROOT::Math::XYZPoint, double>& prop_pair) {
+        const auto& position = prop_pair.first;
+
+        LOG(DEBUG) << " Propagated " << charge << " to " << Units::display(position, {"mm", "um"}) << " in "
+                   << Units::display(prop_pair.second, "ns") << " time";
+
+        add_to_output(propagated_charges,
+                      *detector_,
+                      position,
+                      deposit.getType(),
+                      charge,
+                      deposit.getEventTime() + prop_pair.second,
+                      &deposit);
+
+        // Update statistical information
+        ++summary.steps;
+        summary.propagated_charges += charge;
+        summary.total_time += charge * prop_pair.second;
+        if(output_plots_) {
+            drift_time_histo_->fill(static_cast<double>(Units::convert(prop_pair.second, "ns")), charge);
+            group_size_histo_->fill(charge);
+        }
+    };
+
+    // Sets of charge carriers collected for batch propagation, which are propagated together and added in order. The sets of
+    // a batch group are propagated in the common batch of all members of the group instead.
+    std::vector<std::pair<const DepositedCharge*, unsigned int>> charge_sets;
+    std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>> carriers;
+    auto propagate_collected = [&]() {
+        auto results = (batch_group_ != nullptr ? take_group_results(carriers, max_batch_sets, summary.counters)
+                        : offload_backend_      ? propagate_offload(carriers, random_generator)
+                                                : propagate_batch(carriers, random_generator, summary.counters));
+        for(size_t i = 0; i < charge_sets.size(); ++i) {
+            add_propagated_charge(*charge_sets[i].first, charge_sets[i].second, results[i]);
+        }
+        charge_sets.clear();
+        carriers.clear();
+    };
+
+    for(size_t i = begin; i < end; ++i) {
+        const auto& deposit = deposits[i];
+        split_deposit(deposit, random_generator, summary, keep_fraction, [&](unsigned int set_charge) {
             // Get position and propagate through sensor
             auto position = deposit.getLocalPosition();
 
+            // Propagate the set later together with all others if batch propagation or the offload backend is requested
+            if(batch_propagation_ || offload_backend_) {
+                charge_sets.emplace_back(&deposit, set_charge);
+                carriers.emplace_back(position, deposit.getType());
+                if(carriers.size() >= max_batch_sets && batch_group_ == nullptr) {
+                    propagate_collected();
+                }
+                return;
+            }
+
             // Add point of deposition to the output plots if requested
             if(output_linegraphs_) {
-                auto global_position = detector_->getGlobalPosition(position);
-                output_plot_points_.emplace_back(
-                    PropagatedCharge(position, global_position, deposit.getType(), charge_per_step, deposit.getEventTime()),
-                    std::vector<ROOT::Math::XYZPoint>());
-            }
-
-            // Propagate a single charge deposit
-            auto prop_pair = propagate(position, deposit.getType());
-            position = prop_pair.first;
-
-            LOG(DEBUG) << " Propagated " << charge_per_step << " to " << Units::display(position, {"mm", "um"}) << " in "
-                       << Units::display(prop_pair.second, "ns") << " time";
-
-            // Create a new propagated charge and add it to the list
-            auto global_position = detector_->getGlobalPosition(position);
-            PropagatedCharge propagated_charge(position,
-                                               global_position,
-                                               deposit.getType(),
-                                               charge_per_step,
-                                               deposit.getEventTime() + prop_pair.second,
-                                               &deposit);
-
-            propagated_charges.push_back(std::move(propagated_charge));
-
-            // Update statistical information
-            ++step_count;
-            propagated_charges_count += charge_per_step;
-            total_time += charge_per_step * prop_pair.second;
-            if(output_plots_) {
-                drift_time_histo_->Fill(static_cast<double>(Units::convert(prop_pair.second, "ns")), charge_per_step);
-                group_size_histo_->Fill(charge_per_step);
+                output_plot_lines_.push_back({deposit.getType(), set_charge, deposit.getEventTime(), {}});
+            }
+
+            // Propagate a single charge deposit, or move it along the cached drift line if requested
+            if(drift_line_cache_) {
+                auto prop_pair = propagate_cached(position, deposit.getType(), random_generator, summary);
+                add_propagated_charge(deposit, set_charge, prop_pair);
+                return;
             }
+            auto prop_pair =
+                propagate(position, deposit.getType(), deposit.getEventTime(), random_generator, summary.counters);
+            add_propagated_charge(deposit, set_charge, prop_pair);
+        });
+    }
+
+    // Propagate all remaining sets in batches and add them in order of the deposits
+    if(!carriers.empty()) {
+        propagate_collected();
+    }
+}
+
+/**
+ * Deposits of carrier types which are not propagated, or which cannot reach the region of interest, are skipped. The
+ * charge carriers of the remaining deposits are split into sets of at most charge_per_step carriers, or of up to
+ * max_charge_per_step carriers if they drift uniformly, and thinned out if requested.
+ */
+template <typename F>
+void GenericPropagationModule::split_deposit(const DepositedCharge& deposit,
+                                             std::mt19937_64& random_generator,
+                                             PropagationSummary& summary,
+                                             double keep_fraction,
+                                             F&& propagate_set) {
+    if((deposit.getType() == CarrierType::ELECTRON && !propagate_electrons_) ||
+       (deposit.getType() == CarrierType::HOLE && !propagate_holes_)) {
+        LOG(DEBUG) << "Skipping charge carriers (" << deposit.getType() << ") on "
+                   << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+        return;
+    }
+
+    // Skip deposits which cannot reach the region of interest of the detector
+    if(!detector_->isNearRegionOfInterest(deposit.getLocalPosition(), region_of_interest_margin_)) {
+        LOG(DEBUG) << "Skipping charge carriers outside of the region of interest on "
+                   << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+        summary.skipped_charges += deposit.getCharge();
+        return;
+    }
+
+    // Loop over all charges in the deposit
+    unsigned int charges_remaining = deposit.getCharge();
+
+    LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
+               << Units::display(deposit.getLocalPosition(), {"mm", "um"});
+
+    // Merge the carriers into larger sets if they drift uniformly and stay within the pixel they are deposited below
+    auto charge_per_step = charge_per_step_;
+    if(max_charge_per_step_ > charge_per_step_ &&
+       is_uniform_drift(*detector_, deposit.getLocalPosition(), deposit.getType(), boltzmann_kT_, grouping_tolerance_)) {
+        charge_per_step = max_charge_per_step_;
+        summary.saved_sets += (charges_remaining + charge_per_step_ - 1) / charge_per_step_ -
+                              (charges_remaining + max_charge_per_step_ - 1) / max_charge_per_step_;
+        LOG(DEBUG) << "Propagating carriers in sets of up to " << charge_per_step << " charges";
+    }
+    while(charges_remaining > 0) {
+        // Define number of charges to be propagated and remove charges of this step from the total
+        if(charge_per_step > charges_remaining) {
+            charge_per_step = charges_remaining;
+        }
+        charges_remaining -= charge_per_step;
+
+        // Propagate only a random subset of the sets when thinning, scaling their charge by the inverse fraction. The
+        // scaled charge is rounded stochastically, such that the expected total charge is conserved.
+        auto set_charge = charge_per_step;
+        if(keep_fraction < 1.0) {
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            if(uniform(random_generator) >= keep_fraction) {
+                ++summary.thinned_sets;
+                continue;
+            }
+            auto scaled_charge = static_cast<double>(charge_per_step) / keep_fraction;
+            auto rounded_charge = std::floor(scaled_charge);
+            set_charge = static_cast<unsigned int>(rounded_charge) +
+                         (uniform(random_generator) < scaled_charge - rounded_charge ? 1u : 0u);
         }
+
+        propagate_set(set_charge);
     }
+}
 
-    // Output plots if required
-    if(output_linegraphs_) {
-        create_output_plots(event_num);
+/**
+ * Members are kept in the order of the names of their detectors, such that the leader of the group does not depend on the
+ * order in which the modules are initialized. The group is only kept alive by its members, such that a new group is created
+ * for every simulation.
+ */
+void GenericPropagationModule::join_batch_group(const std::string& name) {
+    static std::mutex registry_mutex;
+    static std::map<std::string, std::weak_ptr<BatchGroup>> registry;
+    {
+        std::lock_guard<std::mutex> registry_lock(registry_mutex);
+        batch_group_ = registry[name].lock();
+        if(batch_group_ == nullptr) {
+            batch_group_ = std::make_shared<BatchGroup>();
+            registry[name] = batch_group_;
+        }
     }
 
-    // Write summary and update statistics
-    long double average_time = total_time / std::max(1u, propagated_charges_count);
-    LOG(INFO) << "Propagated " << propagated_charges_count << " charges in " << step_count << " steps in average time of "
-              << Units::display(average_time, "ns");
-    total_propagated_charges_ += propagated_charges_count;
-    total_steps_ += step_count;
-    total_time_ += total_time;
-
-    // Create a new message with propagated charges
-    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
-
-    // Dispatch the message with propagated charges
-    messenger_->dispatchMessage(this, propagated_charge_message);
+    std::lock_guard<std::mutex> lock(batch_group_->mutex);
+    for(const auto* member : batch_group_->members) {
+        auto member_name = member->detector_->getName();
+        if(member->model_->getType() != model_->getType()) {
+            throw InvalidValueError(config_,
+                                    "batch_group",
+                                    "detector model '" + model_->getType() + "' differs from model '" +
+                                        member->model_->getType() + "' of detector '" + member_name + "' in the group");
+        }
+
+        // Compare the electric fields, fields given as full grids have to contain identical values
+        FieldGridView field, member_field;
+        auto has_grid = detector_->getElectricFieldGridView(field);
+        auto member_has_grid = member->detector_->getElectricFieldGridView(member_field);
+        if(detector_->getElectricFieldType() != member->detector_->getElectricFieldType() || has_grid != member_has_grid ||
+           (has_grid && field.values != member_field.values &&
+            (field.size != member_field.size || field.dimensions != member_field.dimensions ||
+             !std::equal(field.values, field.values + field.size, member_field.values)))) {
+            throw InvalidValueError(
+                config_, "batch_group", "electric field differs from the field of detector '" + member_name + "'");
+        }
+
+        // The sets of all members are propagated with the parameters of the leader
+        for(const auto* key : {"temperature",
+                               "integration_time",
+                               "timestep_start",
+                               "timestep_min",
+                               "timestep_max",
+                               "timestep_error_control",
+                               "spatial_precision",
+                               "diffusion_at_step_start",
+                               "pooled_diffusion",
+                               "mobility_precision",
+                               "batch_precision"}) {
+            if(config_.getText(key) != member->config_.getText(key)) {
+                throw InvalidValueError(
+                    config_, key, "differs from the value of detector '" + member_name + "' in the same batch group");
+            }
+        }
+    }
+    batch_group_->members.push_back(this);
+    std::sort(batch_group_->members.begin(), batch_group_->members.end(), [](const auto* a, const auto* b) {
+        return a->detector_->getName() < b->detector_->getName();
+    });
+    LOG(DEBUG) << "Propagating charge carriers together with the detectors of batch group '" << name << "'";
+}
+
+/**
+ * The event of the group is identified by the event seed of the leader, which is identical for all members. The results of
+ * every member are removed once taken, and the event is removed from the group once all members with sets in the event have
+ * taken their results.
+ */
+std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+GenericPropagationModule::take_group_results(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                                             size_t max_batch_sets,
+                                             PropagationCounters& counters) {
+    auto* leader = batch_group_->members.front();
+    auto event_key = leader->getEventSeed();
+
+    // Claim the propagation of the group in this event if no other member has done so yet
+    std::shared_ptr<BatchGroupEvent> group_event;
+    bool claimed = false;
+    {
+        std::lock_guard<std::mutex> lock(batch_group_->mutex);
+        auto& entry = batch_group_->events[event_key];
+        if(entry == nullptr) {
+            entry = std::make_shared<BatchGroupEvent>();
+            entry->ready = entry->promise.get_future().share();
+            claimed = true;
+        }
+        group_event = entry;
+    }
+    if(claimed) {
+        try {
+            propagate_group(*group_event, max_batch_sets);
+            group_event->promise.set_value();
+        } catch(...) {
+            group_event->promise.set_exception(std::current_exception());
+        }
+    }
+
+    // Wait for the batch to be propagated, rethrowing any error of the member propagating the group
+    group_event->ready.get();
+
+    std::lock_guard<std::mutex> lock(batch_group_->mutex);
+    auto results = std::move(group_event->results[this]);
+    group_event->results.erase(this);
+    if(this == leader) {
+        counters += group_event->counters;
+    }
+    if(group_event->results.empty()) {
+        batch_group_->events.erase(event_key);
+    }
+    if(results.size() != carriers.size()) {
+        throw ModuleError("Propagated " + std::to_string(results.size()) + " sets in the batch group instead of " +
+                          std::to_string(carriers.size()));
+    }
+    return results;
+}
+
+/**
+ * The sets of every member are collected from its deposits with the random generator of its event, drawing the same random
+ * numbers as the member itself. All sets are propagated in local coordinates with the parameters and the random stream of
+ * the leader of the group, such that the result does not depend on the member propagating the group.
+ */
+void GenericPropagationModule::propagate_group(BatchGroupEvent& group_event, size_t max_batch_sets) {
+    std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>> carriers;
+    std::vector<std::pair<const GenericPropagationModule*, size_t>> member_sets;
+    for(auto* member : batch_group_->members) {
+        auto message = messenger_->fetchMessage<DepositedChargeMessage>(member);
+        if(message == nullptr) {
+            continue;
+        }
+
+        const auto& deposits = message->getData();
+        std::mt19937_64 member_random_generator(member->getEventSeed());
+        PropagationSummary member_summary;
+        size_t total_sets = 0;
+        auto keep_fraction = member->get_keep_fraction(deposits, total_sets);
+        auto begin = carriers.size();
+        for(const auto& deposit : deposits) {
+            member->split_deposit(deposit, member_random_generator, member_summary, keep_fraction, [&](unsigned int) {
+                carriers.emplace_back(deposit.getLocalPosition(), deposit.getType());
+            });
+        }
+        if(carriers.size() > begin) {
+            member_sets.emplace_back(member, carriers.size() - begin);
+        }
+    }
+    LOG(DEBUG) << "Propagating " << carriers.size() << " sets of charge carriers of " << member_sets.size()
+               << " detectors in a common batch";
+
+    // Propagate the sets in batches of at most the maximum number of sets and distribute the results to the members
+    auto* leader = batch_group_->members.front();
+    std::mt19937_64 batch_random_generator(leader->getRandomStream(0)());
+    std::vector<std::pair<ROOT::Math::XYZPoint, double>> results;
+    unsigned long batches = 0;
+    for(size_t begin = 0; begin < carriers.size(); begin += max_batch_sets) {
+        auto end = begin + std::min(max_batch_sets, carriers.size() - begin);
+        std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>> batch(
+            carriers.begin() + static_cast<std::ptrdiff_t>(begin), carriers.begin() + static_cast<std::ptrdiff_t>(end));
+        auto batch_results = leader->propagate_batch(batch, batch_random_generator, group_event.counters);
+        results.insert(results.end(), batch_results.begin(), batch_results.end());
+        ++batches;
+    }
+
+    std::lock_guard<std::mutex> lock(batch_group_->mutex);
+    auto result = results.begin();
+    for(const auto& [member, sets] : member_sets) {
+        group_event.results[member].assign(result, result + static_cast<std::ptrdiff_t>(sets));
+        result += static_cast<std::ptrdiff_t>(sets);
+    }
+    batch_group_->batches += batches;
+    batch_group_->sets += carriers.size();
+}
+
+/**
+ * The lattice starts at the lower corner of the sensor. The key of a drift line combines the carrier type and the indices of
+ * the lattice cell with 21 bits each, covering more than a million cells in every dimension.
+ */
+std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate_cached(const ROOT::Math::XYZPoint& pos,
+                                                                                   const CarrierType& type,
+                                                                                   std::mt19937_64& random_generator,
+                                                                                   PropagationSummary& summary) {
+    auto sensor_min = model_->getSensorCenter() - model_->getSensorSize() / 2.0;
+    auto index = [](double offset, double spacing) {
+        return std::min(static_cast<uint64_t>(std::max(std::floor(offset / spacing), 0.0)), (uint64_t(1) << 21u) - 1);
+    };
+    auto ix = index(pos.x() - sensor_min.x(), drift_line_lattice_.x());
+    auto iy = index(pos.y() - sensor_min.y(), drift_line_lattice_.y());
+    auto iz = index(pos.z() - sensor_min.z(), drift_line_lattice_.z());
+    uint64_t key = (static_cast<uint64_t>(type == CarrierType::ELECTRON) << 63u) | (ix << 42u) | (iy << 21u) | iz;
+
+    // Look up the drift line, integrating it without diffusion on first use. Drift lines of cells whose center is outside
+    // the sensor, such as the last cell if the sensor size is not a multiple of the spacing, start at the deposit instead.
+    ++summary.cached_sets;
+    DriftLine line{};
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(drift_lines_mutex_);
+        auto it = drift_line_index_.find(key);
+        if(it != drift_line_index_.end()) {
+            // Move the drift line to the front of the list as the most recently used
+            drift_lines_.splice(drift_lines_.begin(), drift_lines_, it->second);
+            line = it->second->second;
+            cached = true;
+        }
+    }
+    if(!cached) {
+        ROOT::Math::XYZPoint start(sensor_min.x() + (static_cast<double>(ix) + 0.5) * drift_line_lattice_.x(),
+                                   sensor_min.y() + (static_cast<double>(iy) + 0.5) * drift_line_lattice_.y(),
+                                   sensor_min.z() + (static_cast<double>(iz) + 0.5) * drift_line_lattice_.z());
+        if(!geometry_.isWithinSensor(start)) {
+            start = pos;
+        }
+        double variance = 0;
+        auto drift = propagate(start, type, 0, random_generator, summary.counters, &variance);
+        line = {start, drift.first, drift.second, variance};
+        ++summary.drift_line_misses;
+
+        // Another thread may have integrated the same drift line in the meantime, which is then kept
+        std::lock_guard<std::mutex> lock(drift_lines_mutex_);
+        if(drift_line_index_.find(key) == drift_line_index_.end()) {
+            drift_lines_.emplace_front(key, line);
+            drift_line_index_.emplace(key, drift_lines_.begin());
+            if(drift_line_cache_size_ > 0 && drift_lines_.size() > drift_line_cache_size_) {
+                drift_line_index_.erase(drift_lines_.back().first);
+                drift_lines_.pop_back();
+                ++evicted_drift_lines_;
+            }
+        }
+    }
+
+    // Shift the end point by the offset of the deposit from the start of the drift line and apply the accumulated diffusion
+    std::normal_distribution<double> diffusion(0, std::sqrt(line.variance));
+    ROOT::Math::XYZPoint end(line.end.x() + (pos.x() - line.start.x()) + diffusion(random_generator),
+                             line.end.y() + (pos.y() - line.start.y()) + diffusion(random_generator),
+                             line.end.z());
+    return {end, line.time};
 }
 
 /**
@@ -643,24 +1630,19 @@ void GenericPropagationModule::run(unsigned int event_num) {
  * multiple steps, adding a random diffusion to the propagating charge every step.
  */
 std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(const ROOT::Math::XYZPoint& pos,
-                                                                            const CarrierType& type) {
+                                                                            const CarrierType& type,
+                                                                            const double initial_time,
+                                                                            std::mt19937_64& random_generator,
+                                                                            PropagationCounters& counters,
+                                                                            double* drift_variance) {
     // Create a runge kutta solver using the electric field as step function
     Eigen::Vector3d position(pos.x(), pos.y(), pos.z());
 
+    // Pool of normal random numbers for the diffusion, only filled if requested
+    NormalPool<std::mt19937_64> normal_pool(random_generator);
+
     // Define a lambda function to compute the carrier mobility
-    // NOTE This function is typically the most frequently executed part of the framework and therefore the bottleneck
-    auto carrier_mobility = [&](double efield_mag) {
-        // Compute carrier mobility from constants and electric field magnitude
-        double numerator, denominator;
-        if(type == CarrierType::ELECTRON) {
-            numerator = electron_Vm_ / electron_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
-        } else {
-            numerator = hole_Vm_ / hole_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
-        }
-        return numerator / denominator;
-    };
+    auto carrier_mobility = [&](double efield_mag) { return mobility_(type, efield_mag); };
 
     // Define a function to compute the diffusion
     auto carrier_diffusion = [&](double efield_mag, double timestep) -> Eigen::Vector3d {
@@ -668,30 +1650,32 @@ std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(cons
         double diffusion_std_dev = std::sqrt(2. * diffusion_constant * timestep);
 
         // Compute the independent diffusion in three
-        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
         Eigen::Vector3d diffusion;
+        if(pooled_diffusion_) {
+            for(int i = 0; i < 3; ++i) {
+                diffusion[i] = normal_pool(diffusion_std_dev);
+            }
+            return diffusion;
+        }
+        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
         for(int i = 0; i < 3; ++i) {
-            diffusion[i] = gauss_distribution(random_generator_);
+            diffusion[i] = gauss_distribution(random_generator);
         }
         return diffusion;
     };
 
     // Define lambda functions to compute the charge carrier velocity with or without magnetic field
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_noB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-
+    auto carrier_velocity_noB = [&](const Eigen::Vector3d& efield) -> Eigen::Vector3d {
         return static_cast<int>(type) * carrier_mobility(efield.norm()) * efield;
     };
 
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_withB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-
-        Eigen::Vector3d velocity;
-        Eigen::Vector3d bfield(magnetic_field_.x(), magnetic_field_.y(), magnetic_field_.z());
+    auto carrier_velocity_withB = [&](const Eigen::Vector3d& efield, const Eigen::Vector3d& pos) -> Eigen::Vector3d {
+        Eigen::Vector3d bfield;
+        if(has_magnetic_field_grid_) {
+            detector_->getMagneticField(pos.data(), bfield.data());
+        } else {
+            magnetic_field_.GetCoordinates(bfield.data());
+        }
 
         auto mob = carrier_mobility(efield.norm());
         auto exb = efield.cross(bfield);
@@ -706,23 +1690,40 @@ std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(cons
         return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
     };
 
-    // Create the runge kutta solver with an RKF5 tableau, using different velocity calculators depending on the magnetic
-    // field
-    auto runge_kutta = make_runge_kutta(
-        tableau::RK5, (has_magnetic_field_ ? carrier_velocity_withB : carrier_velocity_noB), timestep_start_, position);
+    // Step function of the solver, selecting the velocity calculator depending on the magnetic field. The lambda is passed
+    // to the solver by type, which allows the compiler to inline it into the integration. If requested, the field of the
+    // first stage, which is evaluated at the start of the step, is kept for the diffusion.
+    Eigen::Vector3d step_start_field;
+    bool first_stage = false;
+    FieldTimeBracket field_bracket;
+    auto carrier_velocity = [&](double t, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        Eigen::Vector3d efield;
+        detector_->getElectricField(cur_pos.data(), initial_time + t, field_bracket, efield.data());
+        counters.addFieldLookup(efield.squaredNorm() == 0);
+        if(first_stage) {
+            step_start_field = efield;
+            first_stage = false;
+        }
+
+        return (has_magnetic_field_ ? carrier_velocity_withB(efield, cur_pos) : carrier_velocity_noB(efield));
+    };
+
+    // Create the runge kutta solver with an RKF5 tableau
+    auto runge_kutta = make_runge_kutta(tableau::RK5, carrier_velocity, timestep_start_, position);
+    StepSizeController<double> step_controller(target_spatial_precision_, timestep_min_, timestep_max_);
 
     // Continue propagation until the deposit is outside the sensor
     Eigen::Vector3d last_position = position;
     double last_time = 0;
     size_t next_idx = 0;
-    while(detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position)) &&
-          runge_kutta.getTime() < integration_time_) {
+    unsigned long steps = 0;
+    while(geometry_.isWithinSensor(position) && runge_kutta.getTime() < integration_time_) {
         // Update output plots if necessary (depending on the plot step)
         if(output_linegraphs_) {
             auto time_idx = static_cast<size_t>(runge_kutta.getTime() / output_plots_step_);
             while(next_idx <= time_idx) {
-                output_plot_points_.back().second.push_back(static_cast<ROOT::Math::XYZPoint>(position));
-                next_idx = output_plot_points_.back().second.size();
+                output_plot_lines_.back().points.push_back(static_cast<ROOT::Math::XYZPoint>(position));
+                next_idx = output_plot_lines_.back().points.size();
             }
         }
 
@@ -731,31 +1732,59 @@ std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(cons
         last_time = runge_kutta.getTime();
 
         // Execute a Runge Kutta step
+        first_stage = diffusion_at_step_start_;
         auto step = runge_kutta.step();
 
-        // Get the current result and timestep
+        // Repeat the step from the previous position with a reduced timestep if its error exceeds the target precision
         auto timestep = runge_kutta.getTimeStep();
+        auto next_timestep = timestep;
+        if(timestep_error_control_ && !step_controller.update(step.error.norm(), next_timestep)) {
+            runge_kutta.setValue(last_position);
+            runge_kutta.setTime(last_time);
+            runge_kutta.setTimeStep(next_timestep);
+            ++counters.rejected_steps;
+            continue;
+        }
+        ++steps;
+
+        // Get the current result
         position = runge_kutta.getValue();
 
-        // Get electric field at current position and fall back to empty field if it does not exist
-        auto efield = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(position));
+        // Get electric field at current position and fall back to empty field if it does not exist, unless the field at the
+        // start of the step is used
+        double efield_mag = 0;
+        if(diffusion_at_step_start_) {
+            efield_mag = step_start_field.norm();
+        } else {
+            Eigen::Vector3d efield;
+            detector_->getElectricField(position.data(), initial_time + runge_kutta.getTime(), field_bracket, efield.data());
+            counters.addFieldLookup(efield.squaredNorm() == 0);
+            efield_mag = efield.norm();
+        }
 
-        // Apply diffusion step
-        auto diffusion = carrier_diffusion(std::sqrt(efield.Mag2()), timestep);
-        position += diffusion;
-        runge_kutta.setValue(position);
+        // Apply diffusion step, or only accumulate its variance along the drift line
+        if(drift_variance != nullptr) {
+            *drift_variance += 2. * boltzmann_kT_ * carrier_mobility(efield_mag) * timestep;
+        } else {
+            auto diffusion = carrier_diffusion(efield_mag, timestep);
+            position += diffusion;
+            runge_kutta.setValue(position);
+        }
 
         // Adapt step size to match target precision
         double uncertainty = step.error.norm();
 
         // Update step length histogram
         if(output_plots_) {
-            step_length_histo_->Fill(static_cast<double>(Units::convert(step.value.norm(), "um")));
-            uncertainty_histo_->Fill(static_cast<double>(Units::convert(step.error.norm(), "nm")));
+            step_length_histo_->fill(static_cast<double>(step.value.norm() / units::um));
+            uncertainty_histo_->fill(static_cast<double>(Units::convert(step.error.norm(), "nm")));
         }
 
         // Lower timestep when reaching the sensor edge
-        if(std::fabs(model_->getSensorSize().z() / 2.0 - position.z()) < 2 * step.value.z()) {
+        bool at_edge = std::fabs(model_->getSensorSize().z() / 2.0 - position.z()) < 2 * step.value.z();
+        if(timestep_error_control_) {
+            timestep = (at_edge ? std::min(next_timestep, 0.75 * timestep) : next_timestep);
+        } else if(at_edge) {
             timestep *= 0.75;
         } else {
             if(uncertainty > target_spatial_precision_) {
@@ -773,12 +1802,16 @@ std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(cons
         runge_kutta.setTimeStep(timestep);
     }
 
+    // Sets still within the sensor have been stopped by the integration time
+    counters.integration_steps += steps;
+    counters.addSet(steps, geometry_.isWithinSensor(position));
+
     // Find proper final position in the sensor
     auto time = runge_kutta.getTime();
-    if(!detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
+    if(!geometry_.isWithinSensor(position)) {
         auto check_position = position;
         check_position.z() = last_position.z();
-        if(position.z() > 0 && detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(check_position))) {
+        if(position.z() > 0 && geometry_.isWithinSensor(check_position)) {
             // Carrier left sensor on the side of the pixel grid, interpolate end point on surface
             auto z_cur_border = std::fabs(position.z() - model_->getSensorSize().z() / 2.0);
             auto z_last_border = std::fabs(model_->getSensorSize().z() / 2.0 - last_position.z());
@@ -796,7 +1829,7 @@ std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(cons
     if(output_linegraphs_ && output_plots_lines_at_implants_) {
         // If drift time is larger than integration time or the charge carriers have been collected at the backside, remove
         if(time >= integration_time_ || last_position.z() < -model_->getSensorSize().z() * 0.45) {
-            output_plot_points_.pop_back();
+            output_plot_lines_.pop_back();
         }
     }
 
@@ -804,15 +1837,396 @@ std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(cons
     return std::make_pair(static_cast<ROOT::Math::XYZPoint>(position), time);
 }
 
+/**
+ * The sets of charge carriers are propagated in batches of a fixed number of lanes which are integrated in lockstep with a
+ * batched Runge-Kutta integrator. All per-carrier quantities are stored as structure of arrays, such that the evaluation
+ * of the mobility and the velocity can be vectorized by the compiler. Carriers which leave the sensor or exceed the
+ * integration time are retired and their lane is refilled with the next carrier. The drift and diffusion applied to every
+ * carrier is the same as for \ref GenericPropagationModule::propagate, but the random numbers are drawn in a different
+ * order such that the results are statistically equivalent but not identical.
+ */
+std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+GenericPropagationModule::propagate_batch(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                                          std::mt19937_64& random_generator,
+                                          PropagationCounters& counters) {
+    return (batch_float_ ? propagate_batch_lanes<float>(carriers, random_generator, counters)
+                         : propagate_batch_lanes<double>(carriers, random_generator, counters));
+}
+
+/**
+ * In single precision, the positions, the electric field, the mobility and all stages of the integrator are stored as float,
+ * such that twice as many lanes fit into a vector register. The field is looked up in double precision and rounded, and
+ * the time of every lane is accumulated in double precision to not lose the short time steps at late times. Positions are
+ * rounded to about 1e-7 of their distance from the origin of the local frame, i.e. about a nanometer per centimeter.
+ */
+template <typename T>
+std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+GenericPropagationModule::propagate_batch_lanes(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                                                std::mt19937_64& random_generator,
+                                                PropagationCounters& counters) {
+    using Lanes = std::array<T, batch_lanes_>;
+    using Times = std::array<double, batch_lanes_>;
+    using Values = std::array<Lanes, 3>;
+
+    // Pool of normal random numbers for the diffusion, only filled if requested
+    NormalPool<std::mt19937_64> normal_pool(random_generator);
+
+    // State of all lanes of the batch
+    Values position{}, last_position{}, step{}, error{};
+    Times time{}, last_time{};
+    Lanes timestep{};
+    std::array<StepSizeController<T>, batch_lanes_> step_controller{};
+    std::array<bool, batch_lanes_> accepted{};
+    Lanes mobility_numerator{}, critical_field{}, beta{}, inverse_beta{}, sign{}, hall_factor{};
+    std::array<size_t, batch_lanes_> carrier_index{};
+    std::array<unsigned long, batch_lanes_> steps{};
+
+    // Electric field and mobility of the active lanes, computed by the velocity calculation
+    Values efield{};
+    Lanes mobility{};
+    std::vector<ROOT::Math::XYZPoint> field_positions;
+    std::vector<ROOT::Math::XYZVector> raw_fields;
+    field_positions.reserve(batch_lanes_);
+    raw_fields.reserve(batch_lanes_);
+    auto compute_mobility = [&](const Values& cur_pos, size_t count) {
+        field_positions.resize(count);
+        for(size_t l = 0; l < count; ++l) {
+            field_positions[l] = ROOT::Math::XYZPoint(cur_pos[0][l], cur_pos[1][l], cur_pos[2][l]);
+        }
+        detector_->getElectricField(field_positions, raw_fields);
+        for(size_t l = 0; l < count; ++l) {
+            efield[0][l] = static_cast<T>(raw_fields[l].x());
+            efield[1][l] = static_cast<T>(raw_fields[l].y());
+            efield[2][l] = static_cast<T>(raw_fields[l].z());
+            counters.addFieldLookup(raw_fields[l].Mag2() == 0);
+        }
+        for(size_t l = 0; l < count; ++l) {
+            mobility[l] =
+                std::sqrt(efield[0][l] * efield[0][l] + efield[1][l] * efield[1][l] + efield[2][l] * efield[2][l]);
+        }
+        if(mobility_.isTabulated()) {
+            for(size_t l = 0; l < count; ++l) {
+                mobility[l] = static_cast<T>(mobility_(carriers[carrier_index[l]].second, mobility[l]));
+            }
+            return;
+        }
+        for(size_t l = 0; l < count; ++l) {
+            mobility[l] = mobility_numerator[l] /
+                          std::pow(T(1) + std::pow(mobility[l] / critical_field[l], beta[l]), inverse_beta[l]);
+        }
+    };
+
+    // Compute the charge carrier velocity of all active lanes with or without magnetic field, keeping the mobility of the
+    // first stage at the start of the step for the diffusion if requested. Magnetic field grids are looked up per lane.
+    Lanes step_start_mobility{};
+    bool first_stage = false;
+    auto carrier_velocity = [&](const Values& cur_pos, size_t count, Values& velocity) {
+        compute_mobility(cur_pos, count);
+        if(first_stage) {
+            step_start_mobility = mobility;
+            first_stage = false;
+        }
+        if(!has_magnetic_field_) {
+            for(int d = 0; d < 3; ++d) {
+                for(size_t l = 0; l < count; ++l) {
+                    velocity[d][l] = sign[l] * mobility[l] * efield[d][l];
+                }
+            }
+            return;
+        }
+        for(size_t l = 0; l < count; ++l) {
+            auto bfield = magnetic_field_;
+            if(has_magnetic_field_grid_) {
+                bfield = detector_->getMagneticField(ROOT::Math::XYZPoint(cur_pos[0][l], cur_pos[1][l], cur_pos[2][l]));
+            }
+            auto bx = bfield.x(), by = bfield.y(), bz = bfield.z();
+            auto ex = efield[0][l], ey = efield[1][l], ez = efield[2][l];
+            auto mob_hall = mobility[l] * hall_factor[l];
+            auto term1 = sign[l] * mob_hall;
+            auto term2 = mob_hall * mob_hall * (ex * bx + ey * by + ez * bz);
+            auto rnorm = 1 + mob_hall * mob_hall * (bx * bx + by * by + bz * bz);
+            auto factor = sign[l] * mobility[l] / rnorm;
+            velocity[0][l] = static_cast<T>(factor * (ex + term1 * (ey * bz - ez * by) + term2 * bx));
+            velocity[1][l] = static_cast<T>(factor * (ey + term1 * (ez * bx - ex * bz) + term2 * by));
+            velocity[2][l] = static_cast<T>(factor * (ez + term1 * (ex * by - ey * bx) + term2 * bz));
+        }
+    };
+    BatchRungeKutta<T, 6, batch_lanes_, 3, decltype(carrier_velocity)> runge_kutta(tableau::RK5.cast<T>(), carrier_velocity);
+
+    // Move the state of one lane to another lane
+    auto move_lane = [&](size_t from, size_t to) {
+        for(int d = 0; d < 3; ++d) {
+            position[d][to] = position[d][from];
+            last_position[d][to] = last_position[d][from];
+        }
+        time[to] = time[from];
+        last_time[to] = last_time[from];
+        timestep[to] = timestep[from];
+        step_controller[to] = step_controller[from];
+        mobility_numerator[to] = mobility_numerator[from];
+        critical_field[to] = critical_field[from];
+        beta[to] = beta[from];
+        inverse_beta[to] = inverse_beta[from];
+        sign[to] = sign[from];
+        hall_factor[to] = hall_factor[from];
+        carrier_index[to] = carrier_index[from];
+        steps[to] = steps[from];
+    };
+
+    // Find proper final position in the sensor for a lane (see propagate)
+    auto final_position = [&](size_t l) -> std::pair<ROOT::Math::XYZPoint, double> {
+        ROOT::Math::XYZPoint pos(position[0][l], position[1][l], position[2][l]);
+        ROOT::Math::XYZPoint last_pos(last_position[0][l], last_position[1][l], last_position[2][l]);
+        auto end_time = time[l];
+        if(!geometry_.isWithinSensor(pos)) {
+            ROOT::Math::XYZPoint check_position(pos.x(), pos.y(), last_pos.z());
+            if(pos.z() > 0 && geometry_.isWithinSensor(check_position)) {
+                // Carrier left sensor on the side of the pixel grid, interpolate end point on surface
+                auto z_cur_border = std::fabs(pos.z() - model_->getSensorSize().z() / 2.0);
+                auto z_last_border = std::fabs(model_->getSensorSize().z() / 2.0 - last_pos.z());
+                auto z_total = z_cur_border + z_last_border;
+                pos = ROOT::Math::XYZPoint((z_last_border / z_total) * ROOT::Math::XYZVector(pos) +
+                                           (z_cur_border / z_total) * ROOT::Math::XYZVector(last_pos));
+                end_time = (z_last_border / z_total) * end_time + (z_cur_border / z_total) * last_time[l];
+            } else {
+                // Carrier left sensor on any order border, use last position inside instead
+                pos = last_pos;
+                end_time = last_time[l];
+            }
+        }
+        return std::make_pair(pos, end_time);
+    };
+
+    std::vector<std::pair<ROOT::Math::XYZPoint, double>> results(carriers.size());
+    size_t next_carrier = 0;
+    size_t count = 0;
+    while(true) {
+        // Fill all free lanes with the next carriers
+        while(count < batch_lanes_ && next_carrier < carriers.size()) {
+            const auto& carrier = carriers[next_carrier];
+            position[0][count] = static_cast<T>(carrier.first.x());
+            position[1][count] = static_cast<T>(carrier.first.y());
+            position[2][count] = static_cast<T>(carrier.first.z());
+            for(int d = 0; d < 3; ++d) {
+                last_position[d][count] = position[d][count];
+            }
+            time[count] = 0;
+            last_time[count] = 0;
+            timestep[count] = static_cast<T>(timestep_start_);
+            step_controller[count] = StepSizeController<T>(static_cast<T>(target_spatial_precision_),
+                                                           static_cast<T>(timestep_min_),
+                                                           static_cast<T>(timestep_max_));
+            mobility_numerator[count] = static_cast<T>(mobility_.getZeroFieldMobility(carrier.second));
+            critical_field[count] = static_cast<T>(mobility_.getCriticalField(carrier.second));
+            beta[count] = static_cast<T>(mobility_.getBeta(carrier.second));
+            inverse_beta[count] = T(1) / beta[count];
+            hall_factor[count] = static_cast<T>(carrier.second == CarrierType::ELECTRON ? electron_Hall_ : hole_Hall_);
+            sign[count] = static_cast<T>(static_cast<int>(carrier.second));
+            carrier_index[count] = next_carrier;
+            steps[count] = 0;
+            ++count;
+            ++next_carrier;
+        }
+
+        // Retire all carriers which left the sensor or exceeded the integration time
+        for(size_t l = count; l-- > 0;) {
+            auto within_sensor =
+                geometry_.isWithinSensor(ROOT::Math::XYZPoint(position[0][l], position[1][l], position[2][l]));
+            if(!within_sensor || time[l] >= integration_time_) {
+                counters.integration_steps += steps[l];
+                counters.addSet(steps[l], within_sensor);
+                results[carrier_index[l]] = final_position(l);
+                move_lane(count - 1, l);
+                --count;
+            }
+        }
+
+        // Refill the lanes freed by retired carriers before continuing
+        if(count < batch_lanes_ && next_carrier < carriers.size()) {
+            continue;
+        }
+        if(count == 0) {
+            break;
+        }
+
+        // Save previous position and time
+        last_position = position;
+        last_time = time;
+
+        // Execute a Runge Kutta step for all lanes
+        first_stage = diffusion_at_step_start_;
+        runge_kutta.step(position, timestep, count, step, error);
+
+        // Repeat the steps of lanes with a reduced timestep if their error exceeds the target precision
+        Lanes next_timestep = timestep;
+        for(size_t l = 0; l < count; ++l) {
+            accepted[l] = true;
+            if(timestep_error_control_) {
+                T uncertainty = std::sqrt(error[0][l] * error[0][l] + error[1][l] * error[1][l] + error[2][l] * error[2][l]);
+                accepted[l] = step_controller[l].update(uncertainty, next_timestep[l]);
+            }
+            if(accepted[l]) {
+                time[l] += timestep[l];
+                ++steps[l];
+            } else {
+                ++counters.rejected_steps;
+                for(int d = 0; d < 3; ++d) {
+                    position[d][l] = last_position[d][l];
+                }
+                timestep[l] = next_timestep[l];
+            }
+        }
+
+        // Apply diffusion step using the mobility at the current position or at the start of the step
+        if(!diffusion_at_step_start_) {
+            compute_mobility(position, count);
+        }
+        const auto& diffusion_mobility = (diffusion_at_step_start_ ? step_start_mobility : mobility);
+        for(size_t l = 0; l < count; ++l) {
+            if(!accepted[l]) {
+                continue;
+            }
+            double diffusion_std_dev = std::sqrt(2. * boltzmann_kT_ * diffusion_mobility[l] * timestep[l]);
+            if(pooled_diffusion_) {
+                for(int d = 0; d < 3; ++d) {
+                    position[d][l] += static_cast<T>(normal_pool(diffusion_std_dev));
+                }
+                continue;
+            }
+            std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
+            for(int d = 0; d < 3; ++d) {
+                position[d][l] += static_cast<T>(gauss_distribution(random_generator));
+            }
+        }
+
+        for(size_t l = 0; l < count; ++l) {
+            if(!accepted[l]) {
+                continue;
+            }
+
+            // Adapt step size to match target precision
+            double uncertainty =
+                std::sqrt(error[0][l] * error[0][l] + error[1][l] * error[1][l] + error[2][l] * error[2][l]);
+
+            // Update step length histogram
+            if(output_plots_) {
+                double step_length = std::sqrt(step[0][l] * step[0][l] + step[1][l] * step[1][l] + step[2][l] * step[2][l]);
+                step_length_histo_->fill(static_cast<double>(step_length / units::um));
+                uncertainty_histo_->fill(static_cast<double>(Units::convert(uncertainty, "nm")));
+            }
+
+            // Lower timestep when reaching the sensor edge
+            bool at_edge = std::fabs(model_->getSensorSize().z() / 2.0 - position[2][l]) < 2 * step[2][l];
+            if(timestep_error_control_) {
+                timestep[l] = (at_edge ? std::min(next_timestep[l], T(0.75) * timestep[l]) : next_timestep[l]);
+            } else if(at_edge) {
+                timestep[l] *= T(0.75);
+            } else {
+                if(uncertainty > target_spatial_precision_) {
+                    timestep[l] *= T(0.75);
+                } else if(2 * uncertainty < target_spatial_precision_) {
+                    timestep[l] *= T(1.5);
+                }
+            }
+            // Limit the timestep to certain minimum and maximum step sizes
+            if(timestep[l] > timestep_max_) {
+                timestep[l] = static_cast<T>(timestep_max_);
+            } else if(timestep[l] < timestep_min_) {
+                timestep[l] = static_cast<T>(timestep_min_);
+            }
+        }
+    }
+
+    return results;
+}
+
+/**
+ * The start positions of all sets are passed to the offload backend as separate arrays. Every set uses its own random
+ * stream seeded from the random generator in the order of the sets, such that the result does not depend on the order in
+ * which the sets are propagated by the accelerator.
+ */
+std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+GenericPropagationModule::propagate_offload(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                                            std::mt19937_64& random_generator) {
+    auto count = carriers.size();
+    std::array<std::vector<double>, 3> start, end;
+    for(int d = 0; d < 3; ++d) {
+        start[d].resize(count);
+        end[d].resize(count);
+    }
+    std::vector<int> carrier_sign(count);
+    std::vector<uint64_t> seeds(count);
+    std::vector<double> end_time(count);
+    for(size_t i = 0; i < count; ++i) {
+        start[0][i] = carriers[i].first.x();
+        start[1][i] = carriers[i].first.y();
+        start[2][i] = carriers[i].first.z();
+        carrier_sign[i] = static_cast<int>(carriers[i].second);
+        seeds[i] = random_generator();
+    }
+
+    offload_propagate(offload_parameters_,
+                      count,
+                      {start[0].data(), start[1].data(), start[2].data()},
+                      carrier_sign.data(),
+                      seeds.data(),
+                      {end[0].data(), end[1].data(), end[2].data()},
+                      end_time.data());
+
+    std::vector<std::pair<ROOT::Math::XYZPoint, double>> results(count);
+    for(size_t i = 0; i < count; ++i) {
+        results[i] = std::make_pair(ROOT::Math::XYZPoint(end[0][i], end[1][i], end[2][i]), end_time[i]);
+    }
+    return results;
+}
+
 void GenericPropagationModule::finalize() {
+    if(offload_backend_) {
+        release_field(offload_parameters_.field);
+    }
+
     if(output_plots_) {
-        step_length_histo_->Write();
-        drift_time_histo_->Write();
-        uncertainty_histo_->Write();
-        group_size_histo_->Write();
+        step_length_histo_->merge()->Write();
+        drift_time_histo_->merge()->Write();
+        uncertainty_histo_->merge()->Write();
+        group_size_histo_->merge()->Write();
     }
 
     long double average_time = total_time_ / std::max(1u, total_propagated_charges_);
     LOG(INFO) << "Propagated total of " << total_propagated_charges_ << " charges in " << total_steps_
               << " steps in average time of " << Units::display(average_time, "ns");
+    if(total_counters_.field_lookups > 0) {
+        LOG(INFO) << "Integrated " << total_counters_.integration_steps << " steps with " << total_counters_.rejected_steps
+                  << " rejected steps and " << total_counters_.field_lookups << " field lookups, of which "
+                  << total_counters_.zero_fields << " returned no field";
+        LOG(INFO) << "Stopped " << total_counters_.timeouts << " sets at the integration time, steps per set "
+                  << total_counters_.getStepDistribution();
+    }
+    if(output_linegraphs_) {
+        LOG(INFO) << "Rendered output plots of " << rendered_plots_ << " events";
+    }
+    if(max_charge_per_step_ > charge_per_step_) {
+        LOG(INFO) << "Saved " << total_saved_sets_ << " sets by propagating carriers in larger sets";
+    }
+    if(detector_->hasRegionOfInterest()) {
+        LOG(INFO) << "Skipped " << total_skipped_charges_ << " charges deposited outside of the region of interest";
+    }
+    if(drift_line_cache_) {
+        LOG(INFO) << "Propagated " << total_cached_sets_ << " sets of charge carriers along " << drift_lines_.size()
+                  << " cached drift lines";
+        auto hit_rate = 100. * (total_cached_sets_ - total_drift_line_misses_) / std::max(1u, total_cached_sets_);
+        LOG(INFO) << "Integrated " << total_drift_line_misses_ << " drift lines, hit rate of the cache " << hit_rate
+                  << "%, evicted " << evicted_drift_lines_ << " drift lines";
+    }
+    if(thinning_budget_ > 0) {
+        LOG(INFO) << "Thinned out " << total_thinned_sets_ << " sets of charge carriers in " << thinned_events_
+                  << " events exceeding the budget";
+    }
+    if(transfer_to_pixels_) {
+        LOG(INFO) << "Transferred total of " << total_transferred_charges_ << " charges to pixels";
+    }
+    if(batch_group_ != nullptr && batch_group_->members.front() == this) {
+        LOG(INFO) << "Propagated " << batch_group_->sets << " sets of charge carriers of " << batch_group_->members.size()
+                  << " detectors in " << batch_group_->batches << " common batches";
+    }
 }
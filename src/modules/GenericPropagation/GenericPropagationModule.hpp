@@ -7,9 +7,15 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <array>
+#include <future>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <Math/Point3D.h>
@@ -22,7 +28,15 @@
 #include "core/module/Module.hpp"
 
 #include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
+#include "objects/PropagatedChargeArray.hpp"
+
+#include "GenericPropagationOffload.hpp"
+
+#include "tools/mobility.h"
+#include "tools/propagation_counters.h"
+#include "tools/threaded_histogram.h"
 
 namespace allpix {
     /**
@@ -64,20 +78,242 @@ namespace allpix {
         Messenger* messenger_;
         std::shared_ptr<const Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
+        DetectorGeometryView geometry_;
+
+        /**
+         * @brief Drift line of a set of charge carriers recorded for the output plots
+         */
+        struct OutputPlotLine {
+            CarrierType type;
+            unsigned int charge;
+            double event_time;
+            std::vector<ROOT::Math::XYZPoint> points;
+        };
 
         /**
          * @brief Create output plots in every event
          * @param event_num Index for this event
+         * @param output_plot_lines Drift lines recorded in this event, converted to the units of the plots
+         * @param file_names Names of the animation and the three contour animation files, only used for animations
+         */
+        void create_output_plots(unsigned int event_num,
+                                 std::vector<OutputPlotLine>& output_plot_lines,
+                                 const std::array<std::string, 4>& file_names) const;
+
+        /**
+         * @brief Summary of the propagation of a set of deposits
          */
-        void create_output_plots(unsigned int event_num);
+        struct PropagationSummary {
+            unsigned int propagated_charges{};
+            unsigned int steps{};
+            unsigned int saved_sets{};
+            unsigned int skipped_charges{};
+            unsigned int thinned_sets{};
+            unsigned int cached_sets{};
+            unsigned int drift_line_misses{};
+            long double total_time{};
+            PropagationCounters counters;
+        };
+
+        /**
+         * @brief Get the fraction of the sets of charge carriers of an event propagated after thinning
+         * @param deposits List of all deposits in this event
+         * @param total_sets Estimated number of sets of charge carriers of the event, set by this method
+         * @return Fraction of the sets propagated, one if the event does not exceed the thinning budget
+         */
+        double get_keep_fraction(const std::vector<DepositedCharge>& deposits, size_t& total_sets) const;
+
+        /**
+         * @brief Split a deposit into the sets of charge carriers which are propagated
+         * @param deposit Deposit to split
+         * @param random_generator Random generator used for the thinning
+         * @param summary Summary of the propagation which is updated for skipped, merged and thinned sets
+         * @param keep_fraction Fraction of the sets of charge carriers propagated after thinning, one to propagate all sets
+         * @param propagate_set Function called with the charge of every set to propagate
+         */
+        template <typename F>
+        void split_deposit(const DepositedCharge& deposit,
+                           std::mt19937_64& random_generator,
+                           PropagationSummary& summary,
+                           double keep_fraction,
+                           F&& propagate_set);
+
+        /**
+         * @brief Propagate all charges of a range of deposits of an event, splitting them into tasks if requested
+         * @param deposits List of all deposits in this event
+         * @param begin Index of the first deposit to propagate
+         * @param end Index after the last deposit to propagate
+         * @param first_task Random stream of the first task, incremented by the number of tasks the range is split into
+         * @param random_generator Random generator used for the diffusion if the deposits are not split into tasks
+         * @param propagated_charges List or \ref PropagatedChargeArray the propagated charges are appended to
+         * @param summary Summary of the propagation which is updated for the propagated charges
+         * @param max_batch_sets Maximum number of sets collected before propagating them in batches
+         * @param keep_fraction Fraction of the sets of charge carriers propagated after thinning, one to propagate all sets
+         */
+        template <typename Output>
+        void propagate_event(const std::vector<DepositedCharge>& deposits,
+                             size_t begin,
+                             size_t end,
+                             size_t& first_task,
+                             std::mt19937_64& random_generator,
+                             Output& propagated_charges,
+                             PropagationSummary& summary,
+                             size_t max_batch_sets,
+                             double keep_fraction);
+
+        /**
+         * @brief Propagate all charges of a range of deposits through the sensor
+         * @param deposits List of all deposits in this event
+         * @param begin Index of the first deposit to propagate
+         * @param end Index after the last deposit to propagate
+         * @param random_generator Random generator used for the diffusion
+         * @param propagated_charges List or \ref PropagatedChargeArray the propagated charges are appended to
+         * @param summary Summary of the propagation which is updated for the propagated charges
+         * @param max_batch_sets Maximum number of sets collected before propagating them in batches
+         * @param keep_fraction Fraction of the sets of charge carriers propagated after thinning, one to propagate all sets
+         */
+        template <typename Output>
+        void propagate_deposits(const std::vector<DepositedCharge>& deposits,
+                                size_t begin,
+                                size_t end,
+                                std::mt19937_64& random_generator,
+                                Output& propagated_charges,
+                                PropagationSummary& summary,
+                                size_t max_batch_sets,
+                                double keep_fraction);
 
         /**
          * @brief Propagate a single set of charges through the sensor
          * @param pos Position of the deposit in the sensor
          * @param type Type of the carrier to propagate
+         * @param initial_time Time of the deposit within the event, used for time-dependent electric fields
+         * @param random_generator Random generator used for the diffusion
+         * @param counters Counters of the field lookups and integration steps which are updated for the set
+         * @param drift_variance If set, no diffusion is applied and the variance of the diffusion along the drift line is
+         *                       accumulated instead
+         * @return Pair of the point where the deposit ended after propagation and the time the propagation took
+         */
+        std::pair<ROOT::Math::XYZPoint, double> propagate(const ROOT::Math::XYZPoint& pos,
+                                                          const CarrierType& type,
+                                                          const double initial_time,
+                                                          std::mt19937_64& random_generator,
+                                                          PropagationCounters& counters,
+                                                          double* drift_variance = nullptr);
+
+        /**
+         * @brief Propagate a single set of charges along the cached drift line of its lattice cell
+         * @param pos Position of the deposit in the sensor
+         * @param type Type of the carrier to propagate
+         * @param random_generator Random generator used for the diffusion
+         * @param summary Summary of the propagation, whose counters are only updated if the drift line is integrated
          * @return Pair of the point where the deposit ended after propagation and the time the propagation took
+         *
+         * The drift line is integrated without diffusion once per lattice cell and carrier type, starting from the center of
+         * the cell. The end point is shifted laterally by the offset of the deposit from the start of the drift line, and
+         * the diffusion accumulated along the drift line is applied as a single Gaussian spread in x and y. If the size of
+         * the cache is limited, the least recently used drift line is evicted once the cache is full.
+         */
+        std::pair<ROOT::Math::XYZPoint, double> propagate_cached(const ROOT::Math::XYZPoint& pos,
+                                                                 const CarrierType& type,
+                                                                 std::mt19937_64& random_generator,
+                                                                 PropagationSummary& summary);
+
+        /**
+         * @brief Propagate several sets of charges through the sensor at the same time
+         * @param carriers List of positions of the deposits in the sensor together with the type of the carriers
+         * @param random_generator Random generator used for the diffusion
+         * @param counters Counters of the field lookups and integration steps which are updated for all sets
+         * @return List of pairs of the end point and the propagation time for every set in the order of the input
          */
-        std::pair<ROOT::Math::XYZPoint, double> propagate(const ROOT::Math::XYZPoint& pos, const CarrierType& type);
+        std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+        propagate_batch(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                        std::mt19937_64& random_generator,
+                        PropagationCounters& counters);
+
+        /**
+         * @brief Propagate several sets of charges in batches with the positions and the integration in a given precision
+         * @param carriers List of positions of the deposits in the sensor together with the type of the carriers
+         * @param random_generator Random generator used for the diffusion
+         * @param counters Counters of the field lookups and integration steps which are updated for all sets
+         * @return List of pairs of the end point and the propagation time for every set in the order of the input
+         *
+         * The time of every set is accumulated in double precision independent of the precision of the integration.
+         */
+        template <typename T>
+        std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+        propagate_batch_lanes(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                              std::mt19937_64& random_generator,
+                              PropagationCounters& counters);
+
+        /**
+         * @brief Propagate several sets of charges through the sensor with the offload backend
+         * @param carriers List of positions of the deposits in the sensor together with the type of the carriers
+         * @param random_generator Random generator used to seed the random numbers of every set
+         * @return List of pairs of the end point and the propagation time for every set in the order of the input
+         */
+        std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+        propagate_offload(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                          std::mt19937_64& random_generator);
+
+        /**
+         * @brief Sets of charge carriers of all members of a batch group propagated together in an event
+         */
+        struct BatchGroupEvent {
+            std::promise<void> promise;
+            std::shared_future<void> ready;
+            std::map<const GenericPropagationModule*, std::vector<std::pair<ROOT::Math::XYZPoint, double>>> results;
+            PropagationCounters counters;
+        };
+
+        /**
+         * @brief Group of instances of this module for identical detectors whose sets are propagated in common batches
+         */
+        struct BatchGroup {
+            std::mutex mutex;
+            // Members of the group ordered by the name of their detector, the first member is the leader of the group
+            std::vector<GenericPropagationModule*> members;
+            // Events currently propagated, identified by the event seed of the leader
+            std::map<uint64_t, std::shared_ptr<BatchGroupEvent>> events;
+            unsigned long batches{};
+            unsigned long sets{};
+        };
+
+        /**
+         * @brief Join the batch group of the given name, checking that the detector is identical to the other members
+         * @param name Name of the batch group
+         */
+        void join_batch_group(const std::string& name);
+
+        /**
+         * @brief Get the results of the sets of this module propagated in the common batch of the group in this event
+         * @param carriers Sets of charge carriers of this module, used to check the consistency with the batch
+         * @param max_batch_sets Maximum number of sets propagated in a single batch
+         * @param counters Counters of the field lookups and integration steps, updated with the counters of the whole batch
+         *                 for the leader of the group
+         * @return List of pairs of the end point and the propagation time for every set in the order of the input
+         *
+         * The first member of the group executed in an event collects the sets of all members and propagates them in a
+         * common batch, while the other members wait for the batch to be propagated.
+         */
+        std::vector<std::pair<ROOT::Math::XYZPoint, double>>
+        take_group_results(const std::vector<std::pair<ROOT::Math::XYZPoint, CarrierType>>& carriers,
+                           size_t max_batch_sets,
+                           PropagationCounters& counters);
+
+        /**
+         * @brief Collect the sets of all members of the batch group in this event and propagate them in a common batch
+         * @param group_event Event of the group the results are stored in
+         * @param max_batch_sets Maximum number of sets propagated in a single batch
+         */
+        void propagate_group(BatchGroupEvent& group_event, size_t max_batch_sets);
+
+        // Batch group this module is a member of, if any
+        std::shared_ptr<BatchGroup> batch_group_;
+
+        // Number of sets of charges propagated at the same time in batch propagation
+        static constexpr size_t batch_lanes_ = 16;
+        // Maximum number of sets collected for batch propagation once the memory budget of an event is exceeded
+        static constexpr size_t batch_chunk_sets_ = 65536;
 
         // Random generator for this module
         std::mt19937_64 random_generator_;
@@ -86,14 +322,50 @@ namespace allpix {
         double temperature_{}, timestep_min_{}, timestep_max_{}, timestep_start_{}, integration_time_{},
             target_spatial_precision_{}, output_plots_step_{};
         bool output_plots_{}, output_linegraphs_{}, output_animations_{}, output_plots_lines_at_implants_{};
+        bool output_plots_use_pixel_units_{}, output_plots_use_equal_scaling_{}, output_plots_align_pixels_{},
+            output_animations_color_markers_{};
+        double output_plots_theta_{}, output_plots_phi_{}, output_animations_time_scaling_{},
+            output_animations_marker_size_{}, output_animations_contour_max_scaling_{};
+        bool timestep_error_control_{};
+        unsigned int deposits_per_task_{}, charge_per_step_{}, max_charge_per_step_{}, chunk_size_{}, thinning_budget_{};
+        double grouping_tolerance_{};
+        double region_of_interest_margin_{};
+        bool propagate_electrons_{}, propagate_holes_{};
+        bool batch_propagation_{}, batch_float_{}, diffusion_at_step_start_{}, columnar_output_{}, defer_global_positions_{};
+        bool pooled_diffusion_{};
+
+        /**
+         * @brief Drift line of a lattice cell, integrated without diffusion
+         */
+        struct DriftLine {
+            ROOT::Math::XYZPoint start;
+            ROOT::Math::XYZPoint end;
+            double time;
+            double variance;
+        };
+
+        // Cache of the drift lines of the lattice cells, filled on first use and shared between events. The drift lines are
+        // ordered from the most to the least recently used, and indexed by the key of their lattice cell.
+        bool drift_line_cache_{};
+        ROOT::Math::XYZVector drift_line_lattice_;
+        size_t drift_line_cache_size_{};
+        std::list<std::pair<uint64_t, DriftLine>> drift_lines_;
+        std::unordered_map<uint64_t, std::list<std::pair<uint64_t, DriftLine>>::iterator> drift_line_index_;
+        std::mutex drift_lines_mutex_;
+        unsigned long evicted_drift_lines_{};
+
+        // Propagation with the offload backend and the parameters passed to it
+        bool offload_backend_{};
+        OffloadParameters offload_parameters_;
+
+        // Parameters of the direct transfer of the propagated charges to the pixels
+        bool transfer_to_pixels_{}, collect_from_implant_{};
+        double max_depth_distance_{};
+        // Flag whether the propagated charges are dispatched, only false if transferring directly without listeners
+        bool dispatch_propagated_charges_{true};
 
-        // Precalculated values for electron and hole mobility
-        double electron_Vm_;
-        double electron_Ec_;
-        double electron_Beta_;
-        double hole_Vm_;
-        double hole_Ec_;
-        double hole_Beta_;
+        // Mobility parameterization for electrons and holes
+        JacoboniCanaliMobility mobility_;
 
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
@@ -104,22 +376,33 @@ namespace allpix {
 
         // Magnetic field
         bool has_magnetic_field_;
+        bool has_magnetic_field_grid_{false};
         ROOT::Math::XYZVector magnetic_field_;
 
-        // Deposits for the bound detector in this event
+        // Deposits for the bound detector in this event, only used to register the message (fetched in the run method)
         std::shared_ptr<DepositedChargeMessage> deposits_message_;
 
         // Statistical information
+        std::mutex stats_mutex_;
         unsigned int total_propagated_charges_{};
+        unsigned int total_transferred_charges_{};
         unsigned int total_steps_{};
+        unsigned int total_saved_sets_{};
+        unsigned int total_skipped_charges_{};
+        unsigned int total_thinned_sets_{};
+        unsigned int thinned_events_{};
+        unsigned int total_cached_sets_{};
+        unsigned int total_drift_line_misses_{};
         long double total_time_{};
+        PropagationCounters total_counters_;
 
-        // List of points to plot to plot for output plots
-        std::vector<std::pair<PropagatedCharge, std::vector<ROOT::Math::XYZPoint>>> output_plot_points_;
-        TH1D* step_length_histo_;
-        TH1D* drift_time_histo_;
-        TH1D* uncertainty_histo_;
-        TH1D* group_size_histo_;
+        // Drift lines of the current event recorded for the output plots, and number of events with rendered plots
+        std::vector<OutputPlotLine> output_plot_lines_;
+        unsigned int rendered_plots_{};
+        std::unique_ptr<ThreadedHistogram<TH1D>> step_length_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> drift_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> uncertainty_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> group_size_histo_;
     };
 
 } // namespace allpix
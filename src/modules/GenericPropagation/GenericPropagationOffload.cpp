@@ -0,0 +1,353 @@
+/**
+ * @file
+ * @brief Implementation of the offload backend of the generic charge propagation
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * This file is compiled with OpenMP target offloading if the module is built with the GENERICPROPAGATION_OFFLOAD option,
+ * and as plain host code otherwise. All functions called in the offloaded region are defined in this file and only use
+ * plain arrays, such that they can be compiled for any accelerator supported by the compiler.
+ */
+
+#include "GenericPropagationOffload.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+#include <omp.h>
+#endif
+
+#include "tools/runge_kutta.h"
+
+using namespace allpix;
+
+namespace {
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+#pragma omp declare target
+#endif
+    // Runge-Kutta-Fehlberg tableau of fifth order with embedded fourth order error estimate, see tableau::RK5
+    constexpr int rk_stages = 6;
+    constexpr double rk_a[rk_stages][rk_stages] = {{0, 0, 0, 0, 0, 0},
+                                                   {1.0 / 4, 0, 0, 0, 0, 0},
+                                                   {3.0 / 32, 9.0 / 32, 0, 0, 0, 0},
+                                                   {1932.0 / 2197, -7200.0 / 2197, 7296.0 / 2197, 0, 0, 0},
+                                                   {439.0 / 216, -8, 3680.0 / 513, -845.0 / 4104, 0, 0},
+                                                   {-8.0 / 27, 2, -3544.0 / 2565, 1859.0 / 4104, -11.0 / 40, 0}};
+    constexpr double rk_b[rk_stages] = {16.0 / 135, 0, 6656.0 / 12825, 28561.0 / 56430, -9.0 / 50, 2.0 / 55};
+    constexpr double rk_b_low[rk_stages] = {25.0 / 216, 0, 1408.0 / 2565, 2197.0 / 4104, -1.0 / 5, 0};
+
+    /*
+     * Random generator of a single set of charge carriers, using the SplitMix64 sequence for uniform numbers and the
+     * Box-Muller transform for normal distributed numbers
+     */
+    struct CarrierRandom {
+        uint64_t state;
+        double spare;
+        bool has_spare;
+
+        double uniform() {
+            state += 0x9e3779b97f4a7c15ULL;
+            auto z = state;
+            z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27u)) * 0x94d049bb133111ebULL;
+            z = z ^ (z >> 31u);
+            // Use the upper 53 bits for a number in (0, 1]
+            return (static_cast<double>(z >> 11u) + 1.0) * 0x1.0p-53;
+        }
+
+        double gauss() {
+            if(has_spare) {
+                has_spare = false;
+                return spare;
+            }
+            constexpr double two_pi = 6.283185307179586;
+            auto radius = std::sqrt(-2.0 * std::log(uniform()));
+            auto angle = two_pi * uniform();
+            spare = radius * std::sin(angle);
+            has_spare = true;
+            return radius * std::cos(angle);
+        }
+    };
+
+    // Look up the field with the replica transform of DetectorField::getFast
+    void field_value(const FieldGridView& field, const double* values, const double* pos, double* value) {
+        value[0] = value[1] = value[2] = 0;
+
+        // Compute the coordinates relative to the lower edge of the replica and the replica indices
+        auto x = pos[0] + field.replica_shift[0];
+        auto y = pos[1] + field.replica_shift[1];
+        auto replica_x = static_cast<int>(std::floor(x * field.inverse_scales[0]));
+        auto replica_y = static_cast<int>(std::floor(y * field.inverse_scales[1]));
+        x -= replica_x * field.scales[0];
+        y -= replica_y * field.scales[1];
+
+        // Mirror odd replicas, converting to the frame centered at the replica
+        auto sign_x = static_cast<double>(1 - 2 * (replica_x & 1));
+        auto sign_y = static_cast<double>(1 - 2 * (replica_y & 1));
+        x = sign_x * (x - 0.5 * field.scales[0]);
+        y = sign_y * (y - 0.5 * field.scales[1]);
+
+        auto dim_x = static_cast<int>(field.dimensions[0]);
+        auto dim_y = static_cast<int>(field.dimensions[1]);
+        auto dim_z = static_cast<int>(field.dimensions[2]);
+        auto bin_z = (pos[2] - field.thickness_begin) * field.bin_factors[2];
+        auto z_ind = static_cast<int>(std::floor(bin_z));
+        if(z_ind < 0 || z_ind >= dim_z) {
+            return;
+        }
+        auto index = [&](int x_ind, int y_ind, int z_ind_) {
+            return ((static_cast<size_t>(x_ind) * field.dimensions[1] + static_cast<size_t>(y_ind)) * field.dimensions[2] +
+                    static_cast<size_t>(z_ind_)) *
+                   3;
+        };
+
+        // Position in units of bins, single bins in x or y denote two-dimensional fields
+        auto bin_x = (dim_x == 1 ? 0.5 : (x + 0.5 * field.scales[0]) * field.bin_factors[0]);
+        auto bin_y = (dim_y == 1 ? 0.5 : (y + 0.5 * field.scales[1]) * field.bin_factors[1]);
+        if(field.interpolation == FieldInterpolation::NEAREST) {
+            auto offset = index(std::clamp(static_cast<int>(bin_x), 0, dim_x - 1),
+                                std::clamp(static_cast<int>(bin_y), 0, dim_y - 1),
+                                z_ind);
+            value[0] = values[offset];
+            value[1] = values[offset + 1];
+            value[2] = values[offset + 2];
+        } else {
+            // Interpolate between the eight surrounding grid points located at the bin centers
+            int low[3], high[3];
+            double frac[3];
+            const double bins[3] = {bin_x, bin_y, bin_z};
+            const int dims[3] = {dim_x, dim_y, dim_z};
+            for(int d = 0; d < 3; ++d) {
+                auto lower = std::floor(bins[d] - 0.5);
+                low[d] = std::clamp(static_cast<int>(lower), 0, dims[d] - 1);
+                high[d] = std::clamp(static_cast<int>(lower) + 1, 0, dims[d] - 1);
+                frac[d] = bins[d] - 0.5 - lower;
+            }
+            for(int corner = 0; corner < 8; ++corner) {
+                auto x_upper = (corner & 1) != 0;
+                auto y_upper = (corner & 2) != 0;
+                auto z_upper = (corner & 4) != 0;
+                auto weight = (x_upper ? frac[0] : 1 - frac[0]) * (y_upper ? frac[1] : 1 - frac[1]) *
+                              (z_upper ? frac[2] : 1 - frac[2]);
+                if(weight == 0) {
+                    continue;
+                }
+                auto offset = index(x_upper ? high[0] : low[0], y_upper ? high[1] : low[1], z_upper ? high[2] : low[2]);
+                for(int d = 0; d < 3; ++d) {
+                    value[d] += weight * values[offset + static_cast<size_t>(d)];
+                }
+            }
+        }
+
+        // Mirror the vector components together with the position
+        value[0] *= sign_x;
+        value[1] *= sign_y;
+    }
+
+    bool within_sensor(const OffloadParameters& parameters, const double* pos) {
+        for(int d = 0; d < 3; ++d) {
+            if(2 * std::fabs(pos[d] - parameters.sensor_center[d]) > parameters.sensor_size[d]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double norm(const double* vec) { return std::sqrt(vec[0] * vec[0] + vec[1] * vec[1] + vec[2] * vec[2]); }
+
+    /*
+     * Propagate a single set of charge carriers, following GenericPropagationModule::propagate without magnetic field
+     */
+    void propagate_carrier(const OffloadParameters& parameters,
+                           const double* values,
+                           const double* start,
+                           int sign,
+                           uint64_t seed,
+                           double* end,
+                           double& end_time) {
+        auto type = (sign < 0 ? 0 : 1);
+        auto zero_field_mobility = parameters.zero_field_mobility[type];
+        auto critical_field = parameters.critical_field[type];
+        auto beta = parameters.beta[type];
+        auto mobility = [&](double efield_mag) {
+            return zero_field_mobility / std::pow(1. + std::pow(efield_mag / critical_field, beta), 1.0 / beta);
+        };
+
+        CarrierRandom random{seed, 0, false};
+        StepSizeController<double> step_controller(
+            parameters.target_spatial_precision, parameters.timestep_min, parameters.timestep_max);
+
+        double position[3] = {start[0], start[1], start[2]};
+        double last_position[3] = {start[0], start[1], start[2]};
+        double time = 0, last_time = 0;
+        double timestep = parameters.timestep_start;
+        double half_thickness = parameters.sensor_size[2] / 2.0;
+        while(within_sensor(parameters, position) && time < parameters.integration_time) {
+            // Save previous position and time
+            for(int d = 0; d < 3; ++d) {
+                last_position[d] = position[d];
+            }
+            last_time = time;
+
+            // Execute a Runge-Kutta step, keeping the field of the first stage at the start of the step
+            double k[rk_stages][3];
+            double step[3] = {0, 0, 0};
+            double error[3] = {0, 0, 0};
+            double step_start_field = 0;
+            for(int i = 0; i < rk_stages; ++i) {
+                double stage_position[3];
+                for(int d = 0; d < 3; ++d) {
+                    stage_position[d] = position[d];
+                    for(int j = 0; j < i; ++j) {
+                        stage_position[d] += timestep * rk_a[i][j] * k[j][d];
+                    }
+                }
+                double efield[3];
+                field_value(parameters.field, values, stage_position, efield);
+                auto efield_mag = norm(efield);
+                if(i == 0) {
+                    step_start_field = efield_mag;
+                }
+                auto mob = mobility(efield_mag);
+                for(int d = 0; d < 3; ++d) {
+                    k[i][d] = sign * mob * efield[d];
+                    step[d] += timestep * rk_b[i] * k[i][d];
+                    error[d] += timestep * (rk_b[i] - rk_b_low[i]) * k[i][d];
+                }
+            }
+            auto uncertainty = norm(error);
+
+            // Repeat the step from the previous position with a reduced timestep if its error exceeds the target precision
+            auto next_timestep = timestep;
+            if(parameters.timestep_error_control && !step_controller.update(uncertainty, next_timestep)) {
+                timestep = next_timestep;
+                continue;
+            }
+            for(int d = 0; d < 3; ++d) {
+                position[d] += step[d];
+            }
+            time += timestep;
+
+            // Apply the diffusion with the field at the current position or at the start of the step
+            double efield_mag = step_start_field;
+            if(!parameters.diffusion_at_step_start) {
+                double efield[3];
+                field_value(parameters.field, values, position, efield);
+                efield_mag = norm(efield);
+            }
+            auto diffusion_std_dev = std::sqrt(2. * parameters.boltzmann_kT * mobility(efield_mag) * timestep);
+            for(int d = 0; d < 3; ++d) {
+                position[d] += diffusion_std_dev * random.gauss();
+            }
+
+            // Lower timestep when reaching the sensor edge
+            bool at_edge = std::fabs(half_thickness - position[2]) < 2 * step[2];
+            if(parameters.timestep_error_control) {
+                timestep = (at_edge ? std::min(next_timestep, 0.75 * timestep) : next_timestep);
+            } else if(at_edge) {
+                timestep *= 0.75;
+            } else {
+                if(uncertainty > parameters.target_spatial_precision) {
+                    timestep *= 0.75;
+                } else if(2 * uncertainty < parameters.target_spatial_precision) {
+                    timestep *= 1.5;
+                }
+            }
+            // Limit the timestep to certain minimum and maximum step sizes
+            timestep = std::min(std::max(timestep, parameters.timestep_min), parameters.timestep_max);
+        }
+
+        // Find proper final position in the sensor
+        end_time = time;
+        for(int d = 0; d < 3; ++d) {
+            end[d] = position[d];
+        }
+        if(!within_sensor(parameters, position)) {
+            double check_position[3] = {position[0], position[1], last_position[2]};
+            if(position[2] > 0 && within_sensor(parameters, check_position)) {
+                // Carrier left sensor on the side of the pixel grid, interpolate end point on surface
+                auto z_cur_border = std::fabs(position[2] - half_thickness);
+                auto z_last_border = std::fabs(half_thickness - last_position[2]);
+                auto z_total = z_cur_border + z_last_border;
+                for(int d = 0; d < 3; ++d) {
+                    end[d] = (z_last_border / z_total) * position[d] + (z_cur_border / z_total) * last_position[d];
+                }
+                end_time = (z_last_border / z_total) * time + (z_cur_border / z_total) * last_time;
+            } else {
+                // Carrier left sensor on any order border, use last position inside instead
+                for(int d = 0; d < 3; ++d) {
+                    end[d] = last_position[d];
+                }
+                end_time = last_time;
+            }
+        }
+    }
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+#pragma omp end declare target
+#endif
+} // namespace
+
+bool allpix::offload_device_available() {
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+    return omp_get_num_devices() > 0;
+#else
+    return false;
+#endif
+}
+
+void allpix::offload_field(const FieldGridView& field) {
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+    const auto* values = field.values;
+#pragma omp target enter data map(to : values[0:field.size])
+#else
+    (void)field;
+#endif
+}
+
+void allpix::release_field(const FieldGridView& field) {
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+    const auto* values = field.values;
+#pragma omp target exit data map(release : values[0:field.size])
+#else
+    (void)field;
+#endif
+}
+
+/**
+ * The field grid is already present on the accelerator, only the start and end values of the sets are transferred. Every
+ * set is propagated by its own thread of the accelerator, which are assigned dynamically as the propagation time of the
+ * sets differs strongly.
+ */
+void allpix::offload_propagate(const OffloadParameters& parameters,
+                               size_t count,
+                               const std::array<const double*, 3>& start,
+                               const int* carrier_sign,
+                               const uint64_t* seeds,
+                               const std::array<double*, 3>& end,
+                               double* end_time) {
+    const auto* values = parameters.field.values;
+    const auto* start_x = start[0];
+    const auto* start_y = start[1];
+    const auto* start_z = start[2];
+    auto* end_x = end[0];
+    auto* end_y = end[1];
+    auto* end_z = end[2];
+#ifdef ALLPIX_GENERICPROPAGATION_OFFLOAD
+    auto size = parameters.field.size;
+#pragma omp target teams distribute parallel for schedule(dynamic, 1)                                                       \
+    map(to : parameters, values[0:size])                                                                                    \
+    map(to : start_x[0:count], start_y[0:count], start_z[0:count], carrier_sign[0:count], seeds[0:count])                   \
+    map(from : end_x[0:count], end_y[0:count], end_z[0:count], end_time[0:count])
+#endif
+    for(size_t i = 0; i < count; ++i) {
+        const double carrier_start[3] = {start_x[i], start_y[i], start_z[i]};
+        double carrier_end[3];
+        propagate_carrier(parameters, values, carrier_start, carrier_sign[i], seeds[i], carrier_end, end_time[i]);
+        end_x[i] = carrier_end[0];
+        end_y[i] = carrier_end[1];
+        end_z[i] = carrier_end[2];
+    }
+}
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief Definition of the offload backend of the generic charge propagation
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_GENERIC_PROPAGATION_OFFLOAD_H
+#define ALLPIX_GENERIC_PROPAGATION_OFFLOAD_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "core/geometry/DetectorField.hpp"
+
+namespace allpix {
+    /**
+     * @brief Parameters of the drift and diffusion of charge carriers propagated by the offload backend
+     *
+     * The mobility parameters are given for electrons at index zero and for holes at index one.
+     */
+    struct OffloadParameters {
+        FieldGridView field;
+        std::array<double, 3> sensor_center{};
+        std::array<double, 3> sensor_size{};
+        double boltzmann_kT{};
+        double integration_time{};
+        double timestep_start{};
+        double timestep_min{};
+        double timestep_max{};
+        double target_spatial_precision{};
+        bool timestep_error_control{};
+        bool diffusion_at_step_start{};
+        std::array<double, 2> zero_field_mobility{};
+        std::array<double, 2> critical_field{};
+        std::array<double, 2> beta{};
+    };
+
+    /**
+     * @brief Check if the offload backend runs on an accelerator
+     * @return True if the backend is built with offload support and an accelerator is available, false if it runs on the
+     * host
+     */
+    bool offload_device_available();
+
+    /**
+     * @brief Copy a field grid to the accelerator, keeping it there until it is released
+     * @param field Description of the field grid
+     *
+     * Fields copied several times, e.g. by several module instances sharing the same grid, are only copied once and kept
+     * until they are released as often as they have been copied.
+     */
+    void offload_field(const FieldGridView& field);
+
+    /**
+     * @brief Release a field grid copied to the accelerator by \ref offload_field
+     * @param field Description of the field grid
+     */
+    void release_field(const FieldGridView& field);
+
+    /**
+     * @brief Propagate sets of charge carriers on the accelerator
+     * @param parameters Parameters of the propagation, the field grid has to be copied by \ref offload_field before
+     * @param count Number of sets of charge carriers
+     * @param start Local start positions of all sets, as arrays of the x, y and z coordinates
+     * @param carrier_sign Sign of the charge of every set, -1 for electrons and +1 for holes
+     * @param seeds Seed of the random numbers of every set
+     * @param end Local end positions of all sets, as arrays of the x, y and z coordinates
+     * @param end_time Propagation time of every set
+     *
+     * Every set of charge carriers draws its random numbers from its own generator initialized with its seed, which makes
+     * the result independent of the execution order on the accelerator.
+     */
+    void offload_propagate(const OffloadParameters& parameters,
+                           size_t count,
+                           const std::array<const double*, 3>& start,
+                           const int* carrier_sign,
+                           const uint64_t* seeds,
+                           const std::array<double*, 3>& end,
+                           double* end_time);
+} // namespace allpix
+
+#endif /* ALLPIX_GENERIC_PROPAGATION_OFFLOAD_H */
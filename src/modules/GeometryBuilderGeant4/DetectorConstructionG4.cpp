@@ -10,6 +10,8 @@
 
 #include "DetectorConstructionG4.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <string>
 #include <utility>
@@ -21,6 +23,7 @@
 #include <G4NistManager.hh>
 #include <G4PVDivision.hh>
 #include <G4PVPlacement.hh>
+#include <G4PVReplica.hh>
 #include <G4PhysicalVolumeStore.hh>
 #include <G4Sphere.hh>
 #include <G4StepLimiterPhysics.hh>
@@ -109,9 +112,9 @@ void DetectorConstructionG4::build(std::map<std::string, G4Material*> materials_
             throw ModuleError("Cannot find world volume");
         }
 
-        // Place the wrapper
+        // Place the wrapper, the overlaps of all volumes are checked once after constructing the full geometry
         auto wrapper_phys = make_shared_no_delete<G4PVPlacement>(
-            transform_phys, wrapper_log.get(), "wrapper_" + name + "_phys", world_log.get(), false, 0, true);
+            transform_phys, wrapper_log.get(), "wrapper_" + name + "_phys", world_log.get(), false, 0, false);
         geo_manager_->setExternalObject(name, "wrapper_phys", wrapper_phys);
 
         LOG(DEBUG) << " Center of the geometry parts relative to the detector wrapper geometric center:";
@@ -138,7 +141,7 @@ void DetectorConstructionG4::build(std::map<std::string, G4Material*> materials_
         auto sensor_pos = toG4Vector(model->getSensorCenter() - model->getGeometricalCenter());
         LOG(DEBUG) << "  - Sensor\t\t:\t" << Units::display(sensor_pos, {"mm", "um"});
         auto sensor_phys = make_shared_no_delete<G4PVPlacement>(
-            nullptr, sensor_pos, sensor_log.get(), "sensor_" + name + "_phys", wrapper_log.get(), false, 0, true);
+            nullptr, sensor_pos, sensor_log.get(), "sensor_" + name + "_phys", wrapper_log.get(), false, 0, false);
         geo_manager_->setExternalObject(name, "sensor_phys", sensor_phys);
 
         // Create the pixel box and logical volume
@@ -188,7 +191,7 @@ void DetectorConstructionG4::build(std::map<std::string, G4Material*> materials_
             auto chip_pos = toG4Vector(model->getChipCenter() - model->getGeometricalCenter());
             LOG(DEBUG) << "  - Chip\t\t:\t" << Units::display(chip_pos, {"mm", "um"});
             auto chip_phys = make_shared_no_delete<G4PVPlacement>(
-                nullptr, chip_pos, chip_log.get(), "chip_" + name + "_phys", wrapper_log.get(), false, 0, true);
+                nullptr, chip_pos, chip_log.get(), "chip_" + name + "_phys", wrapper_log.get(), false, 0, false);
             geo_manager_->setExternalObject(name, "chip_phys", chip_phys);
         }
 
@@ -265,7 +268,7 @@ void DetectorConstructionG4::build(std::map<std::string, G4Material*> materials_
                                                      wrapper_log.get(),
                                                      false,
                                                      0,
-                                                     true);
+                                                     false);
             supports_phys->push_back(support_phys);
 
             ++support_idx;
@@ -309,7 +312,7 @@ void DetectorConstructionG4::build(std::map<std::string, G4Material*> materials_
                                                                            wrapper_log.get(),
                                                                            false,
                                                                            0,
-                                                                           true);
+                                                                           false);
             geo_manager_->setExternalObject(name, "bumps_wrapper_phys", bumps_wrapper_phys);
 
             // Create the individual bump solid
@@ -333,27 +336,100 @@ void DetectorConstructionG4::build(std::map<std::string, G4Material*> materials_
             total_material_budget +=
                 (relativeArea * hybrid_model->getBumpHeight() / bumps_cell_log->GetMaterial()->GetRadlen());
 
-            // Place the bump bonds grid
-            std::shared_ptr<G4VPVParameterisation> bumps_param = std::make_shared<Parameterization2DG4>(
-                hybrid_model->getNPixels().x(),
-                hybrid_model->getPixelSize().x(),
-                hybrid_model->getPixelSize().y(),
-                -(hybrid_model->getNPixels().x() * hybrid_model->getPixelSize().x()) / 2.0 +
-                    (hybrid_model->getBumpsCenter().x() - hybrid_model->getCenter().x()),
-                -(hybrid_model->getNPixels().y() * hybrid_model->getPixelSize().y()) / 2.0 +
-                    (hybrid_model->getBumpsCenter().y() - hybrid_model->getCenter().y()),
-                0);
-            geo_manager_->setExternalObject(name, "bumps_param", bumps_param);
-
-            std::shared_ptr<G4PVParameterised> bumps_param_phys =
-                std::make_shared<ParameterisedG4>("bumps_" + name + "_phys",
-                                                  bumps_cell_log.get(),
-                                                  bumps_wrapper_log.get(),
-                                                  kUndefined,
-                                                  hybrid_model->getNPixels().x() * hybrid_model->getNPixels().y(),
-                                                  bumps_param.get(),
-                                                  false);
-            geo_manager_->setExternalObject(name, "bumps_param_phys", bumps_param_phys);
+            // Offset of the center of the bump bonds grid in the volume containing the bumps
+            auto grid_size_x = hybrid_model->getNPixels().x() * hybrid_model->getPixelSize().x();
+            auto grid_size_y = hybrid_model->getNPixels().y() * hybrid_model->getPixelSize().y();
+            auto grid_offset_x = hybrid_model->getBumpsCenter().x() - hybrid_model->getCenter().x();
+            auto grid_offset_y = hybrid_model->getBumpsCenter().y() - hybrid_model->getCenter().y();
+
+            // Replicas can only be used if the grid is contained in the bumps volume and every bump in its pixel cell
+            auto bump_radius = std::max(bump_sphere_radius, bump_cylinder_radius);
+            bool use_replicas =
+                (std::abs(grid_offset_x) + grid_size_x / 2.0 <= hybrid_model->getSensorSize().x() / 2.0 &&
+                 std::abs(grid_offset_y) + grid_size_y / 2.0 <= hybrid_model->getSensorSize().y() / 2.0 &&
+                 2.0 * bump_radius <= std::min(model->getPixelSize().x(), model->getPixelSize().y()) &&
+                 2.0 * bump_sphere_radius <= bump_height);
+
+            if(use_replicas) {
+                // Place the bump bonds grid as rows of pixel cells replicated along x and y, each containing one bump
+                LOG(DEBUG) << "  - Placing bump bonds as replicated pixel cells";
+                auto bumps_grid_box = make_shared_no_delete<G4Box>(
+                    "bumps_grid_" + name, grid_size_x / 2.0, grid_size_y / 2.0, bump_height / 2.);
+                solids_.push_back(bumps_grid_box);
+                auto bumps_grid_log = make_shared_no_delete<G4LogicalVolume>(
+                    bumps_grid_box.get(), materials_["world_material"], "bumps_grid_" + name + "_log");
+                bumps_grid_log->SetVisAttributes(G4VisAttributes::GetInvisible());
+                auto bumps_grid_phys = make_shared_no_delete<G4PVPlacement>(nullptr,
+                                                                            G4ThreeVector(grid_offset_x, grid_offset_y, 0),
+                                                                            bumps_grid_log.get(),
+                                                                            "bumps_grid_" + name + "_phys",
+                                                                            bumps_wrapper_log.get(),
+                                                                            false,
+                                                                            0,
+                                                                            false);
+                geo_manager_->setExternalObject(name, "bumps_grid_phys", bumps_grid_phys);
+
+                auto bumps_row_box = make_shared_no_delete<G4Box>(
+                    "bumps_row_" + name, model->getPixelSize().x() / 2.0, grid_size_y / 2.0, bump_height / 2.);
+                solids_.push_back(bumps_row_box);
+                auto bumps_row_log = make_shared_no_delete<G4LogicalVolume>(
+                    bumps_row_box.get(), materials_["world_material"], "bumps_row_" + name + "_log");
+                bumps_row_log->SetVisAttributes(G4VisAttributes::GetInvisible());
+                auto bumps_row_phys = make_shared_no_delete<G4PVReplica>("bumps_row_" + name + "_phys",
+                                                                         bumps_row_log.get(),
+                                                                         bumps_grid_log.get(),
+                                                                         kXAxis,
+                                                                         hybrid_model->getNPixels().x(),
+                                                                         model->getPixelSize().x());
+                geo_manager_->setExternalObject(name, "bumps_row_phys", bumps_row_phys);
+
+                auto bumps_pixel_box = make_shared_no_delete<G4Box>("bumps_pixel_" + name,
+                                                                    model->getPixelSize().x() / 2.0,
+                                                                    model->getPixelSize().y() / 2.0,
+                                                                    bump_height / 2.);
+                solids_.push_back(bumps_pixel_box);
+                auto bumps_pixel_log = make_shared_no_delete<G4LogicalVolume>(
+                    bumps_pixel_box.get(), materials_["world_material"], "bumps_pixel_" + name + "_log");
+                bumps_pixel_log->SetVisAttributes(G4VisAttributes::GetInvisible());
+                auto bumps_pixel_phys = make_shared_no_delete<G4PVReplica>("bumps_pixel_" + name + "_phys",
+                                                                           bumps_pixel_log.get(),
+                                                                           bumps_row_log.get(),
+                                                                           kYAxis,
+                                                                           hybrid_model->getNPixels().y(),
+                                                                           model->getPixelSize().y());
+                geo_manager_->setExternalObject(name, "bumps_pixel_phys", bumps_pixel_phys);
+
+                auto bumps_phys = make_shared_no_delete<G4PVPlacement>(nullptr,
+                                                                       G4ThreeVector(0, 0, 0),
+                                                                       bumps_cell_log.get(),
+                                                                       "bumps_" + name + "_phys",
+                                                                       bumps_pixel_log.get(),
+                                                                       false,
+                                                                       0,
+                                                                       false);
+                geo_manager_->setExternalObject(name, "bumps_phys", bumps_phys);
+            } else {
+                // Place the bump bonds grid as parameterised volume if the bumps extend beyond their pixel cells
+                LOG(DEBUG) << "  - Placing bump bonds as parameterised volume";
+                std::shared_ptr<G4VPVParameterisation> bumps_param =
+                    std::make_shared<Parameterization2DG4>(hybrid_model->getNPixels().x(),
+                                                           hybrid_model->getPixelSize().x(),
+                                                           hybrid_model->getPixelSize().y(),
+                                                           -grid_size_x / 2.0 + grid_offset_x,
+                                                           -grid_size_y / 2.0 + grid_offset_y,
+                                                           0);
+                geo_manager_->setExternalObject(name, "bumps_param", bumps_param);
+
+                std::shared_ptr<G4PVParameterised> bumps_param_phys =
+                    std::make_shared<ParameterisedG4>("bumps_" + name + "_phys",
+                                                      bumps_cell_log.get(),
+                                                      bumps_wrapper_log.get(),
+                                                      kUndefined,
+                                                      hybrid_model->getNPixels().x() * hybrid_model->getNPixels().y(),
+                                                      bumps_param.get(),
+                                                      false);
+                geo_manager_->setExternalObject(name, "bumps_param_phys", bumps_param_phys);
+            }
         }
 
         // ALERT: NO COVER LAYER YET
@@ -15,6 +15,9 @@
 #include <utility>
 
 #include <G4RunManager.hh>
+#ifdef G4MULTITHREADED
+#include <G4MTRunManager.hh>
+#endif
 #include <G4UImanager.hh>
 #include <G4UIterminal.hh>
 #include <G4Version.hh>
@@ -38,6 +41,8 @@ using namespace ROOT;
 
 GeometryBuilderGeant4Module::GeometryBuilderGeant4Module(Configuration& config, Messenger*, GeometryManager* geo_manager)
     : Module(config), geo_manager_(geo_manager), run_manager_g4_(nullptr) {
+    config_.setDefault<unsigned int>("number_of_threads", 1);
+
     geometry_construction_ = new GeometryConstructionG4(geo_manager_, config_);
 }
 
@@ -83,8 +88,23 @@ void GeometryBuilderGeant4Module::init() {
     SUPPRESS_STREAM(std::cout);
     SUPPRESS_STREAM(G4cout);
 
-    // Create the G4 run manager
-    run_manager_g4_ = std::make_unique<G4RunManager>();
+    // Create the G4 run manager, using worker threads for the tracking if requested
+    auto number_of_threads = config_.get<unsigned int>("number_of_threads");
+    if(number_of_threads == 0) {
+        throw InvalidValueError(config_, "number_of_threads", "number of threads should be strictly more than zero");
+    } else if(number_of_threads == 1) {
+        run_manager_g4_ = std::make_unique<G4RunManager>();
+    } else {
+#ifdef G4MULTITHREADED
+        auto run_manager_mt = std::make_unique<G4MTRunManager>();
+        run_manager_mt->SetNumberOfThreads(static_cast<int>(number_of_threads));
+        // Hand out single events to the workers, as their results are merged in the order of the events
+        run_manager_mt->SetEventModulo(1);
+        run_manager_g4_ = std::move(run_manager_mt);
+#else
+        throw InvalidValueError(config_, "number_of_threads", "Geant4 has been built without multithreading support");
+#endif
+    }
 
     // Release stdout again
     RELEASE_STREAM(std::cout);
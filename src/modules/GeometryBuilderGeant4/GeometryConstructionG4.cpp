@@ -125,8 +125,12 @@ G4VPhysicalVolume* GeometryConstructionG4::Construct() {
     const auto& detBuilder = new DetectorConstructionG4(geo_manager_);
     detBuilder->build(materials_, world_log_);
 
-    // Check for overlaps:
-    check_overlaps();
+    // Check for overlaps of all volumes at once, as the placements are not checked individually
+    if(config_.get<bool>("check_overlaps", true)) {
+        check_overlaps();
+    } else {
+        LOG(INFO) << "Not checking for overlapping volumes";
+    }
 
     return world_phys_.get();
 }
@@ -139,9 +139,9 @@ void PassiveMaterialModel::buildVolume(const std::map<std::string, G4Material*>&
         log_volume->SetVisAttributes(white_vol);
     }
 
-    // Place the physical volume of the passive material
+    // Place the physical volume of the passive material, overlaps are checked after constructing the full geometry
     auto phys_volume = make_shared_no_delete<G4PVPlacement>(
-        transform_phys, log_volume.get(), getName() + "_phys", mother_log_volume, false, 0, true);
+        transform_phys, log_volume.get(), getName() + "_phys", mother_log_volume, false, 0, false);
     geo_manager_->setExternalObject(getName(), "passive_material_phys", phys_volume);
     LOG(TRACE) << " Constructed passive material " << getName() << " successfully";
 }
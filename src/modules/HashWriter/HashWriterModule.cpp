@@ -0,0 +1,181 @@
+/**
+ * @file
+ * @brief Implementation of a module writing hashes of the output objects of every event
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "HashWriterModule.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "core/config/exceptions.h"
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    constexpr uint64_t fnv_offset = 14695981039346656037ull;
+    constexpr uint64_t fnv_prime = 1099511628211ull;
+
+    /**
+     * @brief Add the bytes of an integer value to a FNV-1a hash, starting from the least significant byte
+     */
+    void add_bytes(uint64_t& hash, uint64_t value) {
+        for(unsigned int byte = 0; byte < 8; ++byte) {
+            hash = (hash ^ ((value >> (8 * byte)) & 0xffu)) * fnv_prime;
+        }
+    }
+} // namespace
+
+HashWriterModule::HashWriterModule(Configuration& config, Messenger* messenger, GeometryManager*) : Module(config) {
+    // Only the hash file of this module is closed when finalizing
+    enable_parallel_finalization();
+
+    config_.setDefaultArray<std::string>("include", {"PixelHit", "PixelCharge", "PropagatedCharge"});
+    config_.setDefault<int>("significant_bits", 52);
+
+    // Only bind the included objects, such that no module creates objects for this module alone
+    for(auto& object : config_.getArray<std::string>("include")) {
+        if(object != "PixelHit" && object != "PixelCharge" && object != "PropagatedCharge") {
+            throw InvalidValueError(config_, "include", "only PixelHit, PixelCharge and PropagatedCharge can be hashed");
+        }
+        include_.insert(object);
+    }
+    if(include_.count("PixelHit") != 0) {
+        messenger->bindMulti(this, &HashWriterModule::pixel_hit_messages_);
+    }
+    if(include_.count("PixelCharge") != 0) {
+        messenger->bindMulti(this, &HashWriterModule::pixel_charge_messages_);
+    }
+    if(include_.count("PropagatedCharge") != 0) {
+        messenger->bindMulti(this, &HashWriterModule::propagated_charge_messages_);
+        messenger->bindMulti(this, &HashWriterModule::propagated_charge_array_messages_);
+    }
+}
+
+void HashWriterModule::init() {
+    significant_bits_ = config_.get<int>("significant_bits");
+    if(significant_bits_ < 1 || significant_bits_ > 52) {
+        throw InvalidValueError(config_, "significant_bits", "number of significant bits should be between 1 and 52");
+    }
+    if(significant_bits_ < 52) {
+        LOG(INFO) << "Hashing floating point values rounded to " << significant_bits_ << " significant bits";
+    }
+
+    output_file_name_ = createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name", "hashes"), "txt"));
+    output_file_ = std::make_unique<std::ofstream>(output_file_name_);
+    if(!output_file_->good()) {
+        throw ModuleError("Cannot open output file " + output_file_name_);
+    }
+    *output_file_ << "# Allpix Squared output hashes - https://cern.ch/allpix-squared\n";
+    *output_file_ << "# event object detector objects hash\n";
+}
+
+void HashWriterModule::add_value(uint64_t& hash, double value) const {
+    // Round the mantissa to the significant bits, adding zero maps negative zero to positive zero
+    if(significant_bits_ < 52 && std::isfinite(value)) {
+        int exponent = 0;
+        auto mantissa = std::frexp(value, &exponent);
+        value = std::ldexp(std::round(std::ldexp(mantissa, significant_bits_)), exponent - significant_bits_);
+    }
+    value += 0.;
+
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    add_bytes(hash, bits);
+}
+
+void HashWriterModule::add_message(std::map<std::pair<std::string, std::string>, Hash>& hashes,
+                                   const std::string& object,
+                                   const std::shared_ptr<const Detector>& detector,
+                                   size_t objects,
+                                   uint64_t hash) {
+    // The hashes of several messages are added, such that they do not depend on the order in which they are received
+    auto& sum = hashes[{object, (detector != nullptr ? detector->getName() : "<global>")}];
+    sum.objects += objects;
+    sum.value += hash;
+}
+
+void HashWriterModule::run(unsigned int event_num) {
+    std::map<std::pair<std::string, std::string>, Hash> hashes;
+
+    for(auto& message : pixel_hit_messages_) {
+        uint64_t hash = fnv_offset;
+        for(const auto& hit : message->getData()) {
+            add_bytes(hash, hit.getIndex().x());
+            add_bytes(hash, hit.getIndex().y());
+            add_value(hash, hit.getSignal());
+            add_value(hash, hit.getTime());
+        }
+        add_message(hashes, "PixelHit", message->getDetector(), message->getData().size(), hash);
+    }
+    for(auto& message : pixel_charge_messages_) {
+        uint64_t hash = fnv_offset;
+        for(const auto& pixel_charge : message->getData()) {
+            add_bytes(hash, pixel_charge.getIndex().x());
+            add_bytes(hash, pixel_charge.getIndex().y());
+            add_bytes(hash, pixel_charge.getCharge());
+        }
+        add_message(hashes, "PixelCharge", message->getDetector(), message->getData().size(), hash);
+    }
+
+    // Propagated charges hash to the same value, independent of whether they are dispatched as objects or in columns
+    for(auto& message : propagated_charge_messages_) {
+        uint64_t hash = fnv_offset;
+        for(const auto& propagated_charge : message->getData()) {
+            auto position = propagated_charge.getLocalPosition();
+            add_value(hash, position.x());
+            add_value(hash, position.y());
+            add_value(hash, position.z());
+            add_bytes(hash, static_cast<uint64_t>(static_cast<int64_t>(propagated_charge.getType())));
+            add_bytes(hash, propagated_charge.getCharge());
+            add_value(hash, propagated_charge.getEventTime());
+        }
+        add_message(hashes, "PropagatedCharge", message->getDetector(), message->getData().size(), hash);
+    }
+    for(auto& message : propagated_charge_array_messages_) {
+        uint64_t hash = fnv_offset;
+        const auto& charges = message->getData();
+        for(size_t i = 0; i < charges.size(); ++i) {
+            add_value(hash, charges.getLocalX()[i]);
+            add_value(hash, charges.getLocalY()[i]);
+            add_value(hash, charges.getLocalZ()[i]);
+            add_bytes(hash, static_cast<uint64_t>(static_cast<int64_t>(charges.getTypes()[i])));
+            add_bytes(hash, charges.getCharges()[i]);
+            add_value(hash, charges.getEventTimes()[i]);
+        }
+        add_message(hashes, "PropagatedCharge", message->getDetector(), charges.size(), hash);
+    }
+
+    // Write the hashes ordered by object type and detector
+    std::ostringstream event_text;
+    for(const auto& [key, hash] : hashes) {
+        event_text << event_num << ' ' << key.first << ' ' << key.second << ' ' << hash.objects << ' ' << std::hex
+                   << std::setw(16) << std::setfill('0') << hash.value << std::dec << std::setfill(' ') << '\n';
+    }
+    auto text = event_text.str();
+    output_file_->write(text.data(), static_cast<std::streamsize>(text.size()));
+    if(!output_file_->good()) {
+        throw ModuleError("Cannot write to output file " + output_file_name_);
+    }
+    LOG(DEBUG) << "Wrote " << hashes.size() << " hashes of event " << event_num;
+    hashes_written_ += hashes.size();
+    ++events_written_;
+}
+
+void HashWriterModule::finalize() {
+    *output_file_ << "# " << hashes_written_ << " hashes of " << events_written_ << " events" << std::endl;
+    output_file_->close();
+
+    LOG(STATUS) << "Wrote " << hashes_written_ << " hashes of " << events_written_ << " events to file:" << std::endl
+                << output_file_name_;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Definition of a module writing hashes of the output objects of every event
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_HASH_WRITER_MODULE_H
+#define ALLPIX_HASH_WRITER_MODULE_H
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+#include "objects/PropagatedCharge.hpp"
+#include "objects/PropagatedChargeArray.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write a hash of the content of the output objects of every event to a text file
+     *
+     * The pixel hits, pixel charges and propagated charges of every event are hashed with the 64-bit FNV-1a algorithm per
+     * object type and detector. Two runs can then be compared event by event with the hash comparison tool, for example to
+     * validate that a multithreaded run produces the same output as a run processing one event after another.
+     */
+    class HashWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_manager Pointer to the geometry manager, containing the detectors
+         */
+        HashWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
+
+        /**
+         * @brief Open the file to write the hashes to
+         */
+        void init() override;
+
+        /**
+         * @brief Hash the objects of the event and write the hashes to file
+         */
+        void run(unsigned int event_num) override;
+
+        /**
+         * @brief Close the file and print the number of hashes written
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Hash of the content of all messages of one object type and detector
+         */
+        struct Hash {
+            uint64_t objects{};
+            uint64_t value{};
+        };
+
+        /**
+         * @brief Add a value to a hash, rounded to the configured number of significant bits
+         * @param hash Running FNV-1a hash of a message
+         * @param value Value to add
+         */
+        void add_value(uint64_t& hash, double value) const;
+
+        /**
+         * @brief Add all objects of a message to the hashes of its object type and detector
+         * @param hashes Hashes of the event
+         * @param object Name of the object type
+         * @param detector Detector of the message
+         * @param objects Number of objects in the message
+         * @param hash Hash of the content of the message
+         */
+        static void add_message(std::map<std::pair<std::string, std::string>, Hash>& hashes,
+                                const std::string& object,
+                                const std::shared_ptr<const Detector>& detector,
+                                size_t objects,
+                                uint64_t hash);
+
+        std::vector<std::shared_ptr<PixelHitMessage>> pixel_hit_messages_;
+        std::vector<std::shared_ptr<PixelChargeMessage>> pixel_charge_messages_;
+        std::vector<std::shared_ptr<PropagatedChargeMessage>> propagated_charge_messages_;
+        std::vector<std::shared_ptr<PropagatedChargeArrayMessage>> propagated_charge_array_messages_;
+
+        std::set<std::string> include_;
+        int significant_bits_{};
+
+        std::string output_file_name_;
+        std::unique_ptr<std::ofstream> output_file_;
+        unsigned long hashes_written_{};
+        unsigned long events_written_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_HASH_WRITER_MODULE_H */
@@ -14,6 +14,7 @@
 
 #include "core/utils/log.h"
 #include "objects/PixelCharge.hpp"
+#include "tools/pixel_accumulator.h"
 
 using namespace allpix;
 using namespace ROOT::Math;
@@ -23,8 +24,10 @@ InducedTransferModule::InducedTransferModule(Configuration& config,
                                              const std::shared_ptr<Detector>& detector)
     : Module(config, detector), messenger_(messenger), detector_(detector) {
     using XYVectorInt = DisplacementVector2D<Cartesian2D<int>>;
-    // Enable parallelization of this module if multithreading is enabled
+    // Enable parallelization of this module if multithreading is enabled, all state of an event is kept in the run method
+    // such that also several events can be transferred at the same time
     enable_parallelization();
+    enable_event_parallelization();
 
     // Save detector model
     model_ = detector_->getModel();
@@ -33,11 +36,13 @@ InducedTransferModule::InducedTransferModule(Configuration& config,
     config_.setDefault<XYVectorInt>("induction_matrix", XYVectorInt(3, 3));
     matrix_ = config_.get<XYVectorInt>("induction_matrix");
 
-    // Require propagated deposits for single detector
-    messenger_->bindSingle(this, &InducedTransferModule::propagated_message_, MsgFlags::REQUIRED);
+    // Require propagated deposits for single detector, either as objects or in columnar form, fetched in the run method
+    messenger_->bindSingle(this, &InducedTransferModule::propagated_message_);
+    messenger_->bindSingle(this, &InducedTransferModule::propagated_array_message_);
 }
 
 void InducedTransferModule::init() {
+    geometry_ = detector_->getGeometryView();
 
     // This module requires a weighting potential - otherwise everything is lost...
     if(!detector_->hasWeightingPotential()) {
@@ -46,57 +51,105 @@ void InducedTransferModule::init() {
 }
 
 void InducedTransferModule::run(unsigned int) {
+    auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this);
+    auto propagated_array_message = messenger_->fetchMessage<PropagatedChargeArrayMessage>(this);
+    if(propagated_message == nullptr && propagated_array_message == nullptr) {
+        LOG(TRACE) << "No propagated charges received, skipping event";
+        return;
+    }
+
     // Calculate induced charge by total motion of charge carriers
     LOG(TRACE) << "Calculating induced charge on pixels";
     bool found_electrons = false, found_holes = false;
-
-    std::map<Pixel::Index, std::vector<std::pair<double, const PropagatedCharge*>>> pixel_map;
-    for(auto& propagated_charge : propagated_message_->getData()) {
-
+    auto check_type = [&](CarrierType type) {
         // Make sure both electrons and holes are present in the input data
-        if(propagated_charge.getType() == CarrierType::ELECTRON) {
+        if(type == CarrierType::ELECTRON) {
             found_electrons = true;
-        } else if(propagated_charge.getType() == CarrierType::HOLE) {
+        } else if(type == CarrierType::HOLE) {
             found_holes = true;
         }
+    };
 
-        auto deposited_charge = propagated_charge.getDepositedCharge();
-
-        // Get start and end point by looking at deposited and propagated charge local positions
-        auto position_end = propagated_charge.getLocalPosition();
-        auto position_start = deposited_charge->getLocalPosition();
-
-        // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position_end.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position_end.y() / model_->getPixelSize().y()));
-        LOG(TRACE) << "Calculating induced charge from carriers below pixel "
-                   << Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel)) << ", moved from "
-                   << Units::display(position_start, {"um", "mm"}) << " to " << Units::display(position_end, {"um", "mm"})
-                   << ", " << Units::display(propagated_charge.getEventTime() - deposited_charge->getEventTime(), "ns");
-
-        // Loop over NxN pixels:
-        for(int x = xpixel - matrix_.x() / 2; x <= xpixel + matrix_.x() / 2; x++) {
-            for(int y = ypixel - matrix_.y() / 2; y <= ypixel + matrix_.y() / 2; y++) {
-                // Ignore if out of pixel grid
-                if(!detector_->isWithinPixelGrid(x, y)) {
-                    LOG(TRACE) << "Pixel (" << x << "," << y << ") skipped, outside the grid";
-                    continue;
-                }
+    std::vector<PixelCharge> pixel_charges;
+    if(propagated_message != nullptr) {
+        // Accumulator kept per thread to reuse its memory across events
+        thread_local PixelAccumulator<std::pair<double, const PropagatedCharge*>> pixel_map;
+        pixel_map.reset(model_->getNPixels());
+        for(auto& propagated_charge : propagated_message->getData()) {
+            check_type(propagated_charge.getType());
+
+            // Get start and end point by looking at deposited and propagated charge local positions
+            auto deposited_charge = propagated_charge.getDepositedCharge();
+            LOG(TRACE) << "Induced charge from carriers moved in "
+                       << Units::display(propagated_charge.getEventTime() - deposited_charge->getEventTime(), "ns");
+            induce_charge(deposited_charge->getLocalPosition(),
+                          propagated_charge.getLocalPosition(),
+                          propagated_charge.getCharge(),
+                          propagated_charge.getType(),
+                          [&](const Pixel::Index& pixel_index, double induced) {
+                              pixel_map.add(pixel_index, {induced, &propagated_charge});
+                          });
+        }
 
-                Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
-                auto ramo_end = detector_->getWeightingPotential(position_end, pixel_index);
-                auto ramo_start = detector_->getWeightingPotential(position_start, pixel_index);
+        // Create pixel charges
+        LOG(TRACE) << "Combining charges at same pixel";
+        std::vector<const PropagatedCharge*> prop_charges;
+        pixel_map.forEachPixel([&](const Pixel::Index& pixel_index, auto begin, auto end) {
+            double charge = 0;
+            prop_charges.clear();
+            for(auto iter = begin; iter != end; ++iter) {
+                charge += iter->first;
+                if(has_object_history()) {
+                    prop_charges.push_back(iter->second);
+                }
+            }
 
-                // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
-                auto induced = propagated_charge.getCharge() * (ramo_end - ramo_start) *
-                               (-static_cast<std::underlying_type<CarrierType>::type>(propagated_charge.getType()));
-                LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo_end - ramo_start) << ", induced "
-                           << propagated_charge.getType() << " q = " << Units::display(induced, "e");
+            // Get pixel object from detector
+            auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+
+            pixel_charges.emplace_back(pixel, std::round(std::fabs(charge)), prop_charges);
+            LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+        });
+    } else {
+        const auto& propagated_charges = propagated_array_message->getData();
+        const auto& types = propagated_charges.getTypes();
+        const auto& charges = propagated_charges.getCharges();
+        const auto& deposited_charges = propagated_charges.getDepositedCharges();
+
+        // Accumulator of the indices of the sets kept per thread to reuse its memory across events
+        thread_local PixelAccumulator<std::pair<double, size_t>> pixel_map;
+        pixel_map.reset(model_->getNPixels());
+        for(size_t i = 0; i < propagated_charges.size(); ++i) {
+            check_type(types[i]);
+            induce_charge(deposited_charges[i]->getLocalPosition(),
+                          propagated_charges.getLocalPosition(i),
+                          charges[i],
+                          types[i],
+                          [&](const Pixel::Index& pixel_index, double induced) {
+                              pixel_map.add(pixel_index, {induced, i});
+                          });
+        }
 
-                // Add the pixel the list of hit pixels
-                pixel_map[pixel_index].emplace_back(induced, &propagated_charge);
+        // Create pixel charges
+        LOG(TRACE) << "Combining charges at same pixel";
+        std::vector<const DepositedCharge*> pixel_deposited_charges;
+        pixel_map.forEachPixel([&](const Pixel::Index& pixel_index, auto begin, auto end) {
+            double charge = 0;
+            pixel_deposited_charges.clear();
+            for(auto iter = begin; iter != end; ++iter) {
+                charge += iter->first;
+                if(has_object_history()) {
+                    pixel_deposited_charges.push_back(deposited_charges[iter->second]);
+                }
             }
-        }
+
+            // Get pixel object from detector
+            auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+
+            pixel_charges.emplace_back(
+                pixel, static_cast<unsigned int>(std::round(std::fabs(charge))), pixel_deposited_charges);
+            LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+        });
     }
 
     // Send an error message if this even only contained one of the two carrier types
@@ -106,25 +159,53 @@ void InducedTransferModule::run(unsigned int) {
                    << "This will cause wrong calculation of induced charge";
     }
 
-    // Create pixel charges
-    LOG(TRACE) << "Combining charges at same pixel";
-    std::vector<PixelCharge> pixel_charges;
-    for(auto& pixel_index_charge : pixel_map) {
-        double charge = 0;
-        std::vector<const PropagatedCharge*> prop_charges;
-        for(auto& prop_pair : pixel_index_charge.second) {
-            charge += prop_pair.first;
-            prop_charges.push_back(prop_pair.second);
-        }
-
-        // Get pixel object from detector
-        auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
-
-        pixel_charges.emplace_back(pixel, std::round(std::fabs(charge)), prop_charges);
-        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
-    }
-
     // Dispatch message of pixel charges
     auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector_);
     messenger_->dispatchMessage(this, pixel_message);
 }
+
+template <typename F>
+void InducedTransferModule::induce_charge(const ROOT::Math::XYZPoint& position_start,
+                                          const ROOT::Math::XYZPoint& position_end,
+                                          unsigned int charge,
+                                          CarrierType type,
+                                          F&& add_induced) const {
+    // Find the nearest pixel
+    auto [xpixel, ypixel] = geometry_.getPixel(position_end);
+    LOG(TRACE) << "Calculating induced charge from carriers below pixel "
+               << Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel)) << ", moved from "
+               << Units::display(position_start, {"um", "mm"}) << " to " << Units::display(position_end, {"um", "mm"});
+
+    // Look up the weighting potentials of all NxN pixels at once
+    thread_local std::vector<double> potentials_end, potentials_start;
+    detector_->getWeightingPotentials(position_end, xpixel, ypixel, matrix_.x(), matrix_.y(), potentials_end);
+    detector_->getWeightingPotentials(position_start, xpixel, ypixel, matrix_.x(), matrix_.y(), potentials_start);
+    const int matrix_x = xpixel - matrix_.x() / 2;
+    const int matrix_y = ypixel - matrix_.y() / 2;
+    const int matrix_height = 2 * (matrix_.y() / 2) + 1;
+
+    // Loop over NxN pixels:
+    for(int x = matrix_x; x <= xpixel + matrix_.x() / 2; x++) {
+        for(int y = matrix_y; y <= ypixel + matrix_.y() / 2; y++) {
+            // Ignore if out of pixel grid
+            if(!geometry_.isWithinPixelGrid(x, y)) {
+                LOG(TRACE) << "Pixel (" << x << "," << y << ") skipped, outside the grid";
+                continue;
+            }
+
+            Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
+            auto index = static_cast<size_t>((x - matrix_x) * matrix_height + (y - matrix_y));
+            auto ramo_end = potentials_end[index];
+            auto ramo_start = potentials_start[index];
+
+            // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
+            auto induced =
+                charge * (ramo_end - ramo_start) * (-static_cast<std::underlying_type<CarrierType>::type>(type));
+            LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo_end - ramo_start) << ", induced " << type
+                       << " q = " << Units::display(induced, "e");
+
+            // Add the pixel the list of hit pixels
+            add_induced(pixel_index, induced);
+        }
+    }
+}
@@ -15,6 +15,7 @@
 #include "core/module/Module.hpp"
 
 #include "objects/PropagatedCharge.hpp"
+#include "objects/PropagatedChargeArray.hpp"
 
 namespace allpix {
     /**
@@ -27,7 +28,8 @@ namespace allpix {
      * object in the history. The total induced charge is calculated per pixel and published as PixelCharge object.
      *
      * This module requires a weighting potential and only works properly of both electrons and holes are present among the
-     * propagated charge carriers.
+     * propagated charge carriers. The propagated charges are either received as objects or in columnar form, in which case
+     * the pixel charges are linked to the Monte-Carlo particles of the deposits instead of the propagated charges.
      */
     class InducedTransferModule : public Module {
     public:
@@ -50,12 +52,29 @@ namespace allpix {
         void run(unsigned int) override;
 
     private:
+        /**
+         * @brief Calculate the charge induced by a set of charge carriers on the pixels of the induction matrix
+         * @param position_start Local position the charge carriers were deposited at
+         * @param position_end Local position the charge carriers were propagated to
+         * @param charge Number of charge carriers
+         * @param type Type of the charge carriers
+         * @param add_induced Function called with the index of every pixel within the grid and the charge induced on it
+         */
+        template <typename F>
+        void induce_charge(const ROOT::Math::XYZPoint& position_start,
+                           const ROOT::Math::XYZPoint& position_end,
+                           unsigned int charge,
+                           CarrierType type,
+                           F&& add_induced) const;
+
         Messenger* messenger_;
         std::shared_ptr<Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
+        DetectorGeometryView geometry_;
 
-        // Message containing the propagated charges
+        // Messages containing the propagated charges, either as objects or in columnar form
         std::shared_ptr<PropagatedChargeMessage> propagated_message_;
+        std::shared_ptr<PropagatedChargeArrayMessage> propagated_array_message_;
 
         // Induction matrix size in number of pixels along x and y
         ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>> matrix_;
@@ -92,6 +92,8 @@ inline std::array<long double, 3> getRotationAnglesFromMatrix(ROOT::Math::Rotati
 
 LCIOWriterModule::LCIOWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo)
     : Module(config), geo_mgr_(geo) {
+    // The LCIO and geometry files are only written by this module, such that it can be finalized with other modules
+    enable_parallel_finalization();
 
     // Bind pixel hits message
     messenger->bindMulti(this, &LCIOWriterModule::pixel_messages_, MsgFlags::REQUIRED);
@@ -243,31 +245,60 @@ void LCIOWriterModule::init() {
     run->setRunNumber(1);
     run->setDetectorName(detector_name_);
     lcWriter_->writeRunHeader(run.get());
-}
-
-void LCIOWriterModule::run(unsigned int eventNb) {
-    auto evt = std::make_unique<LCEventImpl>(); // create the event
-    evt->setRunNumber(1);
-    evt->setEventNumber(static_cast<int>(eventNb)); // set the event attributes
-    evt->parameters().setValue("EventType", 2);
 
-    auto output_col_vec = std::vector<LCCollectionVec*>();
-    auto output_col_encoder_vec = std::vector<std::unique_ptr<CellIDEncoder<TrackerDataImpl>>>();
     // Prepare dynamic output setup and their CellIDEncoders which are defined by the user's config
+    auto output_col_encoder_vec = std::vector<std::unique_ptr<CellIDEncoder<TrackerDataImpl>>>();
     for(size_t i = 0; i < collection_names_vector_.size(); ++i) {
-        output_col_vec.emplace_back(new LCCollectionVec(LCIO::TRACKERDATA));
-        output_col_encoder_vec.emplace_back(
-            std::make_unique<CellIDEncoder<TrackerDataImpl>>(eutelescope::gTrackerDataEncoding, output_col_vec.back()));
+        output_col_vec_.emplace_back(std::make_unique<LCCollectionVec>(LCIO::TRACKERDATA));
+        output_col_encoder_vec.emplace_back(std::make_unique<CellIDEncoder<TrackerDataImpl>>(
+            eutelescope::gTrackerDataEncoding, output_col_vec_.back().get()));
     }
 
-    LCCollectionVec* mc_cluster_vec = nullptr;
-    LCCollectionVec* mc_cluster_raw_vec = nullptr;
-    LCCollectionVec* mc_hit_vec = nullptr;
-    LCCollectionVec* mc_track_vec = nullptr;
+    // Create the object holding the pixel data of every sensor, only its charge vector changes between events
+    for(auto const& det_id_name_pair : detector_names_to_id_) {
+        auto det_id = det_id_name_pair.second;
+        auto hit = new TrackerDataImpl();
+        auto col_index = detector_ids_to_colllection_index_[det_id];
+        (*output_col_encoder_vec[col_index])["sensorID"] = det_id;
+        (*output_col_encoder_vec[col_index])["sparsePixelType"] = pixel_type_;
+        output_col_encoder_vec[col_index]->setCellID(hit);
+        output_col_vec_[col_index]->push_back(hit);
+        sensor_data_[det_id] = hit;
+    }
 
-    std::unique_ptr<CellIDEncoder<TrackerDataImpl>> mc_cluster_raw_encoder = nullptr;
-    std::unique_ptr<CellIDEncoder<TrackerPulseImpl>> mc_cluster_encoder = nullptr;
-    std::unique_ptr<CellIDEncoder<TrackerHitImpl>> mc_hit_encoder = nullptr;
+    if(dump_mc_truth_ == true) {
+        // Prepare static Monte-Carlo output setup and their CellIDEncoders which are the same every time
+        mc_cluster_vec_ = std::make_unique<LCCollectionVec>(LCIO::TRACKERPULSE);
+        mc_cluster_raw_vec_ = std::make_unique<LCCollectionVec>(LCIO::TRACKERDATA);
+        mc_hit_vec_ = std::make_unique<LCCollectionVec>(LCIO::TRACKERHIT);
+        mc_track_vec_ = std::make_unique<LCCollectionVec>(LCIO::TRACK);
+
+        mc_cluster_raw_encoder_ =
+            std::make_unique<CellIDEncoder<TrackerDataImpl>>(eutelescope::gTrackerDataEncoding, mc_cluster_raw_vec_.get());
+        mc_cluster_encoder_ =
+            std::make_unique<CellIDEncoder<TrackerPulseImpl>>(eutelescope::gTrackerPulseEncoding, mc_cluster_vec_.get());
+        mc_hit_encoder_ =
+            std::make_unique<CellIDEncoder<TrackerHitImpl>>(eutelescope::gTrackerHitEncoding, mc_hit_vec_.get());
+
+        LCFlagImpl flag(mc_track_vec_->getFlag());
+        flag.setBit(LCIO::TRBIT_HITS);
+        mc_track_vec_->setFlag(flag.getFlag());
+    }
+
+    // Write the events asynchronously if requested
+    auto async_queue_size = config_.get<size_t>("async_queue_size", 16);
+    if(async_queue_size == 0) {
+        throw InvalidValueError(config_, "async_queue_size", "queue size should be larger than zero");
+    }
+    if(config_.get<bool>("async_write", false)) {
+        LOG(DEBUG) << "Writing events asynchronously with a queue of " << async_queue_size << " events";
+        enable_async_tasks(async_queue_size);
+    }
+}
+
+void LCIOWriterModule::run(unsigned int eventNb) {
+    EventData data;
+    data.event = eventNb;
 
     // The detector id is only attached to the message, not the MCParticle, thus we store it here
     auto mcp_to_det_id = std::map<MCParticle const*, unsigned>{};
@@ -275,30 +306,18 @@ void LCIOWriterModule::run(unsigned int eventNb) {
     // Monte Carlo truth cluster
     auto mcp_to_pixel_data_vec = std::map<MCParticle const*, std::vector<std::vector<float>>>{};
 
-    if(dump_mc_truth_ == true) {
-        // Prepare static Monte-Carlo output setup and their CellIDEncoders which are the same every time
-        mc_cluster_vec = new LCCollectionVec(LCIO::TRACKERPULSE);
-        mc_cluster_raw_vec = new LCCollectionVec(LCIO::TRACKERDATA);
-        mc_hit_vec = new LCCollectionVec(LCIO::TRACKERHIT);
-        mc_track_vec = new LCCollectionVec(LCIO::TRACK);
-
-        mc_cluster_raw_encoder =
-            std::make_unique<CellIDEncoder<TrackerDataImpl>>(eutelescope::gTrackerDataEncoding, mc_cluster_raw_vec);
-        mc_cluster_encoder =
-            std::make_unique<CellIDEncoder<TrackerPulseImpl>>(eutelescope::gTrackerPulseEncoding, mc_cluster_vec);
-        mc_hit_encoder = std::make_unique<CellIDEncoder<TrackerHitImpl>>(eutelescope::gTrackerHitEncoding, mc_hit_vec);
-    }
-
     // In LCIO the 'charge vector' is a vector of floats which correspond to hit pixels, depending on the pixel
     // type in EUTelescope the number of entries per pixel varies
-    std::map<unsigned, std::vector<float>> charges;
     for(auto const& det : detector_names_to_id_) {
-        charges[det.second] = std::vector<float>{};
+        data.charges[det.second] = std::vector<float>{};
     }
 
     // Receive all pixel messages, fill charge vectors
     for(const auto& hit_msg : pixel_messages_) {
         LOG(DEBUG) << hit_msg->getDetector()->getName();
+        unsigned det_id = detector_names_to_id_[hit_msg->getDetector()->getName()];
+        auto& charges = data.charges[det_id];
+
         for(const auto& hitdata : hit_msg->getData()) {
 
             auto this_hit_charge_vec = std::vector<float>{};
@@ -306,36 +325,20 @@ void LCIOWriterModule::run(unsigned int eventNb) {
             LOG(DEBUG) << "X: " << hitdata.getPixel().getIndex().x() << ", Y:" << hitdata.getPixel().getIndex().y()
                        << ", Signal: " << hitdata.getSignal();
 
-            unsigned det_id = detector_names_to_id_[hit_msg->getDetector()->getName()];
-
             switch(pixel_type_) {
-            case 1:                                                                               // EUTelSimpleSparsePixel
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                charges[det_id].push_back(static_cast<float>(hitdata.getSignal()));               // signal
+            case 1: // EUTelSimpleSparsePixel
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getSignal()));               // signal
                 break;
             case 2:  // EUTelGenericSparsePixel
             default: // EUTelGenericSparsePixel is default
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                charges[det_id].push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                charges[det_id].push_back(0.0);
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getSignal()));               // signal
                 this_hit_charge_vec.push_back(0.0);                                                   // time
                 break;
-            case 5:                                                                               // EUTelTimepix3SparsePixel
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                charges[det_id].push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                charges[det_id].push_back(0.0);                                                   // time
-                charges[det_id].push_back(0.0);                                                   // time
-                charges[det_id].push_back(0.0);                                                   // time
-                charges[det_id].push_back(0.0);                                                   // time
+            case 5: // EUTelTimepix3SparsePixel
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
                 this_hit_charge_vec.push_back(static_cast<float>(hitdata.getSignal()));               // signal
@@ -345,105 +348,139 @@ void LCIOWriterModule::run(unsigned int eventNb) {
                 this_hit_charge_vec.push_back(0.0);                                                   // time
                 break;
             }
+            charges.insert(charges.end(), this_hit_charge_vec.begin(), this_hit_charge_vec.end());
 
-            for(auto const& mcp : hitdata.getMCParticles()) {
-                mcp_to_det_id[mcp] = det_id;
-                mcp_to_pixel_data_vec[mcp].emplace_back(this_hit_charge_vec);
+            if(dump_mc_truth_ == true) {
+                for(auto const& mcp : hitdata.getMCParticles()) {
+                    mcp_to_det_id[mcp] = det_id;
+                    mcp_to_pixel_data_vec[mcp].emplace_back(this_hit_charge_vec);
+                }
             }
         }
     }
 
-    // Every track will be linked to at least one (typically multiple) MCParticles and thus TrackerData objects
-    auto mctrk_to_hit_data_vec = std::map<MCTrack const*, std::vector<TrackerHitImpl*>>{};
+    // A MCParticle will be reflected by an LCIO hit and cluster, every track will be linked to at least one (typically
+    // multiple) MCParticles and thus clusters
+    auto mctrk_to_cluster_vec = std::map<MCTrack const*, std::vector<size_t>>{};
+    for(auto& mcp_pixel_data_vec_pair : mcp_to_pixel_data_vec) {
+        auto& mc_particle = mcp_pixel_data_vec_pair.first;
+
+        TruthCluster cluster;
+        cluster.sensor_id = mcp_to_det_id[mc_particle];
+
+        // Every detected pixel hit which had charge contribution from this MCParticle will be added to the cluster
+        for(auto const& pixel_hit_charge_vec : mcp_pixel_data_vec_pair.second) {
+            cluster.charges.insert(
+                std::end(cluster.charges), std::begin(pixel_hit_charge_vec), std::end(pixel_hit_charge_vec));
+        }
+
+        // we take the centre of the MCParticle to be the global z-position
+        auto const& hit_start_pos = mc_particle->getGlobalStartPoint();
+        auto const& hit_end_pos = mc_particle->getGlobalEndPoint();
+        cluster.position = std::array<double, 3>{{0.5 * (hit_start_pos.x() + hit_end_pos.x()),
+                                                  0.5 * (hit_start_pos.y() + hit_end_pos.y()),
+                                                  0.5 * (hit_start_pos.z() + hit_end_pos.z())}};
+
+        cluster.properties = eutelescope::HitProperties::kHitInGlobalCoord + eutelescope::HitProperties::kSimulatedHit;
+        if(mc_particle->getTrack()->getParent() != nullptr) {
+            cluster.properties += eutelescope::HitProperties::kDeltaHit;
+        }
+
+        mctrk_to_cluster_vec[mc_particle->getTrack()].emplace_back(data.clusters.size());
+        data.clusters.push_back(std::move(cluster));
+    }
+    for(auto& pair : mctrk_to_cluster_vec) {
+        data.tracks.push_back(std::move(pair.second));
+    }
+
+    // Write the event after all previous events, asynchronously if enabled
+    run_async([this, data = std::move(data)]() { write_event(data); });
+}
+
+void LCIOWriterModule::write_event(const EventData& data) {
+    auto evt = std::make_unique<LCEventImpl>(); // create the event
+    evt->setRunNumber(1);
+    evt->setEventNumber(static_cast<int>(data.event)); // set the event attributes
+    evt->parameters().setValue("EventType", 2);
+
+    // Fill hitvector with event data
+    for(auto& sensor : sensor_data_) {
+        sensor.second->setChargeValues(data.charges.at(sensor.first));
+    }
 
     // A MCParticle will be reflected by an LCIO hit and cluster - the hit is stored in a TrackerHit, the cluster in
     // a TrackerPulse linked to a TrackerData object
     if(dump_mc_truth_ == true) {
-        for(auto& mcp_pixel_data_vec_pair : mcp_to_pixel_data_vec) {
+        auto mc_hits = std::vector<TrackerHitImpl*>{};
+        for(auto& cluster : data.clusters) {
             auto mc_tracker_data = new TrackerDataImpl();
             auto mc_tracker_pulse = new TrackerPulseImpl();
             auto mc_tracker_hit = new TrackerHitImpl();
 
-            auto& mc_particle = mcp_pixel_data_vec_pair.first;
-
-            // Every detected pixel hit which had charge contribution from this MCParticle will be added to the cluster
-            std::vector<float> truth_cluster_charge_vec;
-            for(auto const& pixel_hit_charge_vec : mcp_pixel_data_vec_pair.second) {
-                truth_cluster_charge_vec.insert(
-                    std::end(truth_cluster_charge_vec), std::begin(pixel_hit_charge_vec), std::end(pixel_hit_charge_vec));
-            }
-
-            mc_tracker_data->setChargeValues(truth_cluster_charge_vec);
-            (*mc_cluster_raw_encoder)["sensorID"] = mcp_to_det_id[mc_particle];
-            (*mc_cluster_raw_encoder)["sparsePixelType"] = pixel_type_;
-            mc_cluster_raw_encoder->setCellID(mc_tracker_data);
-            mc_cluster_raw_vec->push_back(mc_tracker_data);
+            mc_tracker_data->setChargeValues(cluster.charges);
+            (*mc_cluster_raw_encoder_)["sensorID"] = cluster.sensor_id;
+            (*mc_cluster_raw_encoder_)["sparsePixelType"] = pixel_type_;
+            mc_cluster_raw_encoder_->setCellID(mc_tracker_data);
+            mc_cluster_raw_vec_->push_back(mc_tracker_data);
 
             mc_tracker_pulse->setTrackerData(mc_tracker_data);
-            (*mc_cluster_encoder)["sensorID"] = mcp_to_det_id[mc_particle];
-            (*mc_cluster_encoder)["type"] = 1; // corresponds to kEUTelGenericSparseClusterImpl
-            mc_cluster_encoder->setCellID(mc_tracker_pulse);
-            mc_cluster_vec->push_back(mc_tracker_pulse);
-
-            // we take the centre of the MCParticle to be the global z-position
-            auto const& hit_start_pos = mc_particle->getGlobalStartPoint();
-            auto const& hit_end_pos = mc_particle->getGlobalEndPoint();
-            auto pos_arr = std::array<double, 3>{{0.5 * (hit_start_pos.x() + hit_end_pos.x()),
-                                                  0.5 * (hit_start_pos.y() + hit_end_pos.y()),
-                                                  0.5 * (hit_start_pos.z() + hit_end_pos.z())}};
-            mc_tracker_hit->setPosition(pos_arr.data());
-            mc_tracker_hit->setType(1); // corresponds to kEUTelGenericSparseClusterImpl
-            (*mc_hit_encoder)["sensorID"] = mcp_to_det_id[mc_particle];
+            (*mc_cluster_encoder_)["sensorID"] = cluster.sensor_id;
+            (*mc_cluster_encoder_)["type"] = 1; // corresponds to kEUTelGenericSparseClusterImpl
+            mc_cluster_encoder_->setCellID(mc_tracker_pulse);
+            mc_cluster_vec_->push_back(mc_tracker_pulse);
 
-            int hit_properties = eutelescope::HitProperties::kHitInGlobalCoord + eutelescope::HitProperties::kSimulatedHit;
-            if(mc_particle->getTrack()->getParent() != nullptr) {
-                hit_properties += eutelescope::HitProperties::kDeltaHit;
-            }
-            (*mc_hit_encoder)["properties"] = hit_properties;
-
-            mc_hit_encoder->setCellID(mc_tracker_hit);
+            mc_tracker_hit->setPosition(cluster.position.data());
+            mc_tracker_hit->setType(1); // corresponds to kEUTelGenericSparseClusterImpl
+            (*mc_hit_encoder_)["sensorID"] = cluster.sensor_id;
+            (*mc_hit_encoder_)["properties"] = cluster.properties;
+            mc_hit_encoder_->setCellID(mc_tracker_hit);
             mc_tracker_hit->rawHits() = std::vector<LCObject*>{mc_tracker_data};
-            mc_hit_vec->push_back(mc_tracker_hit);
-            mctrk_to_hit_data_vec[mc_particle->getTrack()].emplace_back(mc_tracker_hit);
+            mc_hit_vec_->push_back(mc_tracker_hit);
+            mc_hits.push_back(mc_tracker_hit);
         }
-    }
-    // Fill hitvector with event data
-    for(auto const& det_id_name_pair : detector_names_to_id_) {
-        auto det_id = det_id_name_pair.second;
-        auto hit = new TrackerDataImpl();
-        hit->setChargeValues(charges[det_id]);
-        auto col_index = detector_ids_to_colllection_index_[det_id];
-        (*output_col_encoder_vec[col_index])["sensorID"] = det_id;
-        (*output_col_encoder_vec[col_index])["sparsePixelType"] = pixel_type_;
-        output_col_encoder_vec[col_index]->setCellID(hit);
-        output_col_vec[col_index]->push_back(hit);
-    }
 
-    if(dump_mc_truth_ == true) {
-        LCFlagImpl flag(mc_track_vec->getFlag());
-        flag.setBit(LCIO::TRBIT_HITS);
-        mc_track_vec->setFlag(flag.getFlag());
-        for(auto& pair : mctrk_to_hit_data_vec) {
+        for(auto& track_clusters : data.tracks) {
             auto track = new TrackImpl();
-            for(auto& hit : pair.second) {
-                // std::cout << "Got hit: " << hit << " z-pos: " << hit->getPosition()[2] << '\n';
-                track->addHit(hit);
+            for(auto& cluster_index : track_clusters) {
+                track->addHit(mc_hits[cluster_index]);
             }
-            mc_track_vec->push_back(track);
+            mc_track_vec_->push_back(track);
         }
 
-        // Add collection to event and write event to LCIO file
-        evt->addCollection(mc_track_vec, "mc_track");
-        evt->addCollection(mc_hit_vec, "mc_hit");
-        evt->addCollection(mc_cluster_raw_vec, "mc_raw_cluster");
-        evt->addCollection(mc_cluster_vec, "mc_cluster");
+        // Add collection to event
+        evt->addCollection(mc_track_vec_.get(), "mc_track");
+        evt->addCollection(mc_hit_vec_.get(), "mc_hit");
+        evt->addCollection(mc_cluster_raw_vec_.get(), "mc_raw_cluster");
+        evt->addCollection(mc_cluster_vec_.get(), "mc_cluster");
     }
     for(size_t i = 0; i < collection_names_vector_.size(); i++) {
-        evt->addCollection(output_col_vec[i], collection_names_vector_[i]);
+        evt->addCollection(output_col_vec_[i].get(), collection_names_vector_[i]);
     }
 
-    lcWriter_->writeEvent(evt.get()); // write the event to the file
+    // Take back the ownership of the reused collections before the event is deleted
+    auto take_collections = [&evt]() {
+        for(auto const& name : *evt->getCollectionNames()) {
+            evt->takeCollection(name);
+        }
+    };
+    try {
+        lcWriter_->writeEvent(evt.get()); // write the event to the file
+    } catch(...) {
+        take_collections();
+        throw;
+    }
+    take_collections();
     write_cnt_++;
+
+    // Delete the Monte Carlo truth objects of this event
+    if(dump_mc_truth_ == true) {
+        for(auto* collection : {mc_track_vec_.get(), mc_hit_vec_.get(), mc_cluster_vec_.get(), mc_cluster_raw_vec_.get()}) {
+            for(auto* object : *collection) {
+                delete object;
+            }
+            collection->clear();
+        }
+    }
 }
 
 void LCIOWriterModule::finalize() {
@@ -7,6 +7,9 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <array>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -17,7 +20,12 @@
 
 #include "objects/PixelHit.hpp"
 
+#include <IMPL/LCCollectionVec.h>
+#include <IMPL/TrackerDataImpl.h>
+#include <IMPL/TrackerHitImpl.h>
+#include <IMPL/TrackerPulseImpl.h>
 #include <IO/LCWriter.h>
+#include <UTIL/CellIDEncoder.h>
 
 namespace allpix {
     /**
@@ -25,6 +33,10 @@ namespace allpix {
      * @brief Module to write hit data to LCIO file
      *
      * Create LCIO file, compatible to EUTelescope analysis framework.
+     *
+     * The collections and their encoders are created once and reused for all events. The pixel data of every event is
+     * collected in plain vectors, which are converted to LCIO objects and written to file either directly or by the
+     * asynchronous task thread of the module.
      */
     class LCIOWriterModule : public Module {
     public:
@@ -36,10 +48,8 @@ namespace allpix {
          */
         LCIOWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
 
-        ~LCIOWriterModule(){};
-
         /**
-         * @brief Initialize LCIO and GEAR output files
+         * @brief Initialize LCIO and GEAR output files, create the collections and start the writer thread if requested
          */
         void init() override;
 
@@ -54,6 +64,34 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Monte Carlo truth cluster of a single MCParticle
+         */
+        struct TruthCluster {
+            unsigned sensor_id{};
+            std::vector<float> charges;
+            std::array<double, 3> position{};
+            int properties{};
+        };
+
+        /**
+         * @brief Data of a single event, independent of the messages it has been converted from
+         */
+        struct EventData {
+            unsigned int event{};
+            // Charge vector of every sensor
+            std::map<unsigned, std::vector<float>> charges;
+            // Truth clusters and the indices of the clusters of every Monte Carlo track
+            std::vector<TruthCluster> clusters;
+            std::vector<std::vector<size_t>> tracks;
+        };
+
+        /**
+         * @brief Fill the reused collections with the data of an event and write the event to file
+         * @param data Data of the event
+         */
+        void write_event(const EventData& data);
+
         GeometryManager* geo_mgr_{};
 
         std::vector<std::shared_ptr<PixelHitMessage>> pixel_messages_;
@@ -65,6 +103,18 @@ namespace allpix {
         std::map<std::string, std::vector<std::string>> collections_to_detectors_map_;
 
         std::shared_ptr<IO::LCWriter> lcWriter_{};
+
+        // Collections and encoders reused for all events, the pixel data of every sensor is stored in a single object
+        std::vector<std::unique_ptr<IMPL::LCCollectionVec>> output_col_vec_;
+        std::map<unsigned, IMPL::TrackerDataImpl*> sensor_data_;
+        std::unique_ptr<IMPL::LCCollectionVec> mc_cluster_vec_;
+        std::unique_ptr<IMPL::LCCollectionVec> mc_cluster_raw_vec_;
+        std::unique_ptr<IMPL::LCCollectionVec> mc_hit_vec_;
+        std::unique_ptr<IMPL::LCCollectionVec> mc_track_vec_;
+        std::unique_ptr<UTIL::CellIDEncoder<IMPL::TrackerDataImpl>> mc_cluster_raw_encoder_;
+        std::unique_ptr<UTIL::CellIDEncoder<IMPL::TrackerPulseImpl>> mc_cluster_encoder_;
+        std::unique_ptr<UTIL::CellIDEncoder<IMPL::TrackerHitImpl>> mc_hit_encoder_;
+
         int pixel_type_;
 
         bool dump_mc_truth_;
@@ -9,6 +9,9 @@
 
 #include "MagneticFieldReaderModule.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
 #include <limits>
 #include <memory>
@@ -57,7 +60,103 @@ void MagneticFieldReaderModule::init() {
                        << Units::display(detector->getMagneticField(), {"T", "mT"});
         }
         LOG(INFO) << "Set constant magnetic field: " << Units::display(b_field, {"T", "mT"});
+    } else if(field_model == "mesh") {
+        LOG(TRACE) << "Adding magnetic field from mesh file";
+        type = MagneticFieldType::GRID;
+
+        auto field_data = read_field();
+        auto center = config_.get<ROOT::Math::XYZPoint>("field_center", ROOT::Math::XYZPoint());
+
+        // Interpolate the field linearly between the grid points, outside of the grid the field is zero
+        MagneticFieldFunction function = [data = field_data.getData(),
+                                          dimensions = field_data.getDimensions(),
+                                          size = field_data.getSize(),
+                                          center](const ROOT::Math::XYZPoint& pos) {
+            std::array<double, 3> coordinates{{pos.x() - center.x(), pos.y() - center.y(), pos.z() - center.z()}};
+            std::array<size_t, 3> low{}, high{};
+            std::array<double, 3> frac{};
+            for(size_t i = 0; i < 3; ++i) {
+                if(std::fabs(coordinates[i]) > size[i] / 2.0) {
+                    return ROOT::Math::XYZVector();
+                }
+                // Position in units of bins, relative to the center of the first bin
+                auto bin = (coordinates[i] / size[i] + 0.5) * static_cast<double>(dimensions[i]) - 0.5;
+                auto max_bin = static_cast<double>(dimensions[i] - 1);
+                bin = std::max(0.0, std::min(bin, max_bin));
+                low[i] = static_cast<size_t>(std::floor(bin));
+                high[i] = std::min(low[i] + 1, dimensions[i] - 1);
+                frac[i] = bin - static_cast<double>(low[i]);
+            }
+
+            auto value = [&](size_t x, size_t y, size_t z) {
+                auto index = ((x * dimensions[1] + y) * dimensions[2] + z) * 3;
+                return ROOT::Math::XYZVector((*data)[index], (*data)[index + 1], (*data)[index + 2]);
+            };
+            auto value_z = [&](size_t x, size_t y) {
+                return value(x, y, low[2]) * (1 - frac[2]) + value(x, y, high[2]) * frac[2];
+            };
+            auto value_yz = [&](size_t x) { return value_z(x, low[1]) * (1 - frac[1]) + value_z(x, high[1]) * frac[1]; };
+            return value_yz(low[0]) * (1 - frac[0]) + value_yz(high[0]) * frac[0];
+        };
+        geometryManager_->setMagneticFieldFunction(function, type);
+
+        // Sample the field in the local coordinates of every detector once, to avoid global lookups during propagation
+        auto bins = config_.getArray<size_t>("detector_field_bins", {10, 10, 10});
+        if(bins.size() != 3 || std::find(bins.begin(), bins.end(), 0) != bins.end()) {
+            throw InvalidValueError(config_, "detector_field_bins", "three non-zero numbers of bins are required");
+        }
+        std::array<size_t, 3> dimensions{{bins[0], bins[1], bins[2]}};
+
+        auto detectors = geometryManager_->getDetectors();
+        for(auto& detector : detectors) {
+            auto model = detector->getModel();
+            auto sensor_min = model->getSensorCenter() - model->getSensorSize() / 2.0;
+            auto bin_size = model->getSensorSize();
+            bin_size.SetXYZ(bin_size.x() / static_cast<double>(dimensions[0]),
+                            bin_size.y() / static_cast<double>(dimensions[1]),
+                            bin_size.z() / static_cast<double>(dimensions[2]));
+
+            auto local_field = std::make_shared<std::vector<double>>();
+            local_field->reserve(dimensions[0] * dimensions[1] * dimensions[2] * 3);
+            for(size_t x = 0; x < dimensions[0]; ++x) {
+                for(size_t y = 0; y < dimensions[1]; ++y) {
+                    for(size_t z = 0; z < dimensions[2]; ++z) {
+                        ROOT::Math::XYZPoint local_pos(sensor_min.x() + (static_cast<double>(x) + 0.5) * bin_size.x(),
+                                                       sensor_min.y() + (static_cast<double>(y) + 0.5) * bin_size.y(),
+                                                       sensor_min.z() + (static_cast<double>(z) + 0.5) * bin_size.z());
+                        auto b_field = detector->getOrientation().Inverse() *
+                                       geometryManager_->getMagneticField(detector->getGlobalPosition(local_pos));
+                        local_field->push_back(b_field.x());
+                        local_field->push_back(b_field.y());
+                        local_field->push_back(b_field.z());
+                    }
+                }
+            }
+            detector->setMagneticFieldGrid(local_field, dimensions);
+            LOG(DEBUG) << "Magnetic field in center of detector " << detector->getName() << ": "
+                       << Units::display(detector->getMagneticField(), {"T", "mT"});
+        }
+        LOG(INFO) << "Set magnetic field from mesh with " << field_data.getDimensions().at(0) << "x"
+                  << field_data.getDimensions().at(1) << "x" << field_data.getDimensions().at(2) << " cells";
     } else {
-        throw InvalidValueError(config_, "model", "model can currently only be 'constant'");
+        throw InvalidValueError(config_, "model", "model can only be 'constant' or 'mesh'");
+    }
+}
+
+/**
+ * The field read from the file is cached by the field parser, such that the file is only read once when the module is
+ * instantiated several times.
+ */
+FieldParser<double> MagneticFieldReaderModule::field_parser_(FieldQuantity::VECTOR);
+FieldData<double> MagneticFieldReaderModule::read_field() {
+    try {
+        return field_parser_.getByFileName(
+            config_.getPath("file_name", true), "T", config_.get<bool>("cache_init_file", false));
+    } catch(std::invalid_argument& e) {
+        throw InvalidValueError(config_, "file_name", e.what());
+    } catch(std::runtime_error& e) {
+        throw InvalidValueError(config_, "file_name", e.what());
+    } catch(std::bad_alloc& e) {
+        throw InvalidValueError(config_, "file_name", "file too large");
     }
 }
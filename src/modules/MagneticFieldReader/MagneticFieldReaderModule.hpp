@@ -18,13 +18,15 @@
 
 #include "core/module/Module.hpp"
 
+#include "tools/field_parser.h"
+
 namespace allpix {
     /**
      * @ingroup Modules
      * @brief Module to define magnetic fields
      *
-     * Read the model of the magnetic field from the config during initialization and apply a constant field throughout the
-     * whole volume
+     * Read the model of the magnetic field from the config during initialization and apply it throughout the whole volume,
+     * either as constant field or as field interpolated from a mesh file
      */
     class MagneticFieldReaderModule : public Module {
     public:
@@ -43,5 +45,14 @@ namespace allpix {
 
     private:
         GeometryManager* geometryManager_;
+
+        /**
+         * @brief Read the magnetic field from the mesh file
+         * @return Field data in global coordinates
+         */
+        FieldData<double> read_field();
+
+        // General field parser shared by all instances
+        static FieldParser<double> field_parser_;
     };
 } // namespace allpix
@@ -0,0 +1,151 @@
+/**
+ * @file
+ * @brief Implementation of framework overhead benchmark module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "OverheadBenchmarkModule.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Timing of all instantiations of the module, as the overhead is only known for the chain as a whole
+     */
+    struct ChainStatistics {
+        std::mutex mutex;
+        unsigned int instantiations{}, finalized{};
+        // Period from the start of the first to the end of the last run of any instantiation
+        std::chrono::steady_clock::time_point first_start{std::chrono::steady_clock::time_point::max()};
+        std::chrono::steady_clock::time_point last_end{std::chrono::steady_clock::time_point::min()};
+        // Sum of the time spent in the run method of all instantiations in nanoseconds
+        uint64_t run_time{};
+        unsigned int events{};
+    };
+    ChainStatistics& chain_statistics() {
+        static ChainStatistics statistics;
+        return statistics;
+    }
+} // namespace
+
+OverheadBenchmarkModule::OverheadBenchmarkModule(Configuration& config,
+                                                 Messenger* messenger,
+                                                 std::shared_ptr<Detector> detector)
+    : Module(config, std::move(detector)), messenger_(messenger) {
+    config_.setDefault<bool>("source", false);
+    config_.setDefault<unsigned int>("payload_messages", 1);
+    config_.setDefault<unsigned int>("payload_objects", 10);
+    config_.setDefault<unsigned int>("payload_bins", 0);
+    config_.setDefault<bool>("parallelize", true);
+
+    source_ = config_.get<bool>("source");
+    payload_messages_ = config_.get<unsigned int>("payload_messages");
+    payload_objects_ = config_.get<unsigned int>("payload_objects");
+    payload_bins_ = config_.get<unsigned int>("payload_bins");
+
+    // Enable parallelization of this module if multithreading is enabled, no state of an event is kept in the members
+    if(config_.get<bool>("parallelize")) {
+        enable_parallelization();
+        enable_event_parallelization();
+    }
+
+    // Require the messages of the previous module of the chain unless this module is its source, fetched in the run method
+    if(!source_) {
+        messenger_->bindMulti(this, &OverheadBenchmarkModule::messages_, MsgFlags::REQUIRED);
+    }
+
+    auto& statistics = chain_statistics();
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    ++statistics.instantiations;
+}
+
+void OverheadBenchmarkModule::run(unsigned int event_num) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Visit the objects of the previous module of the chain
+    size_t received_objects = 0;
+    if(!source_) {
+        for(const auto& message : messenger_->fetchMultiMessage<PixelChargeMessage>(this)) {
+            received_objects += message->getData().size();
+        }
+    }
+    LOG(TRACE) << "Received " << received_objects << " pixel charges";
+
+    // Dispatch the payload of this module, with pulses of the requested number of bins if any
+    auto detector = getDetector();
+    auto n_pixels = detector->getModel()->getNPixels();
+    auto bin = Units::get(1.0, "ns");
+    for(unsigned int message = 0; message < payload_messages_; ++message) {
+        std::vector<PixelCharge> pixel_charges;
+        pixel_charges.reserve(payload_objects_);
+        for(unsigned int object = 0; object < payload_objects_; ++object) {
+            auto pixel = detector->getPixel(object % n_pixels.x(), (object / n_pixels.x()) % n_pixels.y());
+            if(payload_bins_ == 0) {
+                pixel_charges.emplace_back(pixel, object);
+                continue;
+            }
+            Pulse pulse(bin);
+            for(unsigned int i = 0; i < payload_bins_; ++i) {
+                pulse.addCharge(1, (i + 0.5) * bin);
+            }
+            pixel_charges.emplace_back(pixel, std::move(pulse));
+        }
+        messenger_->dispatchMessage(this, std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector));
+    }
+
+    // The update of the statistics is accounted to this module as well, such that waiting for it is not counted as overhead
+    auto& statistics = chain_statistics();
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    auto end = std::chrono::steady_clock::now();
+    auto run_time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    run_time_ += run_time;
+    statistics.run_time += run_time;
+    statistics.first_start = std::min(statistics.first_start, start);
+    statistics.last_end = std::max(statistics.last_end, end);
+    statistics.events = std::max(statistics.events, event_num);
+}
+
+/**
+ * The overhead is reported by the last instantiation finalized, and is the time of the event loop per event minus the time
+ * spent in the run methods of all instantiations per event. If several events or modules are executed at the same time, the
+ * time in the modules is summed over all threads, such that the overhead is underestimated.
+ */
+void OverheadBenchmarkModule::finalize() {
+    LOG(DEBUG) << "Spent " << Units::display(static_cast<double>(run_time_), "us") << " in the run method";
+
+    auto& statistics = chain_statistics();
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+    if(++statistics.finalized < statistics.instantiations || statistics.events == 0) {
+        return;
+    }
+
+    auto events = static_cast<double>(statistics.events);
+    auto loop_time =
+        static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(statistics.last_end - statistics.first_start).count()) /
+        events;
+    auto module_time = static_cast<double>(statistics.run_time) / events;
+    LOG(INFO) << "Event loop of " << Units::display(loop_time, "us") << " per event, thereof "
+              << Units::display(module_time, "us") << " in " << statistics.instantiations << " modules";
+    LOG(INFO) << "Framework overhead of " << Units::display(loop_time - module_time, "us") << " per event";
+
+    // Reset the statistics for the next run in the same process
+    statistics.instantiations = 0;
+    statistics.finalized = 0;
+    statistics.first_start = std::chrono::steady_clock::time_point::max();
+    statistics.last_end = std::chrono::steady_clock::time_point::min();
+    statistics.run_time = 0;
+    statistics.events = 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @brief Definition of framework overhead benchmark module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/PixelCharge.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module passing synthetic messages along a chain of modules to measure the overhead of the framework
+     * @note This module supports parallelization
+     *
+     * Every instantiation dispatches a configurable number of messages with a configurable number of pixel charges, either
+     * as source of the chain or after receiving the messages of the previous module of the chain. The time spent in the
+     * run method of all instantiations is subtracted from the time of the event loop, such that the remaining time per
+     * event is the overhead of the framework for dispatching the messages and scheduling the modules.
+     */
+    class OverheadBenchmarkModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        OverheadBenchmarkModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Receive the messages of the previous module of the chain and dispatch the messages of this module
+         */
+        void run(unsigned int event_num) override;
+
+        /**
+         * @brief Report the overhead of the framework per event once all instantiations are finalized
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+
+        // Messages of the previous module of the chain
+        std::vector<std::shared_ptr<PixelChargeMessage>> messages_;
+
+        // Payload dispatched for every event
+        bool source_{};
+        unsigned int payload_messages_{}, payload_objects_{}, payload_bins_{};
+
+        // Time spent in the run method of this instantiation in nanoseconds
+        std::atomic<uint64_t> run_time_{0};
+    };
+} // namespace allpix
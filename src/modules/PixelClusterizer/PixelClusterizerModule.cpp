@@ -0,0 +1,53 @@
+/**
+ * @file
+ * @brief Implementation of pixel clustering module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "PixelClusterizerModule.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "core/utils/log.h"
+#include "tools/cluster_finder.h"
+
+using namespace allpix;
+
+PixelClusterizerModule::PixelClusterizerModule(Configuration& config,
+                                               Messenger* messenger,
+                                               std::shared_ptr<Detector> detector)
+    : Module(config, std::move(detector)), messenger_(messenger), pixel_message_(nullptr) {
+    // Clusters of different events are independent
+    enable_event_parallelization();
+
+    // Require PixelHit message for single detector
+    messenger_->bindSingle(this, &PixelClusterizerModule::pixel_message_, MsgFlags::REQUIRED);
+}
+
+void PixelClusterizerModule::run(unsigned int) {
+    auto pixel_message = messenger_->fetchMessage<PixelHitMessage>(this);
+
+    // Find the clusters with the cluster finder of this thread, keeping its lookup table for the next events
+    thread_local ClusterFinder<PixelCluster> cluster_finder;
+    auto clusters = cluster_finder.find(getDetector()->getModel()->getNPixels(), pixel_message->getData());
+
+    LOG(DEBUG) << "Found " << clusters.size() << " clusters from " << pixel_message->getData().size() << " pixel hits";
+    for(const auto& cluster : clusters) {
+        LOG(TRACE) << "Cluster with seed " << cluster.getSeedPixel().getIndex() << ", size "
+                   << cluster.getSize() << " and charge " << cluster.getCharge();
+    }
+    total_clusters_ += clusters.size();
+
+    if(!clusters.empty()) {
+        auto clusters_message = std::make_shared<PixelClusterMessage>(std::move(clusters), getDetector());
+        messenger_->dispatchMessage(this, clusters_message);
+    }
+}
+
+void PixelClusterizerModule::finalize() {
+    LOG(INFO) << "Found " << total_clusters_ << " clusters in total";
+}
@@ -0,0 +1,59 @@
+/**
+ * @file
+ * @brief Definition of pixel clustering module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <atomic>
+#include <memory>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/PixelCluster.hpp"
+#include "objects/PixelHit.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module combining the neighboring pixel hits of a detector to clusters
+     * @note This module supports parallelization
+     *
+     * The pixel hits touching each other by a side or a corner are combined into clusters with the same cluster finder as
+     * used by the DetectorHistogrammer module, and the clusters of every event are dispatched as a message.
+     */
+    class PixelClusterizerModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        PixelClusterizerModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Find the clusters of the pixel hits
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Display statistical summary
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+
+        // Input message with the pixel hits
+        std::shared_ptr<PixelHitMessage> pixel_message_;
+
+        // Statistics
+        std::atomic<unsigned long long> total_clusters_{};
+    };
+} // namespace allpix
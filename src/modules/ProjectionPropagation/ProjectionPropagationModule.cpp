@@ -6,10 +6,12 @@
 
 #include "ProjectionPropagationModule.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <functional>
 #include <limits>
 #include <string>
+#include <tuple>
 #include <utility>
 
 #include "core/messenger/Messenger.hpp"
@@ -23,12 +25,17 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
                                                          Messenger* messenger,
                                                          std::shared_ptr<Detector> detector)
     : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Enable parallelization of this module if multithreading is enabled, the histograms are filled per thread such that
+    // also several events can be propagated at the same time
+    enable_parallelization();
+    enable_event_parallelization();
+
     // Save detector model
     model_ = detector_->getModel();
 
     random_generator_.seed(getRandomSeed());
 
-    // Require deposits message for single detector
+    // Require deposits message for single detector, fetched in the run method
     messenger_->bindSingle(this, &ProjectionPropagationModule::deposits_message_, MsgFlags::REQUIRED);
 
     // Set default value for config variables
@@ -36,10 +43,16 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<bool>("output_plots", false);
     config_.setDefault<bool>("diffuse_deposit", false);
+    config_.setDefault<bool>("analytic_sharing", false);
+    config_.setDefault<unsigned int>("drift_table_bins", 1000);
+    config_.setDefault<bool>("pooled_diffusion", false);
 
     integration_time_ = config_.get<double>("integration_time");
     output_plots_ = config_.get<bool>("output_plots");
     diffuse_deposit_ = config_.get<bool>("diffuse_deposit");
+    analytic_sharing_ = config_.get<bool>("analytic_sharing");
+    pooled_diffusion_ = config_.get<bool>("pooled_diffusion");
+    config_.bind("charge_per_step", charge_per_step_);
 
     // Set default for charge carrier propagation:
     config_.setDefault<bool>("propagate_holes", false);
@@ -50,15 +63,9 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
         propagate_type_ = CarrierType::ELECTRON;
     }
 
-    // Parameterization variables from https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2)
+    // Mobility parameterization for the configured temperature
     auto temperature = config_.get<double>("temperature");
-    electron_Vm_ = Units::get(1.53e9 * std::pow(temperature, -0.87), "cm/s");
-    electron_Ec_ = Units::get(1.01 * std::pow(temperature, 1.55), "V/cm");
-    electron_Beta_ = 2.57e-2 * std::pow(temperature, 0.66);
-
-    hole_Vm_ = Units::get(1.62e8 * std::pow(temperature, -0.52), "cm/s");
-    hole_Ec_ = Units::get(1.24 * std::pow(temperature, 1.68), "V/cm");
-    hole_Beta_ = 0.46 * std::pow(temperature, 0.17);
+    mobility_ = JacoboniCanaliMobility(temperature);
 
     boltzmann_kT_ = Units::get(8.6173e-5, "eV/K") * temperature;
 
@@ -66,6 +73,8 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
 }
 
 void ProjectionPropagationModule::init() {
+    geometry_ = detector_->getGeometryView();
+
     if(detector_->getElectricFieldType() != FieldType::LINEAR) {
         throw ModuleError("This module should only be used with linear electric fields.");
     }
@@ -92,34 +101,69 @@ void ProjectionPropagationModule::init() {
                "field is wrong!";
     }
 
+    // The field at the surface is the same for all carriers
+    efield_mag_top_ = std::sqrt(detector_->getElectricField(ROOT::Math::XYZPoint(0., 0., top_z_)).Mag2());
+
+    // Tabulate the drift time and diffusion width as a function of depth, as the linear field only depends on the depth
+    auto bins = config_.get<unsigned int>("drift_table_bins");
+    drift_table_.clear();
+    if(bins > 0) {
+        drift_table_z0_ = -std::fabs(top_z_);
+        drift_table_dz_ = 2 * std::fabs(top_z_) / bins;
+        drift_table_.resize(bins + 1);
+        for(unsigned int i = 0; i <= bins; ++i) {
+            ROOT::Math::XYZPoint position(0., 0., drift_table_z0_ + i * drift_table_dz_);
+            auto& entry = drift_table_[i];
+            entry.field = std::sqrt(detector_->getElectricField(position).Mag2());
+            if(entry.field > 0) {
+                std::tie(entry.time, entry.sigma) = drift(position, entry.field, efield_mag_top_);
+            }
+        }
+        LOG(DEBUG) << "Tabulated drift time and diffusion width in " << bins << " bins of "
+                   << Units::display(drift_table_dz_, {"um", "nm"});
+    }
+
     if(output_plots_) {
         // Initialize output plots
-        propagation_time_histo_ = new TH1D("propagation_time_histo",
-                                           "Propagation time (drift + diffusion);Propagation time [ns];charge carriers",
-                                           static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                           0,
-                                           static_cast<double>(Units::convert(integration_time_, "ns")) * 2);
-        drift_time_histo_ = new TH1D("drift_time_histo",
-                                     "Drift time (directed drift only);Drift time [ns];charge carriers",
-                                     static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                     0,
-                                     static_cast<double>(Units::convert(integration_time_, "ns")) * 2);
-        initial_position_histo_ = new TH1D("initial_position_histo",
-                                           "Initial position of collected charge carriers;Position z [um];charge carriers",
-                                           100,
-                                           static_cast<double>(Units::convert(-top_z_, "um")),
-                                           static_cast<double>(Units::convert(top_z_, "um")));
+        propagation_time_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "propagation_time_histo",
+            "Propagation time (drift + diffusion);Propagation time [ns];charge carriers",
+            static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")) * 2);
+        drift_time_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "drift_time_histo",
+            "Drift time (directed drift only);Drift time [ns];charge carriers",
+            static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")) * 2);
+        initial_position_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "initial_position_histo",
+            "Initial position of collected charge carriers;Position z [um];charge carriers",
+            100,
+            static_cast<double>(Units::convert(-top_z_, "um")),
+            static_cast<double>(Units::convert(top_z_, "um")));
         if(diffuse_deposit_) {
-            diffusion_time_histo_ = new TH1D("diffusion_time_histo",
-                                             "Diffusion time prior to drift;Diffusion time [ns];charge carriers",
-                                             static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                             0,
-                                             static_cast<double>(Units::convert(integration_time_, "ns")));
+            diffusion_time_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+                "diffusion_time_histo",
+                "Diffusion time prior to drift;Diffusion time [ns];charge carriers",
+                static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+                0,
+                static_cast<double>(Units::convert(integration_time_, "ns")));
         }
     }
 }
 
 void ProjectionPropagationModule::run(unsigned int) {
+    // Fetch the deposits of the current event
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this);
+
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
 
     // Create vector of propagated charges to output
     std::vector<PropagatedCharge> propagated_charges;
@@ -128,8 +172,11 @@ void ProjectionPropagationModule::run(unsigned int) {
     double total_charge = 0;
     double total_projected_charge = 0;
 
+    // Deposits of which the charge is shared between the pixels analytically, processed together after the loop
+    std::vector<const DepositedCharge*> shared_deposits;
+
     // Loop over all deposits for propagation
-    for(auto& deposit : deposits_message_->getData()) {
+    for(auto& deposit : deposits_message->getData()) {
 
         auto type = deposit.getType();
         auto initial_position = deposit.getLocalPosition();
@@ -142,195 +189,352 @@ void ProjectionPropagationModule::run(unsigned int) {
         LOG(DEBUG) << "Set of " << deposit.getCharge() << " charge carriers (" << type << ") on "
                    << Units::display(initial_position, {"mm", "um"});
 
-        double projected_charge = 0;
+        total_charge += deposit.getCharge();
 
-        unsigned int charges_remaining = deposit.getCharge();
-        total_charge += charges_remaining;
+        // Deposits in a region without electric field are always projected in sets as they might diffuse first
+        if(analytic_sharing_ && detector_->getElectricField(initial_position).Mag2() > 0) {
+            shared_deposits.push_back(&deposit);
+            continue;
+        }
+        total_projected_charge += project_deposit(deposit, propagated_charges, random_generator);
+    }
+    total_projected_charge += share_deposits(shared_deposits, propagated_charges, random_generator);
+    charge_lost = total_charge - total_projected_charge;
 
-        auto charge_per_step = config_.get<unsigned int>("charge_per_step");
-        while(charges_remaining > 0) {
-            if(charge_per_step > charges_remaining) {
-                charge_per_step = charges_remaining;
-            }
-            charges_remaining -= charge_per_step;
-
-            auto position = initial_position;
-
-            // Get the electric field at the position of the deposited charge and the top of the sensor:
-            auto efield = detector_->getElectricField(position);
-            double efield_mag = std::sqrt(efield.Mag2());
-            auto efield_top = detector_->getElectricField(ROOT::Math::XYZPoint(0., 0., top_z_));
-            double efield_mag_top = std::sqrt(efield_top.Mag2());
-
-            // Define a lambda function to compute the carrier mobility
-            auto carrier_mobility = [&](double efield_magn) {
-                // Compute carrier mobility from constants and electric field magnitude
-                double numerator, denominator;
-                if(type == CarrierType::ELECTRON) {
-                    numerator = electron_Vm_ / electron_Ec_;
-                    denominator = std::pow(1. + std::pow(efield_magn / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
-                } else {
-                    numerator = hole_Vm_ / hole_Ec_;
-                    denominator = std::pow(1. + std::pow(efield_magn / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
-                }
-                return numerator / denominator;
-            };
+    LOG(INFO) << "Total charge: " << total_charge << " (lost: " << charge_lost << ", " << (charge_lost / total_charge * 100.)
+              << "%)";
+    LOG(DEBUG) << "Total count of propagated charge carriers: " << propagated_charges.size();
 
-            double diffusion_time = 0;
+    // Create a new message with propagated charges
+    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
 
-            // Only project if within the depleted region (i.e. efield not zero)
-            if(efield_mag < std::numeric_limits<double>::epsilon()) {
-                LOG(TRACE) << "Electric field is zero at " << Units::display(position, {"mm", "um"});
-                if(!diffuse_deposit_) {
-                    continue;
-                }
-                double diffusion_constant = boltzmann_kT_ * carrier_mobility(efield_mag);
-                double diffusion_std_dev = std::sqrt(2. * diffusion_constant * integration_time_);
-                LOG(TRACE) << "Diffusion width of this charge carrier is " << Units::display(diffusion_std_dev, "um");
+    // Dispatch the message with propagated charges
+    messenger_->dispatchMessage(this, propagated_charge_message);
+}
 
-                std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
-                double diffusion_x = gauss_distribution(random_generator_);
-                double diffusion_y = gauss_distribution(random_generator_);
-                double diffusion_z = gauss_distribution(random_generator_);
-                auto diffusion_vec = ROOT::Math::XYZVector(diffusion_x, diffusion_y, diffusion_z);
+/**
+ * The drift time is calculated by integrating the inverse drift velocity analytically, assuming a linear electric field
+ * between the position and the top of the sensor and the mobility approximated with beta set to one.
+ */
+std::pair<double, double>
+ProjectionPropagationModule::drift(const ROOT::Math::XYZPoint& position, double efield_mag, double efield_mag_top) const {
+    auto type = propagate_type_;
+    auto distance = std::abs(top_z_ - position.z());
+    if(distance <= 0) {
+        return {0., 0.};
+    }
+    double slope_efield = (efield_mag_top - efield_mag) / distance;
 
-                auto local_position_diffusion = position + diffusion_vec;
+    // Calculate the drift time, using the limit of the logarithmic term for a constant field
+    double Ec = mobility_.getCriticalField(type);
+    double zero_mobility = mobility_.getZeroFieldMobility(type);
+    double field_term = (std::fabs(efield_mag_top - efield_mag) > 1e-9 * efield_mag
+                             ? (log(efield_mag_top) - log(efield_mag)) / slope_efield
+                             : distance / efield_mag);
+    double drift_time = (field_term + distance / Ec) / zero_mobility;
 
-                auto efield_diffusion = detector_->getElectricField(local_position_diffusion);
-                double efield_mag_diffusion = std::sqrt(efield_diffusion.Mag2());
+    // Assume linear electric field over the depleted part of the sensor
+    double diffusion_constant = boltzmann_kT_ * (mobility_(type, efield_mag) + mobility_(type, efield_mag_top)) / 2.;
+    double diffusion_std_dev = std::sqrt(2. * diffusion_constant * drift_time);
 
-                if(efield_mag_diffusion < std::numeric_limits<double>::epsilon() && (detector_->isWithinSensor(position))) {
-                    LOG(TRACE) << "Charge carrier remains within undepleted volume";
-                    continue;
-                }
+    return {drift_time, diffusion_std_dev};
+}
 
-                std::function<ROOT::Math::XYZPoint(const ROOT::Math::XYZPoint&, const ROOT::Math::XYZPoint&)> interval;
-                interval = [this, &interval](const ROOT::Math::XYZPoint& start,
-                                             const ROOT::Math::XYZPoint& stop) -> ROOT::Math::XYZPoint {
-                    // Break nested intervals at a precision of 0.01 um
-                    if(std::sqrt((stop - ROOT::Math::XYZVector(start)).Mag2()) < 0.00001) {
-                        return stop;
-                    }
-                    auto efield_center = detector_->getElectricField((stop + ROOT::Math::XYZVector(start)) / 2.);
-                    double efield_center_mag = std::sqrt(efield_center.Mag2());
-                    if(efield_center_mag > std::numeric_limits<double>::epsilon()) {
-                        return interval(start, (stop + ROOT::Math::XYZVector(start)) / 2.);
-                    } else {
-                        return interval((stop + ROOT::Math::XYZVector(start)) / 2., stop);
-                    }
-                };
-
-                position = interval(position, local_position_diffusion);
-                efield = detector_->getElectricField(position);
-                efield_mag = std::sqrt(efield.Mag2());
-                diffusion_time = integration_time_ * std::sqrt((position - initial_position).Mag2() /
-                                                               (local_position_diffusion - initial_position).Mag2());
-
-                if(!detector_->isWithinSensor(position)) {
-                    LOG(TRACE) << "Charge carrier diffused outside the sensor volume";
-                    continue;
-                }
-                LOG(TRACE) << "Charge diffused to position: " << Units::display(position, {"mm", "um"});
-                LOG(TRACE) << " ... with an electric field of " << Units::display(efield_mag, "V/cm");
-                LOG(TRACE) << " ... and a diffusion time prior to the drift of " << Units::display(diffusion_time, "ns");
-            }
+/**
+ * The drift time and diffusion width are interpolated linearly between the two closest depths of the table. Close to the
+ * edge of the depleted region the drift time diverges logarithmically with the vanishing field, such that the values are
+ * computed directly if the field changes by more than ten percent between the two depths.
+ */
+std::pair<double, double> ProjectionPropagationModule::lookup_drift(const ROOT::Math::XYZPoint& position,
+                                                                    double efield_mag) const {
+    if(drift_table_.empty()) {
+        return drift(position, efield_mag, efield_mag_top_);
+    }
+
+    auto bin = (position.z() - drift_table_z0_) / drift_table_dz_;
+    if(bin < 0 || bin >= static_cast<double>(drift_table_.size() - 1)) {
+        return drift(position, efield_mag, efield_mag_top_);
+    }
+    auto index = static_cast<size_t>(bin);
+    const auto& lower = drift_table_[index];
+    const auto& upper = drift_table_[index + 1];
+    if(lower.field <= 0 || upper.field <= 0 ||
+       std::fabs(upper.field - lower.field) > 0.1 * std::min(lower.field, upper.field)) {
+        return drift(position, efield_mag, efield_mag_top_);
+    }
 
-            LOG(TRACE) << "Electric field at carrier position / top of the sensor: "
-                       << Units::display(efield_mag_top, "V/cm") << " , " << Units::display(efield_mag, "V/cm");
+    auto weight = bin - static_cast<double>(index);
+    return {lower.time + weight * (upper.time - lower.time), lower.sigma + weight * (upper.sigma - lower.sigma)};
+}
 
-            slope_efield_ = (efield_mag_top - efield_mag) / (std::abs(top_z_ - position.z()));
+unsigned int ProjectionPropagationModule::project_deposit(const DepositedCharge& deposit,
+                                                          std::vector<PropagatedCharge>& propagated_charges,
+                                                          std::mt19937_64& random_generator) {
+    auto type = deposit.getType();
+    auto initial_position = deposit.getLocalPosition();
+
+    unsigned int projected_charge = 0;
+    unsigned int charges_remaining = deposit.getCharge();
+
+    // Pool of normal random numbers for the diffusion, only filled if requested
+    NormalPool<std::mt19937_64> normal_pool(random_generator);
+    auto gauss = [&](double std_dev) {
+        return pooled_diffusion_ ? normal_pool(std_dev) : std::normal_distribution<double>(0, std_dev)(random_generator);
+    };
+
+    auto charge_per_step = charge_per_step_;
+    while(charges_remaining > 0) {
+        if(charge_per_step > charges_remaining) {
+            charge_per_step = charges_remaining;
+        }
+        charges_remaining -= charge_per_step;
 
-            // Calculate the drift time
-            auto calc_drift_time = [&]() {
-                double Ec = (type == CarrierType::ELECTRON ? electron_Ec_ : hole_Ec_);
-                double zero_mobility = (type == CarrierType::ELECTRON ? electron_Vm_ / electron_Ec_ : hole_Vm_ / hole_Ec_);
+        auto position = initial_position;
 
-                return ((log(efield_mag_top) - log(efield_mag)) / slope_efield_ + std::abs(top_z_ - position.z()) / Ec) /
-                       zero_mobility;
-            };
-            LOG(TRACE) << "Electric field is " << Units::display(efield_mag, "V/cm");
+        // Get the electric field at the position of the deposited charge and the top of the sensor:
+        auto efield = detector_->getElectricField(position);
+        double efield_mag = std::sqrt(efield.Mag2());
+        double efield_mag_top = efield_mag_top_;
 
-            // Assume linear electric field over the depleted part of the sensor
-            double diffusion_constant =
-                boltzmann_kT_ * (carrier_mobility(efield_mag) + carrier_mobility(efield_mag_top)) / 2.;
+        // Define a lambda function to compute the carrier mobility
+        auto carrier_mobility = [&](double efield_magn) { return mobility_(type, efield_magn); };
 
-            double drift_time = calc_drift_time();
-            double propagation_time = drift_time + diffusion_time;
-            LOG(TRACE) << "Drift time is " << Units::display(drift_time, "ns");
+        double diffusion_time = 0;
 
-            if(output_plots_) {
-                propagation_time_histo_->Fill(propagation_time, charge_per_step);
-                drift_time_histo_->Fill(drift_time, charge_per_step);
-                if(diffuse_deposit_) {
-                    diffusion_time_histo_->Fill(diffusion_time, charge_per_step);
-                }
+        // Only project if within the depleted region (i.e. efield not zero)
+        if(efield_mag < std::numeric_limits<double>::epsilon()) {
+            LOG(TRACE) << "Electric field is zero at " << Units::display(position, {"mm", "um"});
+            if(!diffuse_deposit_) {
+                continue;
             }
+            double diffusion_constant = boltzmann_kT_ * carrier_mobility(efield_mag);
+            double diffusion_std_dev = std::sqrt(2. * diffusion_constant * integration_time_);
+            LOG(TRACE) << "Diffusion width of this charge carrier is " << Units::display(diffusion_std_dev, "um");
 
-            double diffusion_std_dev = std::sqrt(2. * diffusion_constant * drift_time);
-            LOG(TRACE) << "Diffusion width is " << Units::display(diffusion_std_dev, "um");
+            double diffusion_x = gauss(diffusion_std_dev);
+            double diffusion_y = gauss(diffusion_std_dev);
+            double diffusion_z = gauss(diffusion_std_dev);
+            auto diffusion_vec = ROOT::Math::XYZVector(diffusion_x, diffusion_y, diffusion_z);
 
-            std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
-            double diffusion_x = gauss_distribution(random_generator_);
-            double diffusion_y = gauss_distribution(random_generator_);
+            auto local_position_diffusion = position + diffusion_vec;
 
-            // Find projected position
-            auto local_position = ROOT::Math::XYZPoint(position.x() + diffusion_x, position.y() + diffusion_y, top_z_);
+            auto efield_diffusion = detector_->getElectricField(local_position_diffusion);
+            double efield_mag_diffusion = std::sqrt(efield_diffusion.Mag2());
 
-            // Only add if within requested integration time:
-            auto event_time = deposit.getEventTime() + propagation_time;
-            if(propagation_time > integration_time_) {
-                LOG(DEBUG) << "Charge carriers propagation time not within integration time: "
-                           << Units::display(event_time, "ns");
+            if(efield_mag_diffusion < std::numeric_limits<double>::epsilon() && (geometry_.isWithinSensor(position))) {
+                LOG(TRACE) << "Charge carrier remains within undepleted volume";
                 continue;
             }
 
-            // Only add if within sensor volume:
-            if(!detector_->isWithinSensor(local_position)) {
-                LOG(DEBUG) << "Charge carriers outside sensor volume at " << Units::display(local_position, {"mm", "um"});
-                // FIXME: drop charges if it ends up outside the sensor, could be optimized to estimate position on border
+            std::function<ROOT::Math::XYZPoint(const ROOT::Math::XYZPoint&, const ROOT::Math::XYZPoint&)> interval;
+            interval = [this, &interval](const ROOT::Math::XYZPoint& start,
+                                         const ROOT::Math::XYZPoint& stop) -> ROOT::Math::XYZPoint {
+                // Break nested intervals at a precision of 0.01 um
+                if(std::sqrt((stop - ROOT::Math::XYZVector(start)).Mag2()) < 0.00001) {
+                    return stop;
+                }
+                auto efield_center = detector_->getElectricField((stop + ROOT::Math::XYZVector(start)) / 2.);
+                double efield_center_mag = std::sqrt(efield_center.Mag2());
+                if(efield_center_mag > std::numeric_limits<double>::epsilon()) {
+                    return interval(start, (stop + ROOT::Math::XYZVector(start)) / 2.);
+                } else {
+                    return interval((stop + ROOT::Math::XYZVector(start)) / 2., stop);
+                }
+            };
+
+            position = interval(position, local_position_diffusion);
+            efield = detector_->getElectricField(position);
+            efield_mag = std::sqrt(efield.Mag2());
+            diffusion_time = integration_time_ * std::sqrt((position - initial_position).Mag2() /
+                                                           (local_position_diffusion - initial_position).Mag2());
+
+            if(!geometry_.isWithinSensor(position)) {
+                LOG(TRACE) << "Charge carrier diffused outside the sensor volume";
                 continue;
             }
+            LOG(TRACE) << "Charge diffused to position: " << Units::display(position, {"mm", "um"});
+            LOG(TRACE) << " ... with an electric field of " << Units::display(efield_mag, "V/cm");
+            LOG(TRACE) << " ... and a diffusion time prior to the drift of " << Units::display(diffusion_time, "ns");
+        }
+
+        LOG(TRACE) << "Electric field at carrier position / top of the sensor: " << Units::display(efield_mag_top, "V/cm")
+                   << " , " << Units::display(efield_mag, "V/cm");
 
-            if(output_plots_) {
-                initial_position_histo_->Fill(static_cast<double>(Units::convert(initial_position.z(), "um")),
-                                              charge_per_step);
+        auto drift_pair = lookup_drift(position, efield_mag);
+        double drift_time = drift_pair.first;
+        double propagation_time = drift_time + diffusion_time;
+        LOG(TRACE) << "Drift time is " << Units::display(drift_time, "ns");
+
+        if(output_plots_) {
+            propagation_time_histo_->fill(propagation_time, charge_per_step);
+            drift_time_histo_->fill(drift_time, charge_per_step);
+            if(diffuse_deposit_) {
+                diffusion_time_histo_->fill(diffusion_time, charge_per_step);
             }
+        }
+
+        double diffusion_std_dev = drift_pair.second;
+        LOG(TRACE) << "Diffusion width is " << Units::display(diffusion_std_dev, "um");
 
-            auto global_position = detector_->getGlobalPosition(local_position);
+        double diffusion_x = gauss(diffusion_std_dev);
+        double diffusion_y = gauss(diffusion_std_dev);
 
-            // Produce charge carrier at this position
-            propagated_charges.emplace_back(
-                local_position, global_position, deposit.getType(), charge_per_step, event_time, &deposit);
+        // Find projected position
+        auto local_position = ROOT::Math::XYZPoint(position.x() + diffusion_x, position.y() + diffusion_y, top_z_);
 
-            LOG(DEBUG) << "Propagated " << charge_per_step << " " << type << " to "
-                       << Units::display(local_position, {"mm", "um"}) << " in " << Units::display(event_time, "ns")
-                       << " time";
+        // Only add if within requested integration time:
+        auto event_time = deposit.getEventTime() + propagation_time;
+        if(propagation_time > integration_time_) {
+            LOG(DEBUG) << "Charge carriers propagation time not within integration time: "
+                       << Units::display(event_time, "ns");
+            continue;
+        }
 
-            projected_charge += charge_per_step;
+        // Only add if within sensor volume:
+        if(!geometry_.isWithinSensor(local_position)) {
+            LOG(DEBUG) << "Charge carriers outside sensor volume at " << Units::display(local_position, {"mm", "um"});
+            // FIXME: drop charges if it ends up outside the sensor, could be optimized to estimate position on border
+            continue;
         }
-        total_projected_charge += projected_charge;
+
+        if(output_plots_) {
+            initial_position_histo_->fill(static_cast<double>(Units::convert(initial_position.z(), "um")),
+                                          charge_per_step);
+        }
+
+        auto global_position = detector_->getGlobalPosition(local_position);
+
+        // Produce charge carrier at this position
+        propagated_charges.emplace_back(
+            local_position, global_position, deposit.getType(), charge_per_step, event_time, &deposit);
+
+        LOG(DEBUG) << "Propagated " << charge_per_step << " " << type << " to "
+                   << Units::display(local_position, {"mm", "um"}) << " in " << Units::display(event_time, "ns")
+                   << " time";
+
+        projected_charge += charge_per_step;
     }
-    charge_lost = total_charge - total_projected_charge;
+    return projected_charge;
+}
 
-    LOG(INFO) << "Total charge: " << total_charge << " (lost: " << charge_lost << ", " << (charge_lost / total_charge * 100.)
-              << "%)";
-    LOG(DEBUG) << "Total count of propagated charge carriers: " << propagated_charges.size();
+/**
+ * The drift time and diffusion width of all deposits are computed first in a single loop over contiguous arrays. The
+ * fraction of the carriers of every deposit ending up in a pixel is the integral of the two-dimensional Gaussian
+ * diffusion distribution over the pixel, which factorizes into the differences of the error function at the pixel edges
+ * in x and y. Only pixels of the grid within five standard deviations of the projected position are considered, carriers
+ * outside of these are lost. The number of carriers per pixel is drawn from a multinomial distribution as a sequence of
+ * binomial distributions, and one set of propagated charges is created at the center of every pixel receiving charge.
+ */
+unsigned int ProjectionPropagationModule::share_deposits(const std::vector<const DepositedCharge*>& deposits,
+                                                         std::vector<PropagatedCharge>& propagated_charges,
+                                                         std::mt19937_64& random_generator) {
+    if(deposits.empty()) {
+        return 0;
+    }
 
-    // Create a new message with propagated charges
-    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+    // Compute the projected position, drift time and diffusion width of all deposits
+    std::vector<double> drift_times(deposits.size());
+    std::vector<double> diffusion_widths(deposits.size());
+    for(size_t i = 0; i < deposits.size(); ++i) {
+        const auto& position = deposits[i]->getLocalPosition();
+        auto drift_pair = lookup_drift(position, std::sqrt(detector_->getElectricField(position).Mag2()));
+        drift_times[i] = drift_pair.first;
+        diffusion_widths[i] = drift_pair.second;
+    }
 
-    // Dispatch the message with propagated charges
-    messenger_->dispatchMessage(this, propagated_charge_message);
+    const auto pitch = model_->getPixelSize();
+    const auto grid = model_->getNPixels();
+    std::vector<double> fractions_x, fractions_y;
+    unsigned int projected_charge = 0;
+    for(size_t i = 0; i < deposits.size(); ++i) {
+        const auto& deposit = *deposits[i];
+        const auto& position = deposit.getLocalPosition();
+        const auto sigma = diffusion_widths[i];
+
+        auto event_time = deposit.getEventTime() + drift_times[i];
+        if(drift_times[i] > integration_time_) {
+            LOG(DEBUG) << "Charge carriers propagation time not within integration time: "
+                       << Units::display(event_time, "ns");
+            continue;
+        }
+
+        // Fractions of the carriers arriving in every column and row of the pixels around the projected position
+        auto pixel_fractions = [&](double center, double pixel_pitch, unsigned int pixels, std::vector<double>& fractions) {
+            auto first = std::max(0, static_cast<int>(std::floor((center - 5 * sigma) / pixel_pitch + 0.5)));
+            auto last = std::min(static_cast<int>(pixels) - 1,
+                                 static_cast<int>(std::floor((center + 5 * sigma) / pixel_pitch + 0.5)));
+            fractions.clear();
+            auto cdf = [&](int edge) {
+                auto distance = (edge - 0.5) * pixel_pitch - center;
+                if(sigma <= 0) {
+                    return (distance < 0 ? 0. : 1.);
+                }
+                return 0.5 * std::erfc(-distance / (std::sqrt(2.) * sigma));
+            };
+            auto lower = cdf(first);
+            for(int pixel = first; pixel <= last; ++pixel) {
+                auto upper = cdf(pixel + 1);
+                fractions.push_back(upper - lower);
+                lower = upper;
+            }
+            return first;
+        };
+        auto first_x = pixel_fractions(position.x(), pitch.x(), grid.x(), fractions_x);
+        auto first_y = pixel_fractions(position.y(), pitch.y(), grid.y(), fractions_y);
+
+        // Draw the number of carriers per pixel from a multinomial distribution
+        unsigned int charges_remaining = deposit.getCharge();
+        double probability_remaining = 1;
+        for(size_t x = 0; x < fractions_x.size() && charges_remaining > 0; ++x) {
+            for(size_t y = 0; y < fractions_y.size() && charges_remaining > 0; ++y) {
+                auto probability = fractions_x[x] * fractions_y[y];
+                if(probability <= 0 || probability_remaining <= 0) {
+                    continue;
+                }
+                std::binomial_distribution<unsigned int> binomial(charges_remaining,
+                                                                  std::min(1., probability / probability_remaining));
+                auto charge = binomial(random_generator);
+                probability_remaining -= probability;
+                if(charge == 0) {
+                    continue;
+                }
+                charges_remaining -= charge;
+
+                auto local_position = ROOT::Math::XYZPoint((first_x + static_cast<int>(x)) * pitch.x(),
+                                                           (first_y + static_cast<int>(y)) * pitch.y(),
+                                                           top_z_);
+                propagated_charges.emplace_back(local_position,
+                                                detector_->getGlobalPosition(local_position),
+                                                deposit.getType(),
+                                                charge,
+                                                event_time,
+                                                &deposit);
+                projected_charge += charge;
+                LOG(TRACE) << "Shared " << charge << " " << deposit.getType() << " to pixel center at "
+                           << Units::display(local_position, {"mm", "um"});
+            }
+        }
+
+        auto shared_charge = deposit.getCharge() - charges_remaining;
+        if(output_plots_) {
+            propagation_time_histo_->fill(drift_times[i], shared_charge);
+            drift_time_histo_->fill(drift_times[i], shared_charge);
+            initial_position_histo_->fill(static_cast<double>(Units::convert(position.z(), "um")), shared_charge);
+        }
+        LOG(DEBUG) << "Shared " << shared_charge << " " << deposit.getType() << " between pixels in "
+                   << Units::display(event_time, "ns") << " time";
+    }
+    return projected_charge;
 }
 
 void ProjectionPropagationModule::finalize() {
     if(output_plots_) {
         // Write output plots
-        drift_time_histo_->Write();
-        propagation_time_histo_->Write();
-        initial_position_histo_->Write();
+        drift_time_histo_->merge()->Write();
+        propagation_time_histo_->merge()->Write();
+        initial_position_histo_->merge()->Write();
         if(diffuse_deposit_) {
-            diffusion_time_histo_->Write();
+            diffusion_time_histo_->merge()->Write();
         }
     }
 }
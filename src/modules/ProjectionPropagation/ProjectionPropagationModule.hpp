@@ -8,8 +8,11 @@
  * Refer to the User's Manual for more details.
  */
 
+#include <memory>
 #include <random>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <TH1D.h>
 
@@ -21,6 +24,10 @@
 #include "objects/DepositedCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
 
+#include "tools/mobility.h"
+#include "tools/normal_pool.h"
+#include "tools/threaded_histogram.h"
+
 namespace allpix {
     /**
      * @ingroup Modules
@@ -56,9 +63,50 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Compute the drift to the top of the sensor in a linear electric field
+         * @param position Position the drift starts at
+         * @param efield_mag Magnitude of the electric field at the position
+         * @param efield_mag_top Magnitude of the electric field at the top of the sensor
+         * @return Pair of the drift time and the width of the lateral diffusion
+         */
+        std::pair<double, double>
+        drift(const ROOT::Math::XYZPoint& position, double efield_mag, double efield_mag_top) const;
+
+        /**
+         * @brief Get the drift to the top of the sensor from the table of drift times if available
+         * @param position Position the drift starts at
+         * @param efield_mag Magnitude of the electric field at the position
+         * @return Pair of the drift time and the width of the lateral diffusion
+         */
+        std::pair<double, double> lookup_drift(const ROOT::Math::XYZPoint& position, double efield_mag) const;
+
+        /**
+         * @brief Project the charge carriers of a deposit to the surface in sets with randomized diffusion
+         * @param deposit Deposited charge to project
+         * @param propagated_charges List the propagated charges are added to
+         * @param random_generator Random generator used for the diffusion
+         * @return Number of charge carriers projected within the integration time and sensor
+         */
+        unsigned int project_deposit(const DepositedCharge& deposit,
+                                     std::vector<PropagatedCharge>& propagated_charges,
+                                     std::mt19937_64& random_generator);
+
+        /**
+         * @brief Share the charge carriers of deposits between the pixels using the analytic diffusion distribution
+         * @param deposits Deposited charges in the electric field to share
+         * @param propagated_charges List the propagated charges are added to
+         * @param random_generator Random generator used to share the carriers
+         * @return Number of charge carriers shared between the pixels
+         */
+        unsigned int share_deposits(const std::vector<const DepositedCharge*>& deposits,
+                                    std::vector<PropagatedCharge>& propagated_charges,
+                                    std::mt19937_64& random_generator);
+
         Messenger* messenger_;
         std::shared_ptr<const Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
+        DetectorGeometryView geometry_;
 
         // Random generator for diffusion calculation
         std::mt19937_64 random_generator_;
@@ -67,33 +115,40 @@ namespace allpix {
         bool output_plots_;
         double integration_time_{};
         bool diffuse_deposit_;
+        bool analytic_sharing_{};
+        bool pooled_diffusion_{};
+        unsigned int charge_per_step_{};
 
         // Carrier type to be propagated
         CarrierType propagate_type_;
         // Side to propagate too
         double top_z_;
 
-        // Precalculated values for electron and hole mobility
-        double hole_Vm_;
-        double hole_Ec_;
-        double hole_Beta_;
-        double electron_Vm_;
-        double electron_Ec_;
-        double electron_Beta_;
-
-        // Calculated slope of the electric field
-        double slope_efield_;
+        // Mobility parameterization for electrons and holes
+        JacoboniCanaliMobility mobility_;
 
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
 
+        // Electric field at the top of the sensor
+        double efield_mag_top_{};
+
+        // Drift time, diffusion width and field magnitude at equidistant depths of the sensor
+        struct DriftEntry {
+            double time{};
+            double sigma{};
+            double field{};
+        };
+        std::vector<DriftEntry> drift_table_;
+        double drift_table_z0_{}, drift_table_dz_{};
+
         // Output plot for drift time
-        TH1D* drift_time_histo_;
-        TH1D* diffusion_time_histo_;
-        TH1D* propagation_time_histo_;
-        TH1D* initial_position_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> drift_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> diffusion_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> propagation_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> initial_position_histo_;
 
-        // Deposits for the bound detector in this event
+        // Deposits for the bound detector in this event, only used to register the message (fetched in the run method)
         std::shared_ptr<DepositedChargeMessage> deposits_message_;
     };
 } // namespace allpix
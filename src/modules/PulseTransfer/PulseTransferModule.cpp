@@ -11,20 +11,35 @@
 #include "core/utils/log.h"
 #include "objects/PixelCharge.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <TAxis.h>
 #include <TGraph.h>
 
 using namespace allpix;
 
+namespace {
+    // Pulse induced on a single pixel and the propagated charges contributing to it
+    struct PixelPulse {
+        Pulse pulse;
+        std::vector<const PropagatedCharge*> propagated_charges;
+    };
+} // namespace
+
 PulseTransferModule::PulseTransferModule(Configuration& config,
                                          Messenger* messenger,
                                          const std::shared_ptr<Detector>& detector)
     : Module(config, detector), detector_(detector), messenger_(messenger) {
-    // Enable parallelization of this module if multithreading is enabled
+    // Enable parallelization of this module if multithreading is enabled, the histograms are filled per thread such that
+    // also several events can be transferred at the same time
     enable_parallelization();
+    enable_event_parallelization();
 
     // Set default value for config variables
     config_.setDefault("max_depth_distance", Units::get(5.0, "um"));
@@ -39,11 +54,18 @@ PulseTransferModule::PulseTransferModule(Configuration& config,
     output_plots_ = config_.get<bool>("output_plots");
     output_pulsegraphs_ = config_.get<bool>("output_pulsegraphs");
     timestep_ = config_.get<double>("timestep");
+    config_.bind("max_depth_distance", max_depth_distance_);
+    config_.bind("collect_from_implant", collect_from_implant_);
 
+    // Require propagated charges message for single detector, fetched in the run method
     messenger_->bindSingle(this, &PulseTransferModule::message_, MsgFlags::REQUIRED);
 }
 
 void PulseTransferModule::init() {
+    geometry_ = detector_->getGeometryView();
+    if(!PixelKey::supports(detector_->getModel()->getNPixels())) {
+        throw ModuleError("Pixel grid exceeds " + std::to_string(PixelKey::max_coordinate) + " pixels in x or y");
+    }
 
     if(output_plots_) {
         LOG(TRACE) << "Creating output plots";
@@ -53,32 +75,42 @@ void PulseTransferModule::init() {
         auto nbins = config_.get<int>("output_plots_bins");
 
         // Create histograms if needed
-        h_total_induced_charge_ =
-            new TH1D("inducedcharge", "total induced charge;induced charge [ke];events", nbins, 0, maximum);
-        h_induced_pixel_charge_ =
-            new TH1D("pixelcharge", "induced charge per pixel;induced pixel charge [ke];pixels", nbins, 0, maximum);
+        h_total_induced_charge_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "inducedcharge", "total induced charge;induced charge [ke];events", nbins, 0, maximum);
+        h_induced_pixel_charge_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "pixelcharge", "induced charge per pixel;induced pixel charge [ke];pixels", nbins, 0, maximum);
     }
 }
 
 void PulseTransferModule::run(unsigned int event_num) {
+    auto message = messenger_->fetchMessage<PropagatedChargeMessage>(this);
 
     // Create map for all pixels: pulse and propagated charges
-    std::map<Pixel::Index, Pulse> pixel_pulse_map;
-    std::map<Pixel::Index, std::vector<const PropagatedCharge*>> pixel_charge_map;
+    std::unordered_map<PixelKey, PixelPulse> pixel_pulse_map;
 
-    LOG(DEBUG) << "Received " << message_->getData().size() << " propagated charge objects.";
-    for(const auto& propagated_charge : message_->getData()) {
-        auto pulses = propagated_charge.getPulses();
+    // Add a pulse to a pixel, storing the corresponding propagated charge to preserve the history if required. All pulses
+    // of a propagated charge are added after each other, such that it can only already be stored as last charge.
+    auto add_pulse = [&](const Pixel::Index& pixel_index, const Pulse& pulse, const PropagatedCharge* propagated_charge) {
+        auto& pixel_pulse = pixel_pulse_map[PixelKey(pixel_index)];
+        pixel_pulse.pulse += pulse;
+
+        auto& px = pixel_pulse.propagated_charges;
+        if(has_object_history() && (px.empty() || px.back() != propagated_charge)) {
+            px.emplace_back(propagated_charge);
+        }
+    };
+
+    LOG(DEBUG) << "Received " << message->getData().size() << " propagated charge objects.";
+    for(const auto& propagated_charge : message->getData()) {
+        const auto& pulses = propagated_charge.getPulses();
 
         if(pulses.empty()) {
             LOG(TRACE) << "No pulse information available - producing pseudo-pulse from arrival time of charge carriers.";
 
-            auto model = detector_->getModel();
             auto position = propagated_charge.getLocalPosition();
 
             // Ignore if outside depth range of implant
-            if(std::fabs(position.z() - (model->getSensorCenter().z() + model->getSensorSize().z() / 2.0)) >
-               config_.get<double>("max_depth_distance")) {
+            if(std::fabs(position.z() - geometry_.getSensorTop()) > max_depth_distance_) {
                 LOG(TRACE) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                            << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
                            << " because their local position is not in implant range";
@@ -86,11 +118,10 @@ void PulseTransferModule::run(unsigned int event_num) {
             }
 
             // Find the nearest pixel
-            auto xpixel = static_cast<int>(std::round(position.x() / model->getPixelSize().x()));
-            auto ypixel = static_cast<int>(std::round(position.y() / model->getPixelSize().y()));
+            auto [xpixel, ypixel] = geometry_.getPixel(position);
 
             // Ignore if out of pixel grid
-            if(!detector_->isWithinPixelGrid(xpixel, ypixel)) {
+            if(!geometry_.isWithinPixelGrid(xpixel, ypixel)) {
                 LOG(TRACE) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                            << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
                            << " because their nearest pixel (" << xpixel << "," << ypixel << ") is outside the grid";
@@ -98,13 +129,13 @@ void PulseTransferModule::run(unsigned int event_num) {
             }
 
             // Ignore if outside the implant region:
-            if(config_.get<bool>("collect_from_implant")) {
+            if(collect_from_implant_) {
                 if(detector_->getElectricFieldType() == FieldType::LINEAR) {
                     throw ModuleError(
                         "Charge collection from implant region should not be used with linear electric fields.");
                 }
 
-                if(!detector_->isWithinImplant(position)) {
+                if(!geometry_.isWithinImplant(position)) {
                     LOG(TRACE) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                                << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
                                << " because it is outside the pixel implant.";
@@ -117,46 +148,44 @@ void PulseTransferModule::run(unsigned int event_num) {
             // Generate pseudo-pulse:
             Pulse pulse(timestep_);
             pulse.addCharge(propagated_charge.getCharge(), propagated_charge.getEventTime());
-            pixel_pulse_map[pixel_index] += pulse;
-
-            auto px = pixel_charge_map[pixel_index];
-            // For each pulse, store the corresponding propagated charges to preserve history:
-            if(std::find(px.begin(), px.end(), &propagated_charge) == px.end()) {
-                pixel_charge_map[pixel_index].emplace_back(&propagated_charge);
-            }
+            add_pulse(pixel_index, pulse, &propagated_charge);
         } else {
             LOG(TRACE) << "Found pulse information";
             LOG_ONCE(INFO) << "Pulses available - settings \"timestep\", \"max_depth_distance\" and "
                               "\"collect_from_implant\" have no effect";
 
-            for(auto& pulse : pulses) {
-                auto pixel_index = pulse.first;
-
-                // Accumulate all pulses from input message data:
-                pixel_pulse_map[pixel_index] += pulse.second;
-
-                auto px = pixel_charge_map[pixel_index];
-                // For each pulse, store the corresponding propagated charges to preserve history:
-                if(std::find(px.begin(), px.end(), &propagated_charge) == px.end()) {
-                    pixel_charge_map[pixel_index].emplace_back(&propagated_charge);
-                }
+            // Accumulate all pulses from input message data:
+            for(const auto& pulse : pulses) {
+                add_pulse(pulse.first, pulse.second, &propagated_charge);
             }
         }
     }
 
+    // Sort the pixels by their index, such that the pixel charges are created in the same order for every run
+    std::vector<std::pair<PixelKey, PixelPulse*>> sorted_pixels;
+    sorted_pixels.reserve(pixel_pulse_map.size());
+    for(auto& pixel_index_pulse : pixel_pulse_map) {
+        sorted_pixels.emplace_back(pixel_index_pulse.first, &pixel_index_pulse.second);
+    }
+    std::sort(sorted_pixels.begin(), sorted_pixels.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
     // Create vector of pixel pulses to return for this detector
     std::vector<PixelCharge> pixel_charges;
+    pixel_charges.reserve(sorted_pixels.size());
     Pulse total_pulse;
-    for(auto& pixel_index_pulse : pixel_pulse_map) {
-        auto index = pixel_index_pulse.first;
-        auto pulse = pixel_index_pulse.second;
+    for(auto& pixel_index_pulse : sorted_pixels) {
+        auto index = pixel_index_pulse.first.getIndex();
+        auto& pulse = pixel_index_pulse.second->pulse;
+        auto& propagated_charges = pixel_index_pulse.second->propagated_charges;
 
         // Sum all pulses for informational output:
         total_pulse += pulse;
 
         // Fill pixel charge histogram
         if(output_plots_) {
-            h_induced_pixel_charge_->Fill(pulse.getCharge() / 1e3);
+            h_induced_pixel_charge_->fill(pulse.getCharge() / 1e3);
         }
 
         // Fill a graphs with the individual pixel pulses:
@@ -165,7 +194,7 @@ void PulseTransferModule::run(unsigned int event_num) {
             auto pulse_vec = pulse.getPulse();
             LOG(TRACE) << "Preparing pulse for pixel " << index << ", " << pulse_vec.size() << " bins of "
                        << Units::display(step, {"ps", "ns"})
-                       << ", total charge: " << Units::display(pixel_index_pulse.second.getCharge(), "e");
+                       << ", total charge: " << Units::display(pulse.getCharge(), "e");
 
             // Generate x-axis:
             std::vector<double> time(pulse_vec.size());
@@ -180,9 +209,9 @@ void PulseTransferModule::run(unsigned int event_num) {
             pulse_graph->GetYaxis()->SetTitle("Q_{ind} [e]");
             pulse_graph->SetTitle(("Induced charge in pixel (" + std::to_string(index.x()) + "," +
                                    std::to_string(index.y()) +
-                                   "), Q_{tot} = " + std::to_string(pixel_index_pulse.second.getCharge()) + " e")
+                                   "), Q_{tot} = " + std::to_string(pulse.getCharge()) + " e")
                                       .c_str());
-            getROOTDirectory()->WriteTObject(pulse_graph, name.c_str());
+            writeROOTObject(pulse_graph, name);
 
             // Generate graphs of integrated charge over time:
             std::vector<double> charge_vec;
@@ -199,14 +228,14 @@ void PulseTransferModule::run(unsigned int event_num) {
             charge_graph->GetYaxis()->SetTitle("Q_{tot} [e]");
             charge_graph->SetTitle(("Accumulated induced charge in pixel (" + std::to_string(index.x()) + "," +
                                     std::to_string(index.y()) +
-                                    "), Q_{tot} = " + std::to_string(pixel_index_pulse.second.getCharge()) + " e")
+                                    "), Q_{tot} = " + std::to_string(pulse.getCharge()) + " e")
                                        .c_str());
-            getROOTDirectory()->WriteTObject(charge_graph, name.c_str());
+            writeROOTObject(charge_graph, name);
         }
-        LOG(DEBUG) << "Charge on pixel " << index << " has " << pixel_charge_map[index].size() << " ancestors";
+        LOG(DEBUG) << "Charge on pixel " << index << " has " << propagated_charges.size() << " ancestors";
 
         // Store the pulse:
-        pixel_charges.emplace_back(detector_->getPixel(index), std::move(pulse), pixel_charge_map[index]);
+        pixel_charges.emplace_back(detector_->getPixel(index), std::move(pulse), propagated_charges);
     }
 
     // Create a new message with pixel pulses and dispatch:
@@ -215,7 +244,7 @@ void PulseTransferModule::run(unsigned int event_num) {
 
     // Fill pixel charge histogram
     if(output_plots_) {
-        h_total_induced_charge_->Fill(total_pulse.getCharge() / 1e3);
+        h_total_induced_charge_->fill(total_pulse.getCharge() / 1e3);
     }
 
     LOG(INFO) << "Total charge induced on all pixels: " << Units::display(total_pulse.getCharge(), "e");
@@ -226,7 +255,7 @@ void PulseTransferModule::finalize() {
     if(output_plots_) {
         // Write histograms
         LOG(TRACE) << "Writing output plots to file";
-        h_induced_pixel_charge_->Write();
-        h_total_induced_charge_->Write();
+        h_induced_pixel_charge_->merge()->Write();
+        h_total_induced_charge_->merge()->Write();
     }
 }
@@ -7,6 +7,7 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <memory>
 #include <string>
 
 #include "core/config/Configuration.hpp"
@@ -15,6 +16,7 @@
 #include "core/module/Module.hpp"
 
 #include "objects/PropagatedCharge.hpp"
+#include "tools/threaded_histogram.h"
 
 #include <TH1D.h>
 
@@ -53,14 +55,16 @@ namespace allpix {
 
     private:
         bool output_plots_{}, output_pulsegraphs_{};
-        double timestep_{};
+        double timestep_{}, max_depth_distance_{};
+        bool collect_from_implant_{};
 
         // General module members
         std::shared_ptr<Detector> detector_;
+        DetectorGeometryView geometry_;
         Messenger* messenger_;
         std::shared_ptr<PropagatedChargeMessage> message_;
 
         // Output histograms
-        TH1D *h_total_induced_charge_{}, *h_induced_pixel_charge_{};
+        std::unique_ptr<ThreadedHistogram<TH1D>> h_total_induced_charge_, h_induced_pixel_charge_;
     };
 } // namespace allpix
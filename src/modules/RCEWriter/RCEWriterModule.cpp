@@ -297,6 +297,9 @@ RCEWriterModule::RCEWriterModule(Configuration& config, Messenger* messenger, Ge
     assert(messenger && "messenger must be non-null");
     assert(geo_mgr && "geo_mgr must be non-null");
 
+    // The output file and the Proteus configuration files are not shared with other modules
+    enable_parallel_finalization();
+
     // Bind to PixelHitMessage
     messenger->bindMulti(this, &RCEWriterModule::pixel_hit_messages_);
 
@@ -340,14 +343,25 @@ void RCEWriterModule::init() {
         TDirectory* detector = output_file_->mkdir(det_dir_name.c_str());
         detector->cd();
 
+        // Allocate the hit buffers once, every pixel of the detector can be hit at most once per event
+        auto npixels = geo_mgr_->getDetector(detector_name)->getModel()->getNPixels();
+        auto max_hits = static_cast<size_t>(npixels.x()) * static_cast<size_t>(npixels.y());
+        sensor.nhits_ = 0;
+        sensor.pix_x_.resize(max_hits);
+        sensor.pix_y_.resize(max_hits);
+        sensor.value_.resize(max_hits);
+        sensor.timing_.resize(max_hits);
+        // This contains no useful information but it expected to be present
+        sensor.hit_in_cluster_.assign(max_hits, 0);
+
         // Initialize the tree and its branches
         sensor.tree = new TTree("Hits", "");
         sensor.tree->Branch("NHits", &sensor.nhits_);
-        sensor.tree->Branch("PixX", &sensor.pix_x_, "PixX[NHits]/I");
-        sensor.tree->Branch("PixY", &sensor.pix_y_, "PixY[NHits]/I");
-        sensor.tree->Branch("Value", &sensor.value_, "Value[NHits]/I");
-        sensor.tree->Branch("Timing", &sensor.timing_, "Timing[NHits]/I");
-        sensor.tree->Branch("HitInCluster", &sensor.hit_in_cluster_, "HitInCluster[NHits]/I");
+        sensor.tree->Branch("PixX", sensor.pix_x_.data(), "PixX[NHits]/I");
+        sensor.tree->Branch("PixY", sensor.pix_y_.data(), "PixY[NHits]/I");
+        sensor.tree->Branch("Value", sensor.value_.data(), "Value[NHits]/I");
+        sensor.tree->Branch("Timing", sensor.timing_.data(), "Timing[NHits]/I");
+        sensor.tree->Branch("HitInCluster", sensor.hit_in_cluster_.data(), "HitInCluster[NHits]/I");
 
         det_index += 1;
     }
@@ -379,27 +393,28 @@ void RCEWriterModule::run(unsigned int event_id) {
         const auto& detector_name = hit_msg->getDetector()->getName();
         auto& sensor = sensors_[detector_name];
 
-        // Loop over all the hits
-        for(const auto& hit : hit_msg->getData()) {
-            if(sensor_data::kMaxHits <= sensor.nhits_) {
-                LOG(ERROR) << "More than " << sensor_data::kMaxHits << " in detector " << detector_name;
-                continue;
-            }
+        // Only fill as many hits as fit in the buffers of the detector
+        const auto& hits = hit_msg->getData();
+        auto i = static_cast<size_t>(sensor.nhits_);
+        auto nhits = std::min(hits.size(), sensor.pix_x_.size() - i);
+        if(nhits < hits.size()) {
+            LOG(ERROR) << "More than " << sensor.pix_x_.size() << " hits in detector " << detector_name << ", ignoring "
+                       << (hits.size() - nhits) << " hits";
+        }
 
-            // Fill the tree with received messages
-            auto i = sensor.nhits_;
-            sensor.pix_x_[i] = static_cast<Int_t>(hit.getPixel().getIndex().x()); // NOLINT
-            sensor.pix_y_[i] = static_cast<Int_t>(hit.getPixel().getIndex().y()); // NOLINT
-            sensor.value_[i] = static_cast<Int_t>(hit.getSignal());               // NOLINT
+        // Fill the buffers of the tree with the received hits in one pass
+        for(size_t j = 0; j < nhits; ++j, ++i) {
+            const auto& hit = hits[j];
+            sensor.pix_x_[i] = static_cast<Int_t>(hit.getPixel().getIndex().x());
+            sensor.pix_y_[i] = static_cast<Int_t>(hit.getPixel().getIndex().y());
+            sensor.value_[i] = static_cast<Int_t>(hit.getSignal());
             // Assumes that time is correctly digitized
-            sensor.timing_[i] = static_cast<Int_t>(hit.getTime()); // NOLINT
-            // This contains no useful information but it expected to be present
-            sensor.hit_in_cluster_[i] = 0; // NOLINT
-            sensor.nhits_ += 1;
+            sensor.timing_[i] = static_cast<Int_t>(hit.getTime());
 
             LOG(TRACE) << detector_name << " x=" << hit.getPixel().getIndex().x() << " y=" << hit.getPixel().getIndex().y()
                        << " t=" << hit.getTime() << " signal=" << hit.getSignal();
         }
+        sensor.nhits_ = static_cast<Int_t>(i);
     }
 
     // Loop over all the detectors to fill all corresponding sensor trees
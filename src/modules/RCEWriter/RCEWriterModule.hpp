@@ -9,6 +9,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -63,16 +64,16 @@ namespace allpix {
     private:
         GeometryManager* geo_mgr_;
 
-        // Struct to store tree and information for each detector
+        // Struct to store tree and information for each detector, the hit buffers are allocated once for the maximum
+        // number of hits of the detector and bound to the branches of the tree
         struct sensor_data {
-            static constexpr int kMaxHits = (1 << 14);
             TTree* tree; // no unique_ptr, ROOT takes ownership
             Int_t nhits_;
-            Int_t pix_x_[kMaxHits];
-            Int_t pix_y_[kMaxHits];
-            Int_t value_[kMaxHits];
-            Int_t timing_[kMaxHits];
-            Int_t hit_in_cluster_[kMaxHits];
+            std::vector<Int_t> pix_x_;
+            std::vector<Int_t> pix_y_;
+            std::vector<Int_t> value_;
+            std::vector<Int_t> timing_;
+            std::vector<Int_t> hit_in_cluster_;
         };
         // The map from detector names to the respective sensor_data struct
         std::map<std::string, sensor_data> sensors_;
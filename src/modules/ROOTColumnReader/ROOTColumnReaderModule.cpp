@@ -0,0 +1,254 @@
+/**
+ * @file
+ * @brief Implementation of ROOT columnar data file reader module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ROOTColumnReaderModule.hpp"
+
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <TTree.h>
+
+#include "core/utils/log.h"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+#include "objects/PropagatedCharge.hpp"
+
+using namespace allpix;
+
+namespace {
+    // Get the object at a stored index, returning a null pointer if the index does not refer to an object
+    template <typename T> const T* get_object(const std::vector<T>& objects, int index) {
+        return (index >= 0 && static_cast<size_t>(index) < objects.size() ? &objects[static_cast<size_t>(index)] : nullptr);
+    }
+
+    // Create a message and dispatch it if any module listens to it, the message keeps the objects alive for linking
+    template <typename T>
+    std::shared_ptr<Message<T>> dispatch(Module* module,
+                                         Messenger* messenger,
+                                         std::vector<T> objects,
+                                         const std::shared_ptr<Detector>& detector) {
+        auto message = std::make_shared<Message<T>>(std::move(objects), detector);
+        if(!message->getData().empty() && messenger->hasReceiver<Message<T>>(module, detector)) {
+            messenger->dispatchMessage(module, message);
+        }
+        return message;
+    }
+} // namespace
+
+ROOTColumnReaderModule::ROOTColumnReaderModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
+    : Module(config), geo_manager_(geo_manager), messenger_(messenger) {}
+
+void ROOTColumnReaderModule::init() {
+    std::set<std::string> include;
+    if(config_.has("include")) {
+        auto inc_arr = config_.getArray<std::string>("include");
+        include.insert(inc_arr.begin(), inc_arr.end());
+    }
+
+    // Open the file with the columns
+    auto input_file_name = config_.getPathWithExtension("file_name", "root", true);
+    input_file_ = std::make_unique<TFile>(input_file_name.c_str());
+    if(!input_file_->IsOpen()) {
+        throw InvalidValueError(config_, "file_name", "could not open input file");
+    }
+
+    // Bind the columns of all detectors to the trees of the included object types stored in the file
+    for(auto& detector : geo_manager_->getDetectors()) {
+        auto columns = std::make_unique<DetectorColumns>();
+        columns->detector = detector;
+        columns->for_each_type([&](const std::string& type_name, auto& type_columns) {
+            if(!include.empty() && include.find(type_name) == include.end()) {
+                return;
+            }
+
+            TTree* tree = nullptr;
+            input_file_->GetObject(type_name.c_str(), tree);
+            if(tree == nullptr) {
+                return;
+            }
+
+            // Only bind the columns if all of them are stored for this detector
+            bool complete = true;
+            type_columns.for_each([&](const std::string& column_name, auto&) {
+                complete = complete && (tree->GetBranch((detector->getName() + "_" + column_name).c_str()) != nullptr);
+            });
+            if(!complete) {
+                LOG(WARNING) << "Input file does not contain all columns of " << type_name << " objects for detector "
+                             << detector->getName() << ", not reading them";
+                return;
+            }
+
+            auto& tree_reader = tree_readers_[type_name];
+            if(tree_reader == nullptr) {
+                tree_reader = std::make_unique<TTreeReader>(type_name.c_str(), input_file_.get());
+            }
+            type_columns.for_each([&](const std::string& column_name, auto& column) {
+                using Array = typename std::decay_t<decltype(column)>::element_type;
+                column = std::make_unique<Array>(*tree_reader, (detector->getName() + "_" + column_name).c_str());
+            });
+        });
+        columns_.push_back(std::move(columns));
+    }
+
+    if(tree_readers_.empty()) {
+        LOG(ERROR) << "Provided ROOT file does not contain any columns, module will not read any data";
+    }
+}
+
+void ROOTColumnReaderModule::run(unsigned int event_num) {
+    for(auto& tree_reader : tree_readers_) {
+        auto status = tree_reader.second->SetEntry(event_num - 1);
+        if(status == TTreeReader::kEntryNotFound || status == TTreeReader::kEntryBeyondEnd) {
+            throw EndOfRunException("Requesting end of run because the columns only contain data for " +
+                                    std::to_string(event_num - 1) + " events");
+        } else if(status != TTreeReader::kEntryValid) {
+            throw ModuleError("Cannot read columns of " + tree_reader.first +
+                              " objects, error: " + std::to_string(static_cast<int>(status)));
+        }
+    }
+
+    LOG(TRACE) << "Building messages from stored columns";
+    for(auto& columns : columns_) {
+        read_detector(*columns);
+    }
+}
+
+/**
+ * The objects are created in the order of their relations, such that related objects are always created before. Relations
+ * to objects which are not stored are left empty. Pixel charges without related propagated charges are linked to their
+ * Monte-Carlo particles through the first deposited charge of every particle.
+ */
+void ROOTColumnReaderModule::read_detector(DetectorColumns& columns) {
+    const auto& detector = columns.detector;
+
+    std::shared_ptr<MCParticleMessage> mcparticle_message;
+    std::vector<MCParticle> mcparticles;
+    auto& mcp = columns.mcparticles;
+    if(mcp.particle_id != nullptr) {
+        for(size_t i = 0; i < mcp.particle_id->GetSize(); ++i) {
+            mcparticles.emplace_back(mcp.local_start_point.get(i),
+                                     mcp.global_start_point.get(i),
+                                     mcp.local_end_point.get(i),
+                                     mcp.global_end_point.get(i),
+                                     (*mcp.particle_id)[i],
+                                     (*mcp.time)[i]);
+        }
+        for(size_t i = 0; i < mcparticles.size(); ++i) {
+            auto* parent = get_object(mcparticles, (*mcp.parent)[i]);
+            if(parent != nullptr) {
+                mcparticles[i].setParent(parent);
+            }
+        }
+    }
+    read_cnt_ += mcparticles.size();
+    mcparticle_message = dispatch(this, messenger_, std::move(mcparticles), detector);
+    const auto& stored_mcparticles = mcparticle_message->getData();
+
+    // Deposited charges, keeping the first deposit of every Monte-Carlo particle
+    std::vector<DepositedCharge> deposited_charges;
+    std::vector<int> first_deposits(stored_mcparticles.size(), -1);
+    auto& deposits = columns.deposited_charges;
+    if(deposits.charge != nullptr) {
+        for(size_t i = 0; i < deposits.charge->GetSize(); ++i) {
+            auto mcparticle_index = (*deposits.origin)[i];
+            deposited_charges.emplace_back(deposits.local_position.get(i),
+                                           deposits.global_position.get(i),
+                                           static_cast<CarrierType>((*deposits.type)[i]),
+                                           (*deposits.charge)[i],
+                                           (*deposits.event_time)[i],
+                                           get_object(stored_mcparticles, mcparticle_index));
+            if(get_object(stored_mcparticles, mcparticle_index) != nullptr &&
+               first_deposits[static_cast<size_t>(mcparticle_index)] < 0) {
+                first_deposits[static_cast<size_t>(mcparticle_index)] = static_cast<int>(i);
+            }
+        }
+    }
+    read_cnt_ += deposited_charges.size();
+    auto deposit_message = dispatch(this, messenger_, std::move(deposited_charges), detector);
+    const auto& stored_deposits = deposit_message->getData();
+
+    std::vector<PropagatedCharge> propagated_charges;
+    auto& propagated = columns.propagated_charges;
+    if(propagated.charge != nullptr) {
+        for(size_t i = 0; i < propagated.charge->GetSize(); ++i) {
+            propagated_charges.emplace_back(propagated.local_position.get(i),
+                                            propagated.global_position.get(i),
+                                            static_cast<CarrierType>((*propagated.type)[i]),
+                                            (*propagated.charge)[i],
+                                            (*propagated.event_time)[i],
+                                            get_object(stored_deposits, (*propagated.origin)[i]));
+        }
+    }
+    read_cnt_ += propagated_charges.size();
+    auto propagated_message = dispatch(this, messenger_, std::move(propagated_charges), detector);
+    const auto& stored_propagated = propagated_message->getData();
+
+    std::vector<PixelCharge> pixel_charges;
+    auto& charges = columns.pixel_charges;
+    if(charges.charge != nullptr) {
+        size_t propagated_offset = 0;
+        size_t mcparticle_offset = 0;
+        for(size_t i = 0; i < charges.charge->GetSize(); ++i) {
+            auto pixel = detector->getPixel((*charges.pixel_x)[i], (*charges.pixel_y)[i]);
+
+            // Related objects of this pixel charge in the flattened lists of indices
+            std::vector<const PropagatedCharge*> related_propagated;
+            for(unsigned int j = 0; j < (*charges.propagated_charges_count)[i]; ++j) {
+                auto* propagated_charge = get_object(stored_propagated, (*charges.propagated_charges)[propagated_offset++]);
+                if(propagated_charge != nullptr) {
+                    related_propagated.push_back(propagated_charge);
+                }
+            }
+            std::vector<const DepositedCharge*> related_deposits;
+            for(unsigned int j = 0; j < (*charges.mcparticles_count)[i]; ++j) {
+                auto mcparticle_index = (*charges.mcparticles)[mcparticle_offset++];
+                if(get_object(stored_mcparticles, mcparticle_index) != nullptr) {
+                    auto* deposit = get_object(stored_deposits, first_deposits[static_cast<size_t>(mcparticle_index)]);
+                    if(deposit != nullptr) {
+                        related_deposits.push_back(deposit);
+                    }
+                }
+            }
+
+            if(!related_propagated.empty()) {
+                pixel_charges.emplace_back(pixel, (*charges.charge)[i], related_propagated);
+            } else {
+                pixel_charges.emplace_back(pixel, (*charges.charge)[i], related_deposits);
+            }
+        }
+    }
+    read_cnt_ += pixel_charges.size();
+    auto pixel_charge_message = dispatch(this, messenger_, std::move(pixel_charges), detector);
+    const auto& stored_pixel_charges = pixel_charge_message->getData();
+
+    std::vector<PixelHit> pixel_hits;
+    auto& hits = columns.pixel_hits;
+    if(hits.signal != nullptr) {
+        for(size_t i = 0; i < hits.signal->GetSize(); ++i) {
+            pixel_hits.emplace_back(detector->getPixel((*hits.pixel_x)[i], (*hits.pixel_y)[i]),
+                                    (*hits.time)[i],
+                                    (*hits.signal)[i],
+                                    get_object(stored_pixel_charges, (*hits.pixel_charge)[i]));
+        }
+    }
+    read_cnt_ += pixel_hits.size();
+    dispatch(this, messenger_, std::move(pixel_hits), detector);
+}
+
+void ROOTColumnReaderModule::finalize() {
+    // Print statistics
+    LOG(INFO) << "Read " << read_cnt_ << " objects from " << tree_readers_.size() << " trees";
+
+    // Close the file
+    input_file_->Close();
+}
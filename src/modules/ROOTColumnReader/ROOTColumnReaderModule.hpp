@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief Definition of ROOT columnar data file reader module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <TFile.h>
+#include <TTreeReader.h>
+#include <TTreeReaderArray.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to read the core objects from the flat columns written by the \ref ROOTColumnWriterModule
+     *
+     * Reads the columns of all object types stored in the file for all detectors of the geometry, creates the objects with
+     * the relations given by their stored indices and dispatches them as messages.
+     */
+    class ROOTColumnReaderModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_manager Pointer to the geometry manager, containing the detectors
+         */
+        ROOTColumnReaderModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
+
+        /**
+         * @brief Open the input file and bind the columns of all detectors
+         */
+        void init() override;
+
+        /**
+         * @brief Create the objects of the event from the columns and dispatch them
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Print statistics and close the input file
+         */
+        void finalize() override;
+
+    private:
+        template <typename T> using Column = std::unique_ptr<TTreeReaderArray<T>>;
+
+        /**
+         * @brief Columns of the three coordinates of a point
+         */
+        struct PointColumns {
+            Column<double> x, y, z;
+
+            ROOT::Math::XYZPoint get(size_t index) const { return {(*x)[index], (*y)[index], (*z)[index]}; }
+            template <typename F> void for_each(const std::string& name, F&& function) {
+                function(name + "_x", x);
+                function(name + "_y", y);
+                function(name + "_z", z);
+            }
+        };
+
+        /**
+         * @brief Columns of the properties of Monte-Carlo particles
+         */
+        struct MCParticleColumns {
+            PointColumns local_start_point, global_start_point, local_end_point, global_end_point;
+            Column<int> particle_id;
+            Column<double> time;
+            Column<int> parent;
+
+            template <typename F> void for_each(F&& function) {
+                local_start_point.for_each("local_start_point", function);
+                global_start_point.for_each("global_start_point", function);
+                local_end_point.for_each("local_end_point", function);
+                global_end_point.for_each("global_end_point", function);
+                function("particle_id", particle_id);
+                function("time", time);
+                function("parent", parent);
+            }
+        };
+
+        /**
+         * @brief Columns of the properties of sets of charges in the sensor, linked to the object they originate from
+         */
+        struct SensorChargeColumns {
+            PointColumns local_position, global_position;
+            Column<int> type;
+            Column<unsigned int> charge;
+            Column<double> event_time;
+            Column<int> origin;
+
+            explicit SensorChargeColumns(std::string origin_name) : origin_name_(std::move(origin_name)) {}
+            template <typename F> void for_each(F&& function) {
+                local_position.for_each("local_position", function);
+                global_position.for_each("global_position", function);
+                function("type", type);
+                function("charge", charge);
+                function("event_time", event_time);
+                function(origin_name_, origin);
+            }
+
+        private:
+            std::string origin_name_;
+        };
+
+        /**
+         * @brief Columns of the properties of pixel charges, with the indices of the related objects of all pixel charges
+         */
+        struct PixelChargeColumns {
+            Column<unsigned int> pixel_x, pixel_y;
+            Column<unsigned int> charge;
+            Column<unsigned int> propagated_charges_count;
+            Column<int> propagated_charges;
+            Column<unsigned int> mcparticles_count;
+            Column<int> mcparticles;
+
+            template <typename F> void for_each(F&& function) {
+                function("pixel_x", pixel_x);
+                function("pixel_y", pixel_y);
+                function("charge", charge);
+                function("propagated_charges_count", propagated_charges_count);
+                function("propagated_charges", propagated_charges);
+                function("mcparticles_count", mcparticles_count);
+                function("mcparticles", mcparticles);
+            }
+        };
+
+        /**
+         * @brief Columns of the properties of pixel hits
+         */
+        struct PixelHitColumns {
+            Column<unsigned int> pixel_x, pixel_y;
+            Column<double> time;
+            Column<double> signal;
+            Column<int> pixel_charge;
+
+            template <typename F> void for_each(F&& function) {
+                function("pixel_x", pixel_x);
+                function("pixel_y", pixel_y);
+                function("time", time);
+                function("signal", signal);
+                function("pixel_charge", pixel_charge);
+            }
+        };
+
+        /**
+         * @brief Columns of all objects of a single detector, the columns of object types not stored are not bound
+         */
+        struct DetectorColumns {
+            std::shared_ptr<Detector> detector;
+
+            MCParticleColumns mcparticles;
+            SensorChargeColumns deposited_charges{"mcparticle"};
+            SensorChargeColumns propagated_charges{"deposited_charge"};
+            PixelChargeColumns pixel_charges;
+            PixelHitColumns pixel_hits;
+
+            /**
+             * @brief Call a function for the columns of all object types
+             * @param function Function called with the name of the object type and its columns
+             */
+            template <typename F> void for_each_type(F&& function) {
+                function("MCParticle", mcparticles);
+                function("DepositedCharge", deposited_charges);
+                function("PropagatedCharge", propagated_charges);
+                function("PixelCharge", pixel_charges);
+                function("PixelHit", pixel_hits);
+            }
+        };
+
+        /**
+         * @brief Create and dispatch the objects of a single detector
+         * @param columns Columns of the detector
+         */
+        void read_detector(DetectorColumns& columns);
+
+        GeometryManager* geo_manager_;
+        Messenger* messenger_;
+
+        std::unique_ptr<TFile> input_file_;
+        std::map<std::string, std::unique_ptr<TTreeReader>> tree_readers_;
+        std::vector<std::unique_ptr<DetectorColumns>> columns_;
+
+        unsigned long read_cnt_{};
+    };
+} // namespace allpix
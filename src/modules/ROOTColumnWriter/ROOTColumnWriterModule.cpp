@@ -0,0 +1,331 @@
+/**
+ * @file
+ * @brief Implementation of ROOT columnar data file writer module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ROOTColumnWriterModule.hpp"
+
+#include <string>
+#include <utility>
+
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+#include "objects/exceptions.h"
+
+using namespace allpix;
+
+namespace {
+    // Get a related object, returning a null pointer if it is not in scope
+    template <typename F> const Object* get_related_object(F&& getter) {
+        try {
+            return getter();
+        } catch(MissingReferenceException&) {
+            return nullptr;
+        }
+    }
+} // namespace
+
+ROOTColumnWriterModule::ROOTColumnWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
+    : Module(config), geo_manager_(geo_manager), messenger_(messenger) {
+    // Writing can be executed in parallel to the other modules which process the events in order
+    enable_dedicated_thread();
+    // The trees are written to a file of this module only, which allows finalizing it together with other modules
+    enable_parallel_finalization();
+
+    config_.setDefault<std::string>("file_name", "columns");
+    config_.setDefaultArray<std::string>("include",
+                                         {"MCParticle", "DepositedCharge", "PropagatedCharge", "PixelCharge", "PixelHit"});
+
+    // Only listen to the included objects, such that no other objects are created for this module
+    for(auto& name : config_.getArray<std::string>("include")) {
+        if(name == "MCParticle") {
+            messenger_->bindMulti(this, &ROOTColumnWriterModule::mcparticle_messages_, MsgFlags::IGNORE_NAME);
+        } else if(name == "DepositedCharge") {
+            messenger_->bindMulti(this, &ROOTColumnWriterModule::deposited_charge_messages_, MsgFlags::IGNORE_NAME);
+        } else if(name == "PropagatedCharge") {
+            messenger_->bindMulti(this, &ROOTColumnWriterModule::propagated_charge_messages_, MsgFlags::IGNORE_NAME);
+            messenger_->bindMulti(
+                this, &ROOTColumnWriterModule::propagated_charge_array_messages_, MsgFlags::IGNORE_NAME);
+        } else if(name == "PixelCharge") {
+            messenger_->bindMulti(this, &ROOTColumnWriterModule::pixel_charge_messages_, MsgFlags::IGNORE_NAME);
+        } else if(name == "PixelHit") {
+            messenger_->bindMulti(this, &ROOTColumnWriterModule::pixel_hit_messages_, MsgFlags::IGNORE_NAME);
+        } else {
+            throw InvalidValueError(config_,
+                                    "include",
+                                    "object " + name +
+                                        " cannot be stored in columns, possible objects are MCParticle, DepositedCharge, "
+                                        "PropagatedCharge, PixelCharge and PixelHit");
+        }
+        include_.insert(name);
+    }
+}
+
+void ROOTColumnWriterModule::init() {
+    // Create output file
+    output_file_name_ =
+        createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name"), "root"), true);
+    output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "RECREATE");
+    output_file_->cd();
+
+    // Create one tree for every included object type
+    for(auto& name : include_) {
+        trees_.emplace(name, std::make_unique<TTree>(name.c_str(), ("Columns of " + name).c_str()));
+    }
+
+    // Create the branches of all detectors upfront, such that every tree has the same branches in every event
+    auto basket_size = config_.get<int>("basket_size", 32000);
+    if(basket_size <= 0) {
+        throw InvalidValueError(config_, "basket_size", "basket size should be larger than zero");
+    }
+    for(auto& detector : geo_manager_->getDetectors()) {
+        auto detector_name = detector->getName();
+        auto& columns = columns_[detector_name];
+        columns.for_each_type([&](const std::string& type_name, auto& type_columns) {
+            auto tree = trees_.find(type_name);
+            if(tree == trees_.end()) {
+                return;
+            }
+            type_columns.for_each([&](const std::string& column_name, auto& column) {
+                tree->second->Branch((detector_name + "_" + column_name).c_str(), &column, basket_size);
+                ++column_cnt_;
+            });
+        });
+    }
+}
+
+void ROOTColumnWriterModule::run(unsigned int) {
+    // Fetch the messages of the current event
+    auto mcparticle_messages = messenger_->fetchMultiMessage<MCParticleMessage>(this);
+    auto deposited_charge_messages = messenger_->fetchMultiMessage<DepositedChargeMessage>(this);
+    auto propagated_charge_messages = messenger_->fetchMultiMessage<PropagatedChargeMessage>(this);
+    auto propagated_charge_array_messages = messenger_->fetchMultiMessage<PropagatedChargeArrayMessage>(this);
+    auto pixel_charge_messages = messenger_->fetchMultiMessage<PixelChargeMessage>(this);
+    auto pixel_hit_messages = messenger_->fetchMultiMessage<PixelHitMessage>(this);
+
+    // Get the columns of the detector of a message
+    auto get_columns = [&](const BaseMessage& message) -> DetectorColumns* {
+        if(message.getDetector() == nullptr) {
+            LOG(TRACE) << "Ignoring message without detector";
+            return nullptr;
+        }
+        return &columns_.at(message.getDetector()->getName());
+    };
+
+    // Add the objects in the order of their relations, such that all related objects have been added before
+    for(auto& message : mcparticle_messages) {
+        auto* columns = get_columns(*message);
+        if(columns != nullptr) {
+            add_mcparticles(*columns, message->getData());
+        }
+    }
+    for(auto& message : deposited_charge_messages) {
+        auto* columns = get_columns(*message);
+        if(columns != nullptr) {
+            add_deposited_charges(*columns, message->getData());
+        }
+    }
+    for(auto& message : propagated_charge_messages) {
+        auto* columns = get_columns(*message);
+        if(columns != nullptr) {
+            add_propagated_charges(*columns, message->getData());
+        }
+    }
+    for(auto& message : propagated_charge_array_messages) {
+        auto* columns = get_columns(*message);
+        if(columns != nullptr) {
+            add_propagated_charges(*columns, *message);
+        }
+    }
+    for(auto& message : pixel_charge_messages) {
+        auto* columns = get_columns(*message);
+        if(columns != nullptr) {
+            add_pixel_charges(*columns, message->getData());
+        }
+    }
+    for(auto& message : pixel_hit_messages) {
+        auto* columns = get_columns(*message);
+        if(columns != nullptr) {
+            add_pixel_hits(*columns, message->getData());
+        }
+    }
+
+    LOG(TRACE) << "Writing new objects to tree";
+    for(auto& tree : trees_) {
+        tree.second->Fill();
+    }
+
+    // Clear the columns, keeping their memory for the next event
+    for(auto& detector_columns : columns_) {
+        detector_columns.second.for_each_type([](const std::string&, auto& type_columns) {
+            type_columns.for_each([](const std::string&, auto& column) { column.clear(); });
+        });
+        detector_columns.second.indices.clear();
+    }
+}
+
+int ROOTColumnWriterModule::get_index(const DetectorColumns& columns, const Object* object) {
+    if(object == nullptr) {
+        return -1;
+    }
+    auto index = columns.indices.find(object);
+    return (index != columns.indices.end() ? index->second : -1);
+}
+
+void ROOTColumnWriterModule::add_mcparticles(DetectorColumns& columns, const std::vector<MCParticle>& mcparticles) {
+    auto& mcp = columns.mcparticles;
+    for(auto& mcparticle : mcparticles) {
+        columns.indices[&mcparticle] = static_cast<int>(mcp.particle_id.size());
+        mcp.local_start_point.push_back(mcparticle.getLocalStartPoint());
+        mcp.global_start_point.push_back(mcparticle.getGlobalStartPoint());
+        mcp.local_end_point.push_back(mcparticle.getLocalEndPoint());
+        mcp.global_end_point.push_back(mcparticle.getGlobalEndPoint());
+        mcp.particle_id.push_back(mcparticle.getParticleID());
+        mcp.time.push_back(mcparticle.getTime());
+    }
+
+    // Parents can be listed after their secondaries, only link them once all particles of the message are indexed
+    for(auto& mcparticle : mcparticles) {
+        mcp.parent.push_back(has_object_history() ? get_index(columns, mcparticle.getParent()) : -1);
+    }
+    write_cnt_ += mcparticles.size();
+}
+
+void ROOTColumnWriterModule::add_deposited_charges(DetectorColumns& columns,
+                                                   const std::vector<DepositedCharge>& deposited_charges) {
+    auto& deposits = columns.deposited_charges;
+    for(auto& deposit : deposited_charges) {
+        columns.indices[&deposit] = static_cast<int>(deposits.charge.size());
+        deposits.local_position.push_back(deposit.getLocalPosition());
+        deposits.global_position.push_back(deposit.getGlobalPosition());
+        deposits.type.push_back(static_cast<int>(deposit.getType()));
+        deposits.charge.push_back(deposit.getCharge());
+        deposits.event_time.push_back(deposit.getEventTime());
+        deposits.origin.push_back(
+            has_object_history()
+                ? get_index(columns, get_related_object([&]() { return deposit.getMCParticle(); }))
+                : -1);
+    }
+    write_cnt_ += deposited_charges.size();
+}
+
+void ROOTColumnWriterModule::add_propagated_charges(DetectorColumns& columns,
+                                                    const std::vector<PropagatedCharge>& propagated_charges) {
+    auto& propagated = columns.propagated_charges;
+    for(auto& propagated_charge : propagated_charges) {
+        columns.indices[&propagated_charge] = static_cast<int>(propagated.charge.size());
+        propagated.local_position.push_back(propagated_charge.getLocalPosition());
+        propagated.global_position.push_back(propagated_charge.getGlobalPosition());
+        propagated.type.push_back(static_cast<int>(propagated_charge.getType()));
+        propagated.charge.push_back(propagated_charge.getCharge());
+        propagated.event_time.push_back(propagated_charge.getEventTime());
+        propagated.origin.push_back(
+            has_object_history()
+                ? get_index(columns, get_related_object([&]() { return propagated_charge.getDepositedCharge(); }))
+                : -1);
+    }
+    write_cnt_ += propagated_charges.size();
+}
+
+/**
+ * The columns of the array are appended directly, only the global positions are computed if they have been deferred. The
+ * sets of the array are not linked from pixel charges, which refer to the deposited charges instead.
+ */
+void ROOTColumnWriterModule::add_propagated_charges(DetectorColumns& columns, const PropagatedChargeArrayMessage& message) {
+    const auto& data = message.getData();
+    auto& propagated = columns.propagated_charges;
+    auto append = [](auto& column, const auto& values) { column.insert(column.end(), values.begin(), values.end()); };
+
+    append(propagated.local_position.x, data.getLocalX());
+    append(propagated.local_position.y, data.getLocalY());
+    append(propagated.local_position.z, data.getLocalZ());
+    if(data.hasGlobalPositions()) {
+        append(propagated.global_position.x, data.getGlobalX());
+        append(propagated.global_position.y, data.getGlobalY());
+        append(propagated.global_position.z, data.getGlobalZ());
+    } else {
+        std::vector<double> global_x, global_y, global_z;
+        message.getDetector()->getGlobalPositions(
+            data.getLocalX(), data.getLocalY(), data.getLocalZ(), global_x, global_y, global_z);
+        append(propagated.global_position.x, global_x);
+        append(propagated.global_position.y, global_y);
+        append(propagated.global_position.z, global_z);
+    }
+    for(auto type : data.getTypes()) {
+        propagated.type.push_back(static_cast<int>(type));
+    }
+    append(propagated.charge, data.getCharges());
+    append(propagated.event_time, data.getEventTimes());
+    for(auto* deposit : data.getDepositedCharges()) {
+        propagated.origin.push_back(has_object_history() ? get_index(columns, deposit) : -1);
+    }
+    write_cnt_ += data.size();
+}
+
+void ROOTColumnWriterModule::add_pixel_charges(DetectorColumns& columns, const std::vector<PixelCharge>& pixel_charges) {
+    auto& charges = columns.pixel_charges;
+    for(auto& pixel_charge : pixel_charges) {
+        columns.indices[&pixel_charge] = static_cast<int>(charges.charge.size());
+        charges.pixel_x.push_back(pixel_charge.getIndex().x());
+        charges.pixel_y.push_back(pixel_charge.getIndex().y());
+        charges.charge.push_back(pixel_charge.getCharge());
+
+        // Store the related objects which are written in this event
+        unsigned int propagated_charges_count = 0;
+        unsigned int mcparticles_count = 0;
+        if(has_object_history()) {
+            try {
+                for(auto* propagated_charge : pixel_charge.getPropagatedCharges()) {
+                    auto index = get_index(columns, propagated_charge);
+                    if(index >= 0) {
+                        charges.propagated_charges.push_back(index);
+                        ++propagated_charges_count;
+                    }
+                }
+                for(auto* mcparticle : pixel_charge.getMCParticles()) {
+                    auto index = get_index(columns, mcparticle);
+                    if(index >= 0) {
+                        charges.mcparticles.push_back(index);
+                        ++mcparticles_count;
+                    }
+                }
+            } catch(MissingReferenceException&) {
+                LOG(TRACE) << "Related objects of pixel charge are not in scope";
+            }
+        }
+        charges.propagated_charges_count.push_back(propagated_charges_count);
+        charges.mcparticles_count.push_back(mcparticles_count);
+    }
+    write_cnt_ += pixel_charges.size();
+}
+
+void ROOTColumnWriterModule::add_pixel_hits(DetectorColumns& columns, const std::vector<PixelHit>& pixel_hits) {
+    auto& hits = columns.pixel_hits;
+    for(auto& pixel_hit : pixel_hits) {
+        hits.pixel_x.push_back(pixel_hit.getIndex().x());
+        hits.pixel_y.push_back(pixel_hit.getIndex().y());
+        hits.time.push_back(pixel_hit.getTime());
+        hits.signal.push_back(pixel_hit.getSignal());
+        hits.pixel_charge.push_back(
+            has_object_history() ? get_index(columns, get_related_object([&]() { return pixel_hit.getPixelCharge(); }))
+                                 : -1);
+    }
+    write_cnt_ += pixel_hits.size();
+}
+
+void ROOTColumnWriterModule::finalize() {
+    LOG(TRACE) << "Writing trees to file";
+    output_file_->cd();
+    for(auto& tree : trees_) {
+        tree.second->Write();
+    }
+    output_file_->Close();
+
+    // Print statistics
+    LOG(STATUS) << "Wrote " << write_cnt_ << " objects to " << column_cnt_ << " columns in file:" << std::endl
+                << output_file_name_;
+}
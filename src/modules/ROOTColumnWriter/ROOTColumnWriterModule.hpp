@@ -0,0 +1,232 @@
+/**
+ * @file
+ * @brief Definition of ROOT columnar data file writer module
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+#include "objects/PropagatedCharge.hpp"
+#include "objects/PropagatedChargeArray.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write the core objects to flat columns in ROOT trees
+     *
+     * Every property of the objects is stored in a separate branch holding a plain vector of numbers per event, one tree
+     * per object type and one set of branches per detector. Relations between objects are stored as indices of the related
+     * objects in the same event and detector, such that the file can be read without the object dictionaries.
+     */
+    class ROOTColumnWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_manager Pointer to the geometry manager, containing the detectors
+         */
+        ROOTColumnWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_manager);
+
+        /**
+         * @brief Create the output file and the branches of all detectors
+         */
+        void init() override;
+
+        /**
+         * @brief Convert the objects of the event to columns and fill the trees
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Write the trees to the output file
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Columns of the three coordinates of a point
+         */
+        struct PointColumns {
+            std::vector<double> x, y, z;
+
+            void push_back(const ROOT::Math::XYZPoint& point) {
+                x.push_back(point.x());
+                y.push_back(point.y());
+                z.push_back(point.z());
+            }
+            template <typename F> void for_each(const std::string& name, F&& function) {
+                function(name + "_x", x);
+                function(name + "_y", y);
+                function(name + "_z", z);
+            }
+        };
+
+        /**
+         * @brief Columns of the properties of Monte-Carlo particles
+         */
+        struct MCParticleColumns {
+            PointColumns local_start_point, global_start_point, local_end_point, global_end_point;
+            std::vector<int> particle_id;
+            std::vector<double> time;
+            std::vector<int> parent;
+
+            template <typename F> void for_each(F&& function) {
+                local_start_point.for_each("local_start_point", function);
+                global_start_point.for_each("global_start_point", function);
+                local_end_point.for_each("local_end_point", function);
+                global_end_point.for_each("global_end_point", function);
+                function("particle_id", particle_id);
+                function("time", time);
+                function("parent", parent);
+            }
+        };
+
+        /**
+         * @brief Columns of the properties of sets of charges in the sensor, linked to the object they originate from
+         */
+        struct SensorChargeColumns {
+            PointColumns local_position, global_position;
+            std::vector<int> type;
+            std::vector<unsigned int> charge;
+            std::vector<double> event_time;
+            std::vector<int> origin;
+
+            explicit SensorChargeColumns(std::string origin_name) : origin_name_(std::move(origin_name)) {}
+            template <typename F> void for_each(F&& function) {
+                local_position.for_each("local_position", function);
+                global_position.for_each("global_position", function);
+                function("type", type);
+                function("charge", charge);
+                function("event_time", event_time);
+                function(origin_name_, origin);
+            }
+
+        private:
+            std::string origin_name_;
+        };
+
+        /**
+         * @brief Columns of the properties of pixel charges, the related objects are stored as list of indices for all
+         * pixel charges together with the number of indices of every pixel charge
+         */
+        struct PixelChargeColumns {
+            std::vector<unsigned int> pixel_x, pixel_y;
+            std::vector<unsigned int> charge;
+            std::vector<unsigned int> propagated_charges_count;
+            std::vector<int> propagated_charges;
+            std::vector<unsigned int> mcparticles_count;
+            std::vector<int> mcparticles;
+
+            template <typename F> void for_each(F&& function) {
+                function("pixel_x", pixel_x);
+                function("pixel_y", pixel_y);
+                function("charge", charge);
+                function("propagated_charges_count", propagated_charges_count);
+                function("propagated_charges", propagated_charges);
+                function("mcparticles_count", mcparticles_count);
+                function("mcparticles", mcparticles);
+            }
+        };
+
+        /**
+         * @brief Columns of the properties of pixel hits
+         */
+        struct PixelHitColumns {
+            std::vector<unsigned int> pixel_x, pixel_y;
+            std::vector<double> time;
+            std::vector<double> signal;
+            std::vector<int> pixel_charge;
+
+            template <typename F> void for_each(F&& function) {
+                function("pixel_x", pixel_x);
+                function("pixel_y", pixel_y);
+                function("time", time);
+                function("signal", signal);
+                function("pixel_charge", pixel_charge);
+            }
+        };
+
+        /**
+         * @brief Columns of all objects of a single detector
+         */
+        struct DetectorColumns {
+            MCParticleColumns mcparticles;
+            SensorChargeColumns deposited_charges{"mcparticle"};
+            SensorChargeColumns propagated_charges{"deposited_charge"};
+            PixelChargeColumns pixel_charges;
+            PixelHitColumns pixel_hits;
+
+            // Index of every object written in the current event, used to link related objects
+            std::unordered_map<const Object*, int> indices;
+
+            /**
+             * @brief Call a function for the columns of all object types
+             * @param function Function called with the name of the object type and its columns
+             */
+            template <typename F> void for_each_type(F&& function) {
+                function("MCParticle", mcparticles);
+                function("DepositedCharge", deposited_charges);
+                function("PropagatedCharge", propagated_charges);
+                function("PixelCharge", pixel_charges);
+                function("PixelHit", pixel_hits);
+            }
+        };
+
+        /**
+         * @brief Get the index of a related object written in the current event
+         * @param columns Columns of the detector of the object
+         * @param object Related object, can be a null pointer
+         * @return Index of the related object, or -1 if it is not stored
+         */
+        static int get_index(const DetectorColumns& columns, const Object* object);
+
+        void add_mcparticles(DetectorColumns& columns, const std::vector<MCParticle>& mcparticles);
+        void add_deposited_charges(DetectorColumns& columns, const std::vector<DepositedCharge>& deposited_charges);
+        void add_propagated_charges(DetectorColumns& columns, const std::vector<PropagatedCharge>& propagated_charges);
+        void add_propagated_charges(DetectorColumns& columns, const PropagatedChargeArrayMessage& message);
+        void add_pixel_charges(DetectorColumns& columns, const std::vector<PixelCharge>& pixel_charges);
+        void add_pixel_hits(DetectorColumns& columns, const std::vector<PixelHit>& pixel_hits);
+
+        GeometryManager* geo_manager_;
+        Messenger* messenger_;
+
+        std::set<std::string> include_;
+
+        std::vector<std::shared_ptr<MCParticleMessage>> mcparticle_messages_;
+        std::vector<std::shared_ptr<DepositedChargeMessage>> deposited_charge_messages_;
+        std::vector<std::shared_ptr<PropagatedChargeMessage>> propagated_charge_messages_;
+        std::vector<std::shared_ptr<PropagatedChargeArrayMessage>> propagated_charge_array_messages_;
+        std::vector<std::shared_ptr<PixelChargeMessage>> pixel_charge_messages_;
+        std::vector<std::shared_ptr<PixelHitMessage>> pixel_hit_messages_;
+
+        std::string output_file_name_;
+        std::unique_ptr<TFile> output_file_;
+        std::map<std::string, std::unique_ptr<TTree>> trees_;
+        std::map<std::string, DetectorColumns> columns_;
+
+        unsigned long write_cnt_{};
+        int column_cnt_{};
+    };
+} // namespace allpix
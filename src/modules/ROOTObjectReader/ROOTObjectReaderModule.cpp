@@ -9,14 +9,21 @@
 
 #include "ROOTObjectReaderModule.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <TBranch.h>
+#include <TClass.h>
+#include <TEnv.h>
 #include <TKey.h>
 #include <TObjArray.h>
 #include <TProcessID.h>
+#include <TROOT.h>
 #include <TTree.h>
 
 #include "core/messenger/Messenger.hpp"
@@ -117,95 +124,113 @@ void ROOTObjectReaderModule::init() {
     // Initialize the call map from the tuple of available objects
     message_creator_map_ = gen_creator_map<allpix::OBJECTS>();
 
-    // Open the file with the objects
-    auto input_file_name = config_.getPathWithExtension("file_name", "root", true);
-    input_file_ = std::make_unique<TFile>(input_file_name.c_str());
-
-    // Read all the trees in the file
-    TList* keys = input_file_->GetListOfKeys();
-    std::set<std::string> tree_names;
-
-    for(auto&& object : *keys) {
-        auto& key = dynamic_cast<TKey&>(*object);
-        if(std::string(key.GetClassName()) == "TTree") {
-            auto tree = static_cast<TTree*>(key.ReadObjectAny(nullptr));
-
-            // Check if a version of this tree has already been read
-            if(tree_names.find(tree->GetName()) != tree_names.end()) {
-                LOG(TRACE) << "Skipping copy of tree with name " << tree->GetName()
-                           << " because one with identical name has already been processed";
-                continue;
-            }
-            tree_names.insert(tree->GetName());
-
-            // Check if this tree should be used
-            if((!include_.empty() && include_.find(tree->GetName()) == include_.end()) ||
-               (!exclude_.empty() && exclude_.find(tree->GetName()) != exclude_.end())) {
-                LOG(TRACE) << "Ignoring tree with " << tree->GetName()
-                           << " objects because it has been excluded or not explicitly included";
-                continue;
-            }
+    // Read the baskets of the following entries ahead in a background thread of ROOT
+    if(config_.get<bool>("async_prefetch", false)) {
+        gEnv->SetValue("TFile.AsyncPrefetching", 1);
+    }
 
-            trees_.push_back(tree);
+    // Collect the input files from the list of files and wildcard patterns
+    std::vector<file_info> files;
+    for(auto& pattern : config_.getPathArray("file_name")) {
+        auto matches = allpix::get_files_matching(allpix::add_file_extension(pattern, "root"));
+        if(matches.empty()) {
+            throw InvalidValueError(config_, "file_name", "no file matches the pattern " + pattern);
+        }
+        for(auto& match : matches) {
+            file_info info;
+            info.path = match;
+            files.push_back(std::move(info));
         }
     }
 
-    if(trees_.empty()) {
-        LOG(ERROR) << "Provided ROOT file does not contain any trees, module will not read any data";
+    // Open the files and read their metadata in parallel, the files are reopened by the chains when they are read
+    auto open_threads = std::min<size_t>(files.size(), std::max(1u, std::thread::hardware_concurrency()));
+    if(open_threads > 1) {
+        ROOT::EnableThreadSafety();
+    }
+    std::atomic<size_t> next_file{0};
+    auto open_files = [&]() {
+        for(auto i = next_file++; i < files.size(); i = next_file++) {
+            read_file_info(files[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < open_threads; ++i) {
+        threads.emplace_back(open_files);
+    }
+    open_files();
+    for(auto& thread : threads) {
+        thread.join();
     }
 
-    // Cross-check the core random seed stored in the file with the one configured:
-    auto& global_config = getConfigManager()->getGlobalConfiguration();
-    auto config_seed = global_config.get<uint64_t>("random_seed_core");
+    // Check that all files contain the same trees and match the configuration
+    for(auto& info : files) {
+        if(!info.error.empty()) {
+            throw InvalidValueError(config_, "file_name", "could not read file " + info.path + ": " + info.error);
+        }
+        const auto& first_trees = files.front().trees;
+        auto same_trees = std::equal(info.trees.begin(),
+                                     info.trees.end(),
+                                     first_trees.begin(),
+                                     first_trees.end(),
+                                     [](const auto& a, const auto& b) { return a.first == b.first; });
+        if(!same_trees) {
+            throw InvalidValueError(config_,
+                                    "file_name",
+                                    "file " + info.path + " does not contain the same trees as file " + files.front().path);
+        }
+        check_file_info(info);
+    }
 
-    std::string* str = nullptr;
-    input_file_->GetObject("config/Allpix/random_seed_core", str);
+    // Chain the trees of all files, the entries of the files are already known such that they are not opened again here
+    for(size_t tree_idx = 0; tree_idx < files.front().trees.size(); ++tree_idx) {
+        const auto& tree_name = files.front().trees[tree_idx].first;
+        chains_.push_back(std::make_unique<TChain>(tree_name.c_str()));
+        auto* tree = chains_.back().get();
+        for(auto& info : files) {
+            tree->Add(info.path.c_str(), info.trees[tree_idx].second);
+        }
 
-    if(str == nullptr) {
-        // check if missing random seed core in config file should be ignored
-        if(config_.get<bool>("ignore_seed_mismatch", false)) {
-            LOG(WARNING) << "No random seed for core set in the input data file, cross-check with configured value - "
-                         << "this might lead to unexpected behavior. Random seed core from the input data is used.";
-        } else {
-            throw InvalidValueError(global_config,
-                                    "random_seed_core",
-                                    "no random seed for core set in the input data file, cross-check with configured value "
-                                    "impossible - this might lead to unexpected behavior.");
+        // The event weights are not objects, they are applied to the events read
+        if(tree_name == "Event") {
+            LOG(DEBUG) << "Reading event weights from file";
+            weight_tree_ = tree;
+            weight_tree_->SetBranchAddress("weight", &weight_);
+            continue;
         }
-    } else if(config_seed != allpix::from_string<uint64_t>(*str)) {
-        // check if mismatch between random seed core in config and in input file should be ignored
-        if(config_.get<bool>("ignore_seed_mismatch", false)) {
-            LOG(WARNING) << "Mismatch between core random seed in configuration file and input data"
-                         << " - this might lead to unexpected behavior.";
-        } else {
-            throw InvalidValueError(global_config,
-                                    "random_seed_core",
-                                    "mismatch between core random seed in configuration file and input data - this "
-                                    "might lead to unexpected behavior. Set to value configured in the input data file: " +
-                                        (*str));
+
+        // Check if this tree should be used
+        if((!include_.empty() && include_.find(tree_name) == include_.end()) ||
+           (!exclude_.empty() && exclude_.find(tree_name) != exclude_.end())) {
+            LOG(TRACE) << "Ignoring tree with " << tree_name
+                       << " objects because it has been excluded or not explicitly included";
+            continue;
         }
+
+        trees_.push_back({tree});
     }
+    LOG(INFO) << "Chained the trees of " << files.size() << " input files";
 
-    // Cross-check version, print warning only in case of a mismatch:
-    std::string* version_str = nullptr;
-    input_file_->GetObject("config/Allpix/version", version_str);
-    if(version_str != nullptr && allpix::from_string<std::string>(*version_str) != ALLPIX_PROJECT_VERSION) {
-        LOG(WARNING) << "Reading data produced with different version " << (*version_str)
-                     << " - this might lead to unexpected behavior.";
+    if(trees_.empty()) {
+        LOG(ERROR) << "Provided ROOT file does not contain any trees, module will not read any data";
     }
 
     // Loop over all found trees
-    for(auto& tree : trees_) {
+    auto skip_unused_objects = config_.get<bool>("skip_unused_objects", false);
+    for(auto& info : trees_) {
+        auto* tree = info.tree;
+        std::vector<std::string> read_branches;
+
         // Loop over the list of branches and create the set of receiver objects
         TObjArray* branches = tree->GetListOfBranches();
         for(int i = 0; i < branches->GetEntries(); i++) {
             auto* branch = static_cast<TBranch*>(branches->At(i));
 
-            // Add a new vector of objects and bind it to the branch
+            // Add a new vector of objects, which is bound to the branch once it is known to be read
             message_info message_inf;
             message_inf.objects = new std::vector<Object*>;
+            message_inf.tree = &info;
             message_info_array_.emplace_back(message_inf);
-            branch->SetAddress(&(message_info_array_.back().objects));
 
             // Fill the rest of the message information
             // FIXME: we want to index this in a different way
@@ -232,6 +257,7 @@ void ROOTObjectReaderModule::init() {
                 throw ModuleError("Tree is malformed and cannot be used for creating messages");
             }
             std::string class_name = split_type[1].substr(0, split_type[1].size() - 1);
+            std::string full_class_name = class_name;
             std::string apx_namespace = "allpix::";
             size_t ap_idx = class_name.find(apx_namespace);
             if(ap_idx != std::string::npos) {
@@ -249,22 +275,185 @@ void ROOTObjectReaderModule::init() {
                     message_info_array_.back().detector = geo_mgr_->getDetector(split[det_idx]);
                 }
             }
+
+            // Do not read the branch if its objects cannot be dispatched or nobody is listening to the messages
+            auto* cls = TClass::GetClass(full_class_name.c_str());
+            bool registered = (cls != nullptr && cls->GetTypeInfo() != nullptr &&
+                               message_creator_map_.find(*cls->GetTypeInfo()) != message_creator_map_.end());
+            if(!registered || (skip_unused_objects && !has_receiver(full_class_name,
+                                                                     message_info_array_.back().detector,
+                                                                     message_info_array_.back().name))) {
+                LOG(DEBUG) << "Skipping branch " << branch_name << " of " << class_name << " objects because "
+                           << (registered ? "its messages have no receivers" : "they are not registered for messaging");
+                tree->SetBranchStatus(branch_name.c_str(), false);
+                delete message_info_array_.back().objects;
+                message_info_array_.pop_back();
+                continue;
+            }
+
+            // Bind the branch through the chain, such that the address is kept for the trees of all files
+            tree->SetBranchAddress(branch_name.c_str(), static_cast<void*>(&(message_info_array_.back().objects)));
+            read_branches.push_back(branch_name);
+        }
+
+        // Do not read the entries of trees without any branch to read
+        info.read = !read_branches.empty();
+        if(!info.read) {
+            LOG(DEBUG) << "Not reading tree " << tree->GetName() << " because none of its branches is read";
+            continue;
+        }
+
+        // Cache the baskets of all branches read, skipping the learning phase of the cache
+        if(config_.has("cache_size")) {
+            tree->SetCacheSize(config_.get<long long>("cache_size"));
+            for(auto& branch_name : read_branches) {
+                tree->AddBranchToCache(branch_name.c_str(), true);
+            }
+            tree->StopCacheLearningPhase();
+        }
+    }
+
+    // Read the entries of the next event while the current event is processed, opening the next file when needed
+    read_ahead_ = config_.get<bool>("read_ahead", false);
+    if(read_ahead_) {
+        ROOT::EnableThreadSafety();
+        LOG(DEBUG) << "Reading the entries of the next event asynchronously";
+        enable_async_tasks(1);
+    }
+}
+
+void ROOTObjectReaderModule::read_file_info(file_info& info) {
+    TFile file(info.path.c_str(), "READ");
+    if(file.IsZombie() || !file.IsOpen()) {
+        info.error = "file cannot be opened";
+        return;
+    }
+
+    // Read the number of entries of all trees in the file
+    for(auto&& object : *file.GetListOfKeys()) {
+        auto& key = dynamic_cast<TKey&>(*object);
+        if(std::string(key.GetClassName()) != "TTree") {
+            continue;
+        }
+
+        // Only the first version of a tree is used
+        std::string tree_name = key.GetName();
+        if(std::any_of(info.trees.begin(), info.trees.end(), [&](auto& tree) { return tree.first == tree_name; })) {
+            continue;
+        }
+        auto* tree = static_cast<TTree*>(key.ReadObjectAny(nullptr));
+        info.trees.emplace_back(tree_name, tree->GetEntries());
+    }
+
+    std::string* str = nullptr;
+    file.GetObject("config/Allpix/random_seed_core", str);
+    info.random_seed_core.reset(str);
+    str = nullptr;
+    file.GetObject("config/Allpix/version", str);
+    info.version.reset(str);
+    file.Close();
+}
+
+void ROOTObjectReaderModule::check_file_info(const file_info& info) {
+    LOG(DEBUG) << "Checking metadata of input file " << info.path;
+
+    // Cross-check the core random seed stored in the file with the one configured:
+    auto& global_config = getConfigManager()->getGlobalConfiguration();
+    auto config_seed = global_config.get<uint64_t>("random_seed_core");
+
+    const auto* str = info.random_seed_core.get();
+    if(str == nullptr) {
+        // check if missing random seed core in config file should be ignored
+        if(config_.get<bool>("ignore_seed_mismatch", false)) {
+            LOG(WARNING) << "No random seed for core set in the input data file, cross-check with configured value - "
+                         << "this might lead to unexpected behavior. Random seed core from the input data is used.";
+        } else {
+            throw InvalidValueError(global_config,
+                                    "random_seed_core",
+                                    "no random seed for core set in the input data file, cross-check with configured value "
+                                    "impossible - this might lead to unexpected behavior.");
+        }
+    } else if(config_seed != allpix::from_string<uint64_t>(*str)) {
+        // check if mismatch between random seed core in config and in input file should be ignored
+        if(config_.get<bool>("ignore_seed_mismatch", false)) {
+            LOG(WARNING) << "Mismatch between core random seed in configuration file and input data"
+                         << " - this might lead to unexpected behavior.";
+        } else {
+            throw InvalidValueError(global_config,
+                                    "random_seed_core",
+                                    "mismatch between core random seed in configuration file and input data - this "
+                                    "might lead to unexpected behavior. Set to value configured in the input data file: " +
+                                        (*str));
+        }
+    }
+
+    // Cross-check version, print warning only in case of a mismatch:
+    const auto* version_str = info.version.get();
+    if(version_str != nullptr && allpix::from_string<std::string>(*version_str) != ALLPIX_PROJECT_VERSION) {
+        LOG(WARNING) << "Reading data produced with different version " << (*version_str)
+                     << " - this might lead to unexpected behavior.";
+    }
+}
+
+bool ROOTObjectReaderModule::has_receiver(const std::string& class_name,
+                                          const std::shared_ptr<Detector>& detector,
+                                          const std::string& name) {
+    auto* cls = TClass::GetClass(class_name.c_str());
+    if(cls == nullptr || cls->GetTypeInfo() == nullptr) {
+        return true;
+    }
+    auto iter = message_creator_map_.find(*cls->GetTypeInfo());
+    if(iter == message_creator_map_.end()) {
+        return true;
+    }
+
+    // Check with an empty message of the same type and detector
+    auto message = iter->second(std::vector<Object*>(), detector);
+    return messenger_->hasReceiver(this, message, name);
+}
+
+void ROOTObjectReaderModule::read_entries(Long64_t entry) {
+    for(auto& info : trees_) {
+        if(!info.read) {
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto bytes = info.tree->GetEntry(entry);
+        info.read_time += std::chrono::steady_clock::now() - start;
+        if(bytes > 0) {
+            info.bytes += bytes;
         }
     }
+    if(weight_tree_ != nullptr && entry < weight_tree_->GetEntries()) {
+        weight_tree_->GetEntry(entry);
+    }
 }
 
 void ROOTObjectReaderModule::run(unsigned int event_num) {
     --event_num;
-    for(auto& tree : trees_) {
-        if(event_num >= tree->GetEntries()) {
+    for(auto& info : trees_) {
+        if(event_num >= info.tree->GetEntries()) {
             throw EndOfRunException("Requesting end of run because TTree only contains data for " +
                                     std::to_string(event_num) + " events");
         }
-        tree->GetEntry(event_num);
+    }
+
+    // Use the entries read ahead during the previous event if available
+    if(staged_entry_ >= 0) {
+        wait_async_tasks();
+    }
+    if(staged_entry_ != static_cast<Long64_t>(event_num)) {
+        read_entries(event_num);
+    }
+    staged_entry_ = -1;
+    if(weight_tree_ != nullptr && event_num < weight_tree_->GetEntries()) {
+        scaleEventWeight(weight_);
     }
     LOG(TRACE) << "Building messages from stored objects";
 
-    // Loop through all branches
+    // Loop through all branches, the messages are only dispatched once the objects of all branches have been copied
+    std::vector<std::pair<std::shared_ptr<BaseMessage>, const std::string*>> messages;
     for(const auto& message_inf : message_info_array_) {
         auto objects = message_inf.objects;
 
@@ -284,24 +473,56 @@ void ROOTObjectReaderModule::run(unsigned int event_num) {
 
         // Update statistics
         read_cnt_ += objects->size();
+        message_inf.tree->objects += objects->size();
 
         // Create a message
-        std::shared_ptr<BaseMessage> message = iter->second(*objects, message_inf.detector);
+        messages.emplace_back(iter->second(*objects, message_inf.detector), &message_inf.name);
+    }
+    if(messages.empty()) {
+        LOG(DEBUG) << "No objects stored in the input file for event " << (event_num + 1);
+    }
 
-        // Dispatch the message
-        messenger_->dispatchMessage(this, message, message_inf.name);
+    // Resolve the references between the objects of the event in a single pass, such that the objects do not resolve them
+    // whenever their history is accessed by the receiving modules
+    for(auto& message : messages) {
+        for(auto& object : message.first->getObjectArray()) {
+            object.get().resolveHistory();
+        }
+    }
+
+    // Dispatch the messages
+    for(auto& message : messages) {
+        messenger_->dispatchMessage(this, message.first, *message.second);
+    }
+
+    // Read the next event while the current one is processed, the objects of this event have been copied to the messages
+    Long64_t next_entry = event_num + 1;
+    if(read_ahead_ && std::all_of(trees_.begin(), trees_.end(), [&](auto& info) {
+           return next_entry < info.tree->GetEntries();
+       })) {
+        staged_entry_ = next_entry;
+        run_async([this, next_entry]() { read_entries(next_entry); });
     }
 }
 
 void ROOTObjectReaderModule::finalize() {
     int branch_count = 0;
-    for(auto& tree : trees_) {
-        branch_count += tree->GetListOfBranches()->GetEntries();
+    for(auto& info : trees_) {
+        branch_count += info.tree->GetListOfBranches()->GetEntries();
+
+        // Print statistics of every tree read
+        if(info.read) {
+            LOG(INFO) << "Read " << info.objects << " objects from tree " << info.tree->GetName() << " with "
+                      << info.bytes << " bytes in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(info.read_time).count() << " ms";
+        }
     }
 
     // Print statistics
     LOG(INFO) << "Read " << read_cnt_ << " objects from " << branch_count << " branches";
 
-    // Close the file
-    input_file_->Close();
+    // Close the files
+    weight_tree_ = nullptr;
+    trees_.clear();
+    chains_.clear();
 }
@@ -7,10 +7,14 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <chrono>
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include <TChain.h>
 #include <TFile.h>
 #include <TTree.h>
 
@@ -49,7 +53,7 @@ namespace allpix {
         ~ROOTObjectReaderModule() override;
 
         /**
-         * @brief Open the ROOT file containing the stored output data
+         * @brief Open the ROOT files containing the stored output data and chain their trees
          */
         void init() override;
 
@@ -59,14 +63,67 @@ namespace allpix {
         void run(unsigned int) override;
 
         /**
-         * @brief Output summary and close the ROOT file
+         * @brief Output summary and close the ROOT files
          */
         void finalize() override;
 
     private:
+        /**
+         * @brief Check if the messages created from a branch have any receiver
+         * @param class_name Name of the class of the objects stored in the branch
+         * @param detector Detector of the messages, or a null pointer for messages without detector
+         * @param name Name of the messages
+         * @return True if the messages have a receiver or their type is unknown, false otherwise
+         */
+        bool has_receiver(const std::string& class_name, const std::shared_ptr<Detector>& detector, const std::string& name);
+
+        /**
+         * @brief Read the entries of all trees for an event
+         * @param entry Entry of the event in the trees
+         */
+        void read_entries(Long64_t entry);
+
         Messenger* messenger_;
         GeometryManager* geo_mgr_;
 
+        /**
+         * @brief Internal object storing the metadata of an input file, read when the files are opened
+         */
+        struct file_info {
+            std::string path;
+            // Names of the trees in the order of the file and their number of entries
+            std::vector<std::pair<std::string, long long>> trees;
+            std::unique_ptr<std::string> random_seed_core;
+            std::unique_ptr<std::string> version;
+            // Reason why the file cannot be read, empty if the file is valid
+            std::string error;
+        };
+
+        /**
+         * @brief Open an input file and read its metadata
+         * @param info Metadata of the file, to which the path of the file has already been assigned
+         * @note Can be called from several threads at the same time for different files
+         */
+        static void read_file_info(file_info& info);
+
+        /**
+         * @brief Check the metadata of an input file against the configuration
+         * @param info Metadata of the file
+         */
+        void check_file_info(const file_info& info);
+
+        /**
+         * @brief Internal object storing a tree of the file and the statistics of reading it
+         */
+        struct tree_info {
+            TTree* tree;
+            // Trees without any branch to read are only used to check the number of events
+            bool read{false};
+            unsigned long objects{};
+            long long bytes{};
+            std::chrono::steady_clock::duration read_time{};
+        };
+
         /**
          * @brief Internal object storing objects and information to construct a message from tree
          */
@@ -74,17 +131,26 @@ namespace allpix {
             std::vector<Object*>* objects;
             std::shared_ptr<Detector> detector;
             std::string name;
+            tree_info* tree;
         };
 
         // Object names to include or exclude from reading
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
-        // File containing the objects
-        std::unique_ptr<TFile> input_file_;
+        // Chains of the trees with identical names of all files containing the objects, in the order of the files
+        std::vector<std::unique_ptr<TChain>> chains_;
+
+        // Object trees in the files
+        std::vector<tree_info> trees_;
+
+        // Entries of the next event read ahead by the thread of the asynchronous tasks, negative if none
+        bool read_ahead_{};
+        Long64_t staged_entry_{-1};
 
-        // Object trees in the file
-        std::vector<TTree*> trees_;
+        // Tree of the event weights, only present if weighted events have been written
+        TTree* weight_tree_{nullptr};
+        double weight_{1.};
 
         // List of objects and message information converted from the trees
         std::list<message_info> message_info_array_;
@@ -9,25 +9,37 @@
 
 #include "ROOTObjectWriterModule.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <map>
 #include <string>
 #include <utility>
 
 #include <TBranchElement.h>
 #include <TClass.h>
+#include <TProcessID.h>
+#include <TROOT.h>
 
 #include "core/config/ConfigReader.hpp"
 #include "core/utils/file.h"
 #include "core/utils/log.h"
+#include "core/utils/text.h"
 #include "core/utils/type.h"
+#include "core/utils/unit.h"
 
 #include "objects/Object.hpp"
+#include "objects/Pulse.hpp"
 #include "objects/objects.h"
 
 using namespace allpix;
 
 ROOTObjectWriterModule::ROOTObjectWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
     : Module(config), geo_mgr_(geo_mgr) {
+    // Writing can be executed in parallel to the other modules which process the events in order
+    enable_dedicated_thread();
+    // The output file is closed at the same time as other modules are finalized, as it is not shared with them
+    enable_parallel_finalization();
+
     // Bind to all messages
     messenger->registerListener(this, &ROOTObjectWriterModule::receive);
 }
@@ -45,12 +57,80 @@ void ROOTObjectWriterModule::init() {
     // Create output file
     output_file_name_ =
         createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name", "data"), "root"), true);
-    output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "RECREATE");
+    if(is_resuming()) {
+        // Continue writing to the trees saved with the checkpoint
+        if(!allpix::path_is_file(output_file_name_)) {
+            throw ModuleError("Cannot resume writing to missing output file " + output_file_name_);
+        }
+        output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "UPDATE");
+    } else {
+        output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "RECREATE");
+    }
     output_file_->cd();
 
+    // Set the compression of the output file, using the ROOT identifiers of the algorithms
+    if(config_.has("compression_algorithm")) {
+        std::map<std::string, int> algorithms = {{"zlib", 1}, {"lzma", 2}, {"lz4", 4}, {"zstd", 5}};
+        auto algorithm = config_.get<std::string>("compression_algorithm");
+        std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), ::tolower);
+        if(algorithms.find(algorithm) == algorithms.end()) {
+            throw InvalidValueError(config_, "compression_algorithm", "algorithm should be zlib, lzma, lz4 or zstd");
+        }
+        output_file_->SetCompressionAlgorithm(algorithms[algorithm]);
+    }
+    if(config_.has("compression_level")) {
+        auto level = config_.get<int>("compression_level");
+        if(level < 0 || level > 9) {
+            throw InvalidValueError(config_, "compression_level", "level should be between 0 and 9");
+        }
+        output_file_->SetCompressionLevel(level);
+    }
+
+    // Compress the baskets of the different branches in parallel using the implicit multi-threading of ROOT
+    if(config_.get<bool>("parallel_compression", false)) {
+        auto compression_threads = config_.get<unsigned int>("compression_threads", 0);
+        ROOT::EnableThreadSafety();
+        ROOT::EnableImplicitMT(compression_threads);
+        if(ROOT::IsImplicitMTEnabled()) {
+            LOG(DEBUG) << "Enabled implicit multi-threading of ROOT for parallel compression";
+        } else {
+            LOG(WARNING) << "ROOT does not support implicit multi-threading, compressing branches sequentially";
+        }
+    }
+
+    // Settings of the branches and trees, defaulting to the ROOT defaults
+    basket_size_ = config_.get<int>("basket_size", 32000);
+    if(basket_size_ <= 0) {
+        throw InvalidValueError(config_, "basket_size", "basket size should be larger than zero");
+    }
+    auto_flush_ = config_.get<long long>("auto_flush", -30000000);
+
+    // Store the pulses with quantized charges if requested, the quantum is written with every pulse
+    auto pulse_quantization = config_.get<double>("pulse_quantization", 0);
+    if(pulse_quantization < 0) {
+        throw InvalidValueError(config_, "pulse_quantization", "quantization step should not be negative");
+    }
+    Pulse::setStorageQuantum(pulse_quantization);
+    if(pulse_quantization > 0) {
+        LOG(INFO) << "Storing pulses quantized in steps of " << Units::display(pulse_quantization, "e");
+    }
+
+    // Trees are only saved with the checkpoints of the run, such that the file always matches the last checkpoint
+    checkpoints_ = (getConfigManager()->getGlobalConfiguration().get<unsigned int>("checkpoint_interval", 0u) > 0);
+
     // Read include and exclude list
     if(config_.has("include") && config_.has("exclude")) {
         throw InvalidValueError(config_, "exclude", "include and exclude parameter are mutually exclusive");
+    } else if(config_.get<bool>("clusters_only", false)) {
+        // Only write the clusters together with the Monte-Carlo particles they are linked to
+        if(config_.has("include") || config_.has("exclude")) {
+            throw InvalidCombinationError(config_,
+                                          {"clusters_only", "include", "exclude"},
+                                          "only clusters are written, the objects cannot be selected as well");
+        }
+        include_ = {"PixelCluster", "MCParticle"};
+        clusters_only_ = true;
+        LOG(DEBUG) << "Writing only the pixel clusters and the Monte-Carlo particles";
     } else if(config_.has("include")) {
         auto inc_arr = config_.getArray<std::string>("include");
         include_.insert(inc_arr.begin(), inc_arr.end());
@@ -58,111 +138,330 @@ void ROOTObjectWriterModule::init() {
         auto exc_arr = config_.getArray<std::string>("exclude");
         exclude_.insert(exc_arr.begin(), exc_arr.end());
     }
+
+    // Create the declared branches before the first event, such that they never have to be pre-filled with empty events
+    // When resuming, they are only declared after binding to the branches stored before the checkpoint
+    if(config_.has("branches") && !is_resuming()) {
+        declare_branches();
+    }
+
+    // Write the events asynchronously if requested
+    auto async_queue_size = config_.get<size_t>("async_queue_size", 16);
+    if(async_queue_size == 0) {
+        throw InvalidValueError(config_, "async_queue_size", "queue size should be larger than zero");
+    }
+    if(config_.get<bool>("async_write", false)) {
+        // The trees are filled by another thread than the one executing the module
+        ROOT::EnableThreadSafety();
+        LOG(DEBUG) << "Writing events asynchronously with a queue of " << async_queue_size << " events";
+        enable_async_tasks(async_queue_size);
+    }
 }
 
 void ROOTObjectWriterModule::receive(std::shared_ptr<BaseMessage> message, std::string message_name) { // NOLINT
+    const BaseMessage* inst = message.get();
+    std::string name_str = " without a name";
+    if(!message_name.empty()) {
+        name_str = " named " + message_name;
+    }
+    LOG(TRACE) << "ROOT object writer received " << allpix::demangle(typeid(*inst).name()) << name_str;
+
+    // Keep the message until the event is written
+    event_messages_.emplace_back(std::move(message), std::move(message_name));
+}
+
+/**
+ * The objects of the message are handed to their branch as pointers. The branch of a combination of object type, detector
+ * and message name is only looked up once per message. Messages of which the objects are not written are remembered by their
+ * type, since a message type holds a single object type, such that their objects are not collected again.
+ */
+void ROOTObjectWriterModule::write_message(const std::shared_ptr<BaseMessage>& message, const std::string& message_name) {
+    const BaseMessage* inst = message.get();
+
+    // Get the detector name
+    std::string detector_name;
+    if(message->getDetector() != nullptr) {
+        detector_name = message->getDetector()->getName();
+    }
+
+    // Skip messages with objects which are excluded or not included before collecting their objects
+    auto message_index = std::make_tuple(std::type_index(typeid(*inst)), detector_name, message_name);
+    if(ignored_.find(message_index) != ignored_.end()) {
+        return;
+    }
+
     try {
-        const BaseMessage* inst = message.get();
-        std::string name_str = " without a name";
-        if(!message_name.empty()) {
-            name_str = " named " + message_name;
-        }
-        LOG(TRACE) << "ROOT object writer received " << allpix::demangle(typeid(*inst).name()) << name_str;
+        objects_.clear();
+        message->appendObjects(objects_);
+    } catch(MessageWithoutObjectException& e) {
+        LOG(WARNING) << "ROOT object writer cannot process message of type" << allpix::demangle(typeid(*inst).name())
+                     << " with name " << message_name;
+        return;
+    }
+    if(objects_.empty()) {
+        return;
+    }
 
-        // Get the detector name
-        std::string detector_name;
-        if(message->getDetector() != nullptr) {
-            detector_name = message->getDetector()->getName();
+    // Create a new branch of the correct type if this message was not received before
+    auto index_tuple = std::make_tuple(std::type_index(typeid(*objects_.front())), detector_name, message_name);
+    auto branch = write_list_.find(index_tuple);
+    if(branch == write_list_.end()) {
+        auto* cls = TClass::GetClass(typeid(*objects_.front()));
+        if(!is_written(get_tree_name(cls))) {
+            LOG(TRACE) << "ROOT object writer ignored message with object " << allpix::demangle(typeid(*inst).name())
+                       << " because it has been excluded or not explicitly included";
+            ignored_.insert(message_index);
+            return;
         }
 
-        // Read the object
-        auto object_array = message->getObjectArray();
-        if(!object_array.empty()) {
-            keep_messages_.push_back(message);
-
-            const Object& first_object = object_array[0];
-            std::type_index type_idx = typeid(first_object);
+        create_branch(index_tuple, cls);
+        branch = write_list_.find(index_tuple);
+    }
 
-            // Create a new branch of the correct type if this message was not received before
-            auto index_tuple = std::make_tuple(type_idx, detector_name, message_name);
-            if(write_list_.find(index_tuple) == write_list_.end()) {
+    // Fill the branch vector, the Monte-Carlo particles of the clusters are only selected once all clusters are known
+    branch->second->insert(branch->second->end(), objects_.begin(), objects_.end());
+    if(clusters_only_ && std::get<0>(index_tuple) == std::type_index(typeid(MCParticle))) {
+        return;
+    }
+    write_cnt_ += objects_.size();
+    for(auto* object : objects_) {
+        object->markForStorage();
+    }
+}
 
-                auto* cls = TClass::GetClass(typeid(first_object));
+bool ROOTObjectWriterModule::is_written(const std::string& class_name) const {
+    return (include_.empty() || include_.find(class_name) != include_.end()) &&
+           (exclude_.empty() || exclude_.find(class_name) == exclude_.end());
+}
 
-                // Remove the allpix prefix
-                std::string class_name = cls->GetName();
-                std::string apx_namespace = "allpix::";
-                size_t ap_idx = class_name.find(apx_namespace);
-                if(ap_idx != std::string::npos) {
-                    class_name.replace(ap_idx, apx_namespace.size(), "");
+/**
+ * The parents of the linked particles are kept as well, such that the history of the particles can be followed up to the
+ * primary particle. Particles of detectors without written clusters are thus only kept if they are the parent of a linked
+ * particle.
+ */
+void ROOTObjectWriterModule::select_cluster_particles() {
+    std::set<const MCParticle*> particles;
+    for(auto& index_data : write_list_) {
+        if(std::get<0>(index_data.first) != std::type_index(typeid(PixelCluster))) {
+            continue;
+        }
+        for(auto* object : *index_data.second) {
+            for(const auto* particle : static_cast<PixelCluster*>(object)->getMCParticles()) {
+                while(particle != nullptr && particles.insert(particle).second) {
+                    particle = particle->getParent();
                 }
+            }
+        }
+    }
 
-                // Check if this message should be kept
-                if((!include_.empty() && include_.find(class_name) == include_.end()) ||
-                   (!exclude_.empty() && exclude_.find(class_name) != exclude_.end())) {
-                    LOG(TRACE) << "ROOT object writer ignored message with object " << allpix::demangle(typeid(*inst).name())
-                               << " because it has been excluded or not explicitly included";
-                    return;
-                }
+    size_t received = 0;
+    size_t selected = 0;
+    for(auto& index_data : write_list_) {
+        if(std::get<0>(index_data.first) != std::type_index(typeid(MCParticle))) {
+            continue;
+        }
+        auto& objects = *index_data.second;
+        received += objects.size();
+        objects.erase(std::remove_if(objects.begin(),
+                                     objects.end(),
+                                     [&](Object* object) {
+                                         return particles.find(static_cast<MCParticle*>(object)) == particles.end();
+                                     }),
+                      objects.end());
+        selected += objects.size();
+        for(auto* object : objects) {
+            object->markForStorage();
+        }
+    }
+    write_cnt_ += selected;
+    LOG(DEBUG) << "Writing " << selected << " of " << received << " Monte-Carlo particles linked to the clusters";
+}
 
-                // Add vector of objects to write to the write list
-                write_list_[index_tuple] = new std::vector<Object*>();
-                auto addr = &write_list_[index_tuple];
-
-                auto new_tree = (trees_.find(class_name) == trees_.end());
-                if(new_tree) {
-                    // Create new tree
-                    output_file_->cd();
-                    trees_.emplace(
-                        class_name,
-                        std::make_unique<TTree>(class_name.c_str(), (std::string("Tree of ") + class_name).c_str()));
-                }
+/**
+ * Every declared branch is given as object name, optionally followed by the detector name or "global" for objects not bound
+ * to a detector, and the message name, separated by slashes. Without a detector, a branch is declared for every detector.
+ */
+void ROOTObjectWriterModule::declare_branches() {
+    size_t declared = 0;
+    for(const auto& declaration : config_.getArray<std::string>("branches")) {
+        auto parts = allpix::split<std::string>(declaration, "/");
+        if(parts.empty() || parts.size() > 3) {
+            throw InvalidValueError(config_, "branches", "branch '" + declaration + "' should be given as object name, "
+                                                         "detector name and message name separated by slashes");
+        }
 
-                std::string branch_name = detector_name.empty() ? "global" : detector_name;
-                if(!message_name.empty()) {
-                    branch_name += "_";
-                    branch_name += message_name;
-                }
+        auto* cls = TClass::GetClass(("allpix::" + parts[0]).c_str());
+        if(cls == nullptr || cls->GetTypeInfo() == nullptr) {
+            throw InvalidValueError(config_, "branches", "unknown object " + parts[0]);
+        }
+        if(!is_written(get_tree_name(cls))) {
+            throw InvalidValueError(config_, "branches", "object " + parts[0] + " has been excluded or not included");
+        }
 
-                trees_[class_name]->Bronch(
-                    branch_name.c_str(), (std::string("std::vector<") + cls->GetName() + "*>").c_str(), addr);
-
-                // Prefill new tree or new branch with empty records for all events that were missed since the start
-                if(last_event_ > 0) {
-                    if(new_tree) {
-                        LOG(DEBUG) << "Pre-filling new tree of " << class_name << " with " << last_event_ << " empty events";
-                        for(unsigned int i = 0; i < last_event_; ++i) {
-                            trees_[class_name]->Fill();
-                        }
-                    } else {
-                        LOG(DEBUG) << "Pre-filling new branch " << branch_name << " of " << class_name << " with "
-                                   << last_event_ << " empty events";
-                        auto* branch = trees_[class_name]->GetBranch(branch_name.c_str());
-                        for(unsigned int i = 0; i < last_event_; ++i) {
-                            branch->Fill();
-                        }
-                    }
-                }
+        std::vector<std::string> detector_names;
+        if(parts.size() == 1) {
+            for(const auto& detector : geo_mgr_->getDetectors()) {
+                detector_names.push_back(detector->getName());
             }
+        } else if(parts[1] == "global") {
+            detector_names.emplace_back();
+        } else if(geo_mgr_->hasDetector(parts[1])) {
+            detector_names.push_back(parts[1]);
+        } else {
+            throw InvalidValueError(config_, "branches", "unknown detector " + parts[1]);
+        }
 
-            // Fill the branch vector
-            for(Object& object : object_array) {
-                ++write_cnt_;
-                write_list_[index_tuple]->push_back(&object);
+        auto message_name = (parts.size() == 3 ? parts[2] : std::string());
+        for(const auto& detector_name : detector_names) {
+            auto index = std::make_tuple(std::type_index(*cls->GetTypeInfo()), detector_name, message_name);
+            if(write_list_.find(index) == write_list_.end()) {
+                create_branch(index, cls);
+                ++declared;
             }
         }
+    }
+    LOG(INFO) << "Declared " << declared << " branches before the first event";
+}
 
-    } catch(MessageWithoutObjectException& e) {
-        const BaseMessage* inst = message.get();
-        LOG(WARNING) << "ROOT object writer cannot process message of type" << allpix::demangle(typeid(*inst).name())
-                     << " with name " << message_name;
+void ROOTObjectWriterModule::create_branch(const BranchIndex& index, TClass* cls) {
+    auto class_name = get_tree_name(cls);
+    const auto& detector_name = std::get<1>(index);
+    const auto& message_name = std::get<2>(index);
+
+    // Add vector of objects to write to the write list
+    write_list_[index] = new std::vector<Object*>();
+    auto addr = &write_list_[index];
+    branches_.emplace_back(cls->GetName(), detector_name, message_name);
+
+    auto new_tree = (trees_.find(class_name) == trees_.end());
+    if(new_tree && is_resuming()) {
+        // Continue the tree stored in the output file of the resumed run
+        TTree* tree = nullptr;
+        output_file_->GetObject(class_name.c_str(), tree);
+        if(tree != nullptr) {
+            trees_.emplace(class_name, std::unique_ptr<TTree>(tree));
+            new_tree = false;
+        }
+    }
+    if(new_tree) {
+        // Create new tree
+        output_file_->cd();
+        trees_.emplace(class_name,
+                       std::make_unique<TTree>(class_name.c_str(), (std::string("Tree of ") + class_name).c_str()));
+        trees_[class_name]->SetAutoFlush(auto_flush_);
+    }
+    if(checkpoints_) {
+        trees_[class_name]->SetAutoSave(0);
+    }
+
+    std::string branch_name = detector_name.empty() ? "global" : detector_name;
+    if(!message_name.empty()) {
+        branch_name += "_";
+        branch_name += message_name;
+    }
+
+    // Bind to the branch if it has been stored before the checkpoint or declared before the run
+    auto* branch = trees_[class_name]->GetBranch(branch_name.c_str());
+    if(branch != nullptr) {
+        branch->SetAddress(addr);
+        return;
+    }
+
+    trees_[class_name]->Bronch(
+        branch_name.c_str(), (std::string("std::vector<") + cls->GetName() + "*>").c_str(), addr, basket_size_);
+
+    // Prefill new tree or new branch with empty records for all events that were missed since the start
+    if(last_event_ > 0) {
+        if(new_tree) {
+            LOG(DEBUG) << "Pre-filling new tree of " << class_name << " with " << last_event_ << " empty events";
+            for(unsigned int i = 0; i < last_event_; ++i) {
+                trees_[class_name]->Fill();
+            }
+        } else {
+            LOG(DEBUG) << "Pre-filling new branch " << branch_name << " of " << class_name << " with " << last_event_
+                       << " empty events";
+            branch = trees_[class_name]->GetBranch(branch_name.c_str());
+            for(unsigned int i = 0; i < last_event_; ++i) {
+                branch->Fill();
+            }
+        }
     }
 }
 
+std::string ROOTObjectWriterModule::get_tree_name(const TClass* cls) {
+    // Remove the allpix prefix
+    std::string class_name = cls->GetName();
+    std::string apx_namespace = "allpix::";
+    size_t ap_idx = class_name.find(apx_namespace);
+    if(ap_idx != std::string::npos) {
+        class_name.replace(ap_idx, apx_namespace.size(), "");
+    }
+    return class_name;
+}
+
 void ROOTObjectWriterModule::run(unsigned int event) {
+    // Write the messages after all previous events, asynchronously if enabled
+    run_async([this, event, weight = getEventWeight(), messages = std::move(event_messages_)]() {
+        write_event(event, weight, messages);
+    });
+    event_messages_.clear();
+}
+
+void ROOTObjectWriterModule::write_event(unsigned int event, double weight, const EventMessages& messages) {
+    // Get object count for linking objects in current event
+    auto save_id = TProcessID::GetObjectCount();
+
+    // Fill empty entries for the events not written since the last event, e.g. because they were vetoed, such that the
+    // entries of all trees correspond to the same events regardless of the event the trees were created in
+    if(event > last_event_ + 1) {
+        LOG(DEBUG) << "Writing " << (event - last_event_ - 1) << " empty entries for the events skipped before event "
+                   << event;
+        output_file_->cd();
+        for(unsigned int i = last_event_ + 1; i < event; ++i) {
+            for(auto& tree : trees_) {
+                tree.second->Fill();
+            }
+            if(weight_tree_ != nullptr) {
+                weight_ = 1.;
+                weight_tree_->Fill();
+            }
+        }
+        last_event_ = event - 1;
+    }
+
+    // Add the objects of all messages, creating new branches with the last event number before this event
+    for(auto& message : messages) {
+        write_message(message.first, message.second);
+    }
+    if(clusters_only_) {
+        select_cluster_particles();
+    }
+
+    // Link the history of the objects, only creating references to objects stored in this event
+    for(auto& index_data : write_list_) {
+        for(auto* object : *index_data.second) {
+            object->petrifyHistory();
+        }
+    }
+
     LOG(TRACE) << "Writing new objects to tree";
     output_file_->cd();
 
+    // Store the weights of the events once the first weighted event is written, all previous events have a weight of one
+    if(weight_tree_ == nullptr && weight != 1.) {
+        LOG(DEBUG) << "Creating tree of event weights, pre-filled with " << last_event_ << " unweighted events";
+        weight_tree_ = std::make_unique<TTree>("Event", "Tree of event weights");
+        weight_tree_->SetAutoFlush(auto_flush_);
+        if(checkpoints_) {
+            weight_tree_->SetAutoSave(0);
+        }
+        weight_tree_->Branch("weight", &weight_);
+        weight_ = 1.;
+        for(unsigned int i = 0; i < last_event_; ++i) {
+            weight_tree_->Fill();
+        }
+    }
+
     // Save last event number for trees created later
     last_event_ = event;
 
@@ -170,13 +469,103 @@ void ROOTObjectWriterModule::run(unsigned int event) {
     for(auto& tree : trees_) {
         tree.second->Fill();
     }
+    if(weight_tree_ != nullptr) {
+        weight_ = weight;
+        weight_tree_->Fill();
+    }
 
     // Clear the current message list
     for(auto& index_data : write_list_) {
         index_data.second->clear();
     }
-    // Clear the messages we have to keep because they contain the internal pointers
-    keep_messages_.clear();
+
+    // Reset object count for next event
+    TProcessID::SetObjectCount(save_id);
+}
+
+/**
+ * The trees are saved to the output file together with the list of branches, such that writing can be continued after all
+ * events of the checkpoint. The trees are not saved automatically in between the checkpoints.
+ */
+void ROOTObjectWriterModule::checkpoint(TDirectory* directory) {
+    LOG(DEBUG) << "Saving trees of " << last_event_ << " events to file";
+    for(auto& tree : trees_) {
+        tree.second->AutoSave("FlushBaskets SaveSelf");
+    }
+    if(weight_tree_ != nullptr) {
+        weight_tree_->AutoSave("FlushBaskets SaveSelf");
+    }
+
+    auto last_event = std::to_string(last_event_);
+    directory->WriteObject(&last_event, "last_event");
+    auto objects = std::to_string(write_cnt_);
+    directory->WriteObject(&objects, "objects");
+    std::vector<std::string> classes, detectors, messages;
+    for(auto& branch : branches_) {
+        classes.push_back(std::get<0>(branch));
+        detectors.push_back(std::get<1>(branch));
+        messages.push_back(std::get<2>(branch));
+    }
+    directory->WriteObject(&classes, "branch_classes");
+    directory->WriteObject(&detectors, "branch_detectors");
+    directory->WriteObject(&messages, "branch_messages");
+}
+
+void ROOTObjectWriterModule::resume(TDirectory* directory) {
+    std::string* last_event = nullptr;
+    std::string* objects = nullptr;
+    std::vector<std::string>*classes = nullptr, *detectors = nullptr, *messages = nullptr;
+    directory->GetObject("last_event", last_event);
+    directory->GetObject("objects", objects);
+    directory->GetObject("branch_classes", classes);
+    directory->GetObject("branch_detectors", detectors);
+    directory->GetObject("branch_messages", messages);
+    if(last_event == nullptr || objects == nullptr || classes == nullptr || detectors == nullptr || messages == nullptr ||
+       classes->size() != detectors->size() || classes->size() != messages->size()) {
+        throw ModuleError("Checkpoint does not contain a valid state of the writer");
+    }
+    last_event_ = allpix::from_string<unsigned int>(*last_event);
+    write_cnt_ = allpix::from_string<unsigned long>(*objects);
+
+    // Bind to all branches stored before the checkpoint
+    for(size_t i = 0; i < classes->size(); ++i) {
+        auto* cls = TClass::GetClass((*classes)[i].c_str());
+        if(cls == nullptr || cls->GetTypeInfo() == nullptr) {
+            throw ModuleError("Cannot resume writing objects of unknown class " + (*classes)[i]);
+        }
+        create_branch(std::make_tuple(std::type_index(*cls->GetTypeInfo()), (*detectors)[i], (*messages)[i]), cls);
+    }
+    delete last_event;
+    delete objects;
+    delete classes;
+    delete detectors;
+    delete messages;
+
+    // Trees saved after the checkpoint cannot be continued
+    for(auto& tree : trees_) {
+        if(tree.second->GetEntries() != last_event_) {
+            throw ModuleError("Tree " + tree.first + " in file " + output_file_name_ + " contains " +
+                              std::to_string(tree.second->GetEntries()) + " events instead of the " +
+                              std::to_string(last_event_) + " events of the checkpoint");
+        }
+    }
+    LOG(INFO) << "Continuing " << trees_.size() << " trees after " << last_event_ << " events";
+
+    // Continue the event weights if any weighted event has been written before the checkpoint
+    TTree* weight_tree = nullptr;
+    output_file_->GetObject("Event", weight_tree);
+    if(weight_tree != nullptr) {
+        if(weight_tree->GetEntries() != last_event_) {
+            throw ModuleError("Tree of event weights in file " + output_file_name_ + " does not match the checkpoint");
+        }
+        weight_tree_.reset(weight_tree);
+        weight_tree_->SetBranchAddress("weight", &weight_);
+    }
+
+    // Branches declared in addition to the stored ones are pre-filled with the events before the checkpoint
+    if(config_.has("branches")) {
+        declare_branches();
+    }
 }
 
 void ROOTObjectWriterModule::finalize() {
@@ -189,6 +578,15 @@ void ROOTObjectWriterModule::finalize() {
         branch_count += tree.second->GetListOfBranches()->GetEntries();
     }
 
+    // Replace the description of the run written when the resumed run was stopped
+    if(is_resuming()) {
+        for(const auto& name : {"config", "detectors", "models"}) {
+            if(output_file_->GetDirectory(name) != nullptr) {
+                output_file_->Delete((std::string(name) + ";*").c_str());
+            }
+        }
+    }
+
     // Create main config directory
     TDirectory* config_dir = output_file_->mkdir("config");
     config_dir->cd();
@@ -8,7 +8,10 @@
  */
 
 #include <map>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -26,6 +29,9 @@ namespace allpix {
      * Listens to all objects dispatched in the framework. Creates a tree as soon as a new type of object is encountered and
      * saves the data in those objects to tree for every event. The tree name is the class name of the object. A separate
      * branch is created for every combination of detector name and message name that outputs this object.
+     *
+     * If asynchronous writing is enabled, the messages of every event are written by the asynchronous task thread of the
+     * module. This thread owns the trees and fills and compresses them while the next events are simulated.
      */
     class ROOTObjectWriterModule : public Module {
     public:
@@ -49,12 +55,14 @@ namespace allpix {
         void receive(std::shared_ptr<BaseMessage> message, std::string name);
 
         /**
-         * @brief Opens the file to write the objects to
+         * @brief Opens the file to write the objects to and enables asynchronous writing if requested
          */
         void init() override;
 
         /**
          * @brief Writes the objects fetched to their specific tree, constructing trees on the fly for new objects.
+         *
+         * If asynchronous writing is enabled, the messages are only queued for writing, waiting for a full queue.
          */
         void run(unsigned int) override;
 
@@ -64,12 +72,79 @@ namespace allpix {
          */
         void finalize() override;
 
+        /**
+         * @brief Save the trees to the output file and store the list of branches with the checkpoint
+         * @param directory Directory of the checkpoint file for this module
+         */
+        void checkpoint(TDirectory* directory) override;
+
+        /**
+         * @brief Continue the trees of the output file after the events of the checkpoint
+         * @param directory Directory of the checkpoint file for this module
+         */
+        void resume(TDirectory* directory) override;
+
     private:
+        // Messages received for a single event, together with their names
+        using EventMessages = std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>;
+        // Type of the objects, detector name and message name of a branch
+        using BranchIndex = std::tuple<std::type_index, std::string, std::string>;
+
+        /**
+         * @brief Create the branch for a new combination of object type, detector and message name
+         * @param index Object type, detector name and message name of the branch
+         * @param cls Class of the objects stored in the branch
+         *
+         * When resuming a run, the trees and branches already stored in the output file are continued.
+         */
+        void create_branch(const BranchIndex& index, TClass* cls);
+
+        /**
+         * @brief Get the name of the tree storing objects of a class
+         * @param cls Class of the objects
+         * @return Class name without the allpix namespace
+         */
+        static std::string get_tree_name(const TClass* cls);
+
+        /**
+         * @brief Add the objects of a message to the branch vectors, creating a new branch if required
+         * @param message Message received
+         * @param message_name Name of the message
+         */
+        void write_message(const std::shared_ptr<BaseMessage>& message, const std::string& message_name);
+
+        /**
+         * @brief Check if objects of a class are written according to the include and exclude lists
+         * @param class_name Class name without the allpix namespace
+         * @return True if the objects are written, false otherwise
+         */
+        bool is_written(const std::string& class_name) const;
+
+        /**
+         * @brief Only keep the Monte-Carlo particles linked to the written clusters and their parents, and mark them for
+         * storage
+         */
+        void select_cluster_particles();
+
+        /**
+         * @brief Create the branches declared in the configuration
+         */
+        void declare_branches();
+
+        /**
+         * @brief Write all messages of an event to the trees
+         * @param event Number of the event
+         * @param weight Statistical weight of the event
+         * @param messages Messages received for this event
+         */
+        void write_event(unsigned int event, double weight, const EventMessages& messages);
+
         GeometryManager* geo_mgr_;
 
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
+        bool clusters_only_{false};
 
         // Output data file to write
         std::unique_ptr<TFile> output_file_;
@@ -81,12 +156,27 @@ namespace allpix {
         // List of trees that are stored in data file
         std::map<std::string, std::unique_ptr<TTree>> trees_;
 
-        // List of messages to keep so they can be stored in the tree
-        std::vector<std::shared_ptr<BaseMessage>> keep_messages_;
+        // Tree of the event weights, only created with the first event with a weight different from one
+        std::unique_ptr<TTree> weight_tree_;
+        double weight_{1.};
+
+        // Messages of the current event, kept until written since they contain the objects stored in the tree
+        EventMessages event_messages_;
         // List of objects of a particular type, bound to a specific detector and having a particular name
-        std::map<std::tuple<std::type_index, std::string, std::string>, std::vector<Object*>*> write_list_;
+        std::map<BranchIndex, std::vector<Object*>*> write_list_;
+        // Combinations of message type, detector and message name of which the objects are not written
+        std::set<BranchIndex> ignored_;
+        // Objects of the message currently written, kept allocated for the next message
+        std::vector<Object*> objects_;
+        // Full class name, detector name and message name of all branches, stored with the checkpoints
+        std::vector<std::tuple<std::string, std::string, std::string>> branches_;
 
         // Statistical information about number of objects
         unsigned long write_cnt_{};
+
+        // Settings of the branches created
+        int basket_size_{};
+        long long auto_flush_{};
+        bool checkpoints_{};
     };
 } // namespace allpix
@@ -0,0 +1,154 @@
+/**
+ * @file
+ * @brief Implementation of a module to transfer deposited charges to the pixels using a library of the pixel response
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ResponseLibraryTransferModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/config/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+#include "tools/field_parser.h"
+#include "tools/pixel_accumulator.h"
+
+using namespace allpix;
+
+ResponseLibraryTransferModule::ResponseLibraryTransferModule(Configuration& config,
+                                                             Messenger* messenger,
+                                                             std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Seed the random generator with the global seed
+    random_generator_.seed(getRandomSeed());
+
+    // The library is only read after initialization, such that several events can be processed at the same time
+    enable_event_parallelization();
+
+    // Require deposits for the detector
+    messenger_->bindSingle(this, &ResponseLibraryTransferModule::deposits_message_, MsgFlags::REQUIRED);
+}
+
+void ResponseLibraryTransferModule::init() {
+    geometry_ = detector_->getGeometryView();
+
+    // Read the library, the number of values per voxel is taken from the header of the file
+    auto file_name = config_.getPath("library_file", true);
+    try {
+        auto info = FieldParser<double>::getInfoByFileName(file_name);
+        FieldParser<double> field_parser(info.quantity);
+        library_ = std::make_unique<ResponseLibrary>(field_parser.getByFileName(file_name));
+    } catch(std::runtime_error& e) {
+        throw InvalidValueError(config_, "library_file", e.what());
+    }
+
+    // The library has to be generated for the pixel cell of this detector
+    auto model = detector_->getModel();
+    const auto& cell_size = library_->getCellSize();
+    auto matches = [](double library, double detector) { return std::fabs(library - detector) <= 1e-6 * detector; };
+    if(!matches(cell_size[0], model->getPixelSize().x()) || !matches(cell_size[1], model->getPixelSize().y()) ||
+       !matches(cell_size[2], model->getSensorSize().z())) {
+        throw InvalidValueError(config_,
+                                "library_file",
+                                "library was generated for a pixel cell of " +
+                                    Units::display(ROOT::Math::XYZVector(cell_size[0], cell_size[1], cell_size[2]),
+                                                   {"um", "mm"}) +
+                                    ", which does not match the detector");
+    }
+
+    const auto& voxels = library_->getVoxels();
+    LOG(INFO) << "Loaded response library with " << voxels[0] << "x" << voxels[1] << "x" << voxels[2] << " voxels and "
+              << library_->getMatrixSize() << "x" << library_->getMatrixSize() << " pixel matrix";
+}
+
+void ResponseLibraryTransferModule::run(unsigned int) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this);
+
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
+
+    // Accumulator of the charges and deposits kept per thread to reuse its memory across events
+    thread_local PixelAccumulator<std::pair<unsigned int, const DepositedCharge*>> pixel_map;
+    pixel_map.reset(detector_->getModel()->getNPixels());
+
+    auto matrix_size = static_cast<int>(library_->getMatrixSize());
+    auto half_size = matrix_size / 2;
+    unsigned long deposited_charges_count = 0;
+    unsigned long transferred_charges_count = 0;
+    for(const auto& deposit : deposits_message->getData()) {
+        std::pair<int, int> pixel;
+        auto voxel = library_->getVoxel(geometry_, deposit.getLocalPosition(), pixel);
+        const auto* fractions = library_->getFractions(voxel, (deposit.getType() == CarrierType::ELECTRON ? 0 : 1));
+        deposited_charges_count += deposit.getCharge();
+
+        // Sample the carriers collected by the pixels of the matrix from a multinomial distribution, as a sequence of
+        // binomial distributions for every pixel given the carriers not collected by the previous pixels
+        auto remaining = deposit.getCharge();
+        double remaining_fraction = 1.;
+        for(int i = 0; i < matrix_size * matrix_size && remaining > 0; ++i) {
+            auto fraction = fractions[i];
+            if(fraction <= 0.) {
+                continue;
+            }
+            auto probability = (remaining_fraction > fraction ? fraction / remaining_fraction : 1.);
+            remaining_fraction -= fraction;
+            auto collected = std::binomial_distribution<unsigned int>(remaining, probability)(random_generator);
+            if(collected == 0) {
+                continue;
+            }
+            remaining -= collected;
+
+            auto xpixel = pixel.first + i / matrix_size - half_size;
+            auto ypixel = pixel.second + i % matrix_size - half_size;
+            if(!geometry_.isWithinPixelGrid(xpixel, ypixel)) {
+                LOG(TRACE) << "Skipping set of " << collected << " charges collected outside the pixel grid";
+                continue;
+            }
+            pixel_map.add(Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel)),
+                          {collected, &deposit});
+            transferred_charges_count += collected;
+        }
+    }
+
+    // Create pixel charges linked to the deposits they originate from
+    auto pixel_charges = MessageDataPool<PixelCharge>::acquire();
+    std::vector<const DepositedCharge*> pixel_deposited_charges;
+    pixel_map.forEachPixel([&](const Pixel::Index& pixel_index, auto begin, auto end) {
+        unsigned int charge = 0;
+        pixel_deposited_charges.clear();
+        for(auto iter = begin; iter != end; ++iter) {
+            charge += iter->first;
+            if(has_object_history()) {
+                pixel_deposited_charges.push_back(iter->second);
+            }
+        }
+
+        pixel_charges.emplace_back(detector_->getPixel(pixel_index), charge, pixel_deposited_charges);
+        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel_index;
+    });
+
+    LOG(INFO) << "Transferred " << transferred_charges_count << " of " << deposited_charges_count << " charges to "
+              << pixel_charges.size() << " pixels";
+    total_deposited_charges_ += deposited_charges_count;
+    total_transferred_charges_ += transferred_charges_count;
+
+    auto pixel_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    messenger_->dispatchMessage(this, pixel_message);
+}
+
+void ResponseLibraryTransferModule::finalize() {
+    LOG(INFO) << "Transferred total of " << total_transferred_charges_ << " of " << total_deposited_charges_
+              << " deposited charges";
+}
@@ -0,0 +1,83 @@
+/**
+ * @file
+ * @brief Definition of a module to transfer deposited charges to the pixels using a library of the pixel response
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_RESPONSE_LIBRARY_TRANSFER_MODULE_H
+#define ALLPIX_RESPONSE_LIBRARY_TRANSFER_MODULE_H
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorGeometryView.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
+
+#include "tools/response_library.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to transfer deposited charges directly to the pixels by sampling from a response library
+     * @note This module supports parallelization
+     *
+     * The charge carriers of every deposit are distributed over the pixels of the matrix around the pixel of the deposit
+     * according to the fractions stored in the library for the voxel of the deposit, replacing the propagation and transfer
+     * of the charge carriers. The number of carriers collected by each pixel is sampled from a multinomial distribution,
+     * and the remaining carriers are lost. The resulting pixel charges are linked to the deposits they originate from.
+     */
+    class ResponseLibraryTransferModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        ResponseLibraryTransferModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Read the response library and check that it matches the pixel cell of the detector
+         */
+        void init() override;
+
+        /**
+         * @brief Transfer the deposited charges to the pixels
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Display statistical summary
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+        std::shared_ptr<Detector> detector_;
+        DetectorGeometryView geometry_;
+
+        // Random generator used if the modules are not seeded for every event
+        std::mt19937_64 random_generator_;
+
+        // Message containing the deposits of the event
+        std::shared_ptr<DepositedChargeMessage> deposits_message_;
+
+        std::unique_ptr<ResponseLibrary> library_;
+
+        // Statistical information
+        std::atomic<unsigned long> total_deposited_charges_{};
+        std::atomic<unsigned long> total_transferred_charges_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_RESPONSE_LIBRARY_TRANSFER_MODULE_H */
@@ -0,0 +1,179 @@
+/**
+ * @file
+ * @brief Implementation of a module to generate a library of the pixel response to charges deposited in the pixel cell
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ResponseLibraryWriterModule.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "core/config/exceptions.h"
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+ResponseLibraryWriterModule::ResponseLibraryWriterModule(Configuration& config,
+                                                         Messenger* messenger,
+                                                         std::shared_ptr<Detector> detector)
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Set default values for the library
+    config_.setDefault("file_name", "response_library");
+    config_.setDefault("file_type", "apf");
+    config_.setDefault("matrix_size", 3);
+
+    // The library is only locked to add the sums of an event, such that several events can be processed at the same time
+    enable_event_parallelization();
+
+    // Require the deposits and bind the pixel charges, which are missing if no charge has been collected in the event
+    messenger_->bindSingle(this, &ResponseLibraryWriterModule::deposits_message_, MsgFlags::REQUIRED);
+    messenger_->bindSingle(this, &ResponseLibraryWriterModule::pixel_message_);
+}
+
+void ResponseLibraryWriterModule::init() {
+    geometry_ = detector_->getGeometryView();
+
+    // The pixel charges are traced back to the deposits through their propagated charges
+    if(!has_object_history()) {
+        throw ModuleError("The response library requires the object history to link pixel charges to their deposits");
+    }
+
+    auto format = config_.get<std::string>("file_type");
+    std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+    file_type_ = (format == "apf"    ? FileType::APF
+                  : format == "apf2" ? FileType::APF2
+                  : format == "apfz" ? FileType::APFZ
+                                     : FileType::UNKNOWN);
+    if(file_type_ == FileType::UNKNOWN) {
+        throw InvalidValueError(config_, "file_type", "only file types 'apf', 'apf2' and 'apfz' are supported");
+    }
+    file_name_ = createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name"), "apf"));
+
+    // Create the library for the pixel cell of the detector
+    auto voxels = config_.getArray<size_t>("voxels");
+    if(voxels.size() != 3 || std::find(voxels.begin(), voxels.end(), 0) != voxels.end()) {
+        throw InvalidValueError(config_, "voxels", "number of voxels has to be given and positive in x, y and z");
+    }
+    auto model = detector_->getModel();
+    try {
+        library_ = std::make_unique<ResponseLibrary>(
+            std::array<size_t, 3>{{voxels[0], voxels[1], voxels[2]}},
+            config_.get<size_t>("matrix_size"),
+            std::array<double, 3>{{model->getPixelSize().x(), model->getPixelSize().y(), model->getSensorSize().z()}});
+    } catch(std::invalid_argument& e) {
+        throw InvalidValueError(config_, "matrix_size", e.what());
+    }
+    const auto& library_voxels = library_->getVoxels();
+    deposited_.resize(2 * library_voxels[0] * library_voxels[1] * library_voxels[2]);
+
+    LOG(INFO) << "Generating response library with " << library_voxels[0] << "x" << library_voxels[1] << "x"
+              << library_voxels[2] << " voxels and " << library_->getMatrixSize() << "x" << library_->getMatrixSize()
+              << " pixel matrix";
+}
+
+void ResponseLibraryWriterModule::run(unsigned int) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this);
+    auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this);
+
+    // Find the voxel and the pixel of every deposit, the sums of the event are added to the library at once
+    struct DepositVoxel {
+        size_t voxel;
+        size_t carrier;
+        std::pair<int, int> pixel;
+    };
+    std::unordered_map<const DepositedCharge*, DepositVoxel> deposit_voxels;
+    std::vector<std::pair<size_t, unsigned int>> deposited;
+    for(const auto& deposit : deposits_message->getData()) {
+        DepositVoxel deposit_voxel{};
+        deposit_voxel.voxel = library_->getVoxel(geometry_, deposit.getLocalPosition(), deposit_voxel.pixel);
+        deposit_voxel.carrier = (deposit.getType() == CarrierType::ELECTRON ? 0 : 1);
+        deposit_voxels.emplace(&deposit, deposit_voxel);
+        deposited.emplace_back(2 * deposit_voxel.voxel + deposit_voxel.carrier, deposit.getCharge());
+    }
+
+    // Assign the collected charges to the pixel of the matrix around the pixel of their deposit
+    auto matrix_size = static_cast<int>(library_->getMatrixSize());
+    auto half_size = matrix_size / 2;
+    std::vector<std::pair<double*, unsigned int>> collected;
+    if(pixel_message != nullptr) {
+        for(const auto& pixel_charge : pixel_message->getData()) {
+            auto propagated_charges = pixel_charge.getPropagatedCharges();
+            if(propagated_charges.empty() && pixel_charge.getCharge() > 0) {
+                throw ModuleError("Pixel charges are not linked to propagated charge objects, the response library "
+                                  "cannot be generated from columnar propagated charges");
+            }
+
+            auto index = pixel_charge.getIndex();
+            for(const auto* propagated_charge : propagated_charges) {
+                auto deposit_voxel = deposit_voxels.find(propagated_charge->getDepositedCharge());
+                if(deposit_voxel == deposit_voxels.end()) {
+                    continue;
+                }
+                auto dx = static_cast<int>(index.x()) - deposit_voxel->second.pixel.first;
+                auto dy = static_cast<int>(index.y()) - deposit_voxel->second.pixel.second;
+                if(std::abs(dx) > half_size || std::abs(dy) > half_size) {
+                    LOG(TRACE) << "Skipping " << propagated_charge->getCharge()
+                               << " charges collected outside of the matrix";
+                    continue;
+                }
+                auto* fractions = library_->getFractions(deposit_voxel->second.voxel, deposit_voxel->second.carrier);
+                collected.emplace_back(fractions + (dx + half_size) * matrix_size + (dy + half_size),
+                                       propagated_charge->getCharge());
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    for(const auto& [index, charge] : deposited) {
+        deposited_[index] += charge;
+    }
+    for(const auto& [sum, charge] : collected) {
+        *sum += charge;
+    }
+}
+
+void ResponseLibraryWriterModule::finalize() {
+    // Divide the sums of the collected carriers by the deposited carriers of their voxel and type
+    const auto& voxels = library_->getVoxels();
+    auto matrix_pixels = library_->getMatrixSize() * library_->getMatrixSize();
+    size_t empty_voxels = 0;
+    for(size_t voxel = 0; voxel < voxels[0] * voxels[1] * voxels[2]; ++voxel) {
+        if(deposited_[2 * voxel] == 0 && deposited_[2 * voxel + 1] == 0) {
+            ++empty_voxels;
+        }
+        for(size_t carrier = 0; carrier < 2; ++carrier) {
+            auto* fractions = library_->getFractions(voxel, carrier);
+            auto deposited = deposited_[2 * voxel + carrier];
+            for(size_t pixel = 0; pixel < matrix_pixels; ++pixel) {
+                fractions[pixel] = (deposited > 0 ? fractions[pixel] / deposited : 0.);
+            }
+        }
+    }
+    if(empty_voxels > 0) {
+        LOG(WARNING) << empty_voxels << " voxels of the pixel cell did not receive any deposit, no charge will be collected "
+                     << "from them";
+    }
+
+    // Store the library, the values of all pixels of the matrix of both carrier types are stored per voxel
+    auto model = detector_->getModel();
+    std::string header = "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " response library for detector model " +
+                         model->getType() + ", " + std::to_string(library_->getMatrixSize()) + "x" +
+                         std::to_string(library_->getMatrixSize()) + " pixel matrix";
+    FieldWriter<double> field_writer(static_cast<FieldQuantity>(library_->getValuesPerVoxel()));
+    try {
+        field_writer.writeFile(library_->getFieldData(header), file_name_, file_type_);
+    } catch(std::runtime_error& e) {
+        throw ModuleError("Cannot write response library to " + file_name_ + ": " + e.what());
+    }
+    LOG(STATUS) << "Wrote response library with " << voxels[0] << "x" << voxels[1] << "x" << voxels[2] << " voxels to file "
+                << file_name_;
+}
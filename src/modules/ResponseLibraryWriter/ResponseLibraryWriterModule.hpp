@@ -0,0 +1,84 @@
+/**
+ * @file
+ * @brief Definition of a module to generate a library of the pixel response to charges deposited in the pixel cell
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_RESPONSE_LIBRARY_WRITER_MODULE_H
+#define ALLPIX_RESPONSE_LIBRARY_WRITER_MODULE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorGeometryView.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
+
+#include "tools/response_library.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to generate a library of the fractions of deposited charges collected by the pixels around the deposit
+     * @note This module supports parallelization
+     *
+     * The deposits of every event are assigned to the voxel of the pixel cell they are located in, and the pixel charges of
+     * the event are traced back through their propagated charges to the deposits they originate from. For every voxel, the
+     * deposited charge carriers and the carriers collected by the pixels of a matrix around the pixel of the deposit are
+     * summed over all events. At the end of the run, the fractions of the collected carriers are written to a library file
+     * which can be used by the ResponseLibraryTransfer module.
+     */
+    class ResponseLibraryWriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        ResponseLibraryWriterModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Create the library and check the object history
+         */
+        void init() override;
+
+        /**
+         * @brief Add the deposited and collected charges of the event to the library
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Write the fractions of the collected charges to the library file
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+        std::shared_ptr<Detector> detector_;
+        DetectorGeometryView geometry_;
+
+        // Messages with the deposits and the pixel charges of the event
+        std::shared_ptr<DepositedChargeMessage> deposits_message_;
+        std::shared_ptr<PixelChargeMessage> pixel_message_;
+
+        // Library with the sums of the collected carriers, and the sums of the deposited carriers per voxel and type
+        std::unique_ptr<ResponseLibrary> library_;
+        std::vector<double> deposited_;
+        std::mutex library_mutex_;
+
+        std::string file_name_;
+        FileType file_type_{FileType::APF};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_RESPONSE_LIBRARY_WRITER_MODULE_H */
@@ -22,6 +22,7 @@
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
 #include "tools/ROOT.h"
+#include "tools/pixel_accumulator.h"
 
 #include "objects/PixelCharge.hpp"
 
@@ -29,9 +30,6 @@ using namespace allpix;
 
 SimpleTransferModule::SimpleTransferModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
     : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
-    // Enable parallelization of this module if multithreading is enabled
-    enable_parallelization();
-
     // Set default value for the maximum depth distance to transfer
     config_.setDefault("max_depth_distance", Units::get(5.0, "um"));
 
@@ -46,14 +44,29 @@ SimpleTransferModule::SimpleTransferModule(Configuration& config, Messenger* mes
     // Save detector model
     model_ = detector_->getModel();
 
-    // Cache flag for output plots:
+    // Cache flag for output plots and the parameters used for every propagated charge:
     output_plots_ = config_.get<bool>("output_plots");
+    config_.bind("max_depth_distance", max_depth_distance_);
+    config_.bind("collect_from_implant", collect_from_implant_);
+
+    // Enable parallelization of this module if multithreading is enabled, also for several events if no plots are filled
+    if(output_plots_) {
+        enable_parallelization();
+    } else {
+        enable_event_parallelization();
+    }
 
-    // Require propagated deposits for single detector
-    messenger->bindSingle(this, &SimpleTransferModule::propagated_message_, MsgFlags::REQUIRED);
+    // Require propagated deposits for single detector, either as objects or in columnar form. The propagated charges of an
+    // event can be split into several messages, which are all combined.
+    messenger->bindMulti(this, &SimpleTransferModule::propagated_messages_);
+    messenger->bindMulti(this, &SimpleTransferModule::propagated_array_messages_);
 }
 
 void SimpleTransferModule::init() {
+    geometry_ = detector_->getGeometryView();
+    if(!PixelKey::supports(detector_->getModel()->getNPixels())) {
+        throw ModuleError("Pixel grid exceeds " + std::to_string(PixelKey::max_coordinate) + " pixels in x or y");
+    }
 
     if(config_.get<bool>("collect_from_implant")) {
         if(detector_->getElectricFieldType() == FieldType::LINEAR) {
@@ -76,83 +89,188 @@ void SimpleTransferModule::init() {
 }
 
 void SimpleTransferModule::run(unsigned int) {
+    // Fetch the propagated charges of the current event in either form
+    auto propagated_messages = messenger_->fetchMultiMessage<PropagatedChargeMessage>(this);
+    auto propagated_array_messages = messenger_->fetchMultiMessage<PropagatedChargeArrayMessage>(this);
+
     // Find corresponding pixels for all propagated charges
     LOG(TRACE) << "Transferring charges to pixels";
+    auto pixel_charges = MessageDataPool<PixelCharge>::acquire();
     unsigned int transferred_charges_count = 0;
-    std::map<Pixel::Index, std::vector<const PropagatedCharge*>> pixel_map;
-    for(auto& propagated_charge : propagated_message_->getData()) {
-        auto position = propagated_charge.getLocalPosition();
-        // Ignore if outside depth range of implant
-        // FIXME This logic should be improved
-        if(std::fabs(position.z() - (model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0)) >
-           config_.get<double>("max_depth_distance")) {
-            LOG(TRACE) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
-                       << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
-                       << " because their local position is not in implant range";
-            continue;
+    if(!propagated_messages.empty()) {
+        transferred_charges_count = transfer_charges(propagated_messages, pixel_charges);
+    } else if(!propagated_array_messages.empty()) {
+        transferred_charges_count = transfer_charges(propagated_array_messages, pixel_charges);
+    } else {
+        LOG(TRACE) << "No propagated charges received, skipping event";
+        return;
+    }
+
+    // Writing summary and update statistics
+    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_charges.size() << " pixels";
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        total_transferred_charges_ += transferred_charges_count;
+        for(auto& pixel_charge : pixel_charges) {
+            unique_pixels_.emplace(pixel_charge.getPixel().getIndex());
         }
+    }
 
-        // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
+    // Dispatch message of pixel charges
+    auto pixel_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    messenger_->dispatchMessage(this, pixel_message);
+}
 
-        // Ignore if out of pixel grid
-        if(!detector_->isWithinPixelGrid(xpixel, ypixel)) {
-            LOG(TRACE) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
-                       << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
-                       << " because their nearest pixel (" << xpixel << "," << ypixel << ") is outside the grid";
-            continue;
-        }
+bool SimpleTransferModule::find_pixel(const ROOT::Math::XYZPoint& position,
+                                      unsigned int charge,
+                                      Pixel::Index& pixel_index) const {
+    // Ignore if outside depth range of implant
+    // FIXME This logic should be improved
+    if(std::fabs(position.z() - geometry_.getSensorTop()) > max_depth_distance_) {
+        LOG(TRACE) << "Skipping set of " << charge << " propagated charges at " << Units::display(position, {"mm", "um"})
+                   << " because their local position is not in implant range";
+        return false;
+    }
 
-        // Ignore if outside the implant region:
-        if(config_.get<bool>("collect_from_implant") && !detector_->isWithinImplant(position)) {
-            LOG(TRACE) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
-                       << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
-                       << " because it is outside the pixel implant.";
-            continue;
-        }
+    // Find the nearest pixel
+    auto [xpixel, ypixel] = geometry_.getPixel(position);
 
-        Pixel::Index pixel_index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel));
+    // Ignore if out of pixel grid
+    if(!geometry_.isWithinPixelGrid(xpixel, ypixel)) {
+        LOG(TRACE) << "Skipping set of " << charge << " propagated charges at " << Units::display(position, {"mm", "um"})
+                   << " because their nearest pixel (" << xpixel << "," << ypixel << ") is outside the grid";
+        return false;
+    }
 
-        // Update statistics
-        unique_pixels_.insert(pixel_index);
-        transferred_charges_count += propagated_charge.getCharge();
+    // Ignore if outside the implant region:
+    if(collect_from_implant_ && !geometry_.isWithinImplant(position)) {
+        LOG(TRACE) << "Skipping set of " << charge << " propagated charges at " << Units::display(position, {"mm", "um"})
+                   << " because it is outside the pixel implant.";
+        return false;
+    }
 
-        if(output_plots_) {
-            drift_time_histo->Fill(propagated_charge.getEventTime(), propagated_charge.getCharge());
-        }
+    pixel_index = Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel));
 
-        LOG(TRACE) << "Set of " << propagated_charge.getCharge() << " propagated charges at "
-                   << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"}) << " brought to pixel "
-                   << pixel_index;
+    // Ignore if outside the region of interest of the detector
+    if(!detector_->isWithinRegionOfInterest(pixel_index)) {
+        LOG(TRACE) << "Skipping set of " << charge << " propagated charges at " << Units::display(position, {"mm", "um"})
+                   << " because their pixel " << pixel_index << " is outside the region of interest";
+        return false;
+    }
+
+    LOG(TRACE) << "Set of " << charge << " propagated charges at " << Units::display(position, {"mm", "um"})
+               << " brought to pixel " << pixel_index;
+    return true;
+}
 
-        // Add the pixel the list of hit pixels
-        pixel_map[pixel_index].emplace_back(&propagated_charge);
+/**
+ * The propagated charges of all messages are accumulated before combining them, such that charges of different messages
+ * arriving at the same pixel end up in a single pixel charge.
+ */
+unsigned int
+SimpleTransferModule::transfer_charges(const std::vector<std::shared_ptr<PropagatedChargeMessage>>& propagated_messages,
+                                       std::vector<PixelCharge>& pixel_charges) {
+    unsigned int transferred_charges_count = 0;
+    // Accumulator kept per thread to reuse its memory across events
+    thread_local PixelAccumulator<const PropagatedCharge*> pixel_map;
+    pixel_map.reset(model_->getNPixels());
+    for(auto& propagated_message : propagated_messages) {
+        for(auto& propagated_charge : propagated_message->getData()) {
+            Pixel::Index pixel_index;
+            if(!find_pixel(propagated_charge.getLocalPosition(), propagated_charge.getCharge(), pixel_index)) {
+                continue;
+            }
+
+            // Update statistics
+            transferred_charges_count += propagated_charge.getCharge();
+
+            if(output_plots_) {
+                drift_time_histo->Fill(propagated_charge.getEventTime(), propagated_charge.getCharge());
+            }
+
+            // Add the pixel the list of hit pixels
+            pixel_map.add(pixel_index, &propagated_charge);
+        }
     }
 
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
-    std::vector<PixelCharge> pixel_charges;
-    for(auto& pixel_index_charge : pixel_map) {
+    std::vector<const PropagatedCharge*> pixel_propagated_charges;
+    pixel_map.forEachPixel([&](const Pixel::Index& pixel_index, auto begin, auto end) {
         unsigned int charge = 0;
-        for(auto& propagated_charge : pixel_index_charge.second) {
-            charge += propagated_charge->getCharge();
+        for(auto iter = begin; iter != end; ++iter) {
+            charge += (*iter)->getCharge();
         }
 
         // Get pixel object from detector
-        auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
+        auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
 
-        pixel_charges.emplace_back(pixel, charge, pixel_index_charge.second);
+        // Only link the propagated charges if the history is required
+        if(has_object_history()) {
+            pixel_propagated_charges.assign(begin, end);
+        }
+        pixel_charges.emplace_back(pixel, charge, pixel_propagated_charges);
         LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+    });
+    return transferred_charges_count;
+}
+
+/**
+ * Only the local positions, the charges and the deposits of the columnar sets are read, as well as the times if plots are
+ * requested. The charges of all messages are accumulated before combining them at the same pixel.
+ */
+unsigned int
+SimpleTransferModule::transfer_charges(const std::vector<std::shared_ptr<PropagatedChargeArrayMessage>>& propagated_messages,
+                                       std::vector<PixelCharge>& pixel_charges) {
+    unsigned int transferred_charges_count = 0;
+    // Accumulator of the charges and deposits of the sets kept per thread to reuse its memory across events
+    thread_local PixelAccumulator<std::pair<unsigned int, const DepositedCharge*>> pixel_map;
+    pixel_map.reset(model_->getNPixels());
+    for(auto& propagated_message : propagated_messages) {
+        const auto& propagated_charges = propagated_message->getData();
+        const auto& local_x = propagated_charges.getLocalX();
+        const auto& local_y = propagated_charges.getLocalY();
+        const auto& local_z = propagated_charges.getLocalZ();
+        const auto& charges = propagated_charges.getCharges();
+        const auto& deposited_charges = propagated_charges.getDepositedCharges();
+        for(size_t i = 0; i < propagated_charges.size(); ++i) {
+            Pixel::Index pixel_index;
+            if(!find_pixel(ROOT::Math::XYZPoint(local_x[i], local_y[i], local_z[i]), charges[i], pixel_index)) {
+                continue;
+            }
+
+            // Update statistics
+            transferred_charges_count += charges[i];
+
+            if(output_plots_) {
+                drift_time_histo->Fill(propagated_charges.getEventTimes()[i], charges[i]);
+            }
+
+            // Add the pixel the list of hit pixels
+            pixel_map.add(pixel_index, {charges[i], deposited_charges[i]});
+        }
     }
 
-    // Writing summary and update statistics
-    LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_map.size() << " pixels";
-    total_transferred_charges_ += transferred_charges_count;
+    // Create pixel charges
+    LOG(TRACE) << "Combining charges at same pixel";
+    std::vector<const DepositedCharge*> pixel_deposited_charges;
+    pixel_map.forEachPixel([&](const Pixel::Index& pixel_index, auto begin, auto end) {
+        unsigned int charge = 0;
+        pixel_deposited_charges.clear();
+        for(auto iter = begin; iter != end; ++iter) {
+            charge += iter->first;
+            if(has_object_history()) {
+                pixel_deposited_charges.push_back(iter->second);
+            }
+        }
 
-    // Dispatch message of pixel charges
-    auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector_);
-    messenger_->dispatchMessage(this, pixel_message);
+        // Get pixel object from detector
+        auto pixel = detector_->getPixel(pixel_index.x(), pixel_index.y());
+
+        pixel_charges.emplace_back(pixel, charge, pixel_deposited_charges);
+        LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
+    });
+    return transferred_charges_count;
 }
 
 void SimpleTransferModule::finalize() {
@@ -9,7 +9,9 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <TH1D.h>
@@ -22,6 +24,7 @@
 #include "objects/Pixel.hpp"
 #include "objects/PixelCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
+#include "objects/PropagatedChargeArray.hpp"
 
 namespace allpix {
     /**
@@ -32,6 +35,12 @@ namespace allpix {
      * This module does a simple direct mapping from propagated charges to the nearest pixel in the grid. It only considers
      * propagated charges within a certain distance from the implants and within the pixel grid, charges in the rest of the
      * sensor are ignored. The module combines all the propagated charges to a set of charges at a specific pixel.
+     *
+     * The propagated charges are either received as objects or in columnar form. In the latter case, the pixel charges are
+     * linked to the Monte-Carlo particles of the deposits instead of the propagated charges.
+     *
+     * The propagated charges of an event can be split into several messages, such as by the chunked dispatch of the
+     * GenericPropagation module, which are accumulated into a single set of pixel charges.
      */
     class SimpleTransferModule : public Module {
     public:
@@ -59,20 +68,52 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Find the pixel a set of propagated charges is transferred to
+         * @param position Local position of the propagated charges
+         * @param charge Number of propagated charges, only used for logging
+         * @param pixel_index Index of the pixel the charges are transferred to
+         * @return True if the charges are transferred, false if outside the implant range, pixel grid or region of interest
+         */
+        bool find_pixel(const ROOT::Math::XYZPoint& position, unsigned int charge, Pixel::Index& pixel_index) const;
+
+        /**
+         * @brief Transfer propagated charge objects to the pixels
+         * @param propagated_messages Messages with the propagated charges of the event
+         * @param pixel_charges List the pixel charges are appended to
+         * @return Number of transferred charges
+         */
+        unsigned int transfer_charges(const std::vector<std::shared_ptr<PropagatedChargeMessage>>& propagated_messages,
+                                      std::vector<PixelCharge>& pixel_charges);
+
+        /**
+         * @brief Transfer columnar propagated charges to the pixels
+         * @param propagated_messages Messages with the columnar sets of propagated charges of the event
+         * @param pixel_charges List the pixel charges are appended to
+         * @return Number of transferred charges
+         */
+        unsigned int transfer_charges(const std::vector<std::shared_ptr<PropagatedChargeArrayMessage>>& propagated_messages,
+                                      std::vector<PixelCharge>& pixel_charges);
+
         Messenger* messenger_;
         std::shared_ptr<Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
+        DetectorGeometryView geometry_;
 
-        // Message containing the propagated charges
-        std::shared_ptr<PropagatedChargeMessage> propagated_message_;
+        // Messages containing the propagated charges, only used to register the messages (fetched in the run method)
+        std::vector<std::shared_ptr<PropagatedChargeMessage>> propagated_messages_;
+        std::vector<std::shared_ptr<PropagatedChargeArrayMessage>> propagated_array_messages_;
 
         TH1D* drift_time_histo;
 
         // Flag whether to store output plots:
         bool output_plots_{};
+        double max_depth_distance_{};
+        bool collect_from_implant_{};
 
         // Statistical information
+        std::mutex stats_mutex_;
         unsigned int total_transferred_charges_{};
-        std::set<Pixel::Index> unique_pixels_;
+        std::unordered_set<PixelKey> unique_pixels_;
     };
 } // namespace allpix
@@ -10,6 +10,7 @@
 #include "TextWriterModule.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <utility>
 
@@ -27,6 +28,9 @@
 using namespace allpix;
 
 TextWriterModule::TextWriterModule(Configuration& config, Messenger* messenger, GeometryManager*) : Module(config) {
+    // Closing the text file does not interfere with the finalization of other modules
+    enable_parallel_finalization();
+
     // Bind to all messages
     messenger->registerListener(this, &TextWriterModule::receive);
 }
@@ -44,9 +48,20 @@ void TextWriterModule::init() {
     // Create output file
     output_file_name_ =
         createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name", "data"), "txt"), true);
-    output_file_ = std::make_unique<std::ofstream>(output_file_name_);
 
-    *output_file_ << "# Allpix Squared ASCII data - https://cern.ch/allpix-squared" << std::endl << std::endl;
+    // Use a large buffer for the output file, it is only flushed when full instead of on every line
+    auto buffer_size = config_.get<size_t>("buffer_size", 1048576);
+    output_file_ = std::make_unique<std::ofstream>();
+    if(buffer_size > 0) {
+        output_buffer_.resize(buffer_size);
+        output_file_->rdbuf()->pubsetbuf(output_buffer_.data(), static_cast<std::streamsize>(output_buffer_.size()));
+    }
+    output_file_->open(output_file_name_, std::ios_base::out | std::ios_base::binary);
+    if(!output_file_->good()) {
+        throw ModuleError("Cannot open output file " + output_file_name_);
+    }
+
+    *output_file_ << "# Allpix Squared ASCII data - https://cern.ch/allpix-squared\n\n";
 
     // Read include and exclude list
     if(config_.has("include") && config_.has("exclude")) {
@@ -58,6 +73,16 @@ void TextWriterModule::init() {
         auto exc_arr = config_.getArray<std::string>("exclude");
         exclude_.insert(exc_arr.begin(), exc_arr.end());
     }
+
+    // Write the events asynchronously if requested
+    auto async_queue_size = config_.get<size_t>("async_queue_size", 16);
+    if(async_queue_size == 0) {
+        throw InvalidValueError(config_, "async_queue_size", "queue size should be larger than zero");
+    }
+    if(config_.get<bool>("async_write", false)) {
+        LOG(DEBUG) << "Writing events asynchronously with a queue of " << async_queue_size << " events";
+        enable_async_tasks(async_queue_size);
+    }
 }
 
 void TextWriterModule::receive(std::shared_ptr<BaseMessage> message, std::string message_name) { // NOLINT
@@ -111,19 +136,22 @@ void TextWriterModule::receive(std::shared_ptr<BaseMessage> message, std::string
 void TextWriterModule::run(unsigned int event_num) {
     LOG(TRACE) << "Writing new objects to text file";
 
+    // Format the event in memory, such that it is written to the file in a single block
+    std::ostringstream event_text;
+
     // Print the current event:
-    *output_file_ << "=== " << event_num << " ===" << std::endl;
+    event_text << "=== " << event_num << " ===\n";
 
     for(auto& message : keep_messages_) {
         // Print the current detector:
         if(message->getDetector() != nullptr) {
-            *output_file_ << "--- " << message->getDetector()->getName() << " ---" << std::endl;
+            event_text << "--- " << message->getDetector()->getName() << " ---\n";
         } else {
-            *output_file_ << "--- <global> ---" << std::endl;
+            event_text << "--- <global> ---\n";
         }
         for(auto& object : message->getObjectArray()) {
             // Print the object's ASCII representation:
-            *output_file_ << object << std::endl;
+            event_text << object << '\n';
             write_cnt_++;
         }
         msg_cnt_++;
@@ -131,11 +159,24 @@ void TextWriterModule::run(unsigned int event_num) {
 
     // Clear the messages we have to keep because they contain the internal pointers
     keep_messages_.clear();
+
+    write_text(event_text.str());
+}
+
+void TextWriterModule::write_text(std::string text) {
+    // Write the text after all previous events, asynchronously if enabled
+    run_async([this, text = std::move(text)]() {
+        output_file_->write(text.data(), static_cast<std::streamsize>(text.size()));
+        if(!output_file_->good()) {
+            throw ModuleError("Cannot write to output file " + output_file_name_);
+        }
+    });
 }
 
 void TextWriterModule::finalize() {
     // Finish writing to output file
     *output_file_ << "# " << write_cnt_ << " objects from " << msg_cnt_ << " messages" << std::endl;
+    output_file_->close();
 
     // Print statistics
     LOG(STATUS) << "Wrote " << write_cnt_ << " objects from " << msg_cnt_ << " messages to file:" << std::endl
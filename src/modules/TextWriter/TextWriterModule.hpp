@@ -10,6 +10,7 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -22,6 +23,10 @@ namespace allpix {
      * @brief Module to write object data to simple ASCII text files
      *
      * Listens to all objects dispatched in the framework and stores an ASCII representation of every object to file.
+     *
+     * The text of every event is formatted in memory and written to the file in a single block through a large buffer. If
+     * asynchronous writing is enabled, the blocks are written by the asynchronous task thread of the module, such
+     * that writing to disk runs at the same time as the simulation of the next events.
      */
     class TextWriterModule : public Module {
     public:
@@ -45,7 +50,7 @@ namespace allpix {
         void receive(std::shared_ptr<BaseMessage> message, std::string name);
 
         /**
-         * @brief Opens the file to write the objects to
+         * @brief Opens the file to write the objects to and enables asynchronous writing if requested
          */
         void init() override;
 
@@ -61,6 +66,12 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Write a block of text to the output file, either directly or as asynchronous task
+         * @param text Formatted text of an event
+         */
+        void write_text(std::string text);
+
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
@@ -68,6 +79,7 @@ namespace allpix {
         // Output data file to write
         std::string output_file_name_{};
         std::unique_ptr<std::ofstream> output_file_;
+        std::vector<char> output_buffer_;
 
         // List of messages to keep so they can be stored in the tree
         std::vector<std::shared_ptr<BaseMessage>> keep_messages_;
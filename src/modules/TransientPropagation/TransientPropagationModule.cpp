@@ -9,17 +9,24 @@
 
 #include "TransientPropagationModule.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <map>
 #include <memory>
 #include <random>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
 #include "core/utils/log.h"
 #include "objects/PixelCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
+#include "tools/charge_grouping.h"
+#include "tools/normal_pool.h"
+#include "tools/pixel_accumulator.h"
 #include "tools/runge_kutta.h"
 
 using namespace allpix;
@@ -31,8 +38,10 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
     : Module(config, detector), detector_(std::move(detector)), messenger_(messenger) {
     using XYVectorInt = DisplacementVector2D<Cartesian2D<int>>;
 
-    // Enable parallelization of this module if multithreading is enabled:
+    // Enable parallelization of this module if multithreading is enabled, the histograms are filled per thread such that
+    // also several events can be propagated at the same time
     enable_parallelization();
+    enable_event_parallelization();
 
     // Save detector model
     model_ = detector_->getModel();
@@ -47,31 +56,64 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
     config_.setDefault<double>("timestep", Units::get(0.01, "ns"));
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<unsigned int>("charge_per_step", 10);
+    config_.setDefault<unsigned int>("max_charge_per_step", config_.get<unsigned int>("charge_per_step"));
+    config_.setDefault<double>("grouping_tolerance", 0.05);
     config_.setDefault<double>("temperature", 293.15);
     config_.setDefault<bool>("output_plots", false);
     config_.setDefault<XYVectorInt>("induction_matrix", XYVectorInt(3, 3));
+    config_.setDefault<double>("induction_threshold", 0);
     config_.setDefault<bool>("ignore_magnetic_field", false);
 
+    // By default the mobility is evaluated exactly for every step
+    config_.setDefault<double>("mobility_precision", 0);
+    config_.setDefault<double>("mobility_max_field", Units::get(100, "kV/cm"));
+
+    // By default the timestep is fixed instead of being adapted to the error of every step
+    config_.setDefault<bool>("timestep_error_control", false);
+    config_.setDefault<double>("spatial_precision", Units::get(0.25, "nm"));
+    config_.setDefault<double>("timestep_min", Units::get(0.001, "ns"));
+    config_.setDefault<double>("timestep_max", Units::get(0.5, "ns"));
+
+    // By default the carriers are propagated until they leave the sensor or the integration time is reached
+    config_.setDefault<double>("stop_velocity", 0);
+    config_.setDefault<double>("stop_potential_difference", 0);
+    config_.setDefault<unsigned int>("stop_steps", 10);
+
+    // By default the diffusion is drawn from a normal distribution created for every step
+    config_.setDefault<bool>("pooled_diffusion", false);
+
     // Copy some variables from configuration to avoid lookups:
     temperature_ = config_.get<double>("temperature");
     timestep_ = config_.get<double>("timestep");
+    timestep_error_control_ = config_.get<bool>("timestep_error_control");
+    target_spatial_precision_ = config_.get<double>("spatial_precision");
+    timestep_min_ = config_.get<double>("timestep_min");
+    timestep_max_ = config_.get<double>("timestep_max");
     integration_time_ = config_.get<double>("integration_time");
+    config_.bind("charge_per_step", charge_per_step_);
+    max_charge_per_step_ = config_.get<unsigned int>("max_charge_per_step");
+    grouping_tolerance_ = config_.get<double>("grouping_tolerance");
+    if(max_charge_per_step_ < charge_per_step_) {
+        throw InvalidValueError(config_, "max_charge_per_step", "should not be smaller than charge_per_step");
+    }
     matrix_ = config_.get<XYVectorInt>("induction_matrix");
+    induction_threshold_ = config_.get<double>("induction_threshold");
+    stop_velocity_ = config_.get<double>("stop_velocity");
+    stop_potential_difference_ = config_.get<double>("stop_potential_difference");
+    stop_steps_ = config_.get<unsigned int>("stop_steps");
+    pooled_diffusion_ = config_.get<bool>("pooled_diffusion");
 
     if(matrix_.x() % 2 == 0 || matrix_.y() % 2 == 0) {
         throw InvalidValueError(config_, "induction_matrix", "Odd number of pixels in x and y required.");
     }
+    if(induction_threshold_ < 0) {
+        throw InvalidValueError(config_, "induction_threshold", "threshold should not be negative");
+    }
 
     output_plots_ = config_.get<bool>("output_plots");
 
-    // Parameterization variables from https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2)
-    electron_Vm_ = Units::get(1.53e9 * std::pow(temperature_, -0.87), "cm/s");
-    electron_Ec_ = Units::get(1.01 * std::pow(temperature_, 1.55), "V/cm");
-    electron_Beta_ = 2.57e-2 * std::pow(temperature_, 0.66);
-
-    hole_Vm_ = Units::get(1.62e8 * std::pow(temperature_, -0.52), "cm/s");
-    hole_Ec_ = Units::get(1.24 * std::pow(temperature_, 1.68), "V/cm");
-    hole_Beta_ = 0.46 * std::pow(temperature_, 0.17);
+    // Mobility parameterization for the configured temperature
+    mobility_ = JacoboniCanaliMobility(temperature_);
 
     boltzmann_kT_ = Units::get(8.6173e-5, "eV/K") * temperature_;
 
@@ -84,12 +126,28 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
 void TransientPropagationModule::init() {
 
     auto detector = getDetector();
+    geometry_ = detector->getGeometryView();
 
     // Check for electric field
     if(!detector->hasElectricField()) {
         LOG(WARNING) << "This detector does not have an electric field.";
     }
 
+    // Precompute the mobility table if requested
+    auto mobility_precision = config_.get<double>("mobility_precision");
+    if(mobility_precision > 0) {
+        if(!mobility_.tabulate(config_.get<double>("mobility_max_field"), mobility_precision)) {
+            throw InvalidValueError(
+                config_, "mobility_precision", "precision of the mobility table cannot be reached, increase the value");
+        }
+        LOG(DEBUG) << "Interpolating mobility from table with " << mobility_.getTableBins() << " bins up to "
+                   << Units::display(config_.get<double>("mobility_max_field"), "V/cm");
+    }
+
+    if((stop_velocity_ > 0 || stop_potential_difference_ > 0) && stop_steps_ == 0) {
+        throw InvalidValueError(config_, "stop_steps", "at least one step is required to stop idle charge carriers");
+    }
+
     if(!detector_->hasWeightingPotential()) {
         throw ModuleError("This module requires a weighting potential.");
     }
@@ -107,53 +165,84 @@ void TransientPropagationModule::init() {
         } else {
             LOG(DEBUG) << "This detector sees a magnetic field.";
             magnetic_field_ = detector_->getMagneticField();
+            has_magnetic_field_grid_ = detector_->hasMagneticFieldGrid();
         }
     }
 
+    // The lateral drift in the magnetic field is not accounted for when grouping the carriers
+    if(has_magnetic_field_ && max_charge_per_step_ > charge_per_step_) {
+        LOG(WARNING) << "Carriers are not grouped adaptively in a magnetic field, using charge_per_step for all deposits";
+        max_charge_per_step_ = charge_per_step_;
+    }
+
+    // The grouping only probes the field at the time of the deposit
+    if(max_charge_per_step_ > charge_per_step_ && detector_->hasTimeDependentElectricField()) {
+        LOG(WARNING) << "Carriers are not grouped adaptively in a time-dependent electric field, using charge_per_step for "
+                        "all deposits";
+        max_charge_per_step_ = charge_per_step_;
+    }
+
     if(output_plots_) {
-        potential_difference_ =
-            new TH1D("potential_difference",
-                     "Weighting potential difference between two steps;#left|#Delta#phi_{w}#right| [a.u.];events",
-                     500,
-                     0,
-                     1);
-        induced_charge_histo_ = new TH1D("induced_charge_histo",
-                                         "Induced charge per time, all pixels;Drift time [ns];charge [e]",
-                                         static_cast<int>(integration_time_ / timestep_),
-                                         0,
-                                         static_cast<double>(Units::convert(integration_time_, "ns")));
-        induced_charge_e_histo_ = new TH1D("induced_charge_e_histo",
-                                           "Induced charge per time, electrons only, all pixels;Drift time [ns];charge [e]",
-                                           static_cast<int>(integration_time_ / timestep_),
-                                           0,
-                                           static_cast<double>(Units::convert(integration_time_, "ns")));
-        induced_charge_h_histo_ = new TH1D("induced_charge_h_histo",
-                                           "Induced charge per time, holes only, all pixels;Drift time [ns];charge [e]",
-                                           static_cast<int>(integration_time_ / timestep_),
-                                           0,
-                                           static_cast<double>(Units::convert(integration_time_, "ns")));
-        step_length_histo_ = new TH1D("step_length_histo",
-                                      "Step length;length [#mum];integration steps",
-                                      100,
-                                      0,
-                                      static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
-
-        drift_time_histo_ = new TH1D("drift_time_histo",
-                                     "Drift time;Drift time [ns];charge carriers",
-                                     static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                     0,
-                                     static_cast<double>(Units::convert(integration_time_, "ns")));
+        potential_difference_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "potential_difference",
+            "Weighting potential difference between two steps;#left|#Delta#phi_{w}#right| [a.u.];events",
+            500,
+            0,
+            1);
+        induced_charge_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "induced_charge_histo",
+            "Induced charge per time, all pixels;Drift time [ns];charge [e]",
+            static_cast<int>(integration_time_ / timestep_),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+        induced_charge_e_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "induced_charge_e_histo",
+            "Induced charge per time, electrons only, all pixels;Drift time [ns];charge [e]",
+            static_cast<int>(integration_time_ / timestep_),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+        induced_charge_h_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "induced_charge_h_histo",
+            "Induced charge per time, holes only, all pixels;Drift time [ns];charge [e]",
+            static_cast<int>(integration_time_ / timestep_),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+        step_length_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "step_length_histo",
+            "Step length;length [#mum];integration steps",
+            100,
+            0,
+            static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
+
+        drift_time_histo_ =
+            std::make_unique<ThreadedHistogram<TH1D>>("drift_time_histo",
+                                                      "Drift time;Drift time [ns];charge carriers",
+                                                      static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+                                                      0,
+                                                      static_cast<double>(Units::convert(integration_time_, "ns")));
     }
 }
 
 void TransientPropagationModule::run(unsigned int) {
+    // Fetch the deposits of the current event
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this);
+
+    // Use a random generator for this event only if the modules are seeded for every event
+    std::mt19937_64 event_random_generator;
+    if(has_event_seeding()) {
+        event_random_generator.seed(getEventSeed());
+    }
+    auto& random_generator = has_event_seeding() ? event_random_generator : random_generator_;
 
     // Create vector of propagated charges to output
     std::vector<PropagatedCharge> propagated_charges;
+    unsigned long stopped_sets = 0;
+    unsigned long saved_sets = 0;
+    PropagationCounters counters;
 
     // Loop over all deposits for propagation
     LOG(TRACE) << "Propagating charges in sensor";
-    for(auto& deposit : deposits_message_->getData()) {
+    for(auto& deposit : deposits_message->getData()) {
 
         // Loop over all charges in the deposit
         unsigned int charges_remaining = deposit.getCharge();
@@ -161,7 +250,15 @@ void TransientPropagationModule::run(unsigned int) {
         LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
                    << Units::display(deposit.getLocalPosition(), {"mm", "um"});
 
-        auto charge_per_step = config_.get<unsigned int>("charge_per_step");
+        // Merge the carriers into larger sets if they drift uniformly and stay within the pixel they are deposited below
+        auto charge_per_step = charge_per_step_;
+        if(max_charge_per_step_ > charge_per_step_ &&
+           is_uniform_drift(*detector_, deposit.getLocalPosition(), deposit.getType(), boltzmann_kT_, grouping_tolerance_)) {
+            charge_per_step = max_charge_per_step_;
+            saved_sets += (charges_remaining + charge_per_step_ - 1) / charge_per_step_ -
+                          (charges_remaining + max_charge_per_step_ - 1) / max_charge_per_step_;
+            LOG(DEBUG) << "Propagating carriers in sets of up to " << charge_per_step << " charges";
+        }
         while(charges_remaining > 0) {
             // Define number of charges to be propagated and remove charges of this step from the total
             if(charge_per_step > charges_remaining) {
@@ -174,7 +271,18 @@ void TransientPropagationModule::run(unsigned int) {
 
             // Propagate a single charge deposit
             std::map<Pixel::Index, Pulse> px_map;
-            auto prop_pair = propagate(position, deposit.getType(), charge_per_step, px_map);
+            bool stopped = false;
+            auto prop_pair = propagate(position,
+                                       deposit.getType(),
+                                       charge_per_step,
+                                       deposit.getEventTime(),
+                                       random_generator,
+                                       px_map,
+                                       stopped,
+                                       counters);
+            if(stopped) {
+                ++stopped_sets;
+            }
 
             // Create a new propagated charge and add it to the list
             auto global_position = detector_->getGlobalPosition(prop_pair.first);
@@ -192,11 +300,23 @@ void TransientPropagationModule::run(unsigned int) {
             propagated_charges.push_back(std::move(propagated_charge));
 
             if(output_plots_) {
-                drift_time_histo_->Fill(static_cast<double>(Units::convert(prop_pair.second, "ns")), charge_per_step);
+                drift_time_histo_->fill(static_cast<double>(Units::convert(prop_pair.second, "ns")), charge_per_step);
             }
         }
     }
 
+    // Update statistics
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        total_sets_ += propagated_charges.size();
+        stopped_sets_ += stopped_sets;
+        saved_sets_ += saved_sets;
+        total_counters_ += counters;
+        for(const auto& [name, value] : total_counters_.getValues()) {
+            setMetric(name, value);
+        }
+    }
+
     // Create a new message with propagated charges
     auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
 
@@ -212,25 +332,20 @@ void TransientPropagationModule::run(unsigned int) {
 std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(const ROOT::Math::XYZPoint& pos,
                                                                               const CarrierType& type,
                                                                               const unsigned int charge,
-                                                                              std::map<Pixel::Index, Pulse>& pixel_map) {
+                                                                              const double initial_time,
+                                                                              std::mt19937_64& random_generator,
+                                                                              std::map<Pixel::Index, Pulse>& pixel_map,
+                                                                              bool& stopped,
+                                                                              PropagationCounters& counters) {
 
     // Create a runge kutta solver using the electric field as step function
     Eigen::Vector3d position(pos.x(), pos.y(), pos.z());
 
+    // Pool of normal random numbers for the diffusion, only filled if requested
+    NormalPool<std::mt19937_64> normal_pool(random_generator);
+
     // Define a lambda function to compute the carrier mobility
-    // NOTE This function is typically the most frequently executed part of the framework and therefore the bottleneck
-    auto carrier_mobility = [&](double efield_mag) {
-        // Compute carrier mobility from constants and electric field magnitude
-        double numerator, denominator;
-        if(type == CarrierType::ELECTRON) {
-            numerator = electron_Vm_ / electron_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
-        } else {
-            numerator = hole_Vm_ / hole_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
-        }
-        return numerator / denominator;
-    };
+    auto carrier_mobility = [&](double efield_mag) { return mobility_(type, efield_mag); };
 
     // Define a function to compute the diffusion
     auto carrier_diffusion = [&](double efield_mag, double timestep) -> Eigen::Vector3d {
@@ -238,30 +353,32 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         double diffusion_std_dev = std::sqrt(2. * diffusion_constant * timestep);
 
         // Compute the independent diffusion in three
-        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
         Eigen::Vector3d diffusion;
+        if(pooled_diffusion_) {
+            for(int i = 0; i < 3; ++i) {
+                diffusion[i] = normal_pool(diffusion_std_dev);
+            }
+            return diffusion;
+        }
+        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
         for(int i = 0; i < 3; ++i) {
-            diffusion[i] = gauss_distribution(random_generator_);
+            diffusion[i] = gauss_distribution(random_generator);
         }
         return diffusion;
     };
 
     // Define lambda functions to compute the charge carrier velocity with or without magnetic field
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_noB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-
+    auto carrier_velocity_noB = [&](const Eigen::Vector3d& efield) -> Eigen::Vector3d {
         return static_cast<int>(type) * carrier_mobility(efield.norm()) * efield;
     };
 
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_withB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-
-        Eigen::Vector3d velocity;
-        Eigen::Vector3d bfield(magnetic_field_.x(), magnetic_field_.y(), magnetic_field_.z());
+    auto carrier_velocity_withB = [&](const Eigen::Vector3d& efield, const Eigen::Vector3d& pos) -> Eigen::Vector3d {
+        Eigen::Vector3d bfield;
+        if(has_magnetic_field_grid_) {
+            detector_->getMagneticField(pos.data(), bfield.data());
+        } else {
+            magnetic_field_.GetCoordinates(bfield.data());
+        }
 
         auto mob = carrier_mobility(efield.norm());
         auto exb = efield.cross(bfield);
@@ -276,45 +393,109 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
     };
 
+    // Step function of the solver, selecting the velocity calculator depending on the magnetic field. The lambda is passed
+    // to the solver by type, which allows the compiler to inline it into the integration.
+    FieldTimeBracket field_bracket;
+    auto carrier_velocity = [&](double t, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        Eigen::Vector3d efield;
+        detector_->getElectricField(cur_pos.data(), initial_time + t, field_bracket, efield.data());
+        counters.addFieldLookup(efield.squaredNorm() == 0);
+
+        return (has_magnetic_field_ ? carrier_velocity_withB(efield, cur_pos) : carrier_velocity_noB(efield));
+    };
+
     // Create the runge kutta solver with an RKF5 tableau
-    auto runge_kutta = make_runge_kutta(
-        tableau::RK5, (has_magnetic_field_ ? carrier_velocity_withB : carrier_velocity_noB), timestep_, position);
+    auto runge_kutta = make_runge_kutta(tableau::RK5, carrier_velocity, timestep_, position);
+    StepSizeController<double> step_controller(target_spatial_precision_, timestep_min_, timestep_max_);
+
+    // Weighting potentials of the pixel matrix around the carrier, evaluated at the end of the previous step. The end point
+    // of every step is the start point of the next one, such that only pixels entering the matrix need a new lookup of the
+    // potential at the last position.
+    const int matrix_width = 2 * (matrix_.x() / 2) + 1;
+    const int matrix_height = 2 * (matrix_.y() / 2) + 1;
+    const auto matrix_size = static_cast<size_t>(matrix_width) * static_cast<size_t>(matrix_height);
+    thread_local std::vector<double> last_potentials;
+    thread_local std::vector<double> potentials;
+    last_potentials.resize(matrix_size);
+    potentials.resize(matrix_size);
+    int last_matrix_x = 0, last_matrix_y = 0;
+    bool has_last_potentials = false;
+
+    // Weighting potentials of the pixels at which charge has last been induced on them, only used if pixels with a small
+    // change of the potential are pruned. The change is accumulated over the pruned steps, such that no charge is lost.
+    const bool prune_induction = (induction_threshold_ > 0);
+    thread_local std::vector<double> last_references;
+    thread_local std::vector<double> references;
+    if(prune_induction) {
+        last_references.resize(matrix_size);
+        references.resize(matrix_size);
+    }
+
+    // Charges induced on every pixel along the path with their times, added to the pulses at once after the propagation.
+    // The accumulator of this thread is reused for all sets, such that the steps only fill its preallocated lookup table.
+    thread_local PixelAccumulator<std::pair<double, double>> induced_charges;
+    induced_charges.reset(model_->getNPixels());
+
+    // Carriers are idle if they barely move or barely change the weighting potential of the surrounding pixels
+    const bool stop_idle = (stop_velocity_ > 0 || stop_potential_difference_ > 0);
+    unsigned int idle_steps = 0;
 
-    // Continue propagation until the deposit is outside the sensor
+    // Continue propagation until the deposit is outside the sensor or has been idle for the configured number of steps
     Eigen::Vector3d last_position = position;
+    double last_time = 0;
     bool within_sensor = true;
-    while(within_sensor && runge_kutta.getTime() < integration_time_) {
+    stopped = false;
+    unsigned long steps = 0;
+    while(within_sensor && !stopped && runge_kutta.getTime() < integration_time_) {
         // Save previous position and time
         last_position = position;
+        last_time = runge_kutta.getTime();
 
         // Execute a Runge Kutta step
         auto step = runge_kutta.step();
 
+        // Repeat the step from the previous position with a reduced timestep if its error exceeds the target precision
+        auto timestep = runge_kutta.getTimeStep();
+        if(timestep_error_control_) {
+            auto next_timestep = timestep;
+            if(!step_controller.update(step.error.norm(), next_timestep)) {
+                runge_kutta.setValue(last_position);
+                runge_kutta.setTime(last_time);
+                runge_kutta.setTimeStep(next_timestep);
+                ++counters.rejected_steps;
+                continue;
+            }
+            runge_kutta.setTimeStep(next_timestep);
+        }
+        ++steps;
+
         // Get the current result
         position = runge_kutta.getValue();
 
         // Get electric field at current position and fall back to empty field if it does not exist
-        auto efield = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(position));
+        Eigen::Vector3d efield;
+        detector_->getElectricField(position.data(), initial_time + runge_kutta.getTime(), field_bracket, efield.data());
+        counters.addFieldLookup(efield.squaredNorm() == 0);
 
         // Apply diffusion step
-        auto diffusion = carrier_diffusion(std::sqrt(efield.Mag2()), timestep_);
+        auto diffusion = carrier_diffusion(efield.norm(), timestep);
         position += diffusion;
         runge_kutta.setValue(position);
 
         // Update step length histogram
         if(output_plots_) {
-            step_length_histo_->Fill(static_cast<double>(Units::convert(step.value.norm(), "um")));
+            step_length_histo_->fill(static_cast<double>(Units::convert(step.value.norm(), "um")));
         }
 
         // Check for overshooting outside the sensor and correct for it:
-        if(!detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
+        if(!geometry_.isWithinSensor(position)) {
             LOG(TRACE) << "Carrier outside sensor: " << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"nm"});
             // within_sensor = false;
 
             auto check_position = position;
             check_position.z() = last_position.z();
             // Correct for position in z by interpolation to increase precision:
-            if(detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(check_position))) {
+            if(geometry_.isWithinSensor(check_position)) {
                 // FIXME this currently depends in the direction of the drift
                 if(position.z() > 0 && type == CarrierType::HOLE) {
                     LOG(DEBUG) << "Not stopping carrier " << type << " at "
@@ -338,61 +519,205 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         }
 
         // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
+        auto [xpixel, ypixel] = geometry_.getPixel(position);
         LOG(TRACE) << "Moving carriers below pixel "
                    << Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel)) << " from "
                    << Units::display(static_cast<ROOT::Math::XYZPoint>(last_position), {"um", "mm"}) << " to "
                    << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"um", "mm"}) << ", "
                    << Units::display(runge_kutta.getTime(), "ns");
 
+        // Steps longer than the binning of the pulses are split into sub-steps along a straight line, such that the induced
+        // charge is distributed over all bins the step covers
+        const int substeps = std::max(1, static_cast<int>(std::ceil(timestep / timestep_ - 1e-6)));
+
         // Loop over NxN pixels:
-        for(int x = xpixel - matrix_.x() / 2; x <= xpixel + matrix_.x() / 2; x++) {
-            for(int y = ypixel - matrix_.y() / 2; y <= ypixel + matrix_.y() / 2; y++) {
+        const int matrix_x = xpixel - matrix_.x() / 2;
+        const int matrix_y = ypixel - matrix_.y() / 2;
+        detector_->getWeightingPotentials(
+            static_cast<ROOT::Math::XYZPoint>(position), xpixel, ypixel, matrix_.x(), matrix_.y(), potentials);
+        counters.addPotentialLookups(matrix_size);
+        // In the first step all pixels enter the matrix and need the potential at the last position
+        if(!has_last_potentials) {
+            detector_->getWeightingPotentials(
+                static_cast<ROOT::Math::XYZPoint>(last_position), xpixel, ypixel, matrix_.x(), matrix_.y(), last_potentials);
+            counters.addPotentialLookups(matrix_size);
+            last_matrix_x = matrix_x;
+            last_matrix_y = matrix_y;
+            has_last_potentials = true;
+            if(prune_induction) {
+                last_references = last_potentials;
+            }
+        }
+        double max_potential_difference = 0;
+        for(int x = matrix_x; x <= xpixel + matrix_.x() / 2; x++) {
+            for(int y = matrix_y; y <= ypixel + matrix_.y() / 2; y++) {
                 // Ignore if out of pixel grid
-                if(!detector_->isWithinPixelGrid(x, y)) {
+                if(!geometry_.isWithinPixelGrid(x, y)) {
                     LOG(TRACE) << "Pixel (" << x << "," << y << ") skipped, outside the grid";
                     continue;
                 }
 
                 Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
-                auto ramo = detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(position), pixel_index);
-                auto last_ramo =
-                    detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(last_position), pixel_index);
-
-                // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
-                auto induced = charge * (ramo - last_ramo) * (-static_cast<std::underlying_type<CarrierType>::type>(type));
-                LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo - last_ramo) << ", induced " << type
-                           << " q = " << Units::display(induced, "e");
-
-                // Create pulse if it doesn't exist. Store induced charge in the returned pulse iterator
-                auto pixel_map_iterator = pixel_map.emplace(pixel_index, Pulse(timestep_));
-                pixel_map_iterator.first->second.addCharge(induced, runge_kutta.getTime());
-
-                if(output_plots_) {
-                    potential_difference_->Fill(std::fabs(ramo - last_ramo));
-                    induced_charge_histo_->Fill(runge_kutta.getTime(), induced);
-                    if(type == CarrierType::ELECTRON) {
-                        induced_charge_e_histo_->Fill(runge_kutta.getTime(), induced);
-                    } else {
-                        induced_charge_h_histo_->Fill(runge_kutta.getTime(), induced);
+                auto ramo = potentials[static_cast<size_t>((x - matrix_x) * matrix_height + (y - matrix_y))];
+
+                // Reuse the potential at the last position if the pixel was part of the matrix in the previous step
+                double last_ramo = 0;
+                auto last_x = x - last_matrix_x;
+                auto last_y = y - last_matrix_y;
+                if(last_x >= 0 && last_x < matrix_width && last_y >= 0 && last_y < matrix_height) {
+                    last_ramo = last_potentials[static_cast<size_t>(last_x * matrix_height + last_y)];
+                } else {
+                    last_ramo =
+                        detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(last_position), pixel_index);
+                    counters.addPotentialLookups(1);
+                }
+
+                max_potential_difference = std::max(max_potential_difference, std::fabs(ramo - last_ramo));
+
+                // Skip pixels whose potential changed by less than the threshold since charge was last induced on them
+                if(prune_induction) {
+                    auto reference = last_ramo;
+                    if(last_x >= 0 && last_x < matrix_width && last_y >= 0 && last_y < matrix_height) {
+                        reference = last_references[static_cast<size_t>(last_x * matrix_height + last_y)];
+                    }
+                    auto slot = static_cast<size_t>((x - matrix_x) * matrix_height + (y - matrix_y));
+                    if(std::fabs(ramo - reference) < induction_threshold_) {
+                        references[slot] = reference;
+                        ++counters.pruned_inductions;
+                        continue;
+                    }
+                    references[slot] = ramo;
+                    last_ramo = reference;
+                }
+
+                for(int substep = 1; substep <= substeps; ++substep) {
+                    auto substep_ramo = ramo;
+                    auto substep_time = runge_kutta.getTime();
+                    if(substep < substeps) {
+                        auto fraction = static_cast<double>(substep) / substeps;
+                        Eigen::Vector3d substep_position = last_position + fraction * (position - last_position);
+                        substep_ramo = detector_->getWeightingPotential(
+                            static_cast<ROOT::Math::XYZPoint>(substep_position), pixel_index);
+                        counters.addPotentialLookups(1);
+                        substep_time = last_time + fraction * (runge_kutta.getTime() - last_time);
+                    }
+
+                    // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
+                    auto induced = charge * (substep_ramo - last_ramo) *
+                                   (-static_cast<std::underlying_type<CarrierType>::type>(type));
+                    LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (substep_ramo - last_ramo) << ", induced "
+                               << type << " q = " << Units::display(induced, "e");
+                    induced_charges.add(pixel_index, {induced, substep_time});
+
+                    if(output_plots_) {
+                        potential_difference_->fill(std::fabs(substep_ramo - last_ramo));
+                        induced_charge_histo_->fill(substep_time, induced);
+                        if(type == CarrierType::ELECTRON) {
+                            induced_charge_e_histo_->fill(substep_time, induced);
+                        } else {
+                            induced_charge_h_histo_->fill(substep_time, induced);
+                        }
                     }
+                    last_ramo = substep_ramo;
                 }
             }
         }
+
+        // The potentials at the current position are the potentials at the last position of the next step
+        std::swap(potentials, last_potentials);
+        if(prune_induction) {
+            std::swap(references, last_references);
+        }
+        last_matrix_x = matrix_x;
+        last_matrix_y = matrix_y;
+        has_last_potentials = true;
+
+        // Stop the carriers once they have been idle for the configured number of consecutive steps
+        if(stop_idle && within_sensor) {
+            bool idle = (stop_potential_difference_ > 0 && max_potential_difference < stop_potential_difference_);
+            if(!idle && stop_velocity_ > 0) {
+                Eigen::Vector3d field(efield.x(), efield.y(), efield.z());
+                auto velocity =
+                    (has_magnetic_field_ ? carrier_velocity_withB(field, position) : carrier_velocity_noB(field));
+                idle = (velocity.norm() < stop_velocity_);
+            }
+            idle_steps = (idle ? idle_steps + 1 : 0);
+            if(idle_steps >= stop_steps_) {
+                LOG(TRACE) << "Stopping idle carrier at "
+                           << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"um"}) << " after "
+                           << Units::display(runge_kutta.getTime(), "ns");
+                stopped = true;
+            }
+        }
     }
 
+    // Induce the change of the potential accumulated over the last pruned steps at the end of the propagation
+    if(prune_induction && has_last_potentials) {
+        for(int x = last_matrix_x; x < last_matrix_x + matrix_width; x++) {
+            for(int y = last_matrix_y; y < last_matrix_y + matrix_height; y++) {
+                auto slot = static_cast<size_t>((x - last_matrix_x) * matrix_height + (y - last_matrix_y));
+                auto difference = last_potentials[slot] - last_references[slot];
+                if(!geometry_.isWithinPixelGrid(x, y) || difference == 0) {
+                    continue;
+                }
+                auto induced = charge * difference * (-static_cast<std::underlying_type<CarrierType>::type>(type));
+                induced_charges.add(Pixel::Index(static_cast<unsigned int>(x), static_cast<unsigned int>(y)),
+                                    {induced, runge_kutta.getTime()});
+            }
+        }
+    }
+
+    // Sets neither stopped nor outside of the sensor have reached the integration time
+    counters.integration_steps += steps;
+    counters.addSet(steps, within_sensor && !stopped);
+
+    // Add the induced charges to the pulses of the pixels at once, creating the pulses if they don't exist
+    thread_local std::vector<double> charges, times;
+    induced_charges.forEachPixel([&](const Pixel::Index& index, auto begin, auto end) {
+        charges.clear();
+        times.clear();
+        for(auto it = begin; it != end; ++it) {
+            charges.push_back(it->first);
+            times.push_back(it->second);
+        }
+        auto pulse = pixel_map.lower_bound(index);
+        if(pulse == pixel_map.end() || pulse->first != index) {
+            pulse = pixel_map.emplace_hint(pulse, index, Pulse(timestep_));
+        }
+        pulse->second.addCharges(charges, times);
+    });
+
     // Return the final position of the propagated charge
     return std::make_pair(static_cast<ROOT::Math::XYZPoint>(position), runge_kutta.getTime());
 }
 
 void TransientPropagationModule::finalize() {
+    if(stop_velocity_ > 0 || stop_potential_difference_ > 0) {
+        LOG(INFO) << "Stopped " << stopped_sets_ << " of " << total_sets_
+                  << " sets of charge carriers before the end of the integration time as they became idle";
+    }
+    if(max_charge_per_step_ > charge_per_step_) {
+        LOG(INFO) << "Saved the propagation of " << saved_sets_ << " sets of charge carriers by grouping them adaptively";
+    }
+    if(total_counters_.field_lookups > 0) {
+        LOG(INFO) << "Integrated " << total_counters_.integration_steps << " steps with " << total_counters_.rejected_steps
+                  << " rejected steps, " << total_counters_.field_lookups << " field lookups, of which "
+                  << total_counters_.zero_fields << " returned no field, and " << total_counters_.potential_lookups
+                  << " weighting potential lookups";
+        if(induction_threshold_ > 0) {
+            LOG(INFO) << "Pruned " << total_counters_.pruned_inductions
+                      << " inductions on pixels with a change of the weighting potential below the threshold";
+        }
+        LOG(INFO) << "Stopped " << total_counters_.timeouts << " sets at the integration time, steps per set "
+                  << total_counters_.getStepDistribution();
+    }
+
     if(output_plots_) {
-        potential_difference_->Write();
-        step_length_histo_->Write();
-        drift_time_histo_->Write();
-        induced_charge_histo_->Write();
-        induced_charge_e_histo_->Write();
-        induced_charge_h_histo_->Write();
+        potential_difference_->merge()->Write();
+        step_length_histo_->merge()->Write();
+        drift_time_histo_->merge()->Write();
+        induced_charge_histo_->merge()->Write();
+        induced_charge_e_histo_->merge()->Write();
+        induced_charge_h_histo_->merge()->Write();
     }
 }
@@ -7,6 +7,9 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
 
 #include <Math/DisplacementVector2D.h>
@@ -21,6 +24,9 @@
 #include "objects/DepositedCharge.hpp"
 #include "objects/Pulse.hpp"
 #include "tools/ROOT.h"
+#include "tools/mobility.h"
+#include "tools/propagation_counters.h"
+#include "tools/threaded_histogram.h"
 
 namespace allpix {
     /**
@@ -62,6 +68,8 @@ namespace allpix {
         std::shared_ptr<const Detector> detector_;
         Messenger* messenger_;
         std::shared_ptr<DetectorModel> model_;
+        DetectorGeometryView geometry_;
+        // Deposits for the bound detector in this event, only used to register the message (fetched in the run method)
         std::shared_ptr<DepositedChargeMessage> deposits_message_;
 
         /**
@@ -69,30 +77,42 @@ namespace allpix {
          * @param pos       Position of the deposit in the sensor
          * @param type      Type of the carrier to propagate
          * @param charge    Total charge of the observed charge carrier set
+         * @param initial_time Time of the deposit within the event, used for time-dependent electric fields
+         * @param random_generator Random generator used for the diffusion
          * @param pixel_map Map of surrounding pixels and their induced pulses. Provided as reference to store simulation
          *                  result in
+         * @param stopped   Set to true if the propagation was stopped early because the carriers became idle
+         * @param counters  Counters of the field lookups and integration steps which are updated for the set
          * @return          Pair of the point where the deposit ended after propagation and the time the propagation took
          */
         std::pair<ROOT::Math::XYZPoint, double> propagate(const ROOT::Math::XYZPoint& pos,
                                                           const CarrierType& type,
                                                           const unsigned int charge,
-                                                          std::map<Pixel::Index, Pulse>& pixel_map);
+                                                          const double initial_time,
+                                                          std::mt19937_64& random_generator,
+                                                          std::map<Pixel::Index, Pulse>& pixel_map,
+                                                          bool& stopped,
+                                                          PropagationCounters& counters);
 
         // Random generator for this module
         std::mt19937_64 random_generator_;
 
         // Local copies of configuration parameters to avoid costly lookup:
         double temperature_{}, timestep_{}, integration_time_{};
-        bool output_plots_{};
+        bool timestep_error_control_{};
+        double target_spatial_precision_{}, timestep_min_{}, timestep_max_{};
+        unsigned int charge_per_step_{}, max_charge_per_step_{};
+        double grouping_tolerance_{};
+        bool output_plots_{}, pooled_diffusion_{};
         ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>> matrix_;
+        double induction_threshold_{};
 
-        // Precalculated values for electron and hole mobility
-        double electron_Vm_;
-        double electron_Ec_;
-        double electron_Beta_;
-        double hole_Vm_;
-        double hole_Ec_;
-        double hole_Beta_;
+        // Criteria to stop the propagation of idle charge carriers before the end of the integration time
+        double stop_velocity_{}, stop_potential_difference_{};
+        unsigned int stop_steps_{};
+
+        // Mobility parameterization for electrons and holes
+        JacoboniCanaliMobility mobility_;
 
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
@@ -103,11 +123,20 @@ namespace allpix {
 
         // Magnetic field
         bool has_magnetic_field_;
+        bool has_magnetic_field_grid_{false};
         ROOT::Math::XYZVector magnetic_field_;
 
         // Output plots
-        TH1D *potential_difference_, *induced_charge_histo_, *induced_charge_e_histo_, *induced_charge_h_histo_;
-        TH1D* step_length_histo_;
-        TH1D* drift_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> potential_difference_, induced_charge_histo_, induced_charge_e_histo_,
+            induced_charge_h_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> step_length_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> drift_time_histo_;
+
+        // Statistical information
+        std::mutex stats_mutex_;
+        unsigned long total_sets_{};
+        unsigned long stopped_sets_{};
+        unsigned long saved_sets_{};
+        PropagationCounters total_counters_;
     };
 } // namespace allpix
@@ -23,6 +23,10 @@
 #endif
 
 #include <G4LogicalVolume.hh>
+#include <G4ParticleDefinition.hh>
+#include <G4ParticleTable.hh>
+#include <G4Polyline.hh>
+#include <G4Polymarker.hh>
 #include <G4RunManager.hh>
 #ifdef G4UI_USE_QT
 #include <G4UIQt.hh>
@@ -34,15 +38,19 @@
 #include <G4UIterminal.hh>
 #include <G4VPVParameterisation.hh>
 #include <G4VisAttributes.hh>
+#include <G4VVisManager.hh>
 #include <G4VisExecutive.hh>
 
 #include "core/config/exceptions.h"
 #include "core/utils/log.h"
+#include "core/utils/text.h"
 
 using namespace allpix;
 
-VisualizationGeant4Module::VisualizationGeant4Module(Configuration& config, Messenger*, GeometryManager* geo_manager)
-    : Module(config), geo_manager_(geo_manager), has_run_(false), session_param_ptr_(nullptr) {
+VisualizationGeant4Module::VisualizationGeant4Module(Configuration& config,
+                                                     Messenger* messenger,
+                                                     GeometryManager* geo_manager)
+    : Module(config), messenger_(messenger), geo_manager_(geo_manager), has_run_(false), session_param_ptr_(nullptr) {
     // Set default mode and driver for display
     config_.setDefault("mode", "gui");
     config_.setDefault("driver", "OGL");
@@ -53,8 +61,25 @@ VisualizationGeant4Module::VisualizationGeant4Module(Configuration& config, Mess
 
     // Check mode
     auto mode = config_.get<std::string>("mode");
-    if(mode != "gui" && mode != "terminal" && mode != "none") {
-        throw InvalidValueError(config_, "mode", "viewing mode should be 'gui', 'terminal' or 'none'");
+    if(mode != "gui" && mode != "terminal" && mode != "none" && mode != "batch") {
+        throw InvalidValueError(config_, "mode", "viewing mode should be 'gui', 'terminal', 'none' or 'batch'");
+    }
+
+    // Record the tracks and particles of the selected events in batch mode instead of updating the scene with every event
+    if(mode == "batch") {
+        batch_ = true;
+        config_.setDefault("batch_event_limit", 10u);
+        batch_event_limit_ = config_.get<unsigned int>("batch_event_limit");
+        if(config_.has("batch_events")) {
+            auto events = config_.getArray<unsigned int>("batch_events");
+            batch_event_list_.insert(events.begin(), events.end());
+        }
+
+        messenger_->bindSingle(this, &VisualizationGeant4Module::track_message_);
+        messenger_->bindMulti(this, &VisualizationGeant4Module::particle_messages_);
+
+        // Events only access the buffer of recorded events, such that several events can be processed at the same time
+        enable_event_parallelization();
     }
 }
 /**
@@ -175,6 +200,12 @@ void VisualizationGeant4Module::init() {
         UI->ApplyCommand("/control/execute " + config_.getPath("macro_init", true));
     }
 
+    // Do not update the scene during the run in batch mode, the recorded events are drawn at the end
+    if(batch_) {
+        set_batch_settings();
+        UI->ApplyCommand("/vis/disable");
+    }
+
     // Release the g4 output
     RELEASE_STREAM(G4cout);
 }
@@ -203,9 +234,9 @@ void VisualizationGeant4Module::set_visualization_settings() {
         UI->ApplyCommand("/vis/scene/endOfRunAction refresh");
     }
 
-    // Display trajectories if specified
+    // Display trajectories if specified, in batch mode the recorded tracks are drawn instead of the Geant4 trajectories
     auto display_trajectories = config_.get<bool>("display_trajectories", true);
-    if(display_trajectories) {
+    if(display_trajectories && !batch_) {
         // Add smooth trajectories
         UI->ApplyCommand("/vis/scene/add/trajectories smooth rich");
 
@@ -402,7 +433,92 @@ void VisualizationGeant4Module::set_visualization_attributes() {
     }
 }
 
-void VisualizationGeant4Module::run(unsigned int) {
+/**
+ * The colors are derived from the same parameters as the ones of the Geant4 trajectories, the charge and the name of the
+ * particles are taken from the particle table of Geant4.
+ */
+void VisualizationGeant4Module::set_batch_settings() {
+    auto get_colour = [this](const std::string& key, const std::string& def) {
+        G4Colour colour;
+        if(!G4Colour::GetColour(config_.get<std::string>(key, def), colour)) {
+            throw InvalidValueError(config_, key, "color not defined");
+        }
+        return colour;
+    };
+
+    auto traj_color = config_.get<std::string>("trajectories_color_mode", "charge");
+    if(traj_color == "generic") {
+        auto colour = get_colour("trajectories_color", "blue");
+        batch_track_colour_ = [colour](int) { return colour; };
+    } else if(traj_color == "charge") {
+        auto positive = get_colour("trajectories_color_positive", "blue");
+        auto neutral = get_colour("trajectories_color_neutral", "green");
+        auto negative = get_colour("trajectories_color_negative", "red");
+        batch_track_colour_ = [positive, neutral, negative](int particle_id) {
+            auto* particle = G4ParticleTable::GetParticleTable()->FindParticle(particle_id);
+            auto charge = (particle != nullptr ? particle->GetPDGCharge() : 0.);
+            return (charge > 0 ? positive : (charge < 0 ? negative : neutral));
+        };
+    } else if(traj_color == "particle") {
+        std::map<int, G4Colour> particle_colours;
+        for(auto& particle_color : config_.getArray<std::string>("trajectories_particle_colors")) {
+            auto combination = allpix::split<std::string>(particle_color, " \t");
+            G4Colour colour;
+            auto* particle = (combination.size() == 2 ? G4ParticleTable::GetParticleTable()->FindParticle(combination[0])
+                                                      : nullptr);
+            if(particle == nullptr || !G4Colour::GetColour(combination[1], colour)) {
+                throw InvalidValueError(
+                    config_, "trajectories_particle_colors", "combination particle type and color not valid");
+            }
+            particle_colours[particle->GetPDGEncoding()] = colour;
+        }
+        batch_track_colour_ = [particle_colours](int particle_id) {
+            auto colour = particle_colours.find(particle_id);
+            return (colour != particle_colours.end() ? colour->second : G4Colour::White());
+        };
+    } else {
+        throw InvalidValueError(config_, "trajectories_color_mode", "only 'generic', 'charge' or 'particle' are supported");
+    }
+
+    batch_step_colour_ = get_colour("trajectories_draw_step_color", "red");
+    batch_step_size_ = config_.get<double>("trajectories_draw_step_size", 2);
+}
+
+void VisualizationGeant4Module::run(unsigned int event) {
+    // Only copy the start and end points of the tracks and particles of the selected events in batch mode
+    if(batch_) {
+        if(batch_event_list_.empty() ? event > batch_event_limit_
+                                     : batch_event_list_.find(event) == batch_event_list_.end()) {
+            return;
+        }
+
+        BatchEvent batch_event;
+        auto to_array = [](const ROOT::Math::XYZPoint& point) {
+            return std::array<float, 3>{
+                {static_cast<float>(point.x()), static_cast<float>(point.y()), static_cast<float>(point.z())}};
+        };
+        auto track_message = messenger_->fetchMessage<MCTrackMessage>(this);
+        if(track_message != nullptr) {
+            batch_event.tracks.reserve(track_message->getData().size());
+            for(const auto& track : track_message->getData()) {
+                batch_event.tracks.push_back(
+                    {to_array(track.getStartPoint()), to_array(track.getEndPoint()), track.getParticleID()});
+            }
+        }
+        for(const auto& particle_message : messenger_->fetchMultiMessage<MCParticleMessage>(this)) {
+            for(const auto& particle : particle_message->getData()) {
+                batch_event.steps.push_back(to_array(particle.getGlobalStartPoint()));
+                batch_event.steps.push_back(to_array(particle.getGlobalEndPoint()));
+            }
+        }
+
+        LOG(DEBUG) << "Recorded " << batch_event.tracks.size() << " tracks and " << batch_event.steps.size() / 2
+                   << " particles in the sensors";
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        batch_events_.emplace(event, std::move(batch_event));
+        return;
+    }
+
     if(!config_.get<bool>("accumulate")) {
         vis_manager_g4_->GetCurrentViewer()->ShowView();
         std::this_thread::sleep_for(
@@ -456,10 +572,71 @@ void VisualizationGeant4Module::add_visualization_volumes() {
     }
 }
 
+/**
+ * The recorded events are drawn as transient objects of the scene. If the events are accumulated, all of them are shown in a
+ * single view, otherwise the view is shown separately for every event, which writes a file per event for file drivers.
+ */
+void VisualizationGeant4Module::draw_batch_events() {
+    G4UImanager* UI = G4UImanager::GetUIpointer();
+    UI->ApplyCommand("/vis/enable");
+
+    auto* vis_manager = G4VVisManager::GetConcreteInstance();
+    if(vis_manager == nullptr) {
+        LOG(WARNING) << "Cannot draw recorded events, no valid viewer available";
+        return;
+    }
+
+    auto accumulate = config_.get<bool>("accumulate");
+    auto display_trajectories = config_.get<bool>("display_trajectories", true);
+    auto draw_steps = config_.get<bool>("trajectories_draw_step", true);
+    auto to_point = [](const std::array<float, 3>& point) { return G4Point3D(point[0], point[1], point[2]); };
+    for(const auto& [event, batch_event] : batch_events_) {
+        LOG(DEBUG) << "Drawing recorded event " << event;
+        vis_manager->BeginDraw();
+        if(display_trajectories) {
+            for(const auto& track : batch_event.tracks) {
+                G4Polyline polyline;
+                polyline.push_back(to_point(track.start));
+                polyline.push_back(to_point(track.end));
+                polyline.SetVisAttributes(G4VisAttributes(batch_track_colour_(track.particle_id)));
+                vis_manager->Draw(polyline);
+            }
+        }
+        if(draw_steps && !batch_event.steps.empty()) {
+            G4Polymarker polymarker;
+            polymarker.SetMarkerType(G4Polymarker::circles);
+            polymarker.SetScreenSize(batch_step_size_);
+            for(const auto& step : batch_event.steps) {
+                polymarker.push_back(to_point(step));
+            }
+            polymarker.SetVisAttributes(G4VisAttributes(batch_step_colour_));
+            vis_manager->Draw(polymarker);
+        }
+        vis_manager->EndDraw();
+
+        if(!accumulate) {
+            vis_manager_g4_->GetCurrentViewer()->ShowView();
+            UI->ApplyCommand("/vis/viewer/clearTransients");
+        }
+    }
+    LOG(INFO) << "Drew " << batch_events_.size() << " recorded events";
+}
+
 void VisualizationGeant4Module::finalize() {
     // Add volumes that are only used in the visualization
     add_visualization_volumes();
 
+    // Build the scene from all recorded events in batch mode
+    if(batch_) {
+        draw_batch_events();
+        if(config_.get<bool>("accumulate")) {
+            LOG(INFO) << "Starting viewer";
+            vis_manager_g4_->GetCurrentViewer()->ShowView();
+        }
+        has_run_ = true;
+        return;
+    }
+
     // Enable automatic refresh before showing view
     G4UImanager* UI = G4UImanager::GetUIpointer();
     UI->ApplyCommand("/vis/viewer/set/autoRefresh true");
@@ -10,14 +10,25 @@
 #ifndef ALLPIX_TEST_VISUALIZATION_MODULE_H
 #define ALLPIX_TEST_VISUALIZATION_MODULE_H
 
+#include <array>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <vector>
+
+#include <G4Colour.hh>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
 
+#include "objects/MCParticle.hpp"
+#include "objects/MCTrack.hpp"
+
 class G4UIsession;
 class G4VisManager;
 
@@ -28,6 +39,10 @@ namespace allpix {
      *
      * Displays the geometry constructed in \ref GeometryBuilderGeant4Module. Allows passing a variety of options to
      * configure both the visualization viewer as well as the display of the various detector components and the beam.
+     *
+     * In batch mode, the Geant4 scene is not updated during the run. Instead, the Monte-Carlo tracks and the particles
+     * passing the sensors of selected events are recorded into a compact buffer, and the scene is only built from them at
+     * the end of the run, such that the visualization does not slow down the simulation of the events.
      */
     class VisualizationGeant4Module : public Module {
     public:
@@ -49,7 +64,7 @@ namespace allpix {
         void init() override;
 
         /**
-         * @brief Show visualization updates if not accumulating data
+         * @brief Show visualization updates if not accumulating data, or record the event in batch mode
          */
         void run(unsigned int) override;
 
@@ -59,6 +74,7 @@ namespace allpix {
         void finalize() override;
 
     private:
+        Messenger* messenger_;
         GeometryManager* geo_manager_;
 
         /**
@@ -73,6 +89,39 @@ namespace allpix {
          * @brief Add visualization volumes, added at the end to prevent cluttering the geometry during deposition
          */
         void add_visualization_volumes();
+        /**
+         * @brief Set the colors used to draw the events recorded in batch mode from the configuration
+         */
+        void set_batch_settings();
+        /**
+         * @brief Draw the events recorded in batch mode
+         */
+        void draw_batch_events();
+
+        // Track and particle segments of an event recorded in batch mode, stored in single precision to keep them compact
+        struct BatchTrack {
+            std::array<float, 3> start;
+            std::array<float, 3> end;
+            int particle_id;
+        };
+        struct BatchEvent {
+            std::vector<BatchTrack> tracks;
+            std::vector<std::array<float, 3>> steps;
+        };
+
+        // Record the events in batch mode, only drawing them at the end of the run
+        bool batch_{false};
+        std::set<unsigned int> batch_event_list_;
+        unsigned int batch_event_limit_{};
+        std::map<unsigned int, BatchEvent> batch_events_;
+        std::mutex batch_mutex_;
+        std::function<G4Colour(int)> batch_track_colour_;
+        G4Colour batch_step_colour_;
+        double batch_step_size_{};
+
+        // Messages with the tracks and particles of the event, only bound in batch mode
+        std::shared_ptr<MCTrackMessage> track_message_;
+        std::vector<std::shared_ptr<MCParticleMessage>> particle_messages_;
 
         // Check if we did run successfully, used to apply workaround in destructor if needed
         bool has_run_;
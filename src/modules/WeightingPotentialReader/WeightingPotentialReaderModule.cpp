@@ -9,11 +9,16 @@
 
 #include "WeightingPotentialReaderModule.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <iomanip>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -22,6 +27,7 @@
 
 #include "core/config/exceptions.h"
 #include "core/geometry/DetectorModel.hpp"
+#include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
 
@@ -31,6 +37,8 @@ WeightingPotentialReaderModule::WeightingPotentialReaderModule(Configuration& co
                                                                Messenger*,
                                                                std::shared_ptr<Detector> detector)
     : Module(config, detector), detector_(std::move(detector)) {
+    // Allow the instantiations for the different detectors to read their potentials at the same time
+    enable_parallel_init();
 
     // NOTE Backwards-compatibility: interpret both "init" and "apf" as "mesh":
     auto model = config_.get<std::string>("model");
@@ -50,20 +58,59 @@ void WeightingPotentialReaderModule::init() {
 
     // Calculate the potential depending on the configuration
     if(field_model == "mesh") {
-        auto field_data = read_field(thickness_domain);
+        auto interpolation = get_interpolation();
+        auto storage = get_storage();
+        auto symmetry = get_symmetry();
+        auto load_potential = [this, thickness_domain, interpolation, storage, symmetry]() {
+            // Grids converted to another precision do not use the parsed data after this call
+            auto field_data = read_field(thickness_domain, storage == FieldStorage::DOUBLE);
+
+            // Quadrant grids cover half of the field cell in x and y
+            auto grid_factor = (symmetry == FieldSymmetry::QUADRANT ? 2.0 : 1.0);
+            detector_->setWeightingPotentialGrid(
+                field_data.getValues(),
+                field_data.getValuesSize(),
+                field_data.getDimensions(),
+                std::array<double, 2>{{grid_factor * field_data.getSize()[0], grid_factor * field_data.getSize()[1]}},
+                std::array<double, 2>{{0, 0}},
+                thickness_domain,
+                interpolation,
+                storage,
+                symmetry);
+        };
 
-        detector_->setWeightingPotentialGrid(field_data.getData(),
-                                             field_data.getDimensions(),
-                                             std::array<double, 2>{{field_data.getSize()[0], field_data.getSize()[1]}},
-                                             std::array<double, 2>{{0, 0}},
-                                             thickness_domain);
+        // Load the potential right away or only at its first lookup
+        if(config_.get<bool>("lazy_loading", false)) {
+            LOG(INFO) << "Weighting potential will be loaded at its first lookup";
+            if(!is_memory_mapped(storage)) {
+                LOG(WARNING) << "Lazy loading cannot bound the memory used by the weighting potential, which is kept in "
+                                "memory once loaded unless it is mapped from an APF2 file in double precision";
+            }
+            detector_->setWeightingPotentialGridLoader(load_potential, thickness_domain);
+        } else {
+            load_potential();
+        }
     } else if(field_model == "pad") {
         LOG(TRACE) << "Adding weighting potential from pad in plane condenser";
 
         // Get pixel implant size from the detector model:
         auto implant = model->getImplantSize();
         auto function = get_pad_potential_function(implant, thickness_domain);
-        detector_->setWeightingPotentialFunction(function, thickness_domain, FieldType::CUSTOM);
+
+        // Tabulate the potential on a grid if requested, otherwise evaluate the function for every lookup
+        if(config_.get<bool>("tabulate", false)) {
+            auto field_data = tabulate_pad_potential(function, implant, thickness_domain);
+            detector_->setWeightingPotentialGrid(field_data.getValues(),
+                                                 field_data.getValuesSize(),
+                                                 field_data.getDimensions(),
+                                                 std::array<double, 2>{{field_data.getSize()[0], field_data.getSize()[1]}},
+                                                 std::array<double, 2>{{0, 0}},
+                                                 thickness_domain,
+                                                 get_interpolation(),
+                                                 get_storage());
+        } else {
+            detector_->setWeightingPotentialFunction(function, thickness_domain, FieldType::CUSTOM);
+        }
     } else {
         throw InvalidValueError(config_, "model", "model should be 'init' or `pad`");
     }
@@ -115,6 +162,178 @@ WeightingPotentialReaderModule::get_pad_potential_function(const ROOT::Math::XYV
     };
 }
 
+/**
+ * The potential is evaluated at the centers of the grid bins, which covers the given number of pixels centered around the
+ * reference pixel in x and y, and the full thickness domain in z. The pad potential is symmetric under mirroring in x and in
+ * y, such that only one quadrant of the grid is evaluated. If a cache directory is configured, the grid is stored in a file
+ * named after a hash of all parameters entering the calculation, and read back from there if a grid for the same parameters
+ * exists already.
+ */
+FieldData<double>
+WeightingPotentialReaderModule::tabulate_pad_potential(const FieldFunction<double>& function,
+                                                       const ROOT::Math::XYVector& implant,
+                                                       std::pair<double, double> thickness_domain) {
+    using XYVectorInt = ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>;
+
+    auto model = detector_->getModel();
+    auto pixels = config_.get<XYVectorInt>("tabulation_pixels", XYVectorInt(3, 3));
+    if(pixels.x() < 1 || pixels.y() < 1) {
+        throw InvalidValueError(config_, "tabulation_pixels", "number of pixels needs to be positive");
+    }
+    auto bin_size = config_.get<double>("tabulation_bin_size", Units::get(2.0, "um"));
+    if(bin_size <= 0) {
+        throw InvalidValueError(config_, "tabulation_bin_size", "bin size needs to be positive");
+    }
+
+    // Size and binning of the grid
+    std::array<double, 3> size{{model->getPixelSize().x() * pixels.x(),
+                                model->getPixelSize().y() * pixels.y(),
+                                thickness_domain.second - thickness_domain.first}};
+    std::array<size_t, 3> dimensions{};
+    for(size_t i = 0; i < 3; ++i) {
+        dimensions[i] = std::max(static_cast<size_t>(std::round(size[i] / bin_size)), static_cast<size_t>(1));
+    }
+
+    // Identify the grid by all parameters entering the calculation
+    std::stringstream key;
+    key << std::setprecision(std::numeric_limits<double>::max_digits10);
+    key << "Allpix Squared pad weighting potential, implant (" << implant.x() << "," << implant.y()
+        << "), thickness domain (" << thickness_domain.first << "," << thickness_domain.second << "), size (" << size[0]
+        << "," << size[1] << "), bins (" << dimensions[0] << "," << dimensions[1] << "," << dimensions[2] << ")";
+    auto header = key.str();
+
+    // Instantiations initialized at the same time tabulate one after the other, such that identical grids are read from
+    // the cache file written by the first of them
+    static std::mutex tabulation_mutex;
+    std::lock_guard<std::mutex> tabulation_lock(tabulation_mutex);
+
+    std::string cache_file;
+    if(config_.has("tabulation_cache")) {
+        auto cache_path = config_.getPath("tabulation_cache");
+        if(!path_is_directory(cache_path)) {
+            create_directories(cache_path);
+        }
+
+        // FNV-1a hash of the parameters, which is stable between different platforms and compilers
+        uint64_t hash = 14695981039346656037ull;
+        for(auto c : header) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        std::stringstream name;
+        name << cache_path << "/pad_weightingpotential_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".apf";
+        cache_file = name.str();
+
+        if(path_is_file(cache_file)) {
+            try {
+                auto field_data = field_parser_.getByFileName(
+                    get_canonical_path(cache_file), std::string(), false, get_storage() == FieldStorage::DOUBLE);
+                if(field_data.getHeader() == header && field_data.getDimensions() == dimensions) {
+                    LOG(INFO) << "Using tabulated pad weighting potential from " << cache_file;
+                    return field_data;
+                }
+                LOG(WARNING) << "Tabulated pad weighting potential in " << cache_file
+                             << " does not match the parameters, recalculating";
+            } catch(std::runtime_error& e) {
+                LOG(WARNING) << "Cannot read tabulated pad weighting potential from " << cache_file << ": " << e.what();
+            }
+        }
+    }
+
+    LOG(INFO) << "Tabulating pad weighting potential with " << dimensions[0] << "x" << dimensions[1] << "x"
+              << dimensions[2] << " bins over " << Units::display(size[0], {"um", "mm"}) << " x "
+              << Units::display(size[1], {"um", "mm"}) << " x " << Units::display(size[2], {"um", "mm"});
+
+    // Evaluate the lower quadrant including the central bins, and mirror it to the other quadrants
+    auto values = std::make_shared<std::vector<double>>(dimensions[0] * dimensions[1] * dimensions[2]);
+    auto index = [&](size_t x, size_t y, size_t z) { return (x * dimensions[1] + y) * dimensions[2] + z; };
+    auto center = [&](size_t i, size_t bin) {
+        return (static_cast<double>(bin) + 0.5) * size[i] / static_cast<double>(dimensions[i]) - size[i] / 2.0;
+    };
+    auto half_x = (dimensions[0] + 1) / 2;
+    auto half_y = (dimensions[1] + 1) / 2;
+    for(size_t x = 0; x < half_x; ++x) {
+        LOG_PROGRESS(INFO, "tabulation") << "Tabulating pad weighting potential: " << 100 * x / half_x << "%";
+        for(size_t y = 0; y < half_y; ++y) {
+            for(size_t z = 0; z < dimensions[2]; ++z) {
+                auto pos_z = thickness_domain.first +
+                             (static_cast<double>(z) + 0.5) * size[2] / static_cast<double>(dimensions[2]);
+                auto potential = function(ROOT::Math::XYZPoint(center(0, x), center(1, y), pos_z));
+
+                auto mirror_x = dimensions[0] - 1 - x;
+                auto mirror_y = dimensions[1] - 1 - y;
+                (*values)[index(x, y, z)] = potential;
+                (*values)[index(mirror_x, y, z)] = potential;
+                (*values)[index(x, mirror_y, z)] = potential;
+                (*values)[index(mirror_x, mirror_y, z)] = potential;
+            }
+        }
+    }
+    LOG_PROGRESS(INFO, "tabulation") << "Tabulating pad weighting potential: done";
+
+    FieldData<double> field_data(header, dimensions, size, values);
+    if(!cache_file.empty()) {
+        try {
+            FieldWriter<double> writer(FieldQuantity::SCALAR);
+            writer.writeFile(field_data, cache_file, FileType::APF2);
+            LOG(INFO) << "Stored tabulated pad weighting potential in " << cache_file;
+        } catch(std::runtime_error& e) {
+            LOG(WARNING) << "Cannot store tabulated pad weighting potential in " << cache_file << ": " << e.what();
+        }
+    }
+    return field_data;
+}
+
+FieldInterpolation WeightingPotentialReaderModule::get_interpolation() {
+    // Select the interpolation between the grid points, defaulting to the nearest grid point
+    auto interpolation_name = config_.get<std::string>("interpolation", "nearest");
+    if(interpolation_name == "linear") {
+        return FieldInterpolation::LINEAR;
+    } else if(interpolation_name != "nearest") {
+        throw InvalidValueError(config_, "interpolation", "interpolation should be 'nearest' or 'linear'");
+    }
+    return FieldInterpolation::NEAREST;
+}
+
+FieldStorage WeightingPotentialReaderModule::get_storage() {
+    // Select the precision used to store the grid values, defaulting to double precision
+    auto storage_name = config_.get<std::string>("storage", "double");
+    if(storage_name == "float") {
+        return FieldStorage::FLOAT;
+    } else if(storage_name == "half") {
+        return FieldStorage::HALF;
+    } else if(storage_name != "double") {
+        throw InvalidValueError(config_, "storage", "storage should be 'double', 'float' or 'half'");
+    }
+    return FieldStorage::DOUBLE;
+}
+
+FieldSymmetry WeightingPotentialReaderModule::get_symmetry() {
+    // Select the symmetry of the potential within the field cell, defaulting to grids covering the full cell
+    auto symmetry_name = config_.get<std::string>("field_symmetry", "none");
+    if(symmetry_name == "quadrant") {
+        return FieldSymmetry::QUADRANT;
+    } else if(symmetry_name != "none") {
+        throw InvalidValueError(config_, "field_symmetry", "field symmetry should be 'none' or 'quadrant'");
+    }
+    return FieldSymmetry::NONE;
+}
+
+/**
+ * Only APF2 files, including those cached for INIT files, are mapped into memory, and the mapping is only used directly if
+ * the grid is not converted to another precision.
+ */
+bool WeightingPotentialReaderModule::is_memory_mapped(FieldStorage storage) {
+    if(storage != FieldStorage::DOUBLE) {
+        return false;
+    }
+    try {
+        auto file_type = FieldParser<double>::getInfoByFileName(config_.getPath("file_name", true)).type;
+        return file_type == FileType::APF2 || (file_type == FileType::INIT && config_.get<bool>("cache_init_file", false));
+    } catch(std::runtime_error&) {
+        return false;
+    }
+}
+
 void WeightingPotentialReaderModule::create_output_plots() {
     LOG(TRACE) << "Creating output plots";
 
@@ -197,17 +416,19 @@ void WeightingPotentialReaderModule::create_output_plots() {
  * using the static FieldParser's getByFileName method.
  */
 FieldParser<double> WeightingPotentialReaderModule::field_parser_(FieldQuantity::SCALAR);
-FieldData<double> WeightingPotentialReaderModule::read_field(std::pair<double, double> thickness_domain) {
+FieldData<double> WeightingPotentialReaderModule::read_field(std::pair<double, double> thickness_domain, bool keep_cached) {
     using namespace ROOT::Math;
 
     try {
         LOG(TRACE) << "Fetching weighting potential from init file";
 
         // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true));
+        auto field_data = field_parser_.getByFileName(
+            config_.getPath("file_name", true), std::string(), config_.get<bool>("cache_init_file", false), keep_cached);
 
         // Check maximum/minimum values of the potential:
-        auto elements = std::minmax_element(field_data.getData()->begin(), field_data.getData()->end());
+        auto values = field_data.getValues();
+        auto elements = std::minmax_element(values.get(), values.get() + field_data.getValuesSize());
         if(*elements.first < 0 || *elements.second > 1) {
             throw InvalidValueError(config_,
                                     "file_name",
@@ -232,8 +453,12 @@ FieldData<double> WeightingPotentialReaderModule::read_field(std::pair<double, d
             }
         }
 
-        // Check if weigthing potential matches chip
-        check_detector_match(field_data.getSize(), thickness_domain);
+        // Check if weigthing potential matches chip, comparing the size of the full field cell for quadrant grids
+        auto size = field_data.getSize();
+        if(get_symmetry() == FieldSymmetry::QUADRANT) {
+            size = {{2.0 * size[0], 2.0 * size[1], size[2]}};
+        }
+        check_detector_match(size, thickness_domain);
 
         LOG(INFO) << "Set weighting field with " << field_data.getDimensions()[0] << "x" << field_data.getDimensions()[1]
                   << "x" << field_data.getDimensions()[2] << " cells";
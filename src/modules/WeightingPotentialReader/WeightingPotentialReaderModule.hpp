@@ -49,11 +49,45 @@ namespace allpix {
         FieldFunction<double> get_pad_potential_function(const ROOT::Math::XYVector& implant,
                                                          std::pair<double, double> thickness_domain);
 
+        /**
+         * @brief Tabulate the weighting potential of a pad on a grid, or read it from the cache if available
+         * @param function Function of the pad weighting potential
+         * @param implant Size of the implant of the pad
+         * @param thickness_domain Domain of the thickness where the field is defined
+         * @return Field data of the tabulated potential
+         */
+        FieldData<double> tabulate_pad_potential(const FieldFunction<double>& function,
+                                                 const ROOT::Math::XYVector& implant,
+                                                 std::pair<double, double> thickness_domain);
+
+        /**
+         * @brief Get the interpolation of the weighting potential grid from the configuration
+         */
+        FieldInterpolation get_interpolation();
+
+        /**
+         * @brief Get the storage precision of the weighting potential grid from the configuration
+         */
+        FieldStorage get_storage();
+
+        /**
+         * @brief Get the symmetry of the weighting potential within the field cell from the configuration
+         */
+        FieldSymmetry get_symmetry();
+
+        /**
+         * @brief Check if the weighting potential grid is used directly from the memory mapping of its file
+         * @param storage Precision the weighting potential grid is stored in
+         * @return True if the operating system can page out the grid, false if it is copied into memory
+         */
+        bool is_memory_mapped(FieldStorage storage);
+
         /**
          * @brief Read pre-calculated field from file and apply it
          * @param thickness_domain Domain of the thickness where the field is defined
+         * @param keep_cached Keep the field data in the cache of the parser, only useful if the grid uses the data directly
          */
-        FieldData<double> read_field(std::pair<double, double> thickness_domain);
+        FieldData<double> read_field(std::pair<double, double> thickness_domain, bool keep_cached);
         static FieldParser<double> field_parser_;
 
         /**
@@ -10,6 +10,7 @@
 #include "DepositedCharge.hpp"
 
 #include "exceptions.h"
+#include "streamers.h"
 
 using namespace allpix;
 
@@ -26,10 +27,10 @@ DepositedCharge::DepositedCharge(ROOT::Math::XYZPoint local_position,
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is referenced by pointer within the event and stored as TRef, only accessible if pointed object is in scope
  */
 const MCParticle* DepositedCharge::getMCParticle() const {
-    auto mc_particle = dynamic_cast<MCParticle*>(mc_particle_.GetObject());
+    auto mc_particle = get_related(mc_particle_ptr_, mc_particle_);
     if(mc_particle == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(MCParticle));
     }
@@ -37,10 +38,33 @@ const MCParticle* DepositedCharge::getMCParticle() const {
 }
 
 void DepositedCharge::setMCParticle(const MCParticle* mc_particle) {
-    mc_particle_ = const_cast<MCParticle*>(mc_particle); // NOLINT
+    mc_particle_ptr_ = mc_particle;
+    mc_particle_ = nullptr;
+}
+
+void DepositedCharge::petrifyHistory() {
+    petrify(mc_particle_ptr_, mc_particle_);
 }
 
 void DepositedCharge::print(std::ostream& out) const {
     out << "--- Deposited charge information\n";
     SensorCharge::print(out);
 }
+
+/**
+ * Deposited charges of version 2 and before have been written with the generic streamer.
+ */
+void DepositedCharge::Streamer(TBuffer& buffer) {
+    streamers::stream_class(
+        buffer,
+        this,
+        2,
+        [&](Version_t) {
+            SensorCharge::Streamer(buffer);
+            mc_particle_.Streamer(buffer);
+        },
+        [&]() {
+            SensorCharge::Streamer(buffer);
+            mc_particle_.Streamer(buffer);
+        });
+}
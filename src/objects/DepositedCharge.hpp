@@ -22,6 +22,7 @@ namespace allpix {
      */
     class DepositedCharge : public SensorCharge {
         friend class PropagatedCharge;
+        friend class PixelCharge;
 
     public:
         /**
@@ -59,10 +60,15 @@ namespace allpix {
          */
         void print(std::ostream& out) const override;
 
+        /**
+         * @brief Fill the persistent reference to the Monte-Carlo particle
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(DepositedCharge, 2);
+        ClassDefOverride(DepositedCharge, 3);
         /**
          * @brief Default constructor for ROOT I/O
          */
@@ -70,6 +76,7 @@ namespace allpix {
 
     private:
         TRef mc_particle_;
+        const MCParticle* mc_particle_ptr_{nullptr}; //!
     };
 
     /**
@@ -13,17 +13,18 @@
     ROOT::Math::DefaultCoordinateSystemTag> +                                                                               \
     ;
 
-// AP2 objects
+// AP2 objects, the objects written most often have custom streamers using the helpers in streamers.h
 #pragma link C++ class allpix::Object + ;
 #pragma link C++ class allpix::MCTrack + ;
 #pragma link C++ class allpix::MCParticle + ;
-#pragma link C++ class allpix::SensorCharge + ;
-#pragma link C++ class allpix::PropagatedCharge + ;
-#pragma link C++ class allpix::DepositedCharge + ;
-#pragma link C++ class allpix::Pixel + ;
-#pragma link C++ class allpix::PixelCharge + ;
+#pragma link C++ class allpix::SensorCharge - ;
+#pragma link C++ class allpix::PropagatedCharge - ;
+#pragma link C++ class allpix::DepositedCharge - ;
+#pragma link C++ class allpix::Pixel - ;
+#pragma link C++ class allpix::PixelCharge - ;
 #pragma link C++ class allpix::PixelHit + ;
-#pragma link C++ class allpix::Pulse + ;
+#pragma link C++ class allpix::PixelCluster + ;
+#pragma link C++ class allpix::Pulse - ;
 
 // Vector of Object for internal storage
 #pragma link C++ class std::vector < allpix::Object*> + ;
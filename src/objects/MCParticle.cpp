@@ -66,25 +66,32 @@ double MCParticle::getTime() const {
 }
 
 void MCParticle::setParent(const MCParticle* mc_particle) {
-    parent_ = const_cast<MCParticle*>(mc_particle); // NOLINT
+    parent_ptr_ = mc_particle;
+    parent_ = nullptr;
 }
 
 /**
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is referenced by pointer within the event and stored as TRef, only accessible if pointed object is in scope
  */
 const MCParticle* MCParticle::getParent() const {
-    return dynamic_cast<MCParticle*>(parent_.GetObject());
+    return get_related(parent_ptr_, parent_);
 }
 
 void MCParticle::setTrack(const MCTrack* mc_track) {
-    track_ = const_cast<MCTrack*>(mc_track); // NOLINT
+    track_ptr_ = mc_track;
+    track_ = nullptr;
 }
 
 /**
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is referenced by pointer within the event and stored as TRef, only accessible if pointed object is in scope
  */
 const MCTrack* MCParticle::getTrack() const {
-    return dynamic_cast<MCTrack*>(track_.GetObject());
+    return get_related(track_ptr_, track_);
+}
+
+void MCParticle::petrifyHistory() {
+    petrify(parent_ptr_, parent_);
+    petrify(track_ptr_, track_);
 }
 
 void MCParticle::print(std::ostream& out) const {
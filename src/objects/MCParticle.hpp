@@ -120,6 +120,11 @@ namespace allpix {
          */
         void print(std::ostream& out) const override;
 
+        /**
+         * @brief Fill the persistent references to the parent particle and the track
+         */
+        void petrifyHistory() override;
+
     private:
         ROOT::Math::XYZPoint local_start_point_{};
         ROOT::Math::XYZPoint global_start_point_{};
@@ -131,6 +136,8 @@ namespace allpix {
 
         TRef parent_;
         TRef track_;
+        const MCParticle* parent_ptr_{nullptr}; //!
+        const MCTrack* track_ptr_{nullptr};     //!
     };
 
     /**
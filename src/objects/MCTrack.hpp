@@ -126,6 +126,11 @@ namespace allpix {
          */
         void print(std::ostream& out) const override;
 
+        /**
+         * @brief Fill the persistent references to the parent track
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief ROOT class definition
          */
@@ -151,6 +156,7 @@ namespace allpix {
         double final_tot_E_{};
 
         TRef parent_;
+        const MCTrack* parent_ptr_{nullptr}; //!
     };
 
     /**
@@ -16,6 +16,20 @@ std::ostream& allpix::operator<<(std::ostream& out, const Object& obj) {
     return out;
 }
 
+/**
+ * Assigning the reference assigns a unique identifier to the related object, which is thus only done for stored objects
+ */
+void Object::petrify(const Object* pointer, TRef& reference) {
+    if(pointer == nullptr) {
+        return;
+    }
+    if(pointer->isMarkedForStorage()) {
+        reference = const_cast<Object*>(pointer); // NOLINT
+    } else {
+        reference = nullptr;
+    }
+}
+
 bool operator<(const TRef& ref1, const TRef& ref2) {
     if(ref1.GetPID() == ref2.GetPID()) {
         return ref1.GetUniqueID() < ref2.GetUniqueID();
@@ -16,6 +16,7 @@
 #define ALLPIX_OBJECT_H
 
 #include <iostream>
+#include <vector>
 
 #include <TObject.h>
 #include <TRef.h>
@@ -26,6 +27,12 @@ namespace allpix {
     /**
      * @ingroup Objects
      * @brief Base class for internal objects
+     *
+     * Objects link to their history by pointers to the related objects, which are only valid within the event. The
+     * persistent TRef links are only filled by \ref petrifyHistory before the objects are written, and only for related
+     * objects which are \ref markForStorage "marked for storage" as well. No unique identifiers are thus assigned to objects
+     * which are never written. Objects read from file only hold the TRef links, which are resolved when accessing the
+     * related objects, or once for all objects of an event by \ref resolveHistory.
      */
     class Object : public TObject {
     public:
@@ -56,12 +63,85 @@ namespace allpix {
         Object& operator=(Object&&) = default;
         /// @}
 
+        /**
+         * @brief Mark the object to be stored, such that references to it are kept when petrifying the history
+         */
+        void markForStorage() { marked_for_storage_ = true; }
+
+        /**
+         * @brief Check if the object is marked to be stored
+         * @return True if the object is marked for storage, false otherwise
+         */
+        bool isMarkedForStorage() const { return marked_for_storage_; }
+
+        /**
+         * @brief Fill the persistent references to the related objects marked for storage
+         * @warning Should only be called before writing the object, after all stored objects of the event have been marked
+         */
+        virtual void petrifyHistory() {}
+
+        /**
+         * @brief Resolve the persistent references to the related objects to pointers
+         * @warning Should only be called for objects read from file, once all related objects of the event are in scope
+         *
+         * Objects read from file otherwise resolve their persistent references whenever the related objects are accessed.
+         */
+        virtual void resolveHistory() {}
+
         /**
          * @brief ROOT class definition
          */
         ClassDefOverride(Object, 2);
 
     protected:
+        /**
+         * @brief Get a related object by its pointer within the event, or by its persistent reference otherwise
+         * @param pointer Pointer to the related object, null if the object has been read from file
+         * @param reference Persistent reference to the related object
+         * @return Pointer to the related object, null if not available
+         */
+        template <typename T> static T* get_related(T* pointer, const TRef& reference) {
+            return pointer != nullptr ? pointer : dynamic_cast<T*>(reference.GetObject());
+        }
+
+        /**
+         * @brief Fill the persistent reference to a related object from its pointer
+         * @param pointer Pointer to the related object, the reference is kept if null
+         * @param reference Persistent reference, only referencing the related object if it is marked for storage
+         */
+        static void petrify(const Object* pointer, TRef& reference);
+
+        /**
+         * @brief Fill the persistent references to a list of related objects from their pointers
+         * @param pointers Pointers to the related objects, the references are kept if the list is empty
+         * @param references Persistent references, only referencing the related objects marked for storage
+         */
+        template <typename T> static void petrify(const std::vector<T*>& pointers, std::vector<TRef>& references) {
+            if(pointers.empty()) {
+                return;
+            }
+            references.resize(pointers.size());
+            for(size_t i = 0; i < pointers.size(); ++i) {
+                references[i] = nullptr;
+                petrify(pointers[i], references[i]);
+            }
+        }
+
+        /**
+         * @brief Resolve the persistent references to a list of related objects to pointers
+         * @param pointers Pointers to the related objects, only filled if the list is empty
+         * @param references Persistent references, unresolved references result in a null pointer
+         */
+        template <typename T> static void resolve(std::vector<T*>& pointers, const std::vector<TRef>& references) {
+            if(!pointers.empty()) {
+                return;
+            }
+            pointers.reserve(references.size());
+            for(const auto& reference : references) {
+                pointers.push_back(reference.IsValid() ? dynamic_cast<T*>(reference.GetObject()) : nullptr);
+            }
+        }
+
         /**
          * @brief Print an ASCII representation of this Object to the given stream
          * @param out Stream to print to
@@ -76,6 +156,9 @@ namespace allpix {
             print(std::cout);
             std::cout << std::endl;
         }
+
+    private:
+        bool marked_for_storage_{false}; //!
     };
 
     /**
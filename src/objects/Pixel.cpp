@@ -8,6 +8,7 @@
  */
 
 #include "Pixel.hpp"
+#include "streamers.h"
 
 using namespace allpix;
 
@@ -39,3 +40,27 @@ ROOT::Math::XYZPoint Pixel::getGlobalCenter() const {
 ROOT::Math::XYVector Pixel::getSize() const {
     return size_;
 }
+
+/**
+ * Pixels of version 1 have been written with the generic streamer.
+ */
+void Pixel::Streamer(TBuffer& buffer) {
+    streamers::stream_class(
+        buffer,
+        this,
+        1,
+        [&](Version_t) {
+            UInt_t x = 0, y = 0;
+            buffer >> x >> y;
+            index_.SetXY(x, y);
+            streamers::read(buffer, local_center_);
+            streamers::read(buffer, global_center_);
+            streamers::read(buffer, size_);
+        },
+        [&]() {
+            buffer << index_.x() << index_.y();
+            streamers::write(buffer, local_center_);
+            streamers::write(buffer, global_center_);
+            streamers::write(buffer, size_);
+        });
+}
@@ -10,6 +10,9 @@
 #ifndef ALLPIX_PIXEL_H
 #define ALLPIX_PIXEL_H
 
+#include <cstdint>
+#include <functional>
+
 #include <Math/DisplacementVector2D.h>
 #include <Math/Point3D.h>
 #include <Math/Vector2D.h>
@@ -69,7 +72,7 @@ namespace allpix {
         /**
          * @brief Default constructor for ROOT I/O
          */
-        ClassDef(Pixel, 1);
+        ClassDef(Pixel, 2);
 
     private:
         Pixel::Index index_;
@@ -79,6 +82,81 @@ namespace allpix {
         ROOT::Math::XYVector size_;
     };
 
+
+    /**
+     * @brief Compact key of a pixel, packing both coordinates of its index into a single 32-bit integer
+     *
+     * Keys are ordered as the pixel indices, first by the x and then by the y coordinate, and can be hashed directly. They
+     * are meant as keys of maps and sets of pixels, which are considerably smaller and faster to compare than the pixel
+     * indices. Both coordinates have to be below \ref max_coordinate, which can be checked for a full pixel grid with
+     * \ref supports.
+     */
+    class PixelKey {
+    public:
+        /**
+         * @brief Upper limit of both coordinates of a pixel
+         */
+        static constexpr unsigned int max_coordinate = 1u << 16u;
+
+        /**
+         * @brief Check if all pixels of a pixel grid can be represented by a key
+         * @param grid_size Number of pixels of the grid in x and y
+         * @return True if both dimensions of the grid are at most \ref max_coordinate
+         */
+        static bool supports(const Pixel::Index& grid_size) {
+            return grid_size.x() <= max_coordinate && grid_size.y() <= max_coordinate;
+        }
+
+        PixelKey() = default;
+        /**
+         * @brief Construct the key of a pixel from its coordinates
+         * @param x Coordinate of the pixel in x
+         * @param y Coordinate of the pixel in y
+         */
+        PixelKey(unsigned int x, unsigned int y) : key_((static_cast<uint32_t>(x) << 16u) | (y & 0xFFFFu)) {}
+        /**
+         * @brief Construct the key of a pixel from its index
+         * @param index Index of the pixel
+         */
+        explicit PixelKey(const Pixel::Index& index) : PixelKey(index.x(), index.y()) {}
+
+        /**
+         * @brief Get the coordinate of the pixel in x
+         * @return Coordinate in x
+         */
+        unsigned int x() const { return key_ >> 16u; }
+        /**
+         * @brief Get the coordinate of the pixel in y
+         * @return Coordinate in y
+         */
+        unsigned int y() const { return key_ & 0xFFFFu; }
+        /**
+         * @brief Get the index of the pixel
+         * @return Index in x,y-plane
+         */
+        Pixel::Index getIndex() const { return Pixel::Index(x(), y()); }
+        /**
+         * @brief Get the packed value of the key
+         * @return Coordinate in x in the upper and coordinate in y in the lower 16 bits
+         */
+        uint32_t getKey() const { return key_; }
+
+        bool operator==(const PixelKey& other) const { return key_ == other.key_; }
+        bool operator!=(const PixelKey& other) const { return key_ != other.key_; }
+        bool operator<(const PixelKey& other) const { return key_ < other.key_; }
+
+    private:
+        uint32_t key_{};
+    };
 } // namespace allpix
 
+namespace std {
+    /**
+     * @brief Hash of a pixel key, which is unique for every pixel
+     */
+    template <> struct hash<allpix::PixelKey> {
+        size_t operator()(const allpix::PixelKey& key) const { return std::hash<uint32_t>()(key.getKey()); }
+    };
+} // namespace std
+
 #endif /* ALLPIX_PIXEL_H */
@@ -11,21 +11,37 @@
 
 #include <set>
 #include "exceptions.h"
+#include "streamers.h"
 
 using namespace allpix;
 
 PixelCharge::PixelCharge(Pixel pixel, unsigned int charge, const std::vector<const PropagatedCharge*>& propagated_charges)
     : pixel_(std::move(pixel)), charge_(charge) {
-    // Unique set of MC particles
-    std::set<TRef> unique_particles;
-    // Store all propagated charges and their MC particles
+    // Store all propagated charges and the unique set of their MC particles in order of appearance
+    std::set<const MCParticle*> unique_particles;
+    propagated_charges_ptr_ = propagated_charges;
     for(auto& propagated_charge : propagated_charges) {
-        propagated_charges_.push_back(const_cast<PropagatedCharge*>(propagated_charge)); // NOLINT
-        unique_particles.insert(propagated_charge->mc_particle_);
+        auto mc_particle = get_related(propagated_charge->mc_particle_ptr_, propagated_charge->mc_particle_);
+        if(unique_particles.insert(mc_particle).second) {
+            mc_particles_ptr_.push_back(mc_particle);
+        }
     }
-    // Store the MC particle references
-    for(auto& mc_particle : unique_particles) {
-        mc_particles_.push_back(mc_particle);
+
+    // No pulse provided, set full charge in first bin:
+    pulse_.addCharge(charge, 0);
+}
+
+PixelCharge::PixelCharge(Pixel pixel, unsigned int charge, const std::vector<const DepositedCharge*>& deposited_charges)
+    : pixel_(std::move(pixel)), charge_(charge) {
+    // Store the unique set of MC particles of the deposits in order of appearance
+    std::set<const MCParticle*> unique_particles;
+    for(auto& deposited_charge : deposited_charges) {
+        auto mc_particle =
+            (deposited_charge != nullptr ? get_related(deposited_charge->mc_particle_ptr_, deposited_charge->mc_particle_)
+                                         : nullptr);
+        if(unique_particles.insert(mc_particle).second) {
+            mc_particles_ptr_.push_back(mc_particle);
+        }
     }
 
     // No pulse provided, set full charge in first bin:
@@ -57,10 +73,19 @@ const Pulse& PixelCharge::getPulse() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Objects are stored as vector of TRef and can only be accessed if pointed objects are in scope
+ * Objects are referenced by pointer within the event and stored as vector of TRef, only accessible if pointed objects are in
+ * scope
  */
 std::vector<const PropagatedCharge*> PixelCharge::getPropagatedCharges() const {
-    // FIXME: This is not very efficient unfortunately
+    if(!propagated_charges_ptr_.empty()) {
+        for(auto& propagated_charge : propagated_charges_ptr_) {
+            if(propagated_charge == nullptr) {
+                throw MissingReferenceException(typeid(*this), typeid(PropagatedCharge));
+            }
+        }
+        return propagated_charges_ptr_;
+    }
+
     std::vector<const PropagatedCharge*> propagated_charges;
     for(auto& propagated_charge : propagated_charges_) {
         if(!propagated_charge.IsValid() || propagated_charge.GetObject() == nullptr) {
@@ -77,6 +102,14 @@ std::vector<const PropagatedCharge*> PixelCharge::getPropagatedCharges() const {
  * MCParticles can only be fetched if the full history of objects are in scope and stored
  */
 std::vector<const MCParticle*> PixelCharge::getMCParticles() const {
+    if(!mc_particles_ptr_.empty()) {
+        for(auto& mc_particle : mc_particles_ptr_) {
+            if(mc_particle == nullptr) {
+                throw MissingReferenceException(typeid(*this), typeid(MCParticle));
+            }
+        }
+        return mc_particles_ptr_;
+    }
 
     std::vector<const MCParticle*> mc_particles;
     for(auto& mc_particle : mc_particles_) {
@@ -90,6 +123,16 @@ std::vector<const MCParticle*> PixelCharge::getMCParticles() const {
     return mc_particles;
 }
 
+void PixelCharge::petrifyHistory() {
+    petrify(propagated_charges_ptr_, propagated_charges_);
+    petrify(mc_particles_ptr_, mc_particles_);
+}
+
+void PixelCharge::resolveHistory() {
+    resolve(propagated_charges_ptr_, propagated_charges_);
+    resolve(mc_particles_ptr_, mc_particles_);
+}
+
 void PixelCharge::print(std::ostream& out) const {
     auto local_center_location = pixel_.getLocalCenter();
     auto global_center_location = pixel_.getGlobalCenter();
@@ -103,3 +146,29 @@ void PixelCharge::print(std::ostream& out) const {
         << "Global Position: (" << global_center_location.X() << ", " << global_center_location.Y() << ", "
         << global_center_location.Z() << ") mm\n";
 }
+
+/**
+ * Pixel charges of version 6 and before have been written with the generic streamer.
+ */
+void PixelCharge::Streamer(TBuffer& buffer) {
+    streamers::stream_class(
+        buffer,
+        this,
+        6,
+        [&](Version_t) {
+            Object::Streamer(buffer);
+            pixel_.Streamer(buffer);
+            buffer >> charge_;
+            pulse_.Streamer(buffer);
+            streamers::stream(buffer, propagated_charges_);
+            streamers::stream(buffer, mc_particles_);
+        },
+        [&]() {
+            Object::Streamer(buffer);
+            pixel_.Streamer(buffer);
+            buffer << charge_;
+            pulse_.Streamer(buffer);
+            streamers::stream(buffer, propagated_charges_);
+            streamers::stream(buffer, mc_particles_);
+        });
+}
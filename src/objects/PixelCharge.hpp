@@ -49,6 +49,15 @@ namespace allpix {
                     Pulse pulse,
                     const std::vector<const PropagatedCharge*>& propagated_charges = std::vector<const PropagatedCharge*>());
 
+        /**
+         * @brief Construct a set of charges at a pixel from deposits without related propagated charge objects
+         * @param pixel Object holding the information of the pixel
+         * @param charge Amount of charge stored at this pixel
+         * @param deposited_charges Pointers to the deposited charges the charges originate from, used to find the related
+         * Monte-Carlo particles
+         */
+        PixelCharge(Pixel pixel, unsigned int charge, const std::vector<const DepositedCharge*>& deposited_charges);
+
         /**
          * @brief Get the pixel containing the charges
          * @return Pixel indices in the grid
@@ -88,10 +97,20 @@ namespace allpix {
          */
         void print(std::ostream& out) const override;
 
+        /**
+         * @brief Fill the persistent references to the propagated charges and the Monte-Carlo particles
+         */
+        void petrifyHistory() override;
+
+        /**
+         * @brief Resolve the references to the propagated charges and the Monte-Carlo particles
+         */
+        void resolveHistory() override;
+
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(PixelCharge, 6);
+        ClassDefOverride(PixelCharge, 7);
         /**
          * @brief Default constructor for ROOT I/O
          */
@@ -104,6 +123,8 @@ namespace allpix {
 
         std::vector<TRef> propagated_charges_;
         std::vector<TRef> mc_particles_;
+        std::vector<const PropagatedCharge*> propagated_charges_ptr_; //!
+        std::vector<const MCParticle*> mc_particles_ptr_;             //!
     };
 
     /**
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Implementation of object with a cluster of neighboring pixel hits
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "PixelCluster.hpp"
+
+#include <algorithm>
+
+#include "exceptions.h"
+
+using namespace allpix;
+
+PixelCluster::PixelCluster(const PixelHit* pixel_hit)
+    : seed_pixel_(pixel_hit->getPixel()), seed_signal_(pixel_hit->getSignal()), size_(1),
+      min_x_(pixel_hit->getIndex().x()), min_y_(pixel_hit->getIndex().y()), max_x_(min_x_), max_y_(min_y_),
+      charge_(pixel_hit->getSignal()), time_(pixel_hit->getTime()),
+      local_position_(pixel_hit->getPixel().getLocalCenter()),
+      global_position_(pixel_hit->getPixel().getGlobalCenter()), pixel_hits_ptr_({pixel_hit}),
+      mc_particles_ptr_(pixel_hit->getMCParticles()) {}
+
+/**
+ * The centroid is updated with the signal of the added pixel hit relative to the new total signal, such that it stays at
+ * the center of the seed pixel as long as the total signal is zero.
+ */
+void PixelCluster::addPixelHit(const PixelHit* pixel_hit) {
+    const auto& pixel = pixel_hit->getPixel();
+    auto signal = pixel_hit->getSignal();
+    if(signal > seed_signal_) {
+        seed_pixel_ = pixel;
+        seed_signal_ = signal;
+    }
+
+    ++size_;
+    unsigned int x = pixel.getIndex().x();
+    unsigned int y = pixel.getIndex().y();
+    min_x_ = std::min(min_x_, x);
+    min_y_ = std::min(min_y_, y);
+    max_x_ = std::max(max_x_, x);
+    max_y_ = std::max(max_y_, y);
+
+    charge_ += signal;
+    time_ = std::min(time_, pixel_hit->getTime());
+    if(charge_ != 0) {
+        auto fraction = signal / charge_;
+        local_position_ += (pixel.getLocalCenter() - local_position_) * fraction;
+        global_position_ += (pixel.getGlobalCenter() - global_position_) * fraction;
+    }
+
+    pixel_hits_ptr_.push_back(pixel_hit);
+    for(const auto* mc_particle : pixel_hit->getMCParticles()) {
+        if(std::find(mc_particles_ptr_.begin(), mc_particles_ptr_.end(), mc_particle) == mc_particles_ptr_.end()) {
+            mc_particles_ptr_.push_back(mc_particle);
+        }
+    }
+}
+
+std::pair<unsigned int, unsigned int> PixelCluster::getSizeXY() const {
+    return {max_x_ - min_x_ + 1, max_y_ - min_y_ + 1};
+}
+
+/**
+ * @throws MissingReferenceException If a pointed object is not in scope
+ *
+ * Pixel hits can only be fetched if they are in scope and stored
+ */
+std::vector<const PixelHit*> PixelCluster::getPixelHits() const {
+    auto pixel_hits = pixel_hits_ptr_;
+    resolve(pixel_hits, pixel_hits_);
+    for(const auto* pixel_hit : pixel_hits) {
+        if(pixel_hit == nullptr) {
+            throw MissingReferenceException(typeid(*this), typeid(PixelHit));
+        }
+    }
+    return pixel_hits;
+}
+
+/**
+ * @throws MissingReferenceException If a pointed object is not in scope
+ *
+ * MCParticles can only be fetched if the full history of objects are in scope and stored
+ */
+std::vector<const MCParticle*> PixelCluster::getMCParticles() const {
+    auto mc_particles = mc_particles_ptr_;
+    resolve(mc_particles, mc_particles_);
+    for(const auto* mc_particle : mc_particles) {
+        if(mc_particle == nullptr) {
+            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
+        }
+    }
+    return mc_particles;
+}
+
+void PixelCluster::resolveHistory() {
+    resolve(pixel_hits_ptr_, pixel_hits_);
+    resolve(mc_particles_ptr_, mc_particles_);
+}
+
+void PixelCluster::petrifyHistory() {
+    petrify(pixel_hits_ptr_, pixel_hits_);
+    petrify(mc_particles_ptr_, mc_particles_);
+}
+
+void PixelCluster::print(std::ostream& out) const {
+    out << "PixelCluster " << seed_pixel_.getIndex().X() << ", " << seed_pixel_.getIndex().Y() << ", " << size_ << ", "
+        << charge_ << ", " << local_position_.X() << ", " << local_position_.Y();
+}
@@ -0,0 +1,151 @@
+/**
+ * @file
+ * @brief Definition of object with a cluster of neighboring pixel hits
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PIXEL_CLUSTER_H
+#define ALLPIX_PIXEL_CLUSTER_H
+
+#include <utility>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <TRef.h>
+
+#include "MCParticle.hpp"
+#include "Object.hpp"
+#include "Pixel.hpp"
+#include "PixelHit.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Objects
+     * @brief Cluster of neighboring pixel hits in an event
+     *
+     * The cluster stores its seed, the pixel with the largest signal, together with its size, total signal and the
+     * signal-weighted centroid of the centers of its pixels, such that clusters can be analyzed without the pixel hits. The
+     * pixel hits and the Monte-Carlo particles of all hits are only linked.
+     */
+    class PixelCluster : public Object {
+    public:
+        /**
+         * @brief Construct a cluster from its first pixel hit
+         * @param pixel_hit Pixel hit to start the cluster with
+         */
+        explicit PixelCluster(const PixelHit* pixel_hit);
+
+        /**
+         * @brief Add a pixel hit to the cluster
+         * @param pixel_hit Pixel hit to add, which should not be part of the cluster yet
+         */
+        void addPixelHit(const PixelHit* pixel_hit);
+
+        /**
+         * @brief Get the seed pixel of the cluster
+         * @return Pixel with the largest signal, the first one of them if several pixels have the same signal
+         */
+        const Pixel& getSeedPixel() const { return seed_pixel_; }
+        /**
+         * @brief Get the signal of the seed pixel
+         * @return Signal of the seed pixel
+         */
+        double getSeedSignal() const { return seed_signal_; }
+
+        /**
+         * @brief Get the number of pixel hits of the cluster
+         * @return Cluster size
+         */
+        unsigned int getSize() const { return size_; }
+        /**
+         * @brief Get the extent of the cluster in x and y
+         * @return Pair of the number of pixel columns and rows covered by the cluster
+         */
+        std::pair<unsigned int, unsigned int> getSizeXY() const;
+
+        /**
+         * @brief Get the total signal of the cluster
+         * @return Sum of the signals of all pixel hits
+         */
+        double getCharge() const { return charge_; }
+        /**
+         * @brief Get the time of the cluster
+         * @return Earliest time of all pixel hits
+         */
+        double getTime() const { return time_; }
+
+        /**
+         * @brief Get the centroid of the cluster in local coordinates
+         * @return Signal-weighted mean of the local centers of the pixels
+         */
+        ROOT::Math::XYZPoint getLocalPosition() const { return local_position_; }
+        /**
+         * @brief Get the centroid of the cluster in global coordinates
+         * @return Signal-weighted mean of the global centers of the pixels
+         */
+        ROOT::Math::XYZPoint getGlobalPosition() const { return global_position_; }
+
+        /**
+         * @brief Get the pixel hits of the cluster
+         * @return List of all pixel hits of the cluster
+         */
+        std::vector<const PixelHit*> getPixelHits() const;
+        /**
+         * @brief Get the Monte-Carlo particles resulting in the pixel hits of the cluster
+         * @return List of all related Monte-Carlo particles, without duplicates
+         */
+        std::vector<const MCParticle*> getMCParticles() const;
+
+        /**
+         * @brief Print an ASCII representation of PixelCluster to the given stream
+         * @param out Stream to print to
+         */
+        void print(std::ostream& out) const override;
+
+        /**
+         * @brief Fill the persistent references to the pixel hits and the Monte-Carlo particles
+         */
+        void petrifyHistory() override;
+
+        /**
+         * @brief Resolve the references to the pixel hits and the Monte-Carlo particles
+         */
+        void resolveHistory() override;
+
+        /**
+         * @brief ROOT class definition
+         */
+        ClassDefOverride(PixelCluster, 1);
+        /**
+         * @brief Default constructor for ROOT I/O
+         */
+        PixelCluster() = default;
+
+    private:
+        Pixel seed_pixel_;
+        double seed_signal_{};
+
+        unsigned int size_{};
+        unsigned int min_x_{}, min_y_{}, max_x_{}, max_y_{};
+
+        double charge_{};
+        double time_{};
+        ROOT::Math::XYZPoint local_position_;
+        ROOT::Math::XYZPoint global_position_;
+
+        std::vector<TRef> pixel_hits_;
+        std::vector<TRef> mc_particles_;
+        std::vector<const PixelHit*> pixel_hits_ptr_;      //!
+        std::vector<const MCParticle*> mc_particles_ptr_; //!
+    };
+
+    /**
+     * @brief Typedef for message carrying pixel clusters
+     */
+    using PixelClusterMessage = Message<PixelCluster>;
+} // namespace allpix
+
+#endif /* ALLPIX_PIXEL_CLUSTER_H */
@@ -9,8 +9,6 @@
 
 #include "PixelHit.hpp"
 
-#include <set>
-
 #include "DepositedCharge.hpp"
 #include "PropagatedCharge.hpp"
 #include "exceptions.h"
@@ -19,15 +17,14 @@ using namespace allpix;
 
 PixelHit::PixelHit(Pixel pixel, double time, double signal, const PixelCharge* pixel_charge)
     : pixel_(std::move(pixel)), time_(time), signal_(signal) {
-    pixel_charge_ = const_cast<PixelCharge*>(pixel_charge); // NOLINT
-    // Get the unique set of MC particles
-    std::set<TRef> unique_particles;
-    for(auto& mc_particle : pixel_charge->mc_particles_) {
-        unique_particles.insert(mc_particle);
-    }
-    // Store the MC particle references
-    for(auto& mc_particle : unique_particles) {
-        mc_particles_.push_back(mc_particle);
+    pixel_charge_ptr_ = pixel_charge;
+    // Store the MC particles of the pixel charge, which are already unique
+    if(!pixel_charge->mc_particles_ptr_.empty()) {
+        mc_particles_ptr_ = pixel_charge->mc_particles_ptr_;
+        find_primary_particles();
+    } else {
+        // Keep the references of pixel charges read from file, which do not hold pointers to their particles
+        mc_particles_ = pixel_charge->mc_particles_;
     }
 }
 
@@ -42,10 +39,10 @@ Pixel::Index PixelHit::getIndex() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is referenced by pointer within the event and stored as TRef, only accessible if pointed object is in scope
  */
 const PixelCharge* PixelHit::getPixelCharge() const {
-    auto pixel_charge = dynamic_cast<PixelCharge*>(pixel_charge_.GetObject());
+    auto pixel_charge = get_related(pixel_charge_ptr_, pixel_charge_);
     if(pixel_charge == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(PixelCharge));
     }
@@ -55,20 +52,21 @@ const PixelCharge* PixelHit::getPixelCharge() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * MCParticles can only be fetched if the full history of objects are in scope and stored
+ * MCParticles can only be fetched if the full history of objects are in scope and stored. The references of objects read
+ * from file are resolved on the first access if \ref resolveHistory has not been called, which is not thread-safe.
  */
-std::vector<const MCParticle*> PixelHit::getMCParticles() const {
+const std::vector<const MCParticle*>& PixelHit::getMCParticles() const {
+    if(!resolved_) {
+        resolve(mc_particles_ptr_, mc_particles_);
+        find_primary_particles();
+    }
 
-    std::vector<const MCParticle*> mc_particles;
-    for(auto& mc_particle : mc_particles_) {
-        if(!mc_particle.IsValid() || mc_particle.GetObject() == nullptr) {
+    for(auto& mc_particle : mc_particles_ptr_) {
+        if(mc_particle == nullptr) {
             throw MissingReferenceException(typeid(*this), typeid(MCParticle));
         }
-        mc_particles.emplace_back(dynamic_cast<MCParticle*>(mc_particle.GetObject()));
     }
-
-    // Return as a vector of mc particles
-    return mc_particles;
+    return mc_particles_ptr_;
 }
 
 /**
@@ -76,23 +74,31 @@ std::vector<const MCParticle*> PixelHit::getMCParticles() const {
  *
  * MCParticles can only be fetched if the full history of objects are in scope and stored
  */
-std::vector<const MCParticle*> PixelHit::getPrimaryMCParticles() const {
-    std::vector<const MCParticle*> primary_particles;
-    for(auto& mc_particle : mc_particles_) {
-        if(!mc_particle.IsValid() || mc_particle.GetObject() == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
-        }
-        auto particle = dynamic_cast<MCParticle*>(mc_particle.GetObject());
+const std::vector<const MCParticle*>& PixelHit::getPrimaryMCParticles() const {
+    getMCParticles();
+    return primary_mc_particles_ptr_;
+}
 
+void PixelHit::find_primary_particles() const {
+    primary_mc_particles_ptr_.clear();
+    for(const auto* particle : mc_particles_ptr_) {
         // Check for possible parents:
-        if(particle->getParent() != nullptr) {
-            continue;
+        if(particle != nullptr && particle->getParent() == nullptr) {
+            primary_mc_particles_ptr_.emplace_back(particle);
         }
-        primary_particles.emplace_back(particle);
     }
+    resolved_ = true;
+}
+
+void PixelHit::resolveHistory() {
+    pixel_charge_ptr_ = get_related(pixel_charge_ptr_, pixel_charge_);
+    resolve(mc_particles_ptr_, mc_particles_);
+    find_primary_particles();
+}
 
-    // Return as a vector of mc particles
-    return primary_particles;
+void PixelHit::petrifyHistory() {
+    petrify(pixel_charge_ptr_, pixel_charge_);
+    petrify(mc_particles_ptr_, mc_particles_);
 }
 
 void PixelHit::print(std::ostream& out) const {
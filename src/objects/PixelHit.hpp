@@ -66,19 +66,29 @@ namespace allpix {
          * @brief Get the Monte-Carlo particles resulting in this pixel hit
          * @return List of all related Monte-Carlo particles
          */
-        std::vector<const MCParticle*> getMCParticles() const;
+        const std::vector<const MCParticle*>& getMCParticles() const;
         /**
          * @brief Get all primary Monte-Carlo particles resulting in this pixel hit. A particle is considered primary if it
          * has no parent particle set.
          * @return List of all related primary Monte-Carlo particles
          */
-        std::vector<const MCParticle*> getPrimaryMCParticles() const;
+        const std::vector<const MCParticle*>& getPrimaryMCParticles() const;
         /**
          * @brief Print an ASCII representation of PixelHit to the given stream
          * @param out Stream to print to
          */
         void print(std::ostream& out) const override;
 
+        /**
+         * @brief Fill the persistent references to the pixel charge and the Monte-Carlo particles
+         */
+        void petrifyHistory() override;
+
+        /**
+         * @brief Resolve the references to the pixel charge and the Monte-Carlo particles, and find the primary particles
+         */
+        void resolveHistory() override;
+
         /**
          * @brief ROOT class definition
          */
@@ -95,6 +105,18 @@ namespace allpix {
 
         TRef pixel_charge_;
         std::vector<TRef> mc_particles_;
+        const PixelCharge* pixel_charge_ptr_{nullptr}; //!
+
+        /**
+         * @brief Find the primary particles among the Monte-Carlo particles
+         */
+        void find_primary_particles() const;
+
+        // Pointers to the Monte-Carlo particles and the primary particles among them, only resolved on first access for
+        // objects read from file whose history has not been resolved
+        mutable std::vector<const MCParticle*> mc_particles_ptr_;         //!
+        mutable std::vector<const MCParticle*> primary_mc_particles_ptr_; //!
+        mutable bool resolved_{false};                                    //!
     };
 
     /**
@@ -12,6 +12,7 @@
 #include "PropagatedCharge.hpp"
 
 #include "exceptions.h"
+#include "streamers.h"
 
 using namespace allpix;
 
@@ -22,8 +23,10 @@ PropagatedCharge::PropagatedCharge(ROOT::Math::XYZPoint local_position,
                                    double event_time,
                                    const DepositedCharge* deposited_charge)
     : SensorCharge(std::move(local_position), std::move(global_position), type, charge, event_time) {
-    deposited_charge_ = const_cast<DepositedCharge*>(deposited_charge); // NOLINT
+    deposited_charge_ptr_ = deposited_charge;
     if(deposited_charge != nullptr) {
+        // Keep the reference of deposits read from file, which do not hold a pointer to their particle
+        mc_particle_ptr_ = deposited_charge->mc_particle_ptr_;
         mc_particle_ = deposited_charge->mc_particle_;
     }
 }
@@ -51,10 +54,10 @@ PropagatedCharge::PropagatedCharge(ROOT::Math::XYZPoint local_position,
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is referenced by pointer within the event and stored as TRef, only accessible if pointed object is in scope
  */
 const DepositedCharge* PropagatedCharge::getDepositedCharge() const {
-    auto deposited_charge = dynamic_cast<DepositedCharge*>(deposited_charge_.GetObject());
+    auto deposited_charge = get_related(deposited_charge_ptr_, deposited_charge_);
     if(deposited_charge == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(DepositedCharge));
     }
@@ -64,21 +67,60 @@ const DepositedCharge* PropagatedCharge::getDepositedCharge() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is referenced by pointer within the event and stored as TRef, only accessible if pointed object is in scope
  */
 const MCParticle* PropagatedCharge::getMCParticle() const {
-    auto mc_particle = dynamic_cast<MCParticle*>(mc_particle_.GetObject());
+    auto mc_particle = get_related(mc_particle_ptr_, mc_particle_);
     if(mc_particle == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(MCParticle));
     }
     return mc_particle;
 }
 
-std::map<Pixel::Index, Pulse> PropagatedCharge::getPulses() const {
+const std::map<Pixel::Index, Pulse>& PropagatedCharge::getPulses() const {
     return pulses_;
 }
 
+void PropagatedCharge::petrifyHistory() {
+    petrify(deposited_charge_ptr_, deposited_charge_);
+    petrify(mc_particle_ptr_, mc_particle_);
+}
+
 void PropagatedCharge::print(std::ostream& out) const {
     out << "--- Propagated charge information\n";
     SensorCharge::print(out);
 }
+
+/**
+ * Propagated charges of version 4 and before have been written with the generic streamer. The induced pulses are written as
+ * their number followed by the pixel index and the pulse of every entry.
+ */
+void PropagatedCharge::Streamer(TBuffer& buffer) {
+    streamers::stream_class(
+        buffer,
+        this,
+        4,
+        [&](Version_t) {
+            SensorCharge::Streamer(buffer);
+            deposited_charge_.Streamer(buffer);
+            mc_particle_.Streamer(buffer);
+            UInt_t pulses = 0;
+            buffer >> pulses;
+            pulses_.clear();
+            for(UInt_t i = 0; i < pulses; ++i) {
+                UInt_t x = 0, y = 0;
+                buffer >> x >> y;
+                pulses_[Pixel::Index(x, y)].Streamer(buffer);
+            }
+        },
+        [&]() {
+            SensorCharge::Streamer(buffer);
+            deposited_charge_.Streamer(buffer);
+            mc_particle_.Streamer(buffer);
+            buffer << static_cast<UInt_t>(pulses_.size());
+            for(auto& pulse : pulses_) {
+                buffer << pulse.first.x() << pulse.first.y();
+                pulse.second.Streamer(buffer);
+            }
+        });
+}
@@ -75,7 +75,7 @@ namespace allpix {
          * @brief Get related induced pulses
          * @return Map with induced pulses if available
          */
-        std::map<Pixel::Index, Pulse> getPulses() const;
+        const std::map<Pixel::Index, Pulse>& getPulses() const;
 
         /**
          * @brief Print an ASCII representation of PropagatedCharge to the given stream
@@ -83,10 +83,15 @@ namespace allpix {
          */
         void print(std::ostream& out) const override;
 
+        /**
+         * @brief Fill the persistent references to the deposited charge and the Monte-Carlo particle
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(PropagatedCharge, 4);
+        ClassDefOverride(PropagatedCharge, 5);
         /**
          * @brief Default constructor for ROOT I/O
          */
@@ -95,6 +100,8 @@ namespace allpix {
     private:
         TRef deposited_charge_;
         TRef mc_particle_{nullptr};
+        const DepositedCharge* deposited_charge_ptr_{nullptr}; //!
+        const MCParticle* mc_particle_ptr_{nullptr};           //!
         std::map<Pixel::Index, Pulse> pulses_;
     };
 
@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Implementation of the columnar set of propagated charges
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "PropagatedChargeArray.hpp"
+
+#include <utility>
+
+using namespace allpix;
+
+void PropagatedChargeArray::emplace_back(const ROOT::Math::XYZPoint& local_position,
+                                         const ROOT::Math::XYZPoint& global_position,
+                                         CarrierType type,
+                                         unsigned int charge,
+                                         double event_time,
+                                         const DepositedCharge* deposited_charge) {
+    local_x_.push_back(local_position.x());
+    local_y_.push_back(local_position.y());
+    local_z_.push_back(local_position.z());
+    global_x_.push_back(global_position.x());
+    global_y_.push_back(global_position.y());
+    global_z_.push_back(global_position.z());
+    type_.push_back(type);
+    charge_.push_back(charge);
+    event_time_.push_back(event_time);
+    deposited_charge_.push_back(deposited_charge);
+}
+
+void PropagatedChargeArray::emplace_back(const ROOT::Math::XYZPoint& local_position,
+                                         CarrierType type,
+                                         unsigned int charge,
+                                         double event_time,
+                                         const DepositedCharge* deposited_charge) {
+    local_x_.push_back(local_position.x());
+    local_y_.push_back(local_position.y());
+    local_z_.push_back(local_position.z());
+    type_.push_back(type);
+    charge_.push_back(charge);
+    event_time_.push_back(event_time);
+    deposited_charge_.push_back(deposited_charge);
+}
+
+void PropagatedChargeArray::setGlobalPositions(std::vector<double> global_x,
+                                               std::vector<double> global_y,
+                                               std::vector<double> global_z) {
+    global_x_ = std::move(global_x);
+    global_y_ = std::move(global_y);
+    global_z_ = std::move(global_z);
+}
+
+void PropagatedChargeArray::append(const PropagatedChargeArray& other) {
+    auto append_column = [](auto& column, const auto& other_column) {
+        column.insert(column.end(), other_column.begin(), other_column.end());
+    };
+    append_column(local_x_, other.local_x_);
+    append_column(local_y_, other.local_y_);
+    append_column(local_z_, other.local_z_);
+    append_column(global_x_, other.global_x_);
+    append_column(global_y_, other.global_y_);
+    append_column(global_z_, other.global_z_);
+    append_column(type_, other.type_);
+    append_column(charge_, other.charge_);
+    append_column(event_time_, other.event_time_);
+    append_column(deposited_charge_, other.deposited_charge_);
+}
+
+void PropagatedChargeArray::reserve(size_t size) {
+    local_x_.reserve(size);
+    local_y_.reserve(size);
+    local_z_.reserve(size);
+    global_x_.reserve(size);
+    global_y_.reserve(size);
+    global_z_.reserve(size);
+    type_.reserve(size);
+    charge_.reserve(size);
+    event_time_.reserve(size);
+    deposited_charge_.reserve(size);
+}
+
+void PropagatedChargeArray::clear() {
+    local_x_.clear();
+    local_y_.clear();
+    local_z_.clear();
+    global_x_.clear();
+    global_y_.clear();
+    global_z_.clear();
+    type_.clear();
+    charge_.clear();
+    event_time_.clear();
+    deposited_charge_.clear();
+}
+
+size_t PropagatedChargeArray::getMemoryUsage() const {
+    return (local_x_.capacity() + local_y_.capacity() + local_z_.capacity() + global_x_.capacity() + global_y_.capacity() +
+            global_z_.capacity() + event_time_.capacity()) *
+               sizeof(double) +
+           type_.capacity() * sizeof(CarrierType) + charge_.capacity() * sizeof(unsigned int) +
+           deposited_charge_.capacity() * sizeof(const DepositedCharge*);
+}
+
+std::vector<PropagatedCharge> PropagatedChargeArray::toObjects() const {
+    std::vector<PropagatedCharge> objects;
+    objects.reserve(size());
+    for(size_t i = 0; i < size(); ++i) {
+        objects.emplace_back(
+            getLocalPosition(i), getGlobalPosition(i), type_[i], charge_[i], event_time_[i], deposited_charge_[i]);
+    }
+    return objects;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file
+ * @brief Definition of the columnar set of propagated charges
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PROPAGATED_CHARGE_ARRAY_H
+#define ALLPIX_PROPAGATED_CHARGE_ARRAY_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "DepositedCharge.hpp"
+#include "PropagatedCharge.hpp"
+#include "SensorCharge.hpp"
+#include "core/messenger/Message.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Objects
+     * @brief Propagated charges stored as separate arrays for every property
+     *
+     * Holds the same information as a list of \ref PropagatedCharge objects without induced pulses, but with every property
+     * in a separate contiguous array. Modules only using a few properties, such as the local position and the charge, thus
+     * only need to read the arrays of these properties. Propagated charges are added with the same arguments as passed to
+     * the constructor of a \ref PropagatedCharge, and can be converted into objects by \ref toObjects. The array is not a
+     * ROOT object and is converted into objects before writing.
+     */
+    class PropagatedChargeArray {
+    public:
+        /**
+         * @brief Add a set of propagated charges
+         * @param local_position Local position of the propagated set of charges in the sensor
+         * @param global_position Global position of the propagated set of charges in the sensor
+         * @param type Type of the carrier to propagate
+         * @param charge Total charge propagated
+         * @param event_time Total time of propagation arrival after event start
+         * @param deposited_charge Optional pointer to related deposited charge
+         */
+        void emplace_back(const ROOT::Math::XYZPoint& local_position,
+                          const ROOT::Math::XYZPoint& global_position,
+                          CarrierType type,
+                          unsigned int charge,
+                          double event_time,
+                          const DepositedCharge* deposited_charge = nullptr);
+        /**
+         * @brief Add a set of propagated charges without its global position
+         * @param local_position Local position of the propagated set of charges in the sensor
+         * @param type Type of the carrier to propagate
+         * @param charge Total charge propagated
+         * @param event_time Total time of propagation arrival after event start
+         * @param deposited_charge Optional pointer to related deposited charge
+         * @note All sets of an array should either be added with or without global position, the global positions of the
+         * latter are computed for all sets at once by \ref setGlobalPositions when required
+         */
+        void emplace_back(const ROOT::Math::XYZPoint& local_position,
+                          CarrierType type,
+                          unsigned int charge,
+                          double event_time,
+                          const DepositedCharge* deposited_charge = nullptr);
+
+        /**
+         * @brief Check if the global positions of all sets of propagated charges are available
+         * @return True if the global positions are available, false if they have been deferred
+         */
+        bool hasGlobalPositions() const { return global_x_.size() == size(); }
+        /**
+         * @brief Set the global positions of all sets of propagated charges
+         * @param global_x Global x coordinates of all sets
+         * @param global_y Global y coordinates of all sets
+         * @param global_z Global z coordinates of all sets
+         */
+        void setGlobalPositions(std::vector<double> global_x, std::vector<double> global_y, std::vector<double> global_z);
+
+        /**
+         * @brief Append all propagated charges of another array
+         * @param other Array to append
+         */
+        void append(const PropagatedChargeArray& other);
+
+        /**
+         * @brief Reserve memory for a number of sets of propagated charges
+         * @param size Number of sets to reserve memory for
+         */
+        void reserve(size_t size);
+        /**
+         * @brief Remove all propagated charges, keeping the allocated memory
+         */
+        void clear();
+
+        /**
+         * @brief Get the number of sets of propagated charges
+         * @return Number of sets
+         */
+        size_t size() const { return charge_.size(); }
+        /**
+         * @brief Check if the array holds no propagated charges
+         * @return True if empty, false otherwise
+         */
+        bool empty() const { return charge_.empty(); }
+        /**
+         * @brief Get the memory allocated by all arrays
+         * @return Number of bytes allocated
+         */
+        size_t getMemoryUsage() const;
+
+        /**
+         * @brief Get the local position of a set of propagated charges
+         * @param index Index of the set
+         * @return Local position in the sensor
+         */
+        ROOT::Math::XYZPoint getLocalPosition(size_t index) const {
+            return {local_x_[index], local_y_[index], local_z_[index]};
+        }
+        /**
+         * @brief Get the global position of a set of propagated charges
+         * @param index Index of the set
+         * @return Global position in the sensor
+         * @warning Only available if the global positions have not been deferred, see \ref hasGlobalPositions
+         */
+        ROOT::Math::XYZPoint getGlobalPosition(size_t index) const {
+            return {global_x_[index], global_y_[index], global_z_[index]};
+        }
+
+        /// @{
+        /**
+         * @brief Get the array of a property of all sets of propagated charges
+         * @return Values of the property, ordered as the sets were added
+         */
+        const std::vector<double>& getLocalX() const { return local_x_; }
+        const std::vector<double>& getLocalY() const { return local_y_; }
+        const std::vector<double>& getLocalZ() const { return local_z_; }
+        const std::vector<double>& getGlobalX() const { return global_x_; }
+        const std::vector<double>& getGlobalY() const { return global_y_; }
+        const std::vector<double>& getGlobalZ() const { return global_z_; }
+        const std::vector<CarrierType>& getTypes() const { return type_; }
+        const std::vector<unsigned int>& getCharges() const { return charge_; }
+        const std::vector<double>& getEventTimes() const { return event_time_; }
+        const std::vector<const DepositedCharge*>& getDepositedCharges() const { return deposited_charge_; }
+        /// @}
+
+        /**
+         * @brief Convert the propagated charges into objects
+         * @return List of propagated charges, linked to the same deposited charges
+         * @warning Requires the global positions to be available, see \ref hasGlobalPositions
+         */
+        std::vector<PropagatedCharge> toObjects() const;
+
+    private:
+        std::vector<double> local_x_;
+        std::vector<double> local_y_;
+        std::vector<double> local_z_;
+        std::vector<double> global_x_;
+        std::vector<double> global_y_;
+        std::vector<double> global_z_;
+        std::vector<CarrierType> type_;
+        std::vector<unsigned int> charge_;
+        std::vector<double> event_time_;
+        std::vector<const DepositedCharge*> deposited_charge_;
+    };
+
+    /**
+     * @brief Message carrying propagated charges in columnar form
+     *
+     * Modules listening to all messages, such as writers, receive the propagated charges as \ref PropagatedCharge objects
+     * through \ref getObjectArray. The objects are created on the first request only and kept for the lifetime of the
+     * message, such that modules which do not request them do not pay for their construction. Deferred global positions
+     * are computed from the transformation of the linked detector at the same time.
+     */
+    class PropagatedChargeArrayMessage : public BaseMessage {
+    public:
+        /**
+         * @brief Constructs a message bound to a detector containing the supplied propagated charges
+         * @param data Columnar set of propagated charges
+         * @param detector Linked detector
+         */
+        PropagatedChargeArrayMessage(PropagatedChargeArray data, const std::shared_ptr<const Detector>& detector)
+            : BaseMessage(detector), data_(std::move(data)) {}
+
+        /// @{
+        /**
+         * @brief Copying or moving the message is not allowed, as the converted objects are referenced by address
+         */
+        PropagatedChargeArrayMessage(const PropagatedChargeArrayMessage&) = delete;
+        PropagatedChargeArrayMessage& operator=(const PropagatedChargeArrayMessage&) = delete;
+        PropagatedChargeArrayMessage(PropagatedChargeArrayMessage&&) = delete;
+        PropagatedChargeArrayMessage& operator=(PropagatedChargeArrayMessage&&) = delete;
+        /// @}
+
+        /**
+         * @brief Default destructor
+         */
+        ~PropagatedChargeArrayMessage() override = default;
+
+        /**
+         * @brief Get a reference to the propagated charges in this message
+         */
+        const PropagatedChargeArray& getData() const { return data_; }
+
+        /**
+         * @brief Get the propagated charges as list of objects, converting them on the first call
+         * @return List of references to the converted \ref PropagatedCharge objects
+         * @warning Data through this method can only be accessed for as long as this message exists
+         */
+        std::vector<std::reference_wrapper<Object>> getObjectArray() override {
+            std::call_once(objects_flag_, [this]() {
+                if(!data_.hasGlobalPositions()) {
+                    std::vector<double> global_x, global_y, global_z;
+                    getDetector()->getGlobalPositions(
+                        data_.getLocalX(), data_.getLocalY(), data_.getLocalZ(), global_x, global_y, global_z);
+                    data_.setGlobalPositions(std::move(global_x), std::move(global_y), std::move(global_z));
+                }
+                objects_ = data_.toObjects();
+            });
+            return std::vector<std::reference_wrapper<Object>>(objects_.begin(), objects_.end());
+        }
+
+        /**
+         * @brief Get the memory held by the arrays, not including objects converted later
+         * @return Number of bytes held by the message
+         */
+        size_t getMemoryUsage() const override { return sizeof(*this) + data_.getMemoryUsage(); }
+
+        /**
+         * @brief Get the number of propagated charges in the arrays
+         * @return Number of propagated charges
+         */
+        size_t getObjectCount() const override { return data_.size(); }
+
+    private:
+        PropagatedChargeArray data_;
+
+        std::once_flag objects_flag_;
+        std::vector<PropagatedCharge> objects_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PROPAGATED_CHARGE_ARRAY_H */
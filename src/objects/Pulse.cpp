@@ -9,23 +9,50 @@
 
 #include "Pulse.hpp"
 #include "exceptions.h"
+#include "streamers.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <numeric>
+#include <stdexcept>
 
 using namespace allpix;
 
+namespace {
+    // Charge quantum of the pulses written, zero to write the exact charges
+    std::atomic<double> storage_quantum{0};
+} // namespace
+
 Pulse::Pulse(double time_bin) : bin_(time_bin), initialized_(true) {}
 
 void Pulse::addCharge(double charge, double time) {
     // For uninitialized pulses, store all charge in the first bin:
     auto bin = (initialized_ ? static_cast<size_t>(std::lround(time / bin_)) : 0);
 
-    // Adapt pulse storage vector:
-    if(bin >= pulse_.size()) {
-        pulse_.resize(bin + 1);
+    // Adapt pulse storage window:
+    extend(bin, bin + 1);
+    pulse_[bin - offset_] += charge;
+}
+
+void Pulse::addCharges(const std::vector<double>& charges, const std::vector<double>& times) {
+    if(charges.size() != times.size()) {
+        throw std::invalid_argument("number of induced charges and times differ");
+    }
+    if(charges.empty()) {
+        return;
+    }
+
+    // For uninitialized pulses, store all charge in the first bin:
+    auto get_bin = [this](double time) { return (initialized_ ? static_cast<size_t>(std::lround(time / bin_)) : 0); };
+
+    // Adapt pulse storage window once for all charges:
+    auto range = std::minmax_element(times.begin(), times.end());
+    extend(get_bin(*range.first), get_bin(*range.second) + 1);
+    for(size_t i = 0; i < charges.size(); ++i) {
+        pulse_[get_bin(times[i]) - offset_] += charges[i];
     }
-    pulse_.at(bin) += charge;
 }
 
 int Pulse::getCharge() const {
@@ -33,10 +60,24 @@ int Pulse::getCharge() const {
     return static_cast<int>(std::round(charge));
 }
 
-const std::vector<double>& Pulse::getPulse() const {
+std::vector<double> Pulse::getPulse() const {
+    std::vector<double> pulse(offset_, 0.0);
+    pulse.insert(pulse.end(), pulse_.begin(), pulse_.end());
+    return pulse;
+}
+
+const std::vector<double>& Pulse::getWindow() const {
     return pulse_;
 }
 
+size_t Pulse::getOffset() const {
+    return offset_;
+}
+
+size_t Pulse::size() const {
+    return offset_ + pulse_.size();
+}
+
 double Pulse::getBinning() const {
     return bin_;
 }
@@ -45,8 +86,26 @@ bool Pulse::isInitialized() const {
     return initialized_;
 }
 
+/**
+ * Bins before the stored window are inserted at its front, bins after it are appended.
+ */
+void Pulse::extend(size_t begin, size_t end) {
+    if(pulse_.empty()) {
+        offset_ = static_cast<unsigned int>(begin);
+        pulse_.resize(end - begin);
+        return;
+    }
+    if(begin < offset_) {
+        pulse_.insert(pulse_.begin(), offset_ - begin, 0.0);
+        offset_ = static_cast<unsigned int>(begin);
+    }
+    if(end > size()) {
+        pulse_.resize(end - offset_);
+    }
+}
+
 Pulse& Pulse::operator+=(const Pulse& rhs) {
-    auto rhs_pulse = rhs.getPulse();
+    const auto& rhs_pulse = rhs.getWindow();
 
     // Allow to initialize uninitialized pulse
     if(!this->initialized_) {
@@ -58,16 +117,102 @@ Pulse& Pulse::operator+=(const Pulse& rhs) {
     if(this->getBinning() != rhs.getBinning()) {
         throw IncompatibleDatatypesException(typeid(*this), typeid(rhs), "different time binning");
     }
-
-    // If new pulse is longer, extend:
-    if(this->pulse_.size() < rhs_pulse.size()) {
-        this->pulse_.resize(rhs_pulse.size());
+    if(rhs_pulse.empty()) {
+        return *this;
     }
 
+    // If new pulse covers other bins, extend:
+    extend(rhs.getOffset(), rhs.size());
+
     // Add up the individual bins:
+    auto* bins = pulse_.data() + (rhs.getOffset() - offset_);
     for(size_t bin = 0; bin < rhs_pulse.size(); bin++) {
-        this->pulse_.at(bin) += rhs_pulse.at(bin);
+        bins[bin] += rhs_pulse[bin];
     }
 
     return *this;
 }
+
+void Pulse::setStorageQuantum(double quantum) { storage_quantum = quantum; }
+double Pulse::getStorageQuantum() { return storage_quantum; }
+
+/**
+ * Pulses of version 3 and before have been written with the generic streamer. Version 4 stores the window as its size
+ * followed by the charges of its bins. From version 5 on, the empty bins at both ends of the window are trimmed and the
+ * charge quantum is written before the bins. Without a quantum, the charges are written as they are. Otherwise, the
+ * differences between the quantized charges of consecutive bins are written zigzag-encoded as variable-length integers,
+ * such that the slowly varying charges of a pulse mostly take a single byte per bin.
+ */
+void Pulse::Streamer(TBuffer& buffer) {
+    streamers::stream_class(
+        buffer,
+        this,
+        3,
+        [&](Version_t version) {
+            UInt_t size = 0;
+            double quantum = 0;
+            buffer >> bin_ >> initialized_ >> offset_ >> size;
+            if(version > 4) {
+                buffer >> quantum;
+            }
+            pulse_.resize(size);
+            if(quantum <= 0) {
+                buffer.ReadFastArray(pulse_.data(), static_cast<Int_t>(size));
+                return;
+            }
+
+            UInt_t length = 0;
+            buffer >> length;
+            std::vector<UChar_t> bytes(length);
+            buffer.ReadFastArray(bytes.data(), static_cast<Int_t>(length));
+
+            int64_t value = 0;
+            auto byte = bytes.begin();
+            for(auto& bin : pulse_) {
+                uint64_t zigzag = 0;
+                for(unsigned int shift = 0; byte != bytes.end(); shift += 7) {
+                    zigzag |= static_cast<uint64_t>(*byte & 0x7F) << shift;
+                    if((*byte++ & 0x80) == 0) {
+                        break;
+                    }
+                }
+                value += static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+                bin = static_cast<double>(value) * quantum;
+            }
+        },
+        [&]() {
+            double quantum = storage_quantum;
+
+            // Trim the bins which are empty after quantization
+            auto is_empty = [quantum](double charge) {
+                return (quantum > 0 ? std::llround(charge / quantum) == 0 : charge == 0);
+            };
+            auto first = std::find_if_not(pulse_.begin(), pulse_.end(), is_empty);
+            auto last = std::find_if_not(pulse_.rbegin(), std::make_reverse_iterator(first), is_empty).base();
+            auto begin = static_cast<unsigned int>(first - pulse_.begin());
+            auto size = static_cast<UInt_t>(last - first);
+
+            buffer << bin_ << initialized_ << (size > 0 ? offset_ + begin : 0u) << size << quantum;
+            if(quantum <= 0) {
+                buffer.WriteFastArray(pulse_.data() + begin, static_cast<Int_t>(size));
+                return;
+            }
+
+            std::vector<UChar_t> bytes;
+            bytes.reserve(size);
+            int64_t previous = 0;
+            for(auto bin = first; bin != last; ++bin) {
+                auto value = static_cast<int64_t>(std::llround(*bin / quantum));
+                auto delta = value - previous;
+                previous = value;
+                auto zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+                while(zigzag >= 0x80) {
+                    bytes.push_back(static_cast<UChar_t>(zigzag | 0x80));
+                    zigzag >>= 7;
+                }
+                bytes.push_back(static_cast<UChar_t>(zigzag));
+            }
+            buffer << static_cast<UInt_t>(bytes.size());
+            buffer.WriteFastArray(bytes.data(), static_cast<Int_t>(bytes.size()));
+        });
+}
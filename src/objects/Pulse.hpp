@@ -10,6 +10,7 @@
 #ifndef ALLPIX_PULSE_H
 #define ALLPIX_PULSE_H
 
+#include <cstddef>
 #include <vector>
 
 #include <TObject.h>
@@ -19,6 +20,9 @@ namespace allpix {
      * @ingroup Objects
      * @brief Pulse holding induced charges as a function of time
      * @warning This object is special and is not meant to be written directly to a tree (not inheriting from \ref Object)
+     *
+     * Only the window of bins between the first and the last bin with induced charge is stored, together with the index of
+     * its first bin, such that pulses starting late or induced only briefly do not hold a long vector of empty bins.
      */
     class Pulse {
     public:
@@ -39,6 +43,17 @@ namespace allpix {
          */
         void addCharge(double charge, double time);
 
+        /**
+         * @brief adding several induced charges to the pulse at once
+         * @param charges induced charges
+         * @param times   times when the charges have been induced, one for every charge
+         * @throws std::invalid_argument If the number of charges and times differ
+         *
+         * The stored window is extended only once to contain all charges, such that all charges induced by a carrier along
+         * its path can be added in a single call.
+         */
+        void addCharges(const std::vector<double>& charges, const std::vector<double>& times);
+
         /**
          * @brief Function to retrieve the integral (net) charge from the full pulse
          * @return Integrated charge
@@ -47,9 +62,28 @@ namespace allpix {
 
         /**
          * @brief Function to retrieve the full pulse shape
-         * @return Constant reference to the pulse vector
+         * @return Pulse vector starting at time zero, including the empty bins before the stored window
+         * @note This creates a copy of the stored bins, \ref getWindow should be preferred where possible
+         */
+        std::vector<double> getPulse() const;
+
+        /**
+         * @brief Function to retrieve the stored window of the pulse
+         * @return Constant reference to the charges of the bins starting at \ref getOffset
          */
-        const std::vector<double>& getPulse() const;
+        const std::vector<double>& getWindow() const;
+
+        /**
+         * @brief Function to retrieve the index of the first bin of the stored window
+         * @return Number of empty bins before the stored window
+         */
+        size_t getOffset() const;
+
+        /**
+         * @brief Function to retrieve the length of the full pulse
+         * @return Number of bins between time zero and the end of the stored window
+         */
+        size_t size() const;
 
         /**
          * @brief Function to retrieve time binning of pulse
@@ -69,13 +103,38 @@ namespace allpix {
          */
         Pulse& operator+=(const Pulse& rhs);
 
+        /**
+         * @brief Set the quantization step of the charges of all pulses written to file
+         * @param quantum Charge quantum in electrons the bins are rounded to, zero to store the exact charges
+         *
+         * With a quantum set, the empty bins at both ends of the stored window are trimmed and the bins are written as
+         * variable-length differences of the quantized charges. The setting applies to all pulses written by the process and
+         * is stored with every pulse, such that pulses are read back without additional configuration.
+         */
+        static void setStorageQuantum(double quantum);
+
+        /**
+         * @brief Get the quantization step of the charges of all pulses written to file
+         * @return Charge quantum in electrons, zero if the exact charges are stored
+         */
+        static double getStorageQuantum();
+
         /**
          * @brief Default constructor for ROOT I/O
          */
-        ClassDef(Pulse, 2);
+        ClassDef(Pulse, 5);
 
     private:
+        /**
+         * @brief Extend the stored window to contain a range of bins
+         * @param begin Index of the first bin
+         * @param end Index after the last bin
+         */
+        void extend(size_t begin, size_t end);
+
         std::vector<double> pulse_;
+        // Added in version 3, pulses of version 2 are read with the full pulse stored from the first bin
+        unsigned int offset_{};
         double bin_{};
         bool initialized_{};
     };
@@ -8,6 +8,7 @@
  */
 
 #include "SensorCharge.hpp"
+#include "streamers.h"
 
 using namespace allpix;
 
@@ -46,3 +47,27 @@ void SensorCharge::print(std::ostream& out) const {
         << "Global Position: (" << global_position_.X() << ", " << global_position_.Y() << ", " << global_position_.Z()
         << ") mm\n";
 }
+
+/**
+ * Sensor charges of version 2 and before have been written with the generic streamer.
+ */
+void SensorCharge::Streamer(TBuffer& buffer) {
+    streamers::stream_class(
+        buffer,
+        this,
+        2,
+        [&](Version_t) {
+            Object::Streamer(buffer);
+            streamers::read(buffer, local_position_);
+            streamers::read(buffer, global_position_);
+            Char_t type = 0;
+            buffer >> type >> charge_ >> event_time_;
+            type_ = static_cast<CarrierType>(type);
+        },
+        [&]() {
+            Object::Streamer(buffer);
+            streamers::write(buffer, local_position_);
+            streamers::write(buffer, global_position_);
+            buffer << static_cast<Char_t>(type_) << charge_ << event_time_;
+        });
+}
@@ -12,6 +12,7 @@
 #include "MCTrack.hpp"
 #include "Pixel.hpp"
 #include "PixelCharge.hpp"
+#include "PixelCluster.hpp"
 #include "PixelHit.hpp"
 #include "PropagatedCharge.hpp"
 
@@ -19,5 +20,5 @@ namespace allpix {
     /**
      * @brief Tuple containing all objects
      */
-    using OBJECTS = std::tuple<MCTrack, MCParticle, DepositedCharge, PropagatedCharge, PixelCharge, PixelHit>;
+    using OBJECTS = std::tuple<MCTrack, MCParticle, DepositedCharge, PropagatedCharge, PixelCharge, PixelHit, PixelCluster>;
 } // namespace allpix
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Helpers for the custom ROOT streamers of the objects
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_OBJECT_STREAMERS_H
+#define ALLPIX_OBJECT_STREAMERS_H
+
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector2D.h>
+#include <TBuffer.h>
+#include <TRef.h>
+
+namespace allpix {
+    /**
+     * @brief Helpers to stream the members of the objects which are written most often
+     *
+     * The custom streamers write points and vectors as plain coordinates instead of nested ROOT classes, such that neither a
+     * version nor a byte count is written for every member. The streamers read objects written before with the generic
+     * streamers of their previous class versions through the streamer information stored in the file.
+     */
+    namespace streamers {
+        /**
+         * @brief Stream an object with a custom streamer, reading objects written by the generic streamer
+         * @param buffer Buffer to write to or read from
+         * @param object Object to stream
+         * @param generic_version Last version of the class written with the generic streamer
+         * @param read_members Function reading the members of the object, called with the version of the class read
+         * @param write_members Function writing the members of the object
+         */
+        template <typename T, typename R, typename W>
+        void stream_class(TBuffer& buffer, T* object, Version_t generic_version, R&& read_members, W&& write_members) {
+            if(buffer.IsReading()) {
+                UInt_t start = 0, count = 0;
+                auto version = buffer.ReadVersion(&start, &count, T::Class());
+                if(version <= generic_version) {
+                    buffer.ReadClassBuffer(T::Class(), object, version, start, count);
+                    return;
+                }
+                read_members(version);
+                buffer.CheckByteCount(start, count, T::Class());
+            } else {
+                auto count = buffer.WriteVersion(T::Class(), kTRUE);
+                write_members();
+                buffer.SetByteCount(count, kTRUE);
+            }
+        }
+
+        /**
+         * @brief Write the coordinates of a point
+         * @param buffer Buffer to write to
+         * @param point Point to write
+         */
+        inline void write(TBuffer& buffer, const ROOT::Math::XYZPoint& point) {
+            buffer << point.x() << point.y() << point.z();
+        }
+        /**
+         * @brief Read the coordinates of a point
+         * @param buffer Buffer to read from
+         * @param point Point to read
+         */
+        inline void read(TBuffer& buffer, ROOT::Math::XYZPoint& point) {
+            double x = 0, y = 0, z = 0;
+            buffer >> x >> y >> z;
+            point.SetXYZ(x, y, z);
+        }
+
+        /**
+         * @brief Write the coordinates of a two-dimensional vector
+         * @param buffer Buffer to write to
+         * @param vector Vector to write
+         */
+        inline void write(TBuffer& buffer, const ROOT::Math::XYVector& vector) { buffer << vector.x() << vector.y(); }
+        /**
+         * @brief Read the coordinates of a two-dimensional vector
+         * @param buffer Buffer to read from
+         * @param vector Vector to read
+         */
+        inline void read(TBuffer& buffer, ROOT::Math::XYVector& vector) {
+            double x = 0, y = 0;
+            buffer >> x >> y;
+            vector.SetXY(x, y);
+        }
+
+        /**
+         * @brief Stream a list of persistent references
+         * @param buffer Buffer to write to or read from
+         * @param references References to stream, resized when reading
+         */
+        inline void stream(TBuffer& buffer, std::vector<TRef>& references) {
+            if(buffer.IsReading()) {
+                UInt_t size = 0;
+                buffer >> size;
+                references.resize(size);
+            } else {
+                buffer << static_cast<UInt_t>(references.size());
+            }
+            for(auto& reference : references) {
+                reference.Streamer(buffer);
+            }
+        }
+    } // namespace streamers
+} // namespace allpix
+
+#endif /* ALLPIX_OBJECT_STREAMERS_H */
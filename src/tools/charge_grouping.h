@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @brief Utility to decide if charge carriers of a deposit can be propagated in larger groups
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_CHARGE_GROUPING_H
+#define ALLPIX_CHARGE_GROUPING_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+#include "core/geometry/Detector.hpp"
+#include "objects/SensorCharge.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Check if the charge carriers of a deposit drift through a uniform field and stay within a single pixel
+     * @param detector Detector the charge carriers are deposited in
+     * @param position Local position of the deposit
+     * @param type Type of the charge carriers
+     * @param boltzmann_kT Thermal energy at the temperature of the sensor
+     * @param tolerance Maximum relative deviation of the electric field along the drift path from the field at the deposit
+     * @return True if the charge carriers are expected to end up in the pixel they are deposited below
+     *
+     * The electric field is sampled along a straight line from the deposit to the sensor surface the carriers drift to.
+     * If it deviates by less than the tolerance from the field at the deposit, the drift is approximated as uniform. The
+     * expected lateral diffusion is then independent of the mobility, \f$\sigma = \sqrt{2 k_B T d / E}\f$ for a drift
+     * distance \f$d\f$, and is evaluated with the smallest field along the path. The carriers are expected to stay within
+     * the pixel if the lateral drift along the field plus three times this spread is smaller than the distance to the
+     * pixel boundary. Sets of these carriers can be merged into larger groups without changing the pixel they reach.
+     */
+    inline bool is_uniform_drift(const Detector& detector,
+                                 const ROOT::Math::XYZPoint& position,
+                                 CarrierType type,
+                                 double boltzmann_kT,
+                                 double tolerance) {
+        auto model = detector.getModel();
+        auto efield = detector.getElectricField(position);
+        if(efield.Mag2() <= 0 || !detector.isWithinSensor(position)) {
+            return false;
+        }
+
+        // Find the surface the carriers drift to, holes follow the field and electrons drift against it
+        auto direction = (static_cast<int>(type) * efield.z() > 0 ? 1.0 : -1.0);
+        auto surface = model->getSensorCenter().z() + direction * model->getSensorSize().z() / 2.0;
+        auto distance = std::fabs(surface - position.z());
+
+        // Sample the field along the drift path, slightly inside the sensor at the end
+        constexpr int samples = 4;
+        auto field = std::sqrt(efield.Mag2());
+        auto min_field = field;
+        for(int i = 1; i <= samples; ++i) {
+            auto fraction = 0.99 * i / samples;
+            ROOT::Math::XYZPoint sample(position.x(), position.y(), position.z() + direction * fraction * distance);
+            auto sample_field = detector.getElectricField(sample);
+            if(std::sqrt((sample_field - efield).Mag2()) > tolerance * field) {
+                return false;
+            }
+            min_field = std::min(min_field, std::sqrt(sample_field.Mag2()));
+        }
+
+        // Compare the lateral drift and the diffusion spread to the distance to the closest pixel boundary
+        auto pitch = model->getPixelSize();
+        auto margin_x = pitch.x() / 2.0 - std::fabs(position.x() - std::round(position.x() / pitch.x()) * pitch.x());
+        auto margin_y = pitch.y() / 2.0 - std::fabs(position.y() - std::round(position.y() / pitch.y()) * pitch.y());
+        auto spread = 3.0 * std::sqrt(2.0 * boltzmann_kT * distance / min_field);
+        auto drift_x = distance * std::fabs(efield.x() / efield.z());
+        auto drift_y = distance * std::fabs(efield.y() / efield.z());
+        return drift_x + spread < margin_x && drift_y + spread < margin_y;
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_CHARGE_GROUPING_H */
@@ -0,0 +1,172 @@
+/**
+ * @file
+ * @brief Utility to cluster neighboring PixelHits
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_CLUSTER_FINDER_H
+#define ALLPIX_CLUSTER_FINDER_H
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "objects/Pixel.hpp"
+#include "objects/PixelHit.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Clustering of PixelHits touching each other by a side or a corner
+     * @tparam C Type of the clusters, constructed from the pointer to their first hit and extended by addPixelHit
+     *
+     * The hits are registered in a lookup table covering the full pixel grid, after which the hits of neighboring pixels
+     * are joined with a union-find structure. The table is dense for grids of up to \ref max_dense_pixels pixels and a hash
+     * table otherwise. Only the entries of the hits of an event are reset afterwards, such that a finder reused for every
+     * event does not allocate once the largest event has been seen. The clusters are identical to the ones of a sequential
+     * search and are built in the order of their first hit. The finder is not thread-safe, but can be kept per thread and
+     * reused for different pixel grids.
+     */
+    template <typename C> class ClusterFinder {
+    public:
+        /**
+         * @brief Largest number of pixels of a grid for which a dense lookup table is used
+         */
+        static constexpr uint64_t max_dense_pixels = 1u << 24u;
+
+        /**
+         * @brief Find the clusters of the hits of an event
+         * @param grid_size Number of pixels of the grid in x and y
+         * @param hits PixelHits of the event, which should all be within the grid
+         * @return Clusters of neighboring hits in the order of their first hit
+         */
+        std::vector<C> find(const Pixel::Index& grid_size, const std::vector<PixelHit>& hits) {
+            std::vector<C> clusters;
+            if(hits.empty()) {
+                return clusters;
+            }
+
+            auto pixels = static_cast<uint64_t>(grid_size.x()) * grid_size.y();
+            dense_ = (pixels <= max_dense_pixels);
+            if(dense_ && dense_hits_.size() < pixels) {
+                dense_hits_.resize(pixels, no_hit_);
+            }
+            auto key_of = [&](const Pixel::Index& index) {
+                return static_cast<uint64_t>(index.x()) * grid_size.y() + index.y();
+            };
+
+            // Register all hits in the lookup table, hits on the same pixel always belong to the same cluster
+            parents_.resize(hits.size());
+            for(uint32_t i = 0; i < hits.size(); ++i) {
+                parents_[i] = i;
+                auto& entry = lookup(key_of(hits[i].getIndex()));
+                if(entry == no_hit_) {
+                    entry = i;
+                } else {
+                    join(entry, i);
+                }
+            }
+
+            // Join every hit with the hits of the neighboring pixels
+            for(uint32_t i = 0; i < hits.size(); ++i) {
+                auto index = hits[i].getIndex();
+                for(unsigned int x = (index.x() > 0 ? index.x() - 1 : 0); x <= index.x() + 1 && x < grid_size.x(); ++x) {
+                    for(unsigned int y = (index.y() > 0 ? index.y() - 1 : 0); y <= index.y() + 1 && y < grid_size.y(); ++y) {
+                        auto key = static_cast<uint64_t>(x) * grid_size.y() + y;
+                        if(dense_) {
+                            if(dense_hits_[key] != no_hit_) {
+                                join(dense_hits_[key], i);
+                            }
+                        } else {
+                            auto neighbor = sparse_hits_.find(key);
+                            if(neighbor != sparse_hits_.end()) {
+                                join(neighbor->second, i);
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Build the clusters in the order of their first hit
+            clusters_.assign(hits.size(), no_hit_);
+            for(uint32_t i = 0; i < hits.size(); ++i) {
+                auto root = find_root(i);
+                if(clusters_[root] == no_hit_) {
+                    clusters_[root] = static_cast<uint32_t>(clusters.size());
+                    clusters.emplace_back(&hits[i]);
+                } else {
+                    clusters[clusters_[root]].addPixelHit(&hits[i]);
+                }
+            }
+
+            // Reset the entries of this event in the lookup table
+            if(dense_) {
+                for(const auto& hit : hits) {
+                    dense_hits_[key_of(hit.getIndex())] = no_hit_;
+                }
+            } else {
+                sparse_hits_.clear();
+            }
+            return clusters;
+        }
+
+    private:
+        static constexpr uint32_t no_hit_ = std::numeric_limits<uint32_t>::max();
+
+        /**
+         * @brief Get the entry of the lookup table of a pixel
+         * @param key Key of the pixel in the grid
+         * @return Reference to the index of the hit of the pixel, or \ref no_hit_ if the pixel has no hit
+         */
+        uint32_t& lookup(uint64_t key) {
+            if(dense_) {
+                return dense_hits_[key];
+            }
+            return sparse_hits_.emplace(key, no_hit_).first->second;
+        }
+
+        /**
+         * @brief Find the representative of the set of a hit, halving the path to it
+         * @param hit Index of the hit
+         * @return Index of the representative hit
+         */
+        uint32_t find_root(uint32_t hit) {
+            while(parents_[hit] != hit) {
+                parents_[hit] = parents_[parents_[hit]];
+                hit = parents_[hit];
+            }
+            return hit;
+        }
+
+        /**
+         * @brief Join the sets of two hits, keeping the hit registered first as the representative
+         * @param lhs Index of the first hit
+         * @param rhs Index of the second hit
+         */
+        void join(uint32_t lhs, uint32_t rhs) {
+            auto lhs_root = find_root(lhs);
+            auto rhs_root = find_root(rhs);
+            if(lhs_root == rhs_root) {
+                return;
+            }
+            if(lhs_root > rhs_root) {
+                std::swap(lhs_root, rhs_root);
+            }
+            parents_[rhs_root] = lhs_root;
+        }
+
+        bool dense_{true};
+        std::vector<uint32_t> dense_hits_;
+        std::unordered_map<uint64_t, uint32_t> sparse_hits_;
+
+        std::vector<uint32_t> parents_;
+        std::vector<uint32_t> clusters_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_CLUSTER_FINDER_H */
@@ -0,0 +1,246 @@
+/**
+ * @file
+ * @brief Utility to convolve sampled signals with a fixed kernel using fast Fourier transforms
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_CONVOLUTION_H
+#define ALLPIX_CONVOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Linear convolution of sampled signals with a kernel that is fixed for all signals
+     *
+     * The convolution computes the first samples of the linear convolution of an input signal with the kernel, up to the
+     * output length given at construction. The kernel is transformed once on construction, together with the twiddle
+     * factors and the bit reversal table of the transform, and all signals are then convolved by a single forward and
+     * inverse transform of the padded input. Real signals are transformed as complex signals of half the length. Short input
+     * signals, for which the direct summation is cheaper than the transforms, are convolved directly.
+     *
+     * All precomputed data is constant after construction, such that the same object can be used from several threads at
+     * the same time. Every thread uses its own work buffer, which is kept for the next convolution on the same thread.
+     */
+    class FFTConvolution {
+    public:
+        /**
+         * @brief Construct an empty convolution, which produces output signals of zeros
+         */
+        FFTConvolution() = default;
+
+        /**
+         * @brief Construct the convolution for a kernel
+         * @param kernel Samples of the kernel, with the same binning as the signals convolved
+         * @param output_length Number of samples of the output signals, defaults to the length of the kernel
+         */
+        explicit FFTConvolution(std::vector<double> kernel, size_t output_length = 0) : kernel_(std::move(kernel)) {
+            output_length_ = (output_length == 0 ? kernel_.size() : output_length);
+            // Kernel samples beyond the output length do not contribute
+            kernel_.resize(std::min(kernel_.size(), output_length_));
+            if(kernel_.empty()) {
+                return;
+            }
+
+            // Padded length to avoid aliasing for inputs truncated to the output length, at least four samples
+            transform_length_ = 4;
+            while(transform_length_ < output_length_ + kernel_.size() - 1) {
+                transform_length_ *= 2;
+            }
+            auto half_length = transform_length_ / 2;
+
+            // Precompute the bit reversal and the twiddle factors of the complex transform of half the length
+            bit_reversal_.resize(half_length);
+            size_t bits = 0;
+            while((size_t(1) << bits) < half_length) {
+                ++bits;
+            }
+            for(size_t i = 0; i < half_length; ++i) {
+                size_t reversed = 0;
+                for(size_t bit = 0; bit < bits; ++bit) {
+                    reversed |= ((i >> bit) & 1u) << (bits - 1 - bit);
+                }
+                bit_reversal_[i] = reversed;
+            }
+            twiddles_.resize(half_length / 2);
+            for(size_t i = 0; i < twiddles_.size(); ++i) {
+                twiddles_[i] = std::polar(1.0, -2.0 * M_PI * static_cast<double>(i) / static_cast<double>(half_length));
+            }
+            // Twiddle factors to separate the transform of the real signal from the complex transform
+            real_twiddles_.resize(half_length);
+            for(size_t i = 0; i < real_twiddles_.size(); ++i) {
+                real_twiddles_[i] =
+                    std::polar(1.0, -2.0 * M_PI * static_cast<double>(i) / static_cast<double>(transform_length_));
+            }
+
+            // Transform the kernel once, including the normalization of the inverse transform
+            std::vector<std::complex<double>> buffer;
+            pack(kernel_.data(), kernel_.size(), buffer);
+            transform(buffer, false);
+            kernel_transform_.resize(half_length + 1);
+            unpack(buffer, kernel_transform_);
+            for(auto& value : kernel_transform_) {
+                value /= static_cast<double>(half_length);
+            }
+        }
+
+        /**
+         * @brief Convolve a signal with the kernel
+         * @param input Samples of the input signal
+         * @param output Vector to store the samples of the convolution in, resized to the output length
+         * @param offset Index of the first input sample, all samples before are zero
+         */
+        void convolve(const std::vector<double>& input, std::vector<double>& output, size_t offset = 0) const {
+            output.assign(output_length_, 0.0);
+            if(offset >= output_length_) {
+                return;
+            }
+            auto input_length = std::min(input.size(), output_length_ - offset);
+            if(input_length == 0 || kernel_.empty()) {
+                return;
+            }
+
+            // Sum directly if this is faster than the transforms
+            auto direct_cost = static_cast<double>(input_length) * static_cast<double>(kernel_.size());
+            auto transform_cost = direct_cost_factor * static_cast<double>(transform_length_) *
+                                  std::log2(static_cast<double>(transform_length_));
+            if(direct_cost < transform_cost) {
+                for(size_t j = 0; j < input_length; ++j) {
+                    const auto value = input[j];
+                    const auto length = std::min(kernel_.size(), output_length_ - offset - j);
+                    auto* out = output.data() + offset + j;
+                    for(size_t i = 0; i < length; ++i) {
+                        out[i] += value * kernel_[i];
+                    }
+                }
+                return;
+            }
+
+            thread_local std::vector<std::complex<double>> buffer;
+            thread_local std::vector<std::complex<double>> spectrum;
+            pack(input.data(), input_length, buffer);
+            transform(buffer, false);
+            spectrum.resize(kernel_transform_.size());
+            unpack(buffer, spectrum);
+            for(size_t k = 0; k < spectrum.size(); ++k) {
+                spectrum[k] = multiply(spectrum[k], kernel_transform_[k]);
+            }
+            repack(spectrum, buffer);
+            transform(buffer, true);
+            for(size_t k = 0; k < output_length_ - offset; ++k) {
+                output[offset + k] = (k % 2 == 0 ? buffer[k / 2].real() : buffer[k / 2].imag());
+            }
+        }
+
+        /**
+         * @brief Get the number of samples of the output signals
+         * @return Output length
+         */
+        size_t getOutputLength() const { return output_length_; }
+
+        /**
+         * @brief Get the length of the padded signals used in the transforms
+         * @return Transform length, zero for an empty kernel
+         */
+        size_t getTransformLength() const { return transform_length_; }
+
+    private:
+        // Relative cost of one step of the transforms compared to a multiply-add of the direct summation
+        static constexpr double direct_cost_factor = 4.0;
+
+        /**
+         * @brief Multiply two complex numbers without the checks for infinite values of the standard library
+         */
+        static std::complex<double> multiply(const std::complex<double>& a, const std::complex<double>& b) {
+            return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+        }
+
+        /**
+         * @brief Pack the padded real signal into a complex signal of half the length, using odd samples as imaginary part
+         */
+        void pack(const double* signal, size_t size, std::vector<std::complex<double>>& buffer) const {
+            buffer.assign(transform_length_ / 2, 0.0);
+            for(size_t i = 0; i < size; ++i) {
+                if(i % 2 == 0) {
+                    buffer[i / 2].real(signal[i]);
+                } else {
+                    buffer[i / 2].imag(signal[i]);
+                }
+            }
+        }
+
+        /**
+         * @brief Compute the non-negative frequencies of the transform of the real signal from the packed transform
+         */
+        void unpack(const std::vector<std::complex<double>>& buffer, std::vector<std::complex<double>>& spectrum) const {
+            auto half_length = buffer.size();
+            for(size_t k = 0; k <= half_length; ++k) {
+                auto value = buffer[k % half_length];
+                auto mirror = std::conj(buffer[(half_length - k) % half_length]);
+                auto even = 0.5 * (value + mirror);
+                auto odd = multiply({0, -0.5}, value - mirror);
+                auto twiddle = (k < half_length ? real_twiddles_[k] : std::complex<double>(-1, 0));
+                spectrum[k] = even + multiply(twiddle, odd);
+            }
+        }
+
+        /**
+         * @brief Compute the packed transform from the non-negative frequencies of the transform of a real signal
+         */
+        void repack(const std::vector<std::complex<double>>& spectrum, std::vector<std::complex<double>>& buffer) const {
+            auto half_length = spectrum.size() - 1;
+            for(size_t k = 0; k < half_length; ++k) {
+                auto value = spectrum[k];
+                auto mirror = std::conj(spectrum[half_length - k]);
+                auto even = 0.5 * (value + mirror);
+                auto odd = multiply(0.5 * (value - mirror), std::conj(real_twiddles_[k]));
+                buffer[k] = even + std::complex<double>(-odd.imag(), odd.real());
+            }
+        }
+
+        /**
+         * @brief Iterative radix-2 complex transform in place, without normalization
+         * @param buffer Signal to transform, with the length of half the transform length
+         * @param inverse If the inverse transform should be computed
+         */
+        void transform(std::vector<std::complex<double>>& buffer, bool inverse) const {
+            auto length = buffer.size();
+            for(size_t i = 0; i < length; ++i) {
+                if(i < bit_reversal_[i]) {
+                    std::swap(buffer[i], buffer[bit_reversal_[i]]);
+                }
+            }
+            for(size_t size = 2; size <= length; size *= 2) {
+                auto half = size / 2;
+                auto stride = length / size;
+                for(size_t start = 0; start < length; start += size) {
+                    for(size_t i = 0; i < half; ++i) {
+                        auto twiddle = (inverse ? std::conj(twiddles_[i * stride]) : twiddles_[i * stride]);
+                        auto odd = multiply(twiddle, buffer[start + i + half]);
+                        buffer[start + i + half] = buffer[start + i] - odd;
+                        buffer[start + i] += odd;
+                    }
+                }
+            }
+        }
+
+        std::vector<double> kernel_;
+        size_t output_length_{};
+        size_t transform_length_{};
+
+        std::vector<size_t> bit_reversal_;
+        std::vector<std::complex<double>> twiddles_;
+        std::vector<std::complex<double>> real_twiddles_;
+        std::vector<std::complex<double>> kernel_transform_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_CONVOLUTION_H */
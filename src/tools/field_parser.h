@@ -11,9 +11,35 @@
 #define ALLPIX_FIELD_PARSER_H
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Compression.h>
+#include <RVersion.h>
+#include <RZip.h>
 
 #include "core/utils/file.h"
 #include "core/utils/log.h"
@@ -30,6 +56,14 @@
 // Mime type version for APF files
 #define APF_MIME_TYPE_VERSION 1
 
+// Magic bytes and layout version identifying memory-mappable APF files
+#define APF2_MAGIC "APF2FLD"
+#define APF2_LAYOUT_VERSION 2
+
+// Magic bytes and layout version identifying APF files with compressed chunks
+#define APFZ_MAGIC "APFZFLD"
+#define APFZ_LAYOUT_VERSION 1
+
 namespace allpix {
 
     /**
@@ -48,6 +82,53 @@ namespace allpix {
         UNKNOWN = 0, ///< Unknown file format
         INIT,        ///< Legacy file format, values stored in plain-text ASCII
         APF,         ///< Binary Allpix Squared format serialized using the cereal library
+        APF2,        ///< Binary Allpix Squared format with raw field data which can be memory-mapped
+        APFZ,        ///< Binary Allpix Squared format with field data compressed in independent chunks
+    };
+
+    /**
+     * @brief Fixed-size header of memory-mappable APF files
+     *
+     * The header is followed by the human readable header string of the field data and by the flat field data, stored in
+     * native byte order starting at the given data offset. The data offset is aligned to the page size such that the field
+     * data can be mapped directly into memory and shared between processes through the page cache of the operating system.
+     */
+    struct MappedFieldHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t value_size;
+        std::uint64_t quantity;
+        std::uint64_t dimensions[3];
+        double size[3];
+        std::uint64_t header_length;
+        std::uint64_t data_offset;
+    };
+
+    /**
+     * @brief Fixed-size header of APF files with compressed chunks
+     *
+     * The header is followed by the human readable header string of the field data, by an index with the file offsets of
+     * all chunks and the end of the last chunk, and by the chunks themselves. Every chunk holds a fixed number of
+     * consecutive values of the flat field data, only the last chunk can be shorter. The bytes of the values in a chunk
+     * are grouped by their significance before compressing the chunk with the given ROOT compression algorithm, which
+     * improves the compression of floating point data. Chunks which cannot be compressed are stored uncompressed, and can
+     * be recognized by their size. Since the chunks are independent, they can be decompressed in parallel and a part of
+     * the field can be read without decompressing the full file.
+     */
+    struct CompressedFieldHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t value_size;
+        std::uint64_t quantity;
+        std::uint64_t dimensions[3];
+        double size[3];
+        std::uint64_t header_length;
+        std::uint64_t chunk_size;
+        std::uint64_t chunk_count;
+        std::uint32_t algorithm;
+        std::uint32_t level;
     };
 
     /**
@@ -74,7 +155,28 @@ namespace allpix {
                   std::array<size_t, 3> dimensions,
                   std::array<T, 3> size,
                   std::shared_ptr<std::vector<T>> data)
-            : header_(std::move(header)), dimensions_(dimensions), size_(size), data_(std::move(data)){};
+            : header_(std::move(header)), dimensions_(dimensions), size_(size), data_(std::move(data)) {
+            if(data_) {
+                values_ = std::shared_ptr<const T>(data_, data_->data());
+                values_size_ = data_->size();
+            }
+        };
+
+        /**
+         * @brief Constructor for field data stored in externally owned memory, such as a memory-mapped file
+         * @param header     Human readable header string to identify file content, program version used for generation etc.
+         * @param dimensions Number of bins of the field in each coordinate
+         * @param size       Physical extent of the field in each dimension, given in internal units
+         * @param values     Shared pointer to the first value of the flat field data, owning the underlying memory
+         * @param values_size Number of values of the flat field data
+         */
+        FieldData(std::string header,
+                  std::array<size_t, 3> dimensions,
+                  std::array<T, 3> size,
+                  std::shared_ptr<const T> values,
+                  size_t values_size)
+            : header_(std::move(header)), dimensions_(dimensions), size_(size), values_(std::move(values)),
+              values_size_(values_size){};
 
         /**
          * @brief Function to obtain the header (human readbale content description) of the field data
@@ -97,8 +199,32 @@ namespace allpix {
         /**
          * @brief Member to access the actual field data
          * @return shared pointer to the flat vector of field data
+         * @warning For field data stored in external memory, this creates a copy of the data
          */
-        std::shared_ptr<std::vector<T>> getData() const { return data_; }
+        std::shared_ptr<std::vector<T>> getData() const {
+            if(!data_ && values_) {
+                return std::make_shared<std::vector<T>>(values_.get(), values_.get() + values_size_);
+            }
+            return data_;
+        }
+
+        /**
+         * @brief Member to access the field data without copying, independent of where the data is stored
+         * @return shared pointer to the first value of the flat field data, sharing ownership of the underlying memory
+         */
+        std::shared_ptr<const T> getValues() const { return values_; }
+
+        /**
+         * @brief Member to get the number of values of the flat field data
+         * @return number of values
+         */
+        size_t getValuesSize() const { return values_size_; }
+
+        /**
+         * @brief Check if the field data is stored in external memory such as a memory-mapped file
+         * @return True if the data is external, false if it is stored in a vector owned by this object
+         */
+        bool isExternal() const { return !data_ && values_; }
 
         /**
          * @brief get the dimensionality of the configured field in the x-y plane, e.g whether it is defined in 1D, 2D or 3D.
@@ -117,6 +243,10 @@ namespace allpix {
         std::array<T, 3> size_{};
         std::shared_ptr<std::vector<T>> data_;
 
+        // View of the flat field data, either aliasing the data vector or pointing to external memory
+        std::shared_ptr<const T> values_;
+        size_t values_size_{};
+
         friend class cereal::access;
 
         // Versioned serialization function:
@@ -131,6 +261,12 @@ namespace allpix {
             archive(dimensions_);
             archive(size_);
             archive(data_);
+
+            // Update the view of the data after loading
+            if(data_) {
+                values_ = std::shared_ptr<const T>(data_, data_->data());
+                values_size_ = data_->size();
+            }
         }
     };
 } // namespace allpix
@@ -154,12 +290,377 @@ namespace cereal {
 
 namespace allpix {
 
+    /**
+     * @brief Description of the content of a field data file, read from its header without reading the field data
+     */
+    struct FieldInfo {
+        FileType type{FileType::UNKNOWN};               ///< Format of the file
+        std::string header;                             ///< Human readable header string of the field data
+        std::string units;                              ///< Units of the field data as stated in INIT files, empty otherwise
+        std::array<size_t, 3> dimensions{};             ///< Number of bins of the field in each coordinate
+        std::array<double, 3> size{};                   ///< Physical extent of the field in each dimension
+        FieldQuantity quantity{FieldQuantity::UNKNOWN}; ///< Number of values per field point
+    };
+
+    /**
+     * @brief Summary of the values of a field, used to compare and validate field data without keeping a second copy
+     */
+    struct FieldSummary {
+        std::uint64_t checksum{}; ///< Checksum of the bytes of all values, independent of the number of threads used
+        size_t non_finite{};      ///< Number of values which are not finite, i.e. infinite or NaN
+        double minimum{};         ///< Smallest finite value
+        double maximum{};         ///< Largest finite value
+    };
+
+    /**
+     * @brief Summarize the values of a field in parallel
+     * @param values  Pointer to the first value of the flat field data
+     * @param count   Number of values of the flat field data
+     * @param threads Number of threads to process the values with
+     * @return Summary of the values
+     *
+     * The checksum is the 64 bit FNV-1a hash of the hashes of blocks of consecutive values, which are hashed independently
+     * with FNV-1a. Since the blocks are fixed, the checksum only depends on the values and not on the number of threads.
+     */
+    template <typename T> FieldSummary summarize_field(const T* values, size_t count, unsigned int threads) {
+        constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+        constexpr std::uint64_t fnv_prime = 1099511628211ull;
+        constexpr size_t block_size = (1u << 16u);
+        auto blocks = (count + block_size - 1) / block_size;
+
+        struct BlockSummary {
+            std::uint64_t hash;
+            size_t non_finite;
+            double minimum;
+            double maximum;
+        };
+        std::vector<BlockSummary> block_summaries(
+            blocks, {fnv_offset, 0, std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()});
+        std::atomic<size_t> next_block{0};
+        auto worker = [&]() {
+            for(size_t block = next_block++; block < blocks; block = next_block++) {
+                auto& summary = block_summaries[block];
+                auto end = std::min(count, (block + 1) * block_size);
+                for(size_t i = block * block_size; i < end; ++i) {
+                    const auto* bytes = reinterpret_cast<const unsigned char*>(values + i);
+                    for(size_t byte = 0; byte < sizeof(T); ++byte) {
+                        summary.hash = (summary.hash ^ bytes[byte]) * fnv_prime;
+                    }
+                    auto value = static_cast<double>(values[i]);
+                    if(!std::isfinite(value)) {
+                        ++summary.non_finite;
+                        continue;
+                    }
+                    summary.minimum = std::min(summary.minimum, value);
+                    summary.maximum = std::max(summary.maximum, value);
+                }
+            }
+        };
+
+        auto thread_count = std::max(1u, std::min<unsigned int>(threads, static_cast<unsigned int>(blocks)));
+        std::vector<std::thread> workers;
+        for(unsigned int i = 1; i < thread_count; ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for(auto& thread : workers) {
+            thread.join();
+        }
+
+        // Combine the blocks in their order
+        FieldSummary summary{};
+        summary.checksum = fnv_offset;
+        auto minimum = std::numeric_limits<double>::max();
+        auto maximum = std::numeric_limits<double>::lowest();
+        for(const auto& block : block_summaries) {
+            for(size_t byte = 0; byte < sizeof(block.hash); ++byte) {
+                summary.checksum = (summary.checksum ^ ((block.hash >> (8 * byte)) & 0xffu)) * fnv_prime;
+            }
+            summary.non_finite += block.non_finite;
+            minimum = std::min(minimum, block.minimum);
+            maximum = std::max(maximum, block.maximum);
+        }
+        if(minimum <= maximum) {
+            summary.minimum = minimum;
+            summary.maximum = maximum;
+        }
+        return summary;
+    }
+
+    /**
+     * @brief Class to write the data of a memory-mappable APF file in chunks
+     *
+     * The header of the file is written on construction, after which the field data can be written in arbitrary order in
+     * chunks of consecutive values. This allows to write fields which do not fit into memory as a whole, or to write the
+     * parts of a field as soon as they are calculated.
+     */
+    template <typename T = double> class MappedFieldWriter {
+    public:
+        /**
+         * @brief Create the file and write its header
+         * @param file_name  File name (as canonical path) of the output file to be created
+         * @param header_string Human readable header string to identify file content
+         * @param dimensions    Number of bins of the field in each coordinate
+         * @param size          Physical extent of the field in each dimension, given in internal units
+         * @param quantity      Number of values per field point
+         */
+        MappedFieldWriter(const std::string& file_name,
+                          const std::string& header_string,
+                          std::array<size_t, 3> dimensions,
+                          std::array<T, 3> size,
+                          size_t quantity)
+            : file_(file_name, std::ios::binary) {
+            MappedFieldHeader header{};
+            std::memcpy(header.magic, APF2_MAGIC, sizeof(header.magic));
+            header.version = APF2_LAYOUT_VERSION;
+            header.byte_order = 0x01020304u;
+            header.value_size = sizeof(T);
+            header.quantity = quantity;
+            for(size_t i = 0; i < 3; ++i) {
+                header.dimensions[i] = dimensions[i];
+                header.size[i] = static_cast<double>(size[i]);
+            }
+            header.header_length = header_string.size();
+
+            // Align the data to the page size to allow mapping it directly
+            constexpr std::uint64_t alignment = 4096;
+            header.data_offset = (sizeof(header) + header.header_length + alignment - 1) / alignment * alignment;
+            data_offset_ = header.data_offset;
+            values_size_ = dimensions[0] * dimensions[1] * dimensions[2] * quantity;
+
+            file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file_.write(header_string.data(), static_cast<std::streamsize>(header_string.size()));
+            std::vector<char> padding(header.data_offset - sizeof(header) - header.header_length, '\0');
+            file_.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+            if(!file_.good()) {
+                throw std::runtime_error("cannot write file");
+            }
+        }
+
+        /**
+         * @brief Write a chunk of consecutive field values
+         * @param offset Index of the first value of the chunk in the flat field data
+         * @param values Pointer to the values of the chunk
+         * @param count  Number of values of the chunk
+         */
+        void write(size_t offset, const T* values, size_t count) {
+            if(offset + count > values_size_) {
+                throw std::runtime_error("invalid field dimensions");
+            }
+            file_.seekp(static_cast<std::streamoff>(data_offset_ + offset * sizeof(T)));
+            file_.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+            if(!file_.good()) {
+                throw std::runtime_error("cannot write file");
+            }
+        }
+
+        /**
+         * @brief Finish the file, extending it to the full size of the field data if not all values have been written
+         */
+        void close() {
+            file_.seekp(0, std::ios::end);
+            auto end = static_cast<size_t>(file_.tellp());
+            auto full_size = data_offset_ + values_size_ * sizeof(T);
+            if(end < full_size) {
+                std::vector<char> zeros(full_size - end, '\0');
+                file_.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+            }
+            file_.close();
+            if(file_.fail()) {
+                throw std::runtime_error("cannot write file");
+            }
+        }
+
+    private:
+        std::ofstream file_;
+        size_t data_offset_{};
+        size_t values_size_{};
+    };
+
+    /**
+     * @brief Class to read the values of APF files with compressed chunks
+     *
+     * The header and the chunk index are read on construction. Values are read by decompressing only the chunks they are
+     * stored in, optionally using several threads which each decompress a separate set of chunks.
+     */
+    template <typename T = double> class CompressedFieldReader {
+    public:
+        /**
+         * @brief Open the file and read its header and chunk index
+         * @param file_name  File name (as canonical path) of the input file to be read
+         */
+        explicit CompressedFieldReader(std::string file_name) : file_name_(std::move(file_name)) {
+            std::ifstream file(file_name_, std::ios::binary);
+            if(!file.read(reinterpret_cast<char*>(&header_), sizeof(header_))) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            if(std::memcmp(header_.magic, APFZ_MAGIC, sizeof(header_.magic)) != 0) {
+                throw std::runtime_error("invalid data");
+            }
+            if(header_.version != APFZ_LAYOUT_VERSION) {
+                throw std::runtime_error("unknown format version " + std::to_string(header_.version));
+            }
+            if(header_.byte_order != 0x01020304u || header_.value_size != sizeof(T)) {
+                throw std::runtime_error("field data is stored with incompatible byte order or precision");
+            }
+            values_size_ = header_.dimensions[0] * header_.dimensions[1] * header_.dimensions[2] * header_.quantity;
+            auto chunk_count = (header_.chunk_size > 0 ? (values_size_ + header_.chunk_size - 1) / header_.chunk_size : 0);
+            if(header_.chunk_size == 0 || header_.chunk_count != chunk_count) {
+                throw std::runtime_error("invalid data");
+            }
+
+            header_string_.resize(header_.header_length);
+            index_.resize(header_.chunk_count + 1);
+            file.read(&header_string_[0], static_cast<std::streamsize>(header_string_.size()));
+            file.read(reinterpret_cast<char*>(index_.data()),
+                      static_cast<std::streamsize>(index_.size() * sizeof(std::uint64_t)));
+            if(!file || !std::is_sorted(index_.begin(), index_.end())) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+        }
+
+        /**
+         * @brief Get the fixed-size header of the file
+         * @return File header
+         */
+        const CompressedFieldHeader& getHeader() const { return header_; }
+
+        /**
+         * @brief Get the human readable header string of the field data
+         * @return Header string
+         */
+        const std::string& getHeaderString() const { return header_string_; }
+
+        /**
+         * @brief Get the total number of values of the flat field data
+         * @return Number of values
+         */
+        size_t getValuesSize() const { return values_size_; }
+
+        /**
+         * @brief Read a range of consecutive values of the flat field data
+         * @param offset  Index of the first value to read
+         * @param count   Number of values to read
+         * @param values  Pointer to the memory to store the values in
+         * @param threads Number of threads to decompress the chunks with
+         */
+        void read(size_t offset, size_t count, T* values, unsigned int threads = 1) const {
+            if(offset + count > values_size_) {
+                throw std::runtime_error("invalid field dimensions");
+            }
+            if(count == 0) {
+                return;
+            }
+
+            // Decompress all chunks overlapping with the requested range, distributing them over the threads
+            size_t first_chunk = offset / header_.chunk_size;
+            size_t last_chunk = (offset + count - 1) / header_.chunk_size;
+            std::atomic<size_t> next_chunk{first_chunk};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto worker = [&]() {
+                try {
+                    std::ifstream file(file_name_, std::ios::binary);
+                    std::vector<char> buffer;
+                    std::vector<char> unzipped;
+                    std::vector<char> chunk_values;
+                    for(size_t chunk = next_chunk++; chunk <= last_chunk; chunk = next_chunk++) {
+                        auto chunk_offset = chunk * header_.chunk_size;
+                        auto chunk_count = std::min<size_t>(header_.chunk_size, values_size_ - chunk_offset);
+                        read_chunk(file, chunk, chunk_count, buffer, unzipped, chunk_values);
+
+                        // Copy the part of the chunk within the requested range
+                        auto begin = std::max(offset, chunk_offset);
+                        auto end = std::min(offset + count, chunk_offset + chunk_count);
+                        std::memcpy(values + (begin - offset),
+                                    chunk_values.data() + (begin - chunk_offset) * sizeof(T),
+                                    (end - begin) * sizeof(T));
+                    }
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    error = std::current_exception();
+                }
+            };
+
+            auto thread_count = std::max(1u, std::min<unsigned int>(threads, last_chunk - first_chunk + 1));
+            std::vector<std::thread> workers;
+            for(unsigned int i = 1; i < thread_count; ++i) {
+                workers.emplace_back(worker);
+            }
+            worker();
+            for(auto& thread : workers) {
+                thread.join();
+            }
+            if(error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        /**
+         * @brief Read and decompress a single chunk
+         * @param file         Stream of the file to read the chunk from
+         * @param chunk        Index of the chunk
+         * @param count        Number of values in the chunk
+         * @param buffer       Buffer for the data as stored in the file
+         * @param unzipped     Buffer for the decompressed data
+         * @param chunk_values Buffer the bytes of the decompressed values are stored in
+         */
+        void read_chunk(std::ifstream& file,
+                        size_t chunk,
+                        size_t count,
+                        std::vector<char>& buffer,
+                        std::vector<char>& unzipped,
+                        std::vector<char>& chunk_values) const {
+            auto raw_size = count * sizeof(T);
+            auto stored_size = index_[chunk + 1] - index_[chunk];
+            buffer.resize(stored_size);
+            file.seekg(static_cast<std::streamoff>(index_[chunk]));
+            if(!file.read(buffer.data(), static_cast<std::streamsize>(stored_size))) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+
+            // Decompress the chunk unless it is stored uncompressed
+            const char* shuffled = buffer.data();
+            if(stored_size != raw_size) {
+                unzipped.resize(raw_size);
+                int source_size = static_cast<int>(stored_size);
+                int target_size = static_cast<int>(raw_size);
+                int decompressed = 0;
+                R__unzip(&source_size,
+                         reinterpret_cast<unsigned char*>(buffer.data()),
+                         &target_size,
+                         reinterpret_cast<unsigned char*>(unzipped.data()),
+                         &decompressed);
+                if(static_cast<size_t>(decompressed) != raw_size) {
+                    throw std::runtime_error("cannot decompress field data");
+                }
+                shuffled = unzipped.data();
+            }
+
+            // Restore the order of the bytes of the values
+            chunk_values.resize(raw_size);
+            for(size_t byte = 0; byte < sizeof(T); ++byte) {
+                for(size_t i = 0; i < count; ++i) {
+                    chunk_values[i * sizeof(T) + byte] = shuffled[byte * count + i];
+                }
+            }
+        }
+
+        std::string file_name_;
+        CompressedFieldHeader header_{};
+        std::string header_string_;
+        std::vector<std::uint64_t> index_;
+        size_t values_size_{};
+    };
+
     /**
      * @brief Class to parse Allpix Squared field data from files
      *
      * This class can be used to deserialize and parse FieldData objects from files of different format. The FieldData
      * objects read from file are cached, and a cache hit will be returned when trying to re-read a file with the same
-     * canonical path.
+     * canonical path and units. The cached objects share their field data, such that all detectors reading the same file
+     * refer to a single copy of the field in memory.
      */
     template <typename T = double> class FieldParser {
     public:
@@ -178,21 +679,138 @@ namespace allpix {
          * @brief Parse a file and retrieve the field data.
          * @param file_name  File name (as canonical path) of the input file to be parsed
          * @param units      Optional units to convert the field from after reading from file. Only used by some formats.
+         * @param cache_init Store fields read from INIT files as memory-mappable APF file next to the INIT file, and read
+         *                   this file instead of parsing the INIT file again as long as it is newer than the INIT file
+         * @param keep_cached Keep the field data in the internal cache after the caller released it
          * @return           Field data object read from file or internal cache
          *
-         * The type of the field data file to be read is deducted automatically from the file content
+         * The type of the field data file to be read is deducted automatically from the file content. Callers converting
+         * the data to another representation should not keep it cached: only a weak reference is stored in this case, such
+         * that callers requesting the file at the same time share the data, which is released once all of them converted it.
+         */
+        FieldData<T> getByFileName(const std::string& file_name,
+                                   const std::string& units = std::string(),
+                                   bool cache_init = false,
+                                   bool keep_cached = true) {
+            // Fields can be requested by several threads at the same time, the map is only locked to look up the file while
+            // the file itself is locked during parsing, such that different files are read concurrently
+            auto key = std::make_pair(file_name, units);
+            std::shared_ptr<std::mutex> file_mutex;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto& entry = file_mutexes_[key];
+                if(entry == nullptr) {
+                    entry = std::make_shared<std::mutex>();
+                }
+                file_mutex = entry;
+            }
+            std::lock_guard<std::mutex> file_lock(*file_mutex);
+
+            // Search in cache (NOTE: the path reached here is always a canonical name), the units change the parsed values
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto iter = field_map_.find(key);
+                if(iter != field_map_.end()) {
+                    auto& cached = iter->second;
+                    auto values = cached.values.lock();
+                    if(values) {
+                        LOG(INFO) << "Using cached field data";
+                        if(cached.data.getValues()) {
+                            return cached.data;
+                        }
+                        FieldData<T> field_data(cached.data.getHeader(),
+                                                cached.data.getDimensions(),
+                                                cached.data.getSize(),
+                                                values,
+                                                cached.data.getValuesSize());
+                        if(keep_cached) {
+                            cached.data = field_data;
+                        }
+                        return field_data;
+                    }
+                    field_map_.erase(iter);
+                }
+            }
+
+            auto field_data = parse_file(file_name, units, cache_init);
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& cached = field_map_[key];
+            cached.values = field_data.getValues();
+            if(keep_cached) {
+                cached.data = field_data;
+            } else {
+                // Only keep the description of the field next to the weak reference to its values
+                cached.data = FieldData<T>(field_data.getHeader(),
+                                           field_data.getDimensions(),
+                                           field_data.getSize(),
+                                           std::shared_ptr<const T>(),
+                                           field_data.getValuesSize());
+            }
+            return field_data;
+        }
+
+        /**
+         * @brief Read the description of the content of a file without reading its field data
+         * @param file_name File name of the input file
+         * @return Description of the field data stored in the file
+         *
+         * Only the header of the file is read, such that the content of large files can be inspected quickly. The number
+         * of values per field point is taken from the header or, for APF and INIT files, deduced from the size of the data
+         * block and the first line of the data block, respectively. Sizes are given in internal units.
          */
-        FieldData<T> getByFileName(const std::string& file_name, const std::string& units = std::string()) {
-            // Search in cache (NOTE: the path reached here is always a canonical name)
-            auto iter = field_map_.find(file_name);
-            if(iter != field_map_.end()) {
-                LOG(INFO) << "Using cached field data";
-                return iter->second;
+        static FieldInfo getInfoByFileName(const std::string& file_name) {
+            auto file_type = guess_file_type(file_name);
+            switch(file_type) {
+            case FileType::APF2:
+                return read_apf2_info(file_name);
+            case FileType::APFZ: {
+                CompressedFieldReader<T> reader(file_name);
+                const auto& header = reader.getHeader();
+                FieldInfo info;
+                info.type = FileType::APFZ;
+                info.header = reader.getHeaderString();
+                info.dimensions = {{header.dimensions[0], header.dimensions[1], header.dimensions[2]}};
+                info.size = {{header.size[0], header.size[1], header.size[2]}};
+                info.quantity = static_cast<FieldQuantity>(header.quantity);
+                return info;
+            }
+            case FileType::APF:
+                return read_apf_info(file_name);
+            default: {
+                std::ifstream file(file_name);
+                auto info = read_init_header(file);
+
+                // Count the values of the first field point, following its three indices
+                std::string line;
+                std::getline(file, line);
+                if(std::getline(file, line)) {
+                    std::istringstream tokens(line);
+                    auto count = std::distance(std::istream_iterator<std::string>(tokens),
+                                               std::istream_iterator<std::string>());
+                    info.quantity = static_cast<FieldQuantity>(count > 3 ? count - 3 : 0);
+                }
+                return info;
+            }
             }
+        }
 
+    private:
+        /**
+         * @brief Parse a field data file of any type, without accessing the cache
+         * @param file_name Canonical path of the file to parse
+         * @param units Units of the field in the file, only used for INIT files
+         * @param cache_init Store fields read from INIT files as memory-mappable APF file next to the INIT file
+         * @return Field data object read from the file
+         */
+        FieldData<T> parse_file(const std::string& file_name, const std::string& units, bool cache_init) {
             // Deduce the file format
             auto file_type = guess_file_type(file_name);
-            LOG(DEBUG) << "Assuming file type \"" << (file_type == FileType::APF ? "APF" : "INIT") << "\"";
+            LOG(DEBUG) << "Assuming file type \""
+                       << (file_type == FileType::APFZ   ? "APFZ"
+                           : file_type == FileType::APF2 ? "APF2"
+                           : file_type == FileType::APF  ? "APF"
+                                                         : "INIT")
+                       << "\"";
 
             switch(file_type) {
             case FileType::INIT:
@@ -200,18 +818,27 @@ namespace allpix {
                     LOG(WARNING) << "No field units provided, interpreting field data in internal units, this might lead to "
                                     "unexpected results.";
                 }
-                return parse_init_file(file_name, units);
+                return (cache_init ? parse_cached_init_file(file_name, units) : parse_init_file(file_name, units));
             case FileType::APF:
                 if(!units.empty()) {
                     LOG(DEBUG) << "Units will be ignored, APF file content is interpreted in internal units.";
                 }
                 return parse_apf_file(file_name);
+            case FileType::APF2:
+                if(!units.empty()) {
+                    LOG(DEBUG) << "Units will be ignored, APF file content is interpreted in internal units.";
+                }
+                return map_apf2_file(file_name);
+            case FileType::APFZ:
+                if(!units.empty()) {
+                    LOG(DEBUG) << "Units will be ignored, APF file content is interpreted in internal units.";
+                }
+                return parse_apfz_file(file_name);
             default:
                 throw std::runtime_error("unknown file format");
             }
         }
 
-    private:
         /**
          * @brief Function to guess the type of a field data file
          * @param path Path to the file to be tested
@@ -219,10 +846,123 @@ namespace allpix {
          *
          * This function checks if the file contains binary data to interpret it as APF formator INIT format otherwise.
          */
-        FileType guess_file_type(const std::string& path) const {
+        static FileType guess_file_type(const std::string& path) {
+            std::ifstream file(path, std::ios::binary);
+            char magic[sizeof(APF2_MAGIC)] = {};
+            if(file.read(magic, sizeof(magic)) && std::memcmp(magic, APF2_MAGIC, sizeof(magic)) == 0) {
+                return FileType::APF2;
+            }
+            if(std::memcmp(magic, APFZ_MAGIC, sizeof(magic)) == 0) {
+                return FileType::APFZ;
+            }
             return (file_is_binary(path) ? FileType::APF : FileType::INIT);
         }
 
+        /**
+         * @brief Function to read the description of the field data of a memory-mappable APF file from its header
+         * @param file_name  File name of the input file
+         */
+        static FieldInfo read_apf2_info(const std::string& file_name) {
+            std::ifstream file(file_name, std::ios::binary);
+            MappedFieldHeader header{};
+            if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            if(header.version != APF2_LAYOUT_VERSION) {
+                throw std::runtime_error("unknown format version " + std::to_string(header.version));
+            }
+            if(header.byte_order != 0x01020304u || header.value_size != sizeof(T)) {
+                throw std::runtime_error("field data is stored with incompatible byte order or precision");
+            }
+
+            FieldInfo info;
+            info.type = FileType::APF2;
+            info.header.resize(header.header_length);
+            if(!file.read(&info.header[0], static_cast<std::streamsize>(info.header.size()))) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            info.dimensions = {{header.dimensions[0], header.dimensions[1], header.dimensions[2]}};
+            info.size = {{header.size[0], header.size[1], header.size[2]}};
+            info.quantity = static_cast<FieldQuantity>(header.quantity);
+            return info;
+        }
+
+        /**
+         * @brief Function to map FieldData from a memory-mappable APF file. The file is mapped read-only and the field data
+         * points directly into the mapping, such that the memory is shared through the page cache with all other processes
+         * mapping the same file. As for APF files, all values are given in framework-internal base units.
+         * @param file_name  File name (as canonical path) of the input file to be parsed
+         */
+        FieldData<T> map_apf2_file(const std::string& file_name) {
+            int fd = open(file_name.c_str(), O_RDONLY);
+            if(fd < 0) {
+                throw std::runtime_error("cannot open file");
+            }
+            struct stat file_stat {};
+            if(fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(MappedFieldHeader)) {
+                close(fd);
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            auto file_size = static_cast<size_t>(file_stat.st_size);
+            void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if(mapping == MAP_FAILED) { // NOLINT
+                throw std::runtime_error("cannot map file into memory");
+            }
+
+            // Unmap the file once the last reference to the data is released
+            std::shared_ptr<const char> memory(static_cast<const char*>(mapping),
+                                               [file_size](const char* ptr) { munmap(const_cast<char*>(ptr), file_size); });
+
+            // Check the header
+            MappedFieldHeader header{};
+            std::memcpy(&header, memory.get(), sizeof(header));
+            if(header.version != APF2_LAYOUT_VERSION) {
+                throw std::runtime_error("unknown format version " + std::to_string(header.version));
+            }
+            if(header.byte_order != 0x01020304u || header.value_size != sizeof(T)) {
+                throw std::runtime_error("field data is stored with incompatible byte order or precision");
+            }
+            if(header.quantity != N_) {
+                throw std::runtime_error("invalid data");
+            }
+            auto values_size = header.dimensions[0] * header.dimensions[1] * header.dimensions[2] * N_;
+            if(sizeof(header) + header.header_length > header.data_offset || header.data_offset % alignof(T) != 0 ||
+               header.data_offset + values_size * sizeof(T) > file_size) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+
+            std::array<size_t, 3> dimensions{{header.dimensions[0], header.dimensions[1], header.dimensions[2]}};
+            std::array<T, 3> size{
+                {static_cast<T>(header.size[0]), static_cast<T>(header.size[1]), static_cast<T>(header.size[2])}};
+            auto values = std::shared_ptr<const T>(memory, reinterpret_cast<const T*>(memory.get() + header.data_offset));
+            FieldData<T> field_data(
+                std::string(memory.get() + sizeof(header), header.header_length), dimensions, size, values, values_size);
+
+            return field_data;
+        }
+
+        /**
+         * @brief Function to read FieldData from an APF file with compressed chunks. The chunks are decompressed in parallel
+         * using all available cores. As for APF files, all values are given in framework-internal base units.
+         * @param file_name  File name (as canonical path) of the input file to be parsed
+         */
+        FieldData<T> parse_apfz_file(const std::string& file_name) {
+            CompressedFieldReader<T> reader(file_name);
+            auto header = reader.getHeader();
+            if(header.quantity != N_) {
+                throw std::runtime_error("invalid data");
+            }
+
+            auto field = std::make_shared<std::vector<T>>(reader.getValuesSize());
+            reader.read(0, field->size(), field->data(), std::max(1u, std::thread::hardware_concurrency()));
+
+            std::array<size_t, 3> dimensions{{header.dimensions[0], header.dimensions[1], header.dimensions[2]}};
+            std::array<T, 3> size{
+                {static_cast<T>(header.size[0]), static_cast<T>(header.size[1]), static_cast<T>(header.size[2])}};
+            return FieldData<T>(reader.getHeaderString(), dimensions, size, field);
+        }
+
         /**
          * @brief Function to deserialize FieldData from an APF file, using the cereal library. This does not convert any
          * units, i.e. all values stored in APF files are given framework-internal base units. This includes the field data
@@ -250,6 +990,78 @@ namespace allpix {
             return field_data;
         }
 
+        /**
+         * @brief Function to read the description of the field data of an APF file, deserializing only the members of the
+         * field data preceding the values and the number of values. This relies on the layout of the cereal portable binary
+         * archive, in which the class version is followed by the members in the order of serialization and the shared
+         * pointer to the values is stored as an identifier followed by the size of the vector.
+         * @param file_name  File name of the input file
+         */
+        static FieldInfo read_apf_info(const std::string& file_name) {
+            std::ifstream file(file_name, std::ios::binary);
+            FieldInfo info;
+            info.type = FileType::APF;
+            std::uint64_t values_size = 0;
+            try {
+                cereal::PortableBinaryInputArchive archive(file);
+                std::uint32_t version = 0;
+                archive(version);
+                if(version != APF_MIME_TYPE_VERSION) {
+                    throw std::runtime_error("unknown format version " + std::to_string(version));
+                }
+                archive(info.header);
+                archive(info.dimensions);
+                archive(info.size);
+
+                // Identifiers of pointers stored with their data have their most significant bit set
+                std::uint32_t pointer_id = 0;
+                archive(pointer_id);
+                if((pointer_id & 0x80000000u) != 0) {
+                    archive(values_size);
+                }
+            } catch(cereal::Exception& e) {
+                throw std::runtime_error(e.what());
+            }
+
+            auto vertices = info.dimensions[0] * info.dimensions[1] * info.dimensions[2];
+            if(vertices > 0 && values_size % vertices == 0) {
+                info.quantity = static_cast<FieldQuantity>(values_size / vertices);
+            }
+            return info;
+        }
+
+        /**
+         * @brief Function to read the header of INIT-formatted ASCII files. The size of the field given in the file is
+         * always interpreted as micrometers.
+         * @param file Stream of the file, positioned at the end of the header afterwards
+         * @return Description of the field data without number of values per field point
+         */
+        static FieldInfo read_init_header(std::istream& file) {
+            FieldInfo info;
+            info.type = FileType::INIT;
+            std::getline(file, info.header);
+
+            // Read the header
+            std::string tmp;
+            // WARNING the usage of this field as storage for the field units differs from the original INIT format!
+            file >> tmp;
+            info.units = allpix::trim(tmp);
+            file >> tmp;               // ignore cluster length
+            file >> tmp >> tmp >> tmp; // ignore the incident pion direction
+            file >> tmp >> tmp >> tmp; // ignore the magnetic field (specify separately)
+            double thickness, xpixsz, ypixsz;
+            file >> thickness >> xpixsz >> ypixsz;
+            file >> tmp >> tmp >> tmp >> tmp; // ignore temperature, flux, rhe (?) and new_drde (?)
+            file >> info.dimensions[0] >> info.dimensions[1] >> info.dimensions[2];
+            file >> tmp;
+
+            if(file.fail()) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            info.size = {{Units::get(xpixsz, "um"), Units::get(ypixsz, "um"), Units::get(thickness, "um")}};
+            return info;
+        }
+
         /**
          * @brief Helper function to compare potential units defined in the INIT file against the ones provided:
          * @param file_units Unit string read from the file
@@ -273,87 +1085,227 @@ namespace allpix {
             }
         }
 
+        /**
+         * @brief Function to read FieldData from INIT files through a memory-mappable APF file stored next to them. The APF
+         * file is named after the INIT file and the units, and is only used if it is newer than the INIT file. Otherwise,
+         * the INIT file is parsed and the APF file is written for later use, which is skipped with a warning if the file
+         * cannot be written.
+         * @param file_name  File name (as canonical path) of the input file to be parsed
+         * @param units      Units to convert the values of the field data from
+         */
+        FieldData<T> parse_cached_init_file(const std::string& file_name, const std::string& units) {
+            std::stringstream cache_name;
+            cache_name << file_name << "." << std::hex << std::hash<std::string>()(units) << ".apf";
+            auto cache_file = cache_name.str();
+
+            struct stat file_stat {};
+            struct stat cache_stat {};
+            if(stat(file_name.c_str(), &file_stat) == 0 && stat(cache_file.c_str(), &cache_stat) == 0 &&
+               cache_stat.st_mtime >= file_stat.st_mtime) {
+                try {
+                    LOG(INFO) << "Reading field data from cached file " << cache_file;
+                    return map_apf2_file(cache_file);
+                } catch(std::runtime_error& e) {
+                    LOG(WARNING) << "Cannot read cached field data from " << cache_file << ": " << e.what();
+                }
+            }
+
+            auto field_data = parse_init_file(file_name, units);
+            try {
+                MappedFieldWriter<T> writer(
+                    cache_file, field_data.getHeader(), field_data.getDimensions(), field_data.getSize(), N_);
+                writer.write(0, field_data.getValues().get(), field_data.getValuesSize());
+                writer.close();
+                LOG(INFO) << "Stored field data in cached file " << cache_file;
+            } catch(std::runtime_error& e) {
+                LOG(WARNING) << "Cannot store field data in cached file " << cache_file << ": " << e.what();
+            }
+            return field_data;
+        }
+
         /**
          * @brief Function to read FieldData from INIT-formatted ASCII files. Values are interpreted in the units provided by
          * the argument and converted to the framework-internal base units. The size of the field given in the file is always
          * interpreted as micrometers.
          * @param file_name  File name (as canonical path) of the input file to be parsed
          * @param units      Units to convert the values of the field data from
+         *
+         * The header is read from the file stream, after which the data block is mapped into memory and split at line
+         * boundaries into sections, which are parsed in parallel using all available cores.
          */
         FieldData<T> parse_init_file(const std::string& file_name, const std::string& units) {
-            // Load file
+            // Load file and read the header
             std::ifstream file(file_name);
-            std::string header;
-            std::getline(file, header);
-            LOG(TRACE) << "Header of file " << file_name << " is " << std::endl << header;
+            auto info = read_init_header(file);
+            LOG(TRACE) << "Header of file " << file_name << " is " << std::endl << info.header;
+            check_unit_match(info.units, units);
+            auto xsize = info.dimensions[0];
+            auto ysize = info.dimensions[1];
+            auto zsize = info.dimensions[2];
 
-            // Read the header
-            std::string tmp;
-            // WARNING the usage of this field as storage for the field units differs from the original INIT format!
-            file >> tmp;
-            check_unit_match(allpix::trim(tmp), units);
-            file >> tmp;               // ignore cluster length
-            file >> tmp >> tmp >> tmp; // ignore the incident pion direction
-            file >> tmp >> tmp >> tmp; // ignore the magnetic field (specify separately)
-            double thickness, xpixsz, ypixsz;
-            file >> thickness >> xpixsz >> ypixsz;
-            thickness = Units::get(thickness, "um");
-            xpixsz = Units::get(xpixsz, "um");
-            ypixsz = Units::get(ypixsz, "um");
-            file >> tmp >> tmp >> tmp >> tmp; // ignore temperature, flux, rhe (?) and new_drde (?)
-            size_t xsize, ysize, zsize;
-            file >> xsize >> ysize >> zsize;
-            file >> tmp;
+            auto data_begin = static_cast<size_t>(file.tellg());
+            file.close();
 
-            if(file.fail()) {
-                throw std::runtime_error("invalid data or unexpected end of file");
-            }
             auto field = std::make_shared<std::vector<double>>();
             auto vertices = xsize * ysize * zsize;
             field->resize(vertices * N_);
 
-            // Loop through all the field data
-            for(size_t i = 0; i < vertices; ++i) {
-                if(i % (vertices / 100) == 0) {
-                    LOG_PROGRESS(INFO, "read_init") << "Reading field data: " << (100 * i / vertices) << "%";
+            // Map the data block of the file into memory
+            int fd = open(file_name.c_str(), O_RDONLY);
+            if(fd < 0) {
+                throw std::runtime_error("cannot open file");
+            }
+            struct stat file_stat {};
+            if(fstat(fd, &file_stat) != 0) {
+                close(fd);
+                throw std::runtime_error("cannot open file");
+            }
+            auto file_size = static_cast<size_t>(file_stat.st_size);
+            void* mapping = (file_size > 0 ? mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED); // NOLINT
+            close(fd);
+            if(mapping == MAP_FAILED) { // NOLINT
+                throw std::runtime_error("cannot map file into memory");
+            }
+            std::unique_ptr<char, std::function<void(char*)>> memory(static_cast<char*>(mapping),
+                                                                     [file_size](char* ptr) { munmap(ptr, file_size); });
+            madvise(mapping, file_size, MADV_SEQUENTIAL);
+
+            // Split the data block at line boundaries into one section per thread
+            const char* data = memory.get();
+            auto threads = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<size_t> boundaries{data_begin};
+            for(unsigned int i = 1; i < threads; ++i) {
+                auto position = std::max(boundaries.back(), data_begin + (file_size - data_begin) * i / threads);
+                while(position < file_size && data[position] != '\n') {
+                    ++position;
                 }
+                boundaries.push_back(position);
+            }
+            boundaries.push_back(file_size);
 
-                if(file.eof()) {
-                    throw std::runtime_error("unexpected end of file");
+            // Parse all sections, the conversion factor of the units is the same for all values
+            auto factor = Units::get(1.0, units);
+            std::atomic<size_t> records{0};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto worker = [&](size_t section) {
+                try {
+                    records += parse_init_section(
+                        data + boundaries[section], data + boundaries[section + 1], {{xsize, ysize, zsize}}, factor, *field);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    error = std::current_exception();
                 }
+            };
 
-                // Get index of field
-                size_t xind, yind, zind;
-                file >> xind >> yind >> zind;
+            LOG(INFO) << "Reading field data with " << threads << " threads";
+            std::vector<std::thread> workers;
+            for(size_t section = 1; section < threads; ++section) {
+                workers.emplace_back(worker, section);
+            }
+            worker(0);
+            for(auto& thread : workers) {
+                thread.join();
+            }
+            if(error) {
+                std::rethrow_exception(error);
+            }
+            if(records < vertices) {
+                throw std::runtime_error("unexpected end of file");
+            }
+            LOG(INFO) << "Reading field data: finished.";
+
+            FieldData<T> field_data(info.header,
+                                    info.dimensions,
+                                    std::array<T, 3>{{static_cast<T>(info.size[0]),
+                                                      static_cast<T>(info.size[1]),
+                                                      static_cast<T>(info.size[2])}},
+                                    field);
+            return field_data;
+        }
 
-                if(file.fail() || xind > xsize || yind > ysize || zind > zsize) {
+        /**
+         * @brief Helper function to parse a section of the data block of INIT files, consisting of complete lines
+         * @param begin      First character of the section
+         * @param end        End of the section
+         * @param dimensions Number of bins of the field in each coordinate
+         * @param factor     Factor to convert the values of the field to internal units
+         * @param field      Flat field data to store the values in
+         * @return Number of field points parsed
+         */
+        size_t parse_init_section(const char* begin,
+                                  const char* end,
+                                  std::array<size_t, 3> dimensions,
+                                  double factor,
+                                  std::vector<double>& field) const {
+            // Read the next whitespace-separated token into a terminated buffer, returning false at the end of the section
+            char token[64];
+            auto next_token = [&]() {
+                while(begin < end && std::isspace(static_cast<unsigned char>(*begin)) != 0) {
+                    ++begin;
+                }
+                size_t length = 0;
+                while(begin < end && std::isspace(static_cast<unsigned char>(*begin)) == 0) {
+                    if(length + 1 >= sizeof(token)) {
+                        throw std::runtime_error("invalid data");
+                    }
+                    token[length++] = *begin++;
+                }
+                token[length] = '\0';
+                return length > 0;
+            };
+            auto read_index = [&](size_t size) {
+                char* token_end = nullptr;
+                auto index = std::strtoull(token, &token_end, 10);
+                if(*token_end != '\0' || index == 0 || index > size) {
                     throw std::runtime_error("invalid data");
                 }
-                xind--;
-                yind--;
-                zind--;
+                return static_cast<size_t>(index - 1);
+            };
+
+            size_t records = 0;
+            while(next_token()) {
+                // Get index of field
+                auto xind = read_index(dimensions[0]);
+                if(!next_token()) {
+                    throw std::runtime_error("unexpected end of file");
+                }
+                auto yind = read_index(dimensions[1]);
+                if(!next_token()) {
+                    throw std::runtime_error("unexpected end of file");
+                }
+                auto zind = read_index(dimensions[2]);
 
                 // Loop through components of field
+                auto offset = xind * dimensions[1] * dimensions[2] * N_ + yind * dimensions[2] * N_ + zind * N_;
                 for(size_t j = 0; j < N_; ++j) {
-                    double input;
-                    file >> input;
+                    if(!next_token()) {
+                        throw std::runtime_error("unexpected end of file");
+                    }
+                    char* token_end = nullptr;
+                    auto input = std::strtod(token, &token_end);
+                    if(*token_end != '\0') {
+                        throw std::runtime_error("invalid data");
+                    }
 
                     // Set the field at a position
-                    (*field)[xind * ysize * zsize * N_ + yind * zsize * N_ + zind * N_ + j] = Units::get(input, units);
+                    field[offset + j] = input * factor;
                 }
+                ++records;
             }
-            LOG_PROGRESS(INFO, "read_init") << "Reading field data: finished.";
-
-            FieldData<T> field_data(
-                header, std::array<size_t, 3>{{xsize, ysize, zsize}}, std::array<T, 3>{{xpixsz, ypixsz, thickness}}, field);
-
-            // Store the parsed field data for further reference:
-            field_map_[file_name] = field_data;
-            return field_data;
+            return records;
         }
 
         size_t N_;
-        std::map<std::string, FieldData<T>> field_map_;
+
+        // Cached field data, without its values if the data is only referenced weakly
+        struct CachedField {
+            FieldData<T> data;
+            std::weak_ptr<const T> values;
+        };
+        std::map<std::pair<std::string, std::string>, CachedField> field_map_;
+        std::map<std::pair<std::string, std::string>, std::shared_ptr<std::mutex>> file_mutexes_;
+        std::mutex mutex_;
     };
 
     /**
@@ -375,6 +1327,35 @@ namespace allpix {
         };
         ~FieldWriter() = default;
 
+        /**
+         * @brief Set the compression of APF files with compressed chunks
+         * @param algorithm Name of the ROOT compression algorithm, either "zlib", "lzma", "lz4" or "zstd"
+         * @param level     Compression level between 1 and 9
+         * @param chunk_size Number of values compressed together in a chunk
+         */
+        void setCompression(const std::string& algorithm, unsigned int level = 4, size_t chunk_size = (1u << 20u)) {
+            if(algorithm == "zlib") {
+                algorithm_ = 1;
+            } else if(algorithm == "lzma") {
+                algorithm_ = 2;
+            } else if(algorithm == "lz4") {
+                algorithm_ = 4;
+            } else if(algorithm == "zstd" && ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)) {
+                algorithm_ = 5;
+            } else {
+                throw std::invalid_argument("unknown compression algorithm " + algorithm);
+            }
+            if(level < 1 || level > 9) {
+                throw std::invalid_argument("compression level should be between 1 and 9");
+            }
+            // ROOT compresses blocks of at most 16 MB
+            if(chunk_size == 0 || chunk_size * sizeof(T) > 0xffffffu) {
+                throw std::invalid_argument("chunk size should be positive and less than 16 MB");
+            }
+            level_ = level;
+            chunk_size_ = chunk_size;
+        }
+
         /**
          * @brief Write the field to a file
          * @param field_data Field data object to store
@@ -387,7 +1368,7 @@ namespace allpix {
                        const FileType& file_type,
                        const std::string& units = std::string()) {
             auto dimensions = field_data.getDimensions();
-            if(field_data.getData()->size() != N_ * dimensions[0] * dimensions[1] * dimensions[2]) {
+            if(field_data.getValuesSize() != N_ * dimensions[0] * dimensions[1] * dimensions[2]) {
                 throw std::runtime_error("invalid field dimensions");
             }
 
@@ -404,6 +1385,18 @@ namespace allpix {
                 }
                 write_apf_file(field_data, file_name);
                 break;
+            case FileType::APF2:
+                if(!units.empty()) {
+                    LOG(WARNING) << "Units will be ignored, APF file content is written in internal units.";
+                }
+                write_apf2_file(field_data, file_name);
+                break;
+            case FileType::APFZ:
+                if(!units.empty()) {
+                    LOG(WARNING) << "Units will be ignored, APF file content is written in internal units.";
+                }
+                write_apfz_file(field_data, file_name);
+                break;
             default:
                 throw std::runtime_error("unknown file format");
             }
@@ -420,15 +1413,124 @@ namespace allpix {
         void write_apf_file(const FieldData<T>& field_data, const std::string& file_name) {
             std::ofstream file(file_name, std::ios::binary);
 
-            // Write the file with cereal:
+            // Write the file with cereal, copying field data stored in external memory first:
             try {
                 cereal::PortableBinaryOutputArchive archive(file);
-                archive(field_data);
+                if(field_data.isExternal()) {
+                    archive(FieldData<T>(field_data.getHeader(),
+                                         field_data.getDimensions(),
+                                         field_data.getSize(),
+                                         field_data.getData()));
+                } else {
+                    archive(field_data);
+                }
             } catch(cereal::Exception& e) {
                 throw std::runtime_error(e.what());
             }
         }
 
+        /**
+         * @brief Function to write FieldData into a memory-mappable APF file. The field data is stored as raw values in
+         * native byte order behind a fixed-size header, aligned to a page boundary. This does not convert any units.
+         * @param field_data Field data object to store
+         * @param file_name  File name (as canonical path) of the output file to be created
+         */
+        void write_apf2_file(const FieldData<T>& field_data, const std::string& file_name) {
+            MappedFieldWriter<T> writer(
+                file_name, field_data.getHeader(), field_data.getDimensions(), field_data.getSize(), N_);
+            writer.write(0, field_data.getValues().get(), field_data.getValuesSize());
+            writer.close();
+        }
+
+        /**
+         * @brief Function to write FieldData into an APF file with compressed chunks. This does not convert any units.
+         * @param field_data Field data object to store
+         * @param file_name  File name (as canonical path) of the output file to be created
+         */
+        void write_apfz_file(const FieldData<T>& field_data, const std::string& file_name) {
+            auto values = field_data.getValues();
+            auto values_size = field_data.getValuesSize();
+
+            CompressedFieldHeader header{};
+            std::memcpy(header.magic, APFZ_MAGIC, sizeof(header.magic));
+            header.version = APFZ_LAYOUT_VERSION;
+            header.byte_order = 0x01020304u;
+            header.value_size = sizeof(T);
+            header.quantity = N_;
+            for(size_t i = 0; i < 3; ++i) {
+                header.dimensions[i] = field_data.getDimensions()[i];
+                header.size[i] = static_cast<double>(field_data.getSize()[i]);
+            }
+            header.header_length = field_data.getHeader().size();
+            header.chunk_size = chunk_size_;
+            header.chunk_count = (values_size + chunk_size_ - 1) / chunk_size_;
+            header.algorithm = algorithm_;
+            header.level = level_;
+
+            // Leave space for the chunk index, which is written after all chunks are compressed
+            std::ofstream file(file_name, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(field_data.getHeader().data(), static_cast<std::streamsize>(header.header_length));
+            auto index_position = file.tellp();
+            std::vector<uint64_t> index(header.chunk_count + 1);
+            file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * 8));
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+            auto algorithm = static_cast<ROOT::RCompressionSetting::EAlgorithm::EValues>(algorithm_);
+#else
+            auto algorithm = static_cast<ROOT::ECompressionAlgorithm>(algorithm_);
+#endif
+            // Compress the chunks in parallel and write them in their order
+            process_in_order<std::vector<char>>(
+                header.chunk_count,
+                [&](size_t chunk, std::vector<char>& shuffled, std::vector<char>& stored) {
+                    auto chunk_offset = chunk * chunk_size_;
+                    auto count = std::min(chunk_size_, values_size - chunk_offset);
+                    auto raw_size = count * sizeof(T);
+
+                    // Group the bytes of the values by their significance
+                    const auto* bytes = reinterpret_cast<const char*>(values.get() + chunk_offset);
+                    shuffled.resize(raw_size);
+                    for(size_t byte = 0; byte < sizeof(T); ++byte) {
+                        for(size_t i = 0; i < count; ++i) {
+                            shuffled[byte * count + i] = bytes[i * sizeof(T) + byte];
+                        }
+                    }
+
+                    // Compress the chunk, storing it uncompressed if that does not reduce its size
+                    stored.resize(raw_size);
+                    int source_size = static_cast<int>(raw_size);
+                    int target_size = static_cast<int>(raw_size);
+                    int compressed_size = 0;
+                    R__zipMultipleAlgorithm(static_cast<int>(level_),
+                                            &source_size,
+                                            shuffled.data(),
+                                            &target_size,
+                                            stored.data(),
+                                            &compressed_size,
+                                            algorithm);
+                    if(compressed_size > 0 && static_cast<size_t>(compressed_size) < raw_size) {
+                        stored.resize(static_cast<size_t>(compressed_size));
+                    } else {
+                        stored.assign(shuffled.begin(), shuffled.end());
+                    }
+                },
+                [&](size_t chunk, const std::vector<char>& stored) {
+                    index[chunk] = static_cast<uint64_t>(file.tellp());
+                    file.write(stored.data(), static_cast<std::streamsize>(stored.size()));
+                    LOG_PROGRESS(INFO, "write_apfz")
+                        << "Compressing field data: " << (100 * (chunk + 1) / header.chunk_count) << "%";
+                });
+            index.back() = static_cast<uint64_t>(file.tellp());
+
+            file.seekp(index_position);
+            file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * 8));
+            file.close();
+            if(file.fail()) {
+                throw std::runtime_error("cannot write file");
+            }
+        }
+
         /**
          * @brief Function to write FieldData objects out to INIT-formatted ASCII files. Values are converted from the
          * framework-internal base units in which the data is stored in FieldData into the units provided by the units
@@ -457,35 +1559,92 @@ namespace allpix {
             file << dimensions[0] << " " << dimensions[1] << " " << dimensions[2] << " "; // Field grid dimensions (x, y, z)
             file << "0.0" << std::endl;                                                   // Unused
 
-            // Write the data block:
-            auto data = field_data.getData();
-            auto max_points = data->size() / N_;
-
-            for(size_t xind = 0; xind < dimensions[0]; ++xind) {
-                for(size_t yind = 0; yind < dimensions[1]; ++yind) {
-                    for(size_t zind = 0; zind < dimensions[2]; ++zind) {
-                        // Write field point index
-                        file << xind + 1 << " " << yind + 1 << " " << zind + 1;
-
-                        // Vector or scalar field:
-                        for(size_t j = 0; j < N_; j++) {
-                            file << " "
-                                 << Units::convert(data->at(xind * dimensions[1] * dimensions[2] * N_ +
-                                                            yind * dimensions[2] * N_ + zind * N_ + j),
-                                                   units);
+            // Write the data block, formatting the planes in x in parallel and writing them in their order:
+            auto data = field_data.getValues();
+            process_in_order<std::string>(
+                dimensions[0],
+                [&](size_t xind, std::string&, std::string& block) {
+                    std::ostringstream plane;
+                    for(size_t yind = 0; yind < dimensions[1]; ++yind) {
+                        for(size_t zind = 0; zind < dimensions[2]; ++zind) {
+                            // Write field point index
+                            plane << xind + 1 << " " << yind + 1 << " " << zind + 1;
+
+                            // Vector or scalar field:
+                            for(size_t j = 0; j < N_; j++) {
+                                plane << " "
+                                      << Units::convert(data.get()[xind * dimensions[1] * dimensions[2] * N_ +
+                                                                   yind * dimensions[2] * N_ + zind * N_ + j],
+                                                        units);
+                            }
+                            // End this line
+                            plane << '\n';
+                        }
+                    }
+                    block = plane.str();
+                },
+                [&](size_t xind, const std::string& block) {
+                    file << block;
+                    LOG_PROGRESS(INFO, "write_init")
+                        << "Writing field data: " << (100 * (xind + 1) / dimensions[0]) << "%";
+                });
+            LOG_PROGRESS(INFO, "write_init") << "Writing field data: finished.";
+        }
+
+        /**
+         * @brief Helper function to produce blocks of output in parallel and consume them in their order
+         * @param count   Number of blocks
+         * @param produce Function producing a block from its index, with a scratch buffer owned by the calling thread
+         * @param consume Function consuming a block, called in the order of the blocks from the calling thread only
+         *
+         * The blocks are produced in batches of one block per available core, such that only a single batch of blocks is
+         * held in memory at any time.
+         */
+        template <typename Buffer, typename Produce, typename Consume>
+        static void process_in_order(size_t count, Produce produce, Consume consume) {
+            auto threads = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<Buffer> blocks(threads);
+            std::vector<Buffer> scratch(threads);
+            for(size_t batch = 0; batch < count; batch += threads) {
+                auto batch_size = std::min<size_t>(threads, count - batch);
+                std::atomic<size_t> next_block{0};
+                std::exception_ptr error;
+                std::mutex error_mutex;
+                auto worker = [&](size_t thread) {
+                    try {
+                        for(size_t block = next_block++; block < batch_size; block = next_block++) {
+                            produce(batch + block, scratch[thread], blocks[block]);
                         }
-                        // End this line
-                        file << std::endl;
+                    } catch(...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        error = std::current_exception();
                     }
+                };
 
-                    auto curr_point = xind * dimensions[1] * dimensions[2] + yind * dimensions[2];
-                    LOG_PROGRESS(INFO, "write_init") << "Writing field data: " << (100 * curr_point / max_points) << "%";
+                std::vector<std::thread> workers;
+                for(size_t thread = 1; thread < batch_size; ++thread) {
+                    workers.emplace_back(worker, thread);
+                }
+                worker(0);
+                for(auto& thread : workers) {
+                    thread.join();
+                }
+                if(error) {
+                    std::rethrow_exception(error);
+                }
+
+                for(size_t block = 0; block < batch_size; ++block) {
+                    consume(batch + block, blocks[block]);
                 }
             }
-            LOG_PROGRESS(INFO, "write_init") << "Writing field data: finished.";
         }
 
         size_t N_;
+
+        // Compression of APF files with compressed chunks, defaulting to LZ4 for fast decompression
+        std::uint32_t algorithm_{4};
+        std::uint32_t level_{4};
+        size_t chunk_size_{1u << 20u};
     };
 } // namespace allpix
 
@@ -0,0 +1,179 @@
+/**
+ * @file
+ * @brief Utility to compute the mobility of charge carriers in silicon
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_MOBILITY_H
+#define ALLPIX_MOBILITY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "core/utils/unit.h"
+#include "objects/SensorCharge.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Jacoboni-Canali parameterization of the charge carrier mobility in silicon
+     *
+     * Parameterization variables from https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2) for a given temperature.
+     * The mobility is either evaluated exactly, or linearly interpolated from a table precomputed up to a maximum electric
+     * field magnitude, which avoids the two power functions of the exact evaluation. Fields above the range of the table
+     * are always evaluated exactly.
+     */
+    class JacoboniCanaliMobility {
+    public:
+        /**
+         * @brief Construct the mobility model for a given temperature
+         * @param temperature Temperature of the sensor in Kelvin
+         */
+        explicit JacoboniCanaliMobility(double temperature = 293.15) {
+            electron_.saturation_velocity = Units::get(1.53e9 * std::pow(temperature, -0.87), "cm/s");
+            electron_.critical_field = Units::get(1.01 * std::pow(temperature, 1.55), "V/cm");
+            electron_.beta = 2.57e-2 * std::pow(temperature, 0.66);
+
+            hole_.saturation_velocity = Units::get(1.62e8 * std::pow(temperature, -0.52), "cm/s");
+            hole_.critical_field = Units::get(1.24 * std::pow(temperature, 1.68), "V/cm");
+            hole_.beta = 0.46 * std::pow(temperature, 0.17);
+
+            for(auto* parameters : {&electron_, &hole_}) {
+                parameters->zero_field_mobility = parameters->saturation_velocity / parameters->critical_field;
+                parameters->inverse_beta = 1.0 / parameters->beta;
+            }
+        }
+
+        /**
+         * @brief Compute the mobility of a charge carrier
+         * @param type Type of the charge carrier
+         * @param efield_mag Magnitude of the electric field
+         * @return Mobility of the charge carrier
+         * @note This function is typically the most frequently executed part of the framework and therefore the bottleneck
+         */
+        double operator()(const CarrierType& type, double efield_mag) const {
+            const auto& parameters = get_parameters(type);
+            if(parameters.table.empty() || efield_mag >= table_max_field_) {
+                return evaluate(parameters, efield_mag);
+            }
+
+            auto position = efield_mag * table_inverse_bin_width_;
+            auto index = static_cast<size_t>(position);
+            auto fraction = position - static_cast<double>(index);
+            return parameters.table[index] + fraction * (parameters.table[index + 1] - parameters.table[index]);
+        }
+
+        /**
+         * @brief Precompute a table of the mobility to interpolate from
+         * @param max_field Maximum electric field magnitude covered by the table
+         * @param precision Maximum relative deviation of the interpolated from the exact mobility
+         * @param max_bins Maximum number of bins of the table for every carrier type
+         * @return True if the precision is reached, false otherwise (the table is not used in this case)
+         *
+         * The number of bins is doubled until the deviation in the center of every bin is below the requested precision.
+         */
+        bool tabulate(double max_field, double precision, size_t max_bins = 1u << 20u) {
+            for(size_t bins = 64; bins <= max_bins; bins *= 2) {
+                auto bin_width = max_field / static_cast<double>(bins);
+                bool precise = true;
+                for(auto* parameters : {&electron_, &hole_}) {
+                    parameters->table.resize(bins + 1);
+                    for(size_t i = 0; i <= bins; ++i) {
+                        parameters->table[i] = evaluate(*parameters, static_cast<double>(i) * bin_width);
+                    }
+                    for(size_t i = 0; i < bins && precise; ++i) {
+                        auto exact = evaluate(*parameters, (static_cast<double>(i) + 0.5) * bin_width);
+                        auto interpolated = (parameters->table[i] + parameters->table[i + 1]) / 2.0;
+                        precise = std::fabs(interpolated - exact) <= precision * exact;
+                    }
+                }
+
+                if(precise) {
+                    table_max_field_ = max_field;
+                    table_inverse_bin_width_ = 1.0 / bin_width;
+                    return true;
+                }
+            }
+
+            // Fall back to the exact evaluation if the precision cannot be reached
+            electron_.table.clear();
+            hole_.table.clear();
+            return false;
+        }
+
+        /**
+         * @brief Check if the mobility is interpolated from a precomputed table
+         * @return True if a table is used, false if the mobility is evaluated exactly
+         */
+        bool isTabulated() const { return !electron_.table.empty(); }
+
+        /**
+         * @brief Get the number of bins of the precomputed table
+         * @return Number of bins for every carrier type (zero if no table is used)
+         */
+        size_t getTableBins() const { return electron_.table.empty() ? 0 : electron_.table.size() - 1; }
+
+        /**
+         * @brief Get the saturation velocity of a charge carrier
+         * @param type Type of the charge carrier
+         * @return Saturation velocity
+         */
+        double getSaturationVelocity(const CarrierType& type) const { return get_parameters(type).saturation_velocity; }
+
+        /**
+         * @brief Get the critical electric field of a charge carrier
+         * @param type Type of the charge carrier
+         * @return Critical electric field
+         */
+        double getCriticalField(const CarrierType& type) const { return get_parameters(type).critical_field; }
+
+        /**
+         * @brief Get the exponent of the parameterization for a charge carrier
+         * @param type Type of the charge carrier
+         * @return Exponent beta
+         */
+        double getBeta(const CarrierType& type) const { return get_parameters(type).beta; }
+
+        /**
+         * @brief Get the mobility of a charge carrier at zero electric field
+         * @param type Type of the charge carrier
+         * @return Mobility at zero field (saturation velocity over critical field)
+         */
+        double getZeroFieldMobility(const CarrierType& type) const { return get_parameters(type).zero_field_mobility; }
+
+    private:
+        /**
+         * @brief Parameters and precomputed table of a single carrier type
+         */
+        struct Parameters {
+            double saturation_velocity{};
+            double critical_field{};
+            double beta{};
+            double zero_field_mobility{};
+            double inverse_beta{};
+            std::vector<double> table;
+        };
+
+        const Parameters& get_parameters(const CarrierType& type) const {
+            return (type == CarrierType::ELECTRON ? electron_ : hole_);
+        }
+
+        static double evaluate(const Parameters& parameters, double efield_mag) {
+            return parameters.zero_field_mobility /
+                   std::pow(1. + std::pow(efield_mag / parameters.critical_field, parameters.beta), parameters.inverse_beta);
+        }
+
+        Parameters electron_;
+        Parameters hole_;
+
+        double table_max_field_{};
+        double table_inverse_bin_width_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MOBILITY_H */
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @brief Utility to draw normally distributed random numbers from a pool generated in blocks
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_NORMAL_POOL_H
+#define ALLPIX_NORMAL_POOL_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace allpix {
+
+    /**
+     * @brief Pool of standard normal random numbers, refilled in blocks from a random generator
+     *
+     * Every refill draws a full block of uniform numbers from the generator and converts them pairwise to standard normal
+     * numbers with the Box-Muller transform. The conversion loop does not branch, such that it can be vectorized by the
+     * compiler, in contrast to the rejection sampling of std::normal_distribution. The numbers are scaled to the requested
+     * standard deviation when they are drawn, such that a single pool serves distributions of any width.
+     *
+     * The pool is not thread-safe and holds a reference to its generator. It should be created for every task drawing from
+     * a generator, such that the drawn numbers only depend on the state of that generator and not on the order in which
+     * the tasks are executed. Numbers left in the pool when it is destroyed are discarded. The numbers follow the same
+     * distribution as the ones of std::normal_distribution, but the sequence of numbers drawn is different.
+     */
+    template <typename RandomGenerator, std::size_t BlockSize = 128> class NormalPool {
+        static_assert(BlockSize > 0 && BlockSize % 2 == 0, "block size has to be a positive even number");
+        static_assert(RandomGenerator::min() == 0 && RandomGenerator::max() == std::numeric_limits<uint64_t>::max(),
+                      "random generator has to produce 64 random bits");
+
+    public:
+        /**
+         * @brief Construct an empty pool, which is filled with the first number drawn
+         * @param generator Random generator to fill the pool from
+         */
+        explicit NormalPool(RandomGenerator& generator) : generator_(generator) {}
+
+        /**
+         * @brief Draw a normal random number with mean zero
+         * @param std_dev Standard deviation of the distribution
+         * @return Random number
+         */
+        double operator()(double std_dev) {
+            if(next_ == BlockSize) {
+                refill();
+            }
+            return std_dev * values_[next_++];
+        }
+
+    private:
+        static constexpr double two_pi = 6.283185307179586;
+
+        /**
+         * @brief Replace all numbers of the pool by a new block drawn from the generator
+         */
+        void refill() {
+            // Uniform numbers in [0, 1) with the 53 upper bits of the generator output
+            std::array<double, BlockSize> uniforms; // NOLINT
+            for(auto& uniform : uniforms) {
+                uniform = static_cast<double>(generator_() >> 11u) * 0x1.0p-53;
+            }
+
+            // Box-Muller transform, using one minus the first number of a pair to avoid the logarithm of zero
+            for(std::size_t i = 0; i < BlockSize / 2; ++i) {
+                double radius = std::sqrt(-2. * std::log(1. - uniforms[2 * i]));
+                double angle = two_pi * uniforms[2 * i + 1];
+                values_[2 * i] = radius * std::cos(angle);
+                values_[2 * i + 1] = radius * std::sin(angle);
+            }
+            next_ = 0;
+        }
+
+        RandomGenerator& generator_;
+        // Not initialized, the numbers are only read after the first refill
+        std::array<double, BlockSize> values_; // NOLINT
+        std::size_t next_{BlockSize};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_NORMAL_POOL_H */
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief Utility to group values by the pixel they are assigned to
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PIXEL_ACCUMULATOR_H
+#define ALLPIX_PIXEL_ACCUMULATOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "objects/Pixel.hpp"
+
+namespace allpix {
+
+    /**
+     * @brief Accumulator grouping values by the pixel of a pixel grid they are assigned to
+     *
+     * Values are added together with the index of their pixel, and are afterwards visited grouped by pixel in a single
+     * linear sweep. The pixels are visited in ascending order of their index as defined for \ref Pixel::Index, and the
+     * values of every pixel in the order they have been added, equal to the iteration over a std::map of vectors.
+     *
+     * Pixels are assigned a slot by a dense lookup table covering the full pixel grid, or by a hash table for grids above
+     * \ref max_dense_pixels. The values are sorted by pixel with a counting sort over the slots. All containers keep their
+     * memory after \ref clear, such that an accumulator reused for every event does not allocate once the largest event has
+     * been seen. The accumulator is not thread-safe, but can be kept per thread and reused for different pixel grids.
+     */
+    template <typename T> class PixelAccumulator {
+    public:
+        /**
+         * @brief Largest number of pixels of a grid for which a dense lookup table is used
+         */
+        static constexpr uint64_t max_dense_pixels = 1u << 24u;
+
+        /**
+         * @brief Prepare the accumulator for a pixel grid, discarding all values added before
+         * @param grid_size Number of pixels of the grid in x and y
+         */
+        void reset(const Pixel::Index& grid_size) {
+            clear();
+            grid_y_ = grid_size.y();
+            auto pixels = static_cast<uint64_t>(grid_size.x()) * grid_size.y();
+            dense_ = (pixels <= max_dense_pixels);
+            if(dense_ && dense_slots_.size() < pixels) {
+                dense_slots_.resize(pixels, no_slot_);
+            }
+        }
+
+        /**
+         * @brief Add a value to a pixel
+         * @param index Index of the pixel, which should be within the grid
+         * @param value Value to add
+         */
+        void add(const Pixel::Index& index, T value) {
+            auto key = static_cast<uint64_t>(index.x()) * grid_y_ + index.y();
+            uint32_t* slot = nullptr;
+            if(dense_) {
+                slot = &dense_slots_[key];
+            } else {
+                slot = &sparse_slots_.emplace(key, no_slot_).first->second;
+            }
+            if(*slot == no_slot_) {
+                *slot = static_cast<uint32_t>(pixels_.size());
+                pixels_.push_back(index);
+                keys_.push_back(key);
+                counts_.push_back(0);
+            }
+            ++counts_[*slot];
+            entries_.emplace_back(*slot, std::move(value));
+        }
+
+        /**
+         * @brief Get the number of different pixels values have been added to
+         * @return Number of pixels
+         */
+        size_t size() const { return pixels_.size(); }
+
+        /**
+         * @brief Visit the values grouped by pixel
+         * @param function Function called for every pixel with its index and the iterators to the range of its values
+         */
+        template <typename F> void forEachPixel(F&& function) {
+            // Order the slots by the key of their pixel, which corresponds to the order of the pixel indices
+            order_.resize(pixels_.size());
+            for(uint32_t slot = 0; slot < order_.size(); ++slot) {
+                order_[slot] = slot;
+            }
+            std::sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) { return keys_[a] < keys_[b]; });
+
+            // Counting sort of the values, keeping the order in which they were added for every pixel
+            offsets_.resize(pixels_.size());
+            size_t offset = 0;
+            for(auto slot : order_) {
+                offsets_[slot] = offset;
+                offset += counts_[slot];
+            }
+            sorted_.resize(entries_.size());
+            for(auto& entry : entries_) {
+                sorted_[offsets_[entry.first]++] = std::move(entry.second);
+            }
+
+            size_t begin = 0;
+            for(auto slot : order_) {
+                auto end = begin + counts_[slot];
+                function(pixels_[slot],
+                         sorted_.cbegin() + static_cast<std::ptrdiff_t>(begin),
+                         sorted_.cbegin() + static_cast<std::ptrdiff_t>(end));
+                begin = end;
+            }
+        }
+
+        /**
+         * @brief Discard all values, keeping the allocated memory
+         */
+        void clear() {
+            if(dense_) {
+                for(auto key : keys_) {
+                    dense_slots_[key] = no_slot_;
+                }
+            }
+            sparse_slots_.clear();
+            pixels_.clear();
+            keys_.clear();
+            counts_.clear();
+            entries_.clear();
+            sorted_.clear();
+        }
+
+    private:
+        static constexpr uint32_t no_slot_ = std::numeric_limits<uint32_t>::max();
+
+        uint64_t grid_y_{};
+        bool dense_{true};
+        std::vector<uint32_t> dense_slots_;
+        std::unordered_map<uint64_t, uint32_t> sparse_slots_;
+
+        // Data of every slot
+        std::vector<Pixel::Index> pixels_;
+        std::vector<uint64_t> keys_;
+        std::vector<size_t> counts_;
+
+        std::vector<std::pair<uint32_t, T>> entries_;
+        std::vector<uint32_t> order_;
+        std::vector<size_t> offsets_;
+        std::vector<T> sorted_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PIXEL_ACCUMULATOR_H */
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief Utility to count the field lookups and integration steps of the propagation of charge carriers
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PROPAGATION_COUNTERS_H
+#define ALLPIX_PROPAGATION_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Counters of the work done to propagate sets of charge carriers
+     *
+     * The counters are plain integers which are incremented by a single thread, for example per task or per event, and
+     * added to the totals of the module once the task is done. Counting therefore does not require any synchronization in
+     * the integration loop. The number of integration steps of every set is recorded in bins of powers of two, such that
+     * the distribution of the steps per set is available without filling histograms.
+     */
+    class PropagationCounters {
+    public:
+        /**
+         * @brief Number of bins of the distribution of the integration steps per set of charge carriers
+         */
+        static constexpr size_t step_bins = 16;
+
+        /**
+         * @brief Record a lookup of a field
+         * @param zero True if the lookup returned the null vector, as done outside of the field or of the sensor
+         */
+        void addFieldLookup(bool zero) {
+            ++field_lookups;
+            zero_fields += (zero ? 1 : 0);
+        }
+
+        /**
+         * @brief Record lookups of the weighting potential
+         * @param lookups Number of pixels the potential has been looked up for
+         */
+        void addPotentialLookups(unsigned long lookups) { potential_lookups += lookups; }
+
+        /**
+         * @brief Record the end of the propagation of a set of charge carriers
+         * @param steps Number of accepted integration steps of the set
+         * @param timeout True if the set was stopped because the integration time has been reached
+         */
+        void addSet(unsigned long steps, bool timeout) {
+            size_t bin = 0;
+            while(bin + 1 < step_bins && (steps >> (bin + 1)) > 0) {
+                ++bin;
+            }
+            ++step_distribution[bin];
+            timeouts += (timeout ? 1 : 0);
+        }
+
+        /**
+         * @brief Add the counters of another task or event
+         * @param other Counters to add
+         * @return Reference to these counters
+         */
+        PropagationCounters& operator+=(const PropagationCounters& other) {
+            field_lookups += other.field_lookups;
+            zero_fields += other.zero_fields;
+            potential_lookups += other.potential_lookups;
+            integration_steps += other.integration_steps;
+            rejected_steps += other.rejected_steps;
+            pruned_inductions += other.pruned_inductions;
+            timeouts += other.timeouts;
+            for(size_t bin = 0; bin < step_bins; ++bin) {
+                step_distribution[bin] += other.step_distribution[bin];
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Get the names and values of all counters, except for the distribution of the steps
+         * @return List of pairs of the name and the value of the counters
+         */
+        std::vector<std::pair<std::string, double>> getValues() const {
+            return {{"field_lookups", static_cast<double>(field_lookups)},
+                    {"zero_field_lookups", static_cast<double>(zero_fields)},
+                    {"potential_lookups", static_cast<double>(potential_lookups)},
+                    {"integration_steps", static_cast<double>(integration_steps)},
+                    {"rejected_steps", static_cast<double>(rejected_steps)},
+                    {"pruned_inductions", static_cast<double>(pruned_inductions)},
+                    {"timed_out_sets", static_cast<double>(timeouts)}};
+        }
+
+        /**
+         * @brief Get a description of the distribution of the integration steps per set
+         * @return Number of sets for every range of steps which contains sets
+         */
+        std::string getStepDistribution() const {
+            std::ostringstream distribution;
+            for(size_t bin = 0; bin < step_bins; ++bin) {
+                if(step_distribution[bin] == 0) {
+                    continue;
+                }
+                if(distribution.tellp() > 0) {
+                    distribution << ", ";
+                }
+                distribution << (bin == 0 ? 0ul : 1ul << bin) << "-";
+                if(bin + 1 < step_bins) {
+                    distribution << ((1ul << (bin + 1)) - 1);
+                }
+                distribution << ": " << step_distribution[bin];
+            }
+            return distribution.str();
+        }
+
+        unsigned long field_lookups{};
+        unsigned long zero_fields{};
+        unsigned long potential_lookups{};
+        unsigned long integration_steps{};
+        unsigned long rejected_steps{};
+        unsigned long pruned_inductions{};
+        unsigned long timeouts{};
+        std::array<unsigned long, step_bins> step_distribution{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PROPAGATION_COUNTERS_H */
@@ -0,0 +1,168 @@
+/**
+ * @file
+ * @brief Utility to store the response of the pixels to charge carriers deposited in the voxels of a pixel cell
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_RESPONSE_LIBRARY_H
+#define ALLPIX_RESPONSE_LIBRARY_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "core/geometry/DetectorGeometryView.hpp"
+#include "tools/field_parser.h"
+
+namespace allpix {
+
+    /**
+     * @brief Library of the fraction of charge carriers collected by the pixels around the voxel they are deposited in
+     *
+     * The pixel cell, spanning the pitch of a pixel and the full sensor thickness, is divided into a regular grid of voxels.
+     * For every voxel and for both carrier types, the library holds the fraction of the deposited charge carriers which is
+     * collected by each pixel of a square matrix centered on the pixel the carriers are deposited in. The fractions of all
+     * pixels of a matrix add up to at most one, the remainder is lost outside of the matrix or not collected at all.
+     *
+     * The library is stored as field data, with the voxels as field points and the size of the pixel cell as field size.
+     * Every voxel holds the fractions of electrons followed by the ones of holes, each ordered by the column and then the
+     * row of the pixel in the matrix. The files can thus be written and read in all binary APF formats.
+     */
+    class ResponseLibrary {
+    public:
+        /**
+         * @brief Construct an empty library
+         * @param voxels Number of voxels of the pixel cell in x, y and z
+         * @param matrix_size Number of pixels of the side of the pixel matrix, has to be odd
+         * @param cell_size Size of the pixel cell in x, y and z
+         */
+        ResponseLibrary(std::array<size_t, 3> voxels, size_t matrix_size, std::array<double, 3> cell_size)
+            : voxels_(voxels), matrix_size_(matrix_size), cell_size_(cell_size) {
+            if(matrix_size_ % 2 == 0) {
+                throw std::invalid_argument("size of the pixel matrix has to be odd");
+            }
+            if(voxels_[0] == 0 || voxels_[1] == 0 || voxels_[2] == 0) {
+                throw std::invalid_argument("number of voxels has to be positive in all coordinates");
+            }
+            fractions_.resize(voxels_[0] * voxels_[1] * voxels_[2] * getValuesPerVoxel());
+        }
+
+        /**
+         * @brief Construct a library from field data read from file
+         * @param field_data Field data with the fractions of all voxels
+         */
+        explicit ResponseLibrary(const FieldData<double>& field_data)
+            : voxels_(field_data.getDimensions()), cell_size_(field_data.getSize()) {
+            auto vertices = voxels_[0] * voxels_[1] * voxels_[2];
+            auto values = (vertices > 0 ? field_data.getValuesSize() / vertices : 0);
+            matrix_size_ = static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(values / 2))));
+            if(vertices == 0 || values * vertices != field_data.getValuesSize() || matrix_size_ % 2 == 0 ||
+               getValuesPerVoxel() != values) {
+                throw std::runtime_error("field data does not describe a response library");
+            }
+            fractions_.assign(field_data.getValues().get(), field_data.getValues().get() + field_data.getValuesSize());
+        }
+
+        /**
+         * @brief Get the field data of the library to write it to file
+         * @param header Human readable header string of the field data
+         * @return Field data holding the fractions of all voxels
+         */
+        FieldData<double> getFieldData(std::string header) const {
+            return FieldData<double>(
+                std::move(header), voxels_, cell_size_, std::make_shared<std::vector<double>>(fractions_));
+        }
+
+        /**
+         * @brief Get the number of values stored per voxel
+         * @return Number of fractions of both carrier types for all pixels of the matrix
+         */
+        size_t getValuesPerVoxel() const { return 2 * matrix_size_ * matrix_size_; }
+
+        /**
+         * @brief Get the number of pixels of the side of the pixel matrix
+         * @return Size of the pixel matrix
+         */
+        size_t getMatrixSize() const { return matrix_size_; }
+
+        /**
+         * @brief Get the number of voxels of the pixel cell
+         * @return Number of voxels in x, y and z
+         */
+        const std::array<size_t, 3>& getVoxels() const { return voxels_; }
+
+        /**
+         * @brief Get the size of the pixel cell
+         * @return Size of the pixel cell in x, y and z
+         */
+        const std::array<double, 3>& getCellSize() const { return cell_size_; }
+
+        /**
+         * @brief Find the voxel of a position in the pixel cell
+         * @param x Position in x relative to the lower edge of the pixel cell
+         * @param y Position in y relative to the lower edge of the pixel cell
+         * @param z Position in z relative to the lower surface of the sensor
+         * @return Index of the voxel, positions outside of the pixel cell are assigned to the closest voxel
+         */
+        size_t getVoxel(double x, double y, double z) const {
+            auto bin = [](double position, double size, size_t bins) {
+                auto index = static_cast<long>(std::floor(position / size * static_cast<double>(bins)));
+                return static_cast<size_t>(std::clamp(index, 0L, static_cast<long>(bins) - 1));
+            };
+            return (bin(x, cell_size_[0], voxels_[0]) * voxels_[1] + bin(y, cell_size_[1], voxels_[1])) * voxels_[2] +
+                   bin(z, cell_size_[2], voxels_[2]);
+        }
+
+        /**
+         * @brief Find the nearest pixel and the voxel of a position in the sensor
+         * @param geometry Geometry of the detector
+         * @param local_pos Position in the local frame
+         * @param pixel Coordinates of the nearest pixel, which can be outside of the pixel grid
+         * @return Index of the voxel of the position in the cell of the nearest pixel
+         */
+        size_t getVoxel(const DetectorGeometryView& geometry,
+                        const ROOT::Math::XYZPoint& local_pos,
+                        std::pair<int, int>& pixel) const {
+            pixel = geometry.getPixel(local_pos);
+            auto center = geometry.getPixelCenter(pixel.first, pixel.second);
+            return getVoxel(local_pos.x() - center.x() + cell_size_[0] / 2,
+                            local_pos.y() - center.y() + cell_size_[1] / 2,
+                            local_pos.z() - center.z());
+        }
+
+        /**
+         * @brief Get the fractions of the charge carriers of a voxel collected by the pixels of the matrix
+         * @param voxel Index of the voxel
+         * @param carrier Index of the carrier type, zero for electrons and one for holes
+         * @return Pointer to the fractions of all pixels of the matrix, ordered by column and row
+         */
+        const double* getFractions(size_t voxel, size_t carrier) const {
+            return fractions_.data() + voxel * getValuesPerVoxel() + carrier * matrix_size_ * matrix_size_;
+        }
+
+        /**
+         * @copydoc getFractions
+         */
+        double* getFractions(size_t voxel, size_t carrier) {
+            return fractions_.data() + voxel * getValuesPerVoxel() + carrier * matrix_size_ * matrix_size_;
+        }
+
+    private:
+        std::array<size_t, 3> voxels_{};
+        size_t matrix_size_{};
+        std::array<double, 3> cell_size_{};
+        std::vector<double> fractions_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_RESPONSE_LIBRARY_H */
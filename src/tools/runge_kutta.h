@@ -10,7 +10,13 @@
 #ifndef ALLPIX_RUNGE_KUTTA_H
 #define ALLPIX_RUNGE_KUTTA_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -22,9 +28,14 @@ namespace allpix {
      *
      * Class can be provided a Runge-Kutta tableau (optionally with an error function), together with the dimension of the
      * equations and a step function to integrate a step of the equation. Both the result, error and timestep can be
-     * retrieved and changed during the integration.
+     * retrieved and changed during the integration. The type of the step function is a template parameter, such that
+     * lambdas can be called directly and inlined by the compiler instead of being wrapped by a std::function.
      */
-    template <typename T, int S, int D = 3> class RungeKutta {
+    template <typename T,
+              int S,
+              int D = 3,
+              typename F = std::function<Eigen::Matrix<T, D, 1>(T, Eigen::Matrix<T, D, 1>)>>
+    class RungeKutta {
     public:
         /**
          * @brief Utility type to return both the value and the error at every step
@@ -39,7 +50,7 @@ namespace allpix {
         /**
          * @brief Stepping function to integrate a single step of the equations
          */
-        using StepFunction = std::function<Eigen::Matrix<T, D, 1>(T, Eigen::Matrix<T, D, 1>)>;
+        using StepFunction = F;
 
         /**
          * @brief Construct a Runge-Kutta integrator
@@ -91,6 +102,11 @@ namespace allpix {
          * @return Current time
          */
         T getTime() { return t_; }
+        /**
+         * @brief Changes the current time during integration
+         * @note Can be used together with \ref setValue to repeat a rejected step
+         */
+        void setTime(T t) { t_ = std::move(t); }
 
         /**
          * @brief Execute a single time step of the integration
@@ -161,6 +177,168 @@ namespace allpix {
         T t_;
     };
 
+    /**
+     * @brief Class to perform Runge-Kutta integration of a batch of independent equations at the same time
+     *
+     * The values of all equations are stored as a structure of arrays, such that every stage of the tableau is evaluated
+     * for all lanes in simple loops which can be vectorized by the compiler. Every lane has its own time step. Only the
+     * first lanes up to the provided count are integrated, which allows to retire and refill lanes during the integration.
+     * Contrary to \ref RungeKutta the step function does not depend on the time.
+     */
+    template <typename T,
+              int S,
+              std::size_t N,
+              int D = 3,
+              typename F = std::function<void(const std::array<std::array<T, N>, D>& values,
+                                              std::size_t count,
+                                              std::array<std::array<T, N>, D>& derivatives)>>
+    class BatchRungeKutta {
+    public:
+        /**
+         * @brief Value of a single dimension for all lanes
+         */
+        using Lanes = std::array<T, N>;
+        /**
+         * @brief Values of all dimensions for all lanes
+         */
+        using Values = std::array<Lanes, D>;
+
+        /**
+         * @brief Stepping function computing the derivatives of the first count lanes of the values
+         */
+        using StepFunction = F;
+
+        /**
+         * @brief Construct a batched Runge-Kutta integrator
+         * @param tableau One of the possible Runge-Kutta tables (see \ref allpix::tableau should be preferred)
+         * @param function Step function to perform integration
+         */
+        BatchRungeKutta(Eigen::Matrix<T, S + 2, S> tableau, StepFunction function)
+            : tableau_(std::move(tableau)), function_(std::move(function)) {}
+
+        /**
+         * @brief Execute a single time step of the integration for all active lanes
+         * @param values Values to integrate, updated with the result of the step
+         * @param step_sizes Time step of every lane
+         * @param count Number of active lanes, starting from the first lane
+         * @param step Change of the values in this step
+         * @param error Error of the values in this step
+         */
+        void step(Values& values, const Lanes& step_sizes, std::size_t count, Values& step, Values& error) {
+            for(int d = 0; d < D; ++d) {
+                for(std::size_t l = 0; l < count; ++l) {
+                    step[d][l] = 0;
+                    error[d][l] = 0;
+                }
+            }
+
+            // Compute all stages for all lanes
+            for(int i = 0; i < S; ++i) {
+                for(int d = 0; d < D; ++d) {
+                    for(std::size_t l = 0; l < count; ++l) {
+                        stage_[d][l] = values[d][l];
+                    }
+                    for(int j = 0; j < i; ++j) {
+                        const T coefficient = tableau_(i, j);
+                        for(std::size_t l = 0; l < count; ++l) {
+                            stage_[d][l] += step_sizes[l] * coefficient * k_[j][d][l];
+                        }
+                    }
+                }
+                function_(stage_, count, k_[i]);
+
+                const T weight = tableau_(S, i);
+                const T error_weight = tableau_(S + 1, i);
+                for(int d = 0; d < D; ++d) {
+                    for(std::size_t l = 0; l < count; ++l) {
+                        step[d][l] += step_sizes[l] * weight * k_[i][d][l];
+                        error[d][l] += step_sizes[l] * error_weight * k_[i][d][l];
+                    }
+                }
+            }
+
+            // Update values with new step
+            for(int d = 0; d < D; ++d) {
+                for(std::size_t l = 0; l < count; ++l) {
+                    error[d][l] = step[d][l] - error[d][l];
+                    values[d][l] += step[d][l];
+                }
+            }
+        }
+
+    private:
+        const Eigen::Matrix<T, S + 2, S> tableau_;
+        StepFunction function_;
+
+        // Intermediate values and derivatives of all stages
+        Values stage_{};
+        std::array<Values, S> k_{};
+    };
+
+    /**
+     * @brief Proportional-integral controller of the time step of an embedded Runge-Kutta method
+     *
+     * The error estimate of every step is compared to the tolerance. Steps with a larger error are rejected and should be
+     * repeated with the reduced time step, unless the minimum time step has been reached already. For accepted steps the
+     * next time step is derived from the error of the current and the previous accepted step, which avoids the oscillation
+     * of the time step of a simple proportional controller. The exponents follow from the order of the error estimate,
+     * which is four for the Runge-Kutta-Fehlberg method.
+     */
+    template <typename T> class StepSizeController {
+    public:
+        /**
+         * @brief Default constructor, only used to initialize arrays of controllers which are assigned before use
+         */
+        StepSizeController() = default;
+
+        /**
+         * @brief Construct a step size controller
+         * @param tolerance Maximum error of a single step
+         * @param min_step Minimum time step, steps with this time step are always accepted
+         * @param max_step Maximum time step
+         * @param order Order of the error estimate of the method
+         */
+        StepSizeController(T tolerance, T min_step, T max_step, int order = 4)
+            : tolerance_(tolerance), min_step_(min_step), max_step_(max_step), alpha_(T(0.7) / static_cast<T>(order + 1)),
+              beta_(T(0.4) / static_cast<T>(order + 1)), reject_exponent_(T(1) / static_cast<T>(order + 1)) {}
+
+        /**
+         * @brief Check the error of a step and compute the time step to continue with
+         * @param error Norm of the error estimate of the step
+         * @param step_size Time step of the step, replaced by the time step of the next or the repeated step
+         * @return True if the step is accepted, false if it should be repeated with the new time step
+         */
+        bool update(T error, T& step_size) {
+            auto ratio = std::max(error / tolerance_, min_ratio_);
+            if(ratio > 1 && step_size > min_step_) {
+                auto factor = std::max(min_factor_, safety_ * std::pow(ratio, -reject_exponent_));
+                step_size = std::max(min_step_, step_size * factor);
+                rejected_ = true;
+                return false;
+            }
+
+            // Do not increase the time step directly after a rejected step
+            auto factor = safety_ * std::pow(ratio, -alpha_) * std::pow(previous_ratio_, beta_);
+            factor = std::min(std::max(factor, min_factor_), rejected_ ? T(1) : max_factor_);
+            step_size = std::min(std::max(step_size * factor, min_step_), max_step_);
+            previous_ratio_ = ratio;
+            rejected_ = false;
+            return true;
+        }
+
+    private:
+        static constexpr T safety_ = T(0.9);
+        static constexpr T min_factor_ = T(0.2);
+        static constexpr T max_factor_ = T(5);
+        static constexpr T min_ratio_ = T(1e-4);
+
+        T tolerance_{1}, min_step_{}, max_step_{};
+        T alpha_{}, beta_{}, reject_exponent_{};
+
+        T previous_ratio_{1};
+        bool rejected_{false};
+    };
+
     // clang-format off
     namespace tableau {
         /**
@@ -202,12 +380,20 @@ namespace allpix {
     /**
      * @brief Utility function to create RungeKutta class using template deduction
      * @param tableau One of the possible Runge-Kutta tableaus (see \ref allpix::tableau)
-     * @param args Other forwarded arguments to the \ref RungeKutta::RungeKutta constructor
+     * @param function Step function to perform integration, its type is used as the step function type of the integrator
+     * @param step_size Time step of the integration
+     * @param initial_y Start values of the vector to perform integration on
+     * @param initial_t Initial time at the start of the integration
      * @return Instantiation of \ref RungeKutta class with the forwarded arguments
      */
-    template <typename T, int S, int D = 3, class... Args>
-    RungeKutta<T, S, D> make_runge_kutta(const Eigen::Matrix<T, S + 2, S>& tableau, Args&&... args) {
-        return RungeKutta<T, S, D>(tableau, std::forward<Args>(args)...);
+    template <typename T, int S, int D, typename F>
+    RungeKutta<T, S, D, std::decay_t<F>> make_runge_kutta(const Eigen::Matrix<T, S + 2, S>& tableau,
+                                                          F&& function,
+                                                          typename Eigen::Matrix<T, D, 1>::Scalar step_size,
+                                                          Eigen::Matrix<T, D, 1> initial_y,
+                                                          typename Eigen::Matrix<T, D, 1>::Scalar initial_t = 0) {
+        return RungeKutta<T, S, D, std::decay_t<F>>(
+            tableau, std::forward<F>(function), step_size, std::move(initial_y), initial_t);
     }
 } // namespace allpix
 
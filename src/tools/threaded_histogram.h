@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Utility to fill ROOT histograms from several threads at the same time
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_THREADED_HISTOGRAM_H
+#define ALLPIX_THREADED_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Histogram filled by several threads, with a separate copy for every thread merged at the end of the run
+     *
+     * The histogram passed at construction is kept as the merged histogram, which stays attached to the ROOT directory it
+     * has been created in. Every thread filling the histogram fills its own copy, created on first use from the merged
+     * histogram and detached from any directory. The copies are added to the merged histogram by \ref merge, which should be
+     * called after all events are processed and before the histogram is written or modified. Filling the copies does not
+     * require any locking, such that modules filling histograms can process several events or tasks concurrently. Since the
+     * copies are created by cloning the histogram, ROOT thread-safety has to be enabled if threads are used.
+     */
+    template <typename T> class ThreadedHistogram {
+    public:
+        /**
+         * @brief Construct the histogram, forwarding the arguments to the constructor of the ROOT histogram
+         * @param args Arguments of the histogram constructor
+         */
+        template <typename... Args>
+        explicit ThreadedHistogram(Args&&... args) : histogram_(new T(std::forward<Args>(args)...)), id_(next_id()) {}
+
+        /// @{
+        /**
+         * @brief Copying the histogram is not allowed
+         */
+        ThreadedHistogram(const ThreadedHistogram& rhs) = delete;
+        ThreadedHistogram& operator=(const ThreadedHistogram& rhs) = delete;
+        /// @}
+
+        /**
+         * @brief Get the copy of the histogram of the current thread, creating it if required
+         * @return Histogram to fill by the current thread
+         */
+        T* get() {
+            // Copies are found by the identifier of the histogram, which is never reused unlike its address
+            thread_local std::unordered_map<uint64_t, T*> local_copies;
+            auto iter = local_copies.find(id_);
+            if(iter != local_copies.end()) {
+                return iter->second;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto* copy = static_cast<T*>(histogram_->Clone());
+            copy->SetDirectory(nullptr);
+            copies_.emplace_back(copy);
+            local_copies.emplace(id_, copy);
+            return copy;
+        }
+
+        /**
+         * @brief Fill the copy of the histogram of the current thread
+         * @param args Arguments passed to the fill method of the histogram
+         */
+        template <typename... Args> void fill(Args&&... args) { get()->Fill(std::forward<Args>(args)...); }
+
+        /**
+         * @brief Get the merged histogram
+         * @return Merged histogram, only containing the entries of the copies added by the last call to \ref merge
+         */
+        T* getHistogram() const { return histogram_; }
+
+        /**
+         * @brief Add all copies to the merged histogram and reset them
+         * @return Merged histogram, which is owned by its ROOT directory
+         * @warning Should only be called while no thread is filling the histogram
+         */
+        T* merge() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(auto& copy : copies_) {
+                histogram_->Add(copy.get());
+                copy->Reset();
+            }
+            return histogram_;
+        }
+
+    private:
+        static uint64_t next_id() {
+            static std::atomic<uint64_t> id{0};
+            return id++;
+        }
+
+        T* histogram_;
+        uint64_t id_;
+
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<T>> copies_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_THREADED_HISTOGRAM_H */
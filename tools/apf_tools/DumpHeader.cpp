@@ -4,7 +4,9 @@
  */
 
 #include <fstream>
+#include <iomanip>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "core/utils/log.h"
@@ -13,22 +15,24 @@
 
 using namespace allpix;
 
-template <typename T> static void print_info(allpix::FieldData<T> field_data, size_t n, std::string units) {
-    std::cout << "Header:     \"" << field_data.getHeader() << "\"" << std::endl;
-    std::cout << "Field size: " << Units::display(field_data.getSize()[0], "um") << " x "
-              << Units::display(field_data.getSize()[1], "um") << " x " << Units::display(field_data.getSize()[2], "um")
+static void print_info(const FieldInfo& info) {
+    std::cout << "Format:     "
+              << (info.type == FileType::APFZ   ? "APFZ"
+                  : info.type == FileType::APF2 ? "APF2"
+                  : info.type == FileType::APF  ? "APF"
+                                                : "INIT")
               << std::endl;
-    std::cout << "Dimensions: " << field_data.getDimensions()[0] << " x " << field_data.getDimensions()[1] << " x "
-              << field_data.getDimensions()[2] << " cells" << std::endl;
-    std::cout << "Field vector with " << field_data.getData()->size() << " entries" << std::endl;
-
-    if(n > 0) {
-        std::cout << "First " << n << " entries of field data:" << std::endl;
-        for(size_t i = 0; i < field_data.getData()->size() && i < n; i++) {
-            std::cout << Units::display(field_data.getData()->at(i), units) << " ";
-        }
-        std::cout << std::endl;
+    std::cout << "Header:     \"" << info.header << "\"" << std::endl;
+    if(!info.units.empty()) {
+        std::cout << "Units:      " << info.units << std::endl;
     }
+    std::cout << "Field size: " << Units::display(info.size[0], "um") << " x " << Units::display(info.size[1], "um")
+              << " x " << Units::display(info.size[2], "um") << std::endl;
+    std::cout << "Dimensions: " << info.dimensions[0] << " x " << info.dimensions[1] << " x " << info.dimensions[2]
+              << " cells" << std::endl;
+    auto quantity = static_cast<size_t>(info.quantity);
+    std::cout << "Field vector with " << info.dimensions[0] * info.dimensions[1] * info.dimensions[2] * quantity
+              << " entries (" << quantity << " per cell)" << std::endl;
 }
 
 /**
@@ -56,6 +60,8 @@ int main(int argc, const char* argv[]) {
         std::vector<std::string> file_names;
         std::string units;
         size_t n = 0;
+        bool checksum = false;
+        bool validate = false;
         for(int i = 1; i < argc; i++) {
             if(strcmp(argv[i], "-h") == 0) {
                 print_help = true;
@@ -70,6 +76,10 @@ int main(int argc, const char* argv[]) {
                 n = static_cast<size_t>(std::atoi(argv[++i]));
             } else if(strcmp(argv[i], "--units") == 0 && (i + 1 < argc)) {
                 units = std::string(argv[++i]);
+            } else if(strcmp(argv[i], "--checksum") == 0) {
+                checksum = true;
+            } else if(strcmp(argv[i], "--validate") == 0) {
+                validate = true;
             } else {
                 file_names.emplace_back(std::string(argv[i]));
             }
@@ -84,6 +94,10 @@ int main(int argc, const char* argv[]) {
             std::cout << "Options:" << std::endl;
             std::cout << "  --values <N>     also print the first N values from the file" << std::endl;
             std::cout << "  --units  <units> units the field should be represented in" << std::endl;
+            std::cout << "  --checksum       print the checksum of the field data" << std::endl;
+            std::cout << "  --validate       check that all values of the field data are finite" << std::endl;
+            std::cout << std::endl;
+            std::cout << "Without options, only the header of the file is read." << std::endl;
             std::cout << std::endl;
             std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
             return return_code;
@@ -91,14 +105,40 @@ int main(int argc, const char* argv[]) {
 
         for(auto& file_input : file_names) {
             std::cout << "FILE:       " << file_input << std::endl;
-            try {
-                FieldParser<double> field_parser(FieldQuantity::VECTOR);
-                auto field_data = field_parser.getByFileName(file_input);
-                print_info(field_data, n, units);
-            } catch(std::runtime_error& e) {
-                FieldParser<double> field_parser(FieldQuantity::SCALAR);
-                auto field_data = field_parser.getByFileName(file_input);
-                print_info(field_data, n, units);
+            auto info = FieldParser<double>::getInfoByFileName(file_input);
+            print_info(info);
+            if(n == 0 && !checksum && !validate) {
+                continue;
+            }
+
+            // Read the field data once, the number of values per cell is known from the header
+            FieldParser<double> field_parser(info.quantity);
+            auto field_data = field_parser.getByFileName(file_input);
+            const auto* values = field_data.getValues().get();
+            auto values_size = field_data.getValuesSize();
+            if(n > 0) {
+                std::cout << "First " << n << " entries of field data:" << std::endl;
+                for(size_t i = 0; i < values_size && i < n; i++) {
+                    std::cout << Units::display(values[i], units) << " ";
+                }
+                std::cout << std::endl;
+            }
+
+            if(checksum || validate) {
+                auto summary = summarize_field(values, values_size, std::max(1u, std::thread::hardware_concurrency()));
+                if(checksum) {
+                    std::cout << "Checksum:   " << std::hex << std::setw(16) << std::setfill('0') << summary.checksum
+                              << std::dec << std::setfill(' ') << std::endl;
+                }
+                if(validate) {
+                    if(summary.non_finite > 0) {
+                        std::cout << "Validation: FAILED, " << summary.non_finite << " values are not finite" << std::endl;
+                        return_code = 2;
+                    } else {
+                        std::cout << "Validation: OK, values between " << Units::display(summary.minimum, units) << " and "
+                                  << Units::display(summary.maximum, units) << std::endl;
+                    }
+                }
             }
         }
 
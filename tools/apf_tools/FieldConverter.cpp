@@ -5,7 +5,9 @@
 
 #include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <string>
+#include <thread>
 
 #include "core/utils/log.h"
 #include "tools/field_parser.h"
@@ -39,7 +41,10 @@ int main(int argc, const char* argv[]) {
         std::string file_input;
         std::string file_output;
         std::string units;
+        std::string compression = "lz4";
         bool scalar = false;
+        bool checksum = false;
+        bool validate = false;
         for(int i = 1; i < argc; i++) {
             if(strcmp(argv[i], "-h") == 0) {
                 print_help = true;
@@ -53,15 +58,25 @@ int main(int argc, const char* argv[]) {
             } else if(strcmp(argv[i], "--to") == 0 && (i + 1 < argc)) {
                 std::string format = std::string(argv[++i]);
                 std::transform(format.begin(), format.end(), format.begin(), ::tolower);
-                format_to = (format == "init" ? FileType::INIT : format == "apf" ? FileType::APF : FileType::UNKNOWN);
+                format_to = (format == "init"   ? FileType::INIT
+                             : format == "apf"  ? FileType::APF
+                             : format == "apf2" ? FileType::APF2
+                             : format == "apfz" ? FileType::APFZ
+                                                : FileType::UNKNOWN);
             } else if(strcmp(argv[i], "--input") == 0 && (i + 1 < argc)) {
                 file_input = std::string(argv[++i]);
             } else if(strcmp(argv[i], "--output") == 0 && (i + 1 < argc)) {
                 file_output = std::string(argv[++i]);
             } else if(strcmp(argv[i], "--units") == 0 && (i + 1 < argc)) {
                 units = std::string(argv[++i]);
+            } else if(strcmp(argv[i], "--compression") == 0 && (i + 1 < argc)) {
+                compression = std::string(argv[++i]);
             } else if(strcmp(argv[i], "--scalar") == 0) {
                 scalar = true;
+            } else if(strcmp(argv[i], "--checksum") == 0) {
+                checksum = true;
+            } else if(strcmp(argv[i], "--validate") == 0) {
+                validate = true;
             } else {
                 LOG(ERROR) << "Unrecognized command line argument \"" << argv[i] << "\"";
                 print_help = true;
@@ -76,12 +91,16 @@ int main(int argc, const char* argv[]) {
             std::cout << "Usage: field_converter <parameters>" << std::endl;
             std::cout << std::endl;
             std::cout << "Parameters (all mandatory):" << std::endl;
-            std::cout << "  --to <format>    file format of the output file" << std::endl;
+            std::cout << "  --to <format>    file format of the output file (init, apf, apf2 or apfz)" << std::endl;
             std::cout << "  --input <file>   input field file" << std::endl;
             std::cout << "  --output <file>  output field file" << std::endl;
             std::cout << "  --units <units>  units the field is provided in" << std::endl << std::endl;
             std::cout << "Options:" << std::endl;
             std::cout << "  --scalar         Convert scalar field. Default is vector field" << std::endl;
+            std::cout << "  --compression <algorithm> Compression of apfz files (zlib, lzma, lz4 or zstd). Default is lz4"
+                      << std::endl;
+            std::cout << "  --checksum       Print the checksum of the converted field data in internal units" << std::endl;
+            std::cout << "  --validate       Check that all values are finite before writing the output file" << std::endl;
             std::cout << std::endl;
             std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
             return return_code;
@@ -92,7 +111,25 @@ int main(int argc, const char* argv[]) {
         FieldParser<double> field_parser(quantity);
         LOG(STATUS) << "Reading input file from " << file_input;
         auto field_data = field_parser.getByFileName(file_input, units);
+
+        // Summarize the field data read, such that the input does not need to be read a second time
+        if(checksum || validate) {
+            auto summary = summarize_field(field_data.getValues().get(),
+                                           field_data.getValuesSize(),
+                                           std::max(1u, std::thread::hardware_concurrency()));
+            if(checksum) {
+                LOG(STATUS) << "Checksum of field data: " << std::hex << std::setw(16) << std::setfill('0')
+                            << summary.checksum;
+            }
+            if(validate && summary.non_finite > 0) {
+                LOG(FATAL) << "Field data contains " << summary.non_finite << " values which are not finite, not writing "
+                           << file_output;
+                return 2;
+            }
+        }
+
         FieldWriter<double> field_writer(quantity);
+        field_writer.setCompression(compression);
         LOG(STATUS) << "Writing output file to " << file_output;
         field_writer.writeFile(field_data, file_output, format_to, (format_to == FileType::INIT ? units : ""));
     } catch(std::exception& e) {
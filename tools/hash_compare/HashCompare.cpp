@@ -0,0 +1,245 @@
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "core/utils/log.h"
+
+void interrupt_handler(int);
+
+/**
+ * @brief Handle termination request (CTRL+C)
+ */
+void interrupt_handler(int) {
+    LOG(STATUS) << "Interrupted! Aborting comparison...";
+    allpix::Log::finish();
+    std::exit(0);
+}
+
+/**
+ * @brief Hash of the objects of one type and detector in an event, as written by the HashWriter module
+ */
+struct HashEntry {
+    unsigned long event{};
+    std::string object;
+    std::string detector;
+    unsigned long objects{};
+    std::string hash;
+
+    std::tuple<unsigned long, const std::string&, const std::string&> key() const {
+        return std::tie(event, object, detector);
+    }
+};
+
+/**
+ * @brief Sequential reader of a hash file, checking that the entries are ordered
+ */
+class HashReader {
+public:
+    explicit HashReader(const std::string& file_name) : file_name_(file_name), file_(file_name) {
+        if(!file_.good()) {
+            throw std::runtime_error("could not open hash file " + file_name);
+        }
+    }
+
+    /**
+     * @brief Read the next entry of the file
+     * @param entry Entry to read into
+     * @return True if an entry has been read, false at the end of the file
+     */
+    bool next(HashEntry& entry) {
+        std::string line;
+        while(std::getline(file_, line)) {
+            ++line_number_;
+            if(line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream stream(line);
+            HashEntry read_entry;
+            if(!(stream >> read_entry.event >> read_entry.object >> read_entry.detector >> read_entry.objects >>
+                 read_entry.hash)) {
+                throw std::runtime_error("invalid line " + std::to_string(line_number_) + " in hash file " + file_name_);
+            }
+
+            // The entries are compared while reading, which requires them to be ordered as written by the module
+            if(has_entry_ && read_entry.key() <= last_entry_.key()) {
+                throw std::runtime_error("line " + std::to_string(line_number_) + " of hash file " + file_name_ +
+                                         " is not ordered by event, object and detector");
+            }
+            last_entry_ = read_entry;
+            has_entry_ = true;
+            entry = std::move(read_entry);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::string file_name_;
+    std::ifstream file_;
+    unsigned long line_number_{};
+    HashEntry last_entry_;
+    bool has_entry_{false};
+};
+
+/**
+ * @brief Compare the hashes of the output objects of two runs written by the HashWriter module
+ *
+ * Both files are read in parallel in the order of the events, such that files of runs with any number of events can be
+ * compared without holding them in memory. Returns zero if all hashes agree and one otherwise.
+ */
+int main(int argc, const char* argv[]) {
+    // If no arguments are provided, print the help:
+    bool print_help = false;
+    int return_code = 0;
+    if(argc == 1) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Add stream and set default logging level
+    allpix::Log::addStream(std::cout);
+
+    // Install abort handler (CTRL+\) and interrupt handler (CTRL+C)
+    std::signal(SIGQUIT, interrupt_handler);
+    std::signal(SIGINT, interrupt_handler);
+
+    std::vector<std::string> file_names;
+    unsigned long max_reports = 10;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
+            try {
+                auto log_level = allpix::Log::getLevelFromString(std::string(argv[++i]));
+                allpix::Log::setReportingLevel(log_level);
+            } catch(std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid verbosity level \"" << std::string(argv[i]) << "\", ignoring overwrite";
+                return_code = 1;
+            }
+        } else if(strcmp(argv[i], "-n") == 0 && (i + 1 < argc)) {
+            try {
+                max_reports = std::stoul(argv[++i]);
+            } catch(std::logic_error& e) {
+                LOG(ERROR) << "Invalid number of reported differences \"" << std::string(argv[i]) << "\"";
+                print_help = true;
+                return_code = 1;
+            }
+        } else if(argv[i][0] != '-') {
+            file_names.emplace_back(argv[i]);
+        } else {
+            LOG(ERROR) << "Unrecognized command line argument or missing value \"" << argv[i] << "\"";
+            print_help = true;
+            return_code = 1;
+        }
+    }
+
+    if(file_names.size() != 2) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Print help if requested or no arguments given
+    if(print_help) {
+        std::cerr << "Usage: compare_hashes <reference> <file>" << std::endl;
+        std::cout << "Compares the hashes of the output objects of two runs written by the HashWriter module" << std::endl;
+        std::cout << "Required parameters:" << std::endl;
+        std::cout << "\t <reference>  hash file of the reference run" << std::endl;
+        std::cout << "\t <file>       hash file of the run to compare" << std::endl;
+        std::cout << "Optional parameters:" << std::endl;
+        std::cout << "\t -n <number>  maximum number of differences reported (default is 10)" << std::endl;
+        std::cout << "\t -v <level>   verbosity level (default reporting level is INFO)" << std::endl;
+        std::cout << "\t -h           print this help text" << std::endl;
+
+        allpix::Log::finish();
+        return return_code;
+    }
+
+    unsigned long compared = 0;
+    unsigned long different = 0;
+    unsigned long missing = 0;
+    unsigned long events = 0;
+    unsigned long different_events = 0;
+    try {
+        HashReader reference(file_names[0]);
+        HashReader other(file_names[1]);
+        HashEntry reference_entry;
+        HashEntry other_entry;
+        bool has_reference = reference.next(reference_entry);
+        bool has_other = other.next(other_entry);
+
+        // Count the events seen in both files and the events with at least one difference
+        bool has_event = false;
+        unsigned long last_event = 0;
+        unsigned long last_different_event = 0;
+        auto report = [&](unsigned long event, const std::string& message) {
+            if(different + missing <= max_reports) {
+                LOG(WARNING) << "Event " << event << ": " << message;
+            }
+            if(different_events == 0 || last_different_event != event) {
+                ++different_events;
+                last_different_event = event;
+            }
+        };
+
+        while(has_reference || has_other) {
+            // Take the entry with the lower key, or both if the keys agree
+            bool take_reference = has_reference && (!has_other || reference_entry.key() <= other_entry.key());
+            bool take_other = has_other && (!has_reference || other_entry.key() <= reference_entry.key());
+            const auto& entry = (take_reference ? reference_entry : other_entry);
+            if(!has_event || entry.event != last_event) {
+                has_event = true;
+                last_event = entry.event;
+                ++events;
+            }
+
+            if(take_reference && take_other) {
+                ++compared;
+                if(reference_entry.objects != other_entry.objects || reference_entry.hash != other_entry.hash) {
+                    ++different;
+                    report(entry.event,
+                           entry.object + " of " + entry.detector + " differ, " + std::to_string(reference_entry.objects) +
+                               " objects with hash " + reference_entry.hash + " in reference and " +
+                               std::to_string(other_entry.objects) + " objects with hash " + other_entry.hash);
+                }
+            } else {
+                ++missing;
+                report(entry.event,
+                       entry.object + " of " + entry.detector + " only found in " +
+                           (take_reference ? file_names[0] : file_names[1]));
+            }
+
+            if(take_reference) {
+                has_reference = reference.next(reference_entry);
+            }
+            if(take_other) {
+                has_other = other.next(other_entry);
+            }
+        }
+    } catch(std::runtime_error& e) {
+        LOG(FATAL) << "Cannot compare hashes: " << e.what();
+        allpix::Log::finish();
+        return 1;
+    }
+
+    if(different + missing > max_reports) {
+        LOG(WARNING) << "Not reporting " << (different + missing - max_reports) << " further differences";
+    }
+    LOG(STATUS) << "Compared " << compared << " hashes of " << events << " events, " << different << " differ and "
+                << missing << " are only found in one of the files";
+    if(different_events > 0) {
+        LOG(ERROR) << "Output differs in " << different_events << " of " << events << " events";
+        return_code = 1;
+    } else {
+        LOG(STATUS) << "Output of all events is identical";
+    }
+
+    allpix::Log::finish();
+    return return_code;
+}
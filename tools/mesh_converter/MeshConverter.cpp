@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <cfloat>
 #include <chrono>
 #include <climits>
@@ -26,6 +27,7 @@
 
 #include "MeshElement.hpp"
 #include "MeshParser.hpp"
+#include "NeighborSearch.hpp"
 #include "ThreadPool.hpp"
 #include "combinations/combinations.h"
 #include "octree/Octree.hpp"
@@ -163,17 +165,25 @@ int main(int argc, char** argv) {
         // Output file format:
         auto format = config.get<std::string>("model", "apf");
         std::transform(format.begin(), format.end(), format.begin(), ::tolower);
-        FileType file_type = (format == "init" ? FileType::INIT : format == "apf" ? FileType::APF : FileType::UNKNOWN);
+        FileType file_type = (format == "init"   ? FileType::INIT
+                              : format == "apf"  ? FileType::APF
+                              : format == "apf2" ? FileType::APF2
+                              : format == "apfz" ? FileType::APFZ
+                                                 : FileType::UNKNOWN);
         if(file_type == FileType::UNKNOWN) {
-            throw allpix::InvalidValueError(config, "model", "only models 'apf' and 'init' are currently supported");
+            throw allpix::InvalidValueError(
+                config, "model", "only models 'apf', 'apf2', 'apfz' and 'init' are currently supported");
         }
 
         // Input file parser:
         auto parser = MeshParser::factory(config);
 
-        // Region, observable and binning of output field
+        // Region, observables and binning of output fields, all observables are interpolated in the same pass
         auto regions = config.getArray<std::string>("region", {"bulk"});
-        auto observable = config.get<std::string>("observable", "ElectricField");
+        auto observables = config.getArray<std::string>("observable", {"ElectricField"});
+        if(observables.empty()) {
+            throw allpix::InvalidValueError(config, "observable", "at least one observable is required");
+        }
 
         const auto radius_step = config.get<double>("radius_step", 0.5);
         const auto max_radius = config.get<double>("max_radius", 50);
@@ -190,6 +200,13 @@ int main(int argc, char** argv) {
             throw allpix::InvalidValueError(config, "dimension", "only two or three dimensional fields are supported");
         }
 
+        // Symmetry of the field within the mesh, quadrant grids only cover the upper half of the mesh in x and y
+        auto symmetry = config.get<std::string>("symmetry", "none");
+        std::transform(symmetry.begin(), symmetry.end(), symmetry.begin(), ::tolower);
+        if(symmetry != "none" && symmetry != "quadrant") {
+            throw allpix::InvalidValueError(config, "symmetry", "symmetry should be 'none' or 'quadrant'");
+        }
+
         // Swapping elements
         auto rot = config.getArray<std::string>("xyz", {"x", "y", "z"});
         if(rot.size() != 3) {
@@ -203,54 +220,57 @@ int main(int argc, char** argv) {
         std::vector<Point> points = parser->getMesh(grid_file, regions);
 
         std::string data_file = file_prefix + ".dat";
-        LOG(STATUS) << "Reading field from file \"" << data_file << "\"";
-        std::vector<Point> field = parser->getField(data_file, observable, regions);
-
-        if(points.size() != field.size()) {
-            throw std::runtime_error("Field and grid file do not match, found " + std::to_string(points.size()) + " and " +
-                                     std::to_string(field.size()) + " data points, respectively.");
+        std::vector<std::vector<Point>> fields;
+        for(auto& observable : observables) {
+            LOG(STATUS) << "Reading field " << observable << " from file \"" << data_file << "\"";
+            fields.push_back(parser->getField(data_file, observable, regions));
+
+            if(points.size() != fields.back().size()) {
+                throw std::runtime_error("Field " + observable + " and grid file do not match, found " +
+                                         std::to_string(points.size()) + " and " + std::to_string(fields.back().size()) +
+                                         " data points, respectively.");
+            }
         }
 
-        auto points_temp = points;
-        auto field_temp = field;
-        if(rot.at(0) == "-y" || rot.at(0) == "y") {
-            for(size_t i = 0; i < points.size(); ++i) {
-                points_temp[i].x = points[i].y;
-                field_temp[i].x = field[i].y;
+        // Swap the coordinates of the mesh points and the components of the fields
+        auto swap_axes = [&](std::vector<Point>& values) {
+            auto values_temp = values;
+            if(rot.at(0) == "-y" || rot.at(0) == "y") {
+                for(size_t i = 0; i < values.size(); ++i) {
+                    values_temp[i].x = values[i].y;
+                }
             }
-        }
-        if(rot.at(0) == "-z" || rot.at(0) == "z") {
-            for(size_t i = 0; i < points.size(); ++i) {
-                points_temp[i].x = points[i].z;
-                field_temp[i].x = field[i].z;
+            if(rot.at(0) == "-z" || rot.at(0) == "z") {
+                for(size_t i = 0; i < values.size(); ++i) {
+                    values_temp[i].x = values[i].z;
+                }
             }
-        }
-        if(rot.at(1) == "-x" || rot.at(1) == "x") {
-            for(size_t i = 0; i < points.size(); ++i) {
-                points_temp[i].y = points[i].x;
-                field_temp[i].y = field[i].x;
+            if(rot.at(1) == "-x" || rot.at(1) == "x") {
+                for(size_t i = 0; i < values.size(); ++i) {
+                    values_temp[i].y = values[i].x;
+                }
             }
-        }
-        if(rot.at(1) == "-z" || rot.at(1) == "z") {
-            for(size_t i = 0; i < points.size(); ++i) {
-                points_temp[i].y = points[i].z;
-                field_temp[i].y = field[i].z;
+            if(rot.at(1) == "-z" || rot.at(1) == "z") {
+                for(size_t i = 0; i < values.size(); ++i) {
+                    values_temp[i].y = values[i].z;
+                }
             }
-        }
-        if(rot.at(2) == "-x" || rot.at(2) == "x") {
-            for(size_t i = 0; i < points.size(); ++i) {
-                points_temp[i].z = points[i].x;
-                field_temp[i].z = field[i].x;
+            if(rot.at(2) == "-x" || rot.at(2) == "x") {
+                for(size_t i = 0; i < values.size(); ++i) {
+                    values_temp[i].z = values[i].x;
+                }
             }
-        }
-        if(rot.at(2) == "-y" || rot.at(2) == "y") {
-            for(size_t i = 0; i < points.size(); ++i) {
-                points_temp[i].z = points[i].y;
-                field_temp[i].z = field[i].y;
+            if(rot.at(2) == "-y" || rot.at(2) == "y") {
+                for(size_t i = 0; i < values.size(); ++i) {
+                    values_temp[i].z = values[i].y;
+                }
             }
+            values = values_temp;
+        };
+        swap_axes(points);
+        for(auto& field : fields) {
+            swap_axes(field);
         }
-        points = points_temp;
-        field = field_temp;
 
         // Find minimum and maximum from mesh coordinates
         double minx = DBL_MAX, miny = DBL_MAX, minz = DBL_MAX;
@@ -275,9 +295,13 @@ int main(int argc, char** argv) {
             }
         }
 
+        // Lower edge of the new mesh, starting at the center of the mesh for grids covering a quadrant only
+        const double grid_minx = (symmetry == "quadrant" && dimension == 3 ? (minx + maxx) / 2.0 : minx);
+        const double grid_miny = (symmetry == "quadrant" ? (miny + maxy) / 2.0 : miny);
+
         // Creating a new mesh points cloud with a regular pitch
-        const double xstep = (maxx - minx) / static_cast<double>(divisions.x());
-        const double ystep = (maxy - miny) / static_cast<double>(divisions.y());
+        const double xstep = (maxx - grid_minx) / static_cast<double>(divisions.x());
+        const double ystep = (maxy - grid_miny) / static_cast<double>(divisions.y());
         const double zstep = (maxz - minz) / static_cast<double>(divisions.z());
         const double cell_volume = xstep * ystep * zstep;
 
@@ -292,26 +316,42 @@ int main(int argc, char** argv) {
         LOG(STATUS) << "Mesh dimensions: " << maxx - minx << " x " << maxy - miny << " x " << maxz - minz << std::endl
                     << "New mesh element dimension: " << xstep << " x " << ystep << " x " << zstep
                     << " ==>  Volume = " << cell_volume;
+        if(symmetry == "quadrant") {
+            LOG(STATUS) << "New mesh only covers the quadrant of the mesh starting at its center (" << grid_minx << ", "
+                        << grid_miny << ")";
+        }
 
         if(rot.at(0).find('-') != std::string::npos) {
             LOG(WARNING) << "Inverting coordinate X. This might change the right-handness of the coordinate system!";
             for(size_t i = 0; i < points.size(); ++i) {
                 points[i].x = maxx - (points[i].x - minx);
-                field[i].x = -field[i].x;
+            }
+            for(auto& field : fields) {
+                for(auto& value : field) {
+                    value.x = -value.x;
+                }
             }
         }
         if(rot.at(1).find('-') != std::string::npos) {
             LOG(WARNING) << "Inverting coordinate Y. This might change the right-handness of the coordinate system!";
             for(size_t i = 0; i < points.size(); ++i) {
                 points[i].y = maxy - (points[i].y - miny);
-                field[i].y = -field[i].y;
+            }
+            for(auto& field : fields) {
+                for(auto& value : field) {
+                    value.y = -value.y;
+                }
             }
         }
         if(rot.at(2).find('-') != std::string::npos) {
             LOG(WARNING) << "Inverting coordinate Z. This might change the right-handness of the coordinate system!";
             for(size_t i = 0; i < points.size(); ++i) {
                 points[i].z = maxz - (points[i].z - minz);
-                field[i].z = -field[i].z;
+            }
+            for(auto& field : fields) {
+                for(auto& value : field) {
+                    value.z = -value.z;
+                }
             }
         }
 
@@ -327,83 +367,128 @@ int main(int argc, char** argv) {
         unibn::Octree<Point> octree;
         octree.initialize(points);
 
-        auto mesh_section = [&](double x, double y) {
-            allpix::Log::setReportingLevel(log_level);
+        // Margin of the neighbor search radius to reuse the points found for the following grid points
+        const auto search_margin = config.get<double>("search_margin", 2 * std::max({xstep, ystep, zstep}));
+        const auto block_size = config.get<int>("block_size", 4);
+        if(block_size < 1) {
+            throw allpix::InvalidValueError(config, "block_size", "block size needs to be positive");
+        }
 
-            // New mesh slice
-            std::vector<Point> new_mesh;
-
-            double z = minz + zstep / 2.0;
-            for(int k = 0; k < divisions.z(); ++k) {
-                // New mesh vertex and field
-                Point q(dimension == 2 ? -1 : x, y, z), e;
-                bool valid = false;
-
-                size_t prev_neighbours = 0;
-                double radius = initial_radius;
-
-                while(radius < max_radius) {
-                    LOG(DEBUG) << "Search radius: " << radius;
-                    // Calling octree neighbours search and sorting the results list with the closest neighbours first
-                    std::vector<unsigned int> results;
-                    octree.radiusNeighbors<unibn::L2Distance<Point>>(q, radius, results);
-                    LOG(DEBUG) << "Number of vertices found: " << results.size();
-
-                    // If after a radius step no new neighbours are found, go to the next radius step
-                    if(results.size() <= prev_neighbours || results.empty()) {
-                        prev_neighbours = results.size();
-                        LOG(DEBUG) << "No (new) neighbour found with radius " << radius << ". Increasing search radius.";
-                        radius = radius + radius_step;
-                        continue;
-                    }
+        // Interpolate all fields at a single grid point, sharing the neighbour search and the element found
+        auto interpolate = [&](NeighborSearch& search, const Point& q) {
+            search.setQuery(q);
+
+            size_t prev_neighbours = 0;
+            size_t tested_neighbours = 0;
+            double radius = initial_radius;
+
+            // Combinations of neighbours, given by their rank in the list of neighbours sorted by distance
+            const size_t element_size = (dimension == 3 ? 4 : 3);
+            std::vector<uint32_t> ranks;
+            std::array<uint32_t, 4> element_indices{};
+
+            while(radius < max_radius) {
+                LOG(DEBUG) << "Search radius: " << radius;
+                // Number of neighbours within the radius, the closest neighbours are first in the list of the search
+                auto neighbours = search.count(radius);
+                LOG(DEBUG) << "Number of vertices found: " << neighbours;
+
+                // If after a radius step no new neighbours are found, go to the next radius step
+                if(neighbours <= prev_neighbours || neighbours == 0) {
+                    prev_neighbours = neighbours;
+                    LOG(DEBUG) << "No (new) neighbour found with radius " << radius << ". Increasing search radius.";
+                    radius = radius + radius_step;
+                    continue;
+                }
 
-                    // If we have less than N close neighbors, no full mesh element can be formed. Increase radius.
-                    if(results.size() < (dimension == 3 ? 4 : 3)) {
-                        LOG(DEBUG) << "Incomplete mesh element found for radius " << radius << ", increasing radius";
-                        radius = radius + radius_step;
-                        continue;
-                    }
+                // If we have less than N close neighbors, no full mesh element can be formed. Increase radius.
+                if(neighbours < element_size) {
+                    LOG(DEBUG) << "Incomplete mesh element found for radius " << radius << ", increasing radius";
+                    radius = radius + radius_step;
+                    continue;
+                }
 
-                    // Sort by lowest distance first, this drastically reduces the number of permutations required to find a
-                    // valid mesh element and also ensures that this is the one with the smallest volume.
-                    std::sort(results.begin(), results.end(), [&](unsigned int a, unsigned int b) {
-                        return unibn::L2Distance<Point>::compute(points[a], q) <
-                               unibn::L2Distance<Point>::compute(points[b], q);
+                // Finding tetrahedrons by checking all combinations of N elements, starting with closest to reference
+                // point. The neighbours sorted by lowest distance first drastically reduce the number of permutations
+                // required to find a valid mesh element and also ensure that this is the one with the smallest volume.
+                // Combinations of neighbours tried with a smaller radius already are skipped.
+                ranks.resize(neighbours);
+                for(uint32_t i = 0; i < neighbours; ++i) {
+                    ranks[i] = i;
+                }
+                const auto& sorted = search.getNeighbors();
+                Combination combination(&points, &fields, q, volume_cut);
+                for_each_combination(
+                    ranks.begin(),
+                    ranks.begin() + static_cast<std::ptrdiff_t>(element_size),
+                    ranks.end(),
+                    [&](std::vector<uint32_t>::iterator first, std::vector<uint32_t>::iterator last) {
+                        if(*std::max_element(first, last) < tested_neighbours) {
+                            return false;
+                        }
+                        auto element_end = std::transform(
+                            first, last, element_indices.begin(), [&](uint32_t rank) { return sorted[rank]; });
+                        return combination(element_indices.begin(), element_end);
                     });
+                if(combination.valid()) {
+                    return combination.result();
+                }
+                tested_neighbours = neighbours;
 
-                    // Finding tetrahedrons by checking all combinations of N elements, starting with closest to reference
-                    // point
-                    auto res = for_each_combination(results.begin(),
-                                                    results.begin() + (dimension == 3 ? 4 : 3),
-                                                    results.end(),
-                                                    Combination(&points, &field, q, volume_cut));
-                    valid = res.valid();
-                    if(valid) {
-                        e = res.result();
-                        break;
-                    }
+                radius = radius + radius_step;
+                LOG(DEBUG) << "All combinations tried. Increasing search radius to " << radius;
+            }
 
-                    radius = radius + radius_step;
-                    LOG(DEBUG) << "All combinations tried. Increasing search radius to " << radius;
-                }
+            throw std::runtime_error("Could not find valid volume element. Consider to increase max_radius to include "
+                                     "more mesh points in the search");
+        };
 
-                if(!valid) {
-                    throw std::runtime_error(
-                        "Could not find valid volume element. Consider to increase max_radius to include "
-                        "more mesh points in the search");
-                }
+        // Regular grid to interpolate, given by the lower edge of the grid, the size of its cells and its divisions
+        struct RegularGrid {
+            std::array<double, 3> origin;
+            std::array<double, 3> step;
+            XYZVectorInt divisions;
+        };
 
-                new_mesh.push_back(e);
-                z += zstep;
+        // Interpolate a block of grid columns along z, alternating the direction of consecutive columns such that every
+        // grid point is close to the previous one and the neighbours found can be reused
+        auto mesh_block = [&](const RegularGrid& grid, int block_x, int block_y) {
+            allpix::Log::setReportingLevel(log_level);
+
+            NeighborSearch search(octree, points, search_margin);
+            auto end_x = std::min(block_x + block_size, grid.divisions.x());
+            auto end_y = std::min(block_y + block_size, grid.divisions.y());
+
+            // New mesh block for every observable, ordered by the columns of the block and by z
+            std::vector<std::vector<Point>> new_mesh(
+                fields.size(),
+                std::vector<Point>(static_cast<size_t>((end_x - block_x) * (end_y - block_y) * grid.divisions.z())));
+            bool upwards = true;
+            for(int i = block_x; i < end_x; ++i) {
+                double x = grid.origin[0] + grid.step[0] / 2.0 + i * grid.step[0];
+                for(int j = block_y; j < end_y; ++j) {
+                    double y = grid.origin[1] + grid.step[1] / 2.0 + j * grid.step[1];
+                    auto column = static_cast<size_t>((i - block_x) * (end_y - block_y) + (j - block_y));
+                    for(int n = 0; n < grid.divisions.z(); ++n) {
+                        auto k = (upwards ? n : grid.divisions.z() - 1 - n);
+                        double z = grid.origin[2] + grid.step[2] / 2.0 + k * grid.step[2];
+
+                        // New mesh vertex and fields
+                        Point q(dimension == 2 ? -1 : x, y, z);
+                        const auto& values = interpolate(search, q);
+                        for(size_t m = 0; m < values.size(); ++m) {
+                            new_mesh[m][column * static_cast<size_t>(grid.divisions.z()) + static_cast<size_t>(k)] =
+                                values[m];
+                        }
+                    }
+                    upwards = !upwards;
+                }
             }
 
             return new_mesh;
         };
 
-        // Start the interpolation on many threads:
         auto num_threads = config.get<unsigned int>("workers", std::max(std::thread::hardware_concurrency(), 1u));
-        LOG(STATUS) << "Starting regular grid interpolation with " << num_threads << " threads.";
-        std::vector<Point> e_field_new_mesh;
 
         // clang-format off
         auto init_function = [log_level = allpix::Log::getReportingLevel(), log_format = allpix::Log::getFormat()]() {
@@ -413,74 +498,180 @@ int main(int argc, char** argv) {
             allpix::Log::setFormat(log_format);
         };
 
-        ThreadPool pool(num_threads, init_function);
-        std::vector<std::future<std::vector<Point>>> mesh_futures;
-        // Set starting point
-        double x = minx + xstep / 2.0;
-        // Loop over x coordinate, add tasks for each coordinate to the queue
-        for(int i = 0; i < divisions.x(); ++i) {
-            double y = miny + ystep / 2.0;
-            for(int j = 0; j < divisions.y(); ++j) {
-                mesh_futures.push_back(pool.submit(mesh_section, x, y));
-                y += ystep;
+        // Interpolate a regular grid of all fields on many threads
+        auto interpolate_grid = [&](const RegularGrid& grid) {
+            const auto& grid_divisions = grid.divisions;
+            LOG(STATUS) << "Starting regular grid interpolation of " << fields.size() << " observables with " << num_threads
+                        << " threads.";
+            std::vector<std::vector<Point>> e_field_new_mesh(
+                fields.size(),
+                std::vector<Point>(static_cast<size_t>(grid_divisions.x() * grid_divisions.y() * grid_divisions.z())));
+
+            ThreadPool pool(num_threads, init_function);
+            std::vector<std::pair<XYVectorInt, std::future<std::vector<std::vector<Point>>>>> mesh_futures;
+            // Loop over blocks of grid columns, add tasks for each block to the queue
+            for(int i = 0; i < grid_divisions.x(); i += block_size) {
+                for(int j = 0; j < grid_divisions.y(); j += block_size) {
+                    mesh_futures.emplace_back(XYVectorInt(i, j), pool.submit(mesh_block, grid, i, j));
+                }
             }
-            x += xstep;
-        }
 
-        // Merge the result vectors:
-        unsigned int mesh_slices_done = 0;
-        for(auto& mesh_future : mesh_futures) {
-            auto mesh_slice = mesh_future.get();
-            e_field_new_mesh.insert(e_field_new_mesh.end(), mesh_slice.begin(), mesh_slice.end());
-            LOG_PROGRESS(INFO, "m") << "Interpolating new mesh: " << mesh_slices_done << " of " << mesh_futures.size()
-                                    << ", " << (100 * mesh_slices_done / mesh_futures.size()) << "%";
-            mesh_slices_done++;
+            // Merge the result vectors:
+            unsigned int mesh_blocks_done = 0;
+            for(auto& mesh_future : mesh_futures) {
+                auto mesh_block_result = mesh_future.second.get();
+                auto block_x = mesh_future.first.x();
+                auto block_y = mesh_future.first.y();
+                auto size_y = std::min(block_size, grid_divisions.y() - block_y);
+                for(size_t n = 0; n < mesh_block_result.size(); ++n) {
+                    const auto& block_result = mesh_block_result[n];
+                    for(size_t column = 0; column < block_result.size() / static_cast<size_t>(grid_divisions.z());
+                        ++column) {
+                        auto i = block_x + static_cast<int>(column) / size_y;
+                        auto j = block_y + static_cast<int>(column) % size_y;
+                        auto source = block_result.begin() + static_cast<std::ptrdiff_t>(column) * grid_divisions.z();
+                        std::copy(source,
+                                  source + grid_divisions.z(),
+                                  e_field_new_mesh[n].begin() + (i * grid_divisions.y() + j) * grid_divisions.z());
+                    }
+                }
+                LOG_PROGRESS(INFO, "m") << "Interpolating new mesh: " << mesh_blocks_done << " of " << mesh_futures.size()
+                                        << " blocks, " << (100 * mesh_blocks_done / mesh_futures.size()) << "%";
+                mesh_blocks_done++;
+            }
+            pool.destroy();
+
+            return e_field_new_mesh;
+        };
+
+        // FIXME this should be done in a more elegant way
+        auto field_quantity = [](const std::string& observable) {
+            return (observable == "ElectricField" ? FieldQuantity::VECTOR : FieldQuantity::SCALAR);
+        };
+
+        // Prepare the writers of all observables
+        std::vector<allpix::FieldWriter<double>> field_writers;
+        for(auto& observable : observables) {
+            field_writers.emplace_back(field_quantity(observable));
+            if(file_type == FileType::APFZ) {
+                try {
+                    field_writers.back().setCompression(config.get<std::string>("compression", "lz4"),
+                                                        config.get<unsigned int>("compression_level", 4));
+                } catch(std::invalid_argument& e) {
+                    throw allpix::InvalidValueError(config, "compression", e.what());
+                }
+            }
         }
-        pool.destroy();
+
+        // Write an interpolated regular grid of one observable to file
+        auto write_grid = [&](size_t observable_index,
+                              const std::vector<Point>& e_field_new_mesh,
+                              const RegularGrid& grid,
+                              const std::string& file_name) {
+            // Prepare header and auxiliary information:
+            const auto& observable = observables[observable_index];
+            std::string header =
+                "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " TCAD Mesh Converter, observable: " + observable;
+            FieldQuantity quantity = field_quantity(observable);
+            std::string units = (observable == "ElectricField" ? "V/cm" : "");
+
+            const auto& grid_divisions = grid.divisions;
+            std::array<double, 3> size{{allpix::Units::get(grid.step[0] * grid_divisions.x(), "um"),
+                                        allpix::Units::get(grid.step[1] * grid_divisions.y(), "um"),
+                                        allpix::Units::get(grid.step[2] * grid_divisions.z(), "um")}};
+            std::array<size_t, 3> gridsize{{static_cast<size_t>(grid_divisions.x()),
+                                            static_cast<size_t>(grid_divisions.y()),
+                                            static_cast<size_t>(grid_divisions.z())}};
+
+            // Prepare data:
+            LOG(INFO) << "Preparing data for storage...";
+            auto data = std::make_shared<std::vector<double>>();
+            for(int i = 0; i < grid_divisions.x(); ++i) {
+                for(int j = 0; j < grid_divisions.y(); ++j) {
+                    for(int k = 0; k < grid_divisions.z(); ++k) {
+                        auto& point = e_field_new_mesh[static_cast<unsigned int>(
+                            i * grid_divisions.y() * grid_divisions.z() + j * grid_divisions.z() + k)];
+                        // We need to convert to framework-internal units:
+                        data->push_back(allpix::Units::get(point.x, units));
+                        // For a vector field, we push three values:
+                        if(quantity == FieldQuantity::VECTOR) {
+                            data->push_back(allpix::Units::get(point.y, units));
+                            data->push_back(allpix::Units::get(point.z, units));
+                        }
+                    }
+                }
+            }
+
+            allpix::FieldData<double> field_data(header, gridsize, size, data);
+            field_writers[observable_index].writeFile(
+                field_data, file_name, file_type, (file_type == FileType::INIT ? units : ""));
+            LOG(STATUS) << "New mesh written to file \"" << file_name << "\"";
+        };
+
+        // Interpolate and write the regular grid covering the full mesh
+        RegularGrid grid{{{grid_minx, grid_miny, minz}}, {{xstep, ystep, zstep}}, divisions};
+        auto e_field_new_mesh = interpolate_grid(grid);
 
         end = std::chrono::system_clock::now();
         elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
         LOG(INFO) << "New mesh created in " << elapsed_seconds << " seconds.";
 
-        // Prepare header and auxiliary information:
-        std::string header =
-            "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " TCAD Mesh Converter, observable: " + observable;
-        std::array<double, 3> size{{allpix::Units::get(maxx - minx, "um"),
-                                    allpix::Units::get(maxy - miny, "um"),
-                                    allpix::Units::get(maxz - minz, "um")}};
-        std::array<size_t, 3> gridsize{
-            {static_cast<size_t>(divisions.x()), static_cast<size_t>(divisions.y()), static_cast<size_t>(divisions.z())}};
+        std::string extension = (file_type == FileType::INIT ? ".init" : ".apf");
+        for(size_t n = 0; n < observables.size(); ++n) {
+            write_grid(n, e_field_new_mesh[n], grid, init_file_prefix + "_" + observables[n] + extension);
+        }
 
-        // FIXME this should be done in a more elegant way
-        FieldQuantity quantity = (observable == "ElectricField" ? FieldQuantity::VECTOR : FieldQuantity::SCALAR);
-        std::string units = (observable == "ElectricField" ? "V/cm" : "");
-
-        // Prepare data:
-        LOG(INFO) << "Preparing data for storage...";
-        auto data = std::make_shared<std::vector<double>>();
-        for(int i = 0; i < divisions.x(); ++i) {
-            for(int j = 0; j < divisions.y(); ++j) {
-                for(int k = 0; k < divisions.z(); ++k) {
-                    auto& point = e_field_new_mesh[static_cast<unsigned int>(i * divisions.y() * divisions.z() +
-                                                                             j * divisions.z() + k)];
-                    // We need to convert to framework-internal units:
-                    data->push_back(allpix::Units::get(point.x, units));
-                    // For a vector field, we push three values:
-                    if(quantity == FieldQuantity::VECTOR) {
-                        data->push_back(allpix::Units::get(point.y, units));
-                        data->push_back(allpix::Units::get(point.z, units));
+        // Interpolate and write the refined blocks, covering boxes of cells of the regular grid with finer grids
+        if(config.has("refinement_begin")) {
+            auto refinement_begin = config.getMatrix<int>("refinement_begin");
+            auto refinement_cells = config.getMatrix<int>("refinement_cells");
+            if(refinement_cells.size() != refinement_begin.size()) {
+                throw allpix::InvalidValueError(
+                    config, "refinement_cells", "number of refined blocks does not match the number of first cells");
+            }
+            auto refinement_factor = config.get<int>("refinement_factor", 4);
+            if(refinement_factor < 1) {
+                throw allpix::InvalidValueError(config, "refinement_factor", "refinement factor needs to be positive");
+            }
+
+            for(size_t n = 0; n < refinement_begin.size(); ++n) {
+                const auto& block_begin = refinement_begin[n];
+                const auto& block_cells = refinement_cells[n];
+                if(block_begin.size() != 3 || block_cells.size() != 3) {
+                    throw allpix::InvalidValueError(
+                        config, "refinement_begin", "refined blocks require three indices and cells in x, y and z");
+                }
+
+                // Two-dimensional meshes are not refined along x, which only has a single cell
+                std::array<int, 3> factors{{dimension == 2 ? 1 : refinement_factor, refinement_factor, refinement_factor}};
+                std::array<int, 3> grid_divisions{{divisions.x(), divisions.y(), divisions.z()}};
+                RegularGrid block{};
+                std::array<int, 3> block_divisions{};
+                for(size_t i = 0; i < 3; ++i) {
+                    if(block_begin[i] < 0 || block_cells[i] < 1 || block_begin[i] + block_cells[i] > grid_divisions[i]) {
+                        throw allpix::InvalidValueError(
+                            config, "refinement_cells", "refined block " + std::to_string(n) + " is outside the grid");
                     }
+                    block.origin[i] = grid.origin[i] + block_begin[i] * grid.step[i];
+                    block.step[i] = grid.step[i] / factors[i];
+                    block_divisions[i] = block_cells[i] * factors[i];
+                }
+                block.divisions = XYZVectorInt(block_divisions[0], block_divisions[1], block_divisions[2]);
+
+                LOG(STATUS) << "Refining " << block_cells[0] << " x " << block_cells[1] << " x " << block_cells[2]
+                            << " cells starting at cell (" << block_begin[0] << ", " << block_begin[1] << ", "
+                            << block_begin[2] << ") with " << block_divisions[0] << " x " << block_divisions[1]
+                            << " x " << block_divisions[2] << " divisions";
+                auto block_new_mesh = interpolate_grid(block);
+                for(size_t m = 0; m < observables.size(); ++m) {
+                    write_grid(m,
+                               block_new_mesh[m],
+                               block,
+                               init_file_prefix + "_" + observables[m] + "_refinement" + std::to_string(n) + extension);
                 }
             }
         }
 
-        allpix::FieldData<double> field_data(header, gridsize, size, data);
-        std::string init_file_name = init_file_prefix + "_" + observable + (file_type == FileType::INIT ? ".init" : ".apf");
-
-        allpix::FieldWriter<double> field_writer(quantity);
-        field_writer.writeFile(field_data, init_file_name, file_type, (file_type == FileType::INIT ? units : ""));
-        LOG(STATUS) << "New mesh written to file \"" << init_file_name << "\"";
-
         end = std::chrono::system_clock::now();
         elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
         LOG(STATUS) << "Interpolation and conversion completed in " << elapsed_seconds << " seconds.";
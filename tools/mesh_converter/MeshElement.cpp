@@ -76,14 +76,23 @@ bool MeshElement::validElement(double volume_cut, Point& qp) const {
     return true;
 }
 
-Point MeshElement::getObservable(Point& qp) const {
-    Point new_observable;
+std::array<double, 4> MeshElement::getWeights(Point& qp) const {
+    std::array<double, 4> weights{};
     for(size_t index = 0; index < dimension_ + 1; index++) {
         double sub_volume = get_sub_volume(index, qp);
         LOG(DEBUG) << "Sub volume " << index << ": " << sub_volume;
-        new_observable.x = new_observable.x + (sub_volume * e_field_[index].x) / volume_;
-        new_observable.y = new_observable.y + (sub_volume * e_field_[index].y) / volume_;
-        new_observable.z = new_observable.z + (sub_volume * e_field_[index].z) / volume_;
+        weights[index] = sub_volume / volume_;
+    }
+    return weights;
+}
+
+Point MeshElement::getObservable(Point& qp) const {
+    Point new_observable;
+    auto weights = getWeights(qp);
+    for(size_t index = 0; index < dimension_ + 1; index++) {
+        new_observable.x = new_observable.x + weights[index] * e_field_[index].x;
+        new_observable.y = new_observable.y + weights[index] * e_field_[index].y;
+        new_observable.z = new_observable.z + weights[index] * e_field_[index].z;
     }
     LOG(DEBUG) << "Interpolated electric field: (" << new_observable.x << "," << new_observable.y << "," << new_observable.z
                << ")";
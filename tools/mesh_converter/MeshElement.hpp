@@ -4,6 +4,7 @@
 #include <Eigen/Eigen>
 #include <array>
 #include <utility>
+#include <vector>
 
 #include "core/utils/log.h"
 #include "octree/Octree.hpp"
@@ -62,6 +63,13 @@ namespace mesh_converter {
          */
         Point getObservable(Point& qp) const;
 
+        /**
+         * @brief Get the barycentric weights of the vertices, which interpolate any observable given at the vertices
+         * @param qp Point where the interpolation is being done
+         * @return Weights of the vertices, unused vertices of elements with lower dimension have zero weight
+         */
+        std::array<double, 4> getWeights(Point& qp) const;
+
         /**
          * @brief Print tetrahedron information for debugging
          * @return String describing the mesh element
@@ -92,13 +100,13 @@ namespace mesh_converter {
      *
      * It receives pointers to the point and field vectors and its operator() member is called for every combination of
      * results found. It constructs a new MeshElement, checks for its validity and returns true to stop the iteration and
-     * false to continue to the next combination of results.
+     * false to continue to the next combination of results. The weights of the valid element interpolate all fields.
      */
     class Combination {
         const std::vector<Point>* grid_;
-        const std::vector<Point>* field_;
+        const std::vector<std::vector<Point>>* fields_;
         Point reference_;
-        Point result_;
+        std::vector<Point> result_;
         bool valid_{};
         double cut_;
 
@@ -109,15 +117,15 @@ namespace mesh_converter {
         /**
          * @brief constructor for functor
          * @param  points     Pointer to mesh point vector
-         * @param  field      Pointer to field vector
+         * @param  fields     Pointer to the field vectors of all observables, given at the mesh points
          * @param  q          Reference point to interpolate at
          * @param  volume_cut Volume cut to be used
          */
         explicit Combination(const std::vector<Point>* points,
-                             const std::vector<Point>* field,
+                             const std::vector<std::vector<Point>>* fields,
                              const Point& q,
                              const double volume_cut)
-            : grid_(points), field_(field), reference_(q), cut_(volume_cut) {}
+            : grid_(points), fields_(fields), reference_(q), result_(fields->size()), cut_(volume_cut) {}
 
         /**
          * @brief Operator called for each permutation
@@ -129,10 +137,13 @@ namespace mesh_converter {
         template <class It> bool operator()(It begin, It end) {
             // Dimensionality is number of iterator elements minus one:
             size_t dimensions = static_cast<size_t>(end - begin) - 1;
+            const auto& first_field = fields_->front();
+            std::array<size_t, 4> indices{};
             size_t idx = 0;
-            for(; begin < end; begin++) {
-                grid_elements[idx] = (*grid_)[*begin];
-                field_elements[idx++] = (*field_)[*begin];
+            for(auto it = begin; it < end; it++) {
+                indices[idx] = *it;
+                grid_elements[idx] = (*grid_)[*it];
+                field_elements[idx++] = first_field[*it];
             }
 
             LOG(TRACE) << "Constructing element with dim " << dimensions << " at " << reference_;
@@ -140,7 +151,19 @@ namespace mesh_converter {
             valid_ = element.validElement(cut_, reference_);
             if(valid_) {
                 LOG(DEBUG) << element.print(reference_);
-                result_ = element.getObservable(reference_);
+
+                // Interpolate all observables with the same weights of the vertices
+                auto weights = element.getWeights(reference_);
+                for(size_t n = 0; n < fields_->size(); ++n) {
+                    const auto& field = (*fields_)[n];
+                    Point value;
+                    for(size_t i = 0; i < idx; ++i) {
+                        value.x += weights[i] * field[indices[i]].x;
+                        value.y += weights[i] * field[indices[i]].y;
+                        value.z += weights[i] * field[indices[i]].z;
+                    }
+                    result_[n] = value;
+                }
             }
 
             return valid_; // Don't break out of the loop if element is invalid
@@ -155,9 +178,9 @@ namespace mesh_converter {
 
         /**
          * @brief Member to retrieve interpolated result from valid mesh element
-         * @return Interpolated result from valid mesh element
+         * @return Interpolated results of all fields from valid mesh element
          */
-        Point result() const { return result_; }
+        const std::vector<Point>& result() const { return result_; }
     };
 
 } // namespace mesh_converter
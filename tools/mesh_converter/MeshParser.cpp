@@ -1,15 +1,46 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <sstream>
+
+#include <sys/stat.h>
 
 #include "MeshParser.hpp"
 
 using namespace mesh_converter;
 
+namespace {
+    // Identification and layout version of parser cache files
+    constexpr char cache_magic[8] = "APMESH1";
+
+    struct CacheHeader {
+        char magic[8];
+        std::uint64_t source_size;
+        std::int64_t source_mtime;
+        std::uint64_t points;
+    };
+
+    // Size and modification time of an input file, used to detect changes of the file
+    bool get_file_stat(const std::string& file, std::uint64_t& size, std::int64_t& mtime) {
+        struct stat file_stat {};
+        if(stat(file.c_str(), &file_stat) != 0) {
+            return false;
+        }
+        size = static_cast<std::uint64_t>(file_stat.st_size);
+        mtime = static_cast<std::int64_t>(file_stat.st_mtime);
+        return true;
+    }
+} // namespace
+
 std::shared_ptr<MeshParser> MeshParser::factory(const allpix::Configuration& config) {
     auto parser = config.get<std::string>("parser", "df-ise");
     std::transform(parser.begin(), parser.end(), parser.begin(), ::tolower);
 
     if(parser == "df-ise" || parser == "dfise") {
-        return std::make_shared<DFISEParser>();
+        auto dfise_parser = std::make_shared<DFISEParser>();
+        dfise_parser->setCache(config.get<bool>("parser_cache", false));
+        return dfise_parser;
     } else {
         throw allpix::InvalidValueError(config, "parser", "Unknown parser type");
     }
@@ -18,8 +49,21 @@ std::shared_ptr<MeshParser> MeshParser::factory(const allpix::Configuration& con
 std::vector<Point> MeshParser::getMesh(const std::string& file, const std::vector<std::string>& regions) {
     std::vector<Point> points;
 
-    auto region_grid = read_meshes(file);
-    LOG(INFO) << "Grid sizes for all regions:";
+    std::string cache_file;
+    if(cache_) {
+        std::string key = "mesh";
+        for(const auto& region : regions) {
+            key += " " + region;
+        }
+        cache_file = cache_file_name(file, key);
+        if(read_cache(file, cache_file, points)) {
+            LOG(INFO) << "Read grid with " << points.size() << " points from cache file \"" << cache_file << "\"";
+            return points;
+        }
+    }
+
+    auto region_grid = read_meshes(file, regions);
+    LOG(INFO) << "Grid sizes for requested regions:";
     for(auto& reg : region_grid) {
         LOG(INFO) << "\t" << std::left << std::setw(25) << reg.first << " " << reg.second.size();
     }
@@ -38,6 +82,9 @@ std::vector<Point> MeshParser::getMesh(const std::string& file, const std::vecto
     }
     LOG(DEBUG) << "Grid with " << points.size() << " points";
 
+    if(cache_) {
+        write_cache(file, cache_file, points);
+    }
     return points;
 }
 
@@ -45,8 +92,22 @@ std::vector<Point>
 MeshParser::getField(const std::string& file, const std::string& observable, const std::vector<std::string>& regions) {
 
     std::vector<Point> field;
-    auto region_fields = read_fields(file);
-    LOG(INFO) << "Field sizes for all regions and observables:";
+
+    std::string cache_file;
+    if(cache_) {
+        std::string key = "field " + observable;
+        for(const auto& region : regions) {
+            key += " " + region;
+        }
+        cache_file = cache_file_name(file, key);
+        if(read_cache(file, cache_file, field)) {
+            LOG(INFO) << "Read field with " << field.size() << " points from cache file \"" << cache_file << "\"";
+            return field;
+        }
+    }
+
+    auto region_fields = read_fields(file, observable, regions);
+    LOG(INFO) << "Field sizes for requested regions and observables:";
     for(auto& reg : region_fields) {
         LOG(INFO) << " " << reg.first << ":";
         for(auto& fld : reg.second) {
@@ -69,5 +130,69 @@ MeshParser::getField(const std::string& file, const std::string& observable, con
     }
     LOG(DEBUG) << "Field with " << field.size() << " points";
 
+    if(cache_) {
+        write_cache(file, cache_file, field);
+    }
     return field;
 }
+
+std::string MeshParser::cache_file_name(const std::string& file, const std::string& key) {
+    // FNV-1a hash of the data description, which is stable between different platforms and compilers
+    std::uint64_t hash = 14695981039346656037ull;
+    for(auto c : key) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    std::stringstream name;
+    name << file << "." << std::hex << std::setw(16) << std::setfill('0') << hash << ".cache";
+    return name.str();
+}
+
+bool MeshParser::read_cache(const std::string& file, const std::string& cache_file, std::vector<Point>& points) {
+    std::ifstream cache(cache_file, std::ios::binary);
+    if(!cache) {
+        return false;
+    }
+
+    CacheHeader header{};
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    if(!cache.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, cache_magic, sizeof(header.magic)) != 0 || !get_file_stat(file, size, mtime) ||
+       header.source_size != size || header.source_mtime != mtime) {
+        LOG(INFO) << "Cache file \"" << cache_file << "\" does not match input file, parsing input file";
+        return false;
+    }
+
+    points.resize(header.points);
+    for(auto& point : points) {
+        double coordinates[3];
+        if(!cache.read(reinterpret_cast<char*>(coordinates), sizeof(coordinates))) {
+            LOG(WARNING) << "Cache file \"" << cache_file << "\" is incomplete, parsing input file";
+            points.clear();
+            return false;
+        }
+        point = Point(coordinates[0], coordinates[1], coordinates[2]);
+    }
+    return true;
+}
+
+void MeshParser::write_cache(const std::string& file, const std::string& cache_file, const std::vector<Point>& points) {
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(header.magic));
+    if(!get_file_stat(file, header.source_size, header.source_mtime)) {
+        return;
+    }
+    header.points = points.size();
+
+    std::ofstream cache(cache_file, std::ios::binary | std::ios::trunc);
+    cache.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(const auto& point : points) {
+        double coordinates[3] = {point.x, point.y, point.z};
+        cache.write(reinterpret_cast<const char*>(coordinates), sizeof(coordinates));
+    }
+    if(!cache.good()) {
+        LOG(WARNING) << "Could not write cache file \"" << cache_file << "\"";
+        return;
+    }
+    LOG(INFO) << "Stored parsed data in cache file \"" << cache_file << "\"";
+}
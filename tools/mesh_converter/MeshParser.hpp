@@ -29,6 +29,16 @@ namespace mesh_converter {
          */
         virtual ~MeshParser() = default;
 
+        /**
+         * @brief Enable the cache of parsed meshes and fields
+         * @param enable If parsed data should be read from and stored to cache files next to the input files
+         *
+         * The mesh points and field values extracted from an input file are stored in a binary cache file, named after the
+         * input file and the regions and observable requested. They are read from this file instead of parsing the input
+         * file again as long as the size and modification time of the input file are unchanged.
+         */
+        void setCache(bool enable) { cache_ = enable; }
+
         std::vector<Point> getMesh(const std::string& file, const std::vector<std::string>& regions);
         std::vector<Point>
         getField(const std::string& file, const std::string& observable, const std::vector<std::string>& regions);
@@ -37,16 +47,48 @@ namespace mesh_converter {
         /**
          * @brief Method to read grids of mesh points from the given file
          * @param  file_name Canonical path of the input file
-         * @return           Map with mesh points for all regions found in the file
+         * @param  regions   Regions to read, all other regions may be skipped
+         * @return           Map with mesh points for the regions found in the file
          */
-        virtual MeshMap read_meshes(const std::string& file_name) = 0;
+        virtual MeshMap read_meshes(const std::string& file_name, const std::vector<std::string>& regions) = 0;
 
         /**
          * @brief Method to read fields from the given file
-         * @param  file_name Canonical path pof the input file
-         * @return           Map with all fields for the different regions
+         * @param  file_name  Canonical path pof the input file
+         * @param  observable Observable to read, all other observables may be skipped
+         * @param  regions    Regions to read, all other regions may be skipped
+         * @return            Map with the fields for the different regions
          */
-        virtual FieldMap read_fields(const std::string& file_name) = 0;
+        virtual FieldMap read_fields(const std::string& file_name,
+                                     const std::string& observable,
+                                     const std::vector<std::string>& regions) = 0;
+
+        /**
+         * @brief Get the name of the cache file for data extracted from an input file
+         * @param  file Path of the input file
+         * @param  key  Description of the data extracted
+         * @return      Path of the cache file
+         */
+        static std::string cache_file_name(const std::string& file, const std::string& key);
+
+        /**
+         * @brief Read points from a cache file if it is valid for the input file
+         * @param  file       Path of the input file
+         * @param  cache_file Path of the cache file
+         * @param  points     Vector to store the points in
+         * @return            True if the points have been read from the cache
+         */
+        static bool read_cache(const std::string& file, const std::string& cache_file, std::vector<Point>& points);
+
+        /**
+         * @brief Write points to a cache file for the input file
+         * @param  file       Path of the input file
+         * @param  cache_file Path of the cache file
+         * @param  points     Points to store
+         */
+        static void write_cache(const std::string& file, const std::string& cache_file, const std::vector<Point>& points);
+
+        bool cache_{false};
     };
 
 } // namespace mesh_converter
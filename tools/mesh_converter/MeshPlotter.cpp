@@ -4,6 +4,7 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include "TCanvas.h"
 #include "TFile.h"
@@ -15,6 +16,8 @@
 #include "tools/field_parser.h"
 #include "tools/units.h"
 
+#include "ThreadPool.hpp"
+
 using namespace allpix;
 
 void interrupt_handler(int);
@@ -62,6 +65,8 @@ int main(int argc, char** argv) {
         bool flag_cut = false;
         size_t slice_cut = 0;
         bool log_scale = false;
+        bool cache_init = false;
+        unsigned int num_threads = std::max(std::thread::hardware_concurrency(), 1u);
         allpix::LogLevel log_level = allpix::LogLevel::INFO;
 
         for(int i = 1; i < argc; i++) {
@@ -87,6 +92,10 @@ int main(int argc, char** argv) {
                 flag_cut = true;
             } else if(strcmp(argv[i], "-l") == 0) {
                 log_scale = true;
+            } else if(strcmp(argv[i], "-m") == 0) {
+                cache_init = true;
+            } else if(strcmp(argv[i], "-j") == 0 && (i + 1 < argc)) {
+                num_threads = std::max(static_cast<unsigned int>(std::atoi(argv[++i])), 1u);
             } else {
                 std::cout << "Unrecognized command line argument or missing value\"" << argv[i] << std::endl;
                 print_help = true;
@@ -109,7 +118,11 @@ int main(int argc, char** argv) {
             std::cout << "Optional parameters:" << std::endl;
             std::cout << "\t -c <cut>               projection height index (default is mesh_pitch / 2)" << std::endl;
             std::cout << "\t -h                     display this help text" << std::endl;
+            std::cout << "\t -j <threads>           number of threads to slice the field with (default is all cores)"
+                      << std::endl;
             std::cout << "\t -l                     plot with logarithmic scale if set" << std::endl;
+            std::cout << "\t -m                     store INIT files as memory-mappable APF file for faster reading"
+                      << std::endl;
             std::cout << "\t -o <output_file_name>  name of the file to output (default is efield.png)" << std::endl;
             std::cout << "\t -p <plane>             plane to be ploted. xy, yz or zx (default is yz)" << std::endl;
             std::cout << "\t -u <units>             units to interpret the field data in" << std::endl;
@@ -127,11 +140,15 @@ int main(int argc, char** argv) {
         size_t lastindex = file_name.find_last_of('.');
         std::string observable = file_name.substr(firstindex + 1, lastindex - (firstindex + 1));
 
-        // FIXME this should be done in a more elegant way
-        FieldQuantity quantity = (observable == "ElectricField" ? FieldQuantity::VECTOR : FieldQuantity::SCALAR);
+        // Take the quantity from the file header, falling back to the observable for INIT files without field data
+        FieldQuantity quantity = FieldParser<double>::getInfoByFileName(file_name).quantity;
+        if(quantity != FieldQuantity::VECTOR && quantity != FieldQuantity::SCALAR) {
+            quantity = (observable == "ElectricField" ? FieldQuantity::VECTOR : FieldQuantity::SCALAR);
+        }
 
+        // Memory-mappable files are mapped instead of read, such that only the pages of the slice are loaded
         FieldParser<double> field_parser(quantity);
-        auto field_data = field_parser.getByFileName(file_name, units);
+        auto field_data = field_parser.getByFileName(file_name, units, cache_init);
         size_t xdiv = field_data.getDimensions()[0], ydiv = field_data.getDimensions()[1],
                zdiv = field_data.getDimensions()[2];
 
@@ -141,7 +158,7 @@ int main(int argc, char** argv) {
         int x_bin = 0;
         int y_bin = 0;
         size_t start_x = 0, start_y = 0, start_z = 0;
-        size_t stop_x = xdiv, stop_y = ydiv, stop_z = zdiv;
+        size_t slice_size = 0;
         if(plane == "xy") {
             if(!flag_cut) {
                 slice_cut = (zdiv + 1) / 2;
@@ -149,7 +166,7 @@ int main(int argc, char** argv) {
 
             // z is the slice:
             start_z = slice_cut;
-            stop_z = start_z + 1;
+            slice_size = zdiv;
 
             // scale the plot axes:
             x_bin = static_cast<int>(xdiv);
@@ -161,7 +178,7 @@ int main(int argc, char** argv) {
 
             // x is the slice:
             start_x = slice_cut;
-            stop_x = start_x + 1;
+            slice_size = xdiv;
 
             x_bin = static_cast<int>(ydiv);
             y_bin = static_cast<int>(zdiv);
@@ -172,12 +189,17 @@ int main(int argc, char** argv) {
 
             // y is the slice:
             start_y = slice_cut;
-            stop_y = start_y + 1;
+            slice_size = ydiv;
 
             x_bin = static_cast<int>(zdiv);
             y_bin = static_cast<int>(xdiv);
         }
 
+        if(slice_cut >= slice_size) {
+            throw std::invalid_argument("slice index " + std::to_string(slice_cut) + " is outside of the field with " +
+                                        std::to_string(slice_size) + " divisions");
+        }
+
         // Create and fill histogram
         auto efield_map = new TH2D(
             Form("%s", observable.c_str()), Form("%s", observable.c_str()), x_bin, 1, x_bin + 1, y_bin, 1, y_bin + 1);
@@ -213,41 +235,72 @@ int main(int argc, char** argv) {
             output_name_log = "_log";
         }
 
-        int plot_x, plot_y;
-        auto data = field_data.getData();
-        for(size_t x = start_x; x < stop_x; x++) {
-            for(size_t y = start_y; y < stop_y; y++) {
-                for(size_t z = start_z; z < stop_z; z++) {
-                    // Select the indices for plotting:
-                    if(plane == "xy") {
-                        plot_x = static_cast<int>(x);
-                        plot_y = static_cast<int>(y);
-                    } else if(plane == "yz") {
-                        plot_x = static_cast<int>(y);
-                        plot_y = static_cast<int>(z);
-                    } else {
-                        plot_x = static_cast<int>(z);
-                        plot_y = static_cast<int>(x);
-                    }
-
+        // Select the indices of the field point for a cell of the plot
+        auto field_point = [&](size_t plot_x, size_t plot_y) {
+            if(plane == "xy") {
+                return plot_x * ydiv * zdiv + plot_y * zdiv + start_z;
+            } else if(plane == "yz") {
+                return start_x * ydiv * zdiv + plot_x * zdiv + plot_y;
+            }
+            return plot_y * ydiv * zdiv + start_y * zdiv + plot_x;
+        };
+
+        // Slice the field in blocks of rows of the plot on many threads, the data is accessed without copying it
+        struct SliceBlock {
+            std::vector<double> plot_x, plot_y, norm, ex, ey, ez;
+        };
+        const auto* data = field_data.getValues().get();
+        auto slice_block = [&](size_t row_begin, size_t row_end) {
+            SliceBlock block;
+            for(size_t plot_y = row_begin; plot_y < row_end; ++plot_y) {
+                for(size_t plot_x = 0; plot_x < static_cast<size_t>(x_bin); ++plot_x) {
+                    block.plot_x.push_back(static_cast<double>(plot_x));
+                    block.plot_y.push_back(static_cast<double>(plot_y));
                     if(quantity == FieldQuantity::VECTOR) {
                         // Fill field maps for the individual vector components as well as the magnitude
-                        auto base = x * ydiv * zdiv * 3 + y * zdiv * 3 + z * 3;
-                        efield_map->Fill(
-                            plot_x,
-                            plot_y,
-                            sqrt(pow(data->at(base + 0), 2) + pow(data->at(base + 1), 2) + pow(data->at(base + 2), 2)));
-                        exfield_map->Fill(plot_x, plot_y, data->at(base + 0));
-                        eyfield_map->Fill(plot_x, plot_y, data->at(base + 1));
-                        ezfield_map->Fill(plot_x, plot_y, data->at(base + 2));
-
+                        const auto* point = data + field_point(plot_x, plot_y) * 3;
+                        block.norm.push_back(std::sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]));
+                        block.ex.push_back(point[0]);
+                        block.ey.push_back(point[1]);
+                        block.ez.push_back(point[2]);
                     } else {
                         // Fill one map with the scalar quantity
-                        efield_map->Fill(plot_x, plot_y, data->at(x * ydiv * zdiv + y * zdiv + z));
+                        block.norm.push_back(data[field_point(plot_x, plot_y)]);
                     }
                 }
             }
+            return block;
+        };
+
+        // clang-format off
+        auto init_function = [log_level = allpix::Log::getReportingLevel(), log_format = allpix::Log::getFormat()]() {
+            // clang-format on
+            // Initialize the threads to the same log level and format as the master setting
+            allpix::Log::setReportingLevel(log_level);
+            allpix::Log::setFormat(log_format);
+        };
+
+        LOG(STATUS) << "Slicing field with " << num_threads << " threads";
+        ::ThreadPool pool(num_threads, init_function);
+        std::vector<std::future<SliceBlock>> block_futures;
+        auto rows = static_cast<size_t>(y_bin);
+        auto rows_per_block = std::max<size_t>(1, rows / (4 * num_threads));
+        for(size_t row = 0; row < rows; row += rows_per_block) {
+            block_futures.push_back(pool.submit(slice_block, row, std::min(rows, row + rows_per_block)));
+        }
+
+        // Fill the histograms with the blocks, which cannot be done concurrently
+        for(auto& block_future : block_futures) {
+            auto block = block_future.get();
+            auto entries = static_cast<int>(block.norm.size());
+            efield_map->FillN(entries, block.plot_x.data(), block.plot_y.data(), block.norm.data());
+            if(quantity == FieldQuantity::VECTOR) {
+                exfield_map->FillN(entries, block.plot_x.data(), block.plot_y.data(), block.ex.data());
+                eyfield_map->FillN(entries, block.plot_x.data(), block.plot_y.data(), block.ey.data());
+                ezfield_map->FillN(entries, block.plot_x.data(), block.plot_y.data(), block.ez.data());
+            }
         }
+        pool.destroy();
 
         if(output_file_name.empty()) {
             output_file_name = file_name.substr(0, lastindex);
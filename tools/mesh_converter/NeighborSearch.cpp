@@ -0,0 +1,60 @@
+#include "NeighborSearch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace mesh_converter;
+
+void NeighborSearch::setQuery(const Point& query) {
+    query_ = query;
+    valid_radius_ = -1;
+    if(search_radius_ > 0) {
+        // All points within this radius around the query point are inside the ball searched before. A small tolerance
+        // accounts for the rounding of the distances.
+        auto shift = std::sqrt(unibn::L2Distance<Point>::compute(query_, center_));
+        valid_radius_ = (search_radius_ - shift) * (1 - 1e-12);
+    }
+    sort_neighbors();
+}
+
+size_t NeighborSearch::count(double radius) {
+    if(radius > valid_radius_) {
+        center_ = query_;
+        search_radius_ = radius + margin_;
+        octree_.radiusNeighbors<unibn::L2Distance<Point>>(center_, search_radius_, found_, found_distances_);
+        valid_radius_ = search_radius_;
+        sort_neighbors();
+    }
+
+    // Same strict comparison of the squared distance as used by the octree search
+    auto sqr_radius = unibn::L2Distance<Point>::sqr(radius);
+    auto end = std::lower_bound(
+        sorted_.begin(), sorted_.end(), sqr_radius, [](const std::pair<double, uint32_t>& neighbor, double value) {
+            return neighbor.first < value;
+        });
+    return static_cast<size_t>(end - sorted_.begin());
+}
+
+void NeighborSearch::sort_neighbors() {
+    sorted_.clear();
+    neighbors_.clear();
+    if(valid_radius_ <= 0) {
+        return;
+    }
+
+    auto sqr_valid_radius = unibn::L2Distance<Point>::sqr(valid_radius_);
+    for(size_t i = 0; i < found_.size(); ++i) {
+        auto distance = (query_.x == center_.x && query_.y == center_.y && query_.z == center_.z)
+                            ? found_distances_[i]
+                            : unibn::L2Distance<Point>::compute(query_, points_[found_[i]]);
+        if(distance < sqr_valid_radius) {
+            sorted_.emplace_back(distance, found_[i]);
+        }
+    }
+    std::sort(sorted_.begin(), sorted_.end());
+
+    neighbors_.reserve(sorted_.size());
+    for(auto& neighbor : sorted_) {
+        neighbors_.push_back(neighbor.second);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef ALLPIX_NEIGHBORSEARCH_H
+#define ALLPIX_NEIGHBORSEARCH_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "MeshElement.hpp"
+#include "octree/Octree.hpp"
+
+namespace mesh_converter {
+
+    /**
+     * @brief Search of the mesh points closest to a query point, ordered by their distance
+     *
+     * The neighbors of a query point are provided sorted by distance, ties broken by the point index, and the number of
+     * neighbors within a given radius is found in the sorted list without a new search of the octree. The octree is searched
+     * with a radius extended by a margin, and the points found are kept for the following query points: as long as the
+     * search ball of the new query point lies within the ball searched before, the neighbors are selected from the kept
+     * points instead of searching the octree again. Query points should therefore be visited in an order where consecutive
+     * points are close to each other. The search is not thread-safe, every thread should use its own object.
+     */
+    class NeighborSearch {
+    public:
+        /**
+         * @brief Construct the search for the points stored in an octree
+         * @param octree Octree initialized with the mesh points
+         * @param points Mesh points the octree has been initialized with
+         * @param margin Margin added to the search radius when searching the octree
+         */
+        NeighborSearch(const unibn::Octree<Point>& octree, const std::vector<Point>& points, double margin)
+            : octree_(octree), points_(points), margin_(margin) {}
+
+        /**
+         * @brief Set the point to search the neighbors of
+         * @param query Query point
+         */
+        void setQuery(const Point& query);
+
+        /**
+         * @brief Get the number of neighbors of the query point within a radius, searching the octree if required
+         * @param radius Search radius
+         * @return Number of neighbors closer than the radius, which are the first entries of \ref getNeighbors
+         */
+        size_t count(double radius);
+
+        /**
+         * @brief Get the indices of the neighbors of the query point sorted by distance
+         * @return Sorted neighbor indices, complete up to the largest radius passed to \ref count for this query point
+         */
+        const std::vector<uint32_t>& getNeighbors() const { return neighbors_; }
+
+    private:
+        /**
+         * @brief Sort the kept points within the radius for which they are complete around the query point
+         */
+        void sort_neighbors();
+
+        const unibn::Octree<Point>& octree_;
+        const std::vector<Point>& points_;
+        double margin_;
+
+        // Points found in the last octree search around its center
+        Point center_;
+        double search_radius_{-1};
+        std::vector<uint32_t> found_;
+        std::vector<double> found_distances_;
+
+        // Neighbors of the current query point, complete within the valid radius
+        Point query_;
+        double valid_radius_{-1};
+        std::vector<std::pair<double, uint32_t>> sorted_;
+        std::vector<uint32_t> neighbors_;
+    };
+} // namespace mesh_converter
+
+#endif // ALLPIX_NEIGHBORSEARCH_H
@@ -1,5 +1,6 @@
 #include "DFISEParser.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <exception>
@@ -16,7 +17,12 @@
 
 using namespace mesh_converter;
 
-MeshMap DFISEParser::read_meshes(const std::string& file_name) {
+/**
+ * Faces and elements are stored as flat lists of vertex indices with the offsets of every face or element, and the vertices
+ * of the regions are marked in a mask per region instead of collecting the vertices of all their elements. Only the regions
+ * requested are kept.
+ */
+MeshMap DFISEParser::read_meshes(const std::string& file_name, const std::vector<std::string>& regions) {
     std::ifstream file(file_name);
     if(!file) {
         throw std::runtime_error("file cannot be accessed");
@@ -33,10 +39,19 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
 
     std::vector<Point> vertices;
     std::vector<std::pair<long unsigned int, long unsigned int>> edges;
-    std::vector<std::vector<long unsigned int>> faces;
-    std::vector<std::vector<long unsigned int>> elements;
+    std::vector<size_t> face_offsets{0};
+    std::vector<long unsigned int> face_vertices;
+    std::vector<size_t> element_offsets{0};
+    std::vector<long unsigned int> element_vertices;
 
-    std::map<std::string, std::vector<long unsigned int>> regions_vertices;
+    std::map<std::string, std::vector<bool>> regions_vertices;
+    auto is_requested = [&](const std::string& name) {
+        return regions.empty() || std::find(regions.begin(), regions.end(), name) != regions.end();
+    };
+
+    // Buffers reused for every face and element
+    std::vector<long unsigned int> face;
+    std::vector<long unsigned int> element;
 
     Point point(-1.0, -1.0, -1.0);
 
@@ -132,12 +147,12 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
                 }
                 break;
             case DFSection::FACES:
-                if(faces.size() != data_count) {
+                if(face_offsets.size() - 1 != data_count) {
                     throw std::runtime_error("incorrect number of faces");
                 }
                 break;
             case DFSection::ELEMENTS:
-                if(elements.size() != data_count) {
+                if(element_offsets.size() - 1 != data_count) {
                     throw std::runtime_error("incorrect number of elements");
                 }
                 break;
@@ -222,7 +237,7 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
             // Get vertex indices for every face
             size_t n;
             sstr >> n;
-            std::vector<long unsigned int> face;
+            face.clear();
             for(size_t i = 0; i < n; ++i) {
                 long edge_idx;
                 sstr >> edge_idx;
@@ -260,12 +275,13 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
             face.erase(iter, face.end());
             face.pop_back();
 
-            faces.push_back(face);
+            face_vertices.insert(face_vertices.end(), face.begin(), face.end());
+            face_offsets.push_back(face_vertices.size());
         } break;
         case DFSection::ELEMENTS: {
             int k;
             sstr >> k;
-            std::vector<long unsigned int> element;
+            element.clear();
 
             size_t size = 0;
             switch(k) {
@@ -319,32 +335,47 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
                     element.push_back(edge.second);
                 }
                 if(size == 4) {
-                    if(element_idx >= static_cast<long>(faces.size())) {
+                    if(element_idx >= static_cast<long>(face_offsets.size() - 1)) {
                         throw std::runtime_error("face index is higher than number of faces");
                     }
-                    auto face = faces[static_cast<size_t>(element_idx)];
-                    if(reverse) {
-                        std::reverse(face.begin() + 1, face.end());
+                    auto face_idx = static_cast<size_t>(element_idx);
+                    auto face_begin = face_vertices.begin() + static_cast<std::ptrdiff_t>(face_offsets[face_idx]);
+                    auto face_end = face_vertices.begin() + static_cast<std::ptrdiff_t>(face_offsets[face_idx + 1]);
+                    auto element_face = element.insert(element.end(), face_begin, face_end);
+                    if(reverse && element_face != element.end()) {
+                        std::reverse(element_face + 1, element.end());
                     }
-                    element.insert(element.end(), face.begin(), face.end());
                 }
             }
 
-            elements.push_back(element);
+            element_vertices.insert(element_vertices.end(), element.begin(), element.end());
+            element_offsets.push_back(element_vertices.size());
             break;
         }
         case DFSection::REGION: {
             if(sub_section != DFSection::ELEMENTS) {
                 continue;
             }
+            std::vector<bool>* region_vertices = nullptr;
+            if(is_requested(region)) {
+                region_vertices = &regions_vertices[region];
+                region_vertices->resize(vertices.size(), false);
+            }
             long unsigned int elem_idx;
             while(sstr >> elem_idx) {
-                if(elem_idx >= elements.size()) {
+                if(elem_idx >= element_offsets.size() - 1) {
                     throw std::runtime_error("element index is higher than number of elements");
                 }
+                if(region_vertices == nullptr) {
+                    continue;
+                }
 
-                regions_vertices[region].insert(
-                    regions_vertices[region].end(), elements[elem_idx].begin(), elements[elem_idx].end());
+                for(auto i = element_offsets[elem_idx]; i < element_offsets[elem_idx + 1]; ++i) {
+                    if(element_vertices[i] >= region_vertices->size()) {
+                        throw std::runtime_error("vertex index is higher than number of vertices");
+                    }
+                    (*region_vertices)[element_vertices[i]] = true;
+                }
             }
 
         } break;
@@ -356,25 +387,27 @@ MeshMap DFISEParser::read_meshes(const std::string& file_name) {
 
     std::map<std::string, std::vector<Point>> ret_map;
     for(auto& name_region_vertices : regions_vertices) {
-        auto region_vertices = name_region_vertices.second;
-
-        std::sort(region_vertices.begin(), region_vertices.end());
-        auto iter = std::unique(region_vertices.begin(), region_vertices.end());
-        region_vertices.erase(iter, region_vertices.end());
-
-        std::vector<Point> ret_vector;
-        ret_vector.reserve(region_vertices.size());
-        for(auto& vertex_idx : region_vertices) {
-            ret_vector.push_back(vertices[vertex_idx]);
+        const auto& region_vertices = name_region_vertices.second;
+
+        // Vertices of the region in order of their index
+        auto& ret_vector = ret_map[name_region_vertices.first];
+        ret_vector.reserve(static_cast<size_t>(std::count(region_vertices.begin(), region_vertices.end(), true)));
+        for(size_t vertex_idx = 0; vertex_idx < region_vertices.size(); ++vertex_idx) {
+            if(region_vertices[vertex_idx]) {
+                ret_vector.push_back(vertices[vertex_idx]);
+            }
         }
-
-        ret_map[name_region_vertices.first] = ret_vector;
     }
 
     return ret_map;
 }
 
-FieldMap DFISEParser::read_fields(const std::string& file_name) {
+/**
+ * Only the values of datasets for the requested observable and regions are kept, all other datasets are skipped.
+ */
+FieldMap DFISEParser::read_fields(const std::string& file_name,
+                                  const std::string& observable_name,
+                                  const std::vector<std::string>& regions) {
     std::ifstream file(file_name);
     if(!file) {
         throw std::runtime_error("file cannot be accessed");
@@ -463,6 +496,15 @@ FieldMap DFISEParser::read_fields(const std::string& file_name) {
                     LOG(DEBUG) << "Opening value section with " << header_data << " entries";
                     sub_section = DFSection::VALUES;
                     data_count = std::stoul(header_data);
+
+                    // Skip the values of datasets which are not requested
+                    if(observable == observable_name &&
+                       (regions.empty() || std::find(regions.begin(), regions.end(), region) != regions.end())) {
+                        region_electric_field_num.reserve(data_count);
+                    } else {
+                        LOG(DEBUG) << "Skipping values of " << observable << " in region " << region;
+                        sub_section = DFSection::IGNORED;
+                    }
                 } else {
                     if(main_section != DFSection::NONE) {
                         sub_section = DFSection::IGNORED;
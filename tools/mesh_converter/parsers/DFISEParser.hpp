@@ -5,6 +5,7 @@
 
 #include <iostream>
 #include <map>
+#include <string>
 #include <vector>
 
 namespace mesh_converter {
@@ -33,10 +34,12 @@ namespace mesh_converter {
 
     public:
         // Read the grid
-        MeshMap read_meshes(const std::string& file_name) override;
+        MeshMap read_meshes(const std::string& file_name, const std::vector<std::string>& regions) override;
 
         // Read the electric field
-        FieldMap read_fields(const std::string& file_name) override;
+        FieldMap read_fields(const std::string& file_name,
+                             const std::string& observable,
+                             const std::vector<std::string>& regions) override;
     };
 } // namespace mesh_converter
 
@@ -0,0 +1,252 @@
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <TClass.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TFileMerger.h>
+#include <TKey.h>
+#include <TList.h>
+
+#include "core/utils/log.h"
+
+void interrupt_handler(int);
+
+/**
+ * @brief Handle termination request (CTRL+C)
+ */
+void interrupt_handler(int) {
+    LOG(STATUS) << "Interrupted! Aborting merging...";
+    allpix::Log::finish();
+    std::exit(0);
+}
+
+// Directories written by the ROOTObjectWriter which describe the run and cannot be merged
+static const std::vector<std::string> run_directories = {"config", "detectors", "models"};
+
+/**
+ * @brief Read all configuration values stored in a directory and its subdirectories
+ * @param directory Directory to read from
+ * @param prefix Path of the directory prepended to the keys
+ * @param values Map of the full key paths to the values
+ */
+static void read_values(TDirectory* directory, const std::string& prefix, std::map<std::string, std::string>& values) {
+    for(auto* object : *directory->GetListOfKeys()) {
+        auto* key = static_cast<TKey*>(object);
+        auto path = prefix + "/" + key->GetName();
+        auto* cls = TClass::GetClass(key->GetClassName());
+        if(cls != nullptr && cls->InheritsFrom(TDirectory::Class())) {
+            read_values(static_cast<TDirectory*>(key->ReadObj()), path, values);
+        } else {
+            std::unique_ptr<std::string> value(key->ReadObject<std::string>());
+            if(value != nullptr) {
+                values[path] = *value;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Copy all objects of a directory and its subdirectories to another directory
+ * @param source Directory to copy from
+ * @param target Directory to copy to
+ * @param replace Values of string objects to replace, by the path of the object
+ * @param path Path of the source directory
+ */
+static void copy_directory(TDirectory* source,
+                           TDirectory* target,
+                           const std::map<std::string, std::string>& replace,
+                           const std::string& path) {
+    for(auto* object : *source->GetListOfKeys()) {
+        auto* key = static_cast<TKey*>(object);
+        auto key_path = path + "/" + key->GetName();
+        auto* cls = TClass::GetClass(key->GetClassName());
+        if(cls == nullptr) {
+            LOG(WARNING) << "Skipping object " << key_path << " of unknown class " << key->GetClassName();
+            continue;
+        }
+        if(cls->InheritsFrom(TDirectory::Class())) {
+            copy_directory(static_cast<TDirectory*>(key->ReadObj()), target->mkdir(key->GetName()), replace, key_path);
+            continue;
+        }
+
+        auto replacement = replace.find(key_path);
+        if(replacement != replace.end()) {
+            auto value = replacement->second;
+            target->WriteObject(&value, key->GetName());
+        } else {
+            auto* value = key->ReadObjectAny(cls);
+            target->WriteObjectAny(value, cls, key->GetName());
+            cls->Destructor(value);
+        }
+    }
+}
+
+/**
+ * @brief Merge the output files of the shards of a run
+ *
+ * Trees are concatenated and histograms are added by the ROOT file merger. The configuration and detector setup of the
+ * run written by the ROOTObjectWriter cannot be merged and is copied from the first input file containing it, with the
+ * number of events replaced by the total number of events of all input files.
+ */
+int main(int argc, const char* argv[]) {
+    // If no arguments are provided, print the help:
+    bool print_help = false;
+    int return_code = 0;
+    if(argc == 1) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Add stream and set default logging level
+    allpix::Log::addStream(std::cout);
+
+    // Install abort handler (CTRL+\) and interrupt handler (CTRL+C)
+    std::signal(SIGQUIT, interrupt_handler);
+    std::signal(SIGINT, interrupt_handler);
+
+    std::string output_file_name;
+    std::vector<std::string> input_file_names;
+    bool force = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
+            try {
+                auto log_level = allpix::Log::getLevelFromString(std::string(argv[++i]));
+                allpix::Log::setReportingLevel(log_level);
+            } catch(std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid verbosity level \"" << std::string(argv[i]) << "\", ignoring overwrite";
+                return_code = 1;
+            }
+        } else if(strcmp(argv[i], "-o") == 0 && (i + 1 < argc)) {
+            output_file_name = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-f") == 0) {
+            force = true;
+        } else if(argv[i][0] != '-') {
+            input_file_names.emplace_back(argv[i]);
+        } else {
+            LOG(ERROR) << "Unrecognized command line argument or missing value \"" << argv[i] << "\"";
+            print_help = true;
+            return_code = 1;
+        }
+    }
+
+    if(output_file_name.empty() || input_file_names.empty()) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Print help if requested or no arguments given
+    if(print_help) {
+        std::cerr << "Usage: merge_output -o <output> <input> [<input> ...]" << std::endl;
+        std::cout << "Merges the ROOT output files of the shards of a run into a single file" << std::endl;
+        std::cout << "Required parameters:" << std::endl;
+        std::cout << "\t -o <file>    name of the merged output file" << std::endl;
+        std::cout << "\t <input>      names of the input files to merge" << std::endl;
+        std::cout << "Optional parameters:" << std::endl;
+        std::cout << "\t -f           overwrite an existing output file" << std::endl;
+        std::cout << "\t -v <level>   verbosity level (default reporting level is INFO)" << std::endl;
+        std::cout << "\t -h           print this help text" << std::endl;
+
+        allpix::Log::finish();
+        return return_code;
+    }
+
+    // Read the run configuration of all input files
+    unsigned long total_events = 0;
+    std::map<std::string, std::string> first_values;
+    std::string run_file_name;
+    std::set<std::string> shard_indices;
+    for(size_t i = 0; i < input_file_names.size(); ++i) {
+        auto input_file = std::unique_ptr<TFile>(TFile::Open(input_file_names[i].c_str(), "READ"));
+        if(input_file == nullptr || input_file->IsZombie()) {
+            LOG(FATAL) << "Could not open input file " << input_file_names[i];
+            allpix::Log::finish();
+            return 1;
+        }
+
+        auto* config_dir = input_file->GetDirectory("config");
+        if(config_dir == nullptr) {
+            continue;
+        }
+        std::map<std::string, std::string> values;
+        read_values(config_dir, "config", values);
+        auto events = values.find("config/Allpix/number_of_events");
+        if(events != values.end()) {
+            total_events += std::stoul(events->second);
+        }
+        auto shard_index = values.find("config/Allpix/shard_index");
+        if(shard_index != values.end() && !shard_indices.insert(shard_index->second).second) {
+            LOG(WARNING) << "Input file " << input_file_names[i] << " contains shard " << shard_index->second
+                         << " which has already been added";
+        }
+
+        // Warn about inputs not belonging to the same run
+        if(run_file_name.empty()) {
+            run_file_name = input_file_names[i];
+            first_values = values;
+            continue;
+        }
+        for(auto& value : values) {
+            if(value.first == "config/Allpix/number_of_events" ||
+               value.first == "config/Allpix/shard_index") {
+                continue;
+            }
+            auto first_value = first_values.find(value.first);
+            if(first_value == first_values.end() || first_value->second != value.second) {
+                LOG(WARNING) << "Configuration value " << value.first << " of input file " << input_file_names[i]
+                             << " differs from the first input file, files might not belong to the same run";
+                break;
+            }
+        }
+    }
+
+    // Merge trees and histograms, skipping the description of the run
+    LOG(STATUS) << "Merging " << input_file_names.size() << " files into " << output_file_name;
+    TFileMerger merger(false, false);
+    merger.SetPrintLevel(0);
+    if(!merger.OutputFile(output_file_name.c_str(), force ? "RECREATE" : "CREATE")) {
+        LOG(FATAL) << "Could not create output file " << output_file_name << ", use -f to overwrite an existing file";
+        allpix::Log::finish();
+        return 1;
+    }
+    for(auto& input_file_name : input_file_names) {
+        LOG(INFO) << "Adding input file " << input_file_name;
+        merger.AddFile(input_file_name.c_str(), false);
+    }
+    for(auto& directory : run_directories) {
+        merger.AddObjectNames(directory.c_str());
+    }
+    if(!merger.PartialMerge(TFileMerger::kAll | TFileMerger::kRegular | TFileMerger::kSkipListed)) {
+        LOG(FATAL) << "Merging of the input files failed";
+        allpix::Log::finish();
+        return 1;
+    }
+
+    // Copy the description of the run from the first input file with the total number of events
+    if(!run_file_name.empty()) {
+        auto input_file = std::unique_ptr<TFile>(TFile::Open(run_file_name.c_str(), "READ"));
+        auto output_file = std::unique_ptr<TFile>(TFile::Open(output_file_name.c_str(), "UPDATE"));
+        std::map<std::string, std::string> replace;
+        replace["config/Allpix/number_of_events"] = std::to_string(total_events);
+        for(auto& directory : run_directories) {
+            auto* source = input_file->GetDirectory(directory.c_str());
+            if(source != nullptr) {
+                copy_directory(source, output_file->mkdir(directory.c_str()), replace, directory);
+            }
+        }
+        output_file->Write();
+        LOG(INFO) << "Copied run configuration with a total of " << total_events << " events";
+    }
+
+    LOG(STATUS) << "Merged " << input_file_names.size() << " files into " << output_file_name;
+    allpix::Log::finish();
+    return return_code;
+}
@@ -1,5 +1,8 @@
 #include <csignal>
+#include <deque>
 #include <fstream>
+#include <future>
+#include <memory>
 
 #include "core/config/ConfigReader.hpp"
 #include "core/config/Configuration.hpp"
@@ -65,6 +68,8 @@ int main(int argc, char** argv) {
                 print_help = true;
             } else if(strcmp(argv[i], "--init") == 0) {
                 file_type = allpix::FileType::INIT;
+            } else if(strcmp(argv[i], "--apf2") == 0) {
+                file_type = allpix::FileType::APF2;
             } else if(strcmp(argv[i], "--binning") == 0 && (i + 1 < argc)) {
                 binning = allpix::from_string<XYZVectorInt>(std::string(argv[++i]));
             } else if(strcmp(argv[i], "--matrix") == 0 && (i + 1 < argc)) {
@@ -107,6 +112,9 @@ int main(int argc, char** argv) {
             std::cout
                 << "\t --init                  Switch to enable writing the potential in the INIT format instead of APF"
                 << std::endl;
+            std::cout << "\t --apf2                  Switch to enable writing the potential in the memory-mappable APF2 "
+                         "format, which is written while the potential is generated"
+                      << std::endl;
             std::cout << "\t -v <level>              verbosity level (default reporiting level is INFO)" << std::endl;
             std::cout << "\t -h                      print this help text" << std::endl;
 
@@ -152,7 +160,17 @@ int main(int argc, char** argv) {
         // Start potential generation on many threads:
         auto num_threads = std::max(std::thread::hardware_concurrency(), 1u);
         LOG(STATUS) << "Starting weighting potential generation with " << num_threads << " threads.";
-        auto weighting_potential = std::make_shared<std::vector<double>>();
+
+        // Prepare header and auxiliary information:
+        std::string header = "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " Weighting Potential Generator";
+        std::array<double, 3> size{{fieldsize.x(), fieldsize.y(), fieldsize.z()}};
+        std::array<size_t, 3> gridsize{{binning.x(), binning.y(), binning.z()}};
+
+        // The potential is symmetric under mirroring in x and y around the center of the field. Only the slices and rows up
+        // to the center are calculated, the others are copies of their mirrored counterparts.
+        auto half_x = (binning.x() + 1) / 2;
+        auto half_y = (binning.y() + 1) / 2;
+        auto slice_size = binning.y() * binning.z();
 
         auto generate_section = [&](size_t index_x) {
             allpix::Log::setReportingLevel(log_level);
@@ -188,14 +206,20 @@ int main(int argc, char** argv) {
                 return (1 / (2 * M_PI) * (f(pos.x(), pos.y(), local_z) - sum));
             };
 
-            std::vector<double> slice;
-            for(size_t index_y = 1; index_y <= binning.y(); index_y++) {
-                for(size_t index_z = 1; index_z <= binning.z(); index_z++) {
-                    auto pos = ROOT::Math::XYZPoint(
-                        fieldsize.x() / static_cast<double>(binning.x()) * static_cast<double>(index_x) - fieldsize.x() / 2,
-                        fieldsize.y() / static_cast<double>(binning.y()) * static_cast<double>(index_y) - fieldsize.y() / 2,
-                        fieldsize.z() / static_cast<double>(binning.z()) * static_cast<double>(index_z) - fieldsize.z() / 2);
-                    slice.push_back(potential(pos));
+            // Evaluate the potential at the bin centers
+            auto center = [](double field_size, size_t bins, size_t index) {
+                return field_size / static_cast<double>(bins) * (static_cast<double>(index) + 0.5) - field_size / 2;
+            };
+            std::vector<double> slice(slice_size);
+            for(size_t index_y = 0; index_y < half_y; index_y++) {
+                auto mirror_y = binning.y() - 1 - index_y;
+                for(size_t index_z = 0; index_z < binning.z(); index_z++) {
+                    auto pos = ROOT::Math::XYZPoint(center(fieldsize.x(), binning.x(), index_x),
+                                                    center(fieldsize.y(), binning.y(), index_y),
+                                                    center(fieldsize.z(), binning.z(), index_z));
+                    auto value = potential(pos);
+                    slice[index_y * binning.z() + index_z] = value;
+                    slice[mirror_y * binning.z() + index_z] = value;
                 }
             }
             return slice;
@@ -210,20 +234,42 @@ int main(int argc, char** argv) {
         };
 
         ThreadPool pool(num_threads, init_function);
-        std::vector<std::future<std::vector<double>>> wp_futures;
 
-        // Loop over x coordinate, add tasks for each coordinate to the queue
-        for(size_t x = 1; x <= binning.x(); x++) {
-            wp_futures.push_back(pool.submit(generate_section, x));
+        // APF2 files are written slice by slice while the potential is generated, all other formats are written at the end
+        std::unique_ptr<allpix::MappedFieldWriter<double>> stream_writer;
+        std::shared_ptr<std::vector<double>> weighting_potential;
+        if(file_type == allpix::FileType::APF2) {
+            stream_writer =
+                std::make_unique<allpix::MappedFieldWriter<double>>(output_file_name, header, gridsize, size, 1);
+        } else {
+            weighting_potential = std::make_shared<std::vector<double>>(binning.x() * slice_size);
         }
+        auto store_slice = [&](size_t index_x, const std::vector<double>& slice) {
+            if(stream_writer) {
+                stream_writer->write(index_x * slice_size, slice.data(), slice.size());
+            } else {
+                std::copy(slice.begin(),
+                          slice.end(),
+                          weighting_potential->begin() + static_cast<std::ptrdiff_t>(index_x * slice_size));
+            }
+        };
+
+        // Loop over x coordinate, keeping a limited number of tasks queued to bound the memory of pending slices
+        std::deque<std::future<std::vector<double>>> wp_futures;
+        auto max_pending = 4 * static_cast<size_t>(num_threads);
+        size_t submitted = 0;
+        for(size_t x = 0; x < half_x; x++) {
+            while(submitted < half_x && wp_futures.size() < max_pending) {
+                wp_futures.push_back(pool.submit(generate_section, submitted++));
+            }
 
-        // Merge the result vectors:
-        unsigned int slices_done = 0;
-        for(auto& wp_future : wp_futures) {
-            auto slice = wp_future.get();
-            weighting_potential->insert(weighting_potential->end(), slice.begin(), slice.end());
-            LOG_PROGRESS(INFO, "generation") << "Generating potential: " << (100 * slices_done / wp_futures.size()) << "%";
-            slices_done++;
+            auto slice = wp_futures.front().get();
+            wp_futures.pop_front();
+            store_slice(x, slice);
+            if(binning.x() - 1 - x != x) {
+                store_slice(binning.x() - 1 - x, slice);
+            }
+            LOG_PROGRESS(INFO, "generation") << "Generating potential: " << (100 * x / half_x) << "%";
         }
         LOG_PROGRESS(INFO, "generation") << "Generating potential: 100%";
         pool.destroy();
@@ -232,14 +278,13 @@ int main(int argc, char** argv) {
         auto elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
         LOG(INFO) << "Weighting potential generated in " << elapsed_seconds << " seconds.";
 
-        // Prepare header and auxiliary information:
-        std::string header = "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " Weighting Potential Generator";
-        std::array<double, 3> size{{fieldsize.x(), fieldsize.y(), fieldsize.z()}};
-        std::array<size_t, 3> gridsize{{binning.x(), binning.y(), binning.z()}};
-
-        allpix::FieldData<double> field_data(header, gridsize, size, weighting_potential);
-        allpix::FieldWriter<double> field_writer(allpix::FieldQuantity::SCALAR);
-        field_writer.writeFile(field_data, output_file_name, file_type);
+        if(stream_writer) {
+            stream_writer->close();
+        } else {
+            allpix::FieldData<double> field_data(header, gridsize, size, weighting_potential);
+            allpix::FieldWriter<double> field_writer(allpix::FieldQuantity::SCALAR);
+            field_writer.writeFile(field_data, output_file_name, file_type);
+        }
 
         end = std::chrono::system_clock::now();
         elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();